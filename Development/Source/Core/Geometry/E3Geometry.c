@@ -55,7 +55,9 @@
 //-----------------------------------------------------------------------------
 #include "E3Prefix.h"
 #include "E3View.h"
+#include "E3Pick.h"
 #include "E3Renderer.h"
+#include "E3Set.h"
 #include "E3IOFileFormat.h"
 #include "E3Geometry.h"
 #include "E3GeometryBox.h"
@@ -89,6 +91,112 @@
 //-----------------------------------------------------------------------------
 #define		kWorldSpaceTolerance	1.0e-5f
 
+const TQ3Uns32 kGeometryCacheMaxAlternates					= 3;
+const TQ3Uns32 kGeometryCacheDefaultBudget					= 16 * 1024 * 1024;
+const TQ3Uns32 kGeometryCacheMaxKeyAttributes				= 8;
+
+const TQ3Uns32 kImmediateCacheNumBuckets					= 64;
+const TQ3Uns32 kImmediateCacheDefaultEntries				= 64;
+const TQ3Uns32 kImmediateCacheDefaultIdleFrames				= 60;
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+// Alternate cached representation of a geometry
+//
+// As well as its current cached object, each geometry keeps up to
+// kGeometryCacheMaxAlternates objects which were built for other view
+// states. Alternates are also linked into a global LRU list, and the least
+// recently used are disposed of when they exceed the cache budget.
+struct E3GeometryCacheEntry
+{
+	E3GeometryCacheEntry*		lruPrev;
+	E3GeometryCacheEntry*		lruNext;
+	E3GeometryCacheEntry*		geomNext;
+	E3Geometry*					theGeom;
+	TQ3Uns32					byteSize;
+	E3GeometryCacheKey			cacheKey;
+	TQ3Object					cachedObject;
+};
+
+
+// Global cache state
+struct E3GeometryCacheState
+{
+	E3GeometryCacheEntry*		lruHead;
+	E3GeometryCacheEntry*		lruTail;
+	TQ3Uns32					numEntries;
+	TQ3Uns32					bytesUsed;
+	TQ3Uns32					bytesBudget;
+	volatile TQ3Uns32			numHits;
+	volatile TQ3Uns32			numMisses;
+	volatile TQ3Uns32			numRebuilds;
+	volatile TQ3Uns32			numEvictions;
+};
+
+
+// Immediate mode cached representation
+//
+// Immediate mode geometries are identified by their type, the bytes of
+// their data up to the first attribute set, their attribute sets (and
+// the edit indices of those sets), and the view state they depend on.
+// We hold a reference to each attribute set, so that their addresses
+// can not be reused while the entry exists.
+struct E3ImmediateCacheEntry
+{
+	E3ImmediateCacheEntry*		lruPrev;
+	E3ImmediateCacheEntry*		lruNext;
+	E3ImmediateCacheEntry*		bucketNext;
+	TQ3Uns32					hashValue;
+	TQ3Uns32					lastFrame;
+	TQ3ObjectType				objectType;
+	E3GeometryCacheKey			cacheKey;
+	TQ3Uns32					numAttributeSets;
+	TQ3AttributeSet				attributeSets[kGeometryCacheMaxKeyAttributes];
+	TQ3Uns32					attributeEditIndices[kGeometryCacheMaxKeyAttributes];
+	TQ3Object					cachedObject;
+	TQ3Uns32					dataSize;
+	TQ3Uns8*					theData;
+};
+
+
+// Immediate mode cache state
+struct E3ImmediateCacheState
+{
+	E3ImmediateCacheEntry*		theBuckets[kImmediateCacheNumBuckets];
+	E3ImmediateCacheEntry*		lruHead;
+	E3ImmediateCacheEntry*		lruTail;
+	TQ3Uns32					numEntries;
+	TQ3Uns32					maxEntries;
+	TQ3Uns32					maxIdleFrames;
+	TQ3Uns32					currentFrame;
+	volatile TQ3Uns32			numHits;
+	volatile TQ3Uns32			numMisses;
+};
+
+
+
+
+
+//=============================================================================
+//      Internal globals
+//-----------------------------------------------------------------------------
+//		Note :	The LRU list, and the alternates list of every geometry, are
+//				only accessed with sGeometryCacheLock held. The immediate mode
+//				cache is only accessed with sImmediateCacheLock held.
+//-----------------------------------------------------------------------------
+static E3SpinLock			sGeometryCacheLock = 0;
+static E3GeometryCacheState	sGeometryCache     = { NULL, NULL, 0, 0, kGeometryCacheDefaultBudget, 0, 0, 0, 0 };
+
+static E3SpinLock			sImmediateCacheLock = 0;
+static E3ImmediateCacheState	sImmediateCache     = { { NULL }, NULL, NULL, 0, kImmediateCacheDefaultEntries,
+												kImmediateCacheDefaultIdleFrames, 0, 0, 0 };
+
+
 
 
 
@@ -107,7 +215,11 @@ E3GeometryInfo::E3GeometryInfo	(
 		cacheUpdate			( (TQ3XGeomCacheUpdateMethod)		Find_Method ( kQ3XMethodTypeGeomCacheUpdate ) ) ,
 		cacheNew			( (TQ3XGeomCacheNewMethod)			Find_Method ( kQ3XMethodTypeGeomCacheNew ) ) ,
 		getAttribute		( (TQ3XGeomGetAttributeMethod)		Find_Method ( kQ3XMethodTypeGeomGetAttribute ) ) ,
-		getPublicData		( (TQ3XGeomGetPublicDataMethod)		Find_Method ( kQ3XMethodTypeGeomGetPublicData ) )		 
+		getPublicData		( (TQ3XGeomGetPublicDataMethod)		Find_Method ( kQ3XMethodTypeGeomGetPublicData ) ) ,
+		submitDecomposed	( (TQ3XGeomSubmitDecomposedMethod)	Find_Method ( kQ3XMethodTypeGeomSubmitDecomposed ) ) ,
+		getCacheKey			( (TQ3XGeomGetCacheKeyMethod)		Find_Method ( kQ3XMethodTypeGeomGetCacheKey ) ) ,
+		usesSubdivision		( (TQ3Boolean) ( Find_Method ( kQ3XMethodTypeGeomUsesSubdivision ) != NULL ) ) ,
+		usesOrientation		( (TQ3Boolean) ( Find_Method ( kQ3XMethodTypeGeomUsesOrientation ) != NULL ) )
 	{
 	if ( cacheIsValid == NULL
 	|| cacheUpdate == NULL )
@@ -144,30 +256,798 @@ e3geometry_get_attributes( E3Geometry* theGeom)
 
 
 
-	// Get the pointer to the geometry attribute set.
-	//
-	// Note that this should never be NULL, since we're getting a pointer
-	// to the attribute set here (which should always exist) rather than
-	// the attribute set itself (which may well be NULL).
-	TQ3AttributeSet* attributeSet = getAttribute ( theGeom ) ;
-	Q3_ASSERT_VALID_PTR( attributeSet ) ;
+	// Get the pointer to the geometry attribute set.
+	//
+	// Note that this should never be NULL, since we're getting a pointer
+	// to the attribute set here (which should always exist) rather than
+	// the attribute set itself (which may well be NULL).
+	TQ3AttributeSet* attributeSet = getAttribute ( theGeom ) ;
+	Q3_ASSERT_VALID_PTR( attributeSet ) ;
+	
+	return attributeSet ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_new : Geometry new method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geometry_new ( TQ3Object, void*, const void* )
+	{
+	// No need to do anything as data block filled with zeros when created, but do need
+	// this routine otherwise a custom geometry gets its cache data corrupted on creation. 
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_attribute_size : Get the size of TriMesh attributes.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geometry_cache_attribute_size(TQ3Uns32 numAttributeTypes,
+								const TQ3TriMeshAttributeData *attributeTypes,
+								TQ3Uns32 numElements)
+	{
+	TQ3Uns32 theSize = 0 ;
+
+
+
+	// Add up the attribute arrays
+	for ( TQ3Uns32 n = 0 ; n < numAttributeTypes ; ++n )
+		{
+		TQ3ObjectType attrType = E3Attribute_AttributeToClassType ( attributeTypes[ n ].attributeType ) ;
+		E3ClassInfoPtr theClass = E3ClassTree::GetClass ( attrType ) ;
+		
+		theSize += numElements * ( theClass != NULL ? theClass->GetInstanceSize () : (TQ3Uns32) sizeof(TQ3Object) ) ;
+		
+		if ( attributeTypes[ n ].attributeUseArray != NULL )
+			theSize += numElements ;
+		}
+	
+	return theSize ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_object_size : Estimate the size of a cached object.
+//-----------------------------------------------------------------------------
+//		Note :	Decomposed geometries are normally TriMeshes, or groups of
+//				TriMeshes, so we only look inside those: other objects are
+//				assumed to be the size of their instance data.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geometry_cache_object_size(TQ3Object theObject)
+	{
+	TQ3TriMeshData		*triMeshData ;
+	TQ3GroupPosition	thePosition ;
+	TQ3Object			theChild ;
+
+
+
+	// Start with the instance data
+	if ( theObject == NULL )
+		return 0 ;
+	
+	TQ3Uns32 theSize = theObject->GetClass ()->GetInstanceSize () ;
+
+
+
+	// Add the TriMesh arrays
+	if ( Q3Object_IsType ( theObject, kQ3GeometryTypeTriMesh ) )
+		{
+		if ( E3TriMesh_LockData ( theObject, kQ3True, &triMeshData ) == kQ3Success )
+			{
+			theSize += triMeshData->numPoints    * (TQ3Uns32) sizeof(TQ3Point3D)
+					 + triMeshData->numTriangles * (TQ3Uns32) sizeof(TQ3TriMeshTriangleData)
+					 + triMeshData->numEdges     * (TQ3Uns32) sizeof(TQ3TriMeshEdgeData) ;
+			
+			theSize += e3geometry_cache_attribute_size ( triMeshData->numTriangleAttributeTypes,
+						triMeshData->triangleAttributeTypes, triMeshData->numTriangles ) ;
+			theSize += e3geometry_cache_attribute_size ( triMeshData->numEdgeAttributeTypes,
+						triMeshData->edgeAttributeTypes, triMeshData->numEdges ) ;
+			theSize += e3geometry_cache_attribute_size ( triMeshData->numVertexAttributeTypes,
+						triMeshData->vertexAttributeTypes, triMeshData->numPoints ) ;
+			
+			E3TriMesh_UnlockData ( theObject ) ;
+			}
+		}
+
+
+
+	// Or the contents of a group
+	else if ( Q3Object_IsType ( theObject, kQ3ShapeTypeGroup ) )
+		{
+		Q3Group_GetFirstPosition ( theObject, &thePosition ) ;
+		while ( thePosition != NULL )
+			{
+			if ( Q3Group_GetPositionObject ( theObject, thePosition, &theChild ) == kQ3Success )
+				{
+				theSize += e3geometry_cache_object_size ( theChild ) ;
+				Q3Object_Dispose ( theChild ) ;
+				}
+			
+			Q3Group_GetNextPosition ( theObject, &thePosition ) ;
+			}
+		}
+	
+	return theSize ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_view_key : Get the view state a geometry depends on.
+//-----------------------------------------------------------------------------
+//		Note :	Only the fields the geometry depends on are updated.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_cache_view_key(TQ3ViewObject theView,
+						  TQ3Boolean usesSubdivision, TQ3Boolean usesOrientation,
+						  E3GeometryCacheKey *viewKey)
+	{
+	TQ3Matrix4x4			localToWorld ;
+
+
+
+	// Get the subdivision style, and what it depends on
+	if ( usesSubdivision )
+		{
+		Q3Memory_Copy(E3View_State_GetStyleSubdivision(theView),
+						&viewKey->styleSubdivision,
+						sizeof(TQ3SubdivisionStyleData));
+		
+		if ( viewKey->styleSubdivision.method == kQ3SubdivisionMethodScreenSpace )
+			viewKey->cameraEditIndex = Q3Shared_GetEditIndex(E3View_AccessCamera(theView));
+		
+		if ( viewKey->styleSubdivision.method != kQ3SubdivisionMethodConstant )
+			{
+			Q3View_GetLocalToWorldMatrixState( theView, &localToWorld );
+			viewKey->cachedDeterminant = Q3Matrix4x4_Determinant( &localToWorld );
+			}
+		}
+
+
+
+	// Get the orientation style
+	if ( usesOrientation )
+		viewKey->styleOrientation = E3View_State_GetStyleOrientation ( theView ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_key_matches : Is a cached object valid for a view?
+//-----------------------------------------------------------------------------
+//		Note :	Compares the view state a cached object was built for with the
+//				current view state, using only the inputs the geometry uses.
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+e3geometry_cache_key_matches(const E3GeometryCacheKey *cacheKey,
+							 const E3GeometryCacheKey *viewKey,
+							 TQ3Boolean usesSubdivision, TQ3Boolean usesOrientation)
+	{
+	// Check the subdivision style, and what it depends on
+	if ( usesSubdivision )
+		{
+		if ( memcmp ( &cacheKey->styleSubdivision, &viewKey->styleSubdivision,
+					sizeof(TQ3SubdivisionStyleData) ) != 0 )
+			return kQ3False ;
+		
+		if ( cacheKey->styleSubdivision.method == kQ3SubdivisionMethodScreenSpace
+		&&   viewKey->cameraEditIndex > cacheKey->cameraEditIndex )
+			return kQ3False ;
+		
+		if ( cacheKey->styleSubdivision.method != kQ3SubdivisionMethodConstant )
+			{
+			float detRatio = cacheKey->cachedDeterminant / viewKey->cachedDeterminant ;
+			if ( E3Float_Abs ( 1.0f - detRatio ) > kWorldSpaceTolerance )
+				return kQ3False ;
+			}
+		}
+
+
+
+	// Check the orientation style
+	if ( usesOrientation && cacheKey->styleOrientation != viewKey->styleOrientation )
+		return kQ3False ;
+	
+	return kQ3True ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_link : Add an alternate to the cache.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sGeometryCacheLock held. The entry becomes
+//				the most recently used, both globally and for its geometry.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_cache_link(E3GeometryCacheEntry *theEntry, E3GeometryCacheEntry **geomList)
+	{
+	// Link the entry to its geometry
+	theEntry->geomNext = *geomList ;
+	*geomList          = theEntry ;
+
+
+
+	// And to the head of the LRU list
+	theEntry->lruPrev = NULL ;
+	theEntry->lruNext = sGeometryCache.lruHead ;
+	
+	if ( sGeometryCache.lruHead != NULL )
+		sGeometryCache.lruHead->lruPrev = theEntry ;
+	else
+		sGeometryCache.lruTail = theEntry ;
+	
+	sGeometryCache.lruHead = theEntry ;
+	
+	sGeometryCache.numEntries += 1 ;
+	sGeometryCache.bytesUsed  += theEntry->byteSize ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_unlink : Remove an alternate from the cache.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sGeometryCacheLock held.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_cache_unlink(E3GeometryCacheEntry *theEntry, E3GeometryCacheEntry **geomList)
+	{
+	// Unlink the entry from its geometry
+	E3GeometryCacheEntry **thePtr = geomList ;
+	while ( *thePtr != theEntry )
+		thePtr = &(*thePtr)->geomNext ;
+	
+	*thePtr = theEntry->geomNext ;
+
+
+
+	// And from the LRU list
+	if ( theEntry->lruPrev != NULL )
+		theEntry->lruPrev->lruNext = theEntry->lruNext ;
+	else
+		sGeometryCache.lruHead = theEntry->lruNext ;
+	
+	if ( theEntry->lruNext != NULL )
+		theEntry->lruNext->lruPrev = theEntry->lruPrev ;
+	else
+		sGeometryCache.lruTail = theEntry->lruPrev ;
+	
+	sGeometryCache.numEntries -= 1 ;
+	sGeometryCache.bytesUsed  -= theEntry->byteSize ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_dispose_entries : Dispose of a list of alternates.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called without sGeometryCacheLock held, since disposing
+//				of a cached object may re-enter the cache.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_cache_dispose_entries(E3GeometryCacheEntry *theList)
+	{
+	while ( theList != NULL )
+		{
+		E3GeometryCacheEntry *theEntry = theList ;
+		theList = theEntry->geomNext ;
+		
+		Q3Object_CleanDispose ( &theEntry->cachedObject ) ;
+		Q3Memory_Free ( &theEntry ) ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_trim : Evict alternates until the budget is met.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sGeometryCacheLock held. Evicted entries
+//				are added to disposeList, for disposal once the lock has been
+//				released.
+//-----------------------------------------------------------------------------
+void
+e3geometry_cache_trim(E3GeometryCacheEntry **disposeList)
+	{
+	while ( sGeometryCache.bytesUsed > sGeometryCache.bytesBudget && sGeometryCache.lruTail != NULL )
+		{
+		E3GeometryCacheEntry *theEntry = sGeometryCache.lruTail ;
+		
+		e3geometry_cache_unlink ( theEntry, &theEntry->theGeom->instanceData.cacheAlternates ) ;
+		theEntry->geomNext = *disposeList ;
+		*disposeList       = theEntry ;
+		
+		E3Atomic_Increment ( &sGeometryCache.numEvictions ) ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_exchange : Select an alternate cached object.
+//-----------------------------------------------------------------------------
+//		Note :	If the geometry has an alternate built for viewKey, it becomes
+//				the current cached object and we return kQ3True.
+//
+//				Otherwise the current cached object is kept as an alternate,
+//				if the budget allows, and the geometry is left without a
+//				cached object.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+e3geometry_cache_exchange(E3Geometry *theGeom, const E3GeometryCacheKey *viewKey,
+						  TQ3Boolean usesSubdivision, TQ3Boolean usesOrientation)
+	{
+	E3GeometryData			*instanceData = &theGeom->instanceData ;
+	E3GeometryCacheEntry	*disposeList  = NULL ;
+	E3GeometryCacheEntry	*theEntry ;
+	TQ3Boolean				foundEntry    = kQ3False ;
+
+
+
+	// Size the current object, and prepare an entry for it, outside the lock
+	TQ3Uns32 currentSize = e3geometry_cache_object_size ( instanceData->cachedObject ) ;
+	E3GeometryCacheEntry *newEntry = NULL ;
+	
+	if ( instanceData->cachedObject != NULL && currentSize <= sGeometryCache.bytesBudget )
+		newEntry = (E3GeometryCacheEntry *) Q3Memory_Allocate ( sizeof(E3GeometryCacheEntry) ) ;
+
+
+
+	// Update the cache
+	{
+	E3SpinLocker theLocker ( sGeometryCacheLock ) ;
+
+
+
+	// Look for an alternate which is valid for the view
+	for ( theEntry = instanceData->cacheAlternates ; theEntry != NULL ; theEntry = theEntry->geomNext )
+		{
+		if ( e3geometry_cache_key_matches ( &theEntry->cacheKey, viewKey, usesSubdivision, usesOrientation ) )
+			break ;
+		}
+
+
+
+	// If we found one, swap it with the current object
+	if ( theEntry != NULL )
+		{
+		e3geometry_cache_unlink ( theEntry, &instanceData->cacheAlternates ) ;
+		
+		E3GeometryCacheKey	theKey    = instanceData->cacheKey ;
+		TQ3Object			theObject = instanceData->cachedObject ;
+		
+		instanceData->cacheKey     = theEntry->cacheKey ;
+		instanceData->cachedObject = theEntry->cachedObject ;
+		
+		theEntry->cacheKey     = theKey ;
+		theEntry->cachedObject = theObject ;
+		theEntry->byteSize     = currentSize ;
+		
+		if ( theObject != NULL )
+			e3geometry_cache_link ( theEntry, &instanceData->cacheAlternates ) ;
+		else
+			{
+			theEntry->geomNext = disposeList ;
+			disposeList        = theEntry ;
+			}
+		
+		foundEntry = kQ3True ;
+		}
+
+
+
+	// Otherwise keep the current object as an alternate
+	else if ( newEntry != NULL )
+		{
+		// Make room for it, discarding our least recently used alternate
+		TQ3Uns32 numAlternates = 0 ;
+		E3GeometryCacheEntry *lastEntry = NULL ;
+		
+		for ( theEntry = instanceData->cacheAlternates ; theEntry != NULL ; theEntry = theEntry->geomNext )
+			{
+			numAlternates += 1 ;
+			lastEntry      = theEntry ;
+			}
+		
+		if ( numAlternates >= kGeometryCacheMaxAlternates )
+			{
+			e3geometry_cache_unlink ( lastEntry, &instanceData->cacheAlternates ) ;
+			lastEntry->geomNext = disposeList ;
+			disposeList         = lastEntry ;
+			
+			E3Atomic_Increment ( &sGeometryCache.numEvictions ) ;
+			}
+
+
+
+		// And add it to the cache
+		newEntry->theGeom      = theGeom ;
+		newEntry->byteSize     = currentSize ;
+		newEntry->cacheKey     = instanceData->cacheKey ;
+		newEntry->cachedObject = instanceData->cachedObject ;
+		
+		e3geometry_cache_link ( newEntry, &instanceData->cacheAlternates ) ;
+		
+		instanceData->cachedObject = NULL ;
+		newEntry                   = NULL ;
+		}
+
+
+
+	// Stay within the budget
+	e3geometry_cache_trim ( &disposeList ) ;
+	}
+
+
+
+	// Clean up
+	Q3Memory_Free ( &newEntry ) ;
+	e3geometry_cache_dispose_entries ( disposeList ) ;
+	
+	return foundEntry ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_cache_purge : Dispose of the alternates of a geometry.
+//-----------------------------------------------------------------------------
+void
+e3geometry_cache_purge(E3Geometry *theGeom)
+	{
+	E3GeometryCacheEntry	*disposeList = NULL ;
+
+
+
+	// Alternates are only added with the geometry's cache locked, so a NULL
+	// list is stable
+	if ( theGeom->instanceData.cacheAlternates == NULL )
+		return ;
+
+
+
+	// Remove the alternates from the cache
+	{
+	E3SpinLocker theLocker ( sGeometryCacheLock ) ;
+	
+	while ( theGeom->instanceData.cacheAlternates != NULL )
+		{
+		E3GeometryCacheEntry *theEntry = theGeom->instanceData.cacheAlternates ;
+		
+		e3geometry_cache_unlink ( theEntry, &theGeom->instanceData.cacheAlternates ) ;
+		theEntry->geomNext = disposeList ;
+		disposeList        = theEntry ;
+		}
+	}
+
+
+
+	// And dispose of them
+	e3geometry_cache_dispose_entries ( disposeList ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_immediate_hash : Add some bytes to an immediate cache hash.
+//-----------------------------------------------------------------------------
+//		Note :	Uses the 32-bit FNV-1a hash.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geometry_immediate_hash(TQ3Uns32 hashValue, const void *theData, TQ3Uns32 dataSize)
+	{
+	const TQ3Uns8	*theBytes = (const TQ3Uns8 *) theData ;
+
+
+
+	// Hash the data
+	for ( TQ3Uns32 n = 0 ; n < dataSize ; ++n )
+		{
+		hashValue ^= theBytes[ n ] ;
+		hashValue *= 16777619U ;
+		}
+	
+	return hashValue ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_immediate_unlink : Remove an entry from the immediate cache.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sImmediateCacheLock held.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_immediate_unlink(E3ImmediateCacheEntry *theEntry)
+	{
+	// Unlink the entry from its bucket
+	E3ImmediateCacheEntry **thePtr = &sImmediateCache.theBuckets[ theEntry->hashValue % kImmediateCacheNumBuckets ] ;
+	while ( *thePtr != theEntry )
+		thePtr = &(*thePtr)->bucketNext ;
+	
+	*thePtr = theEntry->bucketNext ;
+
+
+
+	// And from the LRU list
+	if ( theEntry->lruPrev != NULL )
+		theEntry->lruPrev->lruNext = theEntry->lruNext ;
+	else
+		sImmediateCache.lruHead = theEntry->lruNext ;
+	
+	if ( theEntry->lruNext != NULL )
+		theEntry->lruNext->lruPrev = theEntry->lruPrev ;
+	else
+		sImmediateCache.lruTail = theEntry->lruPrev ;
+	
+	sImmediateCache.numEntries -= 1 ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_immediate_make_mru : Move an entry to the head of the LRU.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sImmediateCacheLock held. The entry must
+//				not be in the LRU list.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_immediate_make_mru(E3ImmediateCacheEntry *theEntry)
+	{
+	theEntry->lruPrev   = NULL ;
+	theEntry->lruNext   = sImmediateCache.lruHead ;
+	theEntry->lastFrame = sImmediateCache.currentFrame ;
+	
+	if ( sImmediateCache.lruHead != NULL )
+		sImmediateCache.lruHead->lruPrev = theEntry ;
+	else
+		sImmediateCache.lruTail = theEntry ;
+	
+	sImmediateCache.lruHead = theEntry ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_immediate_trim : Evict entries from the immediate cache.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sImmediateCacheLock held. Entries beyond
+//				the size limit, or which have not been used for too many
+//				frames, are added to disposeList for disposal once the lock
+//				has been released.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_immediate_trim(E3ImmediateCacheEntry **disposeList)
+	{
+	while ( sImmediateCache.lruTail != NULL )
+		{
+		E3ImmediateCacheEntry *theEntry = sImmediateCache.lruTail ;
+		
+		if ( sImmediateCache.numEntries <= sImmediateCache.maxEntries
+		&&   ( sImmediateCache.maxIdleFrames == 0
+			|| sImmediateCache.currentFrame - theEntry->lastFrame <= sImmediateCache.maxIdleFrames ) )
+			break ;
+		
+		e3geometry_immediate_unlink ( theEntry ) ;
+		theEntry->bucketNext = *disposeList ;
+		*disposeList         = theEntry ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_immediate_dispose_entries : Dispose of immediate entries.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called without sImmediateCacheLock held.
+//-----------------------------------------------------------------------------
+static void
+e3geometry_immediate_dispose_entries(E3ImmediateCacheEntry *theList)
+	{
+	while ( theList != NULL )
+		{
+		E3ImmediateCacheEntry *theEntry = theList ;
+		theList = theEntry->bucketNext ;
+		
+		for ( TQ3Uns32 n = 0 ; n < theEntry->numAttributeSets ; ++n )
+			Q3Object_CleanDispose ( &theEntry->attributeSets[ n ] ) ;
+		
+		Q3Object_CleanDispose ( &theEntry->cachedObject ) ;
+		Q3Memory_Free ( &theEntry ) ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      e3geometry_immediate_cache_get : Get the decomposed form of an
+//										 immediate mode geometry.
+//-----------------------------------------------------------------------------
+//		Note :	Returns a new reference to the decomposed object, or NULL.
+//
+//				Geometries which provide a kQ3XMethodTypeGeomGetCacheKey
+//				method are looked up in a system-wide cache, so that the same
+//				data submitted on every frame is only decomposed once. Other
+//				geometries are decomposed on every submit.
+//
+//				The key's leading data bytes are hashed and compared as they
+//				are, so must not include any padding.
+//-----------------------------------------------------------------------------
+static TQ3Object
+e3geometry_immediate_cache_get(TQ3ViewObject theView, TQ3ObjectType objectType,
+							   E3GeometryInfo *theClass, const void *objectData)
+	{
+	TQ3AttributeSet			attributeSets[kGeometryCacheMaxKeyAttributes] ;
+	TQ3Uns32				attributeEditIndices[kGeometryCacheMaxKeyAttributes] ;
+	E3ImmediateCacheEntry	*disposeList = NULL ;
+	E3ImmediateCacheEntry	*theEntry ;
+	TQ3Uns32				dataSize, n ;
+
+
+
+	// If we can't cache the geometry, just decompose it
+	if ( theClass->getCacheKey == NULL || sImmediateCache.maxEntries == 0 )
+		return theClass->cacheNew ( theView, NULL, objectData ) ;
+
+
+
+	// Identify the geometry
+	TQ3Uns32 numAttributeSets = theClass->getCacheKey ( objectData, &dataSize, attributeSets ) ;
+	Q3_ASSERT( numAttributeSets <= kGeometryCacheMaxKeyAttributes ) ;
+	
+	E3GeometryCacheKey viewKey ;
+	Q3Memory_Clear ( &viewKey, sizeof(viewKey) ) ;
+	e3geometry_cache_view_key ( theView, theClass->usesSubdivision, theClass->usesOrientation, &viewKey ) ;
+	
+	TQ3Uns32 hashValue = 2166136261U ;
+	hashValue = e3geometry_immediate_hash ( hashValue, &objectType, sizeof(objectType) ) ;
+	hashValue = e3geometry_immediate_hash ( hashValue, objectData, dataSize ) ;
+	
+	for ( n = 0 ; n < numAttributeSets ; ++n )
+		{
+		attributeEditIndices[ n ] = ( attributeSets[ n ] != NULL ) ? Q3Shared_GetEditIndex ( attributeSets[ n ] ) : 0 ;
+		hashValue = e3geometry_immediate_hash ( hashValue, &attributeSets[ n ],        sizeof(TQ3AttributeSet) ) ;
+		hashValue = e3geometry_immediate_hash ( hashValue, &attributeEditIndices[ n ], sizeof(TQ3Uns32) ) ;
+		}
+	
+	hashValue = e3geometry_immediate_hash ( hashValue, &viewKey.styleSubdivision, sizeof(viewKey.styleSubdivision) ) ;
+	hashValue = e3geometry_immediate_hash ( hashValue, &viewKey.styleOrientation, sizeof(viewKey.styleOrientation) ) ;
+
+
+
+	// Look for a cached object
+	{
+	E3SpinLocker theLocker ( sImmediateCacheLock ) ;
+	
+	for ( theEntry = sImmediateCache.theBuckets[ hashValue % kImmediateCacheNumBuckets ] ;
+		  theEntry != NULL ; theEntry = theEntry->bucketNext )
+		{
+		if ( theEntry->hashValue        == hashValue
+		&&   theEntry->objectType       == objectType
+		&&   theEntry->dataSize         == dataSize
+		&&   theEntry->numAttributeSets == numAttributeSets
+		&&   memcmp ( theEntry->theData,              objectData,           dataSize )                             == 0
+		&&   memcmp ( theEntry->attributeSets,        attributeSets,        numAttributeSets * sizeof(TQ3AttributeSet) ) == 0
+		&&   memcmp ( theEntry->attributeEditIndices, attributeEditIndices, numAttributeSets * sizeof(TQ3Uns32) )  == 0
+		&&   e3geometry_cache_key_matches ( &theEntry->cacheKey, &viewKey,
+					theClass->usesSubdivision, theClass->usesOrientation ) )
+			break ;
+		}
+	
+	if ( theEntry != NULL )
+		{
+		// Make it the most recently used
+		if ( theEntry->lruPrev != NULL )
+			{
+			theEntry->lruPrev->lruNext = theEntry->lruNext ;
+			
+			if ( theEntry->lruNext != NULL )
+				theEntry->lruNext->lruPrev = theEntry->lruPrev ;
+			else
+				sImmediateCache.lruTail = theEntry->lruPrev ;
+			
+			e3geometry_immediate_make_mru ( theEntry ) ;
+			}
+		else
+			theEntry->lastFrame = sImmediateCache.currentFrame ;
+		
+		E3Atomic_Increment ( &sImmediateCache.numHits ) ;
+		return Q3Shared_GetReference ( theEntry->cachedObject ) ;
+		}
+	
+	E3Atomic_Increment ( &sImmediateCache.numMisses ) ;
+	}
+
+
+
+	// Decompose the geometry
+	TQ3Object theObject = theClass->cacheNew ( theView, NULL, objectData ) ;
+	if ( theObject == NULL )
+		return NULL ;
 	
-	return attributeSet ;
-	}
+	theEntry = (E3ImmediateCacheEntry *) Q3Memory_Allocate ( static_cast<TQ3Uns32>(sizeof(E3ImmediateCacheEntry) + dataSize) ) ;
+	if ( theEntry == NULL )
+		return theObject ;
 
 
 
+	// Fill in the entry
+	theEntry->hashValue        = hashValue ;
+	theEntry->objectType       = objectType ;
+	theEntry->cacheKey         = viewKey ;
+	theEntry->numAttributeSets = numAttributeSets ;
+	theEntry->cachedObject     = Q3Shared_GetReference ( theObject ) ;
+	theEntry->dataSize         = dataSize ;
+	theEntry->theData          = (TQ3Uns8 *) ( theEntry + 1 ) ;
+	
+	Q3Memory_Copy ( objectData, theEntry->theData, dataSize ) ;
+	
+	for ( n = 0 ; n < numAttributeSets ; ++n )
+		{
+		theEntry->attributeSets[ n ]        = ( attributeSets[ n ] != NULL ) ? Q3Shared_GetReference ( attributeSets[ n ] ) : NULL ;
+		theEntry->attributeEditIndices[ n ] = attributeEditIndices[ n ] ;
+		}
 
 
-//=============================================================================
-//      e3geometry_new : Geometry new method.
-//-----------------------------------------------------------------------------
-static TQ3Status
-e3geometry_new ( TQ3Object, void*, const void* )
+
+	// And add it to the cache
 	{
-	// No need to do anything as data block filled with zeros when created, but do need
-	// this routine otherwise a custom geometry gets its cache data corrupted on creation. 
-	return kQ3Success ;
+	E3SpinLocker theLocker ( sImmediateCacheLock ) ;
+	
+	E3ImmediateCacheEntry **theBucket = &sImmediateCache.theBuckets[ hashValue % kImmediateCacheNumBuckets ] ;
+	theEntry->bucketNext = *theBucket ;
+	*theBucket           = theEntry ;
+	
+	e3geometry_immediate_make_mru ( theEntry ) ;
+	sImmediateCache.numEntries += 1 ;
+	
+	e3geometry_immediate_trim ( &disposeList ) ;
+	}
+	
+	e3geometry_immediate_dispose_entries ( disposeList ) ;
+	
+	return theObject ;
 	}
 
 
@@ -186,6 +1066,7 @@ e3geometry_delete(TQ3Object theObject, void *privateData)
 
 
 	// Clean up
+	e3geometry_cache_purge ( instanceData ) ;
 	Q3Object_CleanDispose ( &instanceData->instanceData.cachedObject ) ;
 	}
 
@@ -206,12 +1087,13 @@ e3geometry_duplicate(TQ3Object fromObject, const void *fromPrivateData,
 
 
 	// Duplicate the geometry
-	toInstanceData->instanceData.cameraEditIndex   = 0;
-	toInstanceData->instanceData.styleSubdivision  = fromInstanceData->instanceData.styleSubdivision;
-	toInstanceData->instanceData.styleOrientation  = fromInstanceData->instanceData.styleOrientation;
-	toInstanceData->instanceData.cachedEditIndex   = 0;
-	toInstanceData->instanceData.cachedObject      = NULL;
-	toInstanceData->instanceData.cachedDeterminant = 0.0f;
+	toInstanceData->instanceData.cacheLock                  = 0;
+	toInstanceData->instanceData.cacheKey                   = fromInstanceData->instanceData.cacheKey;
+	toInstanceData->instanceData.cacheKey.cameraEditIndex   = 0;
+	toInstanceData->instanceData.cacheKey.cachedDeterminant = 0.0f;
+	toInstanceData->instanceData.cachedEditIndex            = 0;
+	toInstanceData->instanceData.cachedObject               = NULL;
+	toInstanceData->instanceData.cacheAlternates            = NULL;
 	
 	return kQ3Success ;
 	}
@@ -233,6 +1115,16 @@ e3geometry_duplicate(TQ3Object fromObject, const void *fromPrivateData,
 //				If the cached form itself has to be decomposed, we will simply
 //				repeat the process until one of the required geometry types is
 //				reached.
+//
+//				Geometries which can submit their decomposed form directly from
+//				their own data, without building any intermediate objects, can
+//				provide a kQ3XMethodTypeGeomSubmitDecomposed method to bypass
+//				the cache entirely.
+//
+//				A retained geometry may be submitted on several threads at
+//				once, so its cache is validated and rebuilt with the geometry's
+//				cache locked. We submit our own reference to the cached object,
+//				since another thread may replace it once the lock is released.
 //-----------------------------------------------------------------------------
 
 
@@ -251,40 +1143,54 @@ e3geometry_submit_decomposed(TQ3ViewObject theView, TQ3ObjectType objectType, TQ
 
 
 
+	// If the geometry can decompose itself on the fly, let it do so
+	if ( theClass->submitDecomposed != NULL )
+		return theClass->submitDecomposed ( theView, theObject, objectData ) ;
+
+
+
 	// If this is a retained mode submit, submit the cached version.
 	if ( theObject != NULL )
 		{
 		// Find our instance data
 		E3Geometry* instanceData = (E3Geometry*) theObject ;
+		TQ3Object   cachedObject = NULL ;
 
 
 
 		// Rebuild the cached object if it's out of date
+		{
+		E3SpinLocker theLocker ( instanceData->instanceData.cacheLock ) ;
+		
 		if ( ! theClass->cacheIsValid ( theView, objectType, theObject,
 			objectData, instanceData->instanceData.cachedObject ) )
+			{
+			E3Atomic_Increment ( &sGeometryCache.numMisses ) ;
 			
 			theClass->cacheUpdate(theView, objectType, theObject, objectData,
 				&instanceData->instanceData.cachedObject);
+			}
+		else
+			E3Atomic_Increment ( &sGeometryCache.numHits ) ;
+		
+		if ( instanceData->instanceData.cachedObject != NULL )
+			cachedObject = Q3Shared_GetReference ( instanceData->instanceData.cachedObject ) ;
+		}
 
 
 
 		// Submit the cached object (or we fail)
-		if (instanceData->instanceData.cachedObject != NULL)
-			qd3dStatus = E3View_SubmitRetained(theView, instanceData->instanceData.cachedObject);
+		if ( cachedObject != NULL )
+			{
+			qd3dStatus = E3View_SubmitRetained ( theView, cachedObject ) ;
+			Q3Object_Dispose ( cachedObject ) ;
+			}
 		}
 
 
 
-	// Otherwise, create a temporary object and submit that instead.
-	//
-	// This is somewhat inefficient, so we may need to revisit this:
-	// a possible solution could be a system-wide object cache that
-	// could be used to cache immediate mode objects (with some control
-	// over how often the cache should be flushed).
-	//
-	// If you're thinking of fixing this, please let me know.
-	//
-	// -dair
+	// Otherwise, find the decomposed object in the immediate mode cache
+	// (or create a temporary one) and submit that instead.
 	else
 		{
 		// Check we have a method
@@ -292,8 +1198,8 @@ e3geometry_submit_decomposed(TQ3ViewObject theView, TQ3ObjectType objectType, TQ
 			return kQ3Failure ;
 		
 		
-		// Create a temporary object, submit it, and clean up
-		TQ3Object tmpObject = theClass->cacheNew ( theView, theObject, objectData ) ;
+		// Get the decomposed object, submit it, and clean up
+		TQ3Object tmpObject = e3geometry_immediate_cache_get ( theView, objectType, theClass, objectData ) ;
 		if ( tmpObject == NULL )
 			return kQ3Failure ;
 		
@@ -479,15 +1385,20 @@ e3geometry_write(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theO
 //				changed since we last examined it.
 //
 //				If the geometry does use subdivision, we also need to inspect
-//				the camera's edit index and the current subdivision style.
+//				the camera's edit index, the current subdivision style, and
+//				the scale of the local to world transform.
+//
+//				A geometry keeps a few alternate cached objects for previous
+//				view states, so that an object which is instanced at several
+//				scales or with several styles is not rebuilt on every submit.
+//				If the current cached object is invalid but an alternate is
+//				valid, the alternate becomes current and we return kQ3True.
 //-----------------------------------------------------------------------------
 TQ3Boolean
 e3geometry_cache_isvalid(TQ3ViewObject theView,
 						TQ3ObjectType objectType, TQ3GeometryObject theGeom,
 						const void   *geomData,   TQ3Object         cachedGeom)
 	{
-	TQ3Matrix4x4			localToWorld ;
-	TQ3Boolean		isValid = kQ3True;
 
 
 
@@ -503,88 +1414,50 @@ e3geometry_cache_isvalid(TQ3ViewObject theView,
 
 
 	// Find the geometry class
-	E3ClassInfoPtr theClass = E3ClassTree::GetClass ( objectType ) ;
+	E3GeometryInfo* theClass = (E3GeometryInfo*) E3ClassTree::GetClass ( objectType ) ;
 	Q3_ASSERT_VALID_PTR(theClass);
 	
 	
 	
-	// Does the geometry use subdivision?
-	TQ3Boolean usesSubdivision = ( theClass->GetMethod ( kQ3XMethodTypeGeomUsesSubdivision ) != NULL)?
-		kQ3True : kQ3False;
+	// Does the geometry use subdivision or orientation?
+	TQ3Boolean usesSubdivision = theClass->usesSubdivision ;
+	TQ3Boolean usesOrientation = theClass->usesOrientation ;
 
 
 
-	// First check the geometry edit index
-	TQ3Uns32 editIndex = Q3Shared_GetEditIndex ( theGeom ) ;
-	if (instanceData->instanceData.cachedObject == NULL || editIndex > instanceData->instanceData.cachedEditIndex)
-		{
-		instanceData->instanceData.cachedEditIndex = editIndex;
-		
-		isValid = kQ3False;
-		}
+	// Collect the view state the geometry depends on
+	E3GeometryCacheKey viewKey = instanceData->instanceData.cacheKey ;
+	e3geometry_cache_view_key ( theView, usesSubdivision, usesOrientation, &viewKey ) ;
 
 
 
-	// Check for changes to the subdivision style
-	if (usesSubdivision)
+	// First check the geometry edit index: an edit invalidates every cached object
+	TQ3Uns32 editIndex = Q3Shared_GetEditIndex ( theGeom ) ;
+	if (editIndex > instanceData->instanceData.cachedEditIndex)
 		{
-		// Check to see if the current subdivision style is different
-		if (memcmp(&instanceData->instanceData.styleSubdivision,
-					E3View_State_GetStyleSubdivision(theView),
-					sizeof(TQ3SubdivisionStyleData)) != 0)
-			{
-			Q3Memory_Copy(E3View_State_GetStyleSubdivision(theView),
-							&instanceData->instanceData.styleSubdivision,
-							sizeof(TQ3SubdivisionStyleData));
+		e3geometry_cache_purge ( instanceData ) ;
 		
-			isValid = kQ3False;
-			}
-
-
-
-		// If the subdivision style is screen space, check to see if the camera has changed
-		if ( instanceData->instanceData.styleSubdivision.method == kQ3SubdivisionMethodScreenSpace )
-			{
-			editIndex = Q3Shared_GetEditIndex(E3View_AccessCamera(theView));
-			if (editIndex > instanceData->instanceData.cameraEditIndex)
-				{
-				instanceData->instanceData.cameraEditIndex = editIndex;
-				isValid = kQ3False;
-				}
-			}
-
-			
-		// If the subdivision style is not constant, check to see if the local to world
-		// transformation has changed its scale factor.
-		if (instanceData->instanceData.styleSubdivision.method != kQ3SubdivisionMethodConstant)
-			{
-			Q3View_GetLocalToWorldMatrixState( theView, &localToWorld );
-			float theDet = Q3Matrix4x4_Determinant( &localToWorld );
-			float detRatio = instanceData->instanceData.cachedDeterminant / theDet;
-			if (E3Float_Abs( 1.0f - detRatio ) > kWorldSpaceTolerance)
-				{
-				instanceData->instanceData.cachedDeterminant = theDet;
-				isValid = kQ3False;
-				}
-			}
+		instanceData->instanceData.cachedEditIndex = editIndex;
+		instanceData->instanceData.cacheKey        = viewKey;
+		return kQ3False;
 		}
 
 
 
-	// Check for changes to the orientation style
-	if ( theClass->GetMethod ( kQ3XMethodTypeGeomUsesOrientation ) != NULL )
-		{
-		TQ3OrientationStyle theOrientation = E3View_State_GetStyleOrientation ( theView ) ;
-		if (instanceData->instanceData.styleOrientation != theOrientation)
-			{
-			instanceData->instanceData.styleOrientation = theOrientation;
-			isValid = kQ3False;
-			}
-		}
+	// Check the current cached object
+	if ( instanceData->instanceData.cachedObject != NULL
+	&&   e3geometry_cache_key_matches ( &instanceData->instanceData.cacheKey, &viewKey,
+			usesSubdivision, usesOrientation ) )
+		return kQ3True;
 
 
 
-	return isValid;
+	// Otherwise fall back to an alternate
+	if ( e3geometry_cache_exchange ( instanceData, &viewKey, usesSubdivision, usesOrientation ) )
+		return kQ3True;
+	
+	instanceData->instanceData.cacheKey = viewKey;
+	return kQ3False;
 }
 
 
@@ -629,6 +1502,8 @@ e3geometry_cache_update(TQ3ViewObject theView,
 	// If we can create a cached geometry, create it
 	if ( theClass->cacheNew != NULL )
 	{
+		E3Atomic_Increment( &sGeometryCache.numRebuilds );
+		
 		try
 		{
 			*cachedGeom = theClass->cacheNew( theView, theGeom, geomData );
@@ -805,6 +1680,11 @@ E3Geometry_UnregisterClass(void)
 
 
 
+	// Dispose of the immediate mode cache, while its classes exist
+	E3Geometry_FlushImmediateCache();
+
+
+
 	// Unregister the geometry classes
 	E3GeometryBox_UnregisterClass();
 	E3GeometryCone_UnregisterClass();
@@ -965,6 +1845,377 @@ E3Geometry_GetDecomposed( TQ3GeometryObject theGeom, TQ3ViewObject view )
 
 
 
+//=============================================================================
+//      E3Geometry_PickDecomposed : Pick a geometry through its cached form.
+//-----------------------------------------------------------------------------
+//		Note :	Geometries with their own pick method use this for the picks
+//				they can't handle themselves, exactly as if they had inherited
+//				the base class picking method.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_PickDecomposed(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{
+	// Pick the decomposed form
+	return(e3geometry_pick(theView, objectType, theObject, objectData));
+}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_PickAnalytic : Pick a geometry against its exact surface.
+//-----------------------------------------------------------------------------
+//		Note :	The geometry is described by a frame, which maps the canonical
+//				coordinates (x, y, z) to the local point
+//
+//					frameOrigin + x*xAxis + y*yAxis + z*zAxis
+//
+//				and by a method which intersects a canonical ray with the
+//				canonical form of the surface.
+//
+//				Rather than testing the triangles of the cached representation
+//				we map the pick ray into canonical coordinates, and record the
+//				exact hit points, normals, and UVs. Since the frame is affine,
+//				a ray parameter in canonical coordinates is also a ray
+//				parameter in world coordinates.
+//
+//				Picks other than rays, and frames which can't be inverted, are
+//				handled through the decomposed form. So are picks which ask
+//				for the TriMesh face or barycentric coordinates of a hit, since
+//				those describe a triangle of the decomposed form.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_PickAnalytic(TQ3ViewObject					theView,
+						TQ3ObjectType					objectType,
+						TQ3Object						theObject,
+						const void						*objectData,
+						const TQ3Point3D				*frameOrigin,
+						const TQ3Vector3D				*xAxis,
+						const TQ3Vector3D				*yAxis,
+						const TQ3Vector3D				*zAxis,
+						E3GeometryPickIntersectMethod	intersectMethod)
+{	E3GeometryPickHit			theHits[kGeometryPickMaxHits], tempHit;
+	TQ3Matrix4x4				frameToLocal, frameToWorld, worldToFrame;
+	TQ3BackfacingStyle			backfacingStyle;
+	TQ3Ray3D					worldRay, frameRay;
+	TQ3PickData					pickData;
+	TQ3Boolean					cullBackface;
+	TQ3Vector3D					hitNormal;
+	float						axisScale;
+	TQ3Point3D					hitXYZ;
+	TQ3PickObject				thePick;
+	TQ3Uns32					numHits, n, m;
+	TQ3Status					qd3dStatus;
+
+
+
+	// Find the pick ray
+	thePick = E3View_AccessPick(theView);
+	if (Q3Pick_GetData(thePick, &pickData) != kQ3Success ||
+		E3Bit_AnySet(pickData.mask, kQ3PickDetailMaskTriMeshFace | kQ3PickDetailMaskBarycentric))
+		return(e3geometry_pick(theView, objectType, theObject, objectData));
+
+	switch (Q3Pick_GetType(thePick)) {
+		case kQ3PickTypeWindowPoint:
+			E3View_GetRayThroughPickPoint(theView, &worldRay);
+			break;
+
+		case kQ3PickTypeWorldRay:
+			Q3WorldRayPick_GetRay(thePick, &worldRay);
+			break;
+
+		default:
+			return(e3geometry_pick(theView, objectType, theObject, objectData));
+		}
+
+
+
+	// Find the frame in world coordinates
+	Q3Matrix4x4_SetIdentity(&frameToLocal);
+	frameToLocal.value[0][0] = xAxis->x;
+	frameToLocal.value[0][1] = xAxis->y;
+	frameToLocal.value[0][2] = xAxis->z;
+	frameToLocal.value[1][0] = yAxis->x;
+	frameToLocal.value[1][1] = yAxis->y;
+	frameToLocal.value[1][2] = yAxis->z;
+	frameToLocal.value[2][0] = zAxis->x;
+	frameToLocal.value[2][1] = zAxis->y;
+	frameToLocal.value[2][2] = zAxis->z;
+	frameToLocal.value[3][0] = frameOrigin->x;
+	frameToLocal.value[3][1] = frameOrigin->y;
+	frameToLocal.value[3][2] = frameOrigin->z;
+
+	Q3Matrix4x4_Multiply(&frameToLocal, E3View_State_GetMatrixLocalToWorld(theView), &frameToWorld);
+
+
+
+	// Fall back to the decomposed form if we can't map the ray into the frame
+	//
+	// The determinant is compared with the lengths of the axes, since a small
+	// but well shaped frame has a small determinant.
+	if (frameToWorld.value[0][3] != 0.0f || frameToWorld.value[1][3] != 0.0f ||
+		frameToWorld.value[2][3] != 0.0f || frameToWorld.value[3][3] != 1.0f)
+		return(e3geometry_pick(theView, objectType, theObject, objectData));
+
+	axisScale = 1.0f;
+	for (n = 0; n < 3; n++)
+		axisScale *= sqrtf(frameToWorld.value[n][0] * frameToWorld.value[n][0] +
+						   frameToWorld.value[n][1] * frameToWorld.value[n][1] +
+						   frameToWorld.value[n][2] * frameToWorld.value[n][2]);
+
+	if (E3Float_Abs(Q3Matrix4x4_Determinant(&frameToWorld)) <= kQ3RealZero * axisScale)
+		return(e3geometry_pick(theView, objectType, theObject, objectData));
+
+	Q3Matrix4x4_Invert(&frameToWorld, &worldToFrame);
+	Q3Point3D_Transform( &worldRay.origin,    &worldToFrame, &frameRay.origin);
+	Q3Vector3D_Transform(&worldRay.direction, &worldToFrame, &frameRay.direction);
+
+
+
+	// Find the hits, and sort them nearest first
+	numHits = intersectMethod(&frameRay, objectData, theHits);
+	Q3_ASSERT(numHits <= kGeometryPickMaxHits);
+
+	for (n = 1; n < numHits; n++)
+		{
+		for (m = n; m > 0 && theHits[m].rayT < theHits[m - 1].rayT; m--)
+			{
+			tempHit        = theHits[m];
+			theHits[m]     = theHits[m - 1];
+			theHits[m - 1] = tempHit;
+			}
+		}
+
+
+
+	// Determine if we should cull back-facing hits or not
+	cullBackface = (TQ3Boolean)(E3View_GetBackfacingStyleState(theView, &backfacingStyle) == kQ3Success &&
+								backfacingStyle == kQ3BackfacingStyleRemove);
+
+
+
+	// Record the hits
+	//
+	// Normals are transformed back to world coordinates by the transpose of
+	// worldToFrame. If only the nearest hit is wanted, the pick drops anything
+	// behind the first hit we record.
+	qd3dStatus = kQ3Success;
+	for (n = 0; n < numHits && qd3dStatus == kQ3Success; n++)
+		{
+		if (theHits[n].rayT < 0.0f)
+			continue;
+
+		hitNormal.x = theHits[n].normal.x * worldToFrame.value[0][0] +
+					  theHits[n].normal.y * worldToFrame.value[0][1] +
+					  theHits[n].normal.z * worldToFrame.value[0][2];
+		hitNormal.y = theHits[n].normal.x * worldToFrame.value[1][0] +
+					  theHits[n].normal.y * worldToFrame.value[1][1] +
+					  theHits[n].normal.z * worldToFrame.value[1][2];
+		hitNormal.z = theHits[n].normal.x * worldToFrame.value[2][0] +
+					  theHits[n].normal.y * worldToFrame.value[2][1] +
+					  theHits[n].normal.z * worldToFrame.value[2][2];
+		Q3Vector3D_Normalize(&hitNormal, &hitNormal);
+
+		if (cullBackface && Q3Vector3D_Dot(&hitNormal, &worldRay.direction) > 0.0f)
+			continue;
+
+		hitXYZ.x = worldRay.origin.x + theHits[n].rayT * worldRay.direction.x;
+		hitXYZ.y = worldRay.origin.y + theHits[n].rayT * worldRay.direction.y;
+		hitXYZ.z = worldRay.origin.z + theHits[n].rayT * worldRay.direction.z;
+
+		qd3dStatus = E3Pick_RecordHit(thePick, theView, &hitXYZ, &hitNormal, &theHits[n].uv, NULL);
+		}
+
+	return(qd3dStatus);
+}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_GetCacheStatistics : Get the geometry cache statistics.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_GetCacheStatistics(TQ3GeometryCacheStatistics *statistics)
+	{
+	// Return the statistics for retained mode geometries
+	{
+	E3SpinLocker theLocker ( sGeometryCacheLock ) ;
+	
+	statistics->numHits      = sGeometryCache.numHits ;
+	statistics->numMisses    = sGeometryCache.numMisses ;
+	statistics->numRebuilds  = sGeometryCache.numRebuilds ;
+	statistics->numEvictions = sGeometryCache.numEvictions ;
+	statistics->numEntries   = sGeometryCache.numEntries ;
+	statistics->bytesUsed    = sGeometryCache.bytesUsed ;
+	statistics->bytesBudget  = sGeometryCache.bytesBudget ;
+	}
+
+
+
+	// And for immediate mode geometries
+	{
+	E3SpinLocker theLocker ( sImmediateCacheLock ) ;
+	
+	statistics->numImmediateHits    = sImmediateCache.numHits ;
+	statistics->numImmediateMisses  = sImmediateCache.numMisses ;
+	statistics->numImmediateEntries = sImmediateCache.numEntries ;
+	}
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_ResetCacheStatistics : Reset the geometry cache counters.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_ResetCacheStatistics(void)
+	{
+	E3SpinLocker theLocker ( sGeometryCacheLock ) ;
+
+
+
+	// Reset the counters
+	sGeometryCache.numHits      = 0 ;
+	sGeometryCache.numMisses    = 0 ;
+	sGeometryCache.numRebuilds  = 0 ;
+	sGeometryCache.numEvictions = 0 ;
+	
+	sImmediateCache.numHits     = 0 ;
+	sImmediateCache.numMisses   = 0 ;
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_SetCacheBudget : Set the geometry cache budget.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_SetCacheBudget(TQ3Uns32 numBytes)
+	{
+	E3GeometryCacheEntry	*disposeList = NULL ;
+
+
+
+	// Update the budget, evicting any alternates which no longer fit
+	{
+	E3SpinLocker theLocker ( sGeometryCacheLock ) ;
+	
+	sGeometryCache.bytesBudget = numBytes ;
+	e3geometry_cache_trim ( &disposeList ) ;
+	}
+	
+	e3geometry_cache_dispose_entries ( disposeList ) ;
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_SetImmediateCacheLimits : Set the immediate cache limits.
+//-----------------------------------------------------------------------------
+//		Note :	A maxIdleFrames of 0 disables aging, so entries are only
+//				evicted once there are more than maxEntries of them.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_SetImmediateCacheLimits(TQ3Uns32 maxEntries, TQ3Uns32 maxIdleFrames)
+	{
+	E3ImmediateCacheEntry	*disposeList = NULL ;
+
+
+
+	// Update the limits, evicting any entries which no longer fit
+	{
+	E3SpinLocker theLocker ( sImmediateCacheLock ) ;
+	
+	sImmediateCache.maxEntries    = maxEntries ;
+	sImmediateCache.maxIdleFrames = maxIdleFrames ;
+	e3geometry_immediate_trim ( &disposeList ) ;
+	}
+	
+	e3geometry_immediate_dispose_entries ( disposeList ) ;
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_FlushImmediateCache : Empty the immediate cache.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Geometry_FlushImmediateCache(void)
+	{
+	E3ImmediateCacheEntry	*disposeList = NULL ;
+
+
+
+	// Remove every entry
+	{
+	E3SpinLocker theLocker ( sImmediateCacheLock ) ;
+	
+	while ( sImmediateCache.lruTail != NULL )
+		{
+		E3ImmediateCacheEntry *theEntry = sImmediateCache.lruTail ;
+		
+		e3geometry_immediate_unlink ( theEntry ) ;
+		theEntry->bucketNext = disposeList ;
+		disposeList          = theEntry ;
+		}
+	}
+	
+	e3geometry_immediate_dispose_entries ( disposeList ) ;
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Geometry_ImmediateCacheEndFrame : Note the end of a frame.
+//-----------------------------------------------------------------------------
+//		Note :	Called when any view completes a rendering loop. Entries which
+//				have not been used for the idle frame limit are discarded.
+//-----------------------------------------------------------------------------
+void
+E3Geometry_ImmediateCacheEndFrame(void)
+	{
+	E3ImmediateCacheEntry	*disposeList = NULL ;
+
+
+
+	// Advance the frame, and evict any idle entries
+	{
+	E3SpinLocker theLocker ( sImmediateCacheLock ) ;
+	
+	sImmediateCache.currentFrame += 1 ;
+	e3geometry_immediate_trim ( &disposeList ) ;
+	}
+	
+	e3geometry_immediate_dispose_entries ( disposeList ) ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3Geometry_IsDegenerateTriple : Test whether 3 axes are coplanar.
 //-----------------------------------------------------------------------------
@@ -75,6 +75,10 @@ public :
 	const TQ3XGeomCacheNewMethod	 	cacheNew ;
 	const TQ3XGeomGetAttributeMethod	getAttribute ;
 	const TQ3XGeomGetPublicDataMethod	getPublicData ;
+	const TQ3XGeomSubmitDecomposedMethod	submitDecomposed ;
+	const TQ3XGeomGetCacheKeyMethod		getCacheKey ;
+	const TQ3Boolean					usesSubdivision ;
+	const TQ3Boolean					usesOrientation ;
 	
 									E3GeometryInfo	(
 											TQ3XMetaHandler	newClassMetaHandler,
@@ -88,19 +92,54 @@ public :
 
 
 
-// Geometry data
-struct E3GeometryData
+// Geometry cache key
+//
+// The view state a cached representation was built for.
+struct E3GeometryCacheKey
 {
 	TQ3Uns32					cameraEditIndex;
 	TQ3SubdivisionStyleData		styleSubdivision;
 	TQ3OrientationStyle			styleOrientation;
+	float						cachedDeterminant;
+};
+
+
+
+// Geometry data
+//
+// The cached representation of a geometry is only accessed with cacheLock
+// held, since a geometry may be submitted on several threads at once.
+struct E3GeometryCacheEntry;
+
+struct E3GeometryData
+{
+	E3SpinLock					cacheLock;
+	E3GeometryCacheKey			cacheKey;
 	TQ3Uns32					cachedEditIndex;
 	TQ3Object					cachedObject;
-	float						cachedDeterminant;
+	E3GeometryCacheEntry*		cacheAlternates;
 };
 
 
 
+// Analytic pick hit
+//
+// A hit found by intersecting a pick ray with the exact surface of a geometry,
+// rather than with its cached representation. The ray parameter, normal, and
+// UV are in the canonical coordinates of the geometry's pick frame.
+struct E3GeometryPickHit
+{
+	float						rayT;
+	TQ3Vector3D					normal;
+	TQ3Param2D					uv;
+};
+
+const TQ3Uns32 kGeometryPickMaxHits							= 4;
+
+typedef TQ3Uns32 (*E3GeometryPickIntersectMethod)(const TQ3Ray3D *canonicalRay, const void *geomData, E3GeometryPickHit *theHits);
+
+
+
 // This prototype needs to precede the friend declaration in E3Geometry to make some
 // compilers happy.
 TQ3Status			E3Geometry_RegisterClass(void);
@@ -125,6 +164,10 @@ public :
 													const void   *geomData,   TQ3Object         cachedGeom)	;
 	friend TQ3Status			e3geometry_submit_decomposed(TQ3ViewObject theView, TQ3ObjectType objectType,
 													TQ3Object theObject, const void *objectData) ;
+	friend TQ3Boolean			e3geometry_cache_exchange(E3Geometry *theGeom, const E3GeometryCacheKey *viewKey,
+													TQ3Boolean usesSubdivision, TQ3Boolean usesOrientation) ;
+	friend void					e3geometry_cache_purge(E3Geometry *theGeom) ;
+	friend void					e3geometry_cache_trim(E3GeometryCacheEntry **disposeList) ;
 													
 	friend TQ3Status			E3Geometry_RegisterClass();
 	} ;
@@ -142,6 +185,23 @@ TQ3Status			E3Geometry_GetAttributeSet(TQ3GeometryObject theGeom, TQ3AttributeSe
 TQ3Status			E3Geometry_SetAttributeSet(TQ3GeometryObject theGeom, TQ3AttributeSet attributeSet);
 TQ3Status			E3Geometry_Submit(TQ3GeometryObject theGeom, TQ3ViewObject theView);
 TQ3Object			E3Geometry_GetDecomposed( TQ3GeometryObject theGeom, TQ3ViewObject view );
+TQ3Status			E3Geometry_GetCacheStatistics(TQ3GeometryCacheStatistics *statistics);
+TQ3Status			E3Geometry_ResetCacheStatistics(void);
+TQ3Status			E3Geometry_SetCacheBudget(TQ3Uns32 numBytes);
+TQ3Status			E3Geometry_SetImmediateCacheLimits(TQ3Uns32 maxEntries, TQ3Uns32 maxIdleFrames);
+TQ3Status			E3Geometry_FlushImmediateCache(void);
+void				E3Geometry_ImmediateCacheEndFrame(void);
+
+TQ3Status			E3Geometry_PickDecomposed(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData);
+TQ3Status			E3Geometry_PickAnalytic(TQ3ViewObject					theView,
+											TQ3ObjectType					objectType,
+											TQ3Object						theObject,
+											const void						*objectData,
+											const TQ3Point3D				*frameOrigin,
+											const TQ3Vector3D				*xAxis,
+											const TQ3Vector3D				*yAxis,
+											const TQ3Vector3D				*zAxis,
+											E3GeometryPickIntersectMethod	intersectMethod);
 
 TQ3Boolean			E3Geometry_IsDegenerateTriple( const TQ3Vector3D* orientation,
 												const TQ3Vector3D* majorAxis,
@@ -618,6 +618,158 @@ e3geom_box_bounds(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object the
 
 
 
+//=============================================================================
+//      e3geom_box_pick_face_hit : Fill in a ray hit on a face of the box.
+//-----------------------------------------------------------------------------
+//		Note :	The face is the side of the canonical unit cube where the
+//				given axis is 0 or 1, and its UVs are those given to the face
+//				by e3geom_box_cache_new.
+//-----------------------------------------------------------------------------
+static void
+e3geom_box_pick_face_hit(const TQ3Ray3D *theRay, float rayT, TQ3Uns32 theAxis, TQ3Uns32 theSide, E3GeometryPickHit *theHit)
+{	TQ3Point3D		hitPoint;
+
+
+
+	// Find the hit point
+	hitPoint.x = theRay->origin.x + rayT * theRay->direction.x;
+	hitPoint.y = theRay->origin.y + rayT * theRay->direction.y;
+	hitPoint.z = theRay->origin.z + rayT * theRay->direction.z;
+
+	theHit->rayT = rayT;
+	Q3Vector3D_Set(&theHit->normal, 0.0f, 0.0f, 0.0f);
+
+
+
+	// Fill in the normal and UV for the face
+	switch (theAxis) {
+		case 0:
+			// Back and front faces
+			theHit->normal.x = (theSide == 0 ? -1.0f : 1.0f);
+			theHit->uv.u     = (theSide == 0 ? 1.0f - hitPoint.y : hitPoint.y);
+			theHit->uv.v     = hitPoint.z;
+			break;
+
+		case 1:
+			// Left and right faces
+			theHit->normal.y = (theSide == 0 ? -1.0f : 1.0f);
+			theHit->uv.u     = (theSide == 0 ? hitPoint.x : 1.0f - hitPoint.x);
+			theHit->uv.v     = hitPoint.z;
+			break;
+
+		default:
+			// Bottom and top faces
+			theHit->normal.z = (theSide == 0 ? -1.0f : 1.0f);
+			theHit->uv.u     = (theSide == 0 ? 1.0f - hitPoint.y : hitPoint.y);
+			theHit->uv.v     = 1.0f - hitPoint.x;
+			break;
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_box_pick_intersect : Intersect a ray with the box.
+//-----------------------------------------------------------------------------
+//		Note :	In the canonical frame of the box it is the unit cube, and we
+//				find where the ray enters and leaves it by clipping the ray to
+//				the slab between each pair of opposite faces.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_box_pick_intersect(const TQ3Ray3D *theRay, const void *geomData, E3GeometryPickHit *theHits)
+{	float				rayOrigin[3], rayDirection[3];
+	float				nearT, farT, lowT, highT;
+	TQ3Uns32			nearAxis, nearSide, farAxis, farSide;
+	TQ3Uns32			n, lowSide;
+#pragma unused(geomData)
+
+
+
+	// Clip the ray to each slab in turn
+	rayOrigin[0]    = theRay->origin.x;
+	rayOrigin[1]    = theRay->origin.y;
+	rayOrigin[2]    = theRay->origin.z;
+	rayDirection[0] = theRay->direction.x;
+	rayDirection[1] = theRay->direction.y;
+	rayDirection[2] = theRay->direction.z;
+
+	nearT    = -kQ3MaxFloat;
+	farT     =  kQ3MaxFloat;
+	nearAxis = nearSide = farAxis = farSide = 0;
+
+	for (n = 0; n < 3; n++)
+		{
+		if (rayDirection[n] == 0.0f)
+			{
+			if (rayOrigin[n] < 0.0f || rayOrigin[n] > 1.0f)
+				return(0);
+			continue;
+			}
+
+		lowT    = (0.0f - rayOrigin[n]) / rayDirection[n];
+		highT   = (1.0f - rayOrigin[n]) / rayDirection[n];
+		lowSide = 0;
+		if (lowT > highT)
+			{
+			E3Float_Swap(lowT, highT);
+			lowSide = 1;
+			}
+
+		if (lowT > nearT)
+			{
+			nearT    = lowT;
+			nearAxis = n;
+			nearSide = lowSide;
+			}
+
+		if (highT < farT)
+			{
+			farT    = highT;
+			farAxis = n;
+			farSide = 1 - lowSide;
+			}
+
+		if (nearT > farT)
+			return(0);
+		}
+
+
+
+	// Fill in the hits where the ray enters and leaves the box
+	e3geom_box_pick_face_hit(theRay, nearT, nearAxis, nearSide, &theHits[0]);
+	e3geom_box_pick_face_hit(theRay, farT,  farAxis,  farSide,  &theHits[1]);
+
+	return(2);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_box_pick : Box picking method.
+//-----------------------------------------------------------------------------
+//		Note :	The box is picked against its exact faces, rather than through
+//				its cached form.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_box_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{	const TQ3BoxData		*geomData = (const TQ3BoxData *) objectData;
+
+
+
+	// Pick the faces
+	return(E3Geometry_PickAnalytic(theView, objectType, theObject, objectData,
+								   &geomData->origin, &geomData->majorAxis, &geomData->minorAxis, &geomData->orientation,
+								   e3geom_box_pick_intersect));
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_box_get_attribute : Box get attribute set pointer.
 //-----------------------------------------------------------------------------
@@ -632,6 +784,28 @@ e3geom_box_get_attribute ( E3Box* theObject )
 
 
 
+//=============================================================================
+//      e3geom_box_get_cache_key : Box cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_box_get_cache_key(const TQ3BoxData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3BoxData, minorAxis ) + sizeof( geomData->minorAxis ));
+	
+	for (TQ3Uns32 n = 0; n < 6; ++n)
+		attributeSets[n] = (geomData->faceAttributeSet != NULL) ? geomData->faceAttributeSet[n] : NULL;
+	
+	attributeSets[6] = geomData->boxAttributeSet;
+	
+	return 7;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_box_metahandler : Box metahandler.
 //-----------------------------------------------------------------------------
@@ -662,11 +836,19 @@ e3geom_box_metahandler(TQ3XMethodType methodType)
 		case kQ3XMethodTypeObjectSubmitBounds:
 			theMethod = (TQ3XFunctionPointer) e3geom_box_bounds;
 			break;
+
+		case kQ3XMethodTypeObjectSubmitPick:
+			theMethod = (TQ3XFunctionPointer) e3geom_box_pick;
+			break;
 		
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_box_get_attribute;
 			break;
 
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_box_get_cache_key;
+			break;
+
 		case kQ3XMethodTypeGeomUsesOrientation:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
 			break;
@@ -45,6 +45,7 @@
 //-----------------------------------------------------------------------------
 #include "E3Prefix.h"
 #include "E3View.h"
+#include "E3Math.h"
 #include "E3Geometry.h"
 #include "E3GeometryTriMesh.h"
 #include "E3GeometryCone.h"
@@ -854,6 +855,130 @@ e3geom_cone_cache_new(TQ3ViewObject theView, TQ3GeometryObject theGeom, const TQ
 
 
 
+//=============================================================================
+//      e3geom_cone_pick_intersect : Intersect a ray with the cone.
+//-----------------------------------------------------------------------------
+//		Note :	In the canonical frame of the cone the face is the surface
+//				x^2 + y^2 = (1 - z)^2 between z = vMin and z = vMax, with the
+//				tip at z = 1, and the bottom cap is a disk at z = vMin. The UVs
+//				follow the cached form, and the cap uses the UVs of the disk it
+//				would create for it.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_cone_pick_intersect(const TQ3Ray3D *theRay, const void *geomData, E3GeometryPickHit *theHits)
+{	const TQ3ConeData		*coneData = (const TQ3ConeData *) geomData;
+	float					vMin, vMax, capRadius, t;
+	TQ3Uns32				numRoots, numHits, n;
+	float					theRoots[2];
+	TQ3Point3D				hitPoint;
+
+
+
+	// Get the extent of the face
+	vMin = E3Num_Clamp(coneData->vMin, 0.0f, 1.0f);
+	vMax = E3Num_Clamp(coneData->vMax, 0.0f, 1.0f);
+	if (vMin > vMax)
+		E3Float_Swap(vMin, vMax);
+
+
+
+	// Intersect the face
+	//
+	// The quadric also contains the cone reflected through the tip, but that
+	// lies above z = 1 and so is never within the extent of the face.
+	numHits  = 0;
+	numRoots = E3Math_SolveQuadratic(theRay->direction.x * theRay->direction.x + theRay->direction.y * theRay->direction.y -
+										theRay->direction.z * theRay->direction.z,
+									 2.0f * (theRay->origin.x * theRay->direction.x + theRay->origin.y * theRay->direction.y +
+										(1.0f - theRay->origin.z) * theRay->direction.z),
+									 theRay->origin.x * theRay->origin.x + theRay->origin.y * theRay->origin.y -
+										(1.0f - theRay->origin.z) * (1.0f - theRay->origin.z),
+									 theRoots);
+
+	for (n = 0; n < numRoots; n++)
+		{
+		hitPoint.x = theRay->origin.x + theRoots[n] * theRay->direction.x;
+		hitPoint.y = theRay->origin.y + theRoots[n] * theRay->direction.y;
+		hitPoint.z = theRay->origin.z + theRoots[n] * theRay->direction.z;
+		if (hitPoint.z < vMin || hitPoint.z > vMax)
+			continue;
+
+
+		// The normal is undefined at the tip, where we use the axis
+		theHits[numHits].rayT = theRoots[n];
+		if (1.0f - hitPoint.z > kQ3RealZero)
+			Q3Vector3D_Set(&theHits[numHits].normal, hitPoint.x, hitPoint.y, 1.0f - hitPoint.z);
+		else
+			Q3Vector3D_Set(&theHits[numHits].normal, 0.0f, 0.0f, 1.0f);
+
+		theHits[numHits].uv.u = atan2f(hitPoint.y, hitPoint.x) / kQ32Pi;
+		if (theHits[numHits].uv.u < 0.0f)
+			theHits[numHits].uv.u += 1.0f;
+
+		theHits[numHits].uv.v = hitPoint.z;
+		numHits++;
+		}
+
+
+
+	// Intersect the bottom cap
+	//
+	// The disk for the cap has its minor radius flipped, to face outwards.
+	if ((coneData->caps & kQ3EndCapMaskBottom) != 0 && theRay->direction.z != 0.0f)
+		{
+		capRadius = 1.0f - vMin;
+		t         = (vMin - theRay->origin.z) / theRay->direction.z;
+
+		hitPoint.x = theRay->origin.x + t * theRay->direction.x;
+		hitPoint.y = theRay->origin.y + t * theRay->direction.y;
+		if (hitPoint.x * hitPoint.x + hitPoint.y * hitPoint.y <= capRadius * capRadius)
+			{
+			theHits[numHits].rayT = t;
+			Q3Vector3D_Set(&theHits[numHits].normal, 0.0f, 0.0f, -1.0f);
+
+			theHits[numHits].uv.u = ( hitPoint.x / capRadius + 1.0f) / 2.0f;
+			theHits[numHits].uv.v = (-hitPoint.y / capRadius + 1.0f) / 2.0f;
+			numHits++;
+			}
+		}
+
+	return(numHits);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_cone_pick : Cone picking method.
+//-----------------------------------------------------------------------------
+//		Note :	A cone which goes all the way round is picked against its
+//				exact surface. Any other cone may have an interior, so we pick
+//				its cached form.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_cone_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{	const TQ3ConeData		*geomData = (const TQ3ConeData *) objectData;
+
+
+
+	// Pick the cached form unless the cone is complete, and has a face
+	if (E3Num_Clamp(geomData->uMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->uMax, 0.0f, 1.0f) != 1.0f ||
+		E3Float_Abs(E3Num_Clamp(geomData->vMax, 0.0f, 1.0f) - E3Num_Clamp(geomData->vMin, 0.0f, 1.0f)) <= kQ3RealZero)
+		return(E3Geometry_PickDecomposed(theView, objectType, theObject, objectData));
+
+
+
+	// Pick the surface
+	return(E3Geometry_PickAnalytic(theView, objectType, theObject, objectData,
+								   &geomData->origin, &geomData->majorRadius, &geomData->minorRadius, &geomData->orientation,
+								   e3geom_cone_pick_intersect));
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_cone_get_attribute : Cone get attribute set pointer.
 //-----------------------------------------------------------------------------
@@ -868,6 +993,28 @@ e3geom_cone_get_attribute ( E3Cone* cone )
 
 
 
+//=============================================================================
+//      e3geom_cone_get_cache_key : Cone cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_cone_get_cache_key(const TQ3ConeData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3ConeData, caps ) + sizeof( geomData->caps ));
+	
+	attributeSets[0] = geomData->interiorAttributeSet;
+	attributeSets[1] = geomData->faceAttributeSet;
+	attributeSets[2] = geomData->bottomAttributeSet;
+	attributeSets[3] = geomData->coneAttributeSet;
+	
+	return 4;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_cone_metahandler : Cone metahandler.
 //-----------------------------------------------------------------------------
@@ -895,9 +1042,17 @@ e3geom_cone_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) e3geom_cone_cache_new;
 			break;
 
+		case kQ3XMethodTypeObjectSubmitPick:
+			theMethod = (TQ3XFunctionPointer) e3geom_cone_pick;
+			break;
+
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_cone_get_attribute;
 			break;
+
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_cone_get_cache_key;
+			break;
 		
 		case kQ3XMethodTypeGeomUsesSubdivision:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
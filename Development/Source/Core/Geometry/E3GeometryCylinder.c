@@ -45,6 +45,7 @@
 //-----------------------------------------------------------------------------
 #include "E3Prefix.h"
 #include "E3View.h"
+#include "E3Math.h"
 #include "E3Geometry.h"
 #include "E3GeometryTriMesh.h"
 #include "E3GeometryCylinder.h"
@@ -673,6 +674,124 @@ e3geom_cylinder_cache_new(TQ3ViewObject theView, TQ3GeometryObject theGeom, cons
 
 
 
+//=============================================================================
+//      e3geom_cylinder_pick_intersect : Intersect a ray with the cylinder.
+//-----------------------------------------------------------------------------
+//		Note :	In the canonical frame of the cylinder the side is the unit
+//				circle swept between z = vMin and z = vMax, and the end caps
+//				are disks at either end. The UVs follow the cached form, and
+//				the caps use the UVs of the disks it would create for them.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_cylinder_pick_intersect(const TQ3Ray3D *theRay, const void *geomData, E3GeometryPickHit *theHits)
+{	const TQ3CylinderData		*cylinderData = (const TQ3CylinderData *) geomData;
+	TQ3Uns32					numRoots, numHits, n;
+	float						vMin, vMax, capZ, t;
+	float						theRoots[2];
+	TQ3Point3D					hitPoint;
+
+
+
+	// Get the height of the side
+	vMin = E3Num_Clamp(cylinderData->vMin, 0.0f, 1.0f);
+	vMax = E3Num_Clamp(cylinderData->vMax, 0.0f, 1.0f);
+	if (vMin > vMax)
+		E3Float_Swap(vMin, vMax);
+
+
+
+	// Intersect the side, solving x^2 + y^2 = 1
+	numHits  = 0;
+	numRoots = E3Math_SolveQuadratic(theRay->direction.x * theRay->direction.x + theRay->direction.y * theRay->direction.y,
+									 2.0f * (theRay->origin.x * theRay->direction.x + theRay->origin.y * theRay->direction.y),
+									 theRay->origin.x * theRay->origin.x + theRay->origin.y * theRay->origin.y - 1.0f,
+									 theRoots);
+
+	for (n = 0; n < numRoots; n++)
+		{
+		hitPoint.x = theRay->origin.x + theRoots[n] * theRay->direction.x;
+		hitPoint.y = theRay->origin.y + theRoots[n] * theRay->direction.y;
+		hitPoint.z = theRay->origin.z + theRoots[n] * theRay->direction.z;
+		if (hitPoint.z < vMin || hitPoint.z > vMax)
+			continue;
+
+		theHits[numHits].rayT = theRoots[n];
+		Q3Vector3D_Set(&theHits[numHits].normal, hitPoint.x, hitPoint.y, 0.0f);
+
+		theHits[numHits].uv.u = atan2f(hitPoint.y, hitPoint.x) / kQ32Pi;
+		if (theHits[numHits].uv.u < 0.0f)
+			theHits[numHits].uv.u += 1.0f;
+
+		theHits[numHits].uv.v = (hitPoint.z - vMin) / (vMax - vMin);
+		numHits++;
+		}
+
+
+
+	// Intersect the caps
+	if (theRay->direction.z != 0.0f)
+		{
+		for (n = 0; n < 2; n++)
+			{
+			if ((cylinderData->caps & (n == 0 ? kQ3EndCapMaskBottom : kQ3EndCapMaskTop)) == 0)
+				continue;
+
+			capZ = (n == 0 ? vMin : vMax);
+			t    = (capZ - theRay->origin.z) / theRay->direction.z;
+
+			hitPoint.x = theRay->origin.x + t * theRay->direction.x;
+			hitPoint.y = theRay->origin.y + t * theRay->direction.y;
+			if (hitPoint.x * hitPoint.x + hitPoint.y * hitPoint.y > 1.0f)
+				continue;
+
+
+			// The bottom disk has its minor radius flipped, to face outwards
+			theHits[numHits].rayT = t;
+			Q3Vector3D_Set(&theHits[numHits].normal, 0.0f, 0.0f, (n == 0 ? -1.0f : 1.0f));
+
+			theHits[numHits].uv.u = (hitPoint.x + 1.0f) / 2.0f;
+			theHits[numHits].uv.v = ((n == 0 ? -hitPoint.y : hitPoint.y) + 1.0f) / 2.0f;
+			numHits++;
+			}
+		}
+
+	return(numHits);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_cylinder_pick : Cylinder picking method.
+//-----------------------------------------------------------------------------
+//		Note :	A cylinder which goes all the way round is picked against its
+//				exact surface. Any other cylinder may have an interior, so we
+//				pick its cached form.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_cylinder_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{	const TQ3CylinderData		*geomData = (const TQ3CylinderData *) objectData;
+
+
+
+	// Pick the cached form unless the cylinder is complete, and has a side
+	if (E3Num_Clamp(geomData->uMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->uMax, 0.0f, 1.0f) != 1.0f ||
+		E3Float_Abs(E3Num_Clamp(geomData->vMax, 0.0f, 1.0f) - E3Num_Clamp(geomData->vMin, 0.0f, 1.0f)) <= kQ3RealZero)
+		return(E3Geometry_PickDecomposed(theView, objectType, theObject, objectData));
+
+
+
+	// Pick the surface
+	return(E3Geometry_PickAnalytic(theView, objectType, theObject, objectData,
+								   &geomData->origin, &geomData->majorRadius, &geomData->minorRadius, &geomData->orientation,
+								   e3geom_cylinder_pick_intersect));
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_cylinder_get_attribute : Cylinder get attribute set pointer.
 //-----------------------------------------------------------------------------
@@ -687,6 +806,29 @@ e3geom_cylinder_get_attribute ( E3Cylinder* cylinder )
 
 
 
+//=============================================================================
+//      e3geom_cylinder_get_cache_key : Cylinder cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_cylinder_get_cache_key(const TQ3CylinderData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3CylinderData, caps ) + sizeof( geomData->caps ));
+	
+	attributeSets[0] = geomData->interiorAttributeSet;
+	attributeSets[1] = geomData->topAttributeSet;
+	attributeSets[2] = geomData->faceAttributeSet;
+	attributeSets[3] = geomData->bottomAttributeSet;
+	attributeSets[4] = geomData->cylinderAttributeSet;
+	
+	return 5;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_cylinder_metahandler : Cylinder metahandler.
 //-----------------------------------------------------------------------------
@@ -714,9 +856,17 @@ e3geom_cylinder_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) e3geom_cylinder_cache_new;
 			break;
 
+		case kQ3XMethodTypeObjectSubmitPick:
+			theMethod = (TQ3XFunctionPointer) e3geom_cylinder_pick;
+			break;
+
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_cylinder_get_attribute;
 			break;
+
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_cylinder_get_cache_key;
+			break;
 		
 		case kQ3XMethodTypeGeomUsesSubdivision:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
@@ -45,6 +45,7 @@
 //-----------------------------------------------------------------------------
 #include "E3Prefix.h"
 #include "E3View.h"
+#include "E3Math.h"
 #include "E3Geometry.h"
 #include "E3GeometryDisk.h"
 #include "E3ErrorManager.h"
@@ -502,6 +503,92 @@ e3geom_disk_cache_new(TQ3ViewObject theView, TQ3GeometryObject theGeom, const TQ
 
 
 
+//=============================================================================
+//      e3geom_disk_pick_intersect : Intersect a ray with the disk.
+//-----------------------------------------------------------------------------
+//		Note :	In the canonical frame of the disk it is the ring between the
+//				radii vMin and vMax in the plane z = 0. The UVs follow the
+//				cached form.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_disk_pick_intersect(const TQ3Ray3D *theRay, const void *geomData, E3GeometryPickHit *theHits)
+{	const TQ3DiskData		*diskData = (const TQ3DiskData *) geomData;
+	float					vMin, vMax, radiusSquared, t;
+	TQ3Point3D				hitPoint;
+
+
+
+	// Get the extent of the ring
+	vMin = E3Num_Clamp(diskData->vMin, 0.0f, 1.0f);
+	vMax = E3Num_Clamp(diskData->vMax, 0.0f, 1.0f);
+	if (vMin > vMax)
+		E3Float_Swap(vMin, vMax);
+
+
+
+	// Intersect the plane, and check we're within the ring
+	if (theRay->direction.z == 0.0f)
+		return(0);
+
+	t = -theRay->origin.z / theRay->direction.z;
+	hitPoint.x = theRay->origin.x + t * theRay->direction.x;
+	hitPoint.y = theRay->origin.y + t * theRay->direction.y;
+
+	radiusSquared = hitPoint.x * hitPoint.x + hitPoint.y * hitPoint.y;
+	if (radiusSquared < vMin * vMin || radiusSquared > vMax * vMax)
+		return(0);
+
+
+
+	// Fill in the hit
+	theHits[0].rayT = t;
+	Q3Vector3D_Set(&theHits[0].normal, 0.0f, 0.0f, 1.0f);
+
+	theHits[0].uv.u = (hitPoint.x + 1.0f) / 2.0f;
+	theHits[0].uv.v = (hitPoint.y + 1.0f) / 2.0f;
+
+	return(1);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_disk_pick : Disk picking method.
+//-----------------------------------------------------------------------------
+//		Note :	A disk which goes all the way round is picked against its
+//				exact surface, and any other disk through its cached form.
+//
+//				The disk has no third axis, so we complete its frame with the
+//				normal to the disk.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_disk_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{	const TQ3DiskData		*geomData = (const TQ3DiskData *) objectData;
+	TQ3Vector3D				diskNormal;
+
+
+
+	// Pick the cached form unless the disk is complete
+	if (E3Num_Clamp(geomData->uMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->uMax, 0.0f, 1.0f) != 1.0f ||
+		E3Float_Abs(E3Num_Clamp(geomData->vMax, 0.0f, 1.0f) - E3Num_Clamp(geomData->vMin, 0.0f, 1.0f)) <= kQ3RealZero)
+		return(E3Geometry_PickDecomposed(theView, objectType, theObject, objectData));
+
+
+
+	// Pick the surface
+	Q3Vector3D_Cross(&geomData->majorRadius, &geomData->minorRadius, &diskNormal);
+
+	return(E3Geometry_PickAnalytic(theView, objectType, theObject, objectData,
+								   &geomData->origin, &geomData->majorRadius, &geomData->minorRadius, &diskNormal,
+								   e3geom_disk_pick_intersect));
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_disk_get_attribute : Disk get attribute set pointer.
 //-----------------------------------------------------------------------------
@@ -516,6 +603,25 @@ e3geom_disk_get_attribute ( E3Disk* disk )
 
 
 
+//=============================================================================
+//      e3geom_disk_get_cache_key : Disk cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_disk_get_cache_key(const TQ3DiskData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3DiskData, vMax ) + sizeof( geomData->vMax ));
+	
+	attributeSets[0] = geomData->diskAttributeSet;
+	
+	return 1;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_disk_metahandler : Disk metahandler.
 //-----------------------------------------------------------------------------
@@ -543,9 +649,17 @@ e3geom_disk_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) e3geom_disk_cache_new;
 			break;
 
+		case kQ3XMethodTypeObjectSubmitPick:
+			theMethod = (TQ3XFunctionPointer) e3geom_disk_pick;
+			break;
+
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_disk_get_attribute;
 			break;
+
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_disk_get_cache_key;
+			break;
 		
 		case kQ3XMethodTypeGeomUsesSubdivision:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
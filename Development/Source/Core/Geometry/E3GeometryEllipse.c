@@ -276,6 +276,25 @@ e3geom_ellipse_get_attribute ( E3Ellipse* ellipse )
 
 
 
+//=============================================================================
+//      e3geom_ellipse_get_cache_key : Ellipse cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_ellipse_get_cache_key(const TQ3EllipseData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3EllipseData, uMax ) + sizeof( geomData->uMax ));
+	
+	attributeSets[0] = geomData->ellipseAttributeSet;
+	
+	return 1;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_ellipse_metahandler : Ellipse metahandler.
 //-----------------------------------------------------------------------------
@@ -306,6 +325,10 @@ e3geom_ellipse_metahandler(TQ3XMethodType methodType)
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_ellipse_get_attribute;
 			break;
+
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_ellipse_get_cache_key;
+			break;
 		
 		case kQ3XMethodTypeGeomUsesSubdivision:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
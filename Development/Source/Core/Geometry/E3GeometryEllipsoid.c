@@ -45,6 +45,7 @@
 //-----------------------------------------------------------------------------
 #include "E3Prefix.h"
 #include "E3View.h"
+#include "E3Math.h"
 #include "E3Geometry.h"
 #include "E3GeometryTriMesh.h"
 #include "E3GeometryEllipsoid.h"
@@ -1014,6 +1015,84 @@ e3geom_ellipsoid_cache_new( TQ3ViewObject theView, TQ3GeometryObject theGeom,
 
 
 
+//=============================================================================
+//      e3geom_ellipsoid_pick_intersect : Intersect a ray with the ellipsoid.
+//-----------------------------------------------------------------------------
+//		Note :	In the canonical frame of the ellipsoid it is the unit sphere,
+//				with the south pole at z = -1. The outward normal is then the
+//				hit point, and the UVs follow from the surface parameterisation
+//				used for the cached representation.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_ellipsoid_pick_intersect(const TQ3Ray3D *theRay, const void *geomData, E3GeometryPickHit *theHits)
+{	TQ3Uns32		numRoots, n;
+	float			theRoots[2];
+	TQ3Point3D		hitPoint;
+#pragma unused(geomData)
+
+
+
+	// Solve |origin + t*direction|^2 = 1
+	numRoots = E3Math_SolveQuadratic(Q3Vector3D_Dot(&theRay->direction, &theRay->direction),
+									 2.0f * Q3Vector3D_Dot((const TQ3Vector3D *) &theRay->origin, &theRay->direction),
+									 Q3Vector3D_Dot((const TQ3Vector3D *) &theRay->origin, (const TQ3Vector3D *) &theRay->origin) - 1.0f,
+									 theRoots);
+
+
+
+	// Fill in the hits
+	for (n = 0; n < numRoots; n++)
+		{
+		hitPoint.x = theRay->origin.x + theRoots[n] * theRay->direction.x;
+		hitPoint.y = theRay->origin.y + theRoots[n] * theRay->direction.y;
+		hitPoint.z = theRay->origin.z + theRoots[n] * theRay->direction.z;
+
+		theHits[n].rayT = theRoots[n];
+		Q3Vector3D_Set(&theHits[n].normal, hitPoint.x, hitPoint.y, hitPoint.z);
+
+		theHits[n].uv.u = atan2f(hitPoint.y, hitPoint.x) / kQ32Pi;
+		if (theHits[n].uv.u < 0.0f)
+			theHits[n].uv.u += 1.0f;
+
+		theHits[n].uv.v = acosf(E3Num_Clamp(-hitPoint.z, -1.0f, 1.0f)) / kQ3Pi;
+		}
+
+	return(numRoots);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_ellipsoid_pick : Ellipsoid picking method.
+//-----------------------------------------------------------------------------
+//		Note :	A complete ellipsoid is picked against its exact surface. Any
+//				other ellipsoid has caps, so we pick its cached form.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_ellipsoid_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{	const TQ3EllipsoidData		*geomData = (const TQ3EllipsoidData *) objectData;
+
+
+
+	// Pick the cached form unless the ellipsoid is complete
+	if (E3Num_Clamp(geomData->uMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->uMax, 0.0f, 1.0f) != 1.0f ||
+		E3Num_Clamp(geomData->vMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->vMax, 0.0f, 1.0f) != 1.0f)
+		return(E3Geometry_PickDecomposed(theView, objectType, theObject, objectData));
+
+
+
+	// Pick the surface
+	return(E3Geometry_PickAnalytic(theView, objectType, theObject, objectData,
+								   &geomData->origin, &geomData->majorRadius, &geomData->minorRadius, &geomData->orientation,
+								   e3geom_ellipsoid_pick_intersect));
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_ellipsoid_get_attribute : Ellipsoid get attribute set pointer.
 //-----------------------------------------------------------------------------
@@ -1028,6 +1107,26 @@ e3geom_ellipsoid_get_attribute ( E3Ellipsoid* ellipsoid )
 
 
 
+//=============================================================================
+//      e3geom_ellipsoid_get_cache_key : Ellipsoid cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_ellipsoid_get_cache_key(const TQ3EllipsoidData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3EllipsoidData, caps ) + sizeof( geomData->caps ));
+	
+	attributeSets[0] = geomData->interiorAttributeSet;
+	attributeSets[1] = geomData->ellipsoidAttributeSet;
+	
+	return 2;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_ellipsoid_metahandler : Ellipsoid metahandler.
 //-----------------------------------------------------------------------------
@@ -1055,9 +1154,17 @@ e3geom_ellipsoid_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) e3geom_ellipsoid_cache_new;
 			break;
 
+		case kQ3XMethodTypeObjectSubmitPick:
+			theMethod = (TQ3XFunctionPointer) e3geom_ellipsoid_pick;
+			break;
+
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_ellipsoid_get_attribute;
 			break;
+
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_ellipsoid_get_cache_key;
+			break;
 		
 		case kQ3XMethodTypeGeomUsesSubdivision:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
@@ -56,6 +56,17 @@
 
 
 
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+const float kTorusPickCircularTolerance						= 1.0e-4f;
+const TQ3Uns32 kTorusPickBisections							= 64;
+const double kTorusPickSphereScale							= 1.01;
+
+
+
+
+
 //=============================================================================
 //      Internal types
 //-----------------------------------------------------------------------------
@@ -578,6 +589,262 @@ e3geom_torus_cache_new(TQ3ViewObject theView, TQ3GeometryObject theGeom,
 
 
 
+//=============================================================================
+//      e3geom_torus_evaluate_polynomial : Evaluate a polynomial.
+//-----------------------------------------------------------------------------
+//		Note :	The coefficients are in order of increasing degree.
+//-----------------------------------------------------------------------------
+static double
+e3geom_torus_evaluate_polynomial(TQ3Uns32 theDegree, const double *theCoeffs, double x)
+{	double		theValue;
+	TQ3Uns32	n;
+
+
+
+	// Evaluate by Horner's rule
+	theValue = theCoeffs[theDegree];
+	for (n = theDegree; n > 0; n--)
+		theValue = theValue * x + theCoeffs[n - 1];
+
+	return(theValue);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_torus_find_polynomial_roots : Find the roots of a polynomial.
+//-----------------------------------------------------------------------------
+//		Note :	Finds the roots of a polynomial of degree at most 4 between
+//				xMin and xMax, in ascending order.
+//
+//				The roots of the derivative split the interval into pieces on
+//				which the polynomial is monotonic, so each piece holds at most
+//				one root, which we find by bisection. A root which only touches
+//				zero is not found, but that is a ray which grazes the surface.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_torus_find_polynomial_roots(TQ3Uns32 theDegree, const double *theCoeffs,
+									double xMin, double xMax, double *theRoots)
+{	double		theDerivative[4], theBounds[5];
+	double		lowX, highX, midX, lowValue, highValue, midValue;
+	TQ3Uns32	numBounds, numRoots, n, i;
+
+
+
+	// Split the interval at the roots of the derivative
+	numBounds = 0;
+	theBounds[numBounds++] = xMin;
+
+	if (theDegree > 1)
+		{
+		for (n = 1; n <= theDegree; n++)
+			theDerivative[n - 1] = n * theCoeffs[n];
+
+		numBounds += e3geom_torus_find_polynomial_roots(theDegree - 1, theDerivative, xMin, xMax, &theBounds[1]);
+		}
+
+	theBounds[numBounds++] = xMax;
+
+
+
+	// Bisect each piece where the polynomial changes sign
+	numRoots = 0;
+	for (n = 0; n + 1 < numBounds; n++)
+		{
+		lowX      = theBounds[n];
+		highX     = theBounds[n + 1];
+		lowValue  = e3geom_torus_evaluate_polynomial(theDegree, theCoeffs, lowX);
+		highValue = e3geom_torus_evaluate_polynomial(theDegree, theCoeffs, highX);
+		if ((lowValue < 0.0) == (highValue < 0.0) || lowValue == 0.0 || highValue == 0.0)
+			continue;
+
+		for (i = 0; i < kTorusPickBisections; i++)
+			{
+			midX     = 0.5 * (lowX + highX);
+			midValue = e3geom_torus_evaluate_polynomial(theDegree, theCoeffs, midX);
+			if ((midValue < 0.0) == (lowValue < 0.0))
+				lowX = midX;
+			else
+				highX = midX;
+			}
+
+		theRoots[numRoots++] = 0.5 * (lowX + highX);
+		}
+
+	return(numRoots);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_torus_pick_intersect : Intersect a ray with the torus.
+//-----------------------------------------------------------------------------
+//		Note :	We only pick a torus with circular sections this way, and we
+//				scale its canonical frame along the orientation so that the
+//				cross section is a circle. The torus then has a major radius
+//				of 1, and a minor radius r of ratio*|orientation|/|majorRadius|,
+//				and is the quartic surface
+//
+//					(x^2 + y^2 + z^2 + 1 - r^2)^2 = 4(x^2 + y^2)
+//
+//				To keep the quartic well conditioned we measure the ray from
+//				where it enters the bounding sphere of the torus, with a unit
+//				direction, and then only look for roots within the sphere.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_torus_pick_intersect(const TQ3Ray3D *theRay, const void *geomData, E3GeometryPickHit *theHits)
+{	double					rayOrigin[3], rayDirection[3], theCoeffs[5], theRoots[4];
+	double					dirLength, tubeRadius, sphereRadius, theDiscriminant, sMin, sMax, e, f;
+	const TQ3TorusData		*torusData = (const TQ3TorusData *) geomData;
+	float					surfaceValue, ringRadius;
+	TQ3Uns32				numRoots, n;
+	TQ3Point3D				hitPoint;
+
+
+
+	// Find the ray with a unit direction
+	dirLength = sqrt((double) theRay->direction.x * theRay->direction.x +
+					 (double) theRay->direction.y * theRay->direction.y +
+					 (double) theRay->direction.z * theRay->direction.z);
+	if (dirLength == 0.0)
+		return(0);
+
+	rayDirection[0] = theRay->direction.x / dirLength;
+	rayDirection[1] = theRay->direction.y / dirLength;
+	rayDirection[2] = theRay->direction.z / dirLength;
+
+
+
+	// Find where the ray crosses the bounding sphere
+	//
+	// The sphere is slightly enlarged, so that hits on the outer equator of the
+	// torus are not at the ends of the interval.
+	tubeRadius   = torusData->ratio * Q3Vector3D_Length(&torusData->orientation) /
+					Q3Vector3D_Length(&torusData->majorRadius);
+	sphereRadius = (1.0 + tubeRadius) * kTorusPickSphereScale;
+
+	e = theRay->origin.x * rayDirection[0] + theRay->origin.y * rayDirection[1] + theRay->origin.z * rayDirection[2];
+	f = (double) theRay->origin.x * theRay->origin.x + (double) theRay->origin.y * theRay->origin.y +
+		(double) theRay->origin.z * theRay->origin.z;
+
+	theDiscriminant = e * e - f + sphereRadius * sphereRadius;
+	if (theDiscriminant <= 0.0)
+		return(0);
+
+	sMin = -e - sqrt(theDiscriminant);
+	sMax = -e + sqrt(theDiscriminant);
+
+	rayOrigin[0] = theRay->origin.x + sMin * rayDirection[0];
+	rayOrigin[1] = theRay->origin.y + sMin * rayDirection[1];
+	rayOrigin[2] = theRay->origin.z + sMin * rayDirection[2];
+
+
+
+	// Find the roots of the quartic in the distance s from rayOrigin
+	e = rayOrigin[0] * rayDirection[0] + rayOrigin[1] * rayDirection[1] + rayOrigin[2] * rayDirection[2];
+	f = rayOrigin[0] * rayOrigin[0] + rayOrigin[1] * rayOrigin[1] + rayOrigin[2] * rayOrigin[2] +
+		1.0 - tubeRadius * tubeRadius;
+
+	theCoeffs[4] = 1.0;
+	theCoeffs[3] = 4.0 * e;
+	theCoeffs[2] = 4.0 * e * e + 2.0 * f -
+				   4.0 * (rayDirection[0] * rayDirection[0] + rayDirection[1] * rayDirection[1]);
+	theCoeffs[1] = 4.0 * e * f -
+				   8.0 * (rayOrigin[0] * rayDirection[0] + rayOrigin[1] * rayDirection[1]);
+	theCoeffs[0] = f * f -
+				   4.0 * (rayOrigin[0] * rayOrigin[0] + rayOrigin[1] * rayOrigin[1]);
+
+	numRoots = e3geom_torus_find_polynomial_roots(4, theCoeffs, 0.0, sMax - sMin, theRoots);
+
+
+
+	// Fill in the hits
+	//
+	// The normal is the gradient of the quartic, and the UVs follow from the
+	// surface parameterisation used for the cached representation.
+	for (n = 0; n < numRoots; n++)
+		{
+		theHits[n].rayT = (float) ((theRoots[n] + sMin) / dirLength);
+
+		hitPoint.x = theRay->origin.x + theHits[n].rayT * theRay->direction.x;
+		hitPoint.y = theRay->origin.y + theHits[n].rayT * theRay->direction.y;
+		hitPoint.z = theRay->origin.z + theHits[n].rayT * theRay->direction.z;
+
+		surfaceValue = hitPoint.x * hitPoint.x + hitPoint.y * hitPoint.y + hitPoint.z * hitPoint.z +
+					   1.0f - (float) (tubeRadius * tubeRadius);
+		Q3Vector3D_Set(&theHits[n].normal, hitPoint.x * (surfaceValue - 2.0f),
+										   hitPoint.y * (surfaceValue - 2.0f),
+										   hitPoint.z * surfaceValue);
+
+		theHits[n].uv.u = atan2f(hitPoint.y, hitPoint.x) / kQ32Pi;
+		if (theHits[n].uv.u < 0.0f)
+			theHits[n].uv.u += 1.0f;
+
+		ringRadius      = sqrtf(hitPoint.x * hitPoint.x + hitPoint.y * hitPoint.y);
+		theHits[n].uv.v = atan2f(-hitPoint.z, 1.0f - ringRadius) / kQ32Pi;
+		if (theHits[n].uv.v < 0.0f)
+			theHits[n].uv.v += 1.0f;
+		}
+
+	return(numRoots);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_torus_pick : Torus picking method.
+//-----------------------------------------------------------------------------
+//		Note :	A complete torus with circular sections is picked against its
+//				exact surface. Any other torus is picked through its cached
+//				form, since its section varies around the torus or it has caps.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_torus_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object theObject, const void *objectData)
+{	const TQ3TorusData		*geomData = (const TQ3TorusData *) objectData;
+	float					majorLength, minorLength;
+	TQ3Vector3D				scaledOrientation;
+
+
+
+	// Pick the cached form unless the torus is complete
+	if (E3Num_Clamp(geomData->uMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->uMax, 0.0f, 1.0f) != 1.0f ||
+		E3Num_Clamp(geomData->vMin, 0.0f, 1.0f) != 0.0f || E3Num_Clamp(geomData->vMax, 0.0f, 1.0f) != 1.0f)
+		return(E3Geometry_PickDecomposed(theView, objectType, theObject, objectData));
+
+
+
+	// Pick the cached form unless the sections are circles
+	majorLength = Q3Vector3D_Length(&geomData->majorRadius);
+	minorLength = Q3Vector3D_Length(&geomData->minorRadius);
+
+	if (geomData->ratio <= 0.0f || majorLength <= kQ3RealZero ||
+		E3Float_Abs(majorLength - minorLength) > kTorusPickCircularTolerance * majorLength ||
+		E3Float_Abs(Q3Vector3D_Dot(&geomData->majorRadius, &geomData->minorRadius)) >
+			kTorusPickCircularTolerance * majorLength * minorLength)
+		return(E3Geometry_PickDecomposed(theView, objectType, theObject, objectData));
+
+
+
+	// Pick the surface
+	Q3Vector3D_Scale(&geomData->orientation,
+					 majorLength / (geomData->ratio * Q3Vector3D_Length(&geomData->orientation)),
+					 &scaledOrientation);
+
+	return(E3Geometry_PickAnalytic(theView, objectType, theObject, objectData,
+								   &geomData->origin, &geomData->majorRadius, &geomData->minorRadius, &scaledOrientation,
+								   e3geom_torus_pick_intersect));
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_torus_get_attribute : Torus get attribute set pointer.
 //-----------------------------------------------------------------------------
@@ -592,6 +859,26 @@ e3geom_torus_get_attribute ( E3Torus* torus )
 
 
 
+//=============================================================================
+//      e3geom_torus_get_cache_key : Torus cache key method.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3geom_torus_get_cache_key(const TQ3TorusData *geomData, TQ3Uns32 *dataSize, TQ3AttributeSet *attributeSets)
+{
+	// The geometry is described by the fields before the attribute sets,
+	// excluding any padding which precedes them
+	*dataSize = (TQ3Uns32) (offsetof( TQ3TorusData, caps ) + sizeof( geomData->caps ));
+	
+	attributeSets[0] = geomData->interiorAttributeSet;
+	attributeSets[1] = geomData->torusAttributeSet;
+	
+	return 2;
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_torus_metahandler : Torus metahandler.
 //-----------------------------------------------------------------------------
@@ -619,9 +906,17 @@ e3geom_torus_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) e3geom_torus_cache_new;
 			break;
 
+		case kQ3XMethodTypeObjectSubmitPick:
+			theMethod = (TQ3XFunctionPointer) e3geom_torus_pick;
+			break;
+
 		case kQ3XMethodTypeGeomGetAttribute:
 			theMethod = (TQ3XFunctionPointer) e3geom_torus_get_attribute;
 			break;
+
+		case kQ3XMethodTypeGeomGetCacheKey:
+			theMethod = (TQ3XFunctionPointer) e3geom_torus_get_cache_key;
+			break;
 		
 		case kQ3XMethodTypeGeomUsesSubdivision:
 			theMethod = (TQ3XFunctionPointer) kQ3True;
@@ -183,12 +183,16 @@ e3geom_trigrid_disposedata(TQ3TriGridData *theTriGrid)
 		for (i=0; i<qtyFacets; i++) {
 			Q3Object_CleanDispose(&theTriGrid->facetAttributeSet[i] );
 		}
+		Q3Memory_Free( &theTriGrid->facetAttributeSet );
 	}
 	
-	qtyVertices = theTriGrid->numRows * theTriGrid->numColumns;
-	for (i = 0; i < qtyVertices; ++i)
-	{
-		Q3Object_CleanDispose(&theTriGrid->vertices[ i ].attributeSet );
+	if (theTriGrid->vertices != NULL) {
+		qtyVertices = theTriGrid->numRows * theTriGrid->numColumns;
+		for (i = 0; i < qtyVertices; ++i)
+		{
+			Q3Object_CleanDispose(&theTriGrid->vertices[ i ].attributeSet );
+		}
+		Q3Memory_Free( &theTriGrid->vertices );
 	}
 	
 	Q3Object_CleanDispose(&theTriGrid->triGridAttributeSet );
@@ -51,8 +51,11 @@
 #include "E3Math_Intersect.h"
 #include "E3Geometry.h"
 #include "E3GeometryTriMesh.h"
+#include "E3GeometryTriMeshBVH.h"
 #include "E3ErrorManager.h"
 
+#include <vector>
+
 
 
 
@@ -64,6 +67,9 @@ const TQ3Uns32 kTriMeshNone											= 0;
 const TQ3Uns32 kTriMeshLocked										= (1 << 0);
 const TQ3Uns32 kTriMeshLockedReadOnly								= (1 << 1);
 
+// TriMeshes with fewer triangles than this are picked without a BVH
+const TQ3Uns32 kTriMeshPickTreeMinTriangles							= 64;
+
 
 
 
@@ -75,10 +81,50 @@ const TQ3Uns32 kTriMeshLockedReadOnly								= (1 << 1);
 typedef struct {
 	TQ3Uns32			theFlags;
 	TQ3Uns32			lockCount;
+	E3SpinLock			lockCountLock;	// Guards lockCount and kTriMeshLockedReadOnly
 	TQ3TriMeshData		geomData;
+	E3TriMeshBVH		*pickTree;
 } TQ3TriMeshInstanceData;
 
 
+// State for ray picking a TriMesh
+typedef struct {
+	TQ3ViewObject			theView;
+	TQ3PickObject			thePick;
+	const TQ3TriMeshData	*geomData;
+	const TQ3Matrix4x4		*localToWorld;
+	const TQ3Ray3D			*worldRay;
+	const TQ3Point3D		*worldPoints;
+	TQ3Boolean				cullBackface;
+	TQ3Boolean				nearestOnly;
+	TQ3Uns32				nearestIndex;
+	TQ3Param3D				nearestHit;
+	TQ3Status				qd3dStatus;
+} TQ3TriMeshRayPickState;
+
+
+// State for rect picking a TriMesh
+typedef struct {
+	TQ3ViewObject			theView;
+	TQ3PickObject			thePick;
+	const TQ3TriMeshData	*geomData;
+	const TQ3Matrix4x4		*localToWindow;
+	const TQ3Matrix4x4		*worldToWindow;
+	const TQ3Area			*theRect;
+	const TQ3Point3D		*windowPoints;
+	TQ3Uns32				hitIndex;
+	TQ3Point3D				windowHitPt;
+} TQ3TriMeshRectPickState;
+
+
+// Resolved TriMesh attribute array, for submitting decomposed triangles
+typedef struct {
+	TQ3ObjectType			attrType;
+	TQ3Uns32				attrSize;
+	const TQ3Uns8			*attrData;
+} TQ3TriMeshAttributeSource;
+
+
 
 
 class E3TriMesh : public E3Geometry // This is a leaf class so no other classes use this,
@@ -634,7 +680,9 @@ e3geom_trimesh_new(TQ3Object theObject, void *privateData, const void *paramData
 
 
 	// Initialise the TriMesh, then optimise it
-	instanceData->theFlags = kTriMeshNone;
+	instanceData->theFlags      = kTriMeshNone;
+	instanceData->lockCountLock = 0;
+	instanceData->pickTree      = NULL;
 	qd3dStatus = e3geom_trimesh_copydata(trimeshData, &instanceData->geomData,
 		kQ3False);
 	
@@ -667,7 +715,9 @@ e3geom_trimesh_new_nocopy(TQ3Object theObject, void *privateData, const void *pa
 
 
 	// Initialise the TriMesh, then optimise it
-	instanceData->theFlags = kTriMeshNone;
+	instanceData->theFlags      = kTriMeshNone;
+	instanceData->lockCountLock = 0;
+	instanceData->pickTree      = NULL;
 
 	Q3Memory_Copy( trimeshData, &instanceData->geomData, sizeof(TQ3TriMeshData) );
 	
@@ -702,6 +752,7 @@ e3geom_trimesh_delete(TQ3Object theObject, void *privateData)
 
 	// Dispose of our instance data
 	e3geom_trimesh_disposedata(&instanceData->geomData);
+	E3TriMeshBVH_Dispose(instanceData->pickTree);
 }
 
 
@@ -729,8 +780,12 @@ e3geom_trimesh_duplicate(TQ3Object fromObject, const void *fromPrivateData,
 
 
 	// Initialise the instance data of the new object
-	toData->theFlags = fromData->theFlags;
-	qd3dStatus       = e3geom_trimesh_copydata( &fromData->geomData, &toData->geomData, kQ3True );
+	//
+	// The pick tree is not shared, the duplicate builds its own if it is picked.
+	toData->theFlags      = fromData->theFlags;
+	toData->lockCountLock = 0;
+	toData->pickTree      = NULL;
+	qd3dStatus            = e3geom_trimesh_copydata( &fromData->geomData, &toData->geomData, kQ3True );
 
 	return(qd3dStatus);
 }
@@ -947,45 +1002,255 @@ e3geom_trimesh_cache_new(TQ3ViewObject theView, TQ3GeometryObject theGeom,
 
 
 
+//=============================================================================
+//      e3geom_trimesh_get_pick_tree : Get the pick BVH for a TriMesh.
+//-----------------------------------------------------------------------------
+//		Note :	The tree is built lazily the first time a retained TriMesh is
+//				picked, and discarded whenever its points or triangles are
+//				changed. We return NULL for immediate mode TriMeshes, for small
+//				TriMeshes, and for TriMeshes which are currently locked for
+//				writing, in which case the caller should test every triangle.
+//
+//				A TriMesh which is shared between threads may be picked on
+//				several of them at once, so the tree is built privately and
+//				then published. Threads which build a tree at the same time
+//				keep the first to be published, and dispose of the others.
+//-----------------------------------------------------------------------------
+static const E3TriMeshBVH *
+e3geom_trimesh_get_pick_tree(TQ3Object theObject, const void *objectData)
+{	TQ3TriMeshInstanceData		*instanceData;
+	E3TriMeshBVH				*pickTree;
+
+
+
+	// Check we can use a tree
+	if (theObject == NULL)
+		return(NULL);
+	
+	instanceData = (TQ3TriMeshInstanceData *) objectData;
+	if (instanceData->geomData.numTriangles < kTriMeshPickTreeMinTriangles)
+		return(NULL);
+
+	{
+	E3SpinLocker theLocker(instanceData->lockCountLock);
+
+	if (instanceData->lockCount != 0 && !E3Bit_IsSet(instanceData->theFlags, kTriMeshLockedReadOnly))
+		return(NULL);
+	}
+
+
+
+	// Use the published tree if there is one
+	pickTree = (E3TriMeshBVH *) E3Atomic_LoadPointer((void * const volatile *) &instanceData->pickTree);
+	if (pickTree != NULL)
+		return(pickTree);
+
+
+
+	// Otherwise build a tree, and publish it unless another thread got there first
+	pickTree = E3TriMeshBVH_New(instanceData->geomData);
+	if (pickTree == NULL)
+		return(NULL);
+
+	if (!E3Atomic_CompareAndSwapPointer((void * volatile *) &instanceData->pickTree, NULL, pickTree))
+		{
+		E3TriMeshBVH_Dispose(pickTree);
+		pickTree = (E3TriMeshBVH *) E3Atomic_LoadPointer((void * const volatile *) &instanceData->pickTree);
+		}
+
+	return(pickTree);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_trimesh_record_ray_hit : Record a ray hit on a triangle.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_trimesh_record_ray_hit(const TQ3TriMeshRayPickState	*theState,
+								TQ3Uns32					theIndex,
+								const TQ3Param3D			*theHit)
+{	TQ3Boolean				haveUV;
+	TQ3Param2D				hitUV, *resultUV;
+	TQ3TriangleData			worldTriangle;
+	TQ3Vector3D				hitNormal;
+	TQ3Point3D				hitXYZ;
+	TQ3Status				qd3dStatus;
+	TQ3Uns32				n, vertIndex;
+
+
+
+	// Create the triangle, and update the vertices to the transformed coordinates
+	e3geom_trimesh_triangle_new(theState->theView, theState->geomData, theIndex, &worldTriangle);
+
+	for (n = 0; n < 3; n++)
+		{
+		vertIndex = theState->geomData->triangles[theIndex].pointIndices[n];
+		if (theState->worldPoints != NULL)
+			worldTriangle.vertices[n].point = theState->worldPoints[vertIndex];
+		else
+			Q3Point3D_Transform(&theState->geomData->points[vertIndex], theState->localToWorld,
+								&worldTriangle.vertices[n].point);
+		}
+
+
+
+	// Obtain the XYZ, normal, and UV for the hit point. We always return an
+	// XYZ and normal for the hit, however we need to cope with missing UVs.
+	E3Triangle_InterpolateHit(theState->theView, &worldTriangle, theHit, &hitXYZ, &hitNormal, &hitUV, &haveUV);
+	resultUV = (haveUV ? &hitUV : NULL);
+
+
+
+	// Record the hit
+	qd3dStatus = E3Pick_RecordHit(theState->thePick, theState->theView, &hitXYZ, &hitNormal,
+		resultUV, NULL, theHit, theIndex );
+
+
+
+	// Clean up
+	e3geom_trimesh_triangle_delete(&worldTriangle);
+
+	return(qd3dStatus);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_trimesh_pick_ray_triangle : Test the pick ray against a triangle.
+//-----------------------------------------------------------------------------
+//		Note :	Invoked for each candidate triangle. The test is done in world
+//				coordinates, so that back-face culling and the hit details are
+//				exactly as if every triangle had been tested.
+//
+//				If only the nearest hit is wanted we just remember the best
+//				hit so far, and lower ioMaxT so that the BVH can skip anything
+//				behind it.
+//-----------------------------------------------------------------------------
+static bool
+e3geom_trimesh_pick_ray_triangle(TQ3Uns32 theIndex, void *userData, float &ioMaxT)
+{	TQ3TriMeshRayPickState		*theState = (TQ3TriMeshRayPickState *) userData;
+	const TQ3TriMeshData		*geomData = theState->geomData;
+	TQ3Point3D					triPoints[3], hitXYZ;
+	TQ3Uns32					n, vertIndex;
+	TQ3Param3D					theHit;
+
+
+
+	// Find the world coordinates of the triangle
+	for (n = 0; n < 3; n++)
+		{
+		vertIndex = geomData->triangles[theIndex].pointIndices[n];
+		Q3_ASSERT(vertIndex < geomData->numPoints);
+
+		if (theState->worldPoints != NULL)
+			triPoints[n] = theState->worldPoints[vertIndex];
+		else
+			Q3Point3D_Transform(&geomData->points[vertIndex], theState->localToWorld, &triPoints[n]);
+		}
+
+
+
+	// Pick the triangle
+	if (!E3Ray3D_IntersectTriangle(theState->worldRay, &triPoints[0], &triPoints[1], &triPoints[2],
+									theState->cullBackface, &theHit))
+		return(true);
+
+
+
+	// Record the hit, or remember it if it's the nearest so far
+	if (!theState->nearestOnly)
+		{
+		theState->qd3dStatus = e3geom_trimesh_record_ray_hit(theState, theIndex, &theHit);
+		return(theState->qd3dStatus == kQ3Success);
+		}
+
+	if (theHit.w <= ioMaxT)
+		{
+		hitXYZ.x = theState->worldRay->origin.x + theHit.w * theState->worldRay->direction.x;
+		hitXYZ.y = theState->worldRay->origin.y + theHit.w * theState->worldRay->direction.y;
+		hitXYZ.z = theState->worldRay->origin.z + theHit.w * theState->worldRay->direction.z;
+
+		if (!E3Pick_IsHitNearerThanHither(theState->thePick, theState->theView, &hitXYZ))
+			{
+			theState->nearestIndex = theIndex;
+			theState->nearestHit   = theHit;
+			ioMaxT                 = theHit.w;
+			}
+		}
+
+	return(true);
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_trimesh_pick_with_ray : TriMesh ray picking method.
 //-----------------------------------------------------------------------------
+//		Note :	If we have a BVH, the ray is transformed to local coordinates
+//				to walk the tree. The local ray direction is not normalized,
+//				so that its parameter matches that of the world ray.
+//
+//				A projective local to world transform does not map the ray to
+//				a straight line with the same parameter, so in that case we
+//				test every triangle in world coordinates.
+//
+//				If only the nearest hit is wanted, we start from the limit set
+//				by the nearest hit the pick has already recorded, so that
+//				anything behind it is skipped.
+//-----------------------------------------------------------------------------
 static TQ3Status
 e3geom_trimesh_pick_with_ray(TQ3ViewObject				theView,
 								TQ3PickObject			thePick,
 								const TQ3Ray3D			*theRay,
-								const TQ3TriMeshData	*geomData)
-{	TQ3Uns32						n, numPoints, v0, v1, v2;
-	TQ3Boolean						haveUV, cullBackface;
-	TQ3Param2D						hitUV, *resultUV;
+								const TQ3TriMeshData	*geomData,
+								const E3TriMeshBVH		*pickTree)
+{	TQ3Matrix4x4					worldToLocal;
+	TQ3TriMeshRayPickState			theState;
 	TQ3BackfacingStyle				backfacingStyle;
-	TQ3TriangleData					worldTriangle;
-	TQ3Point3D						*worldPoints;
-	TQ3Status						qd3dStatus;
-	TQ3Vector3D						hitNormal;
-	TQ3Point3D						hitXYZ;
-	TQ3Param3D						theHit;
+	TQ3Point3D						*worldPoints = NULL;
+	TQ3Ray3D						localRay;
+	TQ3Uns32						n;
+	float							maxT;
 
 
 
-	// Transform our points
-	numPoints   = geomData->numPoints;
-	worldPoints = (TQ3Point3D *) Q3Memory_Allocate(static_cast<TQ3Uns32>(numPoints * sizeof(TQ3Point3D)));
-	if (worldPoints == NULL)
-		return(kQ3Failure);
+	// Set up our state
+	theState.theView      = theView;
+	theState.thePick      = thePick;
+	theState.geomData     = geomData;
+	theState.localToWorld = E3View_State_GetMatrixLocalToWorld(theView);
+	theState.worldRay     = theRay;
+	theState.worldPoints  = NULL;
+	theState.nearestOnly  = E3Pick_IsNearestHitOnly(thePick);
+	theState.nearestIndex = kQ3ArrayIndexNULL;
+	theState.qd3dStatus   = kQ3Success;
 
-	Q3Point3D_To3DTransformArray(geomData->points,
-								 E3View_State_GetMatrixLocalToWorld(theView),
-								 worldPoints,
-								 numPoints,
-								 sizeof(TQ3Point3D),
-								 sizeof(TQ3Point3D));
+	maxT = kQ3MaxFloat;
+	if (theState.nearestOnly)
+		maxT = E3Pick_GetNearestHitRayLimit(thePick, theView, theRay);
 
 
 
 	// Determine if we should cull back-facing triangles or not
-	qd3dStatus   = E3View_GetBackfacingStyleState(theView, &backfacingStyle);
-	cullBackface = (TQ3Boolean)(qd3dStatus == kQ3Success && backfacingStyle == kQ3BackfacingStyleRemove);
+	theState.cullBackface = (TQ3Boolean)(E3View_GetBackfacingStyleState(theView, &backfacingStyle) == kQ3Success &&
+										 backfacingStyle == kQ3BackfacingStyleRemove);
+
+
+
+	// We can't use the tree if the local to world transform is projective, or
+	// can't be inverted
+	if (pickTree != NULL && E3View_State_GetMatrixLocalToWorldKind(theView) == kQ3MatrixKindGeneral)
+		pickTree = NULL;
+
+	if (pickTree != NULL && fabsf(Q3Matrix4x4_Determinant(theState.localToWorld)) < kQ3RealZero)
+		pickTree = NULL;
 
 
 
@@ -993,50 +1258,52 @@ e3geom_trimesh_pick_with_ray(TQ3ViewObject				theView,
 	//
 	// Note we do not use any vertex/edge tolerances supplied for the pick, since
 	// QD3D's blue book appears to suggest neither are used for triangles.
-	for (n = 0; n < geomData->numTriangles && qd3dStatus == kQ3Success; n++)
+	if (pickTree != NULL)
 		{
-		// Grab the vertex indicies
-		v0 = geomData->triangles[n].pointIndices[0];
-		v1 = geomData->triangles[n].pointIndices[1];
-		v2 = geomData->triangles[n].pointIndices[2];
-		Q3_ASSERT(v0 >= 0 && v0 < geomData->numPoints);
-		Q3_ASSERT(v1 >= 0 && v1 < geomData->numPoints);
-		Q3_ASSERT(v2 >= 0 && v2 < geomData->numPoints);
+		Q3Matrix4x4_Invert(theState.localToWorld, &worldToLocal);
+		Q3Point3D_Transform( &theRay->origin,    &worldToLocal, &localRay.origin);
+		Q3Vector3D_Transform(&theRay->direction, &worldToLocal, &localRay.direction);
 
+		pickTree->FindRayTriangles(localRay, maxT, e3geom_trimesh_pick_ray_triangle, &theState);
+		}
+	else
+		{
+		// Transform our points
+		worldPoints = (TQ3Point3D *) Q3Memory_Allocate(static_cast<TQ3Uns32>(geomData->numPoints * sizeof(TQ3Point3D)));
+		if (worldPoints == NULL)
+			return(kQ3Failure);
 
+		Q3Point3D_To3DTransformArray(geomData->points,
+									 theState.localToWorld,
+									 worldPoints,
+									 geomData->numPoints,
+									 sizeof(TQ3Point3D),
+									 sizeof(TQ3Point3D));
 
-		// Pick the triangle
-		if (E3Ray3D_IntersectTriangle(theRay, &worldPoints[v0], &worldPoints[v1], &worldPoints[v2], cullBackface, &theHit))
-			{
-			// Create the triangle, and update the vertices to the transformed coordinates
-			e3geom_trimesh_triangle_new(theView, geomData, n, &worldTriangle);
-			worldTriangle.vertices[0].point = worldPoints[v0];
-			worldTriangle.vertices[1].point = worldPoints[v1];
-			worldTriangle.vertices[2].point = worldPoints[v2];
+		theState.worldPoints = worldPoints;
 
 
-			// Obtain the XYZ, normal, and UV for the hit point. We always return an
-			// XYZ and normal for the hit, however we need to cope with missing UVs.
-			E3Triangle_InterpolateHit(theView,&worldTriangle, &theHit, &hitXYZ, &hitNormal, &hitUV, &haveUV);
-			resultUV = (haveUV ? &hitUV : NULL);
 
+		// Test every triangle
+		for (n = 0; n < geomData->numTriangles; n++)
+			{
+			if (!e3geom_trimesh_pick_ray_triangle(n, &theState, maxT))
+				break;
+			}
+		}
 
-			// Record the hit
-			qd3dStatus = E3Pick_RecordHit(thePick, theView, &hitXYZ, &hitNormal,
-				resultUV, NULL, &theHit, n );
 
 
-			// Clean up
-			e3geom_trimesh_triangle_delete(&worldTriangle);
-			}
-		}
+	// Record the nearest hit if that's all we wanted
+	if (theState.nearestIndex != kQ3ArrayIndexNULL)
+		theState.qd3dStatus = e3geom_trimesh_record_ray_hit(&theState, theState.nearestIndex, &theState.nearestHit);
 
 
 
 	// Clean up
 	Q3Memory_Free(&worldPoints);
 
-	return(qd3dStatus);			
+	return(theState.qd3dStatus);
 }
 
 
@@ -1124,6 +1391,62 @@ e3geom_trimesh_find_triangle_point_in_area( const TQ3Area& inRect,
 
 
 
+//=============================================================================
+//      e3geom_trimesh_pick_rect_triangle : Test the pick rect against a triangle.
+//-----------------------------------------------------------------------------
+//		Note :	Invoked for each candidate triangle. A rect pick records at
+//				most one hit per TriMesh, on the lowest numbered triangle in
+//				the rect, so we remember that triangle and skip any triangle
+//				numbered above it.
+//
+//				The BVH supplies candidates in tree order rather than index
+//				order, so we only stop early when scanning every triangle.
+//-----------------------------------------------------------------------------
+static bool
+e3geom_trimesh_pick_rect_triangle(TQ3Uns32 theIndex, void *userData, float &ioMaxT)
+{	TQ3TriMeshRectPickState		*theState = (TQ3TriMeshRectPickState *) userData;
+	const TQ3TriMeshData		*geomData = theState->geomData;
+	TQ3Point3D					triPoints[3], windowHitPt;
+	TQ3Uns32					n, vertIndex;
+#pragma unused(ioMaxT)
+
+
+
+	// Skip triangles after the one we've already found
+	if (theIndex >= theState->hitIndex)
+		return(true);
+
+
+
+	// Find the window coordinates of the triangle
+	for (n = 0; n < 3; n++)
+		{
+		vertIndex = geomData->triangles[theIndex].pointIndices[n];
+		Q3_ASSERT(vertIndex < geomData->numPoints);
+
+		if (theState->windowPoints != NULL)
+			triPoints[n] = theState->windowPoints[vertIndex];
+		else
+			Q3Point3D_Transform(&geomData->points[vertIndex], theState->localToWindow, &triPoints[n]);
+		}
+
+
+
+	// See if this triangle falls within the pick
+	if (!e3geom_trimesh_find_triangle_point_in_area( *theState->theRect, triPoints[0],
+		triPoints[1], triPoints[2], windowHitPt ))
+		return(true);
+
+	theState->hitIndex    = theIndex;
+	theState->windowHitPt = windowHitPt;
+
+	return(theState->windowPoints == NULL);
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_trimesh_pick_with_rect : TriMesh rect picking method.
 //-----------------------------------------------------------------------------
@@ -1131,76 +1454,84 @@ static TQ3Status
 e3geom_trimesh_pick_with_rect(TQ3ViewObject				theView,
 								TQ3PickObject			thePick,
 								const TQ3Area			*theRect,
-								const TQ3TriMeshData	*geomData)
-{	TQ3Matrix4x4		worldToFrustum, frustumToWindow, worldToWindow, localToWindow;
-	TQ3Uns32			n, numPoints, v0, v1, v2;
-	TQ3Point2D			triVertices[3];
-	TQ3Point3D			*windowPoints;
-	TQ3Status			qd3dStatus;
-
+								const TQ3TriMeshData	*geomData,
+								const E3TriMeshBVH		*pickTree)
+{	TQ3Matrix4x4				worldToFrustum, frustumToWindow, worldToWindow, localToWindow, windowToWorld;
+	TQ3TriMeshRectPickState		theState;
+	TQ3Point3D					*windowPoints = NULL;
+	TQ3Point3D					worldHitPt;
+	TQ3Status					qd3dStatus;
+	TQ3Uns32					n;
+	float						maxT;
 
 
-	// Transform our points from local coordinates to window coordinates
-	numPoints    = geomData->numPoints;
-	windowPoints = (TQ3Point3D *) Q3Memory_Allocate(static_cast<TQ3Uns32>(numPoints * sizeof(TQ3Point3D)));
-	if (windowPoints == NULL)
-		return(kQ3Failure);
 
+	// Find the local to window transform
 	Q3View_GetWorldToFrustumMatrixState(theView,  &worldToFrustum);
 	Q3View_GetFrustumToWindowMatrixState(theView, &frustumToWindow);
 	Q3Matrix4x4_Multiply( &worldToFrustum, &frustumToWindow, &worldToWindow );
 	Q3Matrix4x4_Multiply(E3View_State_GetMatrixLocalToWorld(theView), &worldToWindow, &localToWindow);
 
-	Q3Point3D_To3DTransformArray(geomData->points, &localToWindow, windowPoints,
-		numPoints, sizeof(TQ3Point3D), sizeof(TQ3Point3D));
+
+
+	// Set up our state
+	theState.theView       = theView;
+	theState.thePick       = thePick;
+	theState.geomData      = geomData;
+	theState.localToWindow = &localToWindow;
+	theState.worldToWindow = &worldToWindow;
+	theState.theRect       = theRect;
+	theState.windowPoints  = NULL;
+	theState.hitIndex      = kQ3ArrayIndexNULL;
 
 
 
 	// See if we fall within the pick
-	qd3dStatus = kQ3Success;
+	if (pickTree != NULL)
+		pickTree->FindAreaTriangles(localToWindow, *theRect, e3geom_trimesh_pick_rect_triangle, &theState);
 
-	for (n = 0; n < geomData->numTriangles && qd3dStatus == kQ3Success; n++)
+	else
 		{
-		// Grab the vertex indices
-		v0 = geomData->triangles[n].pointIndices[0];
-		v1 = geomData->triangles[n].pointIndices[1];
-		v2 = geomData->triangles[n].pointIndices[2];
-		Q3_ASSERT(v0 >= 0 && v0 < geomData->numPoints);
-		Q3_ASSERT(v1 >= 0 && v1 < geomData->numPoints);
-		Q3_ASSERT(v2 >= 0 && v2 < geomData->numPoints);
-
+		// Transform our points from local coordinates to window coordinates
+		windowPoints = (TQ3Point3D *) Q3Memory_Allocate(static_cast<TQ3Uns32>(geomData->numPoints * sizeof(TQ3Point3D)));
+		if (windowPoints == NULL)
+			return(kQ3Failure);
 
-		// Set up the 2D component of the triangle
-		triVertices[0].x = windowPoints[v0].x;
-		triVertices[0].y = windowPoints[v0].y;
+		Q3Point3D_To3DTransformArray(geomData->points, &localToWindow, windowPoints,
+			geomData->numPoints, sizeof(TQ3Point3D), sizeof(TQ3Point3D));
 
-		triVertices[1].x = windowPoints[v1].x;
-		triVertices[1].y = windowPoints[v1].y;
+		theState.windowPoints = windowPoints;
 
-		triVertices[2].x = windowPoints[v2].x;
-		triVertices[2].y = windowPoints[v2].y;
 
 
-		// See if this triangle falls within the pick
-		TQ3Point3D	windowHitPt;
-		if (e3geom_trimesh_find_triangle_point_in_area( *theRect, windowPoints[v0],
-			windowPoints[v1], windowPoints[v2], windowHitPt ))
+		// Test every triangle
+		maxT = kQ3MaxFloat;
+		for (n = 0; n < geomData->numTriangles; n++)
 			{
-			TQ3Matrix4x4	windowToWorld;
-			Q3Matrix4x4_Invert( &worldToWindow, &windowToWorld );
-			TQ3Point3D		worldHitPt;
-			Q3Point3D_Transform( &windowHitPt, &windowToWorld, &worldHitPt );
-			qd3dStatus = E3Pick_RecordHit(thePick, theView, &worldHitPt, NULL,
-				NULL, NULL, NULL, n);
-			break;
+			if (!e3geom_trimesh_pick_rect_triangle(n, &theState, maxT))
+				break;
 			}
 		}
 
 
+
+	// Record the hit, if any
+	qd3dStatus = kQ3Success;
+
+	if (theState.hitIndex != kQ3ArrayIndexNULL)
+		{
+		Q3Matrix4x4_Invert( &worldToWindow, &windowToWorld );
+		Q3Point3D_Transform( &theState.windowHitPt, &windowToWorld, &worldHitPt );
+		qd3dStatus = E3Pick_RecordHit(thePick, theView, &worldHitPt, NULL,
+			NULL, NULL, NULL, theState.hitIndex);
+		}
+
+
+
 	// Clean up
 	Q3Memory_Free(&windowPoints);
 
-	return(qd3dStatus);			
+	return(qd3dStatus);
 }
 
 
@@ -1245,7 +1576,8 @@ e3geom_trimesh_pick_screen_bounds(TQ3ViewObject theView, const TQ3TriMeshData *g
 //      e3geom_trimesh_pick_window_point : TriMesh window-point picking method.
 //-----------------------------------------------------------------------------
 static TQ3Status
-e3geom_trimesh_pick_window_point(TQ3ViewObject theView, TQ3PickObject thePick, const TQ3TriMeshData *geomData)
+e3geom_trimesh_pick_window_point(TQ3ViewObject theView, TQ3PickObject thePick,
+								 const TQ3TriMeshData *geomData, const E3TriMeshBVH *pickTree)
 {	TQ3BoundingBox				worldBounds;
 	TQ3Point3D					corners[8];
 	TQ3Status					qd3dStatus;
@@ -1272,7 +1604,7 @@ e3geom_trimesh_pick_window_point(TQ3ViewObject theView, TQ3PickObject thePick, c
 	// If it does, we proceed to the actual triangle-level hit test.
 	E3View_GetRayThroughPickPoint(theView, &theRay);
 	if (E3Ray3D_IntersectBoundingBox(&theRay, &worldBounds, NULL))
-		qd3dStatus = e3geom_trimesh_pick_with_ray(theView, thePick, &theRay, geomData);
+		qd3dStatus = e3geom_trimesh_pick_with_ray(theView, thePick, &theRay, geomData, pickTree);
 	else
 		qd3dStatus = kQ3Success;
 
@@ -1306,7 +1638,8 @@ e3geom_trimesh_record_any_xyz( TQ3ViewObject theView, TQ3PickObject thePick,
 //      e3geom_trimesh_pick_window_rect : TriMesh window-rect picking method.
 //-----------------------------------------------------------------------------
 static TQ3Status
-e3geom_trimesh_pick_window_rect(TQ3ViewObject theView, TQ3PickObject thePick, const TQ3TriMeshData *geomData)
+e3geom_trimesh_pick_window_rect(TQ3ViewObject theView, TQ3PickObject thePick,
+								const TQ3TriMeshData *geomData, const E3TriMeshBVH *pickTree)
 {	TQ3Area						windowBounds;
 	TQ3Status					qd3dStatus = kQ3Success;
 	TQ3WindowRectPickData		pickData;
@@ -1328,7 +1661,7 @@ e3geom_trimesh_pick_window_rect(TQ3ViewObject theView, TQ3PickObject thePick, co
 		e3geom_trimesh_record_any_xyz( theView, thePick, *geomData );
 
 	else if (E3Rect_IntersectRect(&windowBounds, &pickData.rect))
-		qd3dStatus = e3geom_trimesh_pick_with_rect(theView, thePick, &pickData.rect, geomData);
+		qd3dStatus = e3geom_trimesh_pick_with_rect(theView, thePick, &pickData.rect, geomData, pickTree);
 
 	return(qd3dStatus);
 }
@@ -1341,7 +1674,8 @@ e3geom_trimesh_pick_window_rect(TQ3ViewObject theView, TQ3PickObject thePick, co
 //      e3geom_trimesh_pick_world_ray : TriMesh world-ray picking method.
 //-----------------------------------------------------------------------------
 static TQ3Status
-e3geom_trimesh_pick_world_ray(TQ3ViewObject theView, TQ3PickObject thePick, const TQ3TriMeshData *geomData)
+e3geom_trimesh_pick_world_ray(TQ3ViewObject theView, TQ3PickObject thePick,
+							  const TQ3TriMeshData *geomData, const E3TriMeshBVH *pickTree)
 {
 	TQ3BoundingBox				worldBounds;
 	TQ3Status					qd3dStatus;
@@ -1374,7 +1708,7 @@ e3geom_trimesh_pick_world_ray(TQ3ViewObject theView, TQ3PickObject thePick, cons
 
 	// See if we fall within the pick
 	if (Q3Ray3D_IntersectBoundingBox(&pickData.ray, &worldBounds, &hitHYZ))
-		qd3dStatus = e3geom_trimesh_pick_with_ray(theView, thePick, &pickData.ray, geomData);
+		qd3dStatus = e3geom_trimesh_pick_with_ray(theView, thePick, &pickData.ray, geomData, pickTree);
 	else
 		qd3dStatus = kQ3Success;
 
@@ -1394,29 +1728,32 @@ e3geom_trimesh_pick(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Object t
 #pragma unused( objectType )
 	TQ3Status				qd3dStatus;
 	const TQ3TriMeshData	*geomData;
+	const E3TriMeshBVH		*pickTree;
 	TQ3PickObject			thePick;
 
 
 
-	// Get the geometry data
+	// Get the geometry data, and the BVH if we can use one
 	geomData = e3geom_trimesh_get_geom_data(theObject, objectData);
 	Q3_ASSERT(geomData->bBox.isEmpty == kQ3False);
 
+	pickTree = e3geom_trimesh_get_pick_tree(theObject, objectData);
+
 
 
 	// Handle the pick
 	thePick = E3View_AccessPick(theView);
 	switch (Q3Pick_GetType(thePick)) {
 		case kQ3PickTypeWindowPoint:
-			qd3dStatus = e3geom_trimesh_pick_window_point(theView, thePick, geomData);
+			qd3dStatus = e3geom_trimesh_pick_window_point(theView, thePick, geomData, pickTree);
 			break;
 
 		case kQ3PickTypeWindowRect:
-			qd3dStatus = e3geom_trimesh_pick_window_rect(theView, thePick, geomData);
+			qd3dStatus = e3geom_trimesh_pick_window_rect(theView, thePick, geomData, pickTree);
 			break;
 
 		case kQ3PickTypeWorldRay:
-			qd3dStatus = e3geom_trimesh_pick_world_ray(theView, thePick, geomData);
+			qd3dStatus = e3geom_trimesh_pick_world_ray(theView, thePick, geomData, pickTree);
 			break;
 
 		default:
@@ -1506,6 +1843,246 @@ e3geom_trimesh_get_public_data ( E3TriMesh* triMesh )
 
 
 
+//=============================================================================
+//      e3geom_trimesh_scratch_set_new : Create a scratch attribute set.
+//-----------------------------------------------------------------------------
+//		Note :	Scratch sets are reused for every triangle we submit, so the
+//				attributes they hold are overwritten in place each time.
+//-----------------------------------------------------------------------------
+static TQ3AttributeSet
+e3geom_trimesh_scratch_set_new(TQ3AttributeSet parentSet)
+{	TQ3AttributeSet		theSet;
+
+
+
+	// Create the set, and inherit from the parent if we have one
+	theSet = Q3AttributeSet_New();
+	if (theSet != NULL && parentSet != NULL)
+		Q3AttributeSet_Inherit(parentSet, theSet, theSet);
+	
+	return(theSet);
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_trimesh_scratch_set_release : Prepare a scratch set for reuse.
+//-----------------------------------------------------------------------------
+//		Note :	If a renderer has kept a reference to one of our scratch sets,
+//				we must not modify it any further - so we hand it over to the
+//				renderer and start again with a fresh set.
+//-----------------------------------------------------------------------------
+static void
+e3geom_trimesh_scratch_set_release(TQ3AttributeSet *theSet, TQ3AttributeSet parentSet)
+{
+
+
+	// Replace the set if it's now shared
+	if (*theSet != NULL && Q3Shared_GetReferenceCount(*theSet) > 1)
+		{
+		Q3Object_Dispose(*theSet);
+		*theSet = e3geom_trimesh_scratch_set_new(parentSet);
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_trimesh_resolve_attributes : Resolve TriMesh attribute arrays.
+//-----------------------------------------------------------------------------
+//		Note :	Attributes whose class is not registered are skipped, as they
+//				would be by our cached form. May throw std::bad_alloc.
+//-----------------------------------------------------------------------------
+static void
+e3geom_trimesh_resolve_attributes(TQ3Uns32 numAttributeTypes, const TQ3TriMeshAttributeData *attributeTypes,
+									std::vector<TQ3TriMeshAttributeSource> &theSources)
+{	TQ3TriMeshAttributeSource	theSource;
+	E3ClassInfoPtr				theClass;
+	TQ3Uns32					n;
+
+
+
+	// Look up the class of each attribute
+	theSources.reserve(numAttributeTypes);
+	
+	for (n = 0; n < numAttributeTypes; n++)
+		{
+		theSource.attrType = E3Attribute_AttributeToClassType(attributeTypes[n].attributeType);
+		theClass           = E3ClassTree::GetClass ( theSource.attrType ) ;
+		if (theClass != NULL)
+			{
+			theSource.attrSize = theClass->GetInstanceSize () ;
+			theSource.attrData = (const TQ3Uns8 *) attributeTypes[n].data;
+			theSources.push_back(theSource);
+			}
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      e3geom_trimesh_submit_decomposed : TriMesh submit decomposed method.
+//-----------------------------------------------------------------------------
+//		Note :	Submits the TriMesh as a sequence of immediate mode triangles,
+//				built on the stack from the TriMesh arrays.
+//
+//				This produces the same triangles as our cached form, but rather
+//				than creating a Triangle object and attribute set for each one,
+//				we reuse a single triangle attribute set (and one set for each
+//				vertex) for the entire mesh. Q3XAttributeSet_GetPointer documents
+//				what this means for renderers which look at the attributes.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3geom_trimesh_submit_decomposed(TQ3ViewObject theView, TQ3GeometryObject theGeom,
+								const void *objectData)
+{	std::vector<TQ3TriMeshAttributeSource>	triAttrs, vertAttrs;
+	TQ3Uns32								n, m, i, vertIndex;
+	TQ3Boolean								needsNormal, isClockwise;
+	const TQ3TriMeshData					*geomData;
+	TQ3TriangleData							triangleData;
+	TQ3Status								qd3dStatus;
+	TQ3Vector3D								theNormal;
+
+
+
+	// Access the TriMesh data
+	geomData = e3geom_trimesh_get_geom_data( theGeom, objectData );
+
+	if (geomData->numTriangles == 0)
+		return(kQ3Success);
+
+
+
+	// Resolve the attribute types and sizes once, rather than per triangle
+	try
+		{
+		e3geom_trimesh_resolve_attributes(geomData->numTriangleAttributeTypes,
+										  geomData->triangleAttributeTypes, triAttrs);
+		e3geom_trimesh_resolve_attributes(geomData->numVertexAttributeTypes,
+										  geomData->vertexAttributeTypes, vertAttrs);
+		}
+	catch (const std::bad_alloc&)
+		{
+		E3ErrorManager_PostError( kQ3ErrorOutOfMemory, kQ3False );
+		return(kQ3Failure);
+		}
+
+
+
+	// Set up the scratch attribute sets
+	//
+	// As with our cached form, triangles always have an attribute set so that they
+	// can carry a triangle normal for backface culling.
+	Q3Memory_Clear(&triangleData, sizeof(triangleData));
+
+	triangleData.triangleAttributeSet = e3geom_trimesh_scratch_set_new(geomData->triMeshAttributeSet);
+	if (triangleData.triangleAttributeSet == NULL)
+		return(kQ3Failure);
+
+	if (geomData->numVertexAttributeTypes != 0)
+		{
+		Q3_ASSERT(Q3_VALID_PTR(geomData->vertexAttributeTypes));
+		for (n = 0; n < 3; n++)
+			triangleData.vertices[n].attributeSet = e3geom_trimesh_scratch_set_new(NULL);
+		}
+
+
+
+	// Decide if we need to calculate triangle normals
+	//
+	// Since the scratch set is reused, we can't test it for a normal on each triangle:
+	// instead we check the attributes that each triangle would have started with.
+	needsNormal = (TQ3Boolean) (!Q3AttributeSet_Contains(triangleData.triangleAttributeSet, kQ3AttributeTypeNormal));
+	for (m = 0; m < triAttrs.size() && needsNormal; m++)
+		{
+		if (triAttrs[m].attrType == E3Attribute_AttributeToClassType(kQ3AttributeTypeNormal))
+			needsNormal = kQ3False;
+		}
+
+	isClockwise = (TQ3Boolean) (E3View_State_GetStyleOrientation(theView) == kQ3OrientationStyleClockwise);
+
+
+
+	// Submit the triangles
+	qd3dStatus = kQ3Success;
+	
+	for (n = 0; n < geomData->numTriangles && qd3dStatus == kQ3Success; n++)
+		{
+		const TQ3TriMeshTriangleData&	theIndices = geomData->triangles[n];
+
+
+		// Update the triangle attributes
+		if (triangleData.triangleAttributeSet != NULL)
+			{
+			for (m = 0; m < triAttrs.size(); m++)
+				Q3AttributeSet_Add(triangleData.triangleAttributeSet, triAttrs[m].attrType,
+									triAttrs[m].attrData + (n * triAttrs[m].attrSize));
+
+
+			// Calculate the triangle normal
+			//
+			// We can find the normal for a CCW triangle with Q3Point3D_CrossProductTri,
+			// and reverse it if the current orientation style says the triangle is CW.
+			if (needsNormal)
+				{
+				Q3Point3D_CrossProductTri(&geomData->points[theIndices.pointIndices[0]],
+										  &geomData->points[theIndices.pointIndices[1]],
+										  &geomData->points[theIndices.pointIndices[2]],
+										  &theNormal);
+				Q3Vector3D_Normalize(&theNormal, &theNormal);
+
+				if (isClockwise)
+					Q3Vector3D_Negate(&theNormal, &theNormal);
+
+				Q3AttributeSet_Add(triangleData.triangleAttributeSet, kQ3AttributeTypeNormal, &theNormal);
+				}
+			}
+
+
+		// Update the vertices
+		for (i = 0; i < 3; i++)
+			{
+			vertIndex = theIndices.pointIndices[i];
+			triangleData.vertices[i].point = geomData->points[vertIndex];
+			
+			if (triangleData.vertices[i].attributeSet != NULL)
+				{
+				for (m = 0; m < vertAttrs.size(); m++)
+					Q3AttributeSet_Add(triangleData.vertices[i].attributeSet, vertAttrs[m].attrType,
+										vertAttrs[m].attrData + (vertIndex * vertAttrs[m].attrSize));
+				}
+			}
+
+
+		// Submit the triangle
+		qd3dStatus = E3View_SubmitImmediate(theView, kQ3GeometryTypeTriangle, &triangleData);
+
+
+		// Make sure our scratch sets can still be modified
+		e3geom_trimesh_scratch_set_release(&triangleData.triangleAttributeSet, geomData->triMeshAttributeSet);
+
+		for (i = 0; i < 3; i++)
+			e3geom_trimesh_scratch_set_release(&triangleData.vertices[i].attributeSet, NULL);
+		}
+
+
+
+	// Clean up
+	e3geom_trimesh_triangle_delete(&triangleData);
+	
+	return(qd3dStatus);
+}
+
+
+
+
+
 //=============================================================================
 //      e3geom_trimesh_metahandler : TriMesh metahandler.
 //-----------------------------------------------------------------------------
@@ -1533,6 +2110,10 @@ e3geom_trimesh_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) e3geom_trimesh_cache_new;
 			break;
 
+		case kQ3XMethodTypeGeomSubmitDecomposed:
+			theMethod = (TQ3XFunctionPointer) e3geom_trimesh_submit_decomposed;
+			break;
+
 		case kQ3XMethodTypeObjectSubmitPick:
 			theMethod = (TQ3XFunctionPointer) e3geom_trimesh_pick;
 			break;
@@ -1672,6 +2253,7 @@ E3TriMesh_SetData(TQ3GeometryObject theTriMesh, const TQ3TriMeshData *triMeshDat
 
 	// Dispose of the existing data
 	e3geom_trimesh_disposedata ( & triMesh->instanceData.geomData ) ;
+	E3TriMeshBVH_Dispose ( triMesh->instanceData.pickTree ) ;
 
 
 
@@ -1755,17 +2337,23 @@ E3TriMesh_LockData(TQ3GeometryObject theTriMesh, TQ3Boolean readOnly, TQ3TriMesh
 	
 	
 	
+	// Lock the TriMesh
+	//
+	// Several threads may hold read-only locks at once, so the count and the
+	// read-only flag are only changed with the count locked.
+	{
+	E3SpinLocker theLocker ( triMesh->instanceData.lockCountLock ) ;
+	
+	
 	// If the TriMesh was already locked,
 	// then this lock had better be read-only, lest the code that did the outer
 	// lock gets confused.
 	Q3_ASSERT( (triMesh->instanceData.lockCount == 0) || readOnly );
 	
-
-
-	// Lock the TriMesh
 	if ( readOnly && (triMesh->instanceData.lockCount == 0) )
 		E3Bit_Set( triMesh->instanceData.theFlags, kTriMeshLockedReadOnly ) ;
 	triMesh->instanceData.lockCount += 1;
+	}
 
 
 
@@ -1791,25 +2379,35 @@ E3TriMesh_UnlockData(TQ3GeometryObject theTriMesh)
 
 	
 	// Unlock the TriMesh
+	//
+	// The last lock to be released clears the read-only flag, and if the TriMesh
+	// was not locked read-only then it has been edited.
+	TQ3Boolean wasEdited = kQ3False ;
+	{
+	E3SpinLocker theLocker ( triMesh->instanceData.lockCountLock ) ;
+
 	triMesh->instanceData.lockCount -= 1;
 	if (triMesh->instanceData.lockCount == 0)
 	{
-		// If the TriMesh was mutable, assume it needs updating
-		if ( ! E3Bit_IsSet( triMesh->instanceData.theFlags, kTriMeshLockedReadOnly ) )
-		{
-			theStatus = e3geom_trimesh_validate( &triMesh->instanceData.geomData );
-		
-			// Re-optimize the TriMesh
-			e3geom_trimesh_optimize ( & triMesh->instanceData.geomData ) ;
+		wasEdited = (TQ3Boolean) ! E3Bit_IsSet( triMesh->instanceData.theFlags, kTriMeshLockedReadOnly ) ;
+		E3Bit_Clear( triMesh->instanceData.theFlags, kTriMeshLockedReadOnly ) ;
+	}
+	}
 
 
-			// Bump the edit index
-			Q3Shared_Edited ( triMesh ) ;
-		}
 
+	// If the TriMesh was mutable, assume it needs updating
+	if ( wasEdited )
+	{
+		theStatus = e3geom_trimesh_validate( &triMesh->instanceData.geomData );
+	
+		// Re-optimize the TriMesh, and discard the pick tree
+		e3geom_trimesh_optimize ( & triMesh->instanceData.geomData ) ;
+		E3TriMeshBVH_Dispose ( triMesh->instanceData.pickTree ) ;
 
 
-		E3Bit_Clear( triMesh->instanceData.theFlags, kTriMeshLockedReadOnly ) ;
+		// Bump the edit index
+		Q3Shared_Edited ( triMesh ) ;
 	}
 
 	return theStatus;
@@ -0,0 +1,548 @@
+/*  NAME:
+        E3GeometryTriMeshBVH.cpp
+
+    DESCRIPTION:
+        Bounding volume hierarchy used to accelerate TriMesh picking.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "E3Prefix.h"
+#include "E3GeometryTriMeshBVH.h"
+#include "E3ErrorManager.h"
+
+#include <algorithm>
+#include <new>
+
+/*
+	DISCUSSION
+	
+	The hierarchy is stored as a flat array of nodes in depth-first order, so
+	the left child of an interior node always immediately follows it and only
+	the index of the right child needs to be stored. Leaves refer to a run of
+	entries in mTriangles, which is a permutation of the triangle indices of
+	the TriMesh.
+	
+	Nodes are split at the median centroid along the longest axis of the
+	centroid bounds. This is not as tight as a surface area heuristic, but it
+	is O(n log n) to build, guarantees a depth of O(log n), and is quick enough
+	that the tree can be rebuilt lazily the first time a TriMesh is picked
+	after an edit.
+*/
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+namespace
+{
+	// Leaves hold at most this many triangles
+	const TQ3Uns32		kMaxLeafTriangles			= 8;
+
+	// Traversal stack size, which must exceed the maximum tree depth
+	const TQ3Uns32		kMaxStackDepth				= 64;
+}
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+namespace
+{
+	struct CompareCentroids
+	{
+						CompareCentroids( const std::vector<TQ3Point3D>& inCentroids,
+											int inAxis )
+							: mCentroids( inCentroids )
+							, mAxis( inAxis ) {}
+		
+		bool			operator()( TQ3Uns32 inOne, TQ3Uns32 inTwo ) const
+						{
+							return (&mCentroids[ inOne ].x)[ mAxis ] <
+								(&mCentroids[ inTwo ].x)[ mAxis ];
+						}
+
+		const std::vector<TQ3Point3D>&	mCentroids;
+		int								mAxis;
+	};
+	
+	struct RayStackItem
+	{
+		TQ3Uns32		node;
+		float			tNear;
+	};
+}
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      e3bvh_ray_slab_inverse : Reciprocal of a ray direction component.
+//-----------------------------------------------------------------------------
+//		Note :	A zero component is mapped to a huge value rather than to
+//				infinity, so that a ray origin lying exactly on a slab plane
+//				does not produce a NaN in the slab test.
+//-----------------------------------------------------------------------------
+static inline float
+e3bvh_ray_slab_inverse( float inComponent )
+{
+	return (inComponent != 0.0f) ? (1.0f / inComponent) : kQ3MaxFloat;
+}
+
+
+
+
+
+//=============================================================================
+//      e3bvh_ray_hits_box : Slab test of a ray against a node's box.
+//-----------------------------------------------------------------------------
+//		Note :	Returns true if the ray meets the box at a parameter in the
+//				range [0, inMaxT], and returns the nearest such parameter.
+//-----------------------------------------------------------------------------
+static inline bool
+e3bvh_ray_hits_box( const float inMin[3], const float inMax[3],
+					const float inOrigin[3], const float inInvDir[3],
+					float inMaxT, float& outTNear )
+{
+	float	tNear = 0.0f;
+	float	tFar  = inMaxT;
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		float	t0 = (inMin[i] - inOrigin[i]) * inInvDir[i];
+		float	t1 = (inMax[i] - inOrigin[i]) * inInvDir[i];
+		
+		if (t0 > t1)
+			std::swap( t0, t1 );
+		
+		if (t0 > tNear)
+			tNear = t0;
+		
+		if (t1 < tFar)
+			tFar = t1;
+		
+		if (tNear > tFar)
+			return false;
+	}
+	
+	outTNear = tNear;
+	return true;
+}
+
+
+
+
+
+//=============================================================================
+//      e3bvh_box_overlaps_area : Test a node's box against a window area.
+//-----------------------------------------------------------------------------
+//		Note :	The test is conservative. If any corner of the box lies on or
+//				behind the eye plane its projection is meaningless, and so we
+//				report an overlap and let the triangle tests decide.
+//-----------------------------------------------------------------------------
+static bool
+e3bvh_box_overlaps_area( const float inMin[3], const float inMax[3],
+						const TQ3Matrix4x4& inLocalToWindow,
+						const TQ3Area& inArea )
+{
+	const float	(*m)[4] = inLocalToWindow.value;
+	float		minX = kQ3MaxFloat, minY = kQ3MaxFloat;
+	float		maxX = -kQ3MaxFloat, maxY = -kQ3MaxFloat;
+	
+	for (int n = 0; n < 8; ++n)
+	{
+		float	x = (n & 1) ? inMax[0] : inMin[0];
+		float	y = (n & 2) ? inMax[1] : inMin[1];
+		float	z = (n & 4) ? inMax[2] : inMin[2];
+		
+		float	w  = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+		if (w <= kQ3RealZero)
+			return true;
+		
+		float	invW = 1.0f / w;
+		float	wx = (x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0]) * invW;
+		float	wy = (x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1]) * invW;
+		
+		minX = std::min( minX, wx );
+		maxX = std::max( maxX, wx );
+		minY = std::min( minY, wy );
+		maxY = std::max( maxY, wy );
+	}
+	
+	return (maxX >= inArea.min.x) && (minX <= inArea.max.x) &&
+		(maxY >= inArea.min.y) && (minY <= inArea.max.y);
+}
+
+
+
+
+
+//=============================================================================
+//      Class methods
+//-----------------------------------------------------------------------------
+//      E3TriMeshBVH::E3TriMeshBVH : Build the hierarchy.
+//-----------------------------------------------------------------------------
+E3TriMeshBVH::E3TriMeshBVH( const TQ3TriMeshData& inData )
+{
+	const TQ3Uns32	numTriangles = inData.numTriangles;
+	
+	if (numTriangles == 0)
+		return;
+
+
+
+	// Find the triangle centroids
+	std::vector<TQ3Point3D>	centroids( numTriangles );
+	
+	mTriangles.resize( numTriangles );
+
+	for (TQ3Uns32 n = 0; n < numTriangles; ++n)
+	{
+		const TQ3Uns32*		pointIndices = inData.triangles[n].pointIndices;
+		const TQ3Point3D&	p0 = inData.points[ pointIndices[0] ];
+		const TQ3Point3D&	p1 = inData.points[ pointIndices[1] ];
+		const TQ3Point3D&	p2 = inData.points[ pointIndices[2] ];
+
+		centroids[n].x = (p0.x + p1.x + p2.x) * (1.0f / 3.0f);
+		centroids[n].y = (p0.y + p1.y + p2.y) * (1.0f / 3.0f);
+		centroids[n].z = (p0.z + p1.z + p2.z) * (1.0f / 3.0f);
+		
+		mTriangles[n] = n;
+	}
+
+
+
+	// Build the tree
+	mNodes.reserve( 2 * (numTriangles / kMaxLeafTriangles) + 1 );
+	mNodes.push_back( Node() );
+	
+	BuildNode( 0, 0, numTriangles, centroids, inData );
+}
+
+
+
+
+
+//=============================================================================
+//      E3TriMeshBVH::BuildNode : Build a node and its children.
+//-----------------------------------------------------------------------------
+void
+E3TriMeshBVH::BuildNode( TQ3Uns32 inNodeIndex, TQ3Uns32 inFirst, TQ3Uns32 inCount,
+						const std::vector<TQ3Point3D>& inCentroids,
+						const TQ3TriMeshData& inData )
+{
+	float	boxMin[3]      = {  kQ3MaxFloat,  kQ3MaxFloat,  kQ3MaxFloat };
+	float	boxMax[3]      = { -kQ3MaxFloat, -kQ3MaxFloat, -kQ3MaxFloat };
+	float	centroidMin[3] = {  kQ3MaxFloat,  kQ3MaxFloat,  kQ3MaxFloat };
+	float	centroidMax[3] = { -kQ3MaxFloat, -kQ3MaxFloat, -kQ3MaxFloat };
+
+
+
+	// Find the bounds of the triangles, and of their centroids
+	for (TQ3Uns32 n = inFirst; n < inFirst + inCount; ++n)
+	{
+		const TQ3Uns32	triIndex = mTriangles[n];
+		
+		for (int v = 0; v < 3; ++v)
+		{
+			const float*	pt = &inData.points[ inData.triangles[ triIndex ].pointIndices[v] ].x;
+			
+			for (int i = 0; i < 3; ++i)
+			{
+				boxMin[i] = std::min( boxMin[i], pt[i] );
+				boxMax[i] = std::max( boxMax[i], pt[i] );
+			}
+		}
+		
+		const float*	centroid = &inCentroids[ triIndex ].x;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			centroidMin[i] = std::min( centroidMin[i], centroid[i] );
+			centroidMax[i] = std::max( centroidMax[i], centroid[i] );
+		}
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		mNodes[ inNodeIndex ].min[i] = boxMin[i];
+		mNodes[ inNodeIndex ].max[i] = boxMax[i];
+	}
+
+
+
+	// Pick the longest centroid axis to split along
+	int		theAxis = 0;
+	float	theExtent = centroidMax[0] - centroidMin[0];
+	
+	for (int i = 1; i < 3; ++i)
+	{
+		if (centroidMax[i] - centroidMin[i] > theExtent)
+		{
+			theAxis   = i;
+			theExtent = centroidMax[i] - centroidMin[i];
+		}
+	}
+
+
+
+	// Small or degenerate runs become leaves
+	if ( (inCount <= kMaxLeafTriangles) || (theExtent <= 0.0f) )
+	{
+		mNodes[ inNodeIndex ].first = inFirst;
+		mNodes[ inNodeIndex ].count = inCount;
+		return;
+	}
+
+
+
+	// Otherwise split at the median, and build the children. The left child
+	// must be the next node in the array, so it is added before recursing.
+	TQ3Uns32	leftCount = inCount / 2;
+	
+	std::nth_element( mTriangles.begin() + inFirst,
+		mTriangles.begin() + inFirst + leftCount,
+		mTriangles.begin() + inFirst + inCount,
+		CompareCentroids( inCentroids, theAxis ) );
+
+	TQ3Uns32	leftIndex = static_cast<TQ3Uns32>( mNodes.size() );
+	mNodes.push_back( Node() );
+	BuildNode( leftIndex, inFirst, leftCount, inCentroids, inData );
+	
+	TQ3Uns32	rightIndex = static_cast<TQ3Uns32>( mNodes.size() );
+	mNodes.push_back( Node() );
+	BuildNode( rightIndex, inFirst + leftCount, inCount - leftCount, inCentroids, inData );
+	
+	mNodes[ inNodeIndex ].first = rightIndex;
+	mNodes[ inNodeIndex ].count = 0;
+}
+
+
+
+
+
+//=============================================================================
+//      E3TriMeshBVH::FindRayTriangles : Visit triangles along a ray.
+//-----------------------------------------------------------------------------
+void
+E3TriMeshBVH::FindRayTriangles( const TQ3Ray3D& inRay, float inMaxT,
+								E3TriMeshBVHVisitor inVisitor, void* inUserData ) const
+{
+	RayStackItem	theStack[ kMaxStackDepth ];
+	TQ3Uns32		stackSize = 0;
+	float			maxT = inMaxT;
+	float			tNear;
+
+
+
+	// Prepare the ray for slab tests
+	if (mNodes.empty())
+		return;
+
+	const float	origin[3] = { inRay.origin.x, inRay.origin.y, inRay.origin.z };
+	const float	invDir[3] = { e3bvh_ray_slab_inverse( inRay.direction.x ),
+							  e3bvh_ray_slab_inverse( inRay.direction.y ),
+							  e3bvh_ray_slab_inverse( inRay.direction.z ) };
+
+
+
+	// Walk the tree front to back
+	if (! e3bvh_ray_hits_box( mNodes[0].min, mNodes[0].max, origin, invDir, maxT, tNear ))
+		return;
+	
+	theStack[ stackSize ].node  = 0;
+	theStack[ stackSize ].tNear = tNear;
+	++stackSize;
+	
+	while (stackSize > 0)
+	{
+		--stackSize;
+		
+		// The visitor may have lowered maxT since this node was pushed
+		if (theStack[ stackSize ].tNear > maxT)
+			continue;
+
+		const TQ3Uns32	nodeIndex = theStack[ stackSize ].node;
+		const Node&		theNode   = mNodes[ nodeIndex ];
+		
+		if (theNode.count != 0)
+		{
+			for (TQ3Uns32 n = theNode.first; n < theNode.first + theNode.count; ++n)
+			{
+				if (! inVisitor( mTriangles[n], inUserData, maxT ))
+					return;
+			}
+		}
+		else
+		{
+			const TQ3Uns32	leftIndex  = nodeIndex + 1;
+			const TQ3Uns32	rightIndex = theNode.first;
+			float			leftNear, rightNear;
+			
+			bool	hitLeft  = e3bvh_ray_hits_box( mNodes[ leftIndex ].min,  mNodes[ leftIndex ].max,
+												origin, invDir, maxT, leftNear );
+			bool	hitRight = e3bvh_ray_hits_box( mNodes[ rightIndex ].min, mNodes[ rightIndex ].max,
+												origin, invDir, maxT, rightNear );
+			
+			Q3_ASSERT( stackSize + 2 <= kMaxStackDepth );
+			
+			// Push the farther child first, so that the nearer is visited first
+			if (hitLeft && hitRight && (leftNear < rightNear))
+			{
+				theStack[ stackSize ].node  = rightIndex;
+				theStack[ stackSize ].tNear = rightNear;
+				++stackSize;
+				hitRight = false;
+			}
+
+			if (hitLeft)
+			{
+				theStack[ stackSize ].node  = leftIndex;
+				theStack[ stackSize ].tNear = leftNear;
+				++stackSize;
+			}
+			
+			if (hitRight)
+			{
+				theStack[ stackSize ].node  = rightIndex;
+				theStack[ stackSize ].tNear = rightNear;
+				++stackSize;
+			}
+		}
+	}
+}
+
+
+
+
+
+//=============================================================================
+//      E3TriMeshBVH::FindAreaTriangles : Visit triangles within a window area.
+//-----------------------------------------------------------------------------
+void
+E3TriMeshBVH::FindAreaTriangles( const TQ3Matrix4x4& inLocalToWindow,
+								const TQ3Area& inArea,
+								E3TriMeshBVHVisitor inVisitor, void* inUserData ) const
+{
+	TQ3Uns32		theStack[ kMaxStackDepth ];
+	TQ3Uns32		stackSize = 0;
+	float			unusedMaxT = kQ3MaxFloat;
+
+
+
+	// Walk the tree
+	if (mNodes.empty())
+		return;
+	
+	theStack[ stackSize++ ] = 0;
+	
+	while (stackSize > 0)
+	{
+		const TQ3Uns32	nodeIndex = theStack[ --stackSize ];
+		const Node&		theNode   = mNodes[ nodeIndex ];
+		
+		if (! e3bvh_box_overlaps_area( theNode.min, theNode.max, inLocalToWindow, inArea ))
+			continue;
+		
+		if (theNode.count != 0)
+		{
+			for (TQ3Uns32 n = theNode.first; n < theNode.first + theNode.count; ++n)
+			{
+				if (! inVisitor( mTriangles[n], inUserData, unusedMaxT ))
+					return;
+			}
+		}
+		else
+		{
+			Q3_ASSERT( stackSize + 2 <= kMaxStackDepth );
+
+			theStack[ stackSize++ ] = theNode.first;
+			theStack[ stackSize++ ] = nodeIndex + 1;
+		}
+	}
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      E3TriMeshBVH_New : Build a hierarchy for some TriMesh data.
+//-----------------------------------------------------------------------------
+E3TriMeshBVH*
+E3TriMeshBVH_New( const TQ3TriMeshData& inData )
+{
+	E3TriMeshBVH*	theTree = NULL;
+	
+	try
+	{
+		theTree = new E3TriMeshBVH( inData );
+	}
+	catch (...)
+	{
+		E3ErrorManager_PostError( kQ3ErrorOutOfMemory, kQ3False );
+	}
+	
+	return theTree;
+}
+
+
+
+
+
+//=============================================================================
+//      E3TriMeshBVH_Dispose : Dispose of a hierarchy.
+//-----------------------------------------------------------------------------
+void
+E3TriMeshBVH_Dispose( E3TriMeshBVH*& ioTree )
+{
+	delete ioTree;
+	ioTree = NULL;
+}
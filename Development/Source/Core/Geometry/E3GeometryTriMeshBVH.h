@@ -0,0 +1,163 @@
+/*  NAME:
+        E3GeometryTriMeshBVH.h
+
+    DESCRIPTION:
+        Header file for E3GeometryTriMeshBVH.cpp.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+#ifndef E3GEOMETRY_TRIMESH_BVH_HDR
+#define E3GEOMETRY_TRIMESH_BVH_HDR
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "E3Prefix.h"
+
+#include <vector>
+
+
+
+
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+/*!
+	@typedef	E3TriMeshBVHVisitor
+	
+	@abstract	Callback invoked for each candidate triangle of a BVH query.
+	
+	@discussion	For ray queries, ioMaxT holds the ray parameter beyond which
+				nodes are skipped. A visitor that only wants the nearest hit
+				can lower it to the parameter of each hit it accepts, so that
+				nodes behind that hit are never visited.
+				
+				Returning false stops the traversal.
+	
+	@param		inTriIndex		Index of the triangle within the TriMesh.
+	@param		inUserData		User data passed to the query.
+	@param		ioMaxT			Ray parameter limit for the query.
+	@result		True to continue the traversal.
+*/
+typedef bool (*E3TriMeshBVHVisitor)(TQ3Uns32 inTriIndex, void *inUserData, float &ioMaxT);
+
+
+
+/*!
+	@class		E3TriMeshBVH
+	
+	@abstract	Bounding volume hierarchy over the triangles of a TriMesh.
+	
+	@discussion	The hierarchy is built in the local coordinates of the TriMesh,
+				so it remains valid under any local-to-world transform. It
+				holds triangle indices rather than copies of the points, and
+				must be rebuilt if the TriMesh data changes.
+*/
+class E3TriMeshBVH
+{
+public:
+	/*!
+		@function	E3TriMeshBVH
+		@abstract	Build a hierarchy for some TriMesh data.
+		@discussion	Throws std::bad_alloc if memory runs out.
+		@param		inData		The TriMesh data.
+	*/
+							E3TriMeshBVH( const TQ3TriMeshData& inData );
+	
+	/*!
+		@function	FindRayTriangles
+		@abstract	Visit the triangles whose bounds are crossed by a ray.
+		@discussion	The ray need not have a normalized direction. Nodes are
+					visited front to back, and nodes which the ray only reaches
+					beyond inMaxT (as lowered by the visitor) are skipped.
+		@param		inRay		A ray, in the local coordinates of the TriMesh.
+		@param		inMaxT		Initial ray parameter limit.
+		@param		inVisitor	Callback for each candidate triangle.
+		@param		inUserData	User data for the callback.
+	*/
+	void					FindRayTriangles(
+									const TQ3Ray3D& inRay,
+									float inMaxT,
+									E3TriMeshBVHVisitor inVisitor,
+									void* inUserData ) const;
+
+	/*!
+		@function	FindAreaTriangles
+		@abstract	Visit the triangles whose projected bounds overlap a
+					window-space rectangle.
+		@param		inLocalToWindow		Local to window transform.
+		@param		inArea				Area in window coordinates.
+		@param		inVisitor			Callback for each candidate triangle.
+		@param		inUserData			User data for the callback.
+	*/
+	void					FindAreaTriangles(
+									const TQ3Matrix4x4& inLocalToWindow,
+									const TQ3Area& inArea,
+									E3TriMeshBVHVisitor inVisitor,
+									void* inUserData ) const;
+
+private:
+	struct Node
+	{
+		float		min[3];
+		float		max[3];
+		TQ3Uns32	first;		// leaf: first triangle slot, interior: right child
+		TQ3Uns32	count;		// leaf: number of triangles, interior: 0
+	};
+
+	void					BuildNode(
+									TQ3Uns32 inNodeIndex,
+									TQ3Uns32 inFirst,
+									TQ3Uns32 inCount,
+									const std::vector<TQ3Point3D>& inCentroids,
+									const TQ3TriMeshData& inData );
+
+	std::vector<Node>		mNodes;
+	std::vector<TQ3Uns32>	mTriangles;
+};
+
+
+
+
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+E3TriMeshBVH*		E3TriMeshBVH_New( const TQ3TriMeshData& inData );
+void				E3TriMeshBVH_Dispose( E3TriMeshBVH*& ioTree );
+
+#endif
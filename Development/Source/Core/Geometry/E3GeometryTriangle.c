@@ -264,11 +264,13 @@ e3geom_triangle_pick_window_rect(TQ3ViewObject theView, TQ3PickObject thePick, T
 
 
 
-	// Transform our points
-	TQ3Matrix4x4	frustumToWindow, localToWindow;
-	const TQ3Matrix4x4&	localToFrustum( E3View_State_GetMatrixLocalToFrustum( theView ) );
-	E3View_GetFrustumToWindowMatrixState( theView, &frustumToWindow );
-	Q3Matrix4x4_Multiply( &localToFrustum, &frustumToWindow, &localToWindow );
+	// Transform our points. The camera matrices on the view stack are only
+	// set when drawing, so as for other window picks we take the camera's.
+	TQ3Matrix4x4	worldToFrustum, frustumToWindow, localToWindow;
+	Q3View_GetWorldToFrustumMatrixState( theView, &worldToFrustum );
+	Q3View_GetFrustumToWindowMatrixState( theView, &frustumToWindow );
+	Q3Matrix4x4_Multiply( E3View_State_GetMatrixLocalToWorld( theView ), &worldToFrustum, &localToWindow );
+	Q3Matrix4x4_Multiply( &localToWindow, &frustumToWindow, &localToWindow );
 	for (n = 0; n < 3; n++)
 	{
 		Q3Point3D_Transform( &instanceData->vertices[n].point, &localToWindow,
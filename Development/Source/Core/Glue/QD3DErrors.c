@@ -175,8 +175,8 @@ Q3Notice_Register(TQ3NoticeMethod noticePost, TQ3Int32 reference)
 //-----------------------------------------------------------------------------
 TQ3Error
 Q3Error_Get(TQ3Error *firstError)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
-	TQ3Boolean		saveState;
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
+	TQ3Boolean			saveState;
 
 
 
@@ -191,12 +191,12 @@ Q3Error_Get(TQ3Error *firstError)
 
 
 	// Call the bottleneck, saving the state around it
-	saveState                      = theGlobals->systemDoBottleneck;
-	theGlobals->systemDoBottleneck = kQ3False;
+	saveState                     = theThread->systemDoBottleneck;
+	theThread->systemDoBottleneck = kQ3False;
 
 	E3System_Bottleneck();
 	
-	theGlobals->systemDoBottleneck = saveState;
+	theThread->systemDoBottleneck = saveState;
 
 
 
@@ -237,8 +237,8 @@ Q3Error_IsFatalError(TQ3Error error)
 //-----------------------------------------------------------------------------
 TQ3Warning
 Q3Warning_Get(TQ3Warning *firstWarning)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
-	TQ3Boolean		saveState;
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
+	TQ3Boolean			saveState;
 
 
 
@@ -254,12 +254,12 @@ Q3Warning_Get(TQ3Warning *firstWarning)
 
 
 	// Call the bottleneck, saving the state around it
-	saveState                      = theGlobals->errMgrClearWarning;
-	theGlobals->errMgrClearWarning = kQ3False;
+	saveState                     = theThread->errMgrClearWarning;
+	theThread->errMgrClearWarning = kQ3False;
 
 	E3System_Bottleneck();
 	
-	theGlobals->errMgrClearWarning = saveState;
+	theThread->errMgrClearWarning = saveState;
 
 
 
@@ -279,8 +279,8 @@ Q3Warning_Get(TQ3Warning *firstWarning)
 //-----------------------------------------------------------------------------
 TQ3Notice
 Q3Notice_Get(TQ3Notice *firstNotice)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
-	TQ3Boolean		saveState;
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
+	TQ3Boolean			saveState;
 
 
 
@@ -296,12 +296,12 @@ Q3Notice_Get(TQ3Notice *firstNotice)
 
 
 	// Call the bottleneck, saving the state around it
-	saveState                     = theGlobals->errMgrClearNotice;
-	theGlobals->errMgrClearNotice = kQ3False;
+	saveState                    = theThread->errMgrClearNotice;
+	theThread->errMgrClearNotice = kQ3False;
 
 	E3System_Bottleneck();
 	
-	theGlobals->errMgrClearNotice = saveState;
+	theThread->errMgrClearNotice = saveState;
 
 
 
@@ -322,8 +322,8 @@ Q3Notice_Get(TQ3Notice *firstNotice)
 #if QUESA_ALLOW_QD3D_EXTENSIONS
 TQ3Uns32
 Q3Error_PlatformGet(TQ3Uns32 *firstErr)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
-	TQ3Boolean		saveState;
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
+	TQ3Boolean			saveState;
 
 
 
@@ -339,12 +339,12 @@ Q3Error_PlatformGet(TQ3Uns32 *firstErr)
 
 
 	// Call the bottleneck, saving the state around it
-	saveState                       = theGlobals->errMgrClearPlatform;
-	theGlobals->errMgrClearPlatform = kQ3False;
+	saveState                      = theThread->errMgrClearPlatform;
+	theThread->errMgrClearPlatform = kQ3False;
 
 	E3System_Bottleneck();
 	
-	theGlobals->errMgrClearPlatform = saveState;
+	theThread->errMgrClearPlatform = saveState;
 
 
 
@@ -269,6 +269,153 @@ Q3Geometry_GetDecomposed(TQ3GeometryObject geometry, TQ3ViewObject view)
 
 
 
+
+//=============================================================================
+//      Q3Geometry_GetCacheStatistics : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Geometry_GetCacheStatistics(TQ3GeometryCacheStatistics *statistics)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(statistics), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3Geometry_GetCacheStatistics(statistics));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3Geometry_ResetCacheStatistics : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Geometry_ResetCacheStatistics(void)
+{
+
+
+	// Release build checks
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3Geometry_ResetCacheStatistics());
+}
+
+
+
+
+
+//=============================================================================
+//      Q3Geometry_SetCacheBudget : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Geometry_SetCacheBudget(TQ3Uns32 numBytes)
+{
+
+
+	// Release build checks
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3Geometry_SetCacheBudget(numBytes));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3Geometry_SetImmediateCacheLimits : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Geometry_SetImmediateCacheLimits(TQ3Uns32 maxEntries, TQ3Uns32 maxIdleFrames)
+{
+
+
+	// Release build checks
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3Geometry_SetImmediateCacheLimits(maxEntries, maxIdleFrames));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3Geometry_FlushImmediateCache : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Geometry_FlushImmediateCache(void)
+{
+
+
+	// Release build checks
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3Geometry_FlushImmediateCache());
+}
+
+
+
+
+
 //=============================================================================
 //      Q3Box_New : Quesa API entry point.
 //-----------------------------------------------------------------------------
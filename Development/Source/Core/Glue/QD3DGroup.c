@@ -847,6 +847,40 @@ Q3Group_GetPreviousObjectPosition(TQ3GroupObject group, TQ3Object object, TQ3Gro
 
 
 
+
+
+//=============================================================================
+//      Q3Group_GetSubtreeEditIndex : Quesa API entry point.
+//-----------------------------------------------------------------------------
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+TQ3Uns32
+Q3Group_GetSubtreeEditIndex(TQ3GroupObject group)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT( E3Group::IsOfMyClass ( group ), 0);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return ( (E3Group*) group )->GetSubtreeEditIndex () ;
+}
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
 #pragma mark -
 
 //=============================================================================
@@ -498,6 +498,39 @@ Q3Memory_GetStatistics(
 
 
 
+//=============================================================================
+//      Q3Memory_GetInstancePoolStatistics : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Memory_GetInstancePoolStatistics(
+	TQ3ObjectType				classType,
+	TQ3InstancePoolStatistics*	info
+)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(info), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3Memory_GetInstancePoolStatistics(classType, info));
+}
+
+
+
+
+
 //=============================================================================
 //      Q3SlabMemory_New : Quesa API entry point.
 //-----------------------------------------------------------------------------
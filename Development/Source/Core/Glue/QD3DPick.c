@@ -908,6 +908,165 @@ Q3WorldRayPick_SetData(TQ3PickObject pick, const TQ3WorldRayPickData *data)
 
 
 
+#pragma mark -
+
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+//=============================================================================
+//      Q3WorldRaysPick_New : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3PickObject
+Q3WorldRaysPick_New(const TQ3WorldRaysPickData *data)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(data), NULL);
+	Q3_REQUIRE_OR_RESULT(data->numRays == 0 || Q3_VALID_PTR(data->rays), NULL);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3WorldRaysPick_New(data));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3WorldRaysPick_GetNumRays : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3WorldRaysPick_GetNumRays(TQ3PickObject pick, TQ3Uns32 *numRays)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3Object_IsType(pick, kQ3PickTypeWorldRays), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(numRays), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3WorldRaysPick_GetNumRays(pick, numRays));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3WorldRaysPick_GetNumHits : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3WorldRaysPick_GetNumHits(TQ3PickObject pick, TQ3Uns32 rayIndex, TQ3Uns32 *numHits)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3Object_IsType(pick, kQ3PickTypeWorldRays), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(numHits), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3WorldRaysPick_GetNumHits(pick, rayIndex, numHits));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3WorldRaysPick_GetPickDetailValidMask : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3WorldRaysPick_GetPickDetailValidMask(TQ3PickObject pick, TQ3Uns32 rayIndex, TQ3Uns32 hitIndex, TQ3PickDetail *pickDetailValidMask)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3Object_IsType(pick, kQ3PickTypeWorldRays), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(pickDetailValidMask), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3WorldRaysPick_GetPickDetailValidMask(pick, rayIndex, hitIndex, pickDetailValidMask));
+}
+
+
+
+
+
+//=============================================================================
+//      Q3WorldRaysPick_GetPickDetailData : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3WorldRaysPick_GetPickDetailData(TQ3PickObject pick, TQ3Uns32 rayIndex, TQ3Uns32 hitIndex, TQ3PickDetail pickDetailValue, void *detailData)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3Object_IsType(pick, kQ3PickTypeWorldRays), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(detailData), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3WorldRaysPick_GetPickDetailData(pick, rayIndex, hitIndex, pickDetailValue, detailData));
+}
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
 #pragma mark -
 
 //=============================================================================
@@ -205,6 +205,102 @@ Q3Storage_SetData(TQ3StorageObject storage, TQ3Uns32 offset, TQ3Uns32 dataSize,
 
 
 
+//=============================================================================
+//      Q3Storage_GetSize64 : Quesa API entry point.
+//-----------------------------------------------------------------------------
+#pragma mark -
+TQ3Status
+Q3Storage_GetSize64(TQ3StorageObject storage, TQ3StorageOffset *size)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT( E3Storage::IsOfMyClass ( storage ), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(size), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return ( (E3Storage*) storage )->GetSize64 ( size ) ;
+}
+
+
+
+
+
+//=============================================================================
+//      Q3Storage_GetData64 : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Storage_GetData64(TQ3StorageObject storage, TQ3StorageOffset offset, TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT( E3Storage::IsOfMyClass ( storage ), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(data), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(sizeRead), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return ( (E3Storage*) storage )->GetData64 ( offset, dataSize, data, sizeRead ) ;
+}
+
+
+
+
+
+//=============================================================================
+//      Q3Storage_SetData64 : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3Storage_SetData64(TQ3StorageObject storage, TQ3StorageOffset offset, TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT( E3Storage::IsOfMyClass ( storage ), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(data), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(sizeWritten), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return ( (E3Storage*) storage )->SetData64 ( offset, dataSize, data, sizeWritten ) ;
+}
+
+
+
+
+
 //=============================================================================
 //      Q3MemoryStorage_GetType : Quesa API entry point.
 //-----------------------------------------------------------------------------
@@ -1184,4 +1280,34 @@ Q3UnixPathStorage_Get(TQ3StorageObject storage, char *pathName)
 	// Call our implementation
 	return(E3UnixPathStorage_Get(storage, pathName));
 }
+
+
+
+
+
+//=============================================================================
+//      Q3UnixMappedStorage_New : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3StorageObject
+Q3UnixMappedStorage_New(const char *pathName)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(pathName), NULL);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3UnixMappedStorage_New(pathName));
+}
 #endif // QUESA_OS_UNIX
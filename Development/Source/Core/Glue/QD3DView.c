@@ -982,6 +982,38 @@ Q3View_IsBoundingBoxVisible(TQ3ViewObject view, const TQ3BoundingBox *bbox)
 
 
 
+//=============================================================================
+//      Q3View_IsBoundingBoxArrayVisible : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3View_IsBoundingBoxArrayVisible(TQ3ViewObject view, TQ3Uns32 numBoxes, const TQ3BoundingBox *bboxes, TQ3Uns32 *visibleMask)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT( E3View_IsOfMyClass ( view ), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(numBoxes == 0 || Q3_VALID_PTR(bboxes), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(numBoxes == 0 || Q3_VALID_PTR(visibleMask), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3View_IsBoundingBoxArrayVisible(view, numBoxes, bboxes, visibleMask));
+}
+
+
+
+
+
 //=============================================================================
 //      Q3View_AllowAllGroupCulling : Quesa API entry point.
 //-----------------------------------------------------------------------------
@@ -1012,6 +1044,36 @@ Q3View_AllowAllGroupCulling(TQ3ViewObject view, TQ3Boolean allowCulling)
 
 
 
+//=============================================================================
+//      Q3View_AllowPassReplay : Quesa API entry point.
+//-----------------------------------------------------------------------------
+TQ3Status
+Q3View_AllowPassReplay(TQ3ViewObject view, TQ3Boolean allowReplay)
+{
+
+
+	// Release build checks
+	Q3_REQUIRE_OR_RESULT( E3View_IsOfMyClass ( view ), kQ3Failure);
+
+
+
+	// Debug build checks
+
+
+
+	// Call the bottleneck
+	E3System_Bottleneck();
+
+
+
+	// Call our implementation
+	return(E3View_AllowPassReplay(view, allowReplay));
+}
+
+
+
+
+
 //=============================================================================
 //      Q3View_TransformLocalToWorld : Quesa API entry point.
 //-----------------------------------------------------------------------------
@@ -61,6 +61,7 @@
 #include "E3Prefix.h"
 #include "E3ClassTree.h"
 #include "E3HashTable.h"
+#include "E3InstancePool.h"
 #include "E3Set.h"
 
 #include <time.h>
@@ -75,14 +76,17 @@
 //      Internal constants
 //-----------------------------------------------------------------------------
 #define kClassHashTableSize							512
-#define kMethodHashTableSize						64
+#define kMethodCacheInitialSize						32
 
 static TQ3Uns8	sDummyPlaceholder;
 
 static void* const	sMissingMethodPlaceholder	= (void*) &sDummyPlaceholder;
-// Our hash table functions cannot record a NULL value, and return NULL when
-// nothing is found, so we must use a different value to indicate a missing
-// method in the method table.
+// Our method cache cannot record a NULL value, and returns NULL when nothing
+// is found, so we must use a different value to indicate a missing method in
+// the method cache.
+
+static E3SpinLock	sMethodCacheLock = 0;
+// Serialises updates to the method caches of every class.
 
 
 
@@ -90,6 +94,32 @@ static void* const	sMissingMethodPlaceholder	= (void*) &sDummyPlaceholder;
 //=============================================================================
 //      Internal types
 //-----------------------------------------------------------------------------
+// A slot within a method cache
+//
+// A slot is empty while its methodType is kQ3ObjectTypeInvalid, and is only
+// valid once its method has been published.
+typedef struct E3MethodCacheSlot {
+	volatile TQ3XMethodType		methodType;
+	void * volatile				theMethod;
+} E3MethodCacheSlot;
+
+
+// The method cache for a class
+//
+// Method caches are filled in while objects are in use, potentially from
+// several threads at once, so must be readable without locking. They are
+// open-addressed tables, which are only modified under sMethodCacheLock:
+// each slot's method is published after its type, and a full cache is
+// replaced by a larger copy rather than being resized in place.
+//
+// Replaced caches may still be in use by other threads, so are kept until
+// their class is unregistered.
+typedef struct E3MethodCache {
+	TQ3Uns32					tableSize;
+	TQ3Uns32					numItems;
+	E3MethodCachePtr			prevCache;
+	E3MethodCacheSlot			theSlots[1];
+} E3MethodCache;
 
 
 
@@ -114,6 +144,158 @@ static void* const	sMissingMethodPlaceholder	= (void*) &sDummyPlaceholder;
 //=============================================================================
 //      Internal functions
 //-----------------------------------------------------------------------------
+//      e3class_methodcache_index : Get the first slot for a method type.
+//-----------------------------------------------------------------------------
+static inline TQ3Uns32
+e3class_methodcache_index(const E3MethodCache *theCache, TQ3XMethodType methodType)
+{
+
+
+	// Mix the bytes of the type, then mask to the (power of 2) table size
+	return( (((TQ3Uns32) methodType * 2654435761U) >> 16) & (theCache->tableSize - 1) );
+}
+
+
+
+
+
+//=============================================================================
+//      e3class_methodcache_new : Create a method cache.
+//-----------------------------------------------------------------------------
+static E3MethodCachePtr
+e3class_methodcache_new(TQ3Uns32 tableSize)
+{	E3MethodCachePtr	theCache;
+
+
+
+	// Validate our parameters
+	Q3_ASSERT( (tableSize & (tableSize - 1)) == 0 );	// power of 2
+
+
+
+	// Create the cache
+	theCache = (E3MethodCachePtr) Q3Memory_AllocateClear( static_cast<TQ3Uns32>(sizeof(E3MethodCache) +
+														  sizeof(E3MethodCacheSlot) * (tableSize - 1)) );
+	if (theCache != NULL)
+		theCache->tableSize = tableSize;
+	
+	return(theCache);
+}
+
+
+
+
+
+//=============================================================================
+//      e3class_methodcache_dispose : Dispose of a method cache.
+//-----------------------------------------------------------------------------
+//		Note : Disposes of any caches which this cache replaced.
+//-----------------------------------------------------------------------------
+static void
+e3class_methodcache_dispose(E3MethodCachePtr *theCache)
+{	E3MethodCachePtr	prevCache;
+
+
+
+	// Dispose of the cache and its predecessors
+	while (*theCache != NULL)
+		{
+		prevCache = (*theCache)->prevCache;
+		Q3Memory_Free(theCache);
+		*theCache = prevCache;
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      e3class_methodcache_slot : Find the slot for a method type.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the slot holding the type, or the empty slot where it
+//				would be stored. The cache must never be full.
+//-----------------------------------------------------------------------------
+static E3MethodCacheSlot *
+e3class_methodcache_slot(E3MethodCache *theCache, TQ3XMethodType methodType)
+{	TQ3Uns32				theIndex;
+	E3MethodCacheSlot		*theSlot;
+	TQ3XMethodType			slotType;
+
+
+
+	// Probe linearly from the hashed slot
+	theIndex = e3class_methodcache_index(theCache, methodType);
+	
+	while (true)
+		{
+		theSlot  = &theCache->theSlots[theIndex];
+		slotType = E3Atomic_LoadUns32(&theSlot->methodType);
+		if (slotType == methodType || slotType == kQ3ObjectTypeInvalid)
+			return(theSlot);
+		
+		theIndex = (theIndex + 1) & (theCache->tableSize - 1);
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      e3class_methodcache_find : Find a method in a method cache.
+//-----------------------------------------------------------------------------
+//		Note :	Safe to call while another thread is updating the cache.
+//-----------------------------------------------------------------------------
+static void *
+e3class_methodcache_find(E3MethodCache *theCache, TQ3XMethodType methodType)
+{	E3MethodCacheSlot		*theSlot;
+
+
+
+	// Find the slot, and return its method if it's been published
+	if (theCache == NULL)
+		return(NULL);
+
+	theSlot = e3class_methodcache_slot(theCache, methodType);
+	if (E3Atomic_LoadUns32(&theSlot->methodType) != methodType)
+		return(NULL);
+	
+	return(E3Atomic_LoadPointer(&theSlot->theMethod));
+}
+
+
+
+
+
+//=============================================================================
+//      e3class_methodcache_store : Store a method in a method cache.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called with sMethodCacheLock held, and the cache must
+//				have room for the method.
+//-----------------------------------------------------------------------------
+static void
+e3class_methodcache_store(E3MethodCache *theCache, TQ3XMethodType methodType, void *theMethod)
+{	E3MethodCacheSlot		*theSlot;
+
+
+
+	// Claim a slot if required, then publish the method
+	theSlot = e3class_methodcache_slot(theCache, methodType);
+	if (theSlot->methodType == kQ3ObjectTypeInvalid)
+		{
+		E3Atomic_StoreUns32(&theSlot->methodType, methodType);
+		theCache->numItems++;
+		}
+	
+	E3Atomic_StorePointer(&theSlot->theMethod, theMethod);
+}
+
+
+
+
+
+//=============================================================================
 //      e3class_verify : Verify the instance data hasn't been corrupted.
 //-----------------------------------------------------------------------------
 //		Note :	Used for debug builds, to verify object instance data doesn't
@@ -151,7 +333,7 @@ E3ClassInfo::E3ClassInfo	(
 	{
 	classType = 0 ;
 	className = NULL ;
-	methodTable = NULL ;
+	methodCache = NULL ;
 	abstract = kQ3False ;
 	numInstances = 0 ;
 	instanceSize = 0 ;
@@ -379,23 +561,25 @@ E3ClassInfo::Dump_Class ( FILE *theFile, TQ3Uns32 indent )
 
 	fprintf(theFile, "%s-> deltaInstanceSize = %lu\n", thePad, (unsigned long)deltaInstanceSize);
 
+	TE3InstancePoolInfo poolInfo ;
+	E3InstancePool_GetInfo ( instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ), &poolInfo ) ;
+	if ( poolInfo.itemSize != 0 )
+		fprintf(theFile, "%s-> instance pool, item size = %lu, items in use = %lu of %lu\n", thePad,
+						(unsigned long)poolInfo.itemSize,
+						(unsigned long)poolInfo.numItemsInUse,
+						(unsigned long)poolInfo.numItems);
+
 	fprintf(theFile, "%s-> numChildren  = %lu\n", thePad, (unsigned long)numChildren);
 	
-	if (E3HashTable_GetNumItems( methodTable) == 0)
+	if (methodCache == NULL || methodCache->numItems == 0)
 		fprintf(theFile, "%s-> method cache is empty\n", thePad);
 	else
 		{
-		fprintf(theFile, "%s-> method cache, collision max = %lu\n", thePad,
-							(unsigned long)E3HashTable_GetCollisionMax( methodTable));
-
-		fprintf(theFile, "%s-> method cache, collision avg = %.2f\n", thePad,
-							E3HashTable_GetCollisionAverage( methodTable));
-
 		fprintf(theFile, "%s-> method cache, num items     = %lu\n", thePad,
-							(unsigned long)E3HashTable_GetNumItems( methodTable));
+							(unsigned long)methodCache->numItems);
 
 		fprintf(theFile, "%s-> method cache, table size    = %lu\n", thePad,
-							(unsigned long)E3HashTable_GetTableSize( methodTable));
+							(unsigned long)methodCache->tableSize);
 		}
 
 
@@ -435,6 +619,11 @@ E3ClassTree::Destroy ( void )
 		E3HashTable_Destroy(&theGlobals->classTree);
 		theGlobals->classTreeRoot = NULL;
 		}
+
+
+
+	// Release the memory used for instances
+	E3InstancePool_Destroy () ;
 	}
 
 
@@ -545,15 +734,14 @@ E3ClassTree::RegisterClass (	TQ3ObjectType		parentClassType,
 		return kQ3Failure ;
 
 	newClass->className   = (char *) Q3Memory_Allocate ( (TQ3Uns32)strlen ( className ) + 1 ) ;
-	newClass->methodTable = E3HashTable_Create ( kMethodHashTableSize)  ;
+	newClass->methodCache = e3class_methodcache_new ( kMethodCacheInitialSize ) ;
 
-	if ( newClass->className == NULL || newClass->methodTable == NULL )
+	if ( newClass->className == NULL || newClass->methodCache == NULL )
 		{
 		if ( newClass->className != NULL )
 			Q3Memory_Free ( & newClass->className ) ;
 		
-		if ( newClass->methodTable != NULL )
-			E3HashTable_Destroy ( &newClass->methodTable ) ;
+		e3class_methodcache_dispose ( &newClass->methodCache ) ;
 
 		delete newClass ;
 		return kQ3Failure ;
@@ -622,7 +810,7 @@ E3ClassTree::RegisterClass (	TQ3ObjectType		parentClassType,
 
 		// Clean up the class
 		Q3Memory_Free ( & newClass->className ) ;
-		E3HashTable_Destroy ( & newClass->methodTable ) ;
+		e3class_methodcache_dispose ( & newClass->methodCache ) ;
 		delete newClass ;
 		}
 
@@ -704,7 +892,7 @@ E3ClassTree::UnregisterClass ( TQ3ObjectType classType, TQ3Boolean isRequired )
 	Q3_ASSERT(theClass->theChildren == NULL);
 
 	Q3Memory_Free(&theClass->className);
-	E3HashTable_Destroy(&theClass->methodTable);
+	e3class_methodcache_dispose(&theClass->methodCache);
 	
 	delete theClass ;
 	
@@ -838,7 +1026,7 @@ E3ClassInfo::CreateInstance (	TQ3Boolean		sharedParams,
 		return NULL ; // Cannot create an object of an abstract class, the required methods are missing (pure virtual)
 		
 	// Allocate and initialise the object
-	TQ3Object theObject = (TQ3Object) Q3Memory_AllocateClear ( instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
+	TQ3Object theObject = (TQ3Object) E3InstancePool_Allocate ( instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
 	if ( theObject == NULL )
 		return NULL ;
 
@@ -853,13 +1041,15 @@ E3ClassInfo::CreateInstance (	TQ3Boolean		sharedParams,
 
 	if ( qd3dStatus == kQ3Failure )
 		{
-		Q3Memory_Free ( &theObject ) ;
+		E3InstancePool_Free ( (void**) &theObject, instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
 		return NULL ;
 		}
 		
 	// Increment the instance count of the class (watch for overflow)
-	++numInstances ;
-	Q3_ASSERT ( numInstances > 0 ) ;
+	//
+	// Instances may be created and destroyed on several threads at once.
+	E3Atomic_Increment ( &numInstances ) ;
+	Q3_ASSERT ( E3Atomic_LoadUns32 ( &numInstances ) > 0 ) ;
 
 
 
@@ -926,14 +1116,14 @@ OpaqueTQ3Object::DestroyInstance ( void )
 
 
 	// Decrement the instance count of the class
-	Q3_ASSERT(theClass->numInstances > 0);
-	theClass->numInstances-- ;
+	Q3_ASSERT(E3Atomic_LoadUns32(&theClass->numInstances) > 0);
+	E3Atomic_Decrement ( &theClass->numInstances ) ;
 
 
 
 	// Dispose of the object
 	TQ3Object theObject = (TQ3Object) this ;		
-	Q3Memory_Free ( & theObject ) ;
+	E3InstancePool_Free ( (void**) &theObject, theClass->instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
 	}
 
 
@@ -1019,7 +1209,7 @@ OpaqueTQ3Object::DuplicateInstance ( void )
 
 
 	// Allocate and initialise the object
-	TQ3Object newObject = (TQ3Object) Q3Memory_AllocateClear ( theClass->instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
+	TQ3Object newObject = (TQ3Object) E3InstancePool_Allocate ( theClass->instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
 	if ( newObject == NULL )
 		return NULL ;
 
@@ -1034,14 +1224,14 @@ OpaqueTQ3Object::DuplicateInstance ( void )
 	TQ3Status qd3dStatus = DuplicateInstanceData ( newObject , theClass ) ;
 	if ( qd3dStatus == kQ3Failure )
 		{
-		Q3Memory_Free ( &newObject ) ;
+		E3InstancePool_Free ( (void**) &newObject, theClass->instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ) ;
 		return NULL ;
 		}
 	
 
 	// Increment the instance count of the object's class
-	theClass->numInstances++ ;
-	Q3_ASSERT ( theClass->numInstances > 0 ) ;
+	E3Atomic_Increment ( &theClass->numInstances ) ;
+	Q3_ASSERT ( E3Atomic_LoadUns32 ( &theClass->numInstances ) > 0 ) ;
 
 
 
@@ -1427,6 +1617,28 @@ E3ClassInfo::GetInstanceSize ( void )
 
 
 
+//=============================================================================
+//      E3ClassTree_GetObjectSize : Get the size of an object of a class.
+//-----------------------------------------------------------------------------
+//		Note :	This is the size allocated for each instance, which includes
+//				the instance data of the class and its parents.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+E3ClassInfo::GetObjectSize ( void )
+	{
+	// Validate our parameters
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(this), 0);
+
+
+
+	// Return the size of the object
+	return instanceSize + (TQ3Uns32)sizeof( TQ3ObjectType ) ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3ClassTree_GetNumInstances : Get number of instances of a class.
 //-----------------------------------------------------------------------------
@@ -1468,14 +1680,15 @@ E3ClassInfo::GetMethod ( TQ3XMethodType methodType )
 
 	// Find the method
 	//
-	// We first check the hash table for the class. If this fails, we invoke the
+	// We first check the method cache for the class. If this fails, we invoke the
 	// metahandler for the class to obtain the method and store it away in the
-	// hash table for future use.
+	// cache for future use.
 	//
 	// When invoking the metahandler, we inherit methods that this class doesn't
-	// implement from the parent - ensuring that the hash table is eventually
+	// implement from the parent - ensuring that the cache is eventually
 	// populated with all of the (invoked) methods of the class.
-	TQ3XFunctionPointer theMethod = (TQ3XFunctionPointer) E3HashTable_Find( methodTable, methodType );
+	E3MethodCachePtr theCache = (E3MethodCachePtr) E3Atomic_LoadPointer( (void * const volatile *) &methodCache );
+	TQ3XFunctionPointer theMethod = (TQ3XFunctionPointer) e3class_methodcache_find( theCache, methodType );
 	if ( theMethod == sMissingMethodPlaceholder )
 	{
 		theMethod = NULL;
@@ -1532,15 +1745,38 @@ E3ClassInfo::AddMethod ( TQ3XMethodType methodType, TQ3XFunctionPointer theMetho
 
 
 
-	// Add the method to the hash table for the class
-	if (theMethod == NULL)
-	{
-		E3HashTable_Add( methodTable, methodType, sMissingMethodPlaceholder );
-	}
-	else
+	// Add the method to the cache for the class
+	//
+	// If the cache is more than half full, we replace it with a larger copy -
+	// other threads may be reading from the old cache, so it's kept until the
+	// class is unregistered.
+	E3SpinLocker theLocker( sMethodCacheLock );
+
+	E3MethodCachePtr theCache = methodCache;
+	if (theCache == NULL)
+		return;
+
+	if (e3class_methodcache_find( theCache, methodType ) == NULL
+	&&  (theCache->numItems + 1) * 2 > theCache->tableSize)
 	{
-		E3HashTable_Add( methodTable, methodType, (void*)theMethod );
+		E3MethodCachePtr newCache = e3class_methodcache_new( theCache->tableSize * 2 );
+		if (newCache == NULL)
+			return;
+
+		for (TQ3Uns32 n = 0; n < theCache->tableSize; ++n)
+		{
+			const E3MethodCacheSlot& theSlot = theCache->theSlots[ n ];
+			if (theSlot.methodType != kQ3ObjectTypeInvalid)
+				e3class_methodcache_store( newCache, theSlot.methodType, theSlot.theMethod );
+		}
+
+		newCache->prevCache = theCache;
+		E3Atomic_StorePointer( (void * volatile *) &methodCache, newCache );
+		theCache = newCache;
 	}
+
+	e3class_methodcache_store( theCache, methodType,
+		(theMethod == NULL) ? sMissingMethodPlaceholder : (void*)theMethod );
 }
 
 
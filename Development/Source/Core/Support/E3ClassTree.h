@@ -83,6 +83,7 @@ class OpaqueTQ3Object ;
 
 // Nodes in the class tree have all their fields private
 typedef class E3ClassInfo *E3ClassInfoPtr ;
+typedef struct E3MethodCache *E3MethodCachePtr ;
 
 
 typedef Q3_CALLBACK_API_C ( E3ClassInfo*, TQ3XObjectRegisterMethod ) (	TQ3XMetaHandler	newClassMetaHandler,
@@ -96,7 +97,7 @@ class E3ClassInfo
 	TQ3ObjectType		classType ;
 	char				*className ;
 	TQ3XMetaHandler		classMetaHandler ;
-	E3HashTablePtr		methodTable ;
+	E3MethodCachePtr	methodCache ;
 	
 	TQ3Boolean			abstract ;	// If set, class is 'abstract' in the C++ sense, in that no instances of the class can be created
 									// It gets set because the class has necessary methods missing (= 0 or pure virtual in C++ parlance)
@@ -155,6 +156,7 @@ public :
 	const char*			GetName ( void ) ;
 	TQ3XMetaHandler		GetMetaHandler ( void ) ;
 	TQ3Uns32			GetInstanceSize ( void ) ;
+	TQ3Uns32			GetObjectSize ( void ) ;
 	TQ3Uns32			GetNumInstances ( void ) ;
 	TQ3XFunctionPointer GetMethod ( TQ3XMethodType methodType ) ;
 	void				AddMethod ( TQ3XMethodType methodType, TQ3XFunctionPointer theMethod ) ;
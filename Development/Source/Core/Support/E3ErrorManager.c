@@ -61,23 +61,24 @@
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_PostError(TQ3Error theError, TQ3Boolean isFatal)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread  = E3Globals_GetThread();
+	E3GlobalsPtr		theGlobals = E3Globals_Get();
 
 
 
 	// Update our state
-	if (theGlobals->errMgrOldestError == kQ3ErrorNone)
-		theGlobals->errMgrOldestError = theError;
+	if (theThread->errMgrOldestError == kQ3ErrorNone)
+		theThread->errMgrOldestError = theError;
 	
-	theGlobals->errMgrIsFatalError = isFatal;
-	theGlobals->errMgrLatestError  = theError;
+	theThread->errMgrIsFatalError = isFatal;
+	theThread->errMgrLatestError  = theError;
 
 
 
 	// Call the handler
 	if (theGlobals->errMgrHandlerFuncError != NULL)
-		theGlobals->errMgrHandlerFuncError(theGlobals->errMgrOldestError,
-										   theGlobals->errMgrLatestError,
+		theGlobals->errMgrHandlerFuncError(theThread->errMgrOldestError,
+										   theThread->errMgrLatestError,
 										   theGlobals->errMgrHandlerDataError);
 }
 
@@ -90,22 +91,23 @@ E3ErrorManager_PostError(TQ3Error theError, TQ3Boolean isFatal)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_PostWarning(TQ3Warning theWarning)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread  = E3Globals_GetThread();
+	E3GlobalsPtr		theGlobals = E3Globals_Get();
 
 
 
 	// Update our state
-	if (theGlobals->errMgrOldestWarning == kQ3WarningNone)
-		theGlobals->errMgrOldestWarning = theWarning;
+	if (theThread->errMgrOldestWarning == kQ3WarningNone)
+		theThread->errMgrOldestWarning = theWarning;
 	
-	theGlobals->errMgrLatestWarning = theWarning;
+	theThread->errMgrLatestWarning = theWarning;
 
 
 
 	// Call the handler
 	if (theGlobals->errMgrHandlerFuncWarning != NULL)
-		theGlobals->errMgrHandlerFuncWarning(theGlobals->errMgrOldestWarning,
-											 theGlobals->errMgrLatestWarning,
+		theGlobals->errMgrHandlerFuncWarning(theThread->errMgrOldestWarning,
+											 theThread->errMgrLatestWarning,
 											 theGlobals->errMgrHandlerDataWarning);
 }
 
@@ -118,23 +120,25 @@ E3ErrorManager_PostWarning(TQ3Warning theWarning)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_PostNotice(TQ3Notice theNotice)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread  = E3Globals_GetThread();
 
 
 
 	// Update our state
-	if (theGlobals->errMgrOldestNotice == kQ3NoticeNone)
-		theGlobals->errMgrOldestNotice = theNotice;
+	if (theThread->errMgrOldestNotice == kQ3NoticeNone)
+		theThread->errMgrOldestNotice = theNotice;
 	
-	theGlobals->errMgrLatestNotice = theNotice;
+	theThread->errMgrLatestNotice = theNotice;
 
 
 
 	// Call the handler in debug builds (notices are not posted in release builds)
 	#if Q3_DEBUG
+	E3GlobalsPtr		theGlobals = E3Globals_Get();
+
 	if (theGlobals->errMgrHandlerFuncNotice != NULL)
-		theGlobals->errMgrHandlerFuncNotice(theGlobals->errMgrOldestNotice,
-											theGlobals->errMgrLatestNotice,
+		theGlobals->errMgrHandlerFuncNotice(theThread->errMgrOldestNotice,
+											theThread->errMgrLatestNotice,
 											theGlobals->errMgrHandlerDataNotice);
 	#endif
 }
@@ -148,15 +152,16 @@ E3ErrorManager_PostNotice(TQ3Notice theNotice)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_PostPlatformError(TQ3Uns32 theError)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread  = E3Globals_GetThread();
+	E3GlobalsPtr		theGlobals = E3Globals_Get();
 
 
 
 	// Update our state
-	if (theGlobals->errMgrOldestPlatform == 0)
-		theGlobals->errMgrOldestPlatform = theError;
+	if (theThread->errMgrOldestPlatform == 0)
+		theThread->errMgrOldestPlatform = theError;
 	
-	theGlobals->errMgrLatestPlatform = theError;
+	theThread->errMgrLatestPlatform = theError;
 
 
 
@@ -171,8 +176,8 @@ E3ErrorManager_PostPlatformError(TQ3Uns32 theError)
 	// When this API is made public, apps will be able to listen directly
 	// to platform specific errors.
 	if (theGlobals->errMgrHandlerFuncPlatform != NULL)
-		theGlobals->errMgrHandlerFuncPlatform((TQ3Error) theGlobals->errMgrOldestPlatform,
-											  (TQ3Error) theGlobals->errMgrLatestPlatform,
+		theGlobals->errMgrHandlerFuncPlatform((TQ3Error) theThread->errMgrOldestPlatform,
+											  (TQ3Error) theThread->errMgrLatestPlatform,
 											  theGlobals->errMgrHandlerDataPlatform);
 	else
 		E3ErrorManager_PostError(
@@ -201,7 +206,7 @@ E3ErrorManager_PostPlatformError(TQ3Uns32 theError)
 //-----------------------------------------------------------------------------
 TQ3Boolean
 E3ErrorManager_GetIsFatalError(TQ3Error theError)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
@@ -212,7 +217,7 @@ E3ErrorManager_GetIsFatalError(TQ3Error theError)
 
 
 	// If this error isn't fatal, see if we've hit one which is
-	return(theGlobals->errMgrIsFatalError);
+	return(theThread->errMgrIsFatalError);
 }
 
 
@@ -226,22 +231,22 @@ E3ErrorManager_GetIsFatalError(TQ3Error theError)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_GetError(TQ3Error *oldestError, TQ3Error *latestError)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Return the requested state
 	if (oldestError != NULL)
-		*oldestError = theGlobals->errMgrOldestError;
+		*oldestError = theThread->errMgrOldestError;
 
 	if (latestError != NULL)
-		*latestError = theGlobals->errMgrLatestError;
+		*latestError = theThread->errMgrLatestError;
 
 
 
 	// Set our flags
-	theGlobals->systemDoBottleneck = kQ3True;
-	theGlobals->errMgrClearError   = kQ3True;
+	theThread->systemDoBottleneck = kQ3True;
+	theThread->errMgrClearError   = kQ3True;
 }
 
 
@@ -255,22 +260,22 @@ E3ErrorManager_GetError(TQ3Error *oldestError, TQ3Error *latestError)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_GetWarning(TQ3Warning *oldestWarning, TQ3Warning *latestWarning)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Return the requested state
 	if (oldestWarning != NULL)
-		*oldestWarning = theGlobals->errMgrOldestWarning;
+		*oldestWarning = theThread->errMgrOldestWarning;
 
 	if (latestWarning != NULL)
-		*latestWarning = theGlobals->errMgrLatestWarning;
+		*latestWarning = theThread->errMgrLatestWarning;
 
 
 
 	// Set our flags
-	theGlobals->systemDoBottleneck = kQ3True;
-	theGlobals->errMgrClearWarning = kQ3True;
+	theThread->systemDoBottleneck = kQ3True;
+	theThread->errMgrClearWarning = kQ3True;
 }
 
 
@@ -284,22 +289,22 @@ E3ErrorManager_GetWarning(TQ3Warning *oldestWarning, TQ3Warning *latestWarning)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_GetNotice(TQ3Notice *oldestNotice, TQ3Notice *latestNotice)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Return the requested state
 	if (oldestNotice != NULL)
-		*oldestNotice = theGlobals->errMgrOldestNotice;
+		*oldestNotice = theThread->errMgrOldestNotice;
 
 	if (latestNotice != NULL)
-		*latestNotice = theGlobals->errMgrLatestNotice;
+		*latestNotice = theThread->errMgrLatestNotice;
 
 
 
 	// Set our flags
-	theGlobals->systemDoBottleneck = kQ3True;
-	theGlobals->errMgrClearNotice  = kQ3True;
+	theThread->systemDoBottleneck = kQ3True;
+	theThread->errMgrClearNotice  = kQ3True;
 }
 
 
@@ -313,22 +318,22 @@ E3ErrorManager_GetNotice(TQ3Notice *oldestNotice, TQ3Notice *latestNotice)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_GetPlatformError(TQ3Uns32 *oldestPlatform, TQ3Uns32 *latestPlatform)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Return the requested state
 	if (oldestPlatform != NULL)
-		*oldestPlatform = theGlobals->errMgrOldestPlatform;
+		*oldestPlatform = theThread->errMgrOldestPlatform;
 
 	if (latestPlatform != NULL)
-		*latestPlatform = theGlobals->errMgrLatestPlatform;
+		*latestPlatform = theThread->errMgrLatestPlatform;
 
 
 
 	// Set our flags
-	theGlobals->systemDoBottleneck  = kQ3True;
-	theGlobals->errMgrClearPlatform = kQ3True;
+	theThread->systemDoBottleneck  = kQ3True;
+	theThread->errMgrClearPlatform = kQ3True;
 }
 
 
@@ -340,14 +345,14 @@ E3ErrorManager_GetPlatformError(TQ3Uns32 *oldestPlatform, TQ3Uns32 *latestPlatfo
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_ClearError(void)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Clear our state
-	theGlobals->errMgrClearError  	= kQ3False;
-	theGlobals->errMgrOldestError 	= kQ3ErrorNone;
-	theGlobals->errMgrLatestError 	= kQ3ErrorNone;
+	theThread->errMgrClearError  	= kQ3False;
+	theThread->errMgrOldestError 	= kQ3ErrorNone;
+	theThread->errMgrLatestError 	= kQ3ErrorNone;
 }
 
 
@@ -359,14 +364,14 @@ E3ErrorManager_ClearError(void)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_ClearWarning(void)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Clear our state
-	theGlobals->errMgrClearWarning  = kQ3False;
-	theGlobals->errMgrOldestWarning = kQ3WarningNone;
-	theGlobals->errMgrLatestWarning = kQ3WarningNone;
+	theThread->errMgrClearWarning  = kQ3False;
+	theThread->errMgrOldestWarning = kQ3WarningNone;
+	theThread->errMgrLatestWarning = kQ3WarningNone;
 }
 
 
@@ -378,14 +383,14 @@ E3ErrorManager_ClearWarning(void)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_ClearNotice(void)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Clear our state
-	theGlobals->errMgrClearNotice  = kQ3False;
-	theGlobals->errMgrOldestNotice = kQ3NoticeNone;
-	theGlobals->errMgrLatestNotice = kQ3NoticeNone;
+	theThread->errMgrClearNotice  = kQ3False;
+	theThread->errMgrOldestNotice = kQ3NoticeNone;
+	theThread->errMgrLatestNotice = kQ3NoticeNone;
 }
 
 
@@ -397,14 +402,14 @@ E3ErrorManager_ClearNotice(void)
 //-----------------------------------------------------------------------------
 void
 E3ErrorManager_ClearPlatformError(void)
-{	E3GlobalsPtr	theGlobals = E3Globals_Get();
+{	E3ThreadGlobalsPtr	theThread = E3Globals_GetThread();
 
 
 
 	// Clear our state
-	theGlobals->errMgrClearPlatform  = kQ3False;
-	theGlobals->errMgrOldestPlatform = 0;
-	theGlobals->errMgrLatestPlatform = 0;
+	theThread->errMgrClearPlatform  = kQ3False;
+	theThread->errMgrOldestPlatform = 0;
+	theThread->errMgrLatestPlatform = 0;
 }
 
 
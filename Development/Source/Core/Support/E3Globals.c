@@ -58,26 +58,12 @@
 //-----------------------------------------------------------------------------
 E3Globals gE3Globals = {
 	kQ3False,				// systemInitialised
-	kQ3False,				// systemDoBottleneck
 	0,						// systemRefCount
 	0,						// classTree
 	0,						// classTreeRoot
 	0,						// classNextType
 	0,						// sharedLibraryCount
 	0,						// sharedLibraryInfo
-	kQ3False,				// errMgrClearError
-	kQ3False,				// errMgrClearWarning
-	kQ3False,				// errMgrClearNotice
-	kQ3False,				// errMgrClearPlatform
-	kQ3False,				// errMgrIsFatalError
-	kQ3ErrorNone,			// errMgrOldestError
-	kQ3WarningNone,			// errMgrOldestWarning
-	kQ3NoticeNone,			// errMgrOldestNotice
-	0,						// errMgrOldestPlatform
-	kQ3ErrorNone,			// errMgrLatestError
-	kQ3WarningNone,			// errMgrLatestWarning
-	kQ3NoticeNone,			// errMgrLatestNotice
-	0,						// errMgrLatestPlatform
 	0,						// errMgrHandlerFuncError
 	0,						// errMgrHandlerFuncWarning
 	0,						// errMgrHandlerFuncNotice
@@ -98,11 +84,30 @@ E3Globals gE3Globals = {
 
 #if Q3_DEBUG
 	NULL,					// listHead
-	kQ3False				// isLeakChecking
+	kQ3False,				// isLeakChecking
+	0						// listLock
 #endif
 };
 
 
+E3_THREAD_LOCAL E3ThreadGlobals gE3ThreadGlobals = {
+	kQ3False,				// systemDoBottleneck
+	kQ3False,				// errMgrClearError
+	kQ3False,				// errMgrClearWarning
+	kQ3False,				// errMgrClearNotice
+	kQ3False,				// errMgrClearPlatform
+	kQ3False,				// errMgrIsFatalError
+	kQ3ErrorNone,			// errMgrOldestError
+	kQ3WarningNone,			// errMgrOldestWarning
+	kQ3NoticeNone,			// errMgrOldestNotice
+	0,						// errMgrOldestPlatform
+	kQ3ErrorNone,			// errMgrLatestError
+	kQ3WarningNone,			// errMgrLatestWarning
+	kQ3NoticeNone,			// errMgrLatestNotice
+	0						// errMgrLatestPlatform
+};
+
+
 
 
 
@@ -122,3 +127,22 @@ E3Globals_Get(void)
 	// Return the globals
 	return(&gE3Globals);
 }
+
+
+
+
+
+//=============================================================================
+//      E3Globals_GetThread : Get access to the per-thread Quesa state.
+//-----------------------------------------------------------------------------
+//		Note : Each thread receives its own copy of the state, so the result
+//				must not be passed to another thread.
+//-----------------------------------------------------------------------------
+E3ThreadGlobalsPtr
+E3Globals_GetThread(void)
+{
+
+
+	// Return the globals for this thread
+	return(&gE3ThreadGlobals);
+}
@@ -174,6 +174,7 @@ extern "C" {
 #define kQ3ClassNamePickWindowPoint					"WindowPointPick"
 #define kQ3ClassNamePickWindowRect					"WindowRectPick"
 #define kQ3ClassNamePickWorldRay					"WorldRayPick"
+#define kQ3ClassNamePickWorldRays					"WorldRaysPick"
 #define kQ3ClassNameRenderer						"Renderer"
 #define kQ3ClassNameRendererGeneric					"GenericRenderer"
 #define kQ3ClassNameRendererInteractive				"InteractiveRenderer"
@@ -249,6 +250,7 @@ extern "C" {
 #define kQ3ClassNameShaderUVTransform				"ShaderUVTransform"
 #define kQ3ClassNameStoragePath						"Quesa:Storage:Path"
 #define kQ3ClassNameStorageStream					"Quesa:Storage:Stream"
+#define kQ3ClassNameStorageUnixMapped				"Quesa:Storage:UnixMapped"
 #define kQ3ClassNameStorageBe						"Quesa:Storage:Be"
 #define kQ3ClassNameDrawContextBe					"Quesa:DrawContext:Be"
 #define kQ3ClassName3DMF							"Metafile"
@@ -307,12 +309,18 @@ extern "C" {
 #define kQ3XMethodTypeGeomCacheNew					Q3_METHOD_TYPE('Q', 'g', 'c', 'n')
 #define kQ3XMethodTypeGeomCacheIsValid				Q3_METHOD_TYPE('Q', 'g', 'c', 'v')
 #define kQ3XMethodTypeGeomCacheUpdate				Q3_METHOD_TYPE('Q', 'g', 'c', 'u')
+#define kQ3XMethodTypeGeomSubmitDecomposed			Q3_METHOD_TYPE('Q', 'g', 's', 'd')
+#define kQ3XMethodTypeGeomGetCacheKey				Q3_METHOD_TYPE('Q', 'g', 'c', 'k')
 #define kQ3XMethodTypeStorageReadData				Q3_METHOD_TYPE('Q', 'r', 'e', 'a')
 #define kQ3XMethodTypeStorageWriteData				Q3_METHOD_TYPE('Q', 'w', 'r', 'i')
 #define kQ3XMethodTypeStorageGetSize				Q3_METHOD_TYPE('Q', 'G', 's', 'z')
 #define kQ3XMethodTypeStorageSetSize				Q3_METHOD_TYPE('Q', 'S', 's', 'z')
 #define kQ3XMethodTypeStorageOpen					Q3_METHOD_TYPE('Q', 'O', 'p', 'n')
 #define kQ3XMethodTypeStorageClose					Q3_METHOD_TYPE('Q', 'C', 'l', 's')
+#define kQ3XMethodTypeStorageReadData64				Q3_METHOD_TYPE('Q', 'r', 'e', '8')
+#define kQ3XMethodTypeStorageWriteData64			Q3_METHOD_TYPE('Q', 'w', 'r', '8')
+#define kQ3XMethodTypeStorageGetSize64				Q3_METHOD_TYPE('Q', 'G', 's', '8')
+#define kQ3XMethodTypeFFormatFloat32ReadArrayValid	Q3_METHOD_TYPE('Q', 'f', 'a', 'v')
 
 
 // 3DMF object types
@@ -385,6 +393,12 @@ typedef Q3_CALLBACK_API_C(void,				TQ3XGeomCacheUpdateMethod)(TQ3ViewObject		the
 																		TQ3GeometryObject	theGeom,
 																		const void			*geomData,
 																		TQ3Object			*cachedGeom);
+typedef Q3_CALLBACK_API_C(TQ3Status,			TQ3XGeomSubmitDecomposedMethod)(TQ3ViewObject		theView,
+																			TQ3GeometryObject	theGeom,
+																			const void			*geomData);
+typedef Q3_CALLBACK_API_C(TQ3Uns32,			TQ3XGeomGetCacheKeyMethod)(const void			*geomData,
+																		TQ3Uns32			*dataSize,
+																		TQ3AttributeSet		*attributeSets);
 
 
 // Storage methods
@@ -403,6 +417,19 @@ typedef Q3_CALLBACK_API_C(TQ3Status, TQ3XStorageSetSizeMethod)(TQ3StorageObject
 typedef Q3_CALLBACK_API_C(TQ3Status, TQ3XStorageOpenMethod)(TQ3StorageObject storage, TQ3Boolean forWriting);
 typedef Q3_CALLBACK_API_C(TQ3Status, TQ3XStorageCloseMethod)(TQ3StorageObject storage);
 
+// Storage methods for files larger than 4Gb
+typedef Q3_CALLBACK_API_C(TQ3Status, TQ3XStorageReadData64Method)(TQ3StorageObject storage,
+																TQ3StorageOffset	offset,
+																TQ3Uns32			dataSize,
+																TQ3Uns8				*data,
+																TQ3Uns32			*sizeRead);
+typedef Q3_CALLBACK_API_C(TQ3Status, TQ3XStorageWriteData64Method)(TQ3StorageObject storage,
+																TQ3StorageOffset	offset,
+																TQ3Uns32			dataSize,
+																const TQ3Uns8		*data,
+																TQ3Uns32			*sizeWritten);
+typedef Q3_CALLBACK_API_C(TQ3Status, TQ3XStorageGetSize64Method)(TQ3StorageObject storage, TQ3StorageOffset *size);
+
 
 // Definition of TQ3Object
 #if !QUESA_OBJECTS_ARE_OPAQUE
@@ -428,13 +455,13 @@ typedef class OpaqueTQ3Object {
 // every field in this structure, which minimises the amount of code which
 // depends on the content of the global state.
 //
-// Global state introduces penalties when running under a preemptively
-// threaded environment (which Quesa probably will, at some stage). Please
-// only use the global state as a last resort.
+// Global state is shared by every thread using Quesa, and so must only be
+// modified while no other thread is using Quesa (see E3Threads.h). State
+// which changes during normal use belongs in E3ThreadGlobals. Please only
+// use the global state as a last resort.
 typedef struct E3Globals {
 	// System
 	TQ3Boolean				systemInitialised;
-	TQ3Boolean				systemDoBottleneck;
 	TQ3Uns32				systemRefCount;
 
 
@@ -450,19 +477,6 @@ typedef struct E3Globals {
 
 
 	// Error Manager
-	TQ3Boolean				errMgrClearError;
-	TQ3Boolean				errMgrClearWarning;
-	TQ3Boolean				errMgrClearNotice;
-	TQ3Boolean				errMgrClearPlatform;
-	TQ3Boolean				errMgrIsFatalError;
-	TQ3Error				errMgrOldestError;
-	TQ3Warning				errMgrOldestWarning;
-	TQ3Notice				errMgrOldestNotice;
-	TQ3Uns32				errMgrOldestPlatform;
-	TQ3Error				errMgrLatestError;
-	TQ3Warning				errMgrLatestWarning;
-	TQ3Notice				errMgrLatestNotice;
-	TQ3Uns32				errMgrLatestPlatform;
 	TQ3ErrorMethod			errMgrHandlerFuncError;
 	TQ3WarningMethod		errMgrHandlerFuncWarning;
 	TQ3NoticeMethod			errMgrHandlerFuncNotice;
@@ -488,11 +502,38 @@ typedef struct E3Globals {
 #if Q3_DEBUG
 	TQ3Object				listHead;
 	TQ3Boolean				isLeakChecking;
+	E3SpinLock				listLock;			// Guards the list of recorded objects
 #endif
 
 } E3Globals, *E3GlobalsPtr;
 
 
+// Per-thread state for each instance of Quesa.
+//
+// Each thread has its own copy of this structure, which is zero-filled
+// when the thread first uses it.
+typedef struct E3ThreadGlobals {
+	// System
+	TQ3Boolean				systemDoBottleneck;
+
+
+	// Error Manager
+	TQ3Boolean				errMgrClearError;
+	TQ3Boolean				errMgrClearWarning;
+	TQ3Boolean				errMgrClearNotice;
+	TQ3Boolean				errMgrClearPlatform;
+	TQ3Boolean				errMgrIsFatalError;
+	TQ3Error				errMgrOldestError;
+	TQ3Warning				errMgrOldestWarning;
+	TQ3Notice				errMgrOldestNotice;
+	TQ3Uns32				errMgrOldestPlatform;
+	TQ3Error				errMgrLatestError;
+	TQ3Warning				errMgrLatestWarning;
+	TQ3Notice				errMgrLatestNotice;
+	TQ3Uns32				errMgrLatestPlatform;
+} E3ThreadGlobals, *E3ThreadGlobalsPtr;
+
+
 
 
 
@@ -507,6 +548,12 @@ typedef struct E3Globals {
 extern E3Globals gE3Globals;
 
 
+// Per-thread Quesa state
+//
+// As above, code should use the E3Globals_GetThread accessor.
+extern E3_THREAD_LOCAL E3ThreadGlobals gE3ThreadGlobals;
+
+
 
 
 
@@ -517,6 +564,10 @@ extern E3Globals gE3Globals;
 E3GlobalsPtr	E3Globals_Get(void);
 
 
+// Get access to the Quesa state for the calling thread
+E3ThreadGlobalsPtr	E3Globals_GetThread(void);
+
+
 
 
 
@@ -58,29 +58,38 @@
 
 
 //=============================================================================
-//      Internal types
+//      Internal constants
 //-----------------------------------------------------------------------------
-// An item stored within each node
-typedef struct E3HashTableItem {
-	TQ3ObjectType		theKey;						// Key for item
-	void				*theItem;					// Data for item
-} E3HashTableItem, *E3HashTableItemPtr;
+// Slot states
+//
+// Any key may be stored, including 0, so the state of each slot is kept
+// apart from its key.
+enum {
+	kHashSlotEmpty										= 0,
+	kHashSlotFull										= 1,
+	kHashSlotRemoved									= 2		// Held an item since removed
+};
+
 
 
-// A node within a hash table
-typedef struct E3HashTableNode {
-	TQ3Uns32			numItems;					// Number of items in node
-	E3HashTableItemPtr	theItems;					// Array of items for node
-} E3HashTableNode, *E3HashTableNodePtr;
 
 
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
 // A hash table
+//
+// The table uses open addressing with linear probing. The keys and slot states
+// are stored apart from the items, so that probing for a key touches as few
+// cache lines as possible. The table is kept at most half full (counting
+// removed items), so every probe sequence ends at an empty slot.
 typedef struct E3HashTable {
-	TQ3Uns32			collisionMax;				// Worst case collision count
-	float				collisionAverage;			// Average collision count
 	TQ3Uns32			numItems;					// Number of items in table
+	TQ3Uns32			numDeleted;					// Number of removed-item slots
 	TQ3Uns32			tableSize;					// Number of slots in table
-	E3HashTableNodePtr	*theTable;					// Array of node pointers
+	void				**theItems;					// Array of slot items
+	TQ3ObjectType		*theKeys;					// Array of slot keys
+	TQ3Uns8				*theStates;					// Array of slot states
 } E3HashTable;
 
 
@@ -90,43 +99,62 @@ typedef struct E3HashTable {
 //=============================================================================
 //      Internal functions
 //-----------------------------------------------------------------------------
-//      e3hash_find_node : Find the node for a given key.
+//      e3hash_index : Get the first slot for a given key.
 //-----------------------------------------------------------------------------
-//		Note :	Hash index algorithm inspired by John Punin's hash table code
-//				for the W3's libwww library.  However, libwww needs to hash
-//				strings of unknown length, whereas here we hash just 4 bytes,
-//				which allows a mathematical simplification of the hash function.
-//
-//				Returns the address of a node pointer, rather than the node
-//				pointer itself, since the node pointer may be NULL if the node
-//				hasn't been allocated yet.
+//		Note :	Keys are typically four character codes or small integers,
+//				which differ in only a few bits. We use the MurmurHash3
+//				finaliser to spread those differences across the index.
 //-----------------------------------------------------------------------------
-static E3HashTableNodePtr *
-e3hash_find_node(E3HashTablePtr theTable, TQ3ObjectType theKey)
+static inline TQ3Uns32
+e3hash_index(const E3HashTable *theTable, TQ3ObjectType theKey)
+{	TQ3Uns32		theHash;
+
+
+
+	// Mix the key, then mask to the (power of 2) table size
+	theHash  = (TQ3Uns32) theKey;
+	theHash ^= theHash >> 16;
+	theHash *= 0x85EBCA6BU;
+	theHash ^= theHash >> 13;
+	theHash *= 0xC2B2AE35U;
+	theHash ^= theHash >> 16;
+
+	return(theHash & (theTable->tableSize - 1));
+}
+
+
+
+
+
+//=============================================================================
+//      e3hash_allocate_slots : Allocate the slots for a table.
+//-----------------------------------------------------------------------------
+//		Note :	The items, keys and states share a single block, in order of
+//				decreasing alignment.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3hash_allocate_slots(E3HashTablePtr theTable, TQ3Uns32 tableSize)
 {
-	TQ3Uns32		theIndex;
-	TQ3Uns8			*thePtr;
-	
 
 
 	// Validate our parameters
-	Q3_ASSERT_VALID_PTR(theTable);
-	Q3_ASSERT(theKey != kQ3ObjectTypeInvalid);
-
+	Q3_ASSERT( (tableSize & (tableSize - 1)) == 0 );	// power of 2
 
 
-	// Calculate the index for the node
-	thePtr   = (TQ3Uns8 *) &theKey;
-	
-	// This hash function may not be the most theoretically sound, but I can't
-	// find anything faster that works as well.
-	theIndex = (27*thePtr[0] + 9*thePtr[1] + 3*thePtr[2] + thePtr[3]) & (theTable->tableSize - 1);
 
-	Q3_ASSERT(theIndex < theTable->tableSize);
+	// Allocate the slots, all of which are initially empty
+	theTable->theItems = (void **) Q3Memory_AllocateClear(static_cast<TQ3Uns32>(
+								(sizeof(void *) + sizeof(TQ3ObjectType) + sizeof(TQ3Uns8)) * tableSize));
+	if (theTable->theItems == NULL)
+		return(kQ3Failure);
 
+	theTable->theKeys    = (TQ3ObjectType *) (theTable->theItems + tableSize);
+	theTable->theStates  = (TQ3Uns8 *)       (theTable->theKeys  + tableSize);
+	theTable->tableSize  = tableSize;
+	theTable->numItems   = 0;
+	theTable->numDeleted = 0;
 
-	// Return the address of the appropriate node within the table
-	return (&theTable->theTable[theIndex]);
+	return(kQ3Success);
 }
 
 
@@ -134,34 +162,68 @@ e3hash_find_node(E3HashTablePtr theTable, TQ3ObjectType theKey)
 
 
 //=============================================================================
-//      e3hash_add_key : Add a key and its item to a node.
+//      e3hash_find_slot : Find the slot for a given key.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3hash_add_key(E3HashTableNodePtr theNode, TQ3ObjectType theKey, void *theItem)
-{	TQ3Status		qd3dStatus;
+//		Note :	Returns the index of the slot holding the key, or -1 if the
+//				key is not present.
+//-----------------------------------------------------------------------------
+static TQ3Int32
+e3hash_find_slot(const E3HashTable *theTable, TQ3ObjectType theKey)
+{	TQ3Uns32		theIndex, theMask;
+	TQ3Uns8			slotState;
 
 
 
-	// Validate our parameters
-	Q3_ASSERT_VALID_PTR(theNode);
+	// Probe until we find the key, or an empty slot
+	theMask  = theTable->tableSize - 1;
+	theIndex = e3hash_index(theTable, theKey);
 
+	while (true)
+		{
+		slotState = theTable->theStates[theIndex];
+		if (slotState == kHashSlotFull && theTable->theKeys[theIndex] == theKey)
+			return((TQ3Int32) theIndex);
 
+		if (slotState == kHashSlotEmpty)
+			return(-1);
 
-	// Grow the node item array
-	qd3dStatus = Q3Memory_Reallocate(&theNode->theItems,
-										static_cast<TQ3Uns32>(sizeof(E3HashTableItem) * (theNode->numItems + 1)));
-	if (qd3dStatus != kQ3Success)
-		return(qd3dStatus);
+		theIndex = (theIndex + 1) & theMask;
+		}
+}
 
 
 
-	// Save the item and its key at the end of the node's list,
-	// and update the count for the node
-	theNode->theItems[theNode->numItems].theKey  = theKey;
-	theNode->theItems[theNode->numItems].theItem = theItem;
-	theNode->numItems++;
 
-	return(kQ3Success);
+
+//=============================================================================
+//      e3hash_store : Store a key that isn't present in the table.
+//-----------------------------------------------------------------------------
+//		Note :	The table must have room for the key. We reuse the first
+//				removed-item slot on the probe sequence, if there is one.
+//-----------------------------------------------------------------------------
+static void
+e3hash_store(E3HashTablePtr theTable, TQ3ObjectType theKey, void *theItem)
+{	TQ3Uns32		theIndex, theMask;
+
+
+
+	// Find the first free slot
+	theMask  = theTable->tableSize - 1;
+	theIndex = e3hash_index(theTable, theKey);
+
+	while (theTable->theStates[theIndex] == kHashSlotFull)
+		theIndex = (theIndex + 1) & theMask;
+
+
+
+	// Save the item and its key
+	if (theTable->theStates[theIndex] == kHashSlotRemoved)
+		theTable->numDeleted--;
+
+	theTable->theItems[theIndex]  = theItem;
+	theTable->theKeys[theIndex]   = theKey;
+	theTable->theStates[theIndex] = kHashSlotFull;
+	theTable->numItems++;
 }
 
 
@@ -169,40 +231,64 @@ e3hash_add_key(E3HashTableNodePtr theNode, TQ3ObjectType theKey, void *theItem)
 
 
 //=============================================================================
-//      e3hash_update_stats : Update the table stats.
+//      e3hash_resize : Rebuild a table with a new size.
 //-----------------------------------------------------------------------------
-static void
-e3hash_update_stats(E3HashTablePtr theTable)
-{	TQ3Uns32				n, itemCount, slotCount;
-	E3HashTableNodePtr		theNode;
+//		Note :	Also discards any removed-item slots.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3hash_resize(E3HashTablePtr theTable, TQ3Uns32 tableSize)
+{	TQ3ObjectType	*oldKeys;
+	TQ3Uns8			*oldStates;
+	void			**oldItems;
+	TQ3Uns32		n, oldSize;
 
 
 
-	// Validate our parameters
-	Q3_ASSERT_VALID_PTR(theTable);
+	// Allocate the new slots
+	oldItems  = theTable->theItems;
+	oldKeys   = theTable->theKeys;
+	oldStates = theTable->theStates;
+	oldSize   = theTable->tableSize;
 
+	if (e3hash_allocate_slots(theTable, tableSize) != kQ3Success)
+		{
+		theTable->theItems  = oldItems;
+		theTable->theKeys   = oldKeys;
+		theTable->theStates = oldStates;
+		return(kQ3Failure);
+		}
 
 
-	// Recalculate the table stats
-	theTable->collisionMax     = 0;
-	theTable->collisionAverage = 0.0f;
-	itemCount                  = 0;
-	slotCount                  = 0;
-	
-	for (n = 0; n < theTable->tableSize; n++)
+
+	// Move the items across, and dispose of the old slots
+	for (n = 0; n < oldSize; n++)
 		{
-		theNode = theTable->theTable[n];
-		if (theNode != NULL)
-			{
-			if (theNode->numItems > theTable->collisionMax)
-				theTable->collisionMax = theNode->numItems;
-		
-			itemCount += theNode->numItems;
-			slotCount++;
-			}
+		if (oldStates[n] == kHashSlotFull)
+			e3hash_store(theTable, oldKeys[n], oldItems[n]);
 		}
-	
-	theTable->collisionAverage = (float) itemCount / (float) slotCount;
+
+	Q3Memory_Free(&oldItems);
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3hash_probe_length : Get the number of slots examined to find a key.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3hash_probe_length(const E3HashTable *theTable, TQ3Uns32 theIndex)
+{	TQ3Uns32		firstIndex;
+
+
+
+	// Measure the distance from the key's first slot
+	firstIndex = e3hash_index(theTable, theTable->theKeys[theIndex]);
+
+	return(((theIndex - firstIndex) & (theTable->tableSize - 1)) + 1);
 }
 
 
@@ -214,16 +300,20 @@ e3hash_update_stats(E3HashTablePtr theTable)
 //-----------------------------------------------------------------------------
 //      E3HashTable_Create : Create a hash table.
 //-----------------------------------------------------------------------------
+//		Note :	The table size is the initial number of slots, and is rounded
+//				up to a power of 2. The table will grow as required to keep it
+//				at most half full.
+//-----------------------------------------------------------------------------
 #pragma mark -
 E3HashTablePtr
 E3HashTable_Create(TQ3Uns32 tableSize)
 {	E3HashTablePtr		theTable;
+	TQ3Uns32			numSlots;
 
 
 
 	// Validate our parameters
-	Q3_ASSERT(tableSize != 0 && tableSize < 10000);
-	Q3_ASSERT( (tableSize & (tableSize - 1)) == 0 );	// power of 2
+	Q3_ASSERT(tableSize != 0 && tableSize <= 0x80000000U);
 
 
 
@@ -232,17 +322,11 @@ E3HashTable_Create(TQ3Uns32 tableSize)
 	if (theTable != NULL)
 		{
 		// Initialise the table
-		theTable->collisionMax     = 0;
-		theTable->collisionAverage = 0.0f;
-		theTable->tableSize        = tableSize;
-		theTable->numItems         = 0;
-		theTable->theTable = (E3HashTableNodePtr *) Q3Memory_AllocateClear(static_cast<TQ3Uns32>(sizeof(E3HashTableNodePtr)
-																			* theTable->tableSize));
-
-
+		numSlots = 1;
+		while (numSlots < tableSize)
+			numSlots *= 2;
 
-		// Handle failure
-		if (theTable->theTable == NULL)
+		if (e3hash_allocate_slots(theTable, numSlots) != kQ3Success)
 			{
 			Q3Memory_Free(&theTable);
 			theTable = NULL;
@@ -261,10 +345,7 @@ E3HashTable_Create(TQ3Uns32 tableSize)
 //-----------------------------------------------------------------------------
 void
 E3HashTable_Destroy(E3HashTablePtr *theTable)
-{	E3HashTablePtr			tablePtr;
-	E3HashTableNodePtr		theNode;
-	TQ3Uns32				n;
-
+{
 
 
 	// Validate our parameters
@@ -273,22 +354,8 @@ E3HashTable_Destroy(E3HashTablePtr *theTable)
 
 
 
-	// Dispose of the table items
-	tablePtr = *theTable;
-	for (n = 0; n < tablePtr->tableSize; n++)
-		{
-		theNode = tablePtr->theTable[n];
-		if (theNode != NULL)
-			{
-			Q3Memory_Free(&theNode->theItems);
-			Q3Memory_Free(&tablePtr->theTable[n]);
-			}
-		}
-
-
-
-	// Dispose of the table itself
-	Q3Memory_Free(&tablePtr->theTable);
+	// Dispose of the table
+	Q3Memory_Free(&(*theTable)->theItems);
 	Q3Memory_Free(theTable);
 }
 
@@ -304,8 +371,7 @@ E3HashTable_Destroy(E3HashTablePtr *theTable)
 //-----------------------------------------------------------------------------
 TQ3Status
 E3HashTable_Add(E3HashTablePtr theTable, TQ3ObjectType theKey, void *theItem)
-{	TQ3Status				qd3dStatus;
-	E3HashTableNodePtr		*theNode;
+{	TQ3Uns32		tableSize;
 
 
 
@@ -320,32 +386,24 @@ E3HashTable_Add(E3HashTablePtr theTable, TQ3ObjectType theKey, void *theItem)
 
 
 
-	// Find the node which should contain the item
-	theNode = e3hash_find_node(theTable, theKey);
-	Q3_ASSERT_VALID_PTR(theNode);
-
-
-
-	// If the node doesn't exist, create it
-	if (*theNode == NULL)
+	// Grow the table if it would become more than half full
+	//
+	// If the table is cluttered with removed items we may not need to grow it,
+	// but simply rebuild it at the same size.
+	if ((theTable->numItems + theTable->numDeleted + 1) * 2 > theTable->tableSize)
 		{
-		*theNode = (E3HashTableNodePtr) Q3Memory_AllocateClear(sizeof(E3HashTableNode));
-		if (*theNode == NULL)
+		tableSize = theTable->tableSize;
+		while ((theTable->numItems + 1) * 2 > tableSize)
+			tableSize *= 2;
+		
+		if (e3hash_resize(theTable, tableSize) != kQ3Success)
 			return(kQ3Failure);
 		}
 
 
 
-	// Add the item to the node
-	qd3dStatus = e3hash_add_key(*theNode, theKey, theItem);
-	if (qd3dStatus != kQ3Success)
-		return(qd3dStatus);
-
-
-
-	// Update the table
-	theTable->numItems++;
-	e3hash_update_stats(theTable);
+	// Add the item
+	e3hash_store(theTable, theKey, theItem);
 
 	return(kQ3Success);
 }
@@ -360,9 +418,7 @@ E3HashTable_Add(E3HashTablePtr theTable, TQ3ObjectType theKey, void *theItem)
 //		Note : The item must be present in the hash table.
 //-----------------------------------------------------------------------------
 void E3HashTable_Remove(E3HashTablePtr theTable, TQ3ObjectType theKey)
-{	E3HashTableNodePtr		theNode, *nodePtr;
-	TQ3Boolean				foundItem;
-	TQ3Uns32				n;
+{	TQ3Int32		theIndex;
 
 
 
@@ -371,45 +427,29 @@ void E3HashTable_Remove(E3HashTablePtr theTable, TQ3ObjectType theKey)
 
 
 
-	// Find the node which should contain the item
-	nodePtr = e3hash_find_node(theTable, theKey);
-	Q3_ASSERT_VALID_PTR(nodePtr);
-	
-	theNode = *nodePtr;
-	Q3_ASSERT_VALID_PTR(nodePtr);
-
+	// Find the slot which contains the item
+	theIndex = e3hash_find_slot(theTable, theKey);
+	Q3_ASSERT(theIndex >= 0);
+	Q3_ASSERT(theTable->numItems >= 1);
 
-
-	// Remove the item from the node
-	foundItem = kQ3False;
-	for (n = 0; n < theNode->numItems && !foundItem; n++)
-		{
-		if (theKey == theNode->theItems[n].theKey)
-			{
-			// Shift the items above this item, if any, done by 1
-			if (n != (theNode->numItems - 1))
-				memmove(&theNode->theItems[n],
-						&theNode->theItems[n+1],
-						(theNode->numItems - n - 1) * sizeof(E3HashTableItem));
-			
-			
-			// Decrement the node count and break
-			Q3_ASSERT(theNode->numItems >= 1);
-			theNode->numItems--;
-			foundItem = kQ3True;
-			}
-		}
+	if (theIndex < 0)
+		return;
 
 
 
-	// Update the table
-	Q3_ASSERT(foundItem);
-	Q3_ASSERT(theTable->numItems >= 1);
+	// Mark the slot as removed
+	//
+	// The slot can't simply be emptied, since that would cut short the probe
+	// sequence of any keys stored beyond it. Once the table is empty, however,
+	// we can discard all of the removed slots.
+	theTable->theStates[theIndex] = kHashSlotRemoved;
+	theTable->numItems--;
+	theTable->numDeleted++;
 
-	if (foundItem)
+	if (theTable->numItems == 0)
 		{
-		theTable->numItems--;
-		e3hash_update_stats(theTable);
+		Q3Memory_Clear(theTable->theStates, static_cast<TQ3Uns32>(sizeof(TQ3Uns8) * theTable->tableSize));
+		theTable->numDeleted = 0;
 		}
 }
 
@@ -424,10 +464,8 @@ void E3HashTable_Remove(E3HashTablePtr theTable, TQ3ObjectType theKey)
 //-----------------------------------------------------------------------------
 void *
 E3HashTable_Find(E3HashTablePtr theTable, TQ3ObjectType theKey)
-{	E3HashTableNodePtr		theNode, *nodePtr;
-	E3HashTableItemPtr		theItem;
-	TQ3Uns32				n, numItems;
-	
+{	TQ3Int32		theIndex;
+
 
 
 	// Validate our parameters
@@ -435,32 +473,12 @@ E3HashTable_Find(E3HashTablePtr theTable, TQ3ObjectType theKey)
 
 
 
-	// Find the node which should contain the item
-	nodePtr = e3hash_find_node(theTable, theKey);
-
-
-
-	// If the node is empty, we're done
-	if (*nodePtr == NULL)
+	// Find the slot which contains the item
+	theIndex = e3hash_find_slot(theTable, theKey);
+	if (theIndex < 0)
 		return(NULL);
 
-	theNode = *nodePtr;
-	Q3_ASSERT_VALID_PTR(theNode);
-
-
-
-	// Otherwise, look for the item
-	theItem = theNode->theItems;
-	numItems = theNode->numItems;
-	for (n = 0; n < numItems; ++n)
-		{
-		if (theKey == theItem->theKey)
-			return(theItem->theItem);
-		
-		++theItem;
-		}
-
-	return(NULL);
+	return(theTable->theItems[theIndex]);
 }
 
 
@@ -470,13 +488,13 @@ E3HashTable_Find(E3HashTablePtr theTable, TQ3ObjectType theKey)
 //=============================================================================
 //      E3HashTable_Iterate : Iterate over the items in a hash table.
 //-----------------------------------------------------------------------------
+//		Note :	The iterator may remove the item it is passed, but must not
+//				add items to the table.
+//-----------------------------------------------------------------------------
 TQ3Status
 E3HashTable_Iterate(E3HashTablePtr theTable, TQ3HashTableIterator theIterator, void *userData)
 {	TQ3Status				qd3dStatus = kQ3Success;
-	E3HashTableItemPtr		theItem;
-	E3HashTableNodePtr		theNode;
 	TQ3Uns32				n;
-	TQ3Int32				m;	// must be signed due to backwards loop
 
 
 
@@ -487,26 +505,13 @@ E3HashTable_Iterate(E3HashTablePtr theTable, TQ3HashTableIterator theIterator, v
 
 
 	// Iterate over the table
-	for (n = 0; n < theTable->tableSize; n++)
-	{
-		theNode = theTable->theTable[n];
-		
-		if ( theNode != NULL )
+	//
+	// Removing an item never moves any other item, so we see every item once.
+	for (n = 0; n < theTable->tableSize && qd3dStatus == kQ3Success; n++)
 		{
-			// Iterate backwards in case the iterator function removes any items
-			for (m = theNode->numItems - 1; m >= 0; --m)
-			{
-				theItem = &theNode->theItems[m];
-				
-				qd3dStatus = theIterator(theTable, theItem->theKey, theItem->theItem, userData);
-				if (qd3dStatus != kQ3Success)
-					break;
-			}
+		if (theTable->theStates[n] == kHashSlotFull)
+			qd3dStatus = theIterator(theTable, theTable->theKeys[n], theTable->theItems[n], userData);
 		}
-
-		if (qd3dStatus != kQ3Success)
-			break;
-	}
 	
 	return(qd3dStatus);
 }
@@ -518,9 +523,12 @@ E3HashTable_Iterate(E3HashTablePtr theTable, TQ3HashTableIterator theIterator, v
 //=============================================================================
 //      E3HashTable_GetCollisionMax : Get the max collision count for a table.
 //-----------------------------------------------------------------------------
+//		Note :	Returns the largest number of slots examined to find an item.
+//-----------------------------------------------------------------------------
 TQ3Uns32
 E3HashTable_GetCollisionMax(E3HashTablePtr theTable)
-{
+{	TQ3Uns32		n, collisionMax;
+
 
 
 	// Validate our parameters
@@ -528,8 +536,16 @@ E3HashTable_GetCollisionMax(E3HashTablePtr theTable)
 
 
 
-	// Get the value
-	return(theTable->collisionMax);
+	// Calculate the value
+	collisionMax = 0;
+	
+	for (n = 0; n < theTable->tableSize; n++)
+		{
+		if (theTable->theStates[n] == kHashSlotFull)
+			collisionMax = E3Num_Max(collisionMax, e3hash_probe_length(theTable, n));
+		}
+
+	return(collisionMax);
 }
 
 
@@ -539,9 +555,12 @@ E3HashTable_GetCollisionMax(E3HashTablePtr theTable)
 //=============================================================================
 //      E3HashTable_GetCollisionAverage : Get the average collision count.
 //-----------------------------------------------------------------------------
+//		Note :	Returns the average number of slots examined to find an item.
+//-----------------------------------------------------------------------------
 float
 E3HashTable_GetCollisionAverage(E3HashTablePtr theTable)
-{
+{	TQ3Uns32		n, probeTotal;
+
 
 
 	// Validate our parameters
@@ -549,8 +568,19 @@ E3HashTable_GetCollisionAverage(E3HashTablePtr theTable)
 
 
 
-	// Get the value
-	return(theTable->collisionAverage);
+	// Calculate the value
+	if (theTable->numItems == 0)
+		return(0.0f);
+
+	probeTotal = 0;
+	
+	for (n = 0; n < theTable->tableSize; n++)
+		{
+		if (theTable->theStates[n] == kHashSlotFull)
+			probeTotal += e3hash_probe_length(theTable, n);
+		}
+
+	return((float) probeTotal / (float) theTable->numItems);
 }
 
 
@@ -0,0 +1,414 @@
+/*  NAME:
+        E3InstancePool.c
+
+    DESCRIPTION:
+        Size-class pools for object instance data.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "E3Prefix.h"
+#include "E3Pool.h"
+#include "E3InstancePool.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+//		Note :	Instances are pooled by size, rounded up to a multiple of the
+//				pool granularity. Larger instances are allocated directly.
+//
+//				Each thread keeps a short list of free items for each size,
+//				and only takes the pool's lock to move a batch of items to or
+//				from that list.
+//-----------------------------------------------------------------------------
+const TQ3Uns32 kInstancePoolGranularity				= 16;
+const TQ3Uns32 kInstancePoolNumSizes				= 32;
+const TQ3Uns32 kInstancePoolBlockBytes				= 16 * 1024;
+const TQ3Uns32 kInstancePoolMinBlockLength			= 16;
+const TQ3Uns32 kInstancePoolThreadBatch				= 16;
+const TQ3Uns32 kInstancePoolThreadMax				= 2 * kInstancePoolThreadBatch;
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+// Pool for one size of instance
+typedef struct TE3InstanceSizePool {
+	E3SpinLock			theLock;
+	TE3Pool				thePool;
+	TQ3Uns32			numBlocks;
+	TQ3Uns32			numFreeItems;
+} TE3InstanceSizePool;
+
+
+// Per-thread free lists
+typedef struct TE3InstanceThreadCache {
+	TQ3Uns32			poolGeneration;
+	TE3PoolItem			*freeItems[kInstancePoolNumSizes];
+	TQ3Uns32			numFreeItems[kInstancePoolNumSizes];
+} TE3InstanceThreadCache;
+
+
+
+
+
+//=============================================================================
+//      Static variables
+//-----------------------------------------------------------------------------
+//		Note :	The pool generation changes whenever the pools are released, so
+//				that threads discard any free items they were holding.
+//-----------------------------------------------------------------------------
+static TE3InstanceSizePool						sInstancePools[kInstancePoolNumSizes];
+static volatile TQ3Uns32						sInstancePoolGeneration = 1;
+static E3_THREAD_LOCAL TE3InstanceThreadCache	sInstanceThreadCache;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      e3instancepool_size_index : Get the pool index for a size.
+//-----------------------------------------------------------------------------
+//		Note :	Returns kInstancePoolNumSizes if the size is not pooled.
+//-----------------------------------------------------------------------------
+static inline TQ3Uns32
+e3instancepool_size_index(TQ3Uns32 theSize)
+{
+	if (!QUESA_USE_INSTANCE_POOLS)
+		return(kInstancePoolNumSizes);
+
+	if (theSize == 0)
+		return(0);
+
+	TQ3Uns32 sizeIndex = (theSize - 1) / kInstancePoolGranularity;
+
+	return(sizeIndex < kInstancePoolNumSizes ? sizeIndex : kInstancePoolNumSizes);
+}
+
+
+
+
+
+//=============================================================================
+//      e3instancepool_item_size : Get the item size of a pool.
+//-----------------------------------------------------------------------------
+static inline TQ3Uns32
+e3instancepool_item_size(TQ3Uns32 sizeIndex)
+{
+	return((sizeIndex + 1) * kInstancePoolGranularity);
+}
+
+
+
+
+
+//=============================================================================
+//      e3instancepool_block_length : Get the number of items in a block.
+//-----------------------------------------------------------------------------
+static inline TQ3Uns32
+e3instancepool_block_length(TQ3Uns32 sizeIndex)
+{	TQ3Uns32		blockLength = kInstancePoolBlockBytes / e3instancepool_item_size(sizeIndex);
+
+	return(blockLength > kInstancePoolMinBlockLength ? blockLength : kInstancePoolMinBlockLength);
+}
+
+
+
+
+
+//=============================================================================
+//      e3instancepool_thread_cache : Get the calling thread's free lists.
+//-----------------------------------------------------------------------------
+static TE3InstanceThreadCache *
+e3instancepool_thread_cache(void)
+{	TE3InstanceThreadCache		*theCache = &sInstanceThreadCache;
+
+
+
+	// Forget any items from pools which have since been released
+	if (theCache->poolGeneration != sInstancePoolGeneration)
+		{
+		Q3Memory_Clear(theCache, sizeof(TE3InstanceThreadCache));
+		theCache->poolGeneration = sInstancePoolGeneration;
+		}
+
+	return(theCache);
+}
+
+
+
+
+
+//=============================================================================
+//      e3instancepool_refill : Move a batch of items to a thread's list.
+//-----------------------------------------------------------------------------
+static void
+e3instancepool_refill(TE3InstanceThreadCache *theCache, TQ3Uns32 sizeIndex)
+{	TE3InstanceSizePool		*thePool  = &sInstancePools[sizeIndex];
+	TQ3Uns32				itemSize    = e3instancepool_item_size(sizeIndex);
+	TQ3Uns32				blockLength = e3instancepool_block_length(sizeIndex);
+	TE3PoolItem				*theItem;
+	TQ3Uns32				n;
+
+
+
+	// Take a batch of items from the pool
+	E3SpinLocker	theLocker(thePool->theLock);
+
+	for (n = 0; n < kInstancePoolThreadBatch; ++n)
+		{
+		// Note when the pool needs a new block
+		TQ3Boolean isNewBlock = (TQ3Boolean) (thePool->thePool.headFreeItemPtr_private == NULL);
+
+		theItem = E3Pool_AllocateTagged(&thePool->thePool, kInstancePoolGranularity, itemSize, blockLength, NULL);
+		if (theItem == NULL)
+			break;
+
+		if (isNewBlock)
+			{
+			thePool->numBlocks++;
+			thePool->numFreeItems += blockLength;
+			}
+
+		thePool->numFreeItems--;
+
+
+
+		// And add it to the thread's list
+		theItem->nextFreeItemPtr_private = theCache->freeItems[sizeIndex];
+		theCache->freeItems[sizeIndex]   = theItem;
+		theCache->numFreeItems[sizeIndex]++;
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      e3instancepool_drain : Return a batch of items from a thread's list.
+//-----------------------------------------------------------------------------
+static void
+e3instancepool_drain(TE3InstanceThreadCache *theCache, TQ3Uns32 sizeIndex)
+{	TE3InstanceSizePool		*thePool = &sInstancePools[sizeIndex];
+	TE3PoolItem				*theItem;
+	TQ3Uns32				n;
+
+
+
+	// Return a batch of items to the pool
+	E3SpinLocker	theLocker(thePool->theLock);
+
+	for (n = 0; n < kInstancePoolThreadBatch && theCache->freeItems[sizeIndex] != NULL; ++n)
+		{
+		theItem = theCache->freeItems[sizeIndex];
+		theCache->freeItems[sizeIndex] = theItem->nextFreeItemPtr_private;
+		theCache->numFreeItems[sizeIndex]--;
+
+		E3Pool_Free(&thePool->thePool, &theItem);
+		thePool->numFreeItems++;
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      E3InstancePool_Allocate : Allocate a cleared block of instance data.
+//-----------------------------------------------------------------------------
+void *
+E3InstancePool_Allocate(TQ3Uns32 theSize)
+{	TQ3Uns32		sizeIndex = e3instancepool_size_index(theSize);
+
+
+
+	// Allocate large instances directly
+	if (sizeIndex == kInstancePoolNumSizes)
+		return(Q3Memory_AllocateClear(theSize));
+
+
+
+	// Take an item from the thread's list, refilling it if necessary
+	TE3InstanceThreadCache *theCache = e3instancepool_thread_cache();
+	
+	if (theCache->freeItems[sizeIndex] == NULL)
+		e3instancepool_refill(theCache, sizeIndex);
+
+	TE3PoolItem *theItem = theCache->freeItems[sizeIndex];
+	if (theItem == NULL)
+		return(NULL);
+
+	theCache->freeItems[sizeIndex] = theItem->nextFreeItemPtr_private;
+	theCache->numFreeItems[sizeIndex]--;
+
+
+
+	// Clear the item
+	Q3Memory_Clear(theItem, theSize);
+
+	return(theItem);
+}
+
+
+
+
+
+//=============================================================================
+//      E3InstancePool_Free : Free a block of instance data.
+//-----------------------------------------------------------------------------
+//		Note :	The size must be the size the block was allocated with.
+//-----------------------------------------------------------------------------
+void
+E3InstancePool_Free(void **thePtr, TQ3Uns32 theSize)
+{	TQ3Uns32		sizeIndex = e3instancepool_size_index(theSize);
+
+
+
+	// Validate our parameters
+	Q3_ASSERT_VALID_PTR(thePtr);
+
+	if (*thePtr == NULL)
+		return;
+
+
+
+	// Free large instances directly
+	if (sizeIndex == kInstancePoolNumSizes)
+		{
+		Q3Memory_Free(thePtr);
+		return;
+		}
+
+
+
+	// Add the item to the thread's list, returning a batch to the pool if
+	// the list has grown too long
+	TE3InstanceThreadCache *theCache = e3instancepool_thread_cache();
+	TE3PoolItem            *theItem  = (TE3PoolItem *) *thePtr;
+
+	theItem->nextFreeItemPtr_private = theCache->freeItems[sizeIndex];
+	theCache->freeItems[sizeIndex]   = theItem;
+	theCache->numFreeItems[sizeIndex]++;
+
+	if (theCache->numFreeItems[sizeIndex] > kInstancePoolThreadMax)
+		e3instancepool_drain(theCache, sizeIndex);
+
+	*thePtr = NULL;
+}
+
+
+
+
+
+//=============================================================================
+//      E3InstancePool_Destroy : Release the pools.
+//-----------------------------------------------------------------------------
+//		Note :	Called as Quesa terminates, once all objects have been freed.
+//				Items held by other threads are discarded by those threads
+//				the next time they use the pools.
+//-----------------------------------------------------------------------------
+void
+E3InstancePool_Destroy(void)
+{	TQ3Uns32		n;
+
+
+
+	// Release the pools
+	for (n = 0; n < kInstancePoolNumSizes; ++n)
+		{
+		E3SpinLocker	theLocker(sInstancePools[n].theLock);
+
+		E3Pool_Destroy(&sInstancePools[n].thePool);
+		E3Pool_Create(&sInstancePools[n].thePool);
+
+		sInstancePools[n].numBlocks    = 0;
+		sInstancePools[n].numFreeItems = 0;
+		}
+
+
+
+	// Invalidate the per-thread lists
+	E3Atomic_Increment(&sInstancePoolGeneration);
+}
+
+
+
+
+
+//=============================================================================
+//      E3InstancePool_GetInfo : Get the occupancy of the pool for a size.
+//-----------------------------------------------------------------------------
+void
+E3InstancePool_GetInfo(TQ3Uns32 theSize, TE3InstancePoolInfo *theInfo)
+{	TQ3Uns32		sizeIndex = e3instancepool_size_index(theSize);
+
+
+
+	// Validate our parameters
+	Q3_ASSERT_VALID_PTR(theInfo);
+
+	Q3Memory_Clear(theInfo, sizeof(TE3InstancePoolInfo));
+
+	if (sizeIndex == kInstancePoolNumSizes)
+		return;
+
+
+
+	// Get the occupancy
+	TE3InstanceSizePool		*thePool = &sInstancePools[sizeIndex];
+	E3SpinLocker			theLocker(thePool->theLock);
+
+	theInfo->itemSize      = e3instancepool_item_size(sizeIndex);
+	theInfo->numBlocks     = thePool->numBlocks;
+	theInfo->numItems      = thePool->numBlocks * e3instancepool_block_length(sizeIndex);
+	theInfo->numItemsInUse = theInfo->numItems - thePool->numFreeItems;
+}
+
@@ -0,0 +1,110 @@
+/*  NAME:
+        E3InstancePool.h
+
+    DESCRIPTION:
+        Size-class pools for object instance data.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+#ifndef E3INSTANCEPOOL_HDR
+#define E3INSTANCEPOOL_HDR
+//=============================================================================
+//      Build constants
+//-----------------------------------------------------------------------------
+// Allocate object instance data from per-size pools
+#ifndef QUESA_USE_INSTANCE_POOLS
+	#define QUESA_USE_INSTANCE_POOLS						1
+#endif
+
+
+
+
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+// Pool occupancy
+typedef struct TE3InstancePoolInfo {
+	TQ3Uns32			itemSize;			// 0 if the size is not pooled
+	TQ3Uns32			numBlocks;
+	TQ3Uns32			numItems;
+	TQ3Uns32			numItemsInUse;		// Includes items cached by threads
+} TE3InstancePoolInfo;
+
+
+
+
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+// Allocate/free a cleared block of instance data
+void				*E3InstancePool_Allocate(TQ3Uns32 theSize);
+void				E3InstancePool_Free(void **thePtr, TQ3Uns32 theSize);
+
+
+// Release the pools
+void				E3InstancePool_Destroy(void);
+
+
+// Get the occupancy of the pool used for a size
+void				E3InstancePool_GetInfo(TQ3Uns32 theSize, TE3InstancePoolInfo *theInfo);
+
+
+
+
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -132,6 +132,7 @@
 
 // Quesa (private, platform independent)
 #include "E3Debug.h"
+#include "E3Threads.h"
 #include "E3Globals.h"
 #include "E3Main.h"
 #include "E3Utils.h"
@@ -186,6 +187,16 @@
 #endif
 
 
+// Use SSE2 for the batch math functions?
+#ifndef QUESA_USE_SSE2
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+		#define QUESA_USE_SSE2									1
+	#else
+		#define QUESA_USE_SSE2									0
+	#endif
+#endif
+
+
 // Are C++ exceptions enabled?
 #ifndef QUESA_USE_EXCEPTIONS
 	#ifdef __MWERKS__
@@ -0,0 +1,505 @@
+/*  NAME:
+        E3Threads.h
+
+    DESCRIPTION:
+        Thread support for Quesa.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+#ifndef E3THREADS_HDR
+#define E3THREADS_HDR
+//=============================================================================
+//      Build constants
+//-----------------------------------------------------------------------------
+// Allow Quesa to be used from several threads at once
+#ifndef QUESA_SUPPORT_THREADS
+	#if QUESA_OS_MACINTOSH && TARGET_API_MAC_OS8
+		#define QUESA_SUPPORT_THREADS							0
+	#else
+		#define QUESA_SUPPORT_THREADS							1
+	#endif
+#endif
+
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#if QUESA_SUPPORT_THREADS && !QUESA_OS_WIN32
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+
+
+
+
+//=============================================================================
+//      Notes
+//-----------------------------------------------------------------------------
+//		Quesa can be driven from several threads at once, with the
+//		following rules:
+//
+//		-	Q3Initialize and Q3Exit, and the registration and unregistration
+//			of classes (including the loading of plug-ins), must be performed
+//			while no other thread is using Quesa. The class tree is read-only
+//			at all other times, except for its method caches.
+//
+//		-	The Error Manager state is per-thread, so Q3Error_Get and friends
+//			return the errors posted by the calling thread. Error handlers
+//			are process-wide, and may be invoked on any thread.
+//
+//		-	Shared objects may be referenced and disposed of from several
+//			threads at once, however an object must not be edited on one
+//			thread while another thread is using it.
+//
+//		-	Objects which are not being edited may be submitted, picked and
+//			bounded from several threads at once. The state which Quesa
+//			builds on demand for an object, such as the member caches and
+//			pick trees of groups, the automatic bounds of display groups,
+//			the decomposed forms of geometries and the pick trees of
+//			TriMeshes, is either built privately and published atomically
+//			or built under a lock, and is never changed while in use.
+//
+//		-	Several threads may hold read-only locks on the same TriMesh,
+//			and debug builds may record objects for leak checking while
+//			they are created and disposed of on several threads.
+//
+//		In practice, each thread should own its views and the objects it
+//		edits, and share read-only objects such as textures, geometries,
+//		and the groups which hold them.
+//
+//		Quesa may also spread work across threads of its own, such as the
+//		rays of a world rays pick, with E3Thread_RunParallel.
+//
+//		Threads support can be disabled by defining QUESA_SUPPORT_THREADS
+//		as 0, in which case the primitives below reduce to plain operations.
+//-----------------------------------------------------------------------------
+
+
+
+
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+// Most threads E3Thread_RunParallel will run a function on
+#define kE3ThreadsMax										32
+
+
+
+
+
+//=============================================================================
+//      Macros
+//-----------------------------------------------------------------------------
+// Storage class for per-thread variables
+//
+// Per-thread variables must be plain data with a constant initialiser.
+#if QUESA_SUPPORT_THREADS
+	#if defined(_MSC_VER)
+		#define E3_THREAD_LOCAL								__declspec(thread)
+	#else
+		#define E3_THREAD_LOCAL								__thread
+	#endif
+#else
+	#define E3_THREAD_LOCAL
+#endif
+
+
+
+
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+// Spin lock, for guarding short and infrequent updates to shared state.
+//
+// Spin locks are not recursive, and must be initialised to 0.
+typedef volatile TQ3Uns32 E3SpinLock;
+
+
+// Function run by E3Thread_RunParallel
+typedef void (*E3ThreadProc)(void *userData);
+
+
+// Function and data for a thread started by E3Thread_RunParallel
+typedef struct E3ThreadStart {
+	E3ThreadProc		theProc;
+	void				*userData;
+} E3ThreadStart;
+
+
+
+
+
+//=============================================================================
+//      Inline functions
+//-----------------------------------------------------------------------------
+//      E3Atomic_Increment : Atomically increment a value.
+//-----------------------------------------------------------------------------
+//		Note : Returns the incremented value.
+//-----------------------------------------------------------------------------
+inline TQ3Uns32
+E3Atomic_Increment(volatile TQ3Uns32 *theValue)
+{
+#if !QUESA_SUPPORT_THREADS
+	return(++(*theValue));
+
+#elif QUESA_OS_WIN32
+	return((TQ3Uns32) InterlockedIncrement((volatile LONG *) theValue));
+
+#else
+	return(__atomic_add_fetch(theValue, 1, __ATOMIC_ACQ_REL));
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Atomic_Decrement : Atomically decrement a value.
+//-----------------------------------------------------------------------------
+//		Note : Returns the decremented value.
+//-----------------------------------------------------------------------------
+inline TQ3Uns32
+E3Atomic_Decrement(volatile TQ3Uns32 *theValue)
+{
+#if !QUESA_SUPPORT_THREADS
+	return(--(*theValue));
+
+#elif QUESA_OS_WIN32
+	return((TQ3Uns32) InterlockedDecrement((volatile LONG *) theValue));
+
+#else
+	return(__atomic_sub_fetch(theValue, 1, __ATOMIC_ACQ_REL));
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Atomic_LoadPointer : Load a pointer published by another thread.
+//-----------------------------------------------------------------------------
+//		Note :	Has acquire semantics: anything written before the pointer
+//				was stored with E3Atomic_StorePointer will be visible.
+//-----------------------------------------------------------------------------
+inline void *
+E3Atomic_LoadPointer(void * const volatile *thePtr)
+{
+#if !QUESA_SUPPORT_THREADS
+	return(*thePtr);
+
+#elif QUESA_OS_WIN32
+	void	*theValue = *thePtr;
+	MemoryBarrier();
+	return(theValue);
+
+#else
+	return(__atomic_load_n(thePtr, __ATOMIC_ACQUIRE));
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Atomic_StorePointer : Publish a pointer to other threads.
+//-----------------------------------------------------------------------------
+//		Note :	Has release semantics: see E3Atomic_LoadPointer.
+//-----------------------------------------------------------------------------
+inline void
+E3Atomic_StorePointer(void * volatile *thePtr, void *theValue)
+{
+#if !QUESA_SUPPORT_THREADS
+	*thePtr = theValue;
+
+#elif QUESA_OS_WIN32
+	MemoryBarrier();
+	*thePtr = theValue;
+
+#else
+	__atomic_store_n(thePtr, theValue, __ATOMIC_RELEASE);
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Atomic_LoadUns32 : Load a value published by another thread.
+//-----------------------------------------------------------------------------
+//		Note :	Has acquire semantics, as E3Atomic_LoadPointer.
+//-----------------------------------------------------------------------------
+inline TQ3Uns32
+E3Atomic_LoadUns32(const volatile TQ3Uns32 *theValue)
+{
+#if !QUESA_SUPPORT_THREADS
+	return(*theValue);
+
+#elif QUESA_OS_WIN32
+	TQ3Uns32	theResult = *theValue;
+	MemoryBarrier();
+	return(theResult);
+
+#else
+	return(__atomic_load_n(theValue, __ATOMIC_ACQUIRE));
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Atomic_StoreUns32 : Publish a value to other threads.
+//-----------------------------------------------------------------------------
+//		Note :	Has release semantics, as E3Atomic_StorePointer.
+//-----------------------------------------------------------------------------
+inline void
+E3Atomic_StoreUns32(volatile TQ3Uns32 *theValue, TQ3Uns32 newValue)
+{
+#if !QUESA_SUPPORT_THREADS
+	*theValue = newValue;
+
+#elif QUESA_OS_WIN32
+	MemoryBarrier();
+	*theValue = newValue;
+
+#else
+	__atomic_store_n(theValue, newValue, __ATOMIC_RELEASE);
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Atomic_CompareAndSwapPointer : Publish a pointer if unchanged.
+//-----------------------------------------------------------------------------
+//		Note :	Stores newValue if the pointer still holds oldValue, with the
+//				semantics of E3Atomic_StorePointer. Returns kQ3True if the
+//				pointer was stored, and kQ3False if another thread changed it
+//				first.
+//-----------------------------------------------------------------------------
+inline TQ3Boolean
+E3Atomic_CompareAndSwapPointer(void * volatile *thePtr, void *oldValue, void *newValue)
+{
+#if !QUESA_SUPPORT_THREADS
+	if (*thePtr != oldValue)
+		return(kQ3False);
+	
+	*thePtr = newValue;
+	return(kQ3True);
+
+#elif QUESA_OS_WIN32
+	return((TQ3Boolean) (InterlockedCompareExchangePointer(thePtr, newValue, oldValue) == oldValue));
+
+#else
+	return((TQ3Boolean) __atomic_compare_exchange_n(thePtr, &oldValue, newValue, false,
+													__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3SpinLock_Lock : Acquire a spin lock.
+//-----------------------------------------------------------------------------
+inline void
+E3SpinLock_Lock(E3SpinLock *theLock)
+{
+#if !QUESA_SUPPORT_THREADS
+	#pragma unused(theLock)
+
+#elif QUESA_OS_WIN32
+	while (InterlockedExchange((volatile LONG *) theLock, 1) != 0)
+		SwitchToThread();
+
+#else
+	while (__atomic_exchange_n(theLock, 1, __ATOMIC_ACQUIRE) != 0)
+		sched_yield();
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3SpinLock_Unlock : Release a spin lock.
+//-----------------------------------------------------------------------------
+inline void
+E3SpinLock_Unlock(E3SpinLock *theLock)
+{
+#if !QUESA_SUPPORT_THREADS
+	#pragma unused(theLock)
+
+#elif QUESA_OS_WIN32
+	InterlockedExchange((volatile LONG *) theLock, 0);
+
+#else
+	__atomic_store_n(theLock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      E3Thread_Entry : Entry point of a thread started by E3Thread_RunParallel.
+//-----------------------------------------------------------------------------
+#if QUESA_SUPPORT_THREADS && QUESA_OS_WIN32
+inline DWORD WINAPI
+E3Thread_Entry(LPVOID theStart)
+{
+	((E3ThreadStart *) theStart)->theProc(((E3ThreadStart *) theStart)->userData);
+	return(0);
+}
+
+#elif QUESA_SUPPORT_THREADS
+inline void *
+E3Thread_Entry(void *theStart)
+{
+	((E3ThreadStart *) theStart)->theProc(((E3ThreadStart *) theStart)->userData);
+	return(NULL);
+}
+#endif
+
+
+
+
+
+//=============================================================================
+//      E3Thread_RunParallel : Run a function on several threads at once.
+//-----------------------------------------------------------------------------
+//		Note :	The function is called on up to numThreads threads, one of
+//				which is the calling thread, and every call has returned by
+//				the time we return.
+//
+//				Threads which can't be started are not made up for, so the
+//				function should take its work from a shared counter rather
+//				than assume how many calls there will be.
+//-----------------------------------------------------------------------------
+inline void
+E3Thread_RunParallel(TQ3Uns32 numThreads, E3ThreadProc theProc, void *userData)
+{
+#if QUESA_SUPPORT_THREADS
+	#if QUESA_OS_WIN32
+	HANDLE			theThreads[kE3ThreadsMax];
+	#else
+	pthread_t		theThreads[kE3ThreadsMax];
+	#endif
+	E3ThreadStart	theStart = { theProc, userData };
+	TQ3Uns32		numStarted = 0;
+
+
+
+	// Start the other threads
+	if (numThreads > kE3ThreadsMax)
+		numThreads = kE3ThreadsMax;
+
+	while (numStarted + 1 < numThreads)
+	{
+	#if QUESA_OS_WIN32
+		theThreads[numStarted] = CreateThread(NULL, 0, E3Thread_Entry, &theStart, 0, NULL);
+		if (theThreads[numStarted] == NULL)
+			break;
+	#else
+		if (pthread_create(&theThreads[numStarted], NULL, E3Thread_Entry, &theStart) != 0)
+			break;
+	#endif
+		numStarted++;
+	}
+#else
+	#pragma unused(numThreads)
+#endif
+
+
+
+	// Do our share, then wait for the others
+	theProc(userData);
+
+#if QUESA_SUPPORT_THREADS
+	while (numStarted > 0)
+	{
+		numStarted--;
+	#if QUESA_OS_WIN32
+		WaitForSingleObject(theThreads[numStarted], INFINITE);
+		CloseHandle(theThreads[numStarted]);
+	#else
+		pthread_join(theThreads[numStarted], NULL);
+	#endif
+	}
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      Classes
+//-----------------------------------------------------------------------------
+//      E3SpinLocker : Holds a spin lock for the lifetime of a scope.
+//-----------------------------------------------------------------------------
+class E3SpinLocker
+{
+public:
+						E3SpinLocker( E3SpinLock& inLock )
+							: mLock( inLock ) { E3SpinLock_Lock( &mLock ); }
+						~E3SpinLocker() { E3SpinLock_Unlock( &mLock ); }
+
+private:
+						E3SpinLocker( const E3SpinLocker& );
+	E3SpinLocker&		operator=( const E3SpinLocker& );
+
+	E3SpinLock&			mLock;
+};
+
+#endif
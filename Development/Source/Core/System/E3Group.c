@@ -51,6 +51,48 @@
 #include "E3Renderer.h"
 #include "E3Style.h"
 #include "E3Main.h"
+#include "E3FastArray.h"
+#include "E3HashTable.h"
+#include "E3GroupPickTree.h"
+#include "E3Pick.h"
+#include "E3Math.h"
+
+#include <algorithm>
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+const TQ3Uns32 kGroupTypeIndexTableSize							= 8;
+const TQ3Uns32 kGroupTypeScanLimit								= 2;
+const TQ3Uns32 kGroupParentsMinHashed							= 8;
+
+
+
+
+
+//=============================================================================
+//      Internal globals
+//-----------------------------------------------------------------------------
+// Source of subtree edit indexes, shared by all groups
+static volatile TQ3Uns32 sGroupSubtreeEditIndex = 0;
+
+
+// Locks for the state which groups share with their members
+//
+// The parents of every object are only accessed with sGroupParentsLock held,
+// since groups in use on different threads may hold the same object. Subtree
+// edit indexes are only settled with sGroupSettleLock held, which is taken
+// before sGroupParentsLock when both are needed.
+static E3SpinLock sGroupParentsLock = 0;
+static E3SpinLock sGroupSettleLock  = 0;
+
+
+// Lock for storing the automatic bounds of display groups
+static E3SpinLock sGroupBoundsLock  = 0;
 
 
 
@@ -59,7 +101,54 @@
 //=============================================================================
 //      Internal types
 //-----------------------------------------------------------------------------
-	
+// Group member cache
+//
+// Holds the positions of a group in iteration order, so that the group can be
+// submitted without walking its lists, and hash tables of slot numbers so
+// that the first position of an object, or the slot of a position, can be
+// found in constant time.
+//
+// The slots holding objects of a type are indexed the first time that type is
+// queried, and the indexes are discarded with the rest of the cache. Since a
+// published cache can be queried by several threads, the type indexes are
+// only accessed with cacheLock held, and an index is not changed once added.
+//
+// The pick tree is kept with the cache, but is validated by the subtree edit
+// index of the group since it also depends on the contents of the members.
+// It is also only accessed with cacheLock held.
+//
+// A group which is shared between threads may have its cache built by several
+// threads at once, so a cache is built privately and then published to the
+// group, and is never changed once published. It is discarded, rather than
+// rebuilt in place, when the group is edited.
+struct E3GroupMembers
+{
+	E3FastArray<TQ3XGroupPosition*>		thePositions ;
+	E3FastArray<TQ3Uns32>				objectSlots ;	// Index+1 into thePositions, or 0
+	E3FastArray<TQ3Uns32>				positionSlots ;	// Index+1 into thePositions, or 0
+	E3SpinLock							cacheLock ;		// Guards typeIndexes and pickTree
+	E3HashTablePtr						typeIndexes ;	// E3FastArray<TQ3Uns32>* of slots, by type
+	E3GroupPickTree*					pickTree ;		// Built on demand, see getpicktree
+	TQ3Uns32							pickTreeIndex ;	// Subtree edit index of pickTree, or 0
+} ;
+
+
+
+// Shared object parents
+//
+// Lists the groups whose member caches hold an object, so that edits to the
+// object can be passed up to them. A group is listed once however many times
+// it holds the object.
+//
+// An object held by many groups (such as a shared geometry or attribute set)
+// also has a hash table of the slot of each group, so that the groups can be
+// unlinked from it in constant time. Objects with few groups search the list.
+struct E3SharedParents
+{
+	E3FastArray<E3Group*>				theGroups ;
+	E3FastArray<TQ3Uns32>				groupSlots ;	// Index+1 into theGroups, or 0; empty if not hashed
+} ;
+
 
 
 class E3LightGroup : public E3Group // This is a leaf class so no other classes use this,
@@ -183,22 +272,12 @@ e3group_new_class_info (
 
 
 //=============================================================================
-//      e3group_new : Group new method.
+//      e3group_members_hash : Get the hash table index of a pointer.
 //-----------------------------------------------------------------------------
-TQ3Status
-e3group_new(TQ3Object theObject, void *privateData, const void *paramData)
+static inline TQ3Uns32
+e3group_members_hash ( const void* thePtr, TQ3Uns32 tableMask )
 	{
-#pragma unused(paramData)
-#pragma unused(privateData)
-	E3Group				*instanceData = (E3Group*) theObject ;
-
-	// Initialise our instance data
-	instanceData->groupData.listHead.next        = &instanceData->groupData.listHead;
-	instanceData->groupData.listHead.prev        = &instanceData->groupData.listHead;
-	instanceData->groupData.listHead.object      = theObject; // points to itself but never used
-	instanceData->groupData.groupPositionSize    = sizeof( TQ3GroupPosition );
-
-	return kQ3Success ;
+	return ( (TQ3Uns32) ( ( (size_t) thePtr ) >> 4 ) * 2654435761U ) & tableMask ;
 	}
 
 
@@ -206,59 +285,70 @@ e3group_new(TQ3Object theObject, void *privateData, const void *paramData)
 
 
 //=============================================================================
-//      e3group_delete : Group delete method.
+//      e3group_members_findslot : Find an object in the member cache.
 //-----------------------------------------------------------------------------
-static void
-e3group_delete(TQ3Object theObject, void *privateData)
-{
-#pragma unused(privateData)
+//		Note :	Returns the index of the hash table entry holding the object,
+//				or of the empty entry where it would be added.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3group_members_findslot ( E3GroupMembers& theMembers, TQ3Object object )
+	{
+	TQ3Uns32 tableMask = theMembers.objectSlots.size () - 1 ;
+	TQ3Uns32 theIndex  = e3group_members_hash ( object, tableMask ) ;
 
+	while ( theMembers.objectSlots[ (int) theIndex ] != 0 )
+		{
+		TQ3Uns32 theSlot = theMembers.objectSlots[ (int) theIndex ] - 1 ;
+		if ( theMembers.thePositions[ (int) theSlot ]->object == object )
+			break ;
 
+		theIndex = ( theIndex + 1 ) & tableMask ;
+		}
 
-	// Empty the group
-	Q3Group_EmptyObjects(theObject);
-}
+	return theIndex ;
+	}
 
 
 
 
 
 //=============================================================================
-//      e3group_acceptobject : Group accept object method.
+//      e3group_members_findposition : Find a position in the member cache.
 //-----------------------------------------------------------------------------
-//		Note : We accept all shared objects
+//		Note :	Returns the index of the hash table entry holding the position,
+//				or of the empty entry where it would be added.
 //-----------------------------------------------------------------------------
-static TQ3Boolean
-e3group_acceptobject(TQ3GroupObject group, TQ3Object object)
-{
-#pragma unused (group)
-	if (Q3Object_GetType (object) == kQ3ObjectTypeShared)
-		return(kQ3True);
-	return(kQ3False);
-}
+static TQ3Uns32
+e3group_members_findposition ( E3GroupMembers& theMembers, const TQ3XGroupPosition* thePosition )
+	{
+	TQ3Uns32 tableMask = theMembers.positionSlots.size () - 1 ;
+	TQ3Uns32 theIndex  = e3group_members_hash ( thePosition, tableMask ) ;
+
+	while ( theMembers.positionSlots[ (int) theIndex ] != 0 )
+		{
+		TQ3Uns32 theSlot = theMembers.positionSlots[ (int) theIndex ] - 1 ;
+		if ( theMembers.thePositions[ (int) theSlot ] == thePosition )
+			break ;
+
+		theIndex = ( theIndex + 1 ) & tableMask ;
+		}
+
+	return theIndex ;
+	}
 
 
 
 
 
 //=============================================================================
-//      e3group_createPosition : Group create position method.
+//      e3group_members_disposeindex : Dispose of a type index.
 //-----------------------------------------------------------------------------
-//		Note : Creates a TQ3XGroupPosition* for a new object
-//-----------------------------------------------------------------------------
-TQ3XGroupPosition*
-E3Group::createPosition ( TQ3Object object )
+static TQ3Status
+e3group_members_disposeindex ( E3HashTablePtr theTable, TQ3ObjectType theKey, void *theItem, void *userData )
 	{
-	if ( GetClass ()->acceptObjectMethod ( (TQ3GroupObject) this, object ) != kQ3False )
-		{		
-		TQ3XGroupPosition* newGroupPosition ;
-		if ( TQ3Status newResult = GetClass ()->positionNewMethod ( &newGroupPosition, object, this ) )
-			return newGroupPosition ;
-		}
-	else
-		E3ErrorManager_PostError(kQ3ErrorInvalidObjectForGroup, kQ3False);
-
-	return NULL ;
+#pragma unused( theTable, theKey, userData )
+	delete (E3FastArray<TQ3Uns32>*) theItem ;
+	return kQ3Success ;
 	}
 
 
@@ -266,32 +356,34 @@ E3Group::createPosition ( TQ3Object object )
 
 
 //=============================================================================
-//      e3group_addobject : Group add object method.
-//-----------------------------------------------------------------------------
-//		Note : objects are added to the end
+//      e3group_members_disposeindexes : Dispose of the type indexes.
 //-----------------------------------------------------------------------------
-static TQ3GroupPosition
-e3group_addobject(TQ3GroupObject group, TQ3Object object)
+static void
+e3group_members_disposeindexes ( E3GroupMembers& theMembers )
 	{
-	return ( (E3Group*) group )->addobject ( object ) ;
+	if ( theMembers.typeIndexes != NULL )
+		{
+		E3HashTable_Iterate ( theMembers.typeIndexes, e3group_members_disposeindex, NULL ) ;
+		E3HashTable_Destroy ( &theMembers.typeIndexes ) ;
+		}
 	}
 
 
-TQ3GroupPosition
-E3Group::addobject ( TQ3Object object )	
+
+
+
+//=============================================================================
+//      e3group_members_dispose : Dispose of a member cache.
+//-----------------------------------------------------------------------------
+static void
+e3group_members_dispose ( E3GroupMembers* theMembers )
 	{
-	TQ3XGroupPosition* newGroupPosition = createPosition ( object ) ;
-	
-	if (newGroupPosition)
+	if ( theMembers != NULL )
 		{
-		// add to end of group list
-		newGroupPosition->next = &groupData.listHead ;
-		newGroupPosition->prev = groupData.listHead.prev ;
-		groupData.listHead.prev->next = newGroupPosition ;
-		groupData.listHead.prev = newGroupPosition ;
-		return (TQ3GroupPosition) newGroupPosition ;
+		e3group_members_disposeindexes ( *theMembers ) ;
+		E3GroupPickTree_Dispose ( theMembers->pickTree ) ;
+		delete theMembers ;
 		}
-	return NULL ;
 	}
 
 
@@ -299,34 +391,66 @@ E3Group::addobject ( TQ3Object object )
 
 
 //=============================================================================
-//      e3group_addbefore : Group add before object method.
+//      e3group_members_gettypeindex : Get the slots holding a type.
 //-----------------------------------------------------------------------------
-static TQ3GroupPosition
-e3group_addbefore(TQ3GroupObject group, TQ3GroupPosition position, TQ3Object object)
+//		Note :	Builds the index if the type has not been queried since the
+//				cache was built. Returns NULL if the group has no cache.
+//
+//				The index is built with the cache locked, which is safe
+//				since building it does not visit any other group.
+//-----------------------------------------------------------------------------
+static const E3FastArray<TQ3Uns32>*
+e3group_members_gettypeindex ( E3Group* theGroup, TQ3ObjectType isType )
 	{
-	return ( (E3Group*) group )->addbefore ( position, object ) ;
-	}
+	// Find the existing index
+	E3GroupMembers* theMembers = theGroup->getmembers () ;
+	if ( theMembers == NULL )
+		return NULL ;
 
+	E3SpinLocker theLocker ( theMembers->cacheLock ) ;
 
-TQ3GroupPosition
-E3Group::addbefore ( TQ3GroupPosition position, TQ3Object object )
-	{	
-	if ( position )
+	if ( theMembers->typeIndexes == NULL )
 		{
-		TQ3XGroupPosition* newGroupPosition = createPosition ( object ) ;
-		
-		if ( newGroupPosition )
+		theMembers->typeIndexes = E3HashTable_Create ( kGroupTypeIndexTableSize ) ;
+		if ( theMembers->typeIndexes == NULL )
+			return NULL ;
+		}
+
+	E3FastArray<TQ3Uns32>* typeSlots = (E3FastArray<TQ3Uns32>*) E3HashTable_Find ( theMembers->typeIndexes, isType ) ;
+	if ( typeSlots != NULL )
+		return typeSlots ;
+
+
+
+	// Collect the slots which hold the type
+	//
+	// As in E3Group::countobjects, the class of each object is tested in
+	// constant time once we know the depth of the type in the class tree.
+	typeSlots = new ( std::nothrow ) E3FastArray<TQ3Uns32> ;
+	if ( typeSlots == NULL )
+		return NULL ;
+
+	E3ClassInfoPtr typeClass = E3ClassTree::GetClass ( isType ) ;
+	if ( typeClass != NULL )
+		{
+		TQ3Uns32 classDepth = 0 ;
+		for ( E3ClassInfo* aClass = typeClass->GetParent () ; aClass != NULL ; aClass = aClass->GetParent () )
+			++classDepth ;
+
+		for ( TQ3Uns32 n = 0 ; n < theMembers->thePositions.size () ; ++n )
 			{
-			TQ3XGroupPosition* pos = (TQ3XGroupPosition*) position ;
-			// add before position
-			newGroupPosition->next = pos ;
-			newGroupPosition->prev = pos->prev ;
-			pos->prev->next = newGroupPosition ;
-			pos->prev = newGroupPosition ;
-			return (TQ3GroupPosition) newGroupPosition ;
+			if ( theMembers->thePositions[ (int) n ]->object->GetClass ()->IsClass ( isType, classDepth ) )
+				typeSlots->push_back ( n ) ;
 			}
 		}
-	return NULL ;
+
+	if ( E3HashTable_Add ( theMembers->typeIndexes, isType, typeSlots ) == kQ3Failure )
+		{
+		delete typeSlots ;
+		return NULL ;
+		}
+
+	return typeSlots ;
 	}
 
 
@@ -334,34 +458,19 @@ E3Group::addbefore ( TQ3GroupPosition position, TQ3Object object )
 
 
 //=============================================================================
-//      e3group_addafter : Group add after object method.
+//      e3group_members_getslot : Get the slot of a position.
 //-----------------------------------------------------------------------------
-static TQ3GroupPosition
-e3group_addafter(TQ3GroupObject group, TQ3GroupPosition position, TQ3Object object)
+//		Note :	Returns false if the position is not in the group.
+//-----------------------------------------------------------------------------
+static bool
+e3group_members_getslot ( E3GroupMembers& theMembers, TQ3GroupPosition position, TQ3Uns32* theSlot )
 	{
-	return ( (E3Group*) group )->addafter ( position, object ) ;
-	}
-
-
-TQ3GroupPosition
-E3Group::addafter ( TQ3GroupPosition position, TQ3Object object )
-	{	
-	if ( position )
-		{
-		TQ3XGroupPosition* newGroupPosition = createPosition ( object ) ;
-		
-		if ( newGroupPosition )
-			{
-			TQ3XGroupPosition* pos = (TQ3XGroupPosition*) position ;
-			// add after position
-			newGroupPosition->next = pos->next ;
-			newGroupPosition->prev = pos ;
-			pos->next->prev = newGroupPosition ;
-			pos->next = newGroupPosition ;
-			return (TQ3GroupPosition) newGroupPosition ;
-			}
-		}
-	return NULL ;
+	TQ3Uns32 theIndex = e3group_members_findposition ( theMembers, (const TQ3XGroupPosition*) position ) ;
+	if ( theMembers.positionSlots[ (int) theIndex ] == 0 )
+		return false ;
+	
+	*theSlot = theMembers.positionSlots[ (int) theIndex ] - 1 ;
+	return true ;
 	}
 
 
@@ -369,26 +478,26 @@ E3Group::addafter ( TQ3GroupPosition position, TQ3Object object )
 
 
 //=============================================================================
-//      e3group_setposition : Group set position method.
+//      e3group_parents_findslot : Find a group in the parents of an object.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_setposition( E3Group* group, TQ3GroupPosition position, TQ3Object object)
+//		Note :	Returns the index of the group's entry in the hash table, or
+//				of the empty entry where it would go.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3group_parents_findslot ( E3SharedParents& theParents, E3Group* theGroup )
 	{
-	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) position ;
-	
-	if ( group->GetClass ()->acceptObjectMethod ( group, object ) == kQ3True )
+	TQ3Uns32 tableMask = theParents.groupSlots.size () - 1 ;
+	TQ3Uns32 theIndex  = e3group_members_hash ( theGroup, tableMask ) ;
+
+	while ( theParents.groupSlots[ (int) theIndex ] != 0 )
 		{
-		// replace this position with this object
-		if ( pos->object )
-			Q3Object_Dispose ( pos->object ) ;
+		if ( theParents.theGroups[ (int) ( theParents.groupSlots[ (int) theIndex ] - 1 ) ] == theGroup )
+			break ;
 
-		pos->object = Q3Shared_GetReference ( object ) ;
-		return kQ3Success ;
+		theIndex = ( theIndex + 1 ) & tableMask ;
 		}
-	else
-		E3ErrorManager_PostError ( kQ3ErrorInvalidObjectForGroup, kQ3False ) ;
 
-	return kQ3Failure ;
+	return theIndex ;
 	}
 
 
@@ -396,21 +505,30 @@ e3group_setposition( E3Group* group, TQ3GroupPosition position, TQ3Object object
 
 
 //=============================================================================
-//      e3group_removeposition : Group remove position method.
+//      e3group_parents_rehash : Rebuild the hash table of an object's parents.
 //-----------------------------------------------------------------------------
-static TQ3Object
-e3group_removeposition ( E3Group* group, TQ3XGroupPosition* finishedGroupPosition )
+//		Note :	The table is kept at most half full. If it can't be grown, the
+//				table is discarded and the list is searched instead.
+//-----------------------------------------------------------------------------
+static void
+e3group_parents_rehash ( E3SharedParents& theParents )
 	{
-	// disconnect the position from the group
-	finishedGroupPosition->next->prev = finishedGroupPosition->prev ;
-	finishedGroupPosition->prev->next = finishedGroupPosition->next ;
+	TQ3Uns32 numGroups = theParents.theGroups.size () ;
+	TQ3Uns32 tableSize = 2 * kGroupParentsMinHashed ;
+	while ( tableSize < 2 * numGroups )
+		tableSize *= 2 ;
 
-	TQ3Object result = finishedGroupPosition->object ; // pass the reference back to the caller
-	finishedGroupPosition->object = NULL ; // so does not get disposed
-	
-	group->GetClass ()->positionDeleteMethod ( finishedGroupPosition ) ;
+	theParents.groupSlots.resizeNotPreserving ( tableSize ) ;
+	if ( theParents.groupSlots.size () != tableSize )
+		{
+		theParents.groupSlots.resizeNotPreserving ( 0 ) ;
+		return ;
+		}
 
-	return result ;
+	Q3Memory_Clear ( &theParents.groupSlots[ 0 ], tableSize * sizeof ( TQ3Uns32 ) ) ;
+
+	for ( TQ3Uns32 n = 0 ; n < numGroups ; ++n )
+		theParents.groupSlots[ (int) e3group_parents_findslot ( theParents, theParents.theGroups[ (int) n ] ) ] = n + 1 ;
 	}
 
 
@@ -418,43 +536,38 @@ e3group_removeposition ( E3Group* group, TQ3XGroupPosition* finishedGroupPositio
 
 
 //=============================================================================
-//      e3group_getfirstpositionoftype : Group get first position of type method.
+//      e3group_parents_removeslot : Remove an entry from the parents hash table.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getfirstpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+//		Note :	Later entries in the same run are shifted back into the gap,
+//				so that lookups never need to skip deleted entries.
+//-----------------------------------------------------------------------------
+static void
+e3group_parents_removeslot ( E3SharedParents& theParents, TQ3Uns32 theIndex )
 	{
-	return ( (E3Group*) group )->getfirstposition ( isType, position ) ;
-	}
+	TQ3Uns32 tableMask = theParents.groupSlots.size () - 1 ;
+	TQ3Uns32 nextIndex = theIndex ;
 
+	theParents.groupSlots[ (int) theIndex ] = 0 ;
 
+	for ( ; ; )
+		{
+		nextIndex = ( nextIndex + 1 ) & tableMask ;
+		if ( theParents.groupSlots[ (int) nextIndex ] == 0 )
+			break ;
 
-TQ3Status
-E3Group::getfirstposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
-	{
-	*position = NULL ;
 
-	TQ3XGroupPosition* finish = &groupData.listHead ;
-	TQ3XGroupPosition* pos = groupData.listHead.next ;
 
-	if ( isType == kQ3ObjectTypeShared )
-		{
-		if ( pos != finish )
-			*position = (TQ3GroupPosition) pos ;
-		}
-	else
-		{
-		while ( pos != finish )
+		// Move the entry back if the gap lies between its home and itself
+		E3Group* theGroup  = theParents.theGroups[ (int) ( theParents.groupSlots[ (int) nextIndex ] - 1 ) ] ;
+		TQ3Uns32 homeIndex = e3group_members_hash ( theGroup, tableMask ) ;
+
+		if ( ( ( nextIndex - homeIndex ) & tableMask ) >= ( ( nextIndex - theIndex ) & tableMask ) )
 			{
-			if ( E3Object_IsType ( pos->object, isType ) )
-				{
-				*position = (TQ3GroupPosition) pos ;
-				break ;
-				}
-			pos = pos->next ;
+			theParents.groupSlots[ (int) theIndex ]  = theParents.groupSlots[ (int) nextIndex ] ;
+			theParents.groupSlots[ (int) nextIndex ] = 0 ;
+			theIndex = nextIndex ;
 			}
 		}
-
-	return kQ3Success ;
 	}
 
 
@@ -462,42 +575,36 @@ E3Group::getfirstposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_getlastpositionoftype : Group get last position of type method.
+//      e3group_members_linkparent : Add a group to the parents of an object.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getlastpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+//		Note :	Must be called with sGroupParentsLock held.
+//-----------------------------------------------------------------------------
+static void
+e3group_members_linkparent ( E3Shared* theObject, E3Group* theGroup )
 	{
-	return ( (E3Group*) group )->getlastposition ( isType, position ) ;
-	}
-
+	E3SharedParents* theParents = theObject->sharedData.parentGroups ;
+	if ( theParents == NULL )
+		{
+		theParents = new ( std::nothrow ) E3SharedParents ;
+		if ( theParents == NULL )
+			return ;
 
-TQ3Status
-E3Group::getlastposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
-	{
-	*position = NULL ;
+		E3Atomic_StorePointer ( (void* volatile*) &theObject->sharedData.parentGroups, theParents ) ;
+		}
 	
-	TQ3XGroupPosition* finish = &groupData.listHead ;
-	TQ3XGroupPosition* pos = groupData.listHead.prev ;
+	theParents->theGroups.push_back ( theGroup ) ;
 
-	if ( isType == kQ3ObjectTypeShared )
-		{
-		if ( pos != finish )
-			*position = (TQ3GroupPosition) pos ;
-		}
-	else
+
+
+	// Hash the groups once there are enough of them
+	TQ3Uns32 numGroups = theParents->theGroups.size () ;
+	if ( numGroups > kGroupParentsMinHashed )
 		{
-		while ( pos != finish )
-			{
-			if ( E3Object_IsType ( pos->object, isType ) )
-				{
-				*position = (TQ3GroupPosition) pos ;
-				break ;
-				}
-			pos = pos->prev ;
-			}
+		if ( theParents->groupSlots.size () < 2 * numGroups )
+			e3group_parents_rehash ( *theParents ) ;
+		else
+			theParents->groupSlots[ (int) e3group_parents_findslot ( *theParents, theGroup ) ] = numGroups ;
 		}
-
-	return kQ3Success ;
 	}
 
 
@@ -505,93 +612,94 @@ E3Group::getlastposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_getnextpositionoftype : Group get next position of type method.
+//      e3group_members_unlinkparent : Remove a group from the parents of an object.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getnextpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+//		Note :	Must be called with sGroupParentsLock held.
+//-----------------------------------------------------------------------------
+static void
+e3group_members_unlinkparent ( E3Shared* theObject, E3Group* theGroup )
 	{
-	return ( (E3Group*) group )->getnextposition ( isType, position ) ;
-	}
+	E3SharedParents* theParents = theObject->sharedData.parentGroups ;
+	if ( theParents == NULL )
+		return ;
 
 
-TQ3Status
-E3Group::getnextposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
-	{
-	if ( *position == NULL )
-		return kQ3Failure ;
-		// This function implements Q3Group_GetNextPositionOfType, whose
-		// documentation says that on entry, *position must be a valid group position.
-	
-	TQ3XGroupPosition* finish = &groupData.listHead ;
-	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
-	pos = pos->next ;
-	*position = NULL ;
+
+	// Find the group
+	TQ3Uns32 numGroups = theParents->theGroups.size () ;
+	TQ3Uns32 theSlot   = numGroups ;
 	
-	if ( isType == kQ3ObjectTypeShared )
+	if ( theParents->groupSlots.empty () )
 		{
-		if ( pos != finish )
-			*position = (TQ3GroupPosition) pos ;
+		for ( TQ3Uns32 n = 0 ; n < numGroups && theSlot == numGroups ; ++n )
+			{
+			if ( theParents->theGroups[ (int) n ] == theGroup )
+				theSlot = n ;
+			}
 		}
 	else
 		{
-		while ( pos != finish )
+		TQ3Uns32 theIndex = e3group_parents_findslot ( *theParents, theGroup ) ;
+		if ( theParents->groupSlots[ (int) theIndex ] != 0 )
 			{
-			if ( E3Object_IsType ( pos->object, isType ) )
-				{
-				*position = (TQ3GroupPosition) pos ;
-				break ;
-				}
-			pos = pos->next ;
+			theSlot = theParents->groupSlots[ (int) theIndex ] - 1 ;
+			e3group_parents_removeslot ( *theParents, theIndex ) ;
 			}
 		}
 
-	return kQ3Success ;
-	}
+	if ( theSlot == numGroups )
+		return ;
 
 
 
+	// Swap the last group into its place
+	if ( theSlot != numGroups - 1 )
+		{
+		E3Group* lastGroup = theParents->theGroups[ (int) ( numGroups - 1 ) ] ;
+		theParents->theGroups[ (int) theSlot ] = lastGroup ;
+		
+		if ( ! theParents->groupSlots.empty () )
+			theParents->groupSlots[ (int) e3group_parents_findslot ( *theParents, lastGroup ) ] = theSlot + 1 ;
+		}
+	
+	theParents->theGroups.resize ( numGroups - 1 ) ;
 
 
-//=============================================================================
-//      e3group_getprevpositionoftype : Group get previous position of type method.
-//-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getprevpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
-	{
-	return ( (E3Group*) group )->getprevposition ( isType, position ) ;
+
+	// Dispose of the list once the object is in no groups
+	if ( theParents->theGroups.empty () )
+		{
+		E3Atomic_StorePointer ( (void* volatile*) &theObject->sharedData.parentGroups, NULL ) ;
+		delete theParents ;
+		}
 	}
 
 
-TQ3Status
-E3Group::getprevposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
+
+
+
+//=============================================================================
+//      e3group_subtree_edited : Mark a group and the groups above it as edited.
+//-----------------------------------------------------------------------------
+//		Note :	A group's parents are always marked if it is, so we can stop
+//				at any group which is already marked.
+//
+//				Must be called with sGroupParentsLock held.
+//-----------------------------------------------------------------------------
+static void
+e3group_subtree_edited ( E3Group* theGroup )
 	{
-	if ( *position == NULL )
-		return kQ3Failure ;
+	if ( theGroup->groupData.isSubtreeEdited )
+		return ;
 	
-	TQ3XGroupPosition* finish = &groupData.listHead ;
-	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
-	pos = pos->prev ;
-	*position = NULL ;
+	theGroup->groupData.isSubtreeEdited = kQ3True ;
 
-	if ( isType == kQ3ObjectTypeShared )
-		{
-		if ( pos != finish )
-			*position = (TQ3GroupPosition) pos ;
-		}
-	else
+	E3SharedParents* theParents = theGroup->sharedData.parentGroups ;
+	if ( theParents != NULL )
 		{
-		while ( pos != finish )
-			{
-			if ( E3Object_IsType ( pos->object, isType ) )
-				{
-				*position = (TQ3GroupPosition) pos ;
-				break ;
-				}
-			pos = pos->prev ;
-			}
+		for ( TQ3Uns32 n = 0 ; n < theParents->theGroups.size () ; ++n )
+			e3group_subtree_edited ( theParents->theGroups[ (int) n ] ) ;
 		}
-
-	return kQ3Success ;
 	}
 
 
@@ -599,108 +707,98 @@ E3Group::getprevposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_countobjectsoftype : Group count objects of type method.
+//      E3Group::getmembers : Get the member cache of a group.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_countobjectsoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3Uns32 *number)
+//		Note :	The cache is rebuilt by walking the group's positions if it
+//				has been invalidated, so works for any group class. Returns
+//				NULL if the cache could not be built.
+//
+//				Threads which find the cache missing at the same time each
+//				build one, and all but the first to publish discard theirs.
+//-----------------------------------------------------------------------------
+E3GroupMembers*
+E3Group::getmembers ( void )
 	{
-	return ( (E3Group*) group )->countobjects ( isType, number ) ;
-	}
+	// Use the published cache if there is one
+	E3GroupMembers* theMembers = (E3GroupMembers*) E3Atomic_LoadPointer ( (void* const volatile*) &groupData.memberCache ) ;
+	if ( theMembers != NULL )
+		return theMembers ;
 
 
 
+	// Create a new cache
+	theMembers = new ( std::nothrow ) E3GroupMembers ;
+	if ( theMembers == NULL )
+		return NULL ;
 
+	theMembers->cacheLock     = 0 ;
+	theMembers->typeIndexes   = NULL ;
+	theMembers->pickTree      = NULL ;
+	theMembers->pickTreeIndex = 0 ;
 
-TQ3Status
-E3Group::countobjects ( TQ3ObjectType isType, TQ3Uns32 *number )
-{
-	*number = 0L ;
-	
-	if (groupData.listHead.next != &groupData.listHead)
-	{
-		if (isType == kQ3ObjectTypeShared)
+
+
+	// Collect the positions in order
+	TQ3GroupPosition thePosition = NULL ;
+	TQ3Status qd3dStatus = GetFirstPosition ( &thePosition ) ;
+	while ( qd3dStatus == kQ3Success && thePosition != NULL )
 		{
-			// Optimization: all members of a group are shared
-			for ( TQ3XGroupPosition* pos = groupData.listHead.next; pos != &groupData.listHead;
-				pos = pos->next )
-			{
-				*number += 1;
-			}
+		theMembers->thePositions.push_back ( (TQ3XGroupPosition*) thePosition ) ;
+		qd3dStatus = GetNextPosition ( &thePosition ) ;
 		}
-		else
+
+	if ( qd3dStatus == kQ3Failure )
 		{
-			E3ClassInfoPtr typeClass = E3ClassTree::GetClass( isType );
-			
-			if (typeClass != NULL)
-			{
-				TQ3Uns32 classDepth = 0;
-				
-				for ( E3ClassInfo* aClass = typeClass->GetParent(); aClass != NULL;
-					aClass = aClass->GetParent() )
-				{
-					++classDepth;
-				}
-				
-				// Optimization note:  The more obvious way to write this would
-				// use E3Object_IsType, which uses E3ClassInfo::IsType, which
-				// contains a loop that walks up the class tree.  Here, the
-				// GetClass and IsClass calls are constant time.  If there are
-				// enough members in the group, that gain should pay the cost
-				// of the hash table lookup to find typeClass and the loop to
-				// find classDepth.
-				for ( TQ3XGroupPosition* pos = groupData.listHead.next; pos != &groupData.listHead;
-					pos = pos->next )
-				{
-					if (pos->object->GetClass()->IsClass( isType, classDepth ))
-					{
-						*number += 1;
-					}
-				}
-			}
+		e3group_members_dispose ( theMembers ) ;
+		return NULL ;
 		}
-	}
 
-	return kQ3Success ;
-}
 
 
+	// Build the hash tables, at most half full, recording the first slot of
+	// each object and the slot of each position
+	TQ3Uns32 numPositions = theMembers->thePositions.size () ;
+	TQ3Uns32 tableSize    = 8 ;
+	while ( tableSize < 2 * numPositions )
+		tableSize *= 2 ;
 
+	theMembers->objectSlots.resizeNotPreserving ( tableSize ) ;
+	theMembers->positionSlots.resizeNotPreserving ( tableSize ) ;
+	Q3Memory_Clear ( &theMembers->objectSlots[ 0 ],   tableSize * sizeof ( TQ3Uns32 ) ) ;
+	Q3Memory_Clear ( &theMembers->positionSlots[ 0 ], tableSize * sizeof ( TQ3Uns32 ) ) ;
 
+	for ( TQ3Uns32 n = 0 ; n < numPositions ; ++n )
+		{
+		TQ3Uns32 theIndex = e3group_members_findslot ( *theMembers, theMembers->thePositions[ (int) n ]->object ) ;
+		if ( theMembers->objectSlots[ (int) theIndex ] == 0 )
+			theMembers->objectSlots[ (int) theIndex ] = n + 1 ;
 
-//=============================================================================
-//      e3group_emptyobjectsoftype : Group empty objects of type method.
-//-----------------------------------------------------------------------------
-static TQ3Status
-e3group_emptyobjectsoftype(TQ3GroupObject group, TQ3ObjectType isType)
-	{
-	return ( (E3Group*) group )->emptyobjects ( isType ) ;
-	}
+		theIndex = e3group_members_findposition ( *theMembers, theMembers->thePositions[ (int) n ] ) ;
+		theMembers->positionSlots[ (int) theIndex ] = n + 1 ;
+		}
 
 
 
-TQ3Status
-E3Group::emptyobjects ( TQ3ObjectType isType )
-	{
-	TQ3XGroupPosition* finish = &groupData.listHead ;
-	TQ3XGroupPosition* pos = groupData.listHead.next ;
-	while ( pos != finish )
+	// Publish the cache, or use the one another thread published first
+	if ( ! E3Atomic_CompareAndSwapPointer ( (void* volatile*) &groupData.memberCache, NULL, theMembers ) )
 		{
-		if ( E3Object_IsType ( pos->object, isType ) )
-			{
-			TQ3XGroupPosition* nextPos = pos->next ;
-			
-			// disconnect the position from the group
-			nextPos->prev = pos->prev ;
-			pos->prev->next = pos->next ;
-
-			GetClass ()->positionDeleteMethod ( pos ) ;
-			pos = nextPos ;
-			}
-		else
-			pos = pos->next ;
+		e3group_members_dispose ( theMembers ) ;
+		return (E3GroupMembers*) E3Atomic_LoadPointer ( (void* const volatile*) &groupData.memberCache ) ;
 		}
 
-	return kQ3Success ;
+
+
+	// Listen to the objects in the cache, once for each object
+	E3SpinLocker theLocker ( sGroupParentsLock ) ;
+	
+	for ( TQ3Uns32 n = 0 ; n < numPositions ; ++n )
+		{
+		TQ3Object theObject = theMembers->thePositions[ (int) n ]->object ;
+		if ( theMembers->objectSlots[ (int) e3group_members_findslot ( *theMembers, theObject ) ] == n + 1 )
+			e3group_members_linkparent ( (E3Shared*) theObject, this ) ;
+		}
+	
+	return theMembers ;
 	}
 
 
@@ -708,48 +806,39 @@ E3Group::emptyobjects ( TQ3ObjectType isType )
 
 
 //=============================================================================
-//      e3group_duplicate : Group duplicate method.
+//      E3Group::invalidatemembers : Invalidate the member cache of a group.
 //-----------------------------------------------------------------------------
-TQ3Status
-e3group_duplicate(	TQ3Object fromObject, const void *fromPrivateData,
-					TQ3Object toObject,   void  * toPrivateData)
+//		Note :	Must be called before the positions of a group change, since
+//				the group is unlinked from the objects the cache holds.
+//-----------------------------------------------------------------------------
+void
+E3Group::invalidatemembers ( void )
 	{
-	E3Group* toInstanceData = (E3Group*) toObject ;
-	const E3Group* fromInstanceData = (const E3Group*) fromObject ;
-	TQ3Status status = kQ3Success ;
-	
-	// Validate our parameters
-	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(fromObject),      kQ3Failure);
-	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(fromPrivateData), kQ3Failure);
-	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(toObject),        kQ3Failure);
-	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(toPrivateData),   kQ3Failure);
+	// Stop listening to the objects in the cache, and mark the group
+	E3GroupMembers* theMembers = groupData.memberCache ;
 	
-	// Initialise our instance data
-	e3group_new( toObject, toInstanceData, NULL );
+	{
+	E3SpinLocker theLocker ( sGroupParentsLock ) ;
 	
-	// Loop through the members of the "from" group, duplicating and adding to "to"
-	for ( const TQ3XGroupPosition* pos = fromInstanceData->groupData.listHead.next ;
-		pos != &fromInstanceData->groupData.listHead ;
-		pos = pos->next )
+	if ( theMembers != NULL )
 		{
-		TQ3Object dupObject = Q3Object_Duplicate ( pos->object ) ;
-		if ( dupObject == NULL )
+		for ( TQ3Uns32 n = 0 ; n < theMembers->thePositions.size () ; ++n )
 			{
-			status = kQ3Failure ;
-			break;
+			TQ3Object theObject = theMembers->thePositions[ (int) n ]->object ;
+			TQ3Uns32  theIndex  = e3group_members_findslot ( *theMembers, theObject ) ;
+			if ( theMembers->objectSlots[ (int) theIndex ] == n + 1 )
+				e3group_members_unlinkparent ( (E3Shared*) theObject, this ) ;
 			}
-		toInstanceData->addobject ( dupObject ) ;
-		
-		// Now the group owns a reference to the dup, so we can dispose one
-		Q3Object_Dispose ( dupObject ) ;
-		Q3_ASSERT( Q3Shared_GetReferenceCount( dupObject ) == 1 );
 		}
-	
-	// If the operation failed, we need to clean up.
-	if ( status == kQ3Failure )
-		toInstanceData->emptyobjects ( kQ3ObjectTypeShared ) ;
-	
-	return status ;
+
+	e3group_subtree_edited ( this ) ;
+	}
+
+
+
+	// Discard the cache
+	groupData.memberCache = NULL ;
+	e3group_members_dispose ( theMembers ) ;
 	}
 
 
@@ -757,38 +846,1130 @@ e3group_duplicate(	TQ3Object fromObject, const void *fromPrivateData,
 
 
 //=============================================================================
-//      e3group_getfirstobjectposition : Group get first object position method.
+//      e3group_subtree_settle : Give a group and its edited subgroups a new edit index.
 //-----------------------------------------------------------------------------
-//		Note : Finds the position of the object starting at the beginning
+//		Note :	Only the edited groups below the group are visited, since the
+//				others cannot be marked.
+//
+//				Must be called with sGroupSettleLock held. The new index is
+//				stored before the mark is cleared, so that a thread which
+//				sees the mark cleared without the lock sees the index too.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getfirstobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+static void
+e3group_subtree_settle ( E3Group* theGroup, TQ3Uns32 editIndex )
 	{
-	return ( (E3Group*) group )->getfirstobjectposition ( object, position ) ;
-	}
+	// The cache must be built to hear about later edits, so a group whose
+	// cache can't be built stays marked
+	E3GroupMembers* theMembers = theGroup->getmembers () ;
+	if ( theMembers == NULL )
+		return ;
 
+	theGroup->groupData.subtreeEditIndex = editIndex ;
+	E3Atomic_StoreUns32 ( &theGroup->groupData.isSubtreeEdited, kQ3False ) ;
 
 
-TQ3Status
-E3Group::getfirstobjectposition ( TQ3Object object, TQ3GroupPosition *position )
-	{
-	*position = NULL ;
+
+	// Settle the edited groups it contains
+	for ( TQ3Uns32 n = 0 ; n < theMembers->thePositions.size () ; ++n )
+		{
+		TQ3Object theObject = theMembers->thePositions[ (int) n ]->object ;
+		
+		if ( Q3_OBJECT_IS_CLASS ( theObject, E3Group ) && ( (E3Group*) theObject )->groupData.isSubtreeEdited )
+			e3group_subtree_settle ( (E3Group*) theObject, editIndex ) ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_new : Group new method.
+//-----------------------------------------------------------------------------
+TQ3Status
+e3group_new(TQ3Object theObject, void *privateData, const void *paramData)
+	{
+#pragma unused(paramData)
+#pragma unused(privateData)
+	E3Group				*instanceData = (E3Group*) theObject ;
+
+	// Initialise our instance data
+	instanceData->groupData.listHead.next        = &instanceData->groupData.listHead;
+	instanceData->groupData.listHead.prev        = &instanceData->groupData.listHead;
+	instanceData->groupData.listHead.object      = theObject; // points to itself but never used
+	instanceData->groupData.groupPositionSize    = sizeof( TQ3GroupPosition );
+	instanceData->groupData.memberCache          = NULL;
+	instanceData->groupData.subtreeEditIndex     = 0;
+	instanceData->groupData.isSubtreeEdited      = kQ3True;
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_delete : Group delete method.
+//-----------------------------------------------------------------------------
+static void
+e3group_delete(TQ3Object theObject, void *privateData)
+{
+#pragma unused(privateData)
+	E3Group				*instanceData = (E3Group*) theObject ;
+
+
+
+	// Empty the group
+	Q3Group_EmptyObjects(theObject);
+
+
+
+	// Dispose of the member cache
+	e3group_members_dispose( instanceData->groupData.memberCache );
+	instanceData->groupData.memberCache = NULL;
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_acceptobject : Group accept object method.
+//-----------------------------------------------------------------------------
+//		Note : We accept all shared objects
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+e3group_acceptobject(TQ3GroupObject group, TQ3Object object)
+{
+#pragma unused (group)
+	if (Q3Object_GetType (object) == kQ3ObjectTypeShared)
+		return(kQ3True);
+	return(kQ3False);
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_createPosition : Group create position method.
+//-----------------------------------------------------------------------------
+//		Note : Creates a TQ3XGroupPosition* for a new object
+//-----------------------------------------------------------------------------
+TQ3XGroupPosition*
+E3Group::createPosition ( TQ3Object object )
+	{
+	if ( GetClass ()->acceptObjectMethod ( (TQ3GroupObject) this, object ) != kQ3False )
+		{		
+		TQ3XGroupPosition* newGroupPosition ;
+		if ( TQ3Status newResult = GetClass ()->positionNewMethod ( &newGroupPosition, object, this ) )
+			return newGroupPosition ;
+		}
+	else
+		E3ErrorManager_PostError(kQ3ErrorInvalidObjectForGroup, kQ3False);
+
+	return NULL ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_addobject : Group add object method.
+//-----------------------------------------------------------------------------
+//		Note : objects are added to the end
+//-----------------------------------------------------------------------------
+static TQ3GroupPosition
+e3group_addobject(TQ3GroupObject group, TQ3Object object)
+	{
+	return ( (E3Group*) group )->addobject ( object ) ;
+	}
+
+
+TQ3GroupPosition
+E3Group::addobject ( TQ3Object object )	
+	{
+	TQ3XGroupPosition* newGroupPosition = createPosition ( object ) ;
+	
+	if (newGroupPosition)
+		{
+		// add to end of group list
+		newGroupPosition->next = &groupData.listHead ;
+		newGroupPosition->prev = groupData.listHead.prev ;
+		groupData.listHead.prev->next = newGroupPosition ;
+		groupData.listHead.prev = newGroupPosition ;
+		return (TQ3GroupPosition) newGroupPosition ;
+		}
+	return NULL ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_addbefore : Group add before object method.
+//-----------------------------------------------------------------------------
+static TQ3GroupPosition
+e3group_addbefore(TQ3GroupObject group, TQ3GroupPosition position, TQ3Object object)
+	{
+	return ( (E3Group*) group )->addbefore ( position, object ) ;
+	}
+
+
+TQ3GroupPosition
+E3Group::addbefore ( TQ3GroupPosition position, TQ3Object object )
+	{	
+	if ( position )
+		{
+		TQ3XGroupPosition* newGroupPosition = createPosition ( object ) ;
+		
+		if ( newGroupPosition )
+			{
+			TQ3XGroupPosition* pos = (TQ3XGroupPosition*) position ;
+			// add before position
+			newGroupPosition->next = pos ;
+			newGroupPosition->prev = pos->prev ;
+			pos->prev->next = newGroupPosition ;
+			pos->prev = newGroupPosition ;
+			return (TQ3GroupPosition) newGroupPosition ;
+			}
+		}
+	return NULL ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_addafter : Group add after object method.
+//-----------------------------------------------------------------------------
+static TQ3GroupPosition
+e3group_addafter(TQ3GroupObject group, TQ3GroupPosition position, TQ3Object object)
+	{
+	return ( (E3Group*) group )->addafter ( position, object ) ;
+	}
+
+
+TQ3GroupPosition
+E3Group::addafter ( TQ3GroupPosition position, TQ3Object object )
+	{	
+	if ( position )
+		{
+		TQ3XGroupPosition* newGroupPosition = createPosition ( object ) ;
+		
+		if ( newGroupPosition )
+			{
+			TQ3XGroupPosition* pos = (TQ3XGroupPosition*) position ;
+			// add after position
+			newGroupPosition->next = pos->next ;
+			newGroupPosition->prev = pos ;
+			pos->next->prev = newGroupPosition ;
+			pos->next = newGroupPosition ;
+			return (TQ3GroupPosition) newGroupPosition ;
+			}
+		}
+	return NULL ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_setposition : Group set position method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_setposition( E3Group* group, TQ3GroupPosition position, TQ3Object object)
+	{
+	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) position ;
+	
+	if ( group->GetClass ()->acceptObjectMethod ( group, object ) == kQ3True )
+		{
+		// replace this position with this object
+		if ( pos->object )
+			Q3Object_Dispose ( pos->object ) ;
+
+		pos->object = Q3Shared_GetReference ( object ) ;
+		return kQ3Success ;
+		}
+	else
+		E3ErrorManager_PostError ( kQ3ErrorInvalidObjectForGroup, kQ3False ) ;
+
+	return kQ3Failure ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_removeposition : Group remove position method.
+//-----------------------------------------------------------------------------
+static TQ3Object
+e3group_removeposition ( E3Group* group, TQ3XGroupPosition* finishedGroupPosition )
+	{
+	// disconnect the position from the group
+	finishedGroupPosition->next->prev = finishedGroupPosition->prev ;
+	finishedGroupPosition->prev->next = finishedGroupPosition->next ;
+
+	TQ3Object result = finishedGroupPosition->object ; // pass the reference back to the caller
+	finishedGroupPosition->object = NULL ; // so does not get disposed
+	
+	group->GetClass ()->positionDeleteMethod ( finishedGroupPosition ) ;
+
+	return result ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getfirstpositionoftype : Group get first position of type method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getfirstpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getfirstposition ( isType, position ) ;
+	}
+
+
+
+TQ3Status
+E3Group::getfirstposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
+	{
+	*position = NULL ;
+
+	if ( isType != kQ3ObjectTypeShared )
+		{
+		const E3FastArray<TQ3Uns32>* typeSlots = e3group_members_gettypeindex ( this, isType ) ;
+		if ( typeSlots != NULL )
+			{
+			if ( ! typeSlots->empty () )
+				*position = (TQ3GroupPosition) groupData.memberCache->thePositions[ (int) (*typeSlots)[ 0 ] ] ;
+			return kQ3Success ;
+			}
+		}
+
+	TQ3XGroupPosition* finish = &groupData.listHead ;
+	TQ3XGroupPosition* pos = groupData.listHead.next ;
+
+	if ( isType == kQ3ObjectTypeShared )
+		{
+		if ( pos != finish )
+			*position = (TQ3GroupPosition) pos ;
+		}
+	else
+		{
+		while ( pos != finish )
+			{
+			if ( E3Object_IsType ( pos->object, isType ) )
+				{
+				*position = (TQ3GroupPosition) pos ;
+				break ;
+				}
+			pos = pos->next ;
+			}
+		}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getlastpositionoftype : Group get last position of type method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getlastpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getlastposition ( isType, position ) ;
+	}
+
+
+TQ3Status
+E3Group::getlastposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
+	{
+	*position = NULL ;
+
+	if ( isType != kQ3ObjectTypeShared )
+		{
+		const E3FastArray<TQ3Uns32>* typeSlots = e3group_members_gettypeindex ( this, isType ) ;
+		if ( typeSlots != NULL )
+			{
+			if ( ! typeSlots->empty () )
+				*position = (TQ3GroupPosition) groupData.memberCache->thePositions[ (int) (*typeSlots)[ (int) ( typeSlots->size () - 1 ) ] ] ;
+			return kQ3Success ;
+			}
+		}
+	
+	TQ3XGroupPosition* finish = &groupData.listHead ;
+	TQ3XGroupPosition* pos = groupData.listHead.prev ;
+
+	if ( isType == kQ3ObjectTypeShared )
+		{
+		if ( pos != finish )
+			*position = (TQ3GroupPosition) pos ;
+		}
+	else
+		{
+		while ( pos != finish )
+			{
+			if ( E3Object_IsType ( pos->object, isType ) )
+				{
+				*position = (TQ3GroupPosition) pos ;
+				break ;
+				}
+			pos = pos->prev ;
+			}
+		}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getnextpositionoftype : Group get next position of type method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getnextpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getnextposition ( isType, position ) ;
+	}
+
+
+TQ3Status
+E3Group::getnextposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
+	{
+	if ( *position == NULL )
+		return kQ3Failure ;
+		// This function implements Q3Group_GetNextPositionOfType, whose
+		// documentation says that on entry, *position must be a valid group position.
+	
+	TQ3Uns32 theSlot ;
+	if ( isType != kQ3ObjectTypeShared )
+		{
+		const E3FastArray<TQ3Uns32>* typeSlots = e3group_members_gettypeindex ( this, isType ) ;
+
+		// When most of the group is of this type, the next one is usually
+		// a neighbour, which is cheaper to look at than the index
+		if ( typeSlots != NULL && typeSlots->size () * 2 >= groupData.memberCache->thePositions.size () )
+			{
+			TQ3XGroupPosition* finish  = &groupData.listHead ;
+			TQ3XGroupPosition* nearPos = ( (TQ3XGroupPosition*) *position )->next ;
+			for ( TQ3Uns32 n = 0 ; n < kGroupTypeScanLimit ; ++n )
+				{
+				if ( nearPos == finish || E3Object_IsType ( nearPos->object, isType ) )
+					{
+					*position = ( nearPos == finish ) ? NULL : (TQ3GroupPosition) nearPos ;
+					return kQ3Success ;
+					}
+				nearPos = nearPos->next ;
+				}
+			}
+
+		if ( typeSlots != NULL && e3group_members_getslot ( *groupData.memberCache, *position, &theSlot ) )
+			{
+			// Find the first slot of the type after this one
+			*position = NULL ;
+			if ( ! typeSlots->empty () )
+				{
+				const TQ3Uns32* slotsEnd = &(*typeSlots)[ 0 ] + typeSlots->size () ;
+				const TQ3Uns32* nextSlot = std::upper_bound ( &(*typeSlots)[ 0 ], slotsEnd, theSlot ) ;
+				if ( nextSlot != slotsEnd )
+					*position = (TQ3GroupPosition) groupData.memberCache->thePositions[ (int) *nextSlot ] ;
+				}
+			return kQ3Success ;
+			}
+		}
+	
+	TQ3XGroupPosition* finish = &groupData.listHead ;
+	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
+	pos = pos->next ;
+	*position = NULL ;
+	
+	if ( isType == kQ3ObjectTypeShared )
+		{
+		if ( pos != finish )
+			*position = (TQ3GroupPosition) pos ;
+		}
+	else
+		{
+		while ( pos != finish )
+			{
+			if ( E3Object_IsType ( pos->object, isType ) )
+				{
+				*position = (TQ3GroupPosition) pos ;
+				break ;
+				}
+			pos = pos->next ;
+			}
+		}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getprevpositionoftype : Group get previous position of type method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getprevpositionoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getprevposition ( isType, position ) ;
+	}
+
+
+TQ3Status
+E3Group::getprevposition ( TQ3ObjectType isType, TQ3GroupPosition *position )
+	{
+	if ( *position == NULL )
+		return kQ3Failure ;
+	
+	TQ3Uns32 theSlot ;
+	if ( isType != kQ3ObjectTypeShared )
+		{
+		const E3FastArray<TQ3Uns32>* typeSlots = e3group_members_gettypeindex ( this, isType ) ;
+
+		// When most of the group is of this type, the previous one is usually
+		// a neighbour, which is cheaper to look at than the index
+		if ( typeSlots != NULL && typeSlots->size () * 2 >= groupData.memberCache->thePositions.size () )
+			{
+			TQ3XGroupPosition* finish  = &groupData.listHead ;
+			TQ3XGroupPosition* nearPos = ( (TQ3XGroupPosition*) *position )->prev ;
+			for ( TQ3Uns32 n = 0 ; n < kGroupTypeScanLimit ; ++n )
+				{
+				if ( nearPos == finish || E3Object_IsType ( nearPos->object, isType ) )
+					{
+					*position = ( nearPos == finish ) ? NULL : (TQ3GroupPosition) nearPos ;
+					return kQ3Success ;
+					}
+				nearPos = nearPos->prev ;
+				}
+			}
+
+		if ( typeSlots != NULL && e3group_members_getslot ( *groupData.memberCache, *position, &theSlot ) )
+			{
+			// Find the last slot of the type before this one
+			*position = NULL ;
+			if ( ! typeSlots->empty () )
+				{
+				const TQ3Uns32* slotsBegin = &(*typeSlots)[ 0 ] ;
+				const TQ3Uns32* prevSlot   = std::lower_bound ( slotsBegin, slotsBegin + typeSlots->size (), theSlot ) ;
+				if ( prevSlot != slotsBegin )
+					*position = (TQ3GroupPosition) groupData.memberCache->thePositions[ (int) prevSlot[ -1 ] ] ;
+				}
+			return kQ3Success ;
+			}
+		}
+	
+	TQ3XGroupPosition* finish = &groupData.listHead ;
+	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
+	pos = pos->prev ;
+	*position = NULL ;
+
+	if ( isType == kQ3ObjectTypeShared )
+		{
+		if ( pos != finish )
+			*position = (TQ3GroupPosition) pos ;
+		}
+	else
+		{
+		while ( pos != finish )
+			{
+			if ( E3Object_IsType ( pos->object, isType ) )
+				{
+				*position = (TQ3GroupPosition) pos ;
+				break ;
+				}
+			pos = pos->prev ;
+			}
+		}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_countobjectsoftype : Group count objects of type method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_countobjectsoftype(TQ3GroupObject group, TQ3ObjectType isType, TQ3Uns32 *number)
+	{
+	return ( (E3Group*) group )->countobjects ( isType, number ) ;
+	}
+
+
+
+
+
+TQ3Status
+E3Group::countobjects ( TQ3ObjectType isType, TQ3Uns32 *number )
+{
+	*number = 0L ;
+	
+	if (groupData.listHead.next != &groupData.listHead)
+	{
+		if (isType == kQ3ObjectTypeShared)
+		{
+			// Optimization: all members of a group are shared
+			for ( TQ3XGroupPosition* pos = groupData.listHead.next; pos != &groupData.listHead;
+				pos = pos->next )
+			{
+				*number += 1;
+			}
+		}
+		else if (const E3FastArray<TQ3Uns32>* typeSlots = e3group_members_gettypeindex( this, isType ))
+		{
+			*number = typeSlots->size();
+		}
+		else
+		{
+			E3ClassInfoPtr typeClass = E3ClassTree::GetClass( isType );
+			
+			if (typeClass != NULL)
+			{
+				TQ3Uns32 classDepth = 0;
+				
+				for ( E3ClassInfo* aClass = typeClass->GetParent(); aClass != NULL;
+					aClass = aClass->GetParent() )
+				{
+					++classDepth;
+				}
+				
+				// Optimization note:  The more obvious way to write this would
+				// use E3Object_IsType, which uses E3ClassInfo::IsType, which
+				// contains a loop that walks up the class tree.  Here, the
+				// GetClass and IsClass calls are constant time.  If there are
+				// enough members in the group, that gain should pay the cost
+				// of the hash table lookup to find typeClass and the loop to
+				// find classDepth.
+				for ( TQ3XGroupPosition* pos = groupData.listHead.next; pos != &groupData.listHead;
+					pos = pos->next )
+				{
+					if (pos->object->GetClass()->IsClass( isType, classDepth ))
+					{
+						*number += 1;
+					}
+				}
+			}
+		}
+	}
+
+	return kQ3Success ;
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_emptyobjectsoftype : Group empty objects of type method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_emptyobjectsoftype(TQ3GroupObject group, TQ3ObjectType isType)
+	{
+	return ( (E3Group*) group )->emptyobjects ( isType ) ;
+	}
+
+
+
+TQ3Status
+E3Group::emptyobjects ( TQ3ObjectType isType )
+	{
+	TQ3XGroupPosition* finish = &groupData.listHead ;
+	TQ3XGroupPosition* pos = groupData.listHead.next ;
+	while ( pos != finish )
+		{
+		if ( E3Object_IsType ( pos->object, isType ) )
+			{
+			TQ3XGroupPosition* nextPos = pos->next ;
+			
+			// disconnect the position from the group
+			nextPos->prev = pos->prev ;
+			pos->prev->next = pos->next ;
+
+			GetClass ()->positionDeleteMethod ( pos ) ;
+			pos = nextPos ;
+			}
+		else
+			pos = pos->next ;
+		}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_duplicate : Group duplicate method.
+//-----------------------------------------------------------------------------
+TQ3Status
+e3group_duplicate(	TQ3Object fromObject, const void *fromPrivateData,
+					TQ3Object toObject,   void  * toPrivateData)
+	{
+	E3Group* toInstanceData = (E3Group*) toObject ;
+	const E3Group* fromInstanceData = (const E3Group*) fromObject ;
+	TQ3Status status = kQ3Success ;
+	
+	// Validate our parameters
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(fromObject),      kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(fromPrivateData), kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(toObject),        kQ3Failure);
+	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(toPrivateData),   kQ3Failure);
+	
+	// Initialise our instance data
+	e3group_new( toObject, toInstanceData, NULL );
+	
+	// Loop through the members of the "from" group, duplicating and adding to "to"
+	for ( const TQ3XGroupPosition* pos = fromInstanceData->groupData.listHead.next ;
+		pos != &fromInstanceData->groupData.listHead ;
+		pos = pos->next )
+		{
+		TQ3Object dupObject = Q3Object_Duplicate ( pos->object ) ;
+		if ( dupObject == NULL )
+			{
+			status = kQ3Failure ;
+			break;
+			}
+		toInstanceData->addobject ( dupObject ) ;
+		
+		// Now the group owns a reference to the dup, so we can dispose one
+		Q3Object_Dispose ( dupObject ) ;
+		Q3_ASSERT( Q3Shared_GetReferenceCount( dupObject ) == 1 );
+		}
+	
+	// If the operation failed, we need to clean up.
+	if ( status == kQ3Failure )
+		toInstanceData->emptyobjects ( kQ3ObjectTypeShared ) ;
+	
+	return status ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getfirstobjectposition : Group get first object position method.
+//-----------------------------------------------------------------------------
+//		Note : Finds the position of the object starting at the beginning
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getfirstobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getfirstobjectposition ( object, position ) ;
+	}
+
+
+
+TQ3Status
+E3Group::getfirstobjectposition ( TQ3Object object, TQ3GroupPosition *position )
+	{
+	*position = NULL ;
 
 	TQ3XGroupPosition* finish = &groupData.listHead ;
 	TQ3XGroupPosition* pos = groupData.listHead.next ;
 	while ( pos != finish )
 		{
-		if ( pos->object == object )
-			{
-			*position = (TQ3GroupPosition) pos ;
-			break ;
-			}
-		pos = pos->next ;
+		if ( pos->object == object )
+			{
+			*position = (TQ3GroupPosition) pos ;
+			break ;
+			}
+		pos = pos->next ;
+		}
+
+	// The documentation isn't clear, but QD3D returns kQ3Success even if it also
+	// leaves *position == NULL.
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getlastobjectposition : Group get last object position method.
+//-----------------------------------------------------------------------------
+//		Note : Finds the position of the object starting at the end
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getlastobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getlastobjectposition ( object, position ) ;
+	}
+
+
+
+TQ3Status
+E3Group::getlastobjectposition ( TQ3Object object, TQ3GroupPosition *position )
+	{
+	*position = NULL ;
+
+	TQ3XGroupPosition* finish = &groupData.listHead ;
+	TQ3XGroupPosition* pos = groupData.listHead.prev ;
+	while ( pos != finish )
+		{
+		if ( pos->object == object )
+			{
+			*position = (TQ3GroupPosition) pos ;
+			break ;
+			}
+		pos = pos->prev ;
+		}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getnextobjectposition : Group get next object position method.
+//-----------------------------------------------------------------------------
+//		Note :	Finds the position of the object starting at position
+//				and going forewards
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getnextobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getnextobjectposition ( object, position ) ;
+	}
+
+
+
+TQ3Status
+E3Group::getnextobjectposition ( TQ3Object object, TQ3GroupPosition *position )
+	{
+	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
+
+	*position = NULL;
+
+	for ( pos = pos->next ; pos != &groupData.listHead ; pos = pos->next )
+		if ( pos->object == object )
+			{
+			*position = (TQ3GroupPosition) pos ;
+			break;
+			}
+
+	// The blue book does not make it clear whether the only indication of a failed
+	// search should be *position == NULL, or also a result of kQ3Failure.  QD3D 1.6
+	// seems to have a bug in this case, giving neither indication of failure.
+	// By analogy with other calls such as Q3Group_GetNextObjectPosition, I think we
+	// should return kQ3Success here.
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_getprevobjectposition : Get previous object position method.
+//-----------------------------------------------------------------------------
+//		Note :	Finds the position of the object starting at position
+//				and going backwards
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_getprevobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+	{
+	return ( (E3Group*) group )->getprevobjectposition ( object, position ) ;
+	}
+
+
+
+TQ3Status
+E3Group::getprevobjectposition ( TQ3Object object, TQ3GroupPosition *position )
+	{
+	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
+
+	*position = NULL ;
+
+	for ( pos = pos->prev ; pos != &groupData.listHead ; pos = pos->prev )
+		if ( pos->object == object )
+			{
+			*position = (TQ3GroupPosition) pos ;
+			break ;
+			}
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_positionnew : Group position new method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_positionnew(TQ3XGroupPosition** position, TQ3Object object, const void *initData)
+{
+#pragma unused (initData)
+	if (position)
+		{
+		TQ3XGroupPosition* newGroupPosition = (TQ3XGroupPosition*) Q3Memory_Allocate(sizeof(TQ3XGroupPosition));
+
+		if (newGroupPosition)
+			{
+			newGroupPosition->next        = NULL;
+			newGroupPosition->prev        = NULL;
+			newGroupPosition->object      = Q3Shared_GetReference (object);
+			*position = newGroupPosition ;
+			return kQ3Success ;
+			}
+		*position = NULL;
+		}
+	return kQ3Failure ;
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_positioncopy : Group position copy method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_positioncopy(TQ3XGroupPosition *fromPosition, TQ3XGroupPosition *toPosition)
+{
+	if (fromPosition && toPosition)
+		{
+		if (fromPosition->object)
+			{
+			if (toPosition->object)
+				Q3Object_Dispose (toPosition->object);
+
+			toPosition->object      = Q3Shared_GetReference (fromPosition->object);
+
+			if (toPosition->object)
+				return kQ3Success ;
+			}
+		}
+	return kQ3Failure ;
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_positiondelete : Group position delete method.
+//-----------------------------------------------------------------------------
+static void
+e3group_positiondelete(void *position)
+{
+	TQ3XGroupPosition* pos = (TQ3XGroupPosition*)position;
+	if (pos->object)
+		Q3Object_Dispose (pos->object);
+	
+	Q3Memory_Free (&position);
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_startiterate : Group start iterate method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_startiterate(TQ3GroupObject group, TQ3GroupPosition *iterator, TQ3Object *object, TQ3ViewObject view)
+{	TQ3Status			err;
+	TQ3GroupPosition	thePosition= NULL;
+	TQ3Object			theObject = NULL;
+#pragma unused (view)
+
+	err = ( (E3Group*) group )->GetFirstPosition( &thePosition );
+	if ((err == kQ3Success) && (thePosition != NULL))
+		err = ((E3Group*)group)->GetPositionObject( thePosition, &theObject );
+
+	if (object)
+		*object = theObject;
+	if (iterator)
+		*iterator = thePosition;
+
+	return(err);
+
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_enditerate : Group end iterate method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_enditerate(TQ3GroupObject group, TQ3GroupPosition *iterator, TQ3Object *object, TQ3ViewObject view)
+{	TQ3Status				err = kQ3Failure;
+#pragma unused (view)
+
+	if (object != NULL)
+	{
+		E3Shared_Dispose( (E3Shared*) *object );
+		*object = NULL;
+		
+		err = ((E3Group*)group)->GetNextPosition( iterator );
+		if (err == kQ3Success)
+		{
+			if (*iterator)
+				err = ((E3Group*)group)->GetPositionObject (*iterator, object);
+		}
+	}
+
+	return(err);
+}
+
+
+
+
+
+//=============================================================================
+//      e3group_picktree_transformbox : Transform a box to entry coordinates.
+//-----------------------------------------------------------------------------
+//		Note :	The result bounds the corners of the box after transforming
+//				them by the local to world matrix of the bounding view, which
+//				is the transform from the member to the group's entry state.
+//-----------------------------------------------------------------------------
+static void
+e3group_picktree_transformbox ( TQ3ViewObject theView, const TQ3BoundingBox& localBox, TQ3BoundingBox& theBox )
+	{
+	TQ3Point3D theCorners[ 8 ] ;
+	
+	for ( TQ3Uns32 n = 0 ; n < 8 ; ++n )
+		{
+		theCorners[ n ].x = ( n & 1 ) ? localBox.max.x : localBox.min.x ;
+		theCorners[ n ].y = ( n & 2 ) ? localBox.max.y : localBox.min.y ;
+		theCorners[ n ].z = ( n & 4 ) ? localBox.max.z : localBox.min.z ;
+		}
+
+	E3Point3D_To3DTransformArray ( theCorners, E3View_State_GetMatrixLocalToWorld ( theView ),
+									theCorners, 8, sizeof ( TQ3Point3D ), sizeof ( TQ3Point3D ) ) ;
+	E3BoundingBox_SetFromPoints3D ( &theBox, theCorners, 8, sizeof ( TQ3Point3D ) ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3group_picktree_quadricbox : Get the local bounds of a quadric.
+//-----------------------------------------------------------------------------
+//		Note :	Quadrics are bounded and picked through their decomposition,
+//				which depends on the subdivision style when they are submitted.
+//				We bound their surfaces instead, which bounds any decomposition.
+//
+//				Every quadric lies within origin + a.orientation + b.majorRadius
+//				+ c.minorRadius, for some range of a, b and c. A torus also has
+//				a tube of radius ratio * |orientation| about its ring.
+//
+//				Returns false if the object is not a quadric.
+//-----------------------------------------------------------------------------
+static bool
+e3group_picktree_quadricbox ( TQ3Object theObject, TQ3ObjectType theType, TQ3BoundingBox& theBox )
+	{
+	const TQ3Vector3D zeroVector = { 0.0f, 0.0f, 0.0f } ;
+	const void* theData = theObject->FindLeafInstanceData () ;
+	const TQ3Point3D* theOrigin ;
+	const TQ3Vector3D* theOrientation = &zeroVector ;
+	const TQ3Vector3D* theMajor ;
+	const TQ3Vector3D* theMinor ;
+	float orientMin = -1.0f ;
+	float tubeRadius = 0.0f ;
+
+
+
+	// Find the vectors which span the quadric
+	switch ( theType )
+		{
+		case kQ3GeometryTypeEllipsoid :
+			theOrigin      = &( (const TQ3EllipsoidData*) theData )->origin ;
+			theOrientation = &( (const TQ3EllipsoidData*) theData )->orientation ;
+			theMajor       = &( (const TQ3EllipsoidData*) theData )->majorRadius ;
+			theMinor       = &( (const TQ3EllipsoidData*) theData )->minorRadius ;
+			break ;
+
+		case kQ3GeometryTypeCone :
+			theOrigin      = &( (const TQ3ConeData*) theData )->origin ;
+			theOrientation = &( (const TQ3ConeData*) theData )->orientation ;
+			theMajor       = &( (const TQ3ConeData*) theData )->majorRadius ;
+			theMinor       = &( (const TQ3ConeData*) theData )->minorRadius ;
+			orientMin      = 0.0f ;
+			break ;
+
+		case kQ3GeometryTypeCylinder :
+			theOrigin      = &( (const TQ3CylinderData*) theData )->origin ;
+			theOrientation = &( (const TQ3CylinderData*) theData )->orientation ;
+			theMajor       = &( (const TQ3CylinderData*) theData )->majorRadius ;
+			theMinor       = &( (const TQ3CylinderData*) theData )->minorRadius ;
+			orientMin      = 0.0f ;
+			break ;
+
+		case kQ3GeometryTypeDisk :
+			theOrigin      = &( (const TQ3DiskData*) theData )->origin ;
+			theMajor       = &( (const TQ3DiskData*) theData )->majorRadius ;
+			theMinor       = &( (const TQ3DiskData*) theData )->minorRadius ;
+			break ;
+
+		case kQ3GeometryTypeEllipse :
+			theOrigin      = &( (const TQ3EllipseData*) theData )->origin ;
+			theMajor       = &( (const TQ3EllipseData*) theData )->majorRadius ;
+			theMinor       = &( (const TQ3EllipseData*) theData )->minorRadius ;
+			break ;
+
+		case kQ3GeometryTypeTorus :
+			theOrigin      = &( (const TQ3TorusData*) theData )->origin ;
+			theOrientation = &( (const TQ3TorusData*) theData )->orientation ;
+			theMajor       = &( (const TQ3TorusData*) theData )->majorRadius ;
+			theMinor       = &( (const TQ3TorusData*) theData )->minorRadius ;
+			tubeRadius     = ( (const TQ3TorusData*) theData )->ratio * Q3FastVector3D_Length ( theOrientation ) ;
+			break ;
+
+		default :
+			return false ;
+		}
+
+
+
+	// Bound each axis
+	const float* origin = &theOrigin->x ;
+	const float* orient = &theOrientation->x ;
+	const float* major  = &theMajor->x ;
+	const float* minor  = &theMinor->x ;
+	float* boxMin = &theBox.min.x ;
+	float* boxMax = &theBox.max.x ;
+	
+	for ( int i = 0 ; i < 3 ; ++i )
+		{
+		float theExtent = fabsf ( major[ i ] ) + fabsf ( minor[ i ] ) + fabsf ( tubeRadius ) ;
+		
+		boxMin[ i ] = origin[ i ] + E3Num_Min ( orientMin * orient[ i ], orient[ i ] ) - theExtent ;
+		boxMax[ i ] = origin[ i ] + E3Num_Max ( orientMin * orient[ i ], orient[ i ] ) + theExtent ;
 		}
 
-	// The documentation isn't clear, but QD3D returns kQ3Success even if it also
-	// leaves *position == NULL.
-	return kQ3Success ;
+	theBox.isEmpty = kQ3False ;
+	
+	return true ;
 	}
 
 
@@ -796,36 +1977,201 @@ E3Group::getfirstobjectposition ( TQ3Object object, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_getlastobjectposition : Group get last object position method.
+//      e3group_picktree_build : Build the pick tree for a group.
 //-----------------------------------------------------------------------------
-//		Note : Finds the position of the object starting at the end
+//		Note :	The members are submitted in order to a private bounding view,
+//				so that each member is bounded in the coordinates current when
+//				the group starts to submit its members.
+//
+//				Geometries and non-inline groups with complete bounds are placed
+//				in the tree. Every other member is always submitted. Members
+//				which may be hit but can't be bounded (markers, whose size is
+//				in pixels, or geometries without their own bounds method) leave
+//				the bounds of the group incomplete.
+//
+//				Returns NULL if the state seen by the members while bounding
+//				might differ from the state they see while picking, e.g. due
+//				to a camera transform, or an inline group which is not bounded.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getlastobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+static E3GroupPickTree *
+e3group_picktree_build ( E3GroupMembers& theMembers )
 	{
-	return ( (E3Group*) group )->getlastobjectposition ( object, position ) ;
-	}
+	std::vector<TQ3BoundingBox> theBoxes ;
+	std::vector<TQ3Uns32> theSlots ;
+	std::vector<TQ3Uns32> alwaysSlots ;
+	TQ3BoundingBox theBounds ;
+	bool isComplete = true ;
+	bool isSafe = false ;
+	
+	TQ3XObjectSubmitMethod decomposedBounds =
+		( (E3Root*) E3ClassTree::GetClass ( kQ3ShapeTypeGeometry ) )->submitBoundsMethod ;
 
 
 
-TQ3Status
-E3Group::getlastobjectposition ( TQ3Object object, TQ3GroupPosition *position )
-	{
-	*position = NULL ;
+	// Bound the members
+	TQ3ViewObject theView = Q3View_New () ;
+	if ( theView == NULL )
+		return NULL ;
 
-	TQ3XGroupPosition* finish = &groupData.listHead ;
-	TQ3XGroupPosition* pos = groupData.listHead.prev ;
-	while ( pos != finish )
+	try
 		{
-		if ( pos->object == object )
+		TQ3ViewStatus viewStatus = kQ3ViewStatusError ;
+		if ( Q3View_StartBoundingBox ( theView, kQ3ComputeBoundsApproximate ) != kQ3Failure )
 			{
-			*position = (TQ3GroupPosition) pos ;
-			break ;
+			do
+				{
+				theBoxes.clear () ;
+				theSlots.clear () ;
+				alwaysSlots.clear () ;
+				Q3BoundingBox_Reset ( &theBounds ) ;
+				isComplete = true ;
+				isSafe     = true ;
+				
+				for ( TQ3Uns32 n = 0 ; isSafe && n < theMembers.thePositions.size () ; ++n )
+					{
+					TQ3Object theObject = theMembers.thePositions[ (int) n ]->object ;
+					TQ3ObjectType shapeType = theObject->GetObjectType ( kQ3SharedTypeShape ) ;
+					TQ3BoundingBox theBox ;
+					bool isCullable = false ;
+					bool isBounded  = true ;
+					theBox.isEmpty = kQ3True ;
+					
+					switch ( shapeType )
+						{
+						case kQ3ShapeTypeGeometry :
+							{
+							TQ3ObjectType geomType = theObject->GetLeafType () ;
+							TQ3BoundingBox localBox ;
+							if ( geomType == kQ3GeometryTypeMarker || geomType == kQ3GeometryTypePixmapMarker )
+								{
+								isBounded = false ;
+								break ;
+								}
+							
+							if ( e3group_picktree_quadricbox ( theObject, geomType, localBox ) )
+								e3group_picktree_transformbox ( theView, localBox, theBox ) ;
+							
+							else if ( ( (E3Root*) theObject->GetClass () )->submitBoundsMethod != decomposedBounds )
+								{
+								TQ3BoundingBox* viewBox = E3View_AccessBoundingBox ( theView ) ;
+								viewBox->isEmpty = kQ3True ;
+								E3View_SubmitRetained ( theView, theObject ) ;
+								theBox = *viewBox ;
+								}
+							
+							isCullable = ! theBox.isEmpty ;
+							isBounded  = isCullable ;
+							}
+							break ;
+						
+						case kQ3ShapeTypeGroup :
+							{
+							// Display groups which are not picked do nothing while picking,
+							// so must not change the bounding state either
+							bool isInline = true ;
+							if ( Q3_OBJECT_IS_CLASS ( theObject, E3DisplayGroup ) )
+								{
+								TQ3DisplayGroupState theState ;
+								( (E3DisplayGroup*) theObject )->GetState ( &theState ) ;
+								if ( ! E3Bit_IsSet ( theState, kQ3DisplayGroupStateMaskIsPicked ) )
+									break ;
+								
+								isInline = E3Bit_IsSet ( theState, kQ3DisplayGroupStateMaskIsInline ) ;
+								if ( isInline && E3Bit_IsSet ( theState, kQ3DisplayGroupStateMaskIsNotForBounding ) )
+									isSafe = false ;
+								}
+							
+							
+							// Inline groups change the state for the members after them,
+							// so are always submitted and must have a tree of their own
+							const E3GroupPickTree* childTree = ( (E3Group*) theObject )->getpicktree () ;
+							if ( isInline )
+								{
+								if ( childTree == NULL )
+									isSafe = false ;
+								else
+									E3View_SubmitRetained ( theView, theObject ) ;
+								}
+							
+							isBounded = ( childTree != NULL && childTree->IsComplete () ) ;
+							if ( isBounded )
+								{
+								if ( ! childTree->GetBounds ().isEmpty )
+									e3group_picktree_transformbox ( theView, childTree->GetBounds (), theBox ) ;
+								
+								isCullable = ! isInline ;
+								}
+							}
+							break ;
+						
+						case kQ3ShapeTypeTransform :
+							{
+							TQ3ObjectType xformType = theObject->GetLeafType () ;
+							if ( xformType == kQ3TransformTypeCamera || xformType == kQ3TransformTypeCameraRasterize )
+								isSafe = false ;
+							else
+								E3View_SubmitRetained ( theView, theObject ) ;
+							}
+							break ;
+						
+						case kQ3ShapeTypeStateOperator :
+							E3View_SubmitRetained ( theView, theObject ) ;
+							break ;
+						
+						case kQ3ShapeTypeShader :
+						case kQ3ShapeTypeStyle :
+						case kQ3ShapeTypeLight :
+						case kQ3ShapeTypeUnknown :
+							break ;
+						
+						default :
+							if ( theObject->GetObjectType ( kQ3SharedTypeSet ) != kQ3SetTypeAttribute )
+								isSafe = false ;
+							break ;
+						}
+					
+					
+					
+					// Save the member. Culled members with no bounds are never hit.
+					if ( ! isBounded )
+						isComplete = false ;
+					
+					if ( ! theBox.isEmpty )
+						E3BoundingBox_Union ( &theBox, &theBounds, &theBounds ) ;
+					
+					if ( isCullable && ! theBox.isEmpty )
+						{
+						theBoxes.push_back ( theBox ) ;
+						theSlots.push_back ( n ) ;
+						}
+					else if ( ! isCullable )
+						alwaysSlots.push_back ( n ) ;
+					}
+				
+				TQ3BoundingBox unusedBox ;
+				viewStatus = Q3View_EndBoundingBox ( theView, &unusedBox ) ;
+				}
+			while ( viewStatus == kQ3ViewStatusRetraverse ) ;
 			}
-		pos = pos->prev ;
+		
+		if ( viewStatus != kQ3ViewStatusDone )
+			isSafe = false ;
 		}
+	catch ( ... )
+		{
+		E3ErrorManager_PostError ( kQ3ErrorOutOfMemory, kQ3False ) ;
+		isSafe = false ;
+		}
+	
+	Q3Object_Dispose ( theView ) ;
+	
+	if ( ! isSafe )
+		return NULL ;
 
-	return kQ3Success ;
+
+
+	// Build the tree
+	return E3GroupPickTree_New ( theBoxes, theSlots, alwaysSlots, theBounds, isComplete ) ;
 	}
 
 
@@ -833,39 +2179,121 @@ E3Group::getlastobjectposition ( TQ3Object object, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_getnextobjectposition : Group get next object position method.
+//      e3group_picktree_worldtolocal : Find the transform for ray picks.
 //-----------------------------------------------------------------------------
-//		Note :	Finds the position of the object starting at position
-//				and going forewards
+//		Note :	Rays can only be moved to local coordinates by an invertible
+//				affine transform. Also returns a bound on the scaling of the
+//				world to local transform, by which pick tolerances are grown.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getnextobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+static bool
+e3group_picktree_worldtolocal ( const TQ3Matrix4x4* localToWorld, TQ3Matrix4x4* worldToLocal, float* theScale )
 	{
-	return ( (E3Group*) group )->getnextobjectposition ( object, position ) ;
+	const float (*m)[4] = localToWorld->value ;
+	if ( m[0][3] != 0.0f || m[1][3] != 0.0f || m[2][3] != 0.0f || m[3][3] != 1.0f ||
+		 fabsf ( E3Matrix4x4_Determinant ( localToWorld ) ) < kQ3RealZero )
+		return false ;
+	
+	E3Matrix4x4_Invert ( localToWorld, worldToLocal ) ;
+	
+	float sumSquares = 0.0f ;
+	for ( int i = 0 ; i < 3 ; ++i )
+		for ( int j = 0 ; j < 3 ; ++j )
+			sumSquares += worldToLocal->value[ i ][ j ] * worldToLocal->value[ i ][ j ] ;
+	
+	*theScale = sqrtf ( sumSquares ) ;
+	return true ;
 	}
 
 
 
-TQ3Status
-E3Group::getnextobjectposition ( TQ3Object object, TQ3GroupPosition *position )
-	{
-	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
 
-	*position = NULL;
 
-	for ( pos = pos->next ; pos != &groupData.listHead ; pos = pos->next )
-		if ( pos->object == object )
+//=============================================================================
+//      e3group_picktree_findslots : Find the members to submit for a pick.
+//-----------------------------------------------------------------------------
+//		Note :	The pick is moved into the coordinates current when the group
+//				starts to submit its members, which are those of its tree.
+//
+//				Window picks are tested against the projected boxes of the
+//				tree, within the pick tolerances for a window point pick. Ray
+//				picks are tested in local coordinates, where we allow for the
+//				tolerances by growing the boxes by the tolerance times a bound
+//				on the scaling of the world to local transform.
+//
+//				Returns false if the pick can't use the tree, in which case
+//				every member should be submitted.
+//-----------------------------------------------------------------------------
+static bool
+e3group_picktree_findslots ( TQ3ViewObject theView, const E3GroupPickTree& theTree, std::vector<TQ3Uns32>& theSlots )
+	{
+	TQ3PickObject thePick = E3View_AccessPick ( theView ) ;
+	const TQ3Matrix4x4* localToWorld = E3View_State_GetMatrixLocalToWorld ( theView ) ;
+	TQ3Matrix4x4 worldToFrustum, frustumToWindow, worldToWindow, localToWindow ;
+	TQ3Area theArea ;
+	
+	try
+		{
+		switch ( E3Pick_GetType ( thePick ) )
 			{
-			*position = (TQ3GroupPosition) pos ;
-			break;
+			case kQ3PickTypeWorldRay :
+				{
+				TQ3WorldRayPickData pickData ;
+				TQ3Matrix4x4 worldToLocal ;
+				TQ3Ray3D localRay ;
+				float theScale ;
+				if ( ! e3group_picktree_worldtolocal ( localToWorld, &worldToLocal, &theScale ) )
+					return false ;
+				
+				E3WorldRayPick_GetData ( thePick, &pickData ) ;
+				Q3Point3D_Transform  ( &pickData.ray.origin,    &worldToLocal, &localRay.origin ) ;
+				Q3Vector3D_Transform ( &pickData.ray.direction, &worldToLocal, &localRay.direction ) ;
+				
+				float theTolerance = E3Num_Max ( pickData.vertexTolerance, pickData.edgeTolerance ) ;
+				theTree.FindRaySlots ( localRay, theTolerance * theScale, theSlots ) ;
+				}
+				return true ;
+
+			case kQ3PickTypeWindowPoint :
+				{
+				TQ3WindowPointPickData pickData ;
+				E3WindowPointPick_GetData ( thePick, &pickData ) ;
+				
+				float theTolerance = E3Num_Max ( pickData.vertexTolerance, pickData.edgeTolerance ) ;
+				theArea.min.x = pickData.point.x - theTolerance ;
+				theArea.min.y = pickData.point.y - theTolerance ;
+				theArea.max.x = pickData.point.x + theTolerance ;
+				theArea.max.y = pickData.point.y + theTolerance ;
+				}
+				break ;
+
+			case kQ3PickTypeWindowRect :
+				{
+				TQ3WindowRectPickData pickData ;
+				E3WindowRectPick_GetData ( thePick, &pickData ) ;
+				theArea = pickData.rect ;
+				}
+				break ;
+
+			default :
+				return false ;
 			}
 
-	// The blue book does not make it clear whether the only indication of a failed
-	// search should be *position == NULL, or also a result of kQ3Failure.  QD3D 1.6
-	// seems to have a bug in this case, giving neither indication of failure.
-	// By analogy with other calls such as Q3Group_GetNextObjectPosition, I think we
-	// should return kQ3Success here.
-	return kQ3Success ;
+
+
+		// Test the projected boxes against the area
+		Q3View_GetWorldToFrustumMatrixState  ( theView, &worldToFrustum ) ;
+		Q3View_GetFrustumToWindowMatrixState ( theView, &frustumToWindow ) ;
+		E3Matrix4x4_Multiply ( &worldToFrustum, &frustumToWindow, &worldToWindow ) ;
+		E3Matrix4x4_Multiply ( localToWorld, &worldToWindow, &localToWindow ) ;
+		
+		theTree.FindAreaSlots ( localToWindow, theArea, theSlots ) ;
+		}
+	catch ( ... )
+		{
+		return false ;
+		}
+	
+	return true ;
 	}
 
 
@@ -873,34 +2301,105 @@ E3Group::getnextobjectposition ( TQ3Object object, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_getprevobjectposition : Get previous object position method.
+//      e3group_picktree_findrayslots : Find the members to submit for a world rays pick.
 //-----------------------------------------------------------------------------
-//		Note :	Finds the position of the object starting at position
-//				and going backwards
+//		Note :	Each active ray of the pick is tested against the tree, which
+//				gives the members it may hit. Those members are submitted with
+//				just those rays active, less any ray whose nearest hit is
+//				already in front of the member, while the members which are
+//				always submitted keep every active ray of the group.
+//
+//				theRayFirst and theRayCount give the run of theRays which is
+//				active for each entry of theSlots, or a first of
+//				kQ3ArrayIndexNULL for a member which keeps every active ray.
+//
+//				Returns false if the pick can't use the tree, in which case
+//				every member should be submitted with every active ray.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_getprevobjectposition(TQ3GroupObject group, TQ3Object object, TQ3GroupPosition *position)
+static bool
+e3group_picktree_findrayslots ( TQ3ViewObject theView, const E3GroupPickTree& theTree,
+								std::vector<TQ3Uns32>& theSlots, std::vector<TQ3Uns32>& theRays,
+								std::vector<TQ3Uns32>& theRayFirst, std::vector<TQ3Uns32>& theRayCount )
 	{
-	return ( (E3Group*) group )->getprevobjectposition ( object, position ) ;
-	}
-
-
+	TQ3PickObject thePick = E3View_AccessPick ( theView ) ;
+	const TQ3Matrix4x4* localToWorld = E3View_State_GetMatrixLocalToWorld ( theView ) ;
+	TQ3Matrix4x4 worldToLocal ;
+	float theScale ;
+	
+	if ( ! e3group_picktree_worldtolocal ( localToWorld, &worldToLocal, &theScale ) )
+		return false ;
+	
+	try
+		{
+		// Find the members along each ray, as (slot, ray) pairs
+		std::vector< std::pair<TQ3Uns32, TQ3Uns32> > slotRays ;
+		std::vector<TQ3Uns32> alwaysSlots, raySlots ;
+		const TQ3Uns32* activeRays ;
+		TQ3Uns32 numActive = E3WorldRaysPick_GetActiveRays ( thePick, &activeRays ) ;
+		
+		for ( TQ3Uns32 n = 0 ; n < numActive ; ++n )
+			{
+			TQ3PickObject rayPick = E3WorldRaysPick_AccessRayPick ( thePick, activeRays[ n ] ) ;
+			TQ3WorldRayPickData pickData ;
+			TQ3Ray3D localRay ;
+			E3WorldRayPick_GetData ( rayPick, &pickData ) ;
+			Q3Point3D_Transform  ( &pickData.ray.origin,    &worldToLocal, &localRay.origin ) ;
+			Q3Vector3D_Transform ( &pickData.ray.direction, &worldToLocal, &localRay.direction ) ;
+			
+			float theTolerance = E3Num_Max ( pickData.vertexTolerance, pickData.edgeTolerance ) ;
+			theTree.FindRaySlots ( localRay, theTolerance * theScale, raySlots ) ;
+			
+			for ( TQ3Uns32 m = 0 ; m < raySlots.size () ; ++m )
+				{
+				const TQ3BoundingBox& theBounds = theTree.GetSlotBounds ( raySlots[ m ] ) ;
+				if ( theBounds.isEmpty )
+					{
+					if ( n == 0 )
+						alwaysSlots.push_back ( raySlots[ m ] ) ;
+					}
+				else if ( ! E3Pick_IsBoxBeyondNearestHit ( rayPick, theView, &theBounds, localToWorld ) )
+					slotRays.push_back ( std::make_pair ( raySlots[ m ], activeRays[ n ] ) ) ;
+				}
+			}
 
-TQ3Status
-E3Group::getprevobjectposition ( TQ3Object object, TQ3GroupPosition *position )
-	{
-	TQ3XGroupPosition* pos = (TQ3XGroupPosition*) *position ;
 
-	*position = NULL ;
 
-	for ( pos = pos->prev ; pos != &groupData.listHead ; pos = pos->prev )
-		if ( pos->object == object )
+		// Merge them with the members which are always submitted, in slot order
+		std::sort ( slotRays.begin (), slotRays.end () ) ;
+		
+		theSlots.clear () ;
+		theRays.clear () ;
+		theRayFirst.clear () ;
+		theRayCount.clear () ;
+		
+		TQ3Uns32 i = 0, j = 0 ;
+		while ( i < slotRays.size () || j < alwaysSlots.size () )
 			{
-			*position = (TQ3GroupPosition) pos ;
-			break ;
+			if ( j < alwaysSlots.size () && ( i == slotRays.size () || alwaysSlots[ j ] < slotRays[ i ].first ) )
+				{
+				theSlots.push_back ( alwaysSlots[ j++ ] ) ;
+				theRayFirst.push_back ( kQ3ArrayIndexNULL ) ;
+				theRayCount.push_back ( 0 ) ;
+				}
+			else
+				{
+				TQ3Uns32 theSlot = slotRays[ i ].first ;
+				theSlots.push_back ( theSlot ) ;
+				theRayFirst.push_back ( (TQ3Uns32) theRays.size () ) ;
+				
+				for ( ; i < slotRays.size () && slotRays[ i ].first == theSlot ; ++i )
+					theRays.push_back ( slotRays[ i ].second ) ;
+				
+				theRayCount.push_back ( (TQ3Uns32) theRays.size () - theRayFirst.back () ) ;
+				}
 			}
-
-	return kQ3Success ;
+		}
+	catch ( ... )
+		{
+		return false ;
+		}
+	
+	return true ;
 	}
 
 
@@ -908,97 +2407,122 @@ E3Group::getprevobjectposition ( TQ3Object object, TQ3GroupPosition *position )
 
 
 //=============================================================================
-//      e3group_positionnew : Group position new method.
+//      E3Group::getpicktree : Get the pick tree of a group.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_positionnew(TQ3XGroupPosition** position, TQ3Object object, const void *initData)
-{
-#pragma unused (initData)
-	if (position)
-		{
-		TQ3XGroupPosition* newGroupPosition = (TQ3XGroupPosition*) Q3Memory_Allocate(sizeof(TQ3XGroupPosition));
+//		Note :	The tree is built the first time the group is picked, and again
+//				whenever its subtree edit index has changed. Returns NULL if
+//				the group can't be picked through a tree.
+//
+//				Building a tree submits the members, so is done without the
+//				cache locked. Threads which build a tree for the same index
+//				at once keep the first to be stored, and discard the others.
+//-----------------------------------------------------------------------------
+const E3GroupPickTree*
+E3Group::getpicktree ( void )
+	{
+	// Only groups submitted from their member cache can use a tree
+	E3GroupInfo* groupClass = GetClass () ;
+	if ( groupClass->startIterateMethod != e3group_startiterate ||
+		 groupClass->endIterateMethod   != e3group_enditerate )
+		return NULL ;
 
-		if (newGroupPosition)
-			{
-			newGroupPosition->next        = NULL;
-			newGroupPosition->prev        = NULL;
-			newGroupPosition->object      = Q3Shared_GetReference (object);
-			*position = newGroupPosition ;
-			return kQ3Success ;
-			}
-		*position = NULL;
-		}
-	return kQ3Failure ;
-}
 
 
+	// Rebuild the tree if the group or its members have changed
+	TQ3Uns32 theIndex = GetSubtreeEditIndex () ;
+	E3GroupMembers* theMembers = getmembers () ;
+	if ( theMembers == NULL )
+		return NULL ;
+	
+	{
+	E3SpinLocker theLocker ( theMembers->cacheLock ) ;
+	
+	if ( theMembers->pickTreeIndex == theIndex )
+		return theMembers->pickTree ;
+	}
 
 
 
-//=============================================================================
-//      e3group_positioncopy : Group position copy method.
-//-----------------------------------------------------------------------------
-static TQ3Status
-e3group_positioncopy(TQ3XGroupPosition *fromPosition, TQ3XGroupPosition *toPosition)
-{
-	if (fromPosition && toPosition)
+	// Build a new tree, and store it unless another thread got there first
+	E3GroupPickTree* theTree = e3group_picktree_build ( *theMembers ) ;
+	E3GroupPickTree* oldTree = theTree ;
+	
+	{
+	E3SpinLocker theLocker ( theMembers->cacheLock ) ;
+	
+	if ( theMembers->pickTreeIndex != theIndex )
 		{
-		if (fromPosition->object)
-			{
-			if (toPosition->object)
-				Q3Object_Dispose (toPosition->object);
-
-			toPosition->object      = Q3Shared_GetReference (fromPosition->object);
-
-			if (toPosition->object)
-				return kQ3Success ;
-			}
+		oldTree                   = theMembers->pickTree ;
+		theMembers->pickTree      = theTree ;
+		theMembers->pickTreeIndex = theIndex ;
 		}
-	return kQ3Failure ;
-}
+
+	theTree = theMembers->pickTree ;
+	}
+	
+	E3GroupPickTree_Dispose ( oldTree ) ;
+	
+	return theTree ;
+	}
 
 
 
 
 
 //=============================================================================
-//      e3group_positiondelete : Group position delete method.
+//      e3group_submit_contents : Group general submit method.
 //-----------------------------------------------------------------------------
-static void
-e3group_positiondelete(void *position)
+//		Note :	Used to submit a group for rendering or bounding. Separate
+//				routines are used for picking and writing.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3group_submit_contents(TQ3ViewObject theView, TQ3ObjectType objectType, E3Group* theObject, const void *objectData)
 {
-	TQ3XGroupPosition* pos = (TQ3XGroupPosition*)position;
-	if (pos->object)
-		Q3Object_Dispose (pos->object);
-	
-	Q3Memory_Free (&position);
-}
+#pragma unused( objectType, objectData )
+	E3GroupInfo* groupClass = theObject->GetClass () ;
 
 
+	// Submit the contents of a group with the standard iterator from its member cache
+	if ( groupClass->startIterateMethod == e3group_startiterate &&
+		 groupClass->endIterateMethod   == e3group_enditerate )
+	{
+		E3GroupMembers* theMembers = theObject->getmembers () ;
+		if ( theMembers == NULL )
+			return kQ3Failure ;
 
+		for ( TQ3Uns32 n = 0 ; n < theMembers->thePositions.size () ; ++n )
+		{
+			// Submit the object, ignore errors
+			E3View_SubmitRetained( theView, theMembers->thePositions[ (int) n ]->object );
+		}
 
+		return kQ3Success ;
+	}
 
-//=============================================================================
-//      e3group_startiterate : Group start iterate method.
-//-----------------------------------------------------------------------------
-static TQ3Status
-e3group_startiterate(TQ3GroupObject group, TQ3GroupPosition *iterator, TQ3Object *object, TQ3ViewObject view)
-{	TQ3Status			err;
-	TQ3GroupPosition	thePosition= NULL;
-	TQ3Object			theObject = NULL;
-#pragma unused (view)
 
-	err = ( (E3Group*) group )->GetFirstPosition( &thePosition );
-	if ((err == kQ3Success) && (thePosition != NULL))
-		err = ((E3Group*)group)->GetPositionObject( thePosition, &theObject );
 
-	if (object)
-		*object = theObject;
-	if (iterator)
-		*iterator = thePosition;
+	// Submit the contents of the group
+	TQ3GroupPosition thePosition ;
+	TQ3Object subObject ;
+	TQ3Status qd3dStatus = groupClass->startIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
+	if ( qd3dStatus != kQ3Failure )
+	{
+		while ( subObject != NULL ) // If that was the last object, stop
+		{
+			// Submit the object, ignore errors
+			E3View_SubmitRetained( theView, subObject );
+
+
+
+			// Get the next object	
+			qd3dStatus = groupClass->endIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
+			if ( qd3dStatus == kQ3Failure )
+				return kQ3Failure ;
 
-	return(err);
+		}
+	}
 
+	return qd3dStatus ;
 }
 
 
@@ -1006,68 +2530,136 @@ e3group_startiterate(TQ3GroupObject group, TQ3GroupPosition *iterator, TQ3Object
 
 
 //=============================================================================
-//      e3group_enditerate : Group end iterate method.
+//      e3group_render_findculledmembers : Find member groups to cull in bulk.
 //-----------------------------------------------------------------------------
-static TQ3Status
-e3group_enditerate(TQ3GroupObject group, TQ3GroupPosition *iterator, TQ3Object *object, TQ3ViewObject view)
-{	TQ3Status				err = kQ3Failure;
-#pragma unused (view)
-
-	if (object != NULL)
+//		Note :	Collects the display groups among the members which would cull
+//				themselves against a bounding box, with their boxes.
+//
+//				The boxes are tested in the coordinates current when the group
+//				starts to submit its members, so the scan stops at the first
+//				member which might change the matrix state. Inline groups and
+//				display groups with their own render method stop it too.
+//-----------------------------------------------------------------------------
+static void
+e3group_render_findculledmembers ( E3GroupMembers& theMembers, std::vector<TQ3Uns32>& theSlots,
+									std::vector<TQ3BoundingBox>& theBoxes )
 	{
-		E3Shared_Dispose( (E3Shared*) *object );
-		*object = NULL;
-		
-		err = ((E3Group*)group)->GetNextPosition( iterator );
-		if (err == kQ3Success)
+	TQ3XObjectSubmitMethod displayRender =
+		( (E3Root*) E3ClassTree::GetClass ( kQ3GroupTypeDisplay ) )->submitRenderMethod ;
+	
+	for ( TQ3Uns32 n = 0 ; n < theMembers.thePositions.size () ; ++n )
 		{
-			if (*iterator)
-				err = ((E3Group*)group)->GetPositionObject (*iterator, object);
+		TQ3Object theObject = theMembers.thePositions[ (int) n ]->object ;
+		
+		switch ( theObject->GetObjectType ( kQ3SharedTypeShape ) )
+			{
+			case kQ3ShapeTypeGeometry :
+			case kQ3ShapeTypeShader :
+			case kQ3ShapeTypeStyle :
+				continue ;
+			
+			case kQ3ShapeTypeGroup :
+				{
+				if ( ! Q3_OBJECT_IS_CLASS ( theObject, E3DisplayGroup ) ||
+					 ( (E3Root*) theObject->GetClass () )->submitRenderMethod != displayRender )
+					return ;
+				
+				TQ3DisplayGroupState theState ;
+				( (E3DisplayGroup*) theObject )->GetState ( &theState ) ;
+				if ( E3Bit_IsSet ( theState, kQ3DisplayGroupStateMaskIsInline ) )
+					return ;
+				
+				
+				// Match the test made by e3group_display_submit_render
+				TQ3BoundingBox theBBox ;
+				TQ3Boolean isAutoBounds = E3Bit_IsSet ( theState, kQ3DisplayGroupStateMaskAutoBoundingBox ) ;
+				if ( E3Bit_AnySet ( theState, kQ3DisplayGroupStateMaskIsDrawn ) &&
+					 ( E3Bit_IsSet ( theState, kQ3DisplayGroupStateMaskUseBoundingBox ) || isAutoBounds ) &&
+					 ( ! isAutoBounds || ( kQ3Success == ( (E3DisplayGroup*) theObject )->UpdateAutoBoundingBox () ) ) &&
+					 ( kQ3Success == ( (E3DisplayGroup*) theObject )->GetBoundingBox ( &theBBox ) ) )
+					{
+					theSlots.push_back ( n ) ;
+					theBoxes.push_back ( theBBox ) ;
+					}
+				}
+				continue ;
+			
+			default :
+				if ( theObject->GetObjectType ( kQ3SharedTypeSet ) == kQ3SetTypeAttribute )
+					continue ;
+				return ;
+			}
 		}
 	}
 
-	return(err);
-}
-
 
 
 
 
 //=============================================================================
-//      e3group_submit_contents : Group general submit method.
+//      e3group_submit_contents_render : Group render submit method.
 //-----------------------------------------------------------------------------
-//		Note :	Used to submit a group for rendering or bounding. Separate
-//				routines are used for picking and writing.
+//		Note :	Member groups which would cull themselves are tested together
+//				before any member is submitted. Those which are not visible are
+//				skipped, and those which are visible are marked so that they
+//				don't test themselves again.
+//
+//				While the view is recording a pass for replay, each group must
+//				record its own test, so members are submitted as usual.
 //-----------------------------------------------------------------------------
 static TQ3Status
-e3group_submit_contents(TQ3ViewObject theView, TQ3ObjectType objectType, E3Group* theObject, const void *objectData)
+e3group_submit_contents_render(TQ3ViewObject theView, TQ3ObjectType objectType, E3Group* theObject, const void *objectData)
 {
-#pragma unused( objectType, objectData )
 	E3GroupInfo* groupClass = theObject->GetClass () ;
 
 
-	// Submit the contents of the group
-	TQ3GroupPosition thePosition ;
-	TQ3Object subObject ;
-	TQ3Status qd3dStatus = groupClass->startIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
-	if ( qd3dStatus != kQ3Failure )
-	{
-		while ( subObject != NULL ) // If that was the last object, stop
-		{
-			// Submit the object, ignore errors
-			E3View_SubmitRetained( theView, subObject );
+	// Fall back to the general submit method if we can't cull in bulk
+	if ( ! E3View_IsGroupCullingAllowed ( theView ) || E3View_Replay_IsRecording ( theView ) ||
+		 groupClass->startIterateMethod != e3group_startiterate ||
+		 groupClass->endIterateMethod   != e3group_enditerate )
+		return e3group_submit_contents ( theView, objectType, theObject, objectData ) ;
 
+	E3GroupMembers* theMembers = theObject->getmembers () ;
+	if ( theMembers == NULL )
+		return kQ3Failure ;
+
+	std::vector<TQ3Uns32> theSlots ;
+	std::vector<TQ3BoundingBox> theBoxes ;
+	e3group_render_findculledmembers ( *theMembers, theSlots, theBoxes ) ;
+
+	TQ3Uns32 numSlots = (TQ3Uns32) theSlots.size () ;
+	std::vector<TQ3Uns32> visibleMask ( ( numSlots + 31 ) / 32 ) ;
+	if ( numSlots < 2 ||
+		 E3Renderer_Method_IsBBoxArrayVisible ( theView, numSlots, &theBoxes[ 0 ], &visibleMask[ 0 ] ) == kQ3Failure )
+		return e3group_submit_contents ( theView, objectType, theObject, objectData ) ;
 
 
-			// Get the next object	
-			qd3dStatus = groupClass->endIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
-			if ( qd3dStatus == kQ3Failure )
-				return kQ3Failure ;
 
+	// Submit the members, skipping the groups which were culled
+	TQ3Uns32 nextSlot = 0 ;
+	for ( TQ3Uns32 n = 0 ; n < theMembers->thePositions.size () ; ++n )
+	{
+		TQ3Object subObject = theMembers->thePositions[ (int) n ]->object ;
+		
+		if ( nextSlot < numSlots && theSlots[ nextSlot ] == n )
+		{
+			bool isVisible = ( visibleMask[ nextSlot / 32 ] & ( 1U << ( nextSlot % 32 ) ) ) != 0 ;
+			++nextSlot ;
+			
+			if ( ! isVisible )
+				continue ;
+			
+			E3View_SetPretestedGroup ( theView, subObject ) ;
 		}
+
+
+
+		// Submit the object, ignore errors
+		E3View_SubmitRetained( theView, subObject );
+		E3View_SetPretestedGroup ( theView, NULL ) ;
 	}
 
-	return qd3dStatus ;
+	return kQ3Success ;
 }
 
 
@@ -1091,29 +2683,115 @@ e3group_submit_pick(TQ3ViewObject theView, TQ3ObjectType objectType,
 
 
 
-	// Submit the contents of the group
-	TQ3GroupPosition thePosition ;
-	TQ3Object subObject ;
-	TQ3Status qd3dStatus = groupClass->startIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
-	if ( qd3dStatus != kQ3Failure )
+	// Submit the contents of a group with the standard iterator from its member cache.
+	//
+	// If the group has a pick tree, only the members which might be hit by the pick
+	// and the members which must always be submitted are submitted, still in order.
+	// If only the nearest hit is wanted, members whose bounds lie behind the nearest
+	// hit so far are skipped too. Their bounds are in the coordinates current when
+	// we start, before any of our transforms have been submitted.
+	//
+	// For a world rays pick, each member is submitted with only the rays which may
+	// hit it active, and the active rays of the group are restored afterwards.
+	TQ3Status qd3dStatus = kQ3Success ;
+	if ( groupClass->startIterateMethod == e3group_startiterate &&
+		 groupClass->endIterateMethod   == e3group_enditerate )
 	{
-		while ( subObject != NULL ) // If that was the last object, stop
+		const E3GroupPickTree* pickTree = theObject->getpicktree () ;
+		E3GroupMembers* theMembers = theObject->getmembers () ;
+		TQ3PickObject thePick = E3View_AccessPick ( theView ) ;
+		bool isRaysPick = ( E3Pick_GetType ( thePick ) == kQ3PickTypeWorldRays ) ;
+		std::vector<TQ3Uns32> theSlots, theRays, theRayFirst, theRayCount, groupRays ;
+		
+		bool useSlots = ( pickTree   != NULL &&
+						  theMembers != NULL &&
+						  ( isRaysPick ?
+						  	e3group_picktree_findrayslots ( theView, *pickTree, theSlots, theRays, theRayFirst, theRayCount ) :
+						  	e3group_picktree_findslots    ( theView, *pickTree, theSlots ) ) ) ;
+		TQ3Uns32 numSlots = useSlots ? (TQ3Uns32) theSlots.size () : 0 ;
+		
+		if ( theMembers == NULL )
+			qd3dStatus = kQ3Failure ;
+		
+		else if ( ! useSlots )
+			numSlots = theMembers->thePositions.size () ;
+		
+		TQ3Matrix4x4 localToWorld ;
+		if ( useSlots )
+			localToWorld = *E3View_State_GetMatrixLocalToWorld ( theView ) ;
+		
+		if ( useSlots && isRaysPick )
+		{
+			const TQ3Uns32* activeRays ;
+			TQ3Uns32 numActive = E3WorldRaysPick_GetActiveRays ( thePick, &activeRays ) ;
+			groupRays.assign ( activeRays, activeRays + numActive ) ;
+		}
+		
+		for ( TQ3Uns32 n = 0 ; n < numSlots ; ++n )
 		{
+			// Skip members which can't be nearer than the nearest hit
+			if ( useSlots &&
+				 E3Pick_IsBoxBeyondNearestHit ( thePick, theView,
+				 	&pickTree->GetSlotBounds ( theSlots[ n ] ), &localToWorld ) )
+				continue ;
+
+
+
+			// Activate the rays which may hit the member
+			if ( useSlots && isRaysPick )
+			{
+				if ( theRayFirst[ n ] == kQ3ArrayIndexNULL )
+					E3WorldRaysPick_SetActiveRays ( thePick, (TQ3Uns32) groupRays.size (),
+						groupRays.empty () ? NULL : &groupRays[ 0 ] ) ;
+				else
+					E3WorldRaysPick_SetActiveRays ( thePick, theRayCount[ n ], &theRays[ theRayFirst[ n ] ] ) ;
+			}
+
+
+
 			// We're picking, update the view
-			E3View_PickStack_SavePosition ( theView, thePosition ) ;
+			TQ3XGroupPosition* thePosition = theMembers->thePositions[ (int) ( useSlots ? theSlots[ n ] : n ) ] ;
+			E3View_PickStack_SavePosition ( theView, (TQ3GroupPosition) thePosition ) ;
 
 
 
 			// Submit the object, ignore errors
-			E3View_SubmitRetained( theView, subObject );
+			E3View_SubmitRetained( theView, thePosition->object );
+		}
+		
+		if ( useSlots && isRaysPick )
+			E3WorldRaysPick_SetActiveRays ( thePick, (TQ3Uns32) groupRays.size (),
+				groupRays.empty () ? NULL : &groupRays[ 0 ] ) ;
+	}
 
 
 
-			// Get the next object	
-			qd3dStatus = groupClass->endIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
-			if ( qd3dStatus == kQ3Failure )
-				return kQ3Failure ;
+	// Submit the contents of the group
+	else
+	{
+		TQ3GroupPosition thePosition ;
+		TQ3Object subObject ;
+		qd3dStatus = groupClass->startIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
+		if ( qd3dStatus != kQ3Failure )
+		{
+			while ( subObject != NULL ) // If that was the last object, stop
+			{
+				// We're picking, update the view
+				E3View_PickStack_SavePosition ( theView, thePosition ) ;
+
+
+
+				// Submit the object, ignore errors
+				E3View_SubmitRetained( theView, subObject );
 
+
+
+				// Get the next object	
+				qd3dStatus = groupClass->endIterateMethod ( theObject, &thePosition, &subObject, theView ) ;
+				if ( qd3dStatus == kQ3Failure )
+					return kQ3Failure ;
+
+			}
 		}
 	}
 
@@ -1281,10 +2959,13 @@ e3group_metahandler(TQ3XMethodType methodType)
 			break;
 
 		case kQ3XMethodTypeObjectSubmitBounds:
-		case kQ3XMethodTypeObjectSubmitRender:
 			theMethod = (TQ3XFunctionPointer) e3group_submit_contents;
 			break;
 
+		case kQ3XMethodTypeObjectSubmitRender:
+			theMethod = (TQ3XFunctionPointer) e3group_submit_contents_render;
+			break;
+
 		case kQ3XMethodTypeObjectSubmitWrite:
 			theMethod = (TQ3XFunctionPointer) e3group_submit_write;
 			break;
@@ -1322,6 +3003,7 @@ e3group_display_new(TQ3Object theObject, void *privateData, const void *paramDat
 	instanceData->displayGroupData.bBox.max.y   = 0.0f;
 	instanceData->displayGroupData.bBox.max.z   = 0.0f;
 	instanceData->displayGroupData.bBox.isEmpty = kQ3True;
+	instanceData->displayGroupData.boundsStamp  = 0;
 
 	return kQ3Success ;
 	}
@@ -1349,13 +3031,27 @@ e3group_display_submit_render(TQ3ViewObject theView, TQ3ObjectType objectType,
 
 	
 	// Do group culling if appropriate
+	//
+	// If the view is recording this pass for replay, later passes may cull
+	// differently, so the group is submitted whatever the result.
+	//
+	// Groups with automatic bounds bring their bounding box up to date first,
+	// and groups which our parent has already found visible aren't tested.
 	TQ3BoundingBox	theBBox;
-	if ( shouldSubmit &&
-		E3Bit_IsSet( theState, kQ3DisplayGroupStateMaskUseBoundingBox ) &&
+	TQ3Boolean		isCullRecorded = kQ3False;
+	TQ3Boolean		isPretested    = E3View_TakePretestedGroup( theView, theObject );
+	TQ3Boolean		isAutoBounds   = E3Bit_IsSet( theState, kQ3DisplayGroupStateMaskAutoBoundingBox );
+	if ( shouldSubmit && ! isPretested &&
+		(E3Bit_IsSet( theState, kQ3DisplayGroupStateMaskUseBoundingBox ) || isAutoBounds) &&
 		E3View_IsGroupCullingAllowed( theView ) &&
+		(! isAutoBounds || (kQ3Success == ((E3DisplayGroup*)theObject)->UpdateAutoBoundingBox())) &&
 		(kQ3Success == ((E3DisplayGroup*)theObject)->GetBoundingBox( &theBBox )) )
 	{
 		shouldSubmit = E3Renderer_Method_IsBBoxVisible( theView, &theBBox );
+		
+		isCullRecorded = E3View_Replay_BeginCullTest( theView, &theBBox, shouldSubmit );
+		if ( isCullRecorded )
+			shouldSubmit = kQ3True;
 	}
 
 
@@ -1369,19 +3065,22 @@ e3group_display_submit_render(TQ3ViewObject theView, TQ3ObjectType objectType,
 			qd3dStatus = E3Push_Submit ( theView ) ;
 
 
-		if ( qd3dStatus == kQ3Failure ) return qd3dStatus;
-		
-		
-		// Submit the group, using the generic group submit method
-		qd3dStatus = e3group_submit_contents ( theView, objectType, (E3Group*) theObject, objectData ) ;
+		if ( qd3dStatus != kQ3Failure )
+		{
+			// Submit the group, using the group render submit method
+			qd3dStatus = e3group_submit_contents_render ( theView, objectType, (E3Group*) theObject, objectData ) ;
 
 
 
-		// If the group isn't inline, pop the view state
-		if ( ! isInline )
-			E3Pop_Submit ( theView ) ;
+			// If the group isn't inline, pop the view state
+			if ( ! isInline )
+				E3Pop_Submit ( theView ) ;
+		}
 	}
 	
+	if ( isCullRecorded )
+		E3View_Replay_EndCullTest( theView );
+	
 	return qd3dStatus ;
 }
 
@@ -1392,6 +3091,14 @@ e3group_display_submit_render(TQ3ViewObject theView, TQ3ObjectType objectType,
 //=============================================================================
 //      e3group_display_submit_bounds : Display group submit for bounding method.
 //-----------------------------------------------------------------------------
+//		Note :	Approximate bounds of a group with an automatic bounding box
+//				are taken from the corners of its box, transformed as for a
+//				TriMesh, rather than from its contents. Nested groups with
+//				automatic bounds are then only re-bounded when edited.
+//
+//				An inline group is always submitted, since the transforms in
+//				its contents apply to the objects which follow it.
+//-----------------------------------------------------------------------------
 static TQ3Status
 e3group_display_submit_bounds(TQ3ViewObject theView, TQ3ObjectType objectType,
 								TQ3Object theObject, const void *objectData)
@@ -1407,6 +3114,29 @@ e3group_display_submit_bounds(TQ3ViewObject theView, TQ3ObjectType objectType,
 
 
 
+	// Use our automatic bounds if we can
+	TQ3BoundingMethod boundingMethod = E3View_GetBoundingMethod( theView );
+	
+	if ( shouldSubmit &&
+		 E3Bit_IsSet( theState, kQ3DisplayGroupStateMaskAutoBoundingBox ) &&
+		 ! E3Bit_IsSet( theState, kQ3DisplayGroupStateMaskIsInline ) &&
+		 ( boundingMethod == kQ3BoxBoundsApprox || boundingMethod == kQ3SphereBoundsApprox ) &&
+		 ( (E3DisplayGroup*) theObject )->UpdateAutoBoundingBox() == kQ3Success )
+	{
+		TQ3BoundingBox	theBBox = ( (E3DisplayGroup*) theObject )->displayGroupData.bBox;
+		TQ3Point3D		boundCorners[8];
+		
+		if ( ! theBBox.isEmpty )
+		{
+			E3BoundingBox_GetCorners( &theBBox, boundCorners );
+			E3View_UpdateBounds( theView, 8, sizeof(TQ3Point3D), boundCorners );
+		}
+		
+		return kQ3Success;
+	}
+
+
+
 	// If we need to submit the group, do so
 	if ( shouldSubmit )
 	{
@@ -2854,6 +4584,11 @@ E3Group_GetType(TQ3GroupObject group)
 TQ3GroupPosition
 E3Group::AddObject ( TQ3Object object )
 	{
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	return GetClass ()->addObjectMethod ( this, object ) ;
 	}
@@ -2890,6 +4625,11 @@ TQ3GroupPosition
 E3Group::AddObjectBefore ( TQ3GroupPosition position, TQ3Object object )
 	{
 	
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	return GetClass ()->addObjectBeforeMethod ( this, position, object ) ;
 	}
@@ -2904,6 +4644,11 @@ E3Group::AddObjectBefore ( TQ3GroupPosition position, TQ3Object object )
 TQ3GroupPosition
 E3Group::AddObjectAfter ( TQ3GroupPosition position, TQ3Object object )
 	{
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	return GetClass ()->addObjectAfterMethod ( this, position, object ) ;
 	}
@@ -2944,6 +4689,11 @@ E3Group::GetPositionObject ( TQ3GroupPosition position, TQ3Object *object )
 TQ3Status
 E3Group::SetPositionObject ( TQ3GroupPosition position, TQ3Object object )
 	{
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	TQ3Status result = GetClass ()->setPositionObjectMethod ( this, position, object ) ;
 
@@ -2962,6 +4712,11 @@ E3Group::SetPositionObject ( TQ3GroupPosition position, TQ3Object object )
 TQ3Object
 E3Group::RemovePosition ( TQ3GroupPosition position )
 	{
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	return GetClass ()->removePositionMethod ( this, position ) ;
 	}
@@ -3046,6 +4801,11 @@ E3Group::CountObjects ( TQ3Uns32* nObjects )
 TQ3Status
 E3Group::EmptyObjects ( void )
 	{
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	return GetClass ()->emptyObjectsOfTypeMethod ( this, kQ3ObjectTypeShared ) ;
 	}
@@ -3130,6 +4890,11 @@ E3Group::CountObjectsOfType ( TQ3ObjectType isType, TQ3Uns32* nObjects )
 TQ3Status
 E3Group::EmptyObjectsOfType ( TQ3ObjectType isType )
 	{
+	// Invalidate the member cache
+	invalidatemembers () ;
+
+
+
 	// Call the method
 	return GetClass ()->emptyObjectsOfTypeMethod ( this, isType ) ;
 	}
@@ -3144,6 +4909,21 @@ E3Group::EmptyObjectsOfType ( TQ3ObjectType isType )
 TQ3Status
 E3Group::GetFirstObjectPosition ( TQ3Object object, TQ3GroupPosition* position )
 	{
+	// Look up the object in the member cache, for the standard methods
+	if ( GetClass ()->getFirstObjectPositionMethod == e3group_getfirstobjectposition ||
+		 GetClass ()->getFirstObjectPositionMethod == e3group_display_ordered_getfirstobjectposition )
+		{
+		E3GroupMembers* theMembers = getmembers () ;
+		if ( theMembers != NULL )
+			{
+			TQ3Uns32 theSlot = theMembers->objectSlots[ (int) e3group_members_findslot ( *theMembers, object ) ] ;
+			*position = ( theSlot == 0 ) ? NULL : (TQ3GroupPosition) theMembers->thePositions[ (int) ( theSlot - 1 ) ] ;
+			return kQ3Success ;
+			}
+		}
+
+
+
 	// Call the method
 	return GetClass ()->getFirstObjectPositionMethod ( this, object, position ) ;
 	}
@@ -3194,6 +4974,32 @@ E3Group::GetPreviousObjectPosition ( TQ3Object object, TQ3GroupPosition* positio
 
 
 
+//=============================================================================
+//      E3Group_GetSubtreeEditIndex : Get the edit index of the group's contents.
+//-----------------------------------------------------------------------------
+//		Note :	The index changes whenever the group, or anything in it at any
+//				depth, is edited, added or removed. Indexes come from a single
+//				counter, so can be compared across groups.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+E3Group::GetSubtreeEditIndex ( void )
+	{
+	// Give the group a new index if it has been edited since the last call
+	if ( E3Atomic_LoadUns32 ( &groupData.isSubtreeEdited ) )
+		{
+		E3SpinLocker theLocker ( sGroupSettleLock ) ;
+		
+		if ( groupData.isSubtreeEdited )
+			e3group_subtree_settle ( this, E3Atomic_Increment ( &sGroupSubtreeEditIndex ) ) ;
+		}
+	
+	return groupData.subtreeEditIndex ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3DisplayGroup_New : Creates a new display group.
 //-----------------------------------------------------------------------------
@@ -3304,11 +5110,20 @@ E3DisplayGroup::SetAndUseBoundingBox ( const TQ3BoundingBox *pBBox )
 //=============================================================================
 //      E3DisplayGroup_GetBoundingBox : Get the bounding box.
 //-----------------------------------------------------------------------------
+//		Note :	Automatic bounds are not recorded in the group's state, since
+//				they may be stored while other threads are reading it.
+//-----------------------------------------------------------------------------
 TQ3Status
 E3DisplayGroup::GetBoundingBox ( TQ3BoundingBox *pBBox )
 	{
 	// Get the field
 	*pBBox = displayGroupData.bBox ;
+
+	// Automatic bounds can be used once calculated, unless they are empty
+	if ( (displayGroupData.state & kQ3DisplayGroupStateMaskAutoBoundingBox) != 0 &&
+		 E3Atomic_LoadUns32( &displayGroupData.boundsStamp ) != 0 )
+		return pBBox->isEmpty ? kQ3Failure : kQ3Success;
+
 	return ((displayGroupData.state & kQ3DisplayGroupStateMaskHasBoundingBox) != 0)?
 		kQ3Success : kQ3Failure;
 	}
@@ -3383,6 +5198,87 @@ E3DisplayGroup::CalcAndUseBoundingBox ( TQ3ComputeBounds computeBounds, TQ3ViewO
 
 
 
+//=============================================================================
+//      E3DisplayGroup_UpdateAutoBoundingBox : Update an automatic bounding box.
+//-----------------------------------------------------------------------------
+//		Note :	The bounds of the contents are recalculated in a private view
+//				if the group or its contents have changed since they were last
+//				calculated. The group's edit index is left alone, since the
+//				bounds are derived from the group.
+//
+//				Nested groups with automatic bounds contribute their own boxes,
+//				transformed, so only the edited groups below this one have
+//				their contents bounded again (see e3group_display_submit_bounds).
+//
+//				A group which is shared between threads may have its bounds
+//				calculated by several threads at once. The bounds are only
+//				stored by the first of them, and are stored before the stamp
+//				so that a thread which sees the stamp also sees the bounds.
+//				The group's state is left alone, see GetBoundingBox.
+//
+//				Returns kQ3Failure if the bounds could not be calculated.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3DisplayGroup::UpdateAutoBoundingBox ( void )
+	{
+	// Check whether the bounds are still valid
+	TQ3Uns32 theStamp = GetSubtreeEditIndex () ;
+	if ( theStamp == E3Atomic_LoadUns32 ( &displayGroupData.boundsStamp ) )
+		return kQ3Success ;
+
+
+
+	// Calculate the bounds of the contents
+	TQ3ViewObject theView = Q3View_New () ;
+	if ( theView == NULL )
+		return kQ3Failure ;
+
+	TQ3ViewStatus viewErr ;
+	TQ3BoundingBox theBBox ;
+	TQ3SubdivisionStyleData	subData = {
+		kQ3SubdivisionMethodConstant,
+		20.0f, 20.0f
+	};
+
+	TQ3Status err = Q3View_StartBoundingBox ( theView, kQ3ComputeBoundsApproximate ) ;
+	if ( err != kQ3Failure )
+		{
+		do
+			{
+			E3SubdivisionStyle_Submit( &subData, theView );
+			
+			err = e3group_submit_contents ( theView, kQ3GroupTypeDisplay, this, NULL ) ;
+			viewErr = Q3View_EndBoundingBox ( theView, &theBBox ) ;
+			}
+		while ( viewErr == kQ3ViewStatusRetraverse ) ;
+		
+		if ( viewErr != kQ3ViewStatusDone )
+			err = kQ3Failure ;
+		}
+	
+	Q3Object_Dispose ( theView ) ;
+	
+	if ( err == kQ3Failure )
+		return kQ3Failure ;
+
+
+
+	// Save the bounds, unless another thread already has
+	E3SpinLocker theLocker ( sGroupBoundsLock ) ;
+	
+	if ( theStamp != displayGroupData.boundsStamp )
+		{
+		displayGroupData.bBox = theBBox ;
+		E3Atomic_StoreUns32 ( &displayGroupData.boundsStamp, theStamp ) ;
+		}
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3LightGroup_New : Creates a new light group.
 //-----------------------------------------------------------------------------
@@ -3456,6 +5352,47 @@ E3IOProxyDisplayGroup_New(void)
 
 
 
+//=============================================================================
+//      E3Group_PropagateEdit : Pass an edit up to the groups above an object.
+//-----------------------------------------------------------------------------
+//		Note :	Called by E3Shared::Edited.
+//
+//				Most edited objects are in no group with a member cache, so
+//				the lock is only taken for an object which has parents.
+//-----------------------------------------------------------------------------
+void
+E3Group_PropagateEdit(E3Shared *theObject)
+{
+	// An object with no parents only needs to mark itself, if it's a group
+	if ( E3Atomic_LoadPointer( (void* const volatile*) &theObject->sharedData.parentGroups ) == NULL )
+	{
+		if ( Q3_OBJECT_IS_CLASS( theObject, E3Group ) )
+			E3Atomic_StoreUns32( &( (E3Group*) theObject )->groupData.isSubtreeEdited, kQ3True );
+		
+		return;
+	}
+
+
+
+	// A group is edited itself, anything else marks the groups it is in
+	E3SpinLocker theLocker( sGroupParentsLock );
+	
+	if ( Q3_OBJECT_IS_CLASS( theObject, E3Group ) )
+	{
+		e3group_subtree_edited( (E3Group*) theObject );
+	}
+	else if ( theObject->sharedData.parentGroups != NULL )
+	{
+		E3SharedParents* theParents = theObject->sharedData.parentGroups;
+		for ( TQ3Uns32 n = 0; n < theParents->theGroups.size(); ++n )
+			e3group_subtree_edited( theParents->theGroups[ (int) n ] );
+	}
+}
+
+
+
+
+
 //=============================================================================
 //      E3XGroup_GetPositionPrivate : Gets the private data for this position.
 //-----------------------------------------------------------------------------
@@ -128,7 +128,7 @@ enum
 
 typedef struct TQ3XGroupPosition *TQ3XGroupPositionPtr;
 
-typedef struct TQ3XGroupPosition { // 12 bytes overhead per object in a group
+typedef struct TQ3XGroupPosition { // 24 bytes overhead per object in a group (LP64)
 // initialised in e3group_positionnew
 	TQ3XGroupPositionPtr	next;
 	TQ3XGroupPositionPtr	prev;
@@ -175,10 +175,16 @@ public :
 
 
 
+struct E3GroupMembers ;
+class E3GroupPickTree ;
+
 struct E3GroupData
 {
 	TQ3XGroupPosition						listHead ;
 	TQ3Uns32								groupPositionSize ;
+	E3GroupMembers*							memberCache ;	// Built on demand, see getmembers
+	TQ3Uns32								subtreeEditIndex ;
+	volatile TQ3Uns32						isSubtreeEdited ;	// subtreeEditIndex is out of date
 };
 
 
@@ -188,7 +194,7 @@ class E3Group : public E3Shape
 Q3_CLASS_ENUMS ( kQ3ShapeTypeGroup, E3Group, E3Shape )
 
 public :
-// 16 bytes overhead per group
+// 48 bytes overhead per group (LP64)
 // initialised in e3group_new
 	E3GroupData								groupData;
 		
@@ -215,6 +221,10 @@ public :
 	TQ3Status								getnextobjectposition ( TQ3Object object, TQ3GroupPosition *position ) ;		
 	TQ3Status								getprevobjectposition ( TQ3Object object, TQ3GroupPosition *position ) ;
 
+	E3GroupMembers*							getmembers ( void ) ;
+	void									invalidatemembers ( void ) ;
+	const E3GroupPickTree*					getpicktree ( void ) ;
+
 	TQ3GroupPosition						AddObject ( TQ3Object object ) ;
 
 	TQ3GroupPosition						AddObjectAndDispose ( TQ3Object *theObject ) ;
@@ -239,6 +249,7 @@ public :
 	TQ3Status								GetLastObjectPosition ( TQ3Object object, TQ3GroupPosition* position ) ;
 	TQ3Status								GetNextObjectPosition ( TQ3Object object, TQ3GroupPosition* position ) ;
 	TQ3Status								GetPreviousObjectPosition ( TQ3Object object, TQ3GroupPosition* position ) ;
+	TQ3Uns32								GetSubtreeEditIndex ( void ) ;
 
 
 	
@@ -253,6 +264,7 @@ struct E3DisplayGroupData
 {
 	TQ3DisplayGroupState	state ;
 	TQ3BoundingBox			bBox ;
+	volatile TQ3Uns32		boundsStamp ;	// Subtree stamp of an automatic bBox, or 0
 };
 
 
@@ -263,7 +275,7 @@ Q3_CLASS_ENUMS ( kQ3GroupTypeDisplay, E3DisplayGroup, E3Group )
 
 public :
 
-// 32 bytes + 16 bytes = 48 bytes overhead per display group
+// 36 bytes + 48 bytes = 84 bytes overhead per display group (LP64)
 // initialised in e3group_display_new
 	E3DisplayGroupData		displayGroupData;
 	
@@ -275,6 +287,7 @@ public :
 	TQ3Status				GetBoundingBox ( TQ3BoundingBox *pBBox ) ;
 	TQ3Status				RemoveBoundingBox ( void ) ;
 	TQ3Status				CalcAndUseBoundingBox ( TQ3ComputeBounds computeBounds, TQ3ViewObject view ) ;
+	TQ3Status				UpdateAutoBoundingBox ( void ) ;
 
 
 	friend TQ3Status		e3group_display_new(TQ3Object theObject,
@@ -353,6 +366,8 @@ TQ3GroupObject		E3IOProxyDisplayGroup_New(void);
 
 void				*E3XGroup_GetPositionPrivate(TQ3GroupObject group, TQ3GroupPosition position);
 
+void				E3Group_PropagateEdit(E3Shared *theObject);
+
 
 
 
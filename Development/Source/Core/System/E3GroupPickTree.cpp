@@ -0,0 +1,519 @@
+/*  NAME:
+        E3GroupPickTree.cpp
+
+    DESCRIPTION:
+        Pick hierarchy over the members of a group.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "E3Prefix.h"
+#include "E3GroupPickTree.h"
+#include "E3ErrorManager.h"
+
+#include <algorithm>
+#include <new>
+
+/*
+	DISCUSSION
+	
+	The nodes are laid out as in E3TriMeshBVH: a flat array in depth-first
+	order, where the left child of an interior node immediately follows it.
+	Leaves refer to a run of entries in mSlots.
+	
+	Queries collect the slots of the leaves they reach, sort them, and merge
+	them with the slots that are always submitted. Submitting the result in
+	order gives the same hits, in the same order, as submitting every member
+	of the group, since the members that are left out could not have been hit.
+*/
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+namespace
+{
+	// Leaves hold at most this many members
+	const TQ3Uns32		kMaxLeafMembers				= 4;
+
+	// Traversal stack size, which must exceed the maximum tree depth
+	const TQ3Uns32		kMaxStackDepth				= 64;
+}
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+namespace
+{
+	struct CompareCentres
+	{
+						CompareCentres( const std::vector<TQ3BoundingBox>& inBoxes,
+										int inAxis )
+							: mBoxes( inBoxes )
+							, mAxis( inAxis ) {}
+		
+		bool			operator()( TQ3Uns32 inOne, TQ3Uns32 inTwo ) const
+						{
+							// Compare twice the centres, which orders them the same way
+							return (&mBoxes[ inOne ].min.x)[ mAxis ] + (&mBoxes[ inOne ].max.x)[ mAxis ] <
+								(&mBoxes[ inTwo ].min.x)[ mAxis ] + (&mBoxes[ inTwo ].max.x)[ mAxis ];
+						}
+
+		const std::vector<TQ3BoundingBox>&	mBoxes;
+		int									mAxis;
+	};
+}
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      e3grouppicktree_ray_hits_box : Slab test of a ray against a node.
+//-----------------------------------------------------------------------------
+//		Note :	The node's box is grown by inMargin on every side. A zero
+//				direction component has a huge reciprocal rather than an
+//				infinite one, so that an origin on a slab plane gives no NaN.
+//-----------------------------------------------------------------------------
+static inline bool
+e3grouppicktree_ray_hits_box( const float inMin[3], const float inMax[3], float inMargin,
+								const float inOrigin[3], const float inInvDir[3] )
+{
+	float	tNear = 0.0f;
+	float	tFar  = kQ3MaxFloat;
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		float	t0 = (inMin[i] - inMargin - inOrigin[i]) * inInvDir[i];
+		float	t1 = (inMax[i] + inMargin - inOrigin[i]) * inInvDir[i];
+		
+		if (t0 > t1)
+			std::swap( t0, t1 );
+		
+		if (t0 > tNear)
+			tNear = t0;
+		
+		if (t1 < tFar)
+			tFar = t1;
+		
+		if (tNear > tFar)
+			return false;
+	}
+	
+	return true;
+}
+
+
+
+
+
+//=============================================================================
+//      e3grouppicktree_box_overlaps_area : Test a node against a window area.
+//-----------------------------------------------------------------------------
+//		Note :	If any corner of the box lies on or behind the eye plane its
+//				projection is meaningless, so we report an overlap and let the
+//				members decide.
+//-----------------------------------------------------------------------------
+static bool
+e3grouppicktree_box_overlaps_area( const float inMin[3], const float inMax[3],
+									const TQ3Matrix4x4& inLocalToWindow,
+									const TQ3Area& inArea )
+{
+	const float	(*m)[4] = inLocalToWindow.value;
+	float		minX = kQ3MaxFloat, minY = kQ3MaxFloat;
+	float		maxX = -kQ3MaxFloat, maxY = -kQ3MaxFloat;
+	
+	for (int n = 0; n < 8; ++n)
+	{
+		float	x = (n & 1) ? inMax[0] : inMin[0];
+		float	y = (n & 2) ? inMax[1] : inMin[1];
+		float	z = (n & 4) ? inMax[2] : inMin[2];
+		
+		float	w  = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+		if (w <= kQ3RealZero)
+			return true;
+		
+		float	invW = 1.0f / w;
+		float	wx = (x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0]) * invW;
+		float	wy = (x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1]) * invW;
+		
+		minX = std::min( minX, wx );
+		maxX = std::max( maxX, wx );
+		minY = std::min( minY, wy );
+		maxY = std::max( maxY, wy );
+	}
+	
+	return (maxX >= inArea.min.x) && (minX <= inArea.max.x) &&
+		(maxY >= inArea.min.y) && (minY <= inArea.max.y);
+}
+
+
+
+
+
+//=============================================================================
+//      Class methods
+//-----------------------------------------------------------------------------
+//      E3GroupPickTree::E3GroupPickTree : Build the hierarchy.
+//-----------------------------------------------------------------------------
+E3GroupPickTree::E3GroupPickTree( const std::vector<TQ3BoundingBox>& inBoxes,
+								const std::vector<TQ3Uns32>& inSlots,
+								const std::vector<TQ3Uns32>& inAlwaysSlots,
+								const TQ3BoundingBox& inBounds,
+								bool inIsComplete )
+	: mAlwaysSlots( inAlwaysSlots )
+	, mBounds( inBounds )
+	, mIsComplete( inIsComplete )
+{
+	const TQ3Uns32	numMembers = static_cast<TQ3Uns32>( inBoxes.size() );
+	
+	Q3_ASSERT( inSlots.size() == inBoxes.size() );
+	if (numMembers == 0)
+		return;
+
+
+
+	// Build the tree over the box indices, then map them to slots
+	std::vector<TQ3Uns32>	theItems( numMembers );
+
+	for (TQ3Uns32 n = 0; n < numMembers; ++n)
+		theItems[n] = n;
+
+	mNodes.reserve( 2 * (numMembers / kMaxLeafMembers) + 1 );
+	mNodes.push_back( Node() );
+	
+	BuildNode( 0, 0, numMembers, theItems, inBoxes );
+	
+	mSlots.resize( numMembers );
+	
+	for (TQ3Uns32 n = 0; n < numMembers; ++n)
+		mSlots[n] = inSlots[ theItems[n] ];
+
+
+
+	// Remember the bounds of each slot in the tree
+	TQ3BoundingBox	emptyBox;
+	Q3BoundingBox_Reset( &emptyBox );
+
+	mSlotBounds.resize( *std::max_element( inSlots.begin(), inSlots.end() ) + 1, emptyBox );
+	
+	for (TQ3Uns32 n = 0; n < numMembers; ++n)
+		mSlotBounds[ inSlots[n] ] = inBoxes[n];
+}
+
+
+
+
+
+//=============================================================================
+//      E3GroupPickTree::GetSlotBounds : Get the bounds of a slot.
+//-----------------------------------------------------------------------------
+const TQ3BoundingBox&
+E3GroupPickTree::GetSlotBounds( TQ3Uns32 inSlot ) const
+{
+	static TQ3BoundingBox	sEmptyBox = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, kQ3True };
+	
+	if (inSlot < mSlotBounds.size())
+		return mSlotBounds[ inSlot ];
+	
+	return sEmptyBox;
+}
+
+
+
+
+
+//=============================================================================
+//      E3GroupPickTree::BuildNode : Build a node and its children.
+//-----------------------------------------------------------------------------
+void
+E3GroupPickTree::BuildNode( TQ3Uns32 inNodeIndex, TQ3Uns32 inFirst, TQ3Uns32 inCount,
+							std::vector<TQ3Uns32>& ioItems,
+							const std::vector<TQ3BoundingBox>& inBoxes )
+{
+	float	boxMin[3]    = {  kQ3MaxFloat,  kQ3MaxFloat,  kQ3MaxFloat };
+	float	boxMax[3]    = { -kQ3MaxFloat, -kQ3MaxFloat, -kQ3MaxFloat };
+	float	centreMin[3] = {  kQ3MaxFloat,  kQ3MaxFloat,  kQ3MaxFloat };
+	float	centreMax[3] = { -kQ3MaxFloat, -kQ3MaxFloat, -kQ3MaxFloat };
+
+
+
+	// Find the bounds of the members, and of their centres
+	for (TQ3Uns32 n = inFirst; n < inFirst + inCount; ++n)
+	{
+		const float*	itemMin = &inBoxes[ ioItems[n] ].min.x;
+		const float*	itemMax = &inBoxes[ ioItems[n] ].max.x;
+		
+		for (int i = 0; i < 3; ++i)
+		{
+			float	theCentre = 0.5f * (itemMin[i] + itemMax[i]);
+			
+			boxMin[i]    = std::min( boxMin[i],    itemMin[i] );
+			boxMax[i]    = std::max( boxMax[i],    itemMax[i] );
+			centreMin[i] = std::min( centreMin[i], theCentre );
+			centreMax[i] = std::max( centreMax[i], theCentre );
+		}
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		mNodes[ inNodeIndex ].min[i] = boxMin[i];
+		mNodes[ inNodeIndex ].max[i] = boxMax[i];
+	}
+
+
+
+	// Pick the longest centre axis to split along
+	int		theAxis = 0;
+	float	theExtent = centreMax[0] - centreMin[0];
+	
+	for (int i = 1; i < 3; ++i)
+	{
+		if (centreMax[i] - centreMin[i] > theExtent)
+		{
+			theAxis   = i;
+			theExtent = centreMax[i] - centreMin[i];
+		}
+	}
+
+
+
+	// Small or degenerate runs become leaves
+	if ( (inCount <= kMaxLeafMembers) || (theExtent <= 0.0f) )
+	{
+		mNodes[ inNodeIndex ].first = inFirst;
+		mNodes[ inNodeIndex ].count = inCount;
+		return;
+	}
+
+
+
+	// Otherwise split at the median, and build the children. The left child
+	// must be the next node in the array, so it is added before recursing.
+	TQ3Uns32	leftCount = inCount / 2;
+	
+	std::nth_element( ioItems.begin() + inFirst,
+		ioItems.begin() + inFirst + leftCount,
+		ioItems.begin() + inFirst + inCount,
+		CompareCentres( inBoxes, theAxis ) );
+
+	TQ3Uns32	leftIndex = static_cast<TQ3Uns32>( mNodes.size() );
+	mNodes.push_back( Node() );
+	BuildNode( leftIndex, inFirst, leftCount, ioItems, inBoxes );
+	
+	TQ3Uns32	rightIndex = static_cast<TQ3Uns32>( mNodes.size() );
+	mNodes.push_back( Node() );
+	BuildNode( rightIndex, inFirst + leftCount, inCount - leftCount, ioItems, inBoxes );
+	
+	mNodes[ inNodeIndex ].first = rightIndex;
+	mNodes[ inNodeIndex ].count = 0;
+}
+
+
+
+
+
+//=============================================================================
+//      E3GroupPickTree::MergeAlwaysSlots : Merge in the slots always submitted.
+//-----------------------------------------------------------------------------
+//		Note :	On entry ioSlots holds the slots found by a query, in any
+//				order. On exit it holds those and the slots that are always
+//				submitted, in increasing order.
+//-----------------------------------------------------------------------------
+void
+E3GroupPickTree::MergeAlwaysSlots( std::vector<TQ3Uns32>& ioSlots ) const
+{
+	const size_t	numFound = ioSlots.size();
+	
+	std::sort( ioSlots.begin(), ioSlots.end() );
+	ioSlots.insert( ioSlots.end(), mAlwaysSlots.begin(), mAlwaysSlots.end() );
+	std::inplace_merge( ioSlots.begin(), ioSlots.begin() + numFound, ioSlots.end() );
+}
+
+
+
+
+
+//=============================================================================
+//      E3GroupPickTree::FindRaySlots : Find the slots to submit for a ray.
+//-----------------------------------------------------------------------------
+void
+E3GroupPickTree::FindRaySlots( const TQ3Ray3D& inRay, float inMargin,
+								std::vector<TQ3Uns32>& outSlots ) const
+{
+	TQ3Uns32		theStack[ kMaxStackDepth ];
+	TQ3Uns32		stackSize = 0;
+
+
+
+	// Prepare the ray for slab tests
+	const float	origin[3] = { inRay.origin.x, inRay.origin.y, inRay.origin.z };
+	const float	invDir[3] = { (inRay.direction.x != 0.0f) ? (1.0f / inRay.direction.x) : kQ3MaxFloat,
+							  (inRay.direction.y != 0.0f) ? (1.0f / inRay.direction.y) : kQ3MaxFloat,
+							  (inRay.direction.z != 0.0f) ? (1.0f / inRay.direction.z) : kQ3MaxFloat };
+
+
+
+	// Collect the members along the ray
+	outSlots.clear();
+	
+	if (! mNodes.empty())
+		theStack[ stackSize++ ] = 0;
+	
+	while (stackSize > 0)
+	{
+		const TQ3Uns32	nodeIndex = theStack[ --stackSize ];
+		const Node&		theNode   = mNodes[ nodeIndex ];
+		
+		if (! e3grouppicktree_ray_hits_box( theNode.min, theNode.max, inMargin, origin, invDir ))
+			continue;
+		
+		if (theNode.count != 0)
+			outSlots.insert( outSlots.end(), mSlots.begin() + theNode.first,
+				mSlots.begin() + theNode.first + theNode.count );
+		else
+		{
+			Q3_ASSERT( stackSize + 2 <= kMaxStackDepth );
+
+			theStack[ stackSize++ ] = theNode.first;
+			theStack[ stackSize++ ] = nodeIndex + 1;
+		}
+	}
+	
+	MergeAlwaysSlots( outSlots );
+}
+
+
+
+
+
+//=============================================================================
+//      E3GroupPickTree::FindAreaSlots : Find the slots to submit for an area.
+//-----------------------------------------------------------------------------
+void
+E3GroupPickTree::FindAreaSlots( const TQ3Matrix4x4& inLocalToWindow,
+								const TQ3Area& inArea,
+								std::vector<TQ3Uns32>& outSlots ) const
+{
+	TQ3Uns32		theStack[ kMaxStackDepth ];
+	TQ3Uns32		stackSize = 0;
+
+
+
+	// Collect the members within the area
+	outSlots.clear();
+	
+	if (! mNodes.empty())
+		theStack[ stackSize++ ] = 0;
+	
+	while (stackSize > 0)
+	{
+		const TQ3Uns32	nodeIndex = theStack[ --stackSize ];
+		const Node&		theNode   = mNodes[ nodeIndex ];
+		
+		if (! e3grouppicktree_box_overlaps_area( theNode.min, theNode.max, inLocalToWindow, inArea ))
+			continue;
+		
+		if (theNode.count != 0)
+			outSlots.insert( outSlots.end(), mSlots.begin() + theNode.first,
+				mSlots.begin() + theNode.first + theNode.count );
+		else
+		{
+			Q3_ASSERT( stackSize + 2 <= kMaxStackDepth );
+
+			theStack[ stackSize++ ] = theNode.first;
+			theStack[ stackSize++ ] = nodeIndex + 1;
+		}
+	}
+	
+	MergeAlwaysSlots( outSlots );
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      E3GroupPickTree_New : Build a hierarchy for the members of a group.
+//-----------------------------------------------------------------------------
+E3GroupPickTree*
+E3GroupPickTree_New( const std::vector<TQ3BoundingBox>& inBoxes,
+					const std::vector<TQ3Uns32>& inSlots,
+					const std::vector<TQ3Uns32>& inAlwaysSlots,
+					const TQ3BoundingBox& inBounds,
+					bool inIsComplete )
+{
+	E3GroupPickTree*	theTree = NULL;
+	
+	try
+	{
+		theTree = new E3GroupPickTree( inBoxes, inSlots, inAlwaysSlots, inBounds, inIsComplete );
+	}
+	catch (...)
+	{
+		E3ErrorManager_PostError( kQ3ErrorOutOfMemory, kQ3False );
+	}
+	
+	return theTree;
+}
+
+
+
+
+
+//=============================================================================
+//      E3GroupPickTree_Dispose : Dispose of a hierarchy.
+//-----------------------------------------------------------------------------
+void
+E3GroupPickTree_Dispose( E3GroupPickTree*& ioTree )
+{
+	delete ioTree;
+	ioTree = NULL;
+}
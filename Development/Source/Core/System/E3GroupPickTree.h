@@ -0,0 +1,189 @@
+/*  NAME:
+        E3GroupPickTree.h
+
+    DESCRIPTION:
+        Header file for E3GroupPickTree.cpp.
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+#ifndef E3GROUP_PICK_TREE_HDR
+#define E3GROUP_PICK_TREE_HDR
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "E3Prefix.h"
+
+#include <vector>
+
+
+
+
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+/*!
+	@class		E3GroupPickTree
+	
+	@abstract	Bounding volume hierarchy over the members of a group.
+	
+	@discussion	Members are identified by their slot, the index of their
+				position within the group's member cache. Boxes are in the
+				coordinates that are current when the group starts to submit
+				its members, so the tree remains valid under any transform
+				applied outside the group.
+				
+				Only some members are placed in the tree. The others, such as
+				transforms and styles, must be submitted whatever the pick, and
+				are listed separately so that queries can return every slot to
+				submit in group order.
+*/
+class E3GroupPickTree
+{
+public:
+	/*!
+		@function	E3GroupPickTree
+		@abstract	Build a hierarchy for the members of a group.
+		@discussion	Throws std::bad_alloc if memory runs out.
+		@param		inBoxes			Bounds of the members placed in the tree.
+		@param		inSlots			Slot of each box in inBoxes.
+		@param		inAlwaysSlots	Slots that must always be submitted, in
+									increasing order.
+		@param		inBounds		Bounds of every member that may be hit.
+		@param		inIsComplete	True if inBounds includes every hit the
+									group could produce.
+	*/
+							E3GroupPickTree(
+									const std::vector<TQ3BoundingBox>& inBoxes,
+									const std::vector<TQ3Uns32>& inSlots,
+									const std::vector<TQ3Uns32>& inAlwaysSlots,
+									const TQ3BoundingBox& inBounds,
+									bool inIsComplete );
+	
+	/*!
+		@function	GetBounds
+		@abstract	Get the bounds of the members which may be hit.
+	*/
+	const TQ3BoundingBox&	GetBounds() const { return mBounds; }
+	
+	/*!
+		@function	IsComplete
+		@abstract	Find whether the bounds include every possible hit.
+		@discussion	A group whose bounds are complete can be culled as a
+					whole by the group that contains it.
+	*/
+	bool					IsComplete() const { return mIsComplete; }
+	
+	/*!
+		@function	GetSlotBounds
+		@abstract	Get the bounds of the member in a slot.
+		@discussion	Slots that are not in the tree, such as those which are
+					always submitted, have an empty box.
+		@param		inSlot		A slot returned by a query.
+	*/
+	const TQ3BoundingBox&	GetSlotBounds( TQ3Uns32 inSlot ) const;
+	
+	/*!
+		@function	FindRaySlots
+		@abstract	Find the slots to submit for a ray pick.
+		@discussion	The ray need not have a normalized direction.
+		@param		inRay		A ray, in the coordinates of the tree.
+		@param		inMargin	Distance by which to grow each box, to allow
+								for pick tolerances.
+		@param		outSlots	Receives the slots to submit, in order.
+	*/
+	void					FindRaySlots(
+									const TQ3Ray3D& inRay,
+									float inMargin,
+									std::vector<TQ3Uns32>& outSlots ) const;
+
+	/*!
+		@function	FindAreaSlots
+		@abstract	Find the slots to submit for a window-space pick area.
+		@param		inLocalToWindow		Transform from the coordinates of the
+										tree to window coordinates.
+		@param		inArea				Area in window coordinates.
+		@param		outSlots			Receives the slots to submit, in order.
+	*/
+	void					FindAreaSlots(
+									const TQ3Matrix4x4& inLocalToWindow,
+									const TQ3Area& inArea,
+									std::vector<TQ3Uns32>& outSlots ) const;
+
+private:
+	struct Node
+	{
+		float		min[3];
+		float		max[3];
+		TQ3Uns32	first;		// leaf: first entry in mSlots, interior: right child
+		TQ3Uns32	count;		// leaf: number of entries, interior: 0
+	};
+
+	void					BuildNode(
+									TQ3Uns32 inNodeIndex,
+									TQ3Uns32 inFirst,
+									TQ3Uns32 inCount,
+									std::vector<TQ3Uns32>& ioItems,
+									const std::vector<TQ3BoundingBox>& inBoxes );
+	
+	void					MergeAlwaysSlots(
+									std::vector<TQ3Uns32>& ioSlots ) const;
+
+	std::vector<Node>		mNodes;
+	std::vector<TQ3Uns32>	mSlots;
+	std::vector<TQ3Uns32>	mAlwaysSlots;
+	std::vector<TQ3BoundingBox>	mSlotBounds;
+	TQ3BoundingBox			mBounds;
+	bool					mIsComplete;
+};
+
+
+
+
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+E3GroupPickTree*	E3GroupPickTree_New(
+							const std::vector<TQ3BoundingBox>& inBoxes,
+							const std::vector<TQ3Uns32>& inSlots,
+							const std::vector<TQ3Uns32>& inAlwaysSlots,
+							const TQ3BoundingBox& inBounds,
+							bool inIsComplete );
+void				E3GroupPickTree_Dispose( E3GroupPickTree*& ioTree );
+
+#endif
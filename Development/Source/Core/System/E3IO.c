@@ -674,8 +674,12 @@ E3File::IsNextObjectOfType ( TQ3ObjectType ofType )
 	if ( ofType == nextObjectType )
 		return kQ3True ;
 	
-	if ( ( nextObjectType != kQ3ObjectTypeInvalid )
-	&& ( E3ClassTree::GetClass ( nextObjectType )->IsType ( ofType ) ) )
+	// Objects of unregistered types can only be skipped
+	E3ClassInfoPtr theClass = NULL ;
+	if ( nextObjectType != kQ3ObjectTypeInvalid )
+		theClass = E3ClassTree::GetClass ( nextObjectType ) ;
+
+	if ( ( theClass != NULL ) && theClass->IsType ( ofType ) )
 		return kQ3True ;
 		
 	return kQ3False ;
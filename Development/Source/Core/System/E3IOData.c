@@ -945,6 +945,13 @@ E3Float32_ReadArray( TQ3Uns32 numFloats, TQ3Float32* theFloats, E3File* theFile)
 	Q3_REQUIRE_OR_RESULT(( theFile->GetFileStatus () == kE3_File_Status_Reading),kQ3Failure);
 	Q3_REQUIRE_OR_RESULT((format != NULL),kQ3Failure);
 
+
+	// Formats which validate the floats as they read them need no second pass
+	floatArrayRead = (TQ3XFFormatFloat32ReadArrayMethod) format->GetMethod ( kQ3XMethodTypeFFormatFloat32ReadArrayValid);
+
+	if (floatArrayRead != NULL)
+		return floatArrayRead( format, numFloats, theFloats );
+
 	
 	floatArrayRead = (TQ3XFFormatFloat32ReadArrayMethod) format->GetMethod ( kQ3XMethodTypeFFormatFloat32ReadArray);
 
@@ -205,8 +205,9 @@ e3shared_new ( E3Shared* theObject, void *privateData, void *paramData )
 
 
 	// Initialise our instance data
-	theObject->sharedData.refCount  = 1 ;
-	theObject->sharedData.editIndex = 1 ;
+	theObject->sharedData.refCount     = 1 ;
+	theObject->sharedData.editIndex    = 1 ;
+	theObject->sharedData.parentGroups = NULL ;
 
 #if Q3_DEBUG
 	theObject->sharedData.logRefs = kQ3False;
@@ -232,20 +233,23 @@ E3Shared_Dispose ( E3Shared* theObject )
 
 
 	// Decrement the reference count
-	Q3_ASSERT(theObject->sharedData.refCount >= 1);
-	theObject->sharedData.refCount--;
+	//
+	// The count is updated atomically, since other threads may be acquiring
+	// or releasing references to the same object.
+	Q3_ASSERT(E3Atomic_LoadUns32( &theObject->sharedData.refCount ) >= 1);
+	TQ3Uns32 refCount = E3Atomic_Decrement( &theObject->sharedData.refCount );
 
 #if Q3_DEBUG
 	if (theObject->IsLoggingRefs())
 	{
 		Q3_MESSAGE_FMT("Ref count of %p reduced to %d", theObject,
-			(int) theObject->sharedData.refCount );
+			(int) refCount );
 	}
 #endif
 
 
 	// If the reference count falls to 0, dispose of the object
-	if ( theObject->sharedData.refCount == 0 )
+	if ( refCount == 0 )
 		theObject->DestroyInstance () ;
 	}
 
@@ -276,6 +280,7 @@ e3shared_duplicate(TQ3Object fromObject,     const void *fromPrivateData,
 	// Initialise the instance data of the new object
 	instanceData->sharedData.refCount  = 1;
 	instanceData->sharedData.editIndex = E3Integer_Abs( fromInstanceData->sharedData.editIndex );
+	instanceData->sharedData.parentGroups = NULL;
 
 #if Q3_DEBUG
 	instanceData->sharedData.logRefs = kQ3False;
@@ -493,7 +498,7 @@ e3root_new( TQ3Object theObject, void *privateData, void *paramData )
 
 #if Q3_DEBUG
 	E3GlobalsPtr	theGlobals = E3Globals_Get();
-	static TQ3Boolean	sIsMakingListHead = kQ3False;
+	static E3_THREAD_LOCAL TQ3Boolean	sIsMakingListHead = kQ3False;
 	
 	if (sIsMakingListHead == kQ3True)
 	{
@@ -506,6 +511,10 @@ e3root_new( TQ3Object theObject, void *privateData, void *paramData )
 		// initialize instance data
 		if (theGlobals->isLeakChecking == kQ3True)
 		{
+			// objects may be created on several threads at once, so the list
+			// is only changed with it locked
+			E3SpinLocker	theLocker( theGlobals->listLock );
+			
 			// make sure the list has a header
 			if (theGlobals->listHead == NULL)
 			{
@@ -611,6 +620,9 @@ e3root_delete( TQ3Object theObject, void *privateData )
 	}
 
 #if Q3_DEBUG
+	{
+	E3SpinLocker	theLocker( E3Globals_Get()->listLock );
+	
 	if ( instanceData->prev != NULL )
 	{
 		NEXTLINK( instanceData->prev ) = instanceData->next;
@@ -619,6 +631,7 @@ e3root_delete( TQ3Object theObject, void *privateData )
 
 	instanceData->prev = NULL;
 	instanceData->next = NULL;
+	}
 	
 	E3StackCrawl_Dispose( instanceData->stackCrawl );
 #endif
@@ -1834,14 +1847,18 @@ E3Shared::GetReference ( void )
 	// Increment the reference count and return the object. Note that we
 	// return the object passed in: this is OK since we're not declared
 	// to return a different object.
-	sharedData.refCount++;
-	Q3_ASSERT(sharedData.refCount >= 2);
+	//
+	// The count is updated atomically, as for E3Shared_Dispose.
 #if Q3_DEBUG
+	TQ3Uns32 refCount = E3Atomic_Increment( &sharedData.refCount );
+	Q3_ASSERT(refCount >= 2);
 	if (IsLoggingRefs())
 	{
 		Q3_MESSAGE_FMT("Ref count of %p increased to %d", this,
-			(int) sharedData.refCount );
+			(int) refCount );
 	}
+#else
+	E3Atomic_Increment( &sharedData.refCount );
 #endif
 
 	return this ;
@@ -1922,6 +1939,9 @@ void		E3Shared::SetLoggingRefs( TQ3Boolean inLog )
 //=============================================================================
 //      E3Shared_Edited : Increase the edit index of an object.
 //-----------------------------------------------------------------------------
+//		Note :	Any groups containing the object, directly or indirectly, are
+//				marked as edited.
+//-----------------------------------------------------------------------------
 TQ3Status
 E3Shared::Edited ( void )
 {
@@ -1929,6 +1949,10 @@ E3Shared::Edited ( void )
 	{
 		// Increment the edit index
 		++sharedData.editIndex ;
+		
+		// Let the groups containing the object know
+		if ( (sharedData.parentGroups != NULL) || Q3_OBJECT_IS_CLASS( this, E3Group ) )
+			E3Group_PropagateEdit( this );
 	}
 	
 	return kQ3Success ;
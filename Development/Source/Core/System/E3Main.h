@@ -305,10 +305,13 @@ public :
 
 
 
+struct E3SharedParents;
+
 struct E3SharedData
 {
 	TQ3Uns32		refCount;
 	TQ3Int32		editIndex;	// normally positive, negative means "locked"
+	E3SharedParents*	parentGroups;	// groups to tell about edits, see E3Group_PropagateEdit
 #if Q3_DEBUG
 	TQ3Boolean		logRefs;
 #endif
@@ -52,6 +52,10 @@
 #include <limits>
 #include <cstring>
 
+#if QUESA_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
 
 
 //=============================================================================
@@ -141,6 +145,383 @@ inline void AdvanceConstPointer( const T*& ioPtr, TQ3Uns32 inCount )
 }
 
 
+
+
+
+//=============================================================================
+//      SSE2 batch kernels
+//-----------------------------------------------------------------------------
+//		The array functions below process blocks of four elements at a time
+//		in structure-of-arrays form, then leave any remainder to their scalar
+//		loops. Each lane performs the same operations in the same order as the
+//		scalar code, so results are bit-for-bit identical to a scalar build
+//		that does its float arithmetic in SSE registers.
+//
+//		Packed arrays are loaded and stored with three 16-byte accesses and a
+//		transpose, strided arrays are gathered and scattered one float at a
+//		time. Each block is loaded completely before it is stored, so the
+//		output may still be the same as the input.
+//-----------------------------------------------------------------------------
+#if QUESA_USE_SSE2
+
+template< typename T>
+inline void e3sse2_load_xyz( const T* inPtr, TQ3Uns32 inStructSize,
+							__m128& outX, __m128& outY, __m128& outZ )
+{
+	if (inStructSize == sizeof(T))
+	{
+		const float*	f = &inPtr->x;
+		__m128			a = _mm_loadu_ps( f + 0 );	// x0 y0 z0 x1
+		__m128			b = _mm_loadu_ps( f + 4 );	// y1 z1 x2 y2
+		__m128			c = _mm_loadu_ps( f + 8 );	// z2 x3 y3 z3
+		__m128			t1 = _mm_shuffle_ps( b, c, _MM_SHUFFLE(2, 1, 3, 2) );	// x2 y2 x3 y3
+		__m128			t2 = _mm_shuffle_ps( a, b, _MM_SHUFFLE(1, 0, 2, 1) );	// y0 z0 y1 z1
+		
+		outX = _mm_shuffle_ps( a,  t1, _MM_SHUFFLE(2, 0, 3, 0) );
+		outY = _mm_shuffle_ps( t2, t1, _MM_SHUFFLE(3, 1, 2, 0) );
+		outZ = _mm_shuffle_ps( t2, c,  _MM_SHUFFLE(3, 0, 3, 1) );
+	}
+	else
+	{
+		const T*	p0 = inPtr;
+		const T*	p1 = p0;	AdvanceConstPointer( p1, inStructSize );
+		const T*	p2 = p1;	AdvanceConstPointer( p2, inStructSize );
+		const T*	p3 = p2;	AdvanceConstPointer( p3, inStructSize );
+		
+		outX = _mm_setr_ps( p0->x, p1->x, p2->x, p3->x );
+		outY = _mm_setr_ps( p0->y, p1->y, p2->y, p3->y );
+		outZ = _mm_setr_ps( p0->z, p1->z, p2->z, p3->z );
+	}
+}
+
+template< typename T>
+inline void e3sse2_store_xyz( T* outPtr, TQ3Uns32 outStructSize,
+							__m128 inX, __m128 inY, __m128 inZ )
+{
+	if (outStructSize == sizeof(T))
+	{
+		float*	f = &outPtr->x;
+		__m128	xy = _mm_unpacklo_ps( inX, inY );								// x0 y0 x1 y1
+		__m128	zx = _mm_shuffle_ps( inZ, inX, _MM_SHUFFLE(1, 1, 0, 0) );		// z0 z0 x1 x1
+		__m128	yz = _mm_shuffle_ps( inY, inZ, _MM_SHUFFLE(1, 1, 1, 1) );		// y1 y1 z1 z1
+		__m128	xy2 = _mm_unpackhi_ps( inX, inY );								// x2 y2 x3 y3
+		__m128	zx2 = _mm_shuffle_ps( inZ, inX, _MM_SHUFFLE(3, 3, 2, 2) );		// z2 z2 x3 x3
+		__m128	yz3 = _mm_shuffle_ps( inY, inZ, _MM_SHUFFLE(3, 3, 3, 3) );		// y3 y3 z3 z3
+		
+		_mm_storeu_ps( f + 0, _mm_shuffle_ps( xy,  zx,  _MM_SHUFFLE(2, 0, 1, 0) ) );
+		_mm_storeu_ps( f + 4, _mm_shuffle_ps( yz,  xy2, _MM_SHUFFLE(1, 0, 2, 0) ) );
+		_mm_storeu_ps( f + 8, _mm_shuffle_ps( zx2, yz3, _MM_SHUFFLE(2, 0, 2, 0) ) );
+	}
+	else
+	{
+		float	x[4], y[4], z[4];
+		
+		_mm_storeu_ps( x, inX );
+		_mm_storeu_ps( y, inY );
+		_mm_storeu_ps( z, inZ );
+		
+		for (TQ3Uns32 k = 0; k < 4; ++k)
+		{
+			outPtr->x = x[k];
+			outPtr->y = y[k];
+			outPtr->z = z[k];
+			AdvancePointer( outPtr, outStructSize );
+		}
+	}
+}
+
+
+
+
+
+//=============================================================================
+//      e3vector3d_dot_array_sse2 : SSE2 blocks of E3Vector3D_DotArray.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the number of vectors processed, and advances the
+//				pointers past them. At least one output must be non-NULL.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3vector3d_dot_array_sse2(const TQ3Vector3D *&ioFirstVectors3D,
+						  const TQ3Vector3D *&ioSecondVectors3D,
+						  float *&ioDotProducts,
+						  TQ3Boolean *&ioDotLessThanZeros,
+						  TQ3Uns32 numVectors,
+						  TQ3Uns32 inStructSize,
+						  TQ3Uns32 outDotProductStructSize,
+						  TQ3Uns32 outDotLessThanZeroStructSize)
+{	__m128		x1, y1, z1, x2, y2, z2, dotProducts;
+	float		theDots[4];
+	TQ3Uns32	i, k, lessThanZeros;
+
+
+
+	// Dot each block of four vectors
+	for (i = 0; i + 4 <= numVectors; i += 4)
+	{
+		e3sse2_load_xyz( ioFirstVectors3D,  inStructSize, x1, y1, z1 );
+		e3sse2_load_xyz( ioSecondVectors3D, inStructSize, x2, y2, z2 );
+
+		dotProducts = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x1, x2 ),
+											  _mm_mul_ps( y1, y2 ) ),
+											  _mm_mul_ps( z1, z2 ) );
+
+		if (ioDotProducts != NULL)
+		{
+			if (outDotProductStructSize == sizeof(float))
+			{
+				_mm_storeu_ps( ioDotProducts, dotProducts );
+				ioDotProducts += 4;
+			}
+			else
+			{
+				_mm_storeu_ps( theDots, dotProducts );
+				for (k = 0; k < 4; ++k)
+				{
+					*ioDotProducts = theDots[k];
+					AdvancePointer( ioDotProducts, outDotProductStructSize );
+				}
+			}
+		}
+
+		if (ioDotLessThanZeros != NULL)
+		{
+			lessThanZeros = (TQ3Uns32) _mm_movemask_ps( _mm_cmplt_ps( dotProducts, _mm_setzero_ps() ) );
+			for (k = 0; k < 4; ++k)
+			{
+				*ioDotLessThanZeros = (TQ3Boolean) ((lessThanZeros >> k) & 1);
+				AdvancePointer( ioDotLessThanZeros, outDotLessThanZeroStructSize );
+			}
+		}
+
+		AdvanceConstPointer( ioFirstVectors3D,  4 * inStructSize );
+		AdvanceConstPointer( ioSecondVectors3D, 4 * inStructSize );
+	}
+	
+	return(i);
+}
+
+
+
+
+
+//=============================================================================
+//      e3triangle_crossproduct_array_sse2 : SSE2 blocks of
+//											 E3Triangle_CrossProductArray.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the number of triangles processed. Blocks that mix
+//				used and unused triangles are handled one triangle at a time.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3triangle_crossproduct_array_sse2(TQ3Uns32				numTriangles,
+								   const TQ3Uns8		*usageFlags,
+								   const TQ3Uns32		*theIndices,
+								   const TQ3Point3D		*thePoints,
+								   TQ3Vector3D			*theNormals)
+{	__m128				v1x, v1y, v1z, v2x, v2y, v2z, nx, ny, nz, invLength;
+	const TQ3Point3D	*p1[4], *p2[4], *p3[4];
+	TQ3Uns32			n, m, k;
+	TQ3Boolean			anyUnused;
+
+
+
+	// Calculate the normals of each block of four triangles
+	for (n = 0, m = 0; n + 4 <= numTriangles; n += 4, m += 12)
+	{
+		anyUnused = kQ3False;
+		if (usageFlags != NULL)
+			anyUnused = (TQ3Boolean) ((usageFlags[n + 0] | usageFlags[n + 1] |
+									   usageFlags[n + 2] | usageFlags[n + 3]) != 0);
+
+		if (anyUnused)
+		{
+			for (k = n; k < n + 4; ++k)
+			{
+				if (!usageFlags[k])
+				{
+					Q3FastPoint3D_CrossProductTri(&thePoints[theIndices[k * 3 + 0]],
+											  &thePoints[theIndices[k * 3 + 1]],
+											  &thePoints[theIndices[k * 3 + 2]],
+											  &theNormals[k]);
+					Q3FastVector3D_Normalize(&theNormals[k], &theNormals[k]);
+				}
+			}
+			continue;
+		}
+
+		for (k = 0; k < 4; ++k)
+		{
+			p1[k] = &thePoints[theIndices[m + k * 3 + 0]];
+			p2[k] = &thePoints[theIndices[m + k * 3 + 1]];
+			p3[k] = &thePoints[theIndices[m + k * 3 + 2]];
+		}
+
+		v1x = _mm_sub_ps( _mm_setr_ps( p2[0]->x, p2[1]->x, p2[2]->x, p2[3]->x ),
+						  _mm_setr_ps( p1[0]->x, p1[1]->x, p1[2]->x, p1[3]->x ) );
+		v1y = _mm_sub_ps( _mm_setr_ps( p2[0]->y, p2[1]->y, p2[2]->y, p2[3]->y ),
+						  _mm_setr_ps( p1[0]->y, p1[1]->y, p1[2]->y, p1[3]->y ) );
+		v1z = _mm_sub_ps( _mm_setr_ps( p2[0]->z, p2[1]->z, p2[2]->z, p2[3]->z ),
+						  _mm_setr_ps( p1[0]->z, p1[1]->z, p1[2]->z, p1[3]->z ) );
+		v2x = _mm_sub_ps( _mm_setr_ps( p3[0]->x, p3[1]->x, p3[2]->x, p3[3]->x ),
+						  _mm_setr_ps( p2[0]->x, p2[1]->x, p2[2]->x, p2[3]->x ) );
+		v2y = _mm_sub_ps( _mm_setr_ps( p3[0]->y, p3[1]->y, p3[2]->y, p3[3]->y ),
+						  _mm_setr_ps( p2[0]->y, p2[1]->y, p2[2]->y, p2[3]->y ) );
+		v2z = _mm_sub_ps( _mm_setr_ps( p3[0]->z, p3[1]->z, p3[2]->z, p3[3]->z ),
+						  _mm_setr_ps( p2[0]->z, p2[1]->z, p2[2]->z, p2[3]->z ) );
+
+		nx = _mm_sub_ps( _mm_mul_ps( v1y, v2z ), _mm_mul_ps( v1z, v2y ) );
+		ny = _mm_sub_ps( _mm_mul_ps( v1z, v2x ), _mm_mul_ps( v1x, v2z ) );
+		nz = _mm_sub_ps( _mm_mul_ps( v1x, v2y ), _mm_mul_ps( v1y, v2x ) );
+
+		invLength = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, nx ), _mm_mul_ps( ny, ny ) ),
+											_mm_mul_ps( nz, nz ) );
+		invLength = _mm_add_ps( _mm_sqrt_ps( invLength ), _mm_set1_ps( kQ3MinFloat ) );
+		invLength = _mm_div_ps( _mm_set1_ps( 1.0f ), invLength );
+
+		e3sse2_store_xyz( &theNormals[n], sizeof(TQ3Vector3D),
+						  _mm_mul_ps( nx, invLength ),
+						  _mm_mul_ps( ny, invLength ),
+						  _mm_mul_ps( nz, invLength ) );
+	}
+	
+	return(n);
+}
+
+
+
+
+
+//=============================================================================
+//      e3vector3d_transform_array_sse2 : SSE2 blocks of
+//										  E3Vector3D_To3DTransformArray.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the number of vectors processed, and advances the
+//				pointers past them.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3vector3d_transform_array_sse2(const TQ3Vector3D		*&ioVectors3D,
+								const TQ3Matrix4x4		*matrix4x4,
+								TQ3Vector3D				*&ioResults,
+								TQ3Uns32				numVectors,
+								TQ3Uns32				inStructSize,
+								TQ3Uns32				outStructSize)
+{	__m128		x, y, z;
+	TQ3Uns32	i;
+
+
+
+	// Broadcast the matrix
+	#define M(x,y) _mm_set1_ps( matrix4x4->value[x][y] )
+	const __m128 m00 = M(0,0), m01 = M(0,1), m02 = M(0,2);
+	const __m128 m10 = M(1,0), m11 = M(1,1), m12 = M(1,2);
+	const __m128 m20 = M(2,0), m21 = M(2,1), m22 = M(2,2);
+	#undef M
+
+
+
+	// Transform each block of four vectors
+	for (i = 0; i + 4 <= numVectors; i += 4)
+	{
+		e3sse2_load_xyz( ioVectors3D, inStructSize, x, y, z );
+
+		e3sse2_store_xyz( ioResults, outStructSize,
+			_mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m00 ), _mm_mul_ps( y, m10 ) ), _mm_mul_ps( z, m20 ) ),
+			_mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m01 ), _mm_mul_ps( y, m11 ) ), _mm_mul_ps( z, m21 ) ),
+			_mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m02 ), _mm_mul_ps( y, m12 ) ), _mm_mul_ps( z, m22 ) ) );
+
+		AdvanceConstPointer( ioVectors3D, 4 * inStructSize );
+		AdvancePointer( ioResults, 4 * outStructSize );
+	}
+	
+	return(i);
+}
+
+
+
+
+
+//=============================================================================
+//      e3point3d_transform_array_sse2 : SSE2 blocks of
+//										 E3Point3D_To3DTransformArray.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the number of points processed, and advances the
+//				pointers past them.
+//
+//				A block containing a point at infinity is handed to
+//				E3Point3D_Transform so that the error is posted as before.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3point3d_transform_array_sse2(const TQ3Point3D		*&ioPoints3D,
+							   const TQ3Matrix4x4	*matrix4x4,
+							   TQ3Point3D			*&ioResults,
+							   TQ3Uns32				numPoints,
+							   TQ3Uns32				inStructSize,
+							   TQ3Uns32				outStructSize,
+							   TQ3Boolean			isAffine)
+{	__m128		x, y, z, rx, ry, rz, rw;
+	TQ3Uns32	i, k;
+
+
+
+	// Broadcast the matrix
+	#define M(x,y) _mm_set1_ps( matrix4x4->value[x][y] )
+	const __m128 m00 = M(0,0), m01 = M(0,1), m02 = M(0,2), m03 = M(0,3);
+	const __m128 m10 = M(1,0), m11 = M(1,1), m12 = M(1,2), m13 = M(1,3);
+	const __m128 m20 = M(2,0), m21 = M(2,1), m22 = M(2,2), m23 = M(2,3);
+	const __m128 m30 = M(3,0), m31 = M(3,1), m32 = M(3,2), m33 = M(3,3);
+	#undef M
+
+
+
+	// Transform each block of four points
+	for (i = 0; i + 4 <= numPoints; i += 4)
+	{
+		e3sse2_load_xyz( ioPoints3D, inStructSize, x, y, z );
+
+		rx = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m00 ), _mm_mul_ps( y, m10 ) ), _mm_mul_ps( z, m20 ) ), m30 );
+		ry = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m01 ), _mm_mul_ps( y, m11 ) ), _mm_mul_ps( z, m21 ) ), m31 );
+		rz = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m02 ), _mm_mul_ps( y, m12 ) ), _mm_mul_ps( z, m22 ) ), m32 );
+
+		if (!isAffine)
+		{
+			rw = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m03 ), _mm_mul_ps( y, m13 ) ), _mm_mul_ps( z, m23 ) ), m33 );
+
+			if (_mm_movemask_ps( _mm_cmpeq_ps( rw, _mm_setzero_ps() ) ) != 0)
+			{
+				for (k = 0; k < 4; ++k)
+				{
+					E3Point3D_Transform( ioPoints3D, matrix4x4, ioResults );
+
+					AdvanceConstPointer( ioPoints3D, inStructSize );
+					AdvancePointer( ioResults, outStructSize );
+				}
+				continue;
+			}
+
+
+			// Scaling by 1/w is exact when w is 1, so no lanes need skipping
+			rw = _mm_div_ps( _mm_set1_ps( 1.0f ), rw );
+			rx = _mm_mul_ps( rx, rw );
+			ry = _mm_mul_ps( ry, rw );
+			rz = _mm_mul_ps( rz, rw );
+		}
+
+		e3sse2_store_xyz( ioResults, outStructSize, rx, ry, rz );
+
+		AdvanceConstPointer( ioPoints3D, 4 * inStructSize );
+		AdvancePointer( ioResults, 4 * outStructSize );
+	}
+	
+	return(i);
+}
+
+#endif // QUESA_USE_SSE2
+
+
+
+
+
+
+
 //=============================================================================
 //		e3matrix3x3_determinant : Returns the determinant of the given 3x3 matrix.
 //-----------------------------------------------------------------------------
@@ -1090,12 +1471,25 @@ E3Vector3D_DotArray(
 	TQ3Uns32 outDotLessThanZeroStructSize)
 {
 	float dotProduct;
-	TQ3Uns32 i;
+	TQ3Uns32 i = 0;
+
+#if QUESA_USE_SSE2
+	// Gathering strided vectors costs more than the SIMD dot saves, so
+	// only packed arrays take the SSE2 path.
+	if ((outDotProducts != NULL || outDotLessThanZeros != NULL) &&
+		inStructSize == sizeof(TQ3Vector3D) &&
+		(outDotProducts == NULL || outDotProductStructSize == sizeof(float)))
+		i = e3vector3d_dot_array_sse2( inFirstVectors3D, inSecondVectors3D,
+									   outDotProducts, outDotLessThanZeros,
+									   numVectors, inStructSize,
+									   outDotProductStructSize,
+									   outDotLessThanZeroStructSize );
+#endif
 
 	// Calculate the dot products
 	if (outDotProducts != NULL && outDotLessThanZeros != NULL)
 	{
-		for (i = 0; i < numVectors; ++i)
+		for (; i < numVectors; ++i)
 		{
 			dotProduct           = Q3FastVector3D_Dot(inFirstVectors3D, inSecondVectors3D);
 			*outDotProducts      = dotProduct;	
@@ -1110,7 +1504,7 @@ E3Vector3D_DotArray(
 
 	else if (outDotProducts != NULL)
 	{
-		for (i = 0; i < numVectors; ++i)
+		for (; i < numVectors; ++i)
 		{
 			dotProduct           = Q3FastVector3D_Dot(inFirstVectors3D, inSecondVectors3D);
 			*outDotProducts      = dotProduct;	
@@ -1123,7 +1517,7 @@ E3Vector3D_DotArray(
 
 	else
 	{
-		for (i = 0; i < numVectors; ++i)
+		for (; i < numVectors; ++i)
 		{
 			dotProduct           = Q3FastVector3D_Dot(inFirstVectors3D, inSecondVectors3D);
 			*outDotLessThanZeros = (TQ3Boolean) (dotProduct < 0.0f);
@@ -1212,14 +1606,20 @@ E3Triangle_CrossProductArray(TQ3Uns32			numTriangles,
 							const TQ3Uns32		*theIndices,
 							const TQ3Point3D	*thePoints,
 							TQ3Vector3D			*theNormals)
-{	TQ3Uns32	n, m;
+{	TQ3Uns32	n = 0, m;
+
+
+
+#if QUESA_USE_SSE2
+	n = e3triangle_crossproduct_array_sse2(numTriangles, usageFlags, theIndices, thePoints, theNormals);
+#endif
 
 
 
 	// Calculate the normals
 	if (usageFlags == NULL)
 		{
-		for (n = 0, m = 0; n < numTriangles; n++, m += 3)
+		for (m = n * 3; n < numTriangles; n++, m += 3)
 			{
 			Q3FastPoint3D_CrossProductTri(&thePoints[theIndices[m + 0]],
 									  &thePoints[theIndices[m + 1]],
@@ -1230,7 +1630,7 @@ E3Triangle_CrossProductArray(TQ3Uns32			numTriangles,
 		}
 	else
 		{
-		for (n = 0, m = 0; n < numTriangles; n++, m += 3)
+		for (m = n * 3; n < numTriangles; n++, m += 3)
 			{
 			if (!usageFlags[n])
 				{
@@ -2338,9 +2738,17 @@ E3Vector3D_To3DTransformArray(const TQ3Vector3D		*inVectors3D,
 							  TQ3Uns32				inStructSize,
 							  TQ3Uns32				outStructSize)
 {
-	TQ3Uns32 i;
+	TQ3Uns32 i = 0;
 	
-	for (i = 0; i < numVectors; ++i)
+#if QUESA_USE_SSE2
+	// As with E3Vector3D_DotArray, strided vectors are faster through
+	// the scalar loop.
+	if (inStructSize == sizeof(TQ3Vector3D) && outStructSize == sizeof(TQ3Vector3D))
+		i = e3vector3d_transform_array_sse2( inVectors3D, matrix4x4, outVectors3D,
+											 numVectors, inStructSize, outStructSize );
+#endif
+
+	for (; i < numVectors; ++i)
 	{
 		E3Vector3D_Transform(inVectors3D, matrix4x4, outVectors3D);
 
@@ -2462,16 +2870,23 @@ E3Point3D_To3DTransformArray(const TQ3Point3D		*inPoints3D,
 							 TQ3Uns32				inStructSize,
 							 TQ3Uns32				outStructSize)
 {
-	TQ3Uns32 i;
+	TQ3Uns32 i = 0;
 	
 	// In the common case of the last column of the matrix being (0, 0, 0, 1),
 	// we can avoid some divisions and conditionals inside the loop.
-	if ( (matrix4x4->value[3][3] == 1.0f) &&
+	TQ3Boolean isAffine = (TQ3Boolean) ( (matrix4x4->value[3][3] == 1.0f) &&
 		(matrix4x4->value[0][3] == 0.0f) &&
 		(matrix4x4->value[1][3] == 0.0f) &&
-		(matrix4x4->value[2][3] == 0.0f) )
+		(matrix4x4->value[2][3] == 0.0f) );
+
+#if QUESA_USE_SSE2
+	i = e3point3d_transform_array_sse2( inPoints3D, matrix4x4, outPoints3D,
+										numPoints, inStructSize, outStructSize, isAffine );
+#endif
+
+	if (isAffine)
 	{
-		for (i = 0; i < numPoints; ++i)
+		for (; i < numPoints; ++i)
 		{
 			E3Point3D_TransformAffine( inPoints3D, matrix4x4, outPoints3D );
 
@@ -2482,7 +2897,7 @@ E3Point3D_To3DTransformArray(const TQ3Point3D		*inPoints3D,
 	else
 	{
 		// Transform the points - will be in-lined in release builds
-		for (i = 0; i < numPoints; ++i)
+		for (; i < numPoints; ++i)
 		{
 			E3Point3D_Transform(inPoints3D, matrix4x4, outPoints3D);
 
@@ -3605,6 +4020,189 @@ E3Matrix4x4_Multiply(const TQ3Matrix4x4 *m1, const TQ3Matrix4x4 *m2, TQ3Matrix4x
 
 
 
+//=============================================================================
+//      E3Matrix4x4_GetKind : Classify a 4x4 matrix.
+//-----------------------------------------------------------------------------
+//		Note :	Rigid matrices are not detected, since that would need a
+//				tolerance; callers which know their matrix is a rotation
+//				should tag it as kQ3MatrixKindRigid themselves.
+//-----------------------------------------------------------------------------
+TQ3MatrixKind
+E3Matrix4x4_GetKind(const TQ3Matrix4x4 *matrix4x4)
+{
+	#define M(x,y)	matrix4x4->value[x][y]
+
+	if (M(0,3) != 0.0f || M(1,3) != 0.0f || M(2,3) != 0.0f || M(3,3) != 1.0f)
+		return(kQ3MatrixKindGeneral);
+
+	if (M(0,0) == 1.0f && M(0,1) == 0.0f && M(0,2) == 0.0f &&
+		M(1,0) == 0.0f && M(1,1) == 1.0f && M(1,2) == 0.0f &&
+		M(2,0) == 0.0f && M(2,1) == 0.0f && M(2,2) == 1.0f)
+		return(kQ3MatrixKindTranslation);
+
+	#undef M
+
+	return(kQ3MatrixKindAffine);
+}
+
+
+
+
+
+//=============================================================================
+//      E3Matrix4x4_MultiplyKind : Multiply two 4x4 matrices of known kinds.
+//-----------------------------------------------------------------------------
+//		Note :	Produces the same result as E3Matrix4x4_Multiply, skipping
+//				the terms which the kinds tell us are 0 or 1.
+//
+//				'result' may be the same as 'm1' and/or 'm2'.
+//-----------------------------------------------------------------------------
+TQ3Matrix4x4 *
+E3Matrix4x4_MultiplyKind(const TQ3Matrix4x4 *m1, TQ3MatrixKind kind1,
+						 const TQ3Matrix4x4 *m2, TQ3MatrixKind kind2,
+						 TQ3Matrix4x4 *result)
+{
+	// Fall back to the general multiply if m1 is projective
+	if (kind1 == kQ3MatrixKindGeneral)
+		return(E3Matrix4x4_Multiply(m1, m2, result));
+
+
+
+	// If result is alias of input, output to temporary
+	TQ3Matrix4x4 temp;
+	TQ3Matrix4x4* output = (result == m1 || result == m2 ? &temp : result);
+	int i, j;
+	
+	#define A(x,y)	m1->value[x][y]
+	#define B(x,y)	m2->value[x][y]
+	#define M(x,y)	output->value[x][y]
+
+	if (kind1 == kQ3MatrixKindTranslation)
+	{
+		// The upper rows of m1 are the identity, so select the rows of m2
+		for (i = 0; i < 3; ++i)
+			for (j = 0; j < 4; ++j)
+				M(i,j) = B(i,j);
+
+		for (j = 0; j < 4; ++j)
+			M(3,j) = A(3,0)*B(0,j) + A(3,1)*B(1,j) + A(3,2)*B(2,j) + B(3,j);
+	}
+
+	else if (kind2 == kQ3MatrixKindTranslation)
+	{
+		// m2 only adds its translation to the last row of m1
+		for (i = 0; i < 3; ++i)
+		{
+			for (j = 0; j < 3; ++j)
+				M(i,j) = A(i,j);
+			M(i,3) = 0.0f;
+		}
+
+		for (j = 0; j < 3; ++j)
+			M(3,j) = A(3,j) + B(3,j);
+		M(3,3) = 1.0f;
+	}
+
+	else
+	{
+		// The last column of m1 is (0, 0, 0, 1), and so is that of the
+		// result if m2 is affine as well
+		int numColumns = (kind2 == kQ3MatrixKindGeneral ? 4 : 3);
+		
+		for (i = 0; i < 3; ++i)
+			for (j = 0; j < numColumns; ++j)
+				M(i,j) = A(i,0)*B(0,j) + A(i,1)*B(1,j) + A(i,2)*B(2,j);
+
+		for (j = 0; j < numColumns; ++j)
+			M(3,j) = A(3,0)*B(0,j) + A(3,1)*B(1,j) + A(3,2)*B(2,j) + B(3,j);
+
+		if (numColumns == 3)
+		{
+			M(0,3) = 0.0f;
+			M(1,3) = 0.0f;
+			M(2,3) = 0.0f;
+			M(3,3) = 1.0f;
+		}
+	}
+	
+	#undef A
+	#undef B
+	#undef M
+
+	if (output == &temp)
+		*result = temp;
+
+	return(result);
+}
+
+
+
+
+
+//=============================================================================
+//      E3Matrix4x4_InvertKind : Invert a 4x4 matrix of known kind.
+//-----------------------------------------------------------------------------
+//		Note :	A translation is inverted by negating it, and a rigid matrix
+//				by transposing its rotation. Other kinds use E3Matrix4x4_Invert.
+//
+//				'result' may be the same 'matrix4x4'.
+//-----------------------------------------------------------------------------
+TQ3Matrix4x4 *
+E3Matrix4x4_InvertKind(const TQ3Matrix4x4 *matrix4x4, TQ3MatrixKind theKind, TQ3Matrix4x4 *result)
+{
+	TQ3Matrix4x4	temp;
+	int				i, j;
+
+
+
+	switch (theKind)
+	{
+		case kQ3MatrixKindTranslation:
+			if (result != matrix4x4)
+				*result = *matrix4x4;
+			
+			result->value[3][0] = -result->value[3][0];
+			result->value[3][1] = -result->value[3][1];
+			result->value[3][2] = -result->value[3][2];
+			break;
+		
+		case kQ3MatrixKindRigid:
+			// The inverse of the matrix
+			//		R 0
+			//		v 1
+			// (where R is a 3x3 rotation) is
+			//		transpose(R)		0
+			//		-v * transpose(R)	1	.
+			temp = *matrix4x4;
+			
+			for (i = 0; i < 3; ++i)
+			{
+				for (j = 0; j < 3; ++j)
+					result->value[i][j] = temp.value[j][i];
+				
+				result->value[i][3] = 0.0f;
+			}
+			
+			for (j = 0; j < 3; ++j)
+				result->value[3][j] = -(temp.value[3][0] * temp.value[j][0] +
+										temp.value[3][1] * temp.value[j][1] +
+										temp.value[3][2] * temp.value[j][2]);
+			
+			result->value[3][3] = 1.0f;
+			break;
+		
+		default:
+			E3Matrix4x4_Invert(matrix4x4, result);
+			break;
+	}
+	
+	return(result);
+}
+
+
+
+
+
 //=============================================================================
 //      E3Quaternion_Set : Set quaternion.
 //-----------------------------------------------------------------------------
@@ -4878,3 +5476,60 @@ E3Math_InvSquareRoot(float x)
 	return(1.0f / (float) sqrt(x));
 }
 
+
+
+
+
+//=============================================================================
+//      E3Math_SolveQuadratic : Find the real roots of a quadratic.
+//-----------------------------------------------------------------------------
+//		Note :	Solves a*x^2 + b*x + c = 0, returning the number of real roots
+//				in ascending order. A double root is returned once, and if a is
+//				zero we solve the linear equation instead.
+//
+//				We avoid the cancellation in the familiar quadratic formula by
+//				finding the larger root first, and the other from the product
+//				of the roots.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+E3Math_SolveQuadratic(float a, float b, float c, float *roots)
+{	double		theDiscriminant, q;
+
+
+
+	// Handle the linear case
+	if (a == 0.0f)
+		{
+		if (b == 0.0f)
+			return(0);
+
+		roots[0] = -c / b;
+		return(1);
+		}
+
+
+
+	// Check for real roots
+	theDiscriminant = (double) b * (double) b - 4.0 * (double) a * (double) c;
+	if (theDiscriminant < 0.0)
+		return(0);
+
+	if (theDiscriminant == 0.0)
+		{
+		roots[0] = -b / (2.0f * a);
+		return(1);
+		}
+
+
+
+	// Find the roots
+	q = -0.5 * ((double) b + (b < 0.0f ? -sqrt(theDiscriminant) : sqrt(theDiscriminant)));
+
+	roots[0] = (float) (q / a);
+	roots[1] = (float) (c / q);
+	if (roots[0] > roots[1])
+		E3Float_Swap(roots[0], roots[1]);
+
+	return(2);
+}
+
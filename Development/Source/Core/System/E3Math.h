@@ -62,6 +62,22 @@ extern "C" {
 
 
 
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+// Matrix kinds, ordered from the most specialised to the most general. The
+// kind of a product is the more general of the kinds of its factors.
+typedef enum TQ3MatrixKind {
+	kQ3MatrixKindTranslation				= 0,		// Identity 3x3, last column (0, 0, 0, 1)
+	kQ3MatrixKindRigid						= 1,		// Rotation 3x3, last column (0, 0, 0, 1)
+	kQ3MatrixKindAffine						= 2,		// Any 3x3, last column (0, 0, 0, 1)
+	kQ3MatrixKindGeneral					= 3			// Projective
+} TQ3MatrixKind;
+
+
+
+
+
 //=============================================================================
 //      Function prototypes
 //-----------------------------------------------------------------------------
@@ -316,6 +332,9 @@ TQ3Matrix3x3 *			E3Matrix3x3_Invert(const TQ3Matrix3x3 *matrix3x3, TQ3Matrix3x3
 TQ3Matrix4x4 *			E3Matrix4x4_Invert(const TQ3Matrix4x4 *matrix4x4, TQ3Matrix4x4 *result);
 TQ3Matrix3x3 *			E3Matrix3x3_Multiply(const TQ3Matrix3x3 *m1, const TQ3Matrix3x3 *m2, TQ3Matrix3x3 *result);
 TQ3Matrix4x4 *			E3Matrix4x4_Multiply(const TQ3Matrix4x4 *m1, const TQ3Matrix4x4 *m2, TQ3Matrix4x4 *result);
+TQ3MatrixKind			E3Matrix4x4_GetKind(const TQ3Matrix4x4 *matrix4x4);
+TQ3Matrix4x4 *			E3Matrix4x4_MultiplyKind(const TQ3Matrix4x4 *m1, TQ3MatrixKind kind1, const TQ3Matrix4x4 *m2, TQ3MatrixKind kind2, TQ3Matrix4x4 *result);
+TQ3Matrix4x4 *			E3Matrix4x4_InvertKind(const TQ3Matrix4x4 *matrix4x4, TQ3MatrixKind theKind, TQ3Matrix4x4 *result);
 
 
 
@@ -390,6 +409,7 @@ TQ3BoundingSphere *		E3BoundingSphere_UnionRationalPoint4D(const TQ3BoundingSphe
 //-----------------------------------------------------------------------------
 float					E3Math_SquareRoot(float x);
 float					E3Math_InvSquareRoot(float x);
+TQ3Uns32				E3Math_SolveQuadratic(float a, float b, float c, float *roots);
 
 
 
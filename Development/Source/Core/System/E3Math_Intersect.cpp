@@ -60,6 +60,10 @@
 #include <algorithm>
 #include <cmath>
 
+#if QUESA_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
 
 
 
@@ -1823,6 +1827,117 @@ bool	E3BoundingBox_IntersectViewFrustum(
 }
 
 
+/*!
+	@function	E3BoundingBox_IntersectViewFrustumArray
+	@abstract	Determine which of an array of bounding boxes in local
+				coordinates intersect the view frustum.
+	@discussion	The result for each box is the same as that of
+				E3BoundingBox_IntersectViewFrustum.
+				
+				Phase 1 of that test, against the frustum planes, is done for
+				four boxes at a time.  Only boxes that it cannot decide, which
+				straddle a plane without being wholly outside any, are passed
+				on to the full test.
+	@param		inView			The view object.
+	@param		inNumBoxes		Number of boxes.
+	@param		inLocalBoxes	Bounding boxes in local coordinates.
+	@param		outVisibleMask	Receives a bit for each box, set if the box
+								intersects the frustum.  Box i is bit (i % 32)
+								of word (i / 32), so (inNumBoxes + 31) / 32
+								words are written.
+*/
+void	E3BoundingBox_IntersectViewFrustumArray(
+									TQ3ViewObject inView,
+									TQ3Uns32 inNumBoxes,
+									const TQ3BoundingBox* inLocalBoxes,
+									TQ3Uns32* outVisibleMask )
+{
+	TQ3Uns32	i = 0;
+	
+	std::fill( outVisibleMask, outVisibleMask + (inNumBoxes + 31) / 32, 0U );
+	
+#if QUESA_USE_SSE2
+	const TQ3RationalPoint4D*	localFrustumPlanes =
+		E3View_State_GetFrustumPlanesInLocalSpace( inView );
+	
+	// Phase 1 for blocks of four boxes.  Each lane repeats the arithmetic of
+	// TestBoundingBoxAgainstHalfPlane, so the decisions are the same.
+	for (; i + 4 <= inNumBoxes; i += 4)
+	{
+		const TQ3BoundingBox*	b = &inLocalBoxes[i];
+		__m128	minX = _mm_setr_ps( b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x );
+		__m128	minY = _mm_setr_ps( b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y );
+		__m128	minZ = _mm_setr_ps( b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z );
+		__m128	diffX = _mm_sub_ps( _mm_setr_ps( b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x ), minX );
+		__m128	diffY = _mm_sub_ps( _mm_setr_ps( b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y ), minY );
+		__m128	diffZ = _mm_sub_ps( _mm_setr_ps( b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z ), minZ );
+		__m128	zero = _mm_setzero_ps();
+		__m128	isAllInside = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+		__m128	isOutside = zero;
+		
+		for (int planeIndex = 0; planeIndex < 6; ++planeIndex)
+		{
+			const TQ3RationalPoint4D&	thePlane( localFrustumPlanes[ planeIndex ] );
+			__m128	baseValue = _mm_add_ps( _mm_add_ps( _mm_add_ps(
+									_mm_mul_ps( minX, _mm_set1_ps( thePlane.x ) ),
+									_mm_mul_ps( minY, _mm_set1_ps( thePlane.y ) ) ),
+									_mm_mul_ps( minZ, _mm_set1_ps( thePlane.z ) ) ),
+									_mm_set1_ps( thePlane.w ) );
+			__m128	minValue = baseValue;
+			__m128	maxValue = baseValue;
+			
+			if (thePlane.x > 0.0f)
+				maxValue = _mm_add_ps( maxValue, _mm_mul_ps( _mm_set1_ps( thePlane.x ), diffX ) );
+			else
+				minValue = _mm_add_ps( minValue, _mm_mul_ps( _mm_set1_ps( thePlane.x ), diffX ) );
+			
+			if (thePlane.y > 0.0f)
+				maxValue = _mm_add_ps( maxValue, _mm_mul_ps( _mm_set1_ps( thePlane.y ), diffY ) );
+			else
+				minValue = _mm_add_ps( minValue, _mm_mul_ps( _mm_set1_ps( thePlane.y ), diffY ) );
+			
+			if (thePlane.z > 0.0f)
+				maxValue = _mm_add_ps( maxValue, _mm_mul_ps( _mm_set1_ps( thePlane.z ), diffZ ) );
+			else
+				minValue = _mm_add_ps( minValue, _mm_mul_ps( _mm_set1_ps( thePlane.z ), diffZ ) );
+			
+			__m128	isPlaneInside = _mm_cmple_ps( maxValue, zero );
+			isAllInside = _mm_and_ps( isAllInside, isPlaneInside );
+			isOutside = _mm_or_ps( isOutside,
+				_mm_andnot_ps( isPlaneInside, _mm_cmpgt_ps( minValue, zero ) ) );
+		}
+		
+		TQ3Uns32	insideBits = (TQ3Uns32) _mm_movemask_ps( isAllInside );
+		TQ3Uns32	outsideBits = (TQ3Uns32) _mm_movemask_ps( isOutside );
+		
+		for (TQ3Uns32 k = 0; k < 4; ++k)
+		{
+			TQ3Uns32	j = i + k;
+			if (b[k].isEmpty || (outsideBits & (1U << k)))
+			{
+				continue;
+			}
+			
+			if ( (insideBits & (1U << k)) ||
+				E3BoundingBox_IntersectViewFrustum( inView, b[k] ) )
+			{
+				outVisibleMask[ j / 32 ] |= 1U << (j % 32);
+			}
+		}
+	}
+#endif
+	
+	// Remaining boxes, or all of them if we have no vector unit
+	for (; i < inNumBoxes; ++i)
+	{
+		if (E3BoundingBox_IntersectViewFrustum( inView, inLocalBoxes[i] ))
+		{
+			outVisibleMask[ i / 32 ] |= 1U << (i % 32);
+		}
+	}
+}
+
+
 /*!
 	@function	E3BoundingBox_IntersectCameraFrustum
 	@abstract	Determine whether a bounding box in world coordinates
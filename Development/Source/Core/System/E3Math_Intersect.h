@@ -139,6 +139,26 @@ bool	E3BoundingBox_IntersectViewFrustum(
 									const TQ3BoundingBox& inLocalBox );
 
 
+/*!
+	@function	E3BoundingBox_IntersectViewFrustumArray
+	@abstract	Determine which of an array of bounding boxes in local
+				coordinates intersect the view frustum.
+	@discussion	Gives the same result for each box as
+				E3BoundingBox_IntersectViewFrustum.
+	@param		inView			The view object.
+	@param		inNumBoxes		Number of boxes.
+	@param		inLocalBoxes	Bounding boxes in local coordinates.
+	@param		outVisibleMask	Receives a bit for each box, set if the box
+								intersects the frustum.  Box i is bit (i % 32)
+								of word (i / 32).
+*/
+void	E3BoundingBox_IntersectViewFrustumArray(
+									TQ3ViewObject inView,
+									TQ3Uns32 inNumBoxes,
+									const TQ3BoundingBox* inLocalBoxes,
+									TQ3Uns32* outVisibleMask );
+
+
 /*!
 	@function	E3BoundingBox_IntersectCameraFrustum
 	@abstract	Determine whether a bounding box in world coordinates
@@ -46,6 +46,7 @@
 #include "E3Prefix.h"
 #include "E3Memory.h"
 #include "E3StackCrawl.h"
+#include "E3InstancePool.h"
 #include "E3String.h"
 
 #include <stdlib.h>
@@ -131,6 +132,7 @@ static TQ3Int32		sActiveAllocCount = 0;
 static TQ3Int32		sMaxAllocCount    = 0;
 static TQ3Int64		sActiveAllocBytes = { 0, 0 };
 static TQ3Int64		sMaxAllocBytes	  = { 0, 0 };
+static E3SpinLock	sStatisticsLock   = 0;	// Guards the statistics above
 
 
 
@@ -390,6 +392,7 @@ E3Memory_Allocate(TQ3Uns32 theSize)
 	if (thePtr != NULL)
 	{
 		// Update statistics
+		E3SpinLocker theLocker( sStatisticsLock );
 		sActiveAllocCount += 1;
 		sMaxAllocCount = E3Num_Max( sMaxAllocCount, sActiveAllocCount );
 		Q3Int64_Uns32_Add( sActiveAllocBytes, e3memGetSize( thePtr ), sActiveAllocBytes );
@@ -439,6 +442,7 @@ E3Memory_AllocateClear(TQ3Uns32 theSize)
 	if (thePtr != NULL)
 		{
 		// Update statistics
+		E3SpinLocker theLocker( sStatisticsLock );
 		sActiveAllocCount += 1;
 		sMaxAllocCount = E3Num_Max( sMaxAllocCount, sActiveAllocCount );
 		Q3Int64_Uns32_Add( sActiveAllocBytes, e3memGetSize( thePtr ), sActiveAllocBytes );
@@ -488,8 +492,11 @@ E3Memory_Free(void **thePtr)
 
 #if Q3_MEMORY_DEBUG
 		// Update statistics
+		{
+		E3SpinLocker theLocker( sStatisticsLock );
 		sActiveAllocCount -= 1;
 		Q3Int64_Uns32_Subtract( sActiveAllocBytes, e3memGetSize( realPtr ), sActiveAllocBytes );
+		}
 #endif
 
 		// Free the pointer
@@ -558,6 +565,7 @@ E3Memory_Reallocate(void **thePtr, TQ3Uns32 newSize)
 		#if Q3_MEMORY_DEBUG
 			// Update statistics
 			TQ3Uns32 actualNewSize = e3memGetSize( newPtr );
+			E3SpinLocker theLocker( sStatisticsLock );
 			if (actualNewSize > oldSize)
 			{
 				Q3Int64_Uns32_Add( sActiveAllocBytes, actualNewSize - oldSize,
@@ -806,6 +814,8 @@ E3Memory_ForgetRecording(void)
 	E3GlobalsPtr	theGlobals = E3Globals_Get();
 	Q3_REQUIRE_OR_RESULT( theGlobals != NULL, kQ3Failure );
 	
+	E3SpinLocker	theLocker( theGlobals->listLock );
+	
 	if (theGlobals->listHead)	// true if anything was ever recorded
 		{
 		anObject = NEXTLINK( theGlobals->listHead );
@@ -848,6 +858,8 @@ E3Memory_CountRecords(void)
 	
 	Q3_REQUIRE_OR_RESULT( theGlobals != NULL, 0 ) ;
 	
+	E3SpinLocker theLocker ( theGlobals->listLock ) ;
+	
 	if ( theGlobals->listHead != NULL )	// true if anything was ever recorded
 		{
 		TQ3Object anObject = NEXTLINK( theGlobals->listHead ) ;
@@ -880,6 +892,8 @@ E3Memory_NextRecordedObject( TQ3Object inObject )
 	
 	Q3_REQUIRE_OR_RESULT( theGlobals != NULL, NULL ) ;
 	
+	E3SpinLocker theLocker ( theGlobals->listLock ) ;
+	
 	if ( inObject == NULL )
 		{
 		// Return the first thing in the list, if any.
@@ -923,6 +937,10 @@ E3Memory_DumpRecording( const char* fileName, const char* memo )
 	Q3_REQUIRE_OR_RESULT( Q3_VALID_PTR( fileName ), kQ3Failure );
 	Q3_REQUIRE_OR_RESULT( theGlobals != NULL, kQ3Failure );
 	
+	// The list is locked while it is written out, so objects can not be
+	// created or disposed of by other threads until the dump is complete
+	E3SpinLocker	theLocker( theGlobals->listLock );
+	
 	if (theGlobals->listHead)	// true if anything was ever recorded
 	{
 		SetDirectoryForDump( fileName );
@@ -1022,6 +1040,7 @@ TQ3Status		E3Memory_GetStatistics( TQ3MemoryStatistics* info )
 
 		if (info->structureVersion == kQ3MemoryStatisticsStructureVersion)
 		{
+			E3SpinLocker theLocker( sStatisticsLock );
 			info->currentAllocations = sActiveAllocCount;
 			info->currentBytes = sActiveAllocBytes;
 			info->maxBytes = sMaxAllocBytes;
@@ -1045,6 +1064,42 @@ TQ3Status		E3Memory_GetStatistics( TQ3MemoryStatistics* info )
 
 
 
+//=============================================================================
+//      E3Memory_GetInstancePoolStatistics : Get instance pool occupancy.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Memory_GetInstancePoolStatistics( TQ3ObjectType classType, TQ3InstancePoolStatistics* info )
+{
+	// Check the structure version
+	if (info->structureVersion != kQ3InstancePoolStatisticsStructureVersion)
+		return kQ3Failure;
+
+
+
+	// Find the class
+	E3ClassInfoPtr theClass = E3ClassTree::GetClass( classType );
+	if (theClass == NULL)
+		return kQ3Failure;
+
+
+
+	// Get the occupancy of its pool
+	TE3InstancePoolInfo	poolInfo;
+	E3InstancePool_GetInfo( theClass->GetObjectSize(), &poolInfo );
+	
+	info->numInstances  = theClass->GetNumInstances();
+	info->itemSize      = poolInfo.itemSize;
+	info->numBlocks     = poolInfo.numBlocks;
+	info->numItems      = poolInfo.numItems;
+	info->numItemsInUse = poolInfo.numItemsInUse;
+	
+	return kQ3Success;
+}
+
+
+
+
+
 //=============================================================================
 //      E3SlabMemory_New : Create a new memory slab object.
 //-----------------------------------------------------------------------------
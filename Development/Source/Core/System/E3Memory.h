@@ -95,6 +95,7 @@ TQ3Status	E3Memory_DumpRecording( const char* fileName, const char* memo );
 TQ3Boolean	E3Memory_IsValidBlock( void *thePtr );
 TQ3Status	E3Memory_GetStatistics( TQ3MemoryStatistics* info );
 #endif
+TQ3Status	E3Memory_GetInstancePoolStatistics( TQ3ObjectType classType, TQ3InstancePoolStatistics* info );
 
 TQ3SlabObject E3SlabMemory_New(TQ3Uns32 itemSize, TQ3Uns32 numItems, const void *itemData);
 void         *E3SlabMemory_GetData(   TQ3SlabObject theSlab, TQ3Uns32 itemIndex);
@@ -89,12 +89,25 @@ struct TQ3PickHit
 };
 
 
+// World rays pick state
+struct TQ3PickRaySet
+{
+	// A world ray pick for each ray, which holds the hits of that ray
+	std::vector<TQ3PickObject>			rayPicks;
+	
+	// Indices of the rays which may still hit the objects being submitted
+	std::vector<TQ3Uns32>				activeRays;
+};
+
+
 // Pick object instance data
 struct TQ3PickUnionData
 {
 	// Common data
 	std::vector<TQ3PickHit*>*			pickHits;
 	bool								isSorted;
+	float								nearestDistance;	// Nearest hit kept while only the nearest is wanted
+	TQ3PickRaySet*						raySet;				// World rays picks only
 
 
 	// Pick specific. Note that we assume that a TQ3PickData structure
@@ -105,6 +118,7 @@ struct TQ3PickUnionData
 		TQ3WindowPointPickData			windowPointData;
 		TQ3WindowRectPickData			windowRectData;
 		TQ3WorldRayPickData				worldRayData;
+		TQ3WorldRaysPickData			worldRaysData;
 	} data;
 };
 
@@ -175,6 +189,19 @@ public :
 	
 
 
+class E3WorldRaysPick : public E3Pick  // This is a leaf class so no other classes use this,
+								// so it can be here in the .c file rather than in
+								// the .h file, hence all the fields can be public
+								// as nobody should be including this file
+	{
+Q3_CLASS_ENUMS ( kQ3PickTypeWorldRays, E3WorldRaysPick, E3Pick )
+public :
+
+	TQ3PickUnionData				instanceData ;
+	} ;
+	
+
+
 class E3ShapePart : public E3Shared // This is not a leaf class, but only classes in this,
 								// file inherit from it, so it can be declared here in
 								// the .c file rather than in the .h file, hence all
@@ -312,6 +339,45 @@ e3pick_hit_duplicate_path(TQ3HitPath *pickedPath, TQ3HitPath *newPath)
 
 
 
+//=============================================================================
+//      e3pick_get_eye_point : Get the point hit distances are measured from.
+//-----------------------------------------------------------------------------
+//		Note :	World ray picks measure distances from the origin of their ray,
+//				and other picks from the location of the view's camera.
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+e3pick_get_eye_point(TQ3PickObject thePick, TQ3ViewObject theView, TQ3Point3D *eyePoint)
+{	TQ3CameraPlacement		cameraPlacement;
+	TQ3CameraObject			theCamera;
+	TQ3Ray3D				pickRay;
+
+
+
+	// Use the ray origin for a world ray pick
+	if (Q3Pick_GetType( thePick ) == kQ3PickTypeWorldRay)
+		{
+		Q3WorldRayPick_GetRay( thePick, &pickRay );
+		*eyePoint = pickRay.origin;
+		return(kQ3True);
+		}
+
+
+
+	// Otherwise use the camera location
+	if (Q3View_GetCamera(theView, &theCamera) != kQ3Success)
+		return(kQ3False);
+
+	Q3Camera_GetPlacement(theCamera, &cameraPlacement);
+	Q3Object_Dispose(theCamera);
+
+	*eyePoint = cameraPlacement.cameraLocation;
+	return(kQ3True);
+}
+
+
+
+
+
 //=============================================================================
 //      e3pick_hit_initialise : Initialise a TQ3PickHit.
 //-----------------------------------------------------------------------------
@@ -325,14 +391,12 @@ e3pick_hit_initialise(TQ3PickHit				*theHit,
 						TQ3ShapePartObject		hitShape,
 						const TQ3Param3D*		hitBarycentric,
 						TQ3Uns32				hitFaceIndex )
-{	TQ3CameraPlacement		cameraPlacement;
-	TQ3HitPath				*currentPath;
+{	TQ3HitPath				*currentPath;
 	TQ3Status				qd3dStatus;
-	TQ3CameraObject			theCamera;
 	TQ3Vector3D				eyeVector = { 0.0f, 0.0f, 0.0f };
+	TQ3Point3D				eyePoint;
 	TQ3PickData				pickData;
 	TQ3ObjectType			theType;
-	TQ3Ray3D				pickRay;
 
 
 
@@ -403,22 +467,9 @@ e3pick_hit_initialise(TQ3PickHit				*theHit,
 	// Save the distance to the viewer
 	if (E3Bit_IsSet(pickData.mask, kQ3PickDetailMaskDistance) && hitXYZ != NULL)
 		{
-		if (Q3Pick_GetType( thePick ) == kQ3PickTypeWorldRay)
-			{
-			Q3WorldRayPick_GetRay( thePick, &pickRay );
-			Q3Point3D_Subtract(hitXYZ, &pickRay.origin, &eyeVector);
-			}
-		else
-			{
-			qd3dStatus = Q3View_GetCamera(theView, &theCamera);
-			if (qd3dStatus == kQ3Success)
-				{
-				Q3Camera_GetPlacement(theCamera, &cameraPlacement);
-				Q3Point3D_Subtract(hitXYZ, &cameraPlacement.cameraLocation, &eyeVector);
-				Q3Object_Dispose(theCamera);
+		if (e3pick_get_eye_point(thePick, theView, &eyePoint))
+			Q3Point3D_Subtract(hitXYZ, &eyePoint, &eyeVector);
 
-				}
-			}
 		theHit->hitDistance = Q3Vector3D_Length(&eyeVector);
 		theHit->validMask  |= kQ3PickDetailMaskDistance;
 		}
@@ -607,6 +658,8 @@ e3pick_windowpoint_new(TQ3Object theObject, void *privateData, const void *param
 
 	// Initialise our instance data
 	instanceData->pickHits = new std::vector<TQ3PickHit*>;
+	instanceData->nearestDistance = kQ3MaxFloat;
+	instanceData->raySet = NULL;
 	instanceData->data.windowPointData = *pickData;
 
 	e3pick_set_sort_mask(&instanceData->data.windowPointData.data);
@@ -677,6 +730,8 @@ e3pick_windowrect_new(TQ3Object theObject, void *privateData, const void *paramD
 
 	// Initialise our instance data
 	instanceData->pickHits = new std::vector<TQ3PickHit*>;
+	instanceData->nearestDistance = kQ3MaxFloat;
+	instanceData->raySet = NULL;
 	instanceData->data.windowRectData = *pickData;
 
 	return(kQ3Success);
@@ -745,6 +800,8 @@ e3pick_worldray_new(TQ3Object theObject, void *privateData, const void *paramDat
 
 	// Initialise our instance data
 	instanceData->pickHits = new std::vector<TQ3PickHit*>;
+	instanceData->nearestDistance = kQ3MaxFloat;
+	instanceData->raySet = NULL;
 	instanceData->data.worldRayData = *pickData;
 
 	e3pick_set_sort_mask(&instanceData->data.windowPointData.data);
@@ -803,6 +860,131 @@ e3pick_worldray_metahandler(TQ3XMethodType methodType)
 
 
 
+//=============================================================================
+//      e3pick_worldrays_new : World rays pick new method.
+//-----------------------------------------------------------------------------
+//		Note :	Each ray is given a world ray pick of its own, which collects
+//				the hits of that ray. The rays themselves are only held by
+//				those picks, so our copy of the data does not refer to them.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3pick_worldrays_new(TQ3Object theObject, void *privateData, const void *paramData)
+{	TQ3PickUnionData			*instanceData = (TQ3PickUnionData *) privateData;
+	const TQ3WorldRaysPickData	*pickData     = (const TQ3WorldRaysPickData *) paramData;
+	TQ3WorldRayPickData			rayData;
+	TQ3PickObject				rayPick;
+	TQ3Uns32					n;
+
+
+
+	// Initialise our instance data
+	instanceData->nearestDistance = kQ3MaxFloat;
+	instanceData->data.worldRaysData = *pickData;
+	instanceData->data.worldRaysData.rays = NULL;
+
+	e3pick_set_sort_mask(&instanceData->data.worldRaysData.data);
+
+	try
+		{
+		instanceData->pickHits = new std::vector<TQ3PickHit*>;
+		instanceData->raySet   = new TQ3PickRaySet;
+		instanceData->raySet->rayPicks.reserve(pickData->numRays);
+		instanceData->raySet->activeRays.resize(pickData->numRays);
+		}
+	catch (...)
+		{
+		delete instanceData->pickHits;
+		instanceData->pickHits = NULL;
+		E3ErrorManager_PostError(kQ3ErrorOutOfMemory, kQ3False);
+		return(kQ3Failure);
+		}
+
+
+
+	// Create a pick for each ray
+	rayData.data            = instanceData->data.worldRaysData.data;
+	rayData.vertexTolerance = pickData->vertexTolerance;
+	rayData.edgeTolerance   = pickData->edgeTolerance;
+
+	for (n = 0; n < pickData->numRays; n++)
+		{
+		rayData.ray = pickData->rays[n];
+		rayPick     = E3WorldRayPick_New(&rayData);
+		if (rayPick == NULL)
+			{
+			for (n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+				Q3Object_Dispose(instanceData->raySet->rayPicks[n]);
+
+			delete instanceData->raySet;
+			delete instanceData->pickHits;
+			instanceData->raySet   = NULL;
+			instanceData->pickHits = NULL;
+			return(kQ3Failure);
+			}
+
+		instanceData->raySet->rayPicks.push_back(rayPick);
+		instanceData->raySet->activeRays[n] = n;
+		}
+	
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3pick_worldrays_delete : World rays pick delete method.
+//-----------------------------------------------------------------------------
+static void
+e3pick_worldrays_delete(TQ3Object theObject, void *privateData)
+{
+	// Empty the pick list
+	E3Pick_EmptyHitList(theObject);
+	
+	
+	// Free data held by the instance data
+	TQ3PickUnionData* instanceData = (TQ3PickUnionData*) privateData;
+	for (TQ3Uns32 n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+		Q3Object_Dispose(instanceData->raySet->rayPicks[n]);
+
+	delete instanceData->raySet;
+	delete instanceData->pickHits;
+	instanceData->raySet   = NULL;
+	instanceData->pickHits = NULL;
+}
+
+
+
+
+
+//=============================================================================
+//      e3pick_worldrays_metahandler : World rays pick metahandler.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+e3pick_worldrays_metahandler(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3XMethodTypeObjectNew:
+			theMethod = (TQ3XFunctionPointer) e3pick_worldrays_new;
+			break;
+
+		case kQ3XMethodTypeObjectDelete:
+			theMethod = (TQ3XFunctionPointer) e3pick_worldrays_delete;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
 //=============================================================================
 //      e3shapepart_new : Shape part new method.
 //-----------------------------------------------------------------------------
@@ -1077,6 +1259,11 @@ E3Pick_RegisterClass(void)
 		qd3dStatus = Q3_REGISTER_CLASS (	kQ3ClassNamePickWorldRay,
 											e3pick_worldray_metahandler,
 											E3WorldRayPick ) ;
+
+	if (qd3dStatus == kQ3Success)
+		qd3dStatus = Q3_REGISTER_CLASS (	kQ3ClassNamePickWorldRays,
+											e3pick_worldrays_metahandler,
+											E3WorldRaysPick ) ;
 	
 	//----------------------------------------------------------------------------------
 	
@@ -1134,6 +1321,7 @@ E3Pick_UnregisterClass(void)
 	succeeded = (kQ3Success == E3ClassTree::UnregisterClass(kQ3ShapePartTypeMeshPart,		kQ3True)) && succeeded;
 	succeeded = (kQ3Success == E3ClassTree::UnregisterClass(kQ3SharedTypeShapePart,		kQ3True)) && succeeded;
 
+	succeeded = (kQ3Success == E3ClassTree::UnregisterClass(kQ3PickTypeWorldRays,		kQ3True)) && succeeded;
 	succeeded = (kQ3Success == E3ClassTree::UnregisterClass(kQ3PickTypeWorldRay,			kQ3True)) && succeeded;
 	succeeded = (kQ3Success == E3ClassTree::UnregisterClass(kQ3PickTypeWindowRect,		kQ3True)) && succeeded;
 	succeeded = (kQ3Success == E3ClassTree::UnregisterClass(kQ3PickTypeWindowPoint,		kQ3True)) && succeeded;
@@ -1218,6 +1406,15 @@ E3Pick_SetData(TQ3PickObject thePick, const TQ3PickData *data)
 
 	e3pick_set_sort_mask(&instanceData->data.common);
 
+
+
+	// Pass it on to the picks of each ray
+	if (instanceData->raySet != NULL)
+		{
+		for (TQ3Uns32 n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+			E3Pick_SetData(instanceData->raySet->rayPicks[n], data);
+		}
+
 	return(kQ3Success);
 }
 
@@ -1239,6 +1436,9 @@ E3Pick_GetVertexTolerance(TQ3PickObject thePick, float *vertexTolerance)
 	else
 	if ( Q3_OBJECT_IS_CLASS (thePick, E3WorldRayPick ) )
 		*vertexTolerance = instanceData->data.worldRayData.vertexTolerance;
+	else
+	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRaysPick ) )
+		*vertexTolerance = instanceData->data.worldRaysData.vertexTolerance;
 	else
 		{
 		*vertexTolerance = 0.0f;
@@ -1268,6 +1468,9 @@ E3Pick_GetEdgeTolerance(TQ3PickObject thePick, float *edgeTolerance)
 	else
 	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRayPick ) )
 		*edgeTolerance = instanceData->data.worldRayData.edgeTolerance ;
+	else
+	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRaysPick ) )
+		*edgeTolerance = instanceData->data.worldRaysData.edgeTolerance ;
 	else
 		{
 		*edgeTolerance = 0.0f ;
@@ -1297,6 +1500,14 @@ E3Pick_SetVertexTolerance(TQ3PickObject thePick, float vertexTolerance)
 	else
 	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRayPick ) )
 		instanceData->data.worldRayData.vertexTolerance = vertexTolerance;
+	else
+	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRaysPick ) )
+		{
+		instanceData->data.worldRaysData.vertexTolerance = vertexTolerance;
+		
+		for (TQ3Uns32 n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+			E3Pick_SetVertexTolerance(instanceData->raySet->rayPicks[n], vertexTolerance);
+		}
 	else
 		return kQ3Failure;
 	
@@ -1323,6 +1534,14 @@ E3Pick_SetEdgeTolerance(TQ3PickObject thePick, float edgeTolerance)
 	else
 	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRayPick ) )
 		instanceData->data.worldRayData.edgeTolerance = edgeTolerance;
+	else
+	if ( Q3_OBJECT_IS_CLASS ( thePick, E3WorldRaysPick ) )
+		{
+		instanceData->data.worldRaysData.edgeTolerance = edgeTolerance;
+		
+		for (TQ3Uns32 n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+			E3Pick_SetEdgeTolerance(instanceData->raySet->rayPicks[n], edgeTolerance);
+		}
 	else
 		return kQ3Failure;
 	
@@ -1342,6 +1561,25 @@ E3Pick_GetNumHits(TQ3PickObject thePick, TQ3Uns32 *numHits)
 
 
 
+	TQ3Uns32			rayHits;
+
+
+
+	// A world rays pick has the hits of all its rays
+	if (instanceData->raySet != NULL)
+		{
+		*numHits = 0;
+		for (TQ3Uns32 n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+			{
+			E3Pick_GetNumHits(instanceData->raySet->rayPicks[n], &rayHits);
+			*numHits += rayHits;
+			}
+		
+		return(kQ3Success);
+		}
+
+
+
 	// Get the field, clamping it if a limit was supplied
 	*numHits = static_cast<TQ3Uns32>(instanceData->pickHits->size());
 	
@@ -1376,6 +1614,16 @@ E3Pick_EmptyHitList(TQ3PickObject thePick)
 	}
 	
 	instanceData->pickHits->clear();
+	instanceData->nearestDistance = kQ3MaxFloat;
+
+
+
+	// And those of each ray
+	if (instanceData->raySet != NULL)
+		{
+		for (TQ3Uns32 n = 0; n < instanceData->raySet->rayPicks.size(); n++)
+			E3Pick_EmptyHitList(instanceData->raySet->rayPicks[n]);
+		}
 
 	return(kQ3Success);
 }
@@ -1489,6 +1737,153 @@ E3Pick_GetPickDetailData(TQ3PickObject thePick, TQ3Uns32 index, TQ3PickDetail pi
 
 
 
+//=============================================================================
+//      E3Pick_IsNearestHitOnly : Does a pick only want the nearest hit?
+//-----------------------------------------------------------------------------
+//		Note :	True if the pick sorts its hits near to far and returns only
+//				one of them, in which case geometries need only record their
+//				nearest hit.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+E3Pick_IsNearestHitOnly(TQ3PickObject thePick)
+{	TQ3PickUnionData	*instanceData = (TQ3PickUnionData *) thePick->FindLeafInstanceData () ;
+
+
+
+	// Check the sort and hit count
+	if (instanceData->data.common.sort            == kQ3PickSortNearToFar &&
+		instanceData->data.common.numHitsToReturn == 1)
+		return(kQ3True);
+	
+	return(kQ3False);
+}
+
+
+
+
+
+//=============================================================================
+//      E3Pick_IsHitNearerThanHither : Is a hit in front of the hither plane?
+//-----------------------------------------------------------------------------
+//		Note :	Window-point picks ignore hits nearer than the hither plane of
+//				the camera, since they cannot be seen. Other picks accept any
+//				hit, and so we always return false for them.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+E3Pick_IsHitNearerThanHither(TQ3PickObject thePick, TQ3ViewObject theView, const TQ3Point3D *hitXYZ)
+{
+	if (E3Pick_GetType(thePick) != kQ3PickTypeWindowPoint)
+		return(kQ3False);
+	
+	TQ3CameraObject theCamera = NULL;
+	E3View_GetCamera( theView, &theCamera );
+	CQ3ObjectRef disposeCamera( theCamera );
+	TQ3CameraRange theRange;
+	((E3Camera*) theCamera)->GetRange( &theRange );
+	TQ3Matrix4x4 worldToView;
+	( (E3Camera*) theCamera )->GetWorldToView( &worldToView );
+	TQ3Point3D viewPt = *hitXYZ * worldToView;
+	
+	return (-viewPt.z < theRange.hither) ? kQ3True : kQ3False;
+}
+
+
+
+
+
+//=============================================================================
+//      E3Pick_IsBoxBeyondNearestHit : Is a box behind the nearest hit so far?
+//-----------------------------------------------------------------------------
+//		Note :	If only the nearest hit is wanted, anything whose world bounds
+//				are further from the eye than the nearest hit recorded so far
+//				can not produce a hit we would keep, and so need not be picked.
+//
+//				We always return false if we have no hit to compare against.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+E3Pick_IsBoxBeyondNearestHit(TQ3PickObject thePick, TQ3ViewObject theView,
+							const TQ3BoundingBox *localBox, const TQ3Matrix4x4 *localToWorld)
+{	TQ3PickUnionData	*instanceData = (TQ3PickUnionData *) thePick->FindLeafInstanceData () ;
+	TQ3Point3D			theCorners[8], worldCorners[8], eyePoint, boxPoint;
+	TQ3BoundingBox		worldBox;
+
+
+
+	// Check we have a nearest hit to compare against
+	if (localBox->isEmpty || instanceData->nearestDistance == kQ3MaxFloat ||
+		!E3Pick_IsNearestHitOnly(thePick)                                 ||
+		!e3pick_get_eye_point(thePick, theView, &eyePoint))
+		return(kQ3False);
+
+
+
+	// Find the world bounds of the box
+	Q3Point3D_Set(&theCorners[0], localBox->min.x, localBox->min.y, localBox->min.z);
+	Q3Point3D_Set(&theCorners[1], localBox->min.x, localBox->min.y, localBox->max.z);
+	Q3Point3D_Set(&theCorners[2], localBox->min.x, localBox->max.y, localBox->min.z);
+	Q3Point3D_Set(&theCorners[3], localBox->min.x, localBox->max.y, localBox->max.z);
+	Q3Point3D_Set(&theCorners[4], localBox->max.x, localBox->min.y, localBox->min.z);
+	Q3Point3D_Set(&theCorners[5], localBox->max.x, localBox->min.y, localBox->max.z);
+	Q3Point3D_Set(&theCorners[6], localBox->max.x, localBox->max.y, localBox->min.z);
+	Q3Point3D_Set(&theCorners[7], localBox->max.x, localBox->max.y, localBox->max.z);
+
+	Q3Point3D_To3DTransformArray(theCorners, localToWorld, worldCorners, 8,
+								 sizeof(TQ3Point3D), sizeof(TQ3Point3D));
+	Q3BoundingBox_SetFromPoints3D(&worldBox, worldCorners, 8, sizeof(TQ3Point3D));
+
+
+
+	// Compare the distance to the nearest point of the box
+	boxPoint.x = E3Num_Clamp(eyePoint.x, worldBox.min.x, worldBox.max.x);
+	boxPoint.y = E3Num_Clamp(eyePoint.y, worldBox.min.y, worldBox.max.y);
+	boxPoint.z = E3Num_Clamp(eyePoint.z, worldBox.min.z, worldBox.max.z);
+
+	return((Q3FastPoint3D_Distance(&eyePoint, &boxPoint) > instanceData->nearestDistance) ? kQ3True : kQ3False);
+}
+
+
+
+
+
+//=============================================================================
+//      E3Pick_GetNearestHitRayLimit : Get the ray parameter of the nearest hit.
+//-----------------------------------------------------------------------------
+//		Note :	Returns a ray parameter beyond which a hit along worldRay must
+//				be further from the eye than the nearest hit so far, allowing
+//				ray-casting geometries to ignore anything further along the
+//				ray. Since the ray need not start at the eye, the limit is
+//				widened by the distance between the two.
+//
+//				Returns kQ3MaxFloat if we have no hit to compare against.
+//-----------------------------------------------------------------------------
+float
+E3Pick_GetNearestHitRayLimit(TQ3PickObject thePick, TQ3ViewObject theView, const TQ3Ray3D *worldRay)
+{	TQ3PickUnionData	*instanceData = (TQ3PickUnionData *) thePick->FindLeafInstanceData () ;
+	TQ3Point3D			eyePoint;
+	float				rayLength;
+
+
+
+	// Check we have a nearest hit to compare against
+	if (instanceData->nearestDistance == kQ3MaxFloat ||
+		!E3Pick_IsNearestHitOnly(thePick)             ||
+		!e3pick_get_eye_point(thePick, theView, &eyePoint))
+		return(kQ3MaxFloat);
+
+	rayLength = Q3FastVector3D_Length(&worldRay->direction);
+	if (rayLength < kQ3RealZero)
+		return(kQ3MaxFloat);
+
+
+
+	// Convert the distance to a ray parameter
+	return((instanceData->nearestDistance + Q3FastPoint3D_Distance(&worldRay->origin, &eyePoint)) / rayLength);
+}
+
+
+
+
+
 //=============================================================================
 //      E3Pick_RecordHit : Record a hit against a pick object.
 //-----------------------------------------------------------------------------
@@ -1522,20 +1917,22 @@ E3Pick_RecordHit(TQ3PickObject				thePick,
 	
 	// If it is a window-point pick and we have an XYZ, then reject it if it is
 	// nearer than the hither plane.
-	if ( (hitXYZ != NULL) and (E3Pick_GetType(thePick) == kQ3PickTypeWindowPoint) )
+	if ( (hitXYZ != NULL) and E3Pick_IsHitNearerThanHither( thePick, theView, hitXYZ ) )
 	{
-		TQ3CameraObject theCamera = NULL;
-		E3View_GetCamera( theView, &theCamera );
-		CQ3ObjectRef disposeCamera( theCamera );
-		TQ3CameraRange theRange;
-		((E3Camera*) theCamera)->GetRange( &theRange );
-		TQ3Matrix4x4 worldToView;
-		( (E3Camera*) theCamera )->GetWorldToView( &worldToView );
-		TQ3Point3D viewPt = *hitXYZ * worldToView;
-		if (-viewPt.z < theRange.hither)
-		{
+		return theStatus;
+	}
+	
+	
+	// If only the nearest hit is wanted, drop hits behind the nearest so far
+	TQ3Point3D eyePoint;
+	if ( (hitXYZ != NULL) and E3Pick_IsNearestHitOnly( thePick ) and
+		e3pick_get_eye_point( thePick, theView, &eyePoint ) )
+	{
+		float theDistance = Q3FastPoint3D_Distance( hitXYZ, &eyePoint );
+		if (theDistance > instanceData->nearestDistance)
 			return theStatus;
-		}
+		
+		instanceData->nearestDistance = theDistance;
 	}
 	
 	
@@ -1809,6 +2206,193 @@ E3WorldRayPick_SetData(TQ3PickObject thePick, const TQ3WorldRayPickData *data)
 
 
 
+//=============================================================================
+//      E3WorldRaysPick_New : Creates a new world rays pick.
+//-----------------------------------------------------------------------------
+#pragma mark -
+TQ3PickObject
+E3WorldRaysPick_New(const TQ3WorldRaysPickData *data)
+	{
+	// Create the object
+	return E3ClassTree::CreateInstance ( kQ3PickTypeWorldRays, kQ3False, data ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_GetNumRays : Gets the number of rays.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3WorldRaysPick_GetNumRays(TQ3PickObject thePick, TQ3Uns32 *numRays)
+	{
+	// Get the field
+	*numRays = static_cast<TQ3Uns32>( ( (E3WorldRaysPick*) thePick )->instanceData.raySet->rayPicks.size () ) ;
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_GetNumHits : Gets the number of hits of a ray.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3WorldRaysPick_GetNumHits(TQ3PickObject thePick, TQ3Uns32 rayIndex, TQ3Uns32 *numHits)
+	{
+	TQ3PickObject rayPick = E3WorldRaysPick_AccessRayPick ( thePick, rayIndex ) ;
+	if ( rayPick == NULL )
+		{
+		*numHits = 0 ;
+		return kQ3Failure ;
+		}
+	
+	return E3Pick_GetNumHits ( rayPick, numHits ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_GetPickDetailValidMask : Gets the mask of a ray's hit.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3WorldRaysPick_GetPickDetailValidMask(TQ3PickObject thePick, TQ3Uns32 rayIndex, TQ3Uns32 hitIndex, TQ3PickDetail *pickDetailValidMask)
+	{
+	TQ3PickObject rayPick = E3WorldRaysPick_AccessRayPick ( thePick, rayIndex ) ;
+	if ( rayPick == NULL )
+		{
+		*pickDetailValidMask = kQ3PickDetailNone ;
+		return kQ3Failure ;
+		}
+	
+	return E3Pick_GetPickDetailValidMask ( rayPick, hitIndex, pickDetailValidMask ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_GetPickDetailData : Gets the data of a ray's hit.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3WorldRaysPick_GetPickDetailData(TQ3PickObject thePick, TQ3Uns32 rayIndex, TQ3Uns32 hitIndex, TQ3PickDetail pickDetailValue, void *detailData)
+	{
+	TQ3PickObject rayPick = E3WorldRaysPick_AccessRayPick ( thePick, rayIndex ) ;
+	if ( rayPick == NULL )
+		return kQ3Failure ;
+	
+	return E3Pick_GetPickDetailData ( rayPick, hitIndex, pickDetailValue, detailData ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_AccessRayPick : Access the pick of a ray.
+//-----------------------------------------------------------------------------
+//		Note :	Used internally by Quesa. The world ray pick of each ray is
+//				owned by the world rays pick, and is not ref-counted. Returns
+//				NULL if the index is out of range.
+//-----------------------------------------------------------------------------
+TQ3PickObject
+E3WorldRaysPick_AccessRayPick(TQ3PickObject thePick, TQ3Uns32 rayIndex)
+	{
+	TQ3PickRaySet* raySet = ( (E3WorldRaysPick*) thePick )->instanceData.raySet ;
+	
+	if ( rayIndex >= raySet->rayPicks.size () )
+		return NULL ;
+	
+	return raySet->rayPicks[ rayIndex ] ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_GetNumThreads : Get the number of threads to pick on.
+//-----------------------------------------------------------------------------
+//		Note :	Used internally by Quesa. Returns at least 1.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+E3WorldRaysPick_GetNumThreads(TQ3PickObject thePick)
+	{
+	TQ3Uns32 numThreads = ( (E3WorldRaysPick*) thePick )->instanceData.data.worldRaysData.numThreads ;
+	
+	return ( numThreads == 0 ) ? 1 : numThreads ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_GetActiveRays : Get the rays still to be tested.
+//-----------------------------------------------------------------------------
+//		Note :	Used internally by Quesa. While picking, groups narrow the
+//				active rays to those that may hit each of their members, and
+//				geometries are tested against the active rays only.
+//
+//				The returned array is valid until the active rays change.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+E3WorldRaysPick_GetActiveRays(TQ3PickObject thePick, const TQ3Uns32 **rayIndices)
+	{
+	std::vector<TQ3Uns32>& activeRays = ( (E3WorldRaysPick*) thePick )->instanceData.raySet->activeRays ;
+	
+	*rayIndices = activeRays.empty () ? NULL : &activeRays[ 0 ] ;
+	return static_cast<TQ3Uns32>( activeRays.size () ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_SetActiveRays : Set the rays still to be tested.
+//-----------------------------------------------------------------------------
+//		Note :	Used internally by Quesa. The rays must be a subset of the
+//				rays of the pick, which we always have room for, so this can't
+//				fail.
+//-----------------------------------------------------------------------------
+void
+E3WorldRaysPick_SetActiveRays(TQ3PickObject thePick, TQ3Uns32 numRays, const TQ3Uns32 *rayIndices)
+	{
+	std::vector<TQ3Uns32>& activeRays = ( (E3WorldRaysPick*) thePick )->instanceData.raySet->activeRays ;
+	
+	activeRays.assign ( rayIndices, rayIndices + numRays ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3WorldRaysPick_ResetActiveRays : Make every ray active.
+//-----------------------------------------------------------------------------
+//		Note :	Used internally by Quesa, at the start of each picking pass.
+//-----------------------------------------------------------------------------
+void
+E3WorldRaysPick_ResetActiveRays(TQ3PickObject thePick)
+	{
+	TQ3PickRaySet* raySet = ( (E3WorldRaysPick*) thePick )->instanceData.raySet ;
+	
+	// Our vector was created with room for every ray, so this can't throw
+	raySet->activeRays.resize ( raySet->rayPicks.size () ) ;
+	for ( TQ3Uns32 n = 0 ; n < raySet->activeRays.size () ; ++n )
+		raySet->activeRays[ n ] = n ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3ShapePart_New : Creates a new shape part.
 //		(Semi-private, no access to the 3rd party programmer)
@@ -82,6 +82,11 @@ TQ3Status				E3Pick_EmptyHitList(TQ3PickObject thePick);
 TQ3Status				E3Pick_GetPickDetailValidMask(TQ3PickObject thePick, TQ3Uns32 index, TQ3PickDetail *pickDetailValidMask);
 TQ3Status				E3Pick_GetPickDetailData(TQ3PickObject thePick, TQ3Uns32 index, TQ3PickDetail pickDetailValue, void *detailData);
 
+TQ3Boolean				E3Pick_IsNearestHitOnly(TQ3PickObject thePick);
+TQ3Boolean				E3Pick_IsHitNearerThanHither(TQ3PickObject thePick, TQ3ViewObject theView, const TQ3Point3D *hitXYZ);
+TQ3Boolean				E3Pick_IsBoxBeyondNearestHit(TQ3PickObject thePick, TQ3ViewObject theView, const TQ3BoundingBox *localBox, const TQ3Matrix4x4 *localToWorld);
+float					E3Pick_GetNearestHitRayLimit(TQ3PickObject thePick, TQ3ViewObject theView, const TQ3Ray3D *worldRay);
+
 TQ3Status				E3Pick_RecordHit(TQ3PickObject        		thePick,
 											TQ3ViewObject     		theView,
 											const TQ3Point3D  		*hitXYZ,
@@ -109,6 +114,17 @@ TQ3Status				E3WorldRayPick_SetRay(TQ3PickObject thePick, const TQ3Ray3D *ray);
 TQ3Status				E3WorldRayPick_GetData(TQ3PickObject thePick, TQ3WorldRayPickData *data);
 TQ3Status				E3WorldRayPick_SetData(TQ3PickObject thePick, const TQ3WorldRayPickData *data);
 
+TQ3PickObject			E3WorldRaysPick_New(const TQ3WorldRaysPickData *data);
+TQ3Status				E3WorldRaysPick_GetNumRays(TQ3PickObject thePick, TQ3Uns32 *numRays);
+TQ3Status				E3WorldRaysPick_GetNumHits(TQ3PickObject thePick, TQ3Uns32 rayIndex, TQ3Uns32 *numHits);
+TQ3Status				E3WorldRaysPick_GetPickDetailValidMask(TQ3PickObject thePick, TQ3Uns32 rayIndex, TQ3Uns32 hitIndex, TQ3PickDetail *pickDetailValidMask);
+TQ3Status				E3WorldRaysPick_GetPickDetailData(TQ3PickObject thePick, TQ3Uns32 rayIndex, TQ3Uns32 hitIndex, TQ3PickDetail pickDetailValue, void *detailData);
+TQ3PickObject			E3WorldRaysPick_AccessRayPick(TQ3PickObject thePick, TQ3Uns32 rayIndex);
+TQ3Uns32				E3WorldRaysPick_GetNumThreads(TQ3PickObject thePick);
+TQ3Uns32				E3WorldRaysPick_GetActiveRays(TQ3PickObject thePick, const TQ3Uns32 **rayIndices);
+void					E3WorldRaysPick_SetActiveRays(TQ3PickObject thePick, TQ3Uns32 numRays, const TQ3Uns32 *rayIndices);
+void					E3WorldRaysPick_ResetActiveRays(TQ3PickObject thePick);
+
 TQ3MeshPartObject		E3MeshPart_New(const TQ3MeshComponent data);
 TQ3ObjectType			E3MeshPart_GetType(TQ3MeshPartObject meshPartObject);
 TQ3Status				E3MeshPart_GetComponent(TQ3MeshPartObject meshPartObject, TQ3MeshComponent *component);
@@ -547,6 +547,49 @@ E3Renderer_Method_IsBBoxVisible(TQ3ViewObject theView, const TQ3BoundingBox *the
 
 
 
+//=============================================================================
+//      E3Renderer_Method_IsBBoxArrayVisible : Call the bounds array visible method.
+//-----------------------------------------------------------------------------
+//		Note :	Renderers without an array method have their single bounds
+//				visible method called for each box.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Renderer_Method_IsBBoxArrayVisible(TQ3ViewObject theView, TQ3Uns32 numBBoxes,
+									 const TQ3BoundingBox *theBBoxes, TQ3Uns32 *visibleMask)
+	{
+	TQ3RendererObject theRenderer = E3View_AccessRenderer ( theView ) ;
+	TQ3Uns32 n ;
+
+
+
+	// Use the array method, if implemented
+	if ( theRenderer != NULL )
+		{
+		TQ3XRendererIsBoundingBoxArrayVisibleMethod isBoundingBoxArrayVisible = (TQ3XRendererIsBoundingBoxArrayVisibleMethod)
+							theRenderer->GetMethod ( kQ3XMethodTypeRendererIsBoundingBoxArrayVisible ) ;
+		if ( isBoundingBoxArrayVisible != NULL )
+			return isBoundingBoxArrayVisible ( theView, theRenderer->FindLeafInstanceData (), numBBoxes, theBBoxes, visibleMask ) ;
+		}
+
+
+
+	// Otherwise test each box in turn
+	for ( n = 0 ; n < ( numBBoxes + 31 ) / 32 ; ++n )
+		visibleMask[ n ] = 0 ;
+
+	for ( n = 0 ; n < numBBoxes ; ++n )
+		{
+		if ( E3Renderer_Method_IsBBoxVisible ( theView, &theBBoxes[ n ] ) )
+			visibleMask[ n / 32 ] |= 1U << ( n % 32 ) ;
+		}
+	
+	return kQ3Success ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3Renderer_Method_UpdateMatrix : Matrix update method.
 //-----------------------------------------------------------------------------
@@ -587,7 +630,7 @@ E3Renderer_Method_UpdateMatrix(TQ3ViewObject			theView,
 			E3View_AccessUpdateLocalToWorldInverseTranspose( theView );
 
 		if ((updateLocalToWorldInv != NULL) || (updateLocalToWorldInvT != NULL) )
-			Q3Matrix4x4_Invert(localToWorld, &worldToLocal);
+			E3Matrix4x4_InvertKind(localToWorld, E3View_State_GetMatrixLocalToWorldKind(theView), &worldToLocal);
 
 		if ( (qd3dStatus == kQ3Success) && (updateLocalToWorld != NULL) )
 			qd3dStatus = updateLocalToWorld(theView, instanceData, localToWorld);
@@ -651,7 +694,8 @@ E3Renderer_Method_UpdateMatrix(TQ3ViewObject			theView,
 
 		if ( (qd3dStatus == kQ3Success) && (updateLocalToFrustum != NULL) )
 		{
-			Q3Matrix4x4_Multiply( localToCamera, cameraToFrustum, &tmpMatrix );
+			E3Matrix4x4_MultiplyKind( localToCamera, E3View_State_GetMatrixLocalToCameraKind( theView ),
+									  cameraToFrustum, kQ3MatrixKindGeneral, &tmpMatrix );
 			qd3dStatus = updateLocalToFrustum( theView, instanceData, &tmpMatrix );
 		}
 	}
@@ -806,6 +850,12 @@ E3Renderer_Method_SubmitGeometry(TQ3ViewObject		theView,
 
 	if (*geomSupported)
 	{
+		// Record the geometry if the view is recording this pass for replay,
+		// and skip it if it's in a group which the view has culled
+		if ( ! E3View_Replay_RecordGeometry( theView, geomType, theGeom, geomData ) )
+			return kQ3Success ;
+
+
 		// Test whether the geometry's attribute set contains a surface shader.
 		// (How do we do this in immediate mode?)
 		TQ3Boolean	hasSurfaceShader = kQ3False;
@@ -820,6 +870,11 @@ E3Renderer_Method_SubmitGeometry(TQ3ViewObject		theView,
 		}
 		
 		
+		// Anything submitted from here on is part of the geometry, so isn't
+		// recorded separately
+		E3View_Replay_SuspendRecording( theView, kQ3True );
+
+
 		// If there is a shader, we must push the view state
 		if ( hasSurfaceShader )
 			E3Push_Submit ( theView ) ;
@@ -831,6 +886,8 @@ E3Renderer_Method_SubmitGeometry(TQ3ViewObject		theView,
 
 		if (hasSurfaceShader)
 			E3Pop_Submit( theView );
+
+		E3View_Replay_SuspendRecording( theView, kQ3False );
 	}
 
 
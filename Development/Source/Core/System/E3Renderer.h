@@ -76,6 +76,7 @@ TQ3ViewStatus		E3Renderer_Method_EndPass(TQ3ViewObject theView);
 TQ3Status			E3Renderer_Method_FlushFrame(TQ3ViewObject theView, TQ3DrawContextObject theDrawContext);
 TQ3Status			E3Renderer_Method_EndFrame(TQ3ViewObject theView, TQ3DrawContextObject theDrawContext);
 TQ3Boolean			E3Renderer_Method_IsBBoxVisible(TQ3ViewObject theView, const TQ3BoundingBox *theBBox);
+TQ3Status			E3Renderer_Method_IsBBoxArrayVisible(TQ3ViewObject theView, TQ3Uns32 numBBoxes, const TQ3BoundingBox *theBBoxes, TQ3Uns32 *visibleMask);
 TQ3Status			E3Renderer_Method_UpdateMatrix(TQ3ViewObject theView,
 										TQ3MatrixState theState,
 										const TQ3Matrix4x4 *localToWorld,
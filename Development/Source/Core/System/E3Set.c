@@ -66,6 +66,8 @@
 #include "E3IOFileFormat.h"
 #include "E3Main.h"
 
+#include <cstring>
+
 
 
 
@@ -77,6 +79,39 @@ const TQ3Uns32 kSetTableSize									= 8;
 
 
 
+// Size of the packed data for each built-in attribute
+static const TQ3Uns32 kSetAttributeSizes[kQ3AttributeTypeNumTypes] =
+									{ 0,
+									  sizeof(TQ3Param2D),				// kQ3AttributeTypeSurfaceUV
+									  sizeof(TQ3Param2D),				// kQ3AttributeTypeShadingUV
+									  sizeof(TQ3Vector3D),				// kQ3AttributeTypeNormal
+									  sizeof(float),					// kQ3AttributeTypeAmbientCoefficient
+									  sizeof(TQ3ColorRGB),				// kQ3AttributeTypeDiffuseColor
+									  sizeof(TQ3ColorRGB),				// kQ3AttributeTypeSpecularColor
+									  sizeof(float),					// kQ3AttributeTypeSpecularControl
+									  sizeof(TQ3ColorRGB),				// kQ3AttributeTypeTransparencyColor
+									  sizeof(TQ3Tangent2D),				// kQ3AttributeTypeSurfaceTangent
+									  sizeof(TQ3Switch),				// kQ3AttributeTypeHighlightState
+									  0,								// kQ3AttributeTypeSurfaceShader, held separately
+									  sizeof(TQ3ColorRGB) };			// kQ3AttributeTypeEmissiveColor
+
+
+
+// Built-in attributes which are packed
+const TQ3XAttributeMask kSetPackedAttributeMask					= kQ3XAttributeMaskAll
+																& ~kQ3XAttributeMaskCustomAttribute
+																& ~kQ3XAttributeMaskSurfaceShader;
+
+
+
+// Attribute type of a single mask bit, indexed by the bit modulo 37
+static const TQ3Uns8 kSetMaskBitTypes[37] = {  0,  1,  2, 27,  3, 24, 28,  0,  4, 17,
+											  25, 31, 29, 12,  0, 14,  5,  8, 18,  0,
+											  26, 23, 32, 16, 30, 11, 13,  7,  0, 22,
+											  15, 10,  6, 21,  9, 20, 19 };
+
+
+
 
 
 //=============================================================================
@@ -363,6 +398,331 @@ e3element_new_class_info (
 
 
 
+//=============================================================================
+//      e3set_attribute_lowest_type : Get the lowest attribute type in a mask.
+//-----------------------------------------------------------------------------
+//		Note :	Walking the bits of a mask visits only the attributes present,
+//				where a loop over every type mispredicts a branch for each.
+//-----------------------------------------------------------------------------
+static inline TQ3AttributeType
+e3set_attribute_lowest_type(TQ3XAttributeMask theMask)
+{
+
+
+	// Isolate the lowest bit, and look up its type
+	return((TQ3AttributeType) kSetMaskBitTypes[(theMask & (0 - theMask)) % 37]);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_attribute_data : Get the packed attribute data of a set.
+//-----------------------------------------------------------------------------
+static inline TQ3Uns32 *
+e3set_attribute_data(const TQ3SetData *instanceData)
+{
+
+
+	// Return the spill storage if we have any, otherwise the inline storage
+	if (instanceData->attributeSpill != NULL)
+		return(instanceData->attributeSpill);
+
+	return((TQ3Uns32 *) instanceData->attributeInline);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_attribute_pointer : Get a pointer to a built-in attribute.
+//-----------------------------------------------------------------------------
+//		Note :	The attribute must be present in the set. The pointer remains
+//				valid until the built-in attributes of the set are changed.
+//-----------------------------------------------------------------------------
+static inline void *
+e3set_attribute_pointer(const TQ3SetData *instanceData, TQ3AttributeType theType)
+{
+
+
+	// The surface shader is not packed
+	if (theType == kQ3AttributeTypeSurfaceShader)
+		return((void *) &instanceData->surfaceShader);
+
+	return(e3set_attribute_data(instanceData) + instanceData->attributeOffsets[theType]);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_attribute_layout : Calculate the packed layout for a mask.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the number of words needed by the attributes in theMask.
+//				Only the offsets of the attributes in theMask are set.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3set_attribute_layout(TQ3XAttributeMask theMask, TQ3Uns8 *theOffsets)
+{	TQ3AttributeType	theType;
+	TQ3Uns32			numWords;
+
+
+
+	// Pack the attributes in type order
+	numWords = 0;
+
+	for (theMask &= kSetPackedAttributeMask; theMask != 0; theMask &= (theMask - 1))
+		{
+		theType             = e3set_attribute_lowest_type(theMask);
+		theOffsets[theType] = (TQ3Uns8) numWords;
+		numWords           += kSetAttributeSizes[theType] / sizeof(TQ3Uns32);
+		}
+
+	Q3_ASSERT(numWords <= kQ3SetMaxAttributeWords);
+	return(numWords);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_attribute_resize : Change the built-in attributes of a set.
+//-----------------------------------------------------------------------------
+//		Note :	Attributes in both the old and new mask keep their data, the
+//				data of newly added attributes is undefined.
+//
+//				The surface shader is not touched, our caller must take or
+//				release its reference.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3set_attribute_resize(TQ3SetData *instanceData, TQ3XAttributeMask newMask)
+{	TQ3AttributeType	keptTypes[kQ3AttributeTypeNumTypes];
+	TQ3Uns8				newOffsets[kQ3AttributeTypeNumTypes];
+	TQ3Uns32			*oldData, *newData, *newSpill;
+	TQ3Uns32			n, numKept, numNewWords;
+	TQ3XAttributeMask	keptMask;
+	TQ3AttributeType	theType;
+
+
+
+	// Validate our state
+	Q3_ASSERT((newMask & ~instanceData->theMask) == 0 || (instanceData->theMask & ~newMask) == 0);
+
+
+
+	// Work out the new layout
+	numNewWords = e3set_attribute_layout(newMask, newOffsets);
+	keptMask    = (newMask & instanceData->theMask & kSetPackedAttributeMask);
+	oldData     = e3set_attribute_data(instanceData);
+
+
+
+	// Find the storage for the new layout
+	newSpill = NULL;
+	
+	if (numNewWords > kQ3SetInlineAttributeWords)
+		{
+		newSpill = instanceData->attributeSpill;
+		if (newSpill == NULL)
+			{
+			newSpill = (TQ3Uns32 *) Q3Memory_Allocate(kQ3SetMaxAttributeWords * sizeof(TQ3Uns32));
+			if (newSpill == NULL)
+				return(kQ3Failure);
+			}
+		}
+
+	newData = (newSpill != NULL) ? newSpill : instanceData->attributeInline;
+
+
+
+	// Move the data we kept into place. A set only ever grows or shrinks, so
+	// attributes all move up or all move down, and moving them from the far
+	// end first never overwrites data which has still to be moved.
+	numKept = 0;
+	for (; keptMask != 0; keptMask &= (keptMask - 1))
+		keptTypes[numKept++] = e3set_attribute_lowest_type(keptMask);
+
+	for (n = 0; n < numKept; n++)
+		{
+		if ((newMask & ~instanceData->theMask) != 0)
+			theType = keptTypes[numKept - n - 1];
+		else
+			theType = keptTypes[n];
+
+		if (newData != oldData || newOffsets[theType] != instanceData->attributeOffsets[theType])
+			memmove(&newData[newOffsets[theType]],
+					&oldData[instanceData->attributeOffsets[theType]],
+					kSetAttributeSizes[theType]);
+		}
+
+
+
+	// Update the set
+	if (instanceData->attributeSpill != newSpill)
+		Q3Memory_Free(&instanceData->attributeSpill);
+
+	memcpy(instanceData->attributeOffsets, newOffsets, sizeof(newOffsets));
+	instanceData->attributeSpill = newSpill;
+	instanceData->theMask        = newMask;
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_attribute_copy : Copy the built-in attributes of a set.
+//-----------------------------------------------------------------------------
+//		Note :	The destination must not hold any built-in attributes. The
+//				surface shader is not copied, our caller must handle it.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3set_attribute_copy(const TQ3SetData *fromInstanceData, TQ3SetData *toInstanceData)
+{	TQ3Uns8			theOffsets[kQ3AttributeTypeNumTypes];
+	TQ3Uns32		numWords;
+
+
+
+	// Set up the layout
+	if (e3set_attribute_resize(toInstanceData, fromInstanceData->theMask) != kQ3Success)
+		return(kQ3Failure);
+
+
+
+	// Copy the packed data
+	numWords = e3set_attribute_layout(fromInstanceData->theMask, theOffsets);
+	if (numWords != 0)
+		memcpy(e3set_attribute_data(toInstanceData),
+			   e3set_attribute_data(fromInstanceData),
+			   numWords * sizeof(TQ3Uns32));
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_attribute_inherit : Inherit built-in attributes.
+//-----------------------------------------------------------------------------
+//		Note :	The result must either be empty, or be the child. Attributes in
+//				the child take precedence over those in the parent.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3set_attribute_inherit(const TQ3SetData *parentData, const TQ3SetData *childData, TQ3SetData *resultData)
+{	TQ3Uns32				theWords[kQ3SetMaxAttributeWords];
+	const TQ3Uns32			*parentWords, *childWords, *fromWords;
+	TQ3XAttributeMask		parentMask, copyMask, theMask;
+	TQ3Uns32				n, numWords, theOffset;
+	TQ3AttributeType		theType;
+	TQ3Uns32				*resultWords;
+
+
+
+	// Find the attributes to copy
+	parentMask  = (parentData->theMask & ~childData->theMask);
+	copyMask    = (resultData == childData) ? parentMask : (parentMask | childData->theMask);
+	parentWords = e3set_attribute_data(parentData);
+	childWords  = e3set_attribute_data(childData);
+
+
+
+	// An empty result is laid out and filled in a single pass over the union
+	// of both sets, into a buffer which is then copied to the result's storage
+	if (resultData != childData)
+		{
+		Q3_ASSERT((resultData->theMask & kSetPackedAttributeMask) == kQ3XAttributeMaskNone);
+
+		numWords = 0;
+		for (theMask = (copyMask & kSetPackedAttributeMask); theMask != 0; theMask &= (theMask - 1))
+			{
+			theType = e3set_attribute_lowest_type(theMask);
+
+			if ((parentMask & (1 << (theType - 1))) != 0)
+				fromWords = parentWords + parentData->attributeOffsets[theType];
+			else
+				fromWords = childWords  + childData->attributeOffsets[theType];
+
+			resultData->attributeOffsets[theType] = (TQ3Uns8) numWords;
+
+			for (n = 0; n < kSetAttributeSizes[theType] / sizeof(TQ3Uns32); n++)
+				theWords[numWords++] = fromWords[n];
+			}
+
+		if (numWords > kQ3SetInlineAttributeWords && resultData->attributeSpill == NULL)
+			{
+			resultData->attributeSpill = (TQ3Uns32 *) Q3Memory_Allocate(kQ3SetMaxAttributeWords * sizeof(TQ3Uns32));
+			if (resultData->attributeSpill == NULL)
+				return(kQ3Failure);
+			}
+
+		memcpy(e3set_attribute_data(resultData), theWords, numWords * sizeof(TQ3Uns32));
+		resultData->theMask = (childData->theMask | parentMask);
+		}
+
+
+
+	// Otherwise the child is laid out for the union, and the parent's
+	// attributes copied into it
+	else
+		{
+		if (e3set_attribute_resize(resultData, childData->theMask | parentMask) != kQ3Success)
+			return(kQ3Failure);
+
+		resultWords = e3set_attribute_data(resultData);
+
+		for (theMask = (copyMask & kSetPackedAttributeMask); theMask != 0; theMask &= (theMask - 1))
+			{
+			theType   = e3set_attribute_lowest_type(theMask);
+			fromWords = parentWords + parentData->attributeOffsets[theType];
+			theOffset = resultData->attributeOffsets[theType];
+
+			for (n = 0; n < kSetAttributeSizes[theType] / sizeof(TQ3Uns32); n++)
+				resultWords[theOffset + n] = fromWords[n];
+			}
+		}
+
+
+
+	// Take a reference to the surface shader
+	if ((copyMask & kQ3XAttributeMaskSurfaceShader) != 0)
+		resultData->surfaceShader = Q3Shared_GetReference(((parentMask & kQ3XAttributeMaskSurfaceShader) != 0) ?
+										parentData->surfaceShader : childData->surfaceShader);
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3set_scan_free : Dispose of the scan state of a set.
+//-----------------------------------------------------------------------------
+static void
+e3set_scan_free(TQ3SetData *instanceData)
+{
+
+
+	// Dispose of the scan state
+	if (instanceData->scanState != NULL)
+		{
+		Q3Memory_Free(&instanceData->scanState->scanResults);
+		Q3Memory_Free(&instanceData->scanState);
+		}
+}
+
+
+
+
+
 //=============================================================================
 //      e3set_add_element : Add an element to a set.
 //-----------------------------------------------------------------------------
@@ -605,16 +965,17 @@ e3set_iterator_submit(TQ3SetData *instanceData, TQ3ObjectType theType, TQ3Elemen
 //-----------------------------------------------------------------------------
 static TQ3Status
 e3set_iterator_scan_types(TQ3SetData *instanceData, TQ3ObjectType theType, TQ3ElementObject theElement, void *userData)
-{	TQ3Status	qd3dStatus;
+{	TQ3SetScanState		*scanState = instanceData->scanState;
+	TQ3Status			qd3dStatus;
 
 
 
 	// Append the type to the scan results table
-	qd3dStatus = Q3Memory_Reallocate(&instanceData->scanResults, static_cast<TQ3Uns32>((instanceData->scanCount + 1) * sizeof (TQ3ObjectType)));
+	qd3dStatus = Q3Memory_Reallocate(&scanState->scanResults, static_cast<TQ3Uns32>((scanState->scanCount + 1) * sizeof (TQ3ObjectType)));
 	if (qd3dStatus == kQ3Success)
 		{
-		instanceData->scanResults[instanceData->scanCount] = theType;
-		instanceData->scanCount++;
+		scanState->scanResults[scanState->scanCount] = theType;
+		scanState->scanCount++;
 		}
 	
 	return(qd3dStatus);
@@ -643,7 +1004,7 @@ e3set_delete ( E3Set* theObject, void *privateData )
 	if (instanceData->theTable != NULL)
 		E3HashTable_Destroy(&instanceData->theTable);
 
-	Q3Memory_Free(&instanceData->scanResults);
+	e3set_scan_free(instanceData);
 	}
 
 
@@ -671,11 +1032,17 @@ e3set_duplicate(TQ3Object fromObject, const void *fromPrivateData,
 
 
 	// Initialise the instance data of the new object
-	toInstanceData->theTable = NULL;
-	toInstanceData->theMask = fromInstanceData->theMask;
-	toInstanceData->attributes = fromInstanceData->attributes;
-	if(toInstanceData->attributes.surfaceShader != NULL)
-		toInstanceData->attributes.surfaceShader = Q3Object_Duplicate(toInstanceData->attributes.surfaceShader);
+	toInstanceData->theTable       = NULL;
+	toInstanceData->scanState      = NULL;
+	toInstanceData->attributeSpill = NULL;
+	toInstanceData->surfaceShader  = NULL;
+	toInstanceData->theMask        = kQ3XAttributeMaskNone;
+
+	if (e3set_attribute_copy(fromInstanceData, toInstanceData) != kQ3Success)
+		return(kQ3Failure);
+
+	if (fromInstanceData->surfaceShader != NULL)
+		toInstanceData->surfaceShader = Q3Object_Duplicate(fromInstanceData->surfaceShader);
 	
 	
 
@@ -1945,81 +2312,59 @@ E3Set::Add ( TQ3ElementType theType, const void *data )
 	if ( ( theType  < kQ3AttributeTypeNone ) || ( theType > kQ3AttributeTypeNumTypes ) )
 		theType = E3Attribute_ClassToAttributeType ( theType ) ;
 
-	switch ( theType )
+	if ( theType == kQ3AttributeTypeSurfaceShader )
 		{
-		case kQ3AttributeTypeSurfaceUV:
-			setData.attributes.surfaceUV = * ( (TQ3Param2D*) data ) ;
-			break;
-		case kQ3AttributeTypeShadingUV:
-			setData.attributes.shadingUV = * ( (TQ3Param2D*) data ) ;
-			break;
-		case kQ3AttributeTypeNormal:
-			setData.attributes.normal = * ( (TQ3Vector3D*) data ) ;
-			break;
-		case kQ3AttributeTypeAmbientCoefficient:
-			setData.attributes.ambientCoeficient = * ( (float*) data ) ;
-			break;
-		case kQ3AttributeTypeDiffuseColor:
-			setData.attributes.diffuseColor = * ( (TQ3ColorRGB*) data ) ;
-			break;
-		case kQ3AttributeTypeSpecularColor:
-			setData.attributes.specularColor = * ( (TQ3ColorRGB*) data ) ;
-			break;
-		case kQ3AttributeTypeSpecularControl:
-			setData.attributes.specularControl = * ( (float*) data ) ;
-			break;
-		case kQ3AttributeTypeTransparencyColor:
-			setData.attributes.transparencyColor = * ( (TQ3ColorRGB*) data ) ;
-			break;
-		case kQ3AttributeTypeSurfaceTangent:
-			setData.attributes.surfaceTangent = * ( (TQ3Tangent2D*) data ) ;
-			break;
-		case kQ3AttributeTypeHighlightState:
-			setData.attributes.highlightState = * ( (TQ3Switch*) data ) ;
-			break;
-		case kQ3AttributeTypeEmissiveColor:
-			setData.attributes.emissiveColor = * ( (TQ3ColorRGB*) data ) ;
-			break;
-			
-		case kQ3AttributeTypeSurfaceShader:
-			if ( setData.attributes.surfaceShader != NULL )
-				Q3Object_Dispose ( setData.attributes.surfaceShader ) ;
-				
-			setData.attributes.surfaceShader = * ( (TQ3SurfaceShaderObject*) data ) ;
-			Q3Shared_GetReference ( setData.attributes.surfaceShader ) ;
-			Q3_ASSERT( Q3Object_IsType ( setData.attributes.surfaceShader,
-				kQ3ShaderTypeSurface ) ) ;
-			break;
+		// Take the new reference before releasing the old one, in case they match
+		TQ3SurfaceShaderObject theShader = * ( (TQ3SurfaceShaderObject*) data ) ;
+		Q3_ASSERT( Q3Object_IsType ( theShader, kQ3ShaderTypeSurface ) ) ;
+		Q3Shared_GetReference ( theShader ) ;
 			
-		default:
-			// Find the element, and replace its data if it exists
-			TQ3ElementObject theElement = e3set_find_element ( & setData , theType ) ;
-			if ( theElement != NULL )
-				{
-				E3ElementInfo* elementClass = (E3ElementInfo*) theElement->GetClass () ;
+		if ( setData.surfaceShader != NULL )
+			Q3Object_Dispose ( setData.surfaceShader ) ;
 				
-				if ( elementClass->elementCopyReplaceMethod != NULL )
-					qd3dStatus = elementClass->elementCopyReplaceMethod ( data, theElement->FindLeafInstanceData () ) ;
-				else
-					{
-					TQ3Uns32 dataSize = elementClass->GetInstanceSize () ;
-					if ( dataSize > 0 )
-						Q3Memory_Copy ( data, theElement->FindLeafInstanceData () , dataSize ) ;
-					qd3dStatus = kQ3Success ;
-					}
+		setData.surfaceShader = theShader ;
+		}
 
-				}
+	else if ( ( theType > kQ3AttributeTypeNone ) && ( theType < kQ3AttributeTypeNumTypes ) )
+		{
+		// Make room for the attribute if it's new, then copy its data
+		TQ3XAttributeMask theMask = e3attribute_type_to_mask ( theType ) ;
+		if ( ( setData.theMask & theMask ) == 0 )
+			qd3dStatus = e3set_attribute_resize ( & setData, setData.theMask | theMask ) ;
+
+		if ( qd3dStatus != kQ3Failure )
+			memcpy ( e3set_attribute_pointer ( & setData, theType ), data, kSetAttributeSizes[ theType ] ) ;
+		}
+
+	else
+		{
+		// Find the element, and replace its data if it exists
+		TQ3ElementObject theElement = e3set_find_element ( & setData , theType ) ;
+		if ( theElement != NULL )
+			{
+			E3ElementInfo* elementClass = (E3ElementInfo*) theElement->GetClass () ;
+			
+			if ( elementClass->elementCopyReplaceMethod != NULL )
+				qd3dStatus = elementClass->elementCopyReplaceMethod ( data, theElement->FindLeafInstanceData () ) ;
 			else
 				{
-				// We don't have an existing element, so instantiate a new one
-				theElement = E3ClassTree::CreateInstance ( theType, kQ3False, data ) ;
-				if ( theElement == NULL )
-					return kQ3Failure ;
-
-				// And add it to the set
-				qd3dStatus = e3set_add_element ( & setData , theType, theElement ) ;
+				TQ3Uns32 dataSize = elementClass->GetInstanceSize () ;
+				if ( dataSize > 0 )
+					Q3Memory_Copy ( data, theElement->FindLeafInstanceData () , dataSize ) ;
+				qd3dStatus = kQ3Success ;
 				}
-			break;
+
+			}
+		else
+			{
+			// We don't have an existing element, so instantiate a new one
+			theElement = E3ClassTree::CreateInstance ( theType, kQ3False, data ) ;
+			if ( theElement == NULL )
+				return kQ3Failure ;
+
+			// And add it to the set
+			qd3dStatus = e3set_add_element ( & setData , theType, theElement ) ;
+			}
 		}
 
 
@@ -2035,7 +2380,6 @@ E3Set::Add ( TQ3ElementType theType, const void *data )
 
 
 
-
 //=============================================================================
 //      E3Set_Get : Get the data for an element in a set.
 //-----------------------------------------------------------------------------
@@ -2048,78 +2392,48 @@ E3Set::Get ( TQ3ElementType theType, void *data )
 		theType = E3Attribute_ClassToAttributeType ( theType ) ;
 
 	if ( ( theType > kQ3AttributeTypeNone ) && ( theType < kQ3AttributeTypeNumTypes ) )
+		{
 		if ( ( setData.theMask & e3attribute_type_to_mask(theType) ) == 0 )
 			return kQ3Failure ;
-			
-	switch ( theType )
-		{
-		case kQ3AttributeTypeSurfaceUV:
-			* ( (TQ3Param2D*) data ) = setData.attributes.surfaceUV ;
-			break;
-		case kQ3AttributeTypeShadingUV:
-			* ( (TQ3Param2D*) data ) = setData.attributes.shadingUV ;
-			break;
-		case kQ3AttributeTypeNormal:
-			* ( (TQ3Vector3D*) data ) = setData.attributes.normal ;
-			break;
-		case kQ3AttributeTypeAmbientCoefficient:
-			* ( (float*) data ) = setData.attributes.ambientCoeficient ;
-			break;
-		case kQ3AttributeTypeDiffuseColor:
-			* ( (TQ3ColorRGB*) data ) = setData.attributes.diffuseColor ;
-			break;
-		case kQ3AttributeTypeSpecularColor:
-			* ( (TQ3ColorRGB*) data ) = setData.attributes.specularColor ;
-			break;
-		case kQ3AttributeTypeSpecularControl:
-			* ( (float*) data ) = setData.attributes.specularControl ;
-			break;
-		case kQ3AttributeTypeTransparencyColor:
-			* ( (TQ3ColorRGB*) data ) = setData.attributes.transparencyColor ;
-			break;
-		case kQ3AttributeTypeEmissiveColor:
-			* ( (TQ3ColorRGB*) data ) = setData.attributes.emissiveColor ;
-			break;
-		case kQ3AttributeTypeSurfaceTangent:
-			* ( (TQ3Tangent2D*) data ) = setData.attributes.surfaceTangent ;
-			break;
-		case kQ3AttributeTypeHighlightState:
-			* ( (TQ3Switch*) data ) = setData.attributes.highlightState ;
-			break;
-		case kQ3AttributeTypeSurfaceShader:
+
+		if ( theType == kQ3AttributeTypeSurfaceShader )
 			* ( (TQ3SurfaceShaderObject*) data ) =
-				((E3Shared*)setData.attributes.surfaceShader)->GetReference();
-			break;
-		default:
+				((E3Shared*)setData.surfaceShader)->GetReference();
+		else
+			memcpy ( data, e3set_attribute_pointer ( & setData, theType ), kSetAttributeSizes[ theType ] ) ;
 
-			// Get the size and pointer for the data for the element
-			TQ3ElementObject theElement = e3set_find_element ( & setData , theType ) ;
-			if ( theElement == NULL )
-				return kQ3Failure ;
-				
-			E3ElementInfo* elementClass = (E3ElementInfo*) theElement->GetClass () ;
+		return kQ3Success ;
+		}
 
-			if ( elementClass == NULL )
-				return kQ3Failure ;
-				
-			TQ3Uns32 dataSize = elementClass->GetInstanceSize () ;
 
 
-			// If there's nothing to copy, bail. It is OK for dataSize to be 0, as the
-			// mere presence of an attribute can itself carry information.
-			if ( dataSize == 0 )
-				return kQ3Success ;
+	// Get the size and pointer for the data for the element
+	TQ3ElementObject theElement = e3set_find_element ( & setData , theType ) ;
+	if ( theElement == NULL )
+		return kQ3Failure ;
+		
+	E3ElementInfo* elementClass = (E3ElementInfo*) theElement->GetClass () ;
 
+	if ( elementClass == NULL )
+		return kQ3Failure ;
+		
+	TQ3Uns32 dataSize = elementClass->GetInstanceSize () ;
 
 
-			// Copy the element data
-			if ( elementClass->elementCopyGetMethod != NULL )
-				qd3dStatus = elementClass->elementCopyGetMethod ( theElement->FindLeafInstanceData () , (void*) data ) ;
-			else
-				{
-				Q3Memory_Copy ( theElement->FindLeafInstanceData () , data, dataSize ) ;
-				qd3dStatus = kQ3Success ;
-				}
+	// If there's nothing to copy, bail. It is OK for dataSize to be 0, as the
+	// mere presence of an attribute can itself carry information.
+	if ( dataSize == 0 )
+		return kQ3Success ;
+
+
+
+	// Copy the element data
+	if ( elementClass->elementCopyGetMethod != NULL )
+		qd3dStatus = elementClass->elementCopyGetMethod ( theElement->FindLeafInstanceData () , (void*) data ) ;
+	else
+		{
+		Q3Memory_Copy ( theElement->FindLeafInstanceData () , data, dataSize ) ;
+		qd3dStatus = kQ3Success ;
 		}
 	
 	return qd3dStatus ;
@@ -2128,7 +2442,6 @@ E3Set::Get ( TQ3ElementType theType, void *data )
 
 
 
-
 //=============================================================================
 //      E3Set_CopyElement : Copy an element from one set to another
 //-----------------------------------------------------------------------------
@@ -2145,71 +2458,57 @@ E3Set::CopyElement ( TQ3ElementType theType, TQ3SetObject destSet )
 		theType = E3Attribute_ClassToAttributeType ( theType ) ;
 
 	if ( ( theType  > kQ3AttributeTypeNone ) && ( theType < kQ3AttributeTypeNumTypes ) )
-		if ( ( srcSet->setData.theMask & e3attribute_type_to_mask(theType) ) == 0 )
+		{
+		TQ3XAttributeMask theMask = e3attribute_type_to_mask ( theType ) ;
+		if ( ( srcSet->setData.theMask & theMask ) == 0 )
 			return kQ3Failure ;
+
+		if ( theType == kQ3AttributeTypeSurfaceShader )
+			{
+			TQ3SurfaceShaderObject theShader =
+				((E3Shared*)srcSet->setData.surfaceShader)->GetReference();
+			if ( dstSet->setData.surfaceShader != NULL )
+				Q3Object_Dispose ( dstSet->setData.surfaceShader ) ;
+			dstSet->setData.surfaceShader = theShader ;
+			dstSet->setData.theMask      |= theMask ;
+			}
+		else
+			{
+			if ( ( dstSet->setData.theMask & theMask ) == 0 )
+				qd3dStatus = e3set_attribute_resize ( & dstSet->setData, dstSet->setData.theMask | theMask ) ;
 			
-	switch ( theType )
-		{
-		case kQ3AttributeTypeSurfaceUV:
-			dstSet->setData.attributes.surfaceUV = srcSet->setData.attributes.surfaceUV ;
-			break;
-		case kQ3AttributeTypeShadingUV:
-			dstSet->setData.attributes.shadingUV = srcSet->setData.attributes.shadingUV ;
-			break;
-		case kQ3AttributeTypeNormal:
-			dstSet->setData.attributes.normal = srcSet->setData.attributes.normal ;
-			break;
-		case kQ3AttributeTypeAmbientCoefficient:
-			dstSet->setData.attributes.ambientCoeficient = srcSet->setData.attributes.ambientCoeficient ;
-			break;
-		case kQ3AttributeTypeDiffuseColor:
-			dstSet->setData.attributes.diffuseColor = srcSet->setData.attributes.diffuseColor ;
-			break;
-		case kQ3AttributeTypeSpecularColor:
-			dstSet->setData.attributes.specularColor = srcSet->setData.attributes.specularColor ;
-			break;
-		case kQ3AttributeTypeSpecularControl:
-			dstSet->setData.attributes.specularControl = srcSet->setData.attributes.specularControl ;
-			break;
-		case kQ3AttributeTypeTransparencyColor:
-			dstSet->setData.attributes.transparencyColor = srcSet->setData.attributes.transparencyColor ;
-			break;
-		case kQ3AttributeTypeEmissiveColor:
-			dstSet->setData.attributes.emissiveColor = srcSet->setData.attributes.emissiveColor ;
-			break;
-		case kQ3AttributeTypeSurfaceTangent:
-			dstSet->setData.attributes.surfaceTangent = srcSet->setData.attributes.surfaceTangent ;
-			break;
-		case kQ3AttributeTypeHighlightState:
-			dstSet->setData.attributes.highlightState = srcSet->setData.attributes.highlightState ;
-			break;
-		case kQ3AttributeTypeSurfaceShader:
-			if ( dstSet->setData.attributes.surfaceShader != NULL )
-				Q3Object_Dispose ( dstSet->setData.attributes.surfaceShader ) ;
-			dstSet->setData.attributes.surfaceShader =
-				((E3Shared*)srcSet->setData.attributes.surfaceShader)->GetReference();
-			break;
-		default:
+			if ( qd3dStatus != kQ3Failure )
+				memcpy ( e3set_attribute_pointer ( & dstSet->setData, theType ),
+						 e3set_attribute_pointer ( & srcSet->setData, theType ),
+						 kSetAttributeSizes[ theType ] ) ;
+			}
 
-			// Find the element to copy
-			TQ3ElementObject srcElement = e3set_find_element ( & srcSet->setData, theType ) ;
-			if ( srcElement == NULL )
-				return kQ3Failure ;
+		if ( qd3dStatus != kQ3Failure )
+			Q3Shared_Edited ( dstSet ) ;
 
+		return qd3dStatus ;
+		}
 
 
-			// If the destination has an element of this type, remove it
-			( (E3Set*) destSet )->Clear ( theType ) ;
 
+	// Find the element to copy
+	TQ3ElementObject srcElement = e3set_find_element ( & srcSet->setData, theType ) ;
+	if ( srcElement == NULL )
+		return kQ3Failure ;
 
 
-			// Duplicate the element, and add it to the set
-			TQ3ElementObject dstElement = Q3Object_Duplicate ( srcElement ) ;
-			if ( dstElement != NULL )
-				qd3dStatus = e3set_add_element ( & dstSet->setData, theType, dstElement ) ;
-			else
-				qd3dStatus = kQ3Failure ;
-			}
+
+	// If the destination has an element of this type, remove it
+	( (E3Set*) destSet )->Clear ( theType ) ;
+
+
+
+	// Duplicate the element, and add it to the set
+	TQ3ElementObject dstElement = Q3Object_Duplicate ( srcElement ) ;
+	if ( dstElement != NULL )
+		qd3dStatus = e3set_add_element ( & dstSet->setData, theType, dstElement ) ;
+	else
+		qd3dStatus = kQ3Failure ;
 			
 	return qd3dStatus ;
 	}
@@ -2217,7 +2516,6 @@ E3Set::CopyElement ( TQ3ElementType theType, TQ3SetObject destSet )
 
 
 
-
 //=============================================================================
 //      E3Set_Contains : Does a set contain an element?
 //-----------------------------------------------------------------------------
@@ -2253,14 +2551,19 @@ E3Set::Clear ( TQ3ElementType theType )
 
 	if ( ( theType  > kQ3AttributeTypeNone ) && (theType < kQ3AttributeTypeNumTypes ) )
 		{
-		if ( ( setData.theMask & e3attribute_type_to_mask(theType) ) == 0 )
+		TQ3XAttributeMask theMask = e3attribute_type_to_mask ( theType ) ;
+		if ( ( setData.theMask & theMask ) == 0 )
 			return kQ3Failure ;
 			
 		if ( theType == kQ3AttributeTypeSurfaceShader )
-			Q3Object_CleanDispose ( & setData.attributes.surfaceShader ) ;
+			{
+			Q3Object_CleanDispose ( & setData.surfaceShader ) ;
+			setData.theMask &= ~theMask ;
+			}
+		else if ( e3set_attribute_resize ( & setData, setData.theMask & ~theMask ) == kQ3Failure )
+			return kQ3Failure ;
 
 		Q3Shared_Edited ( this ) ;
-		setData.theMask &= ~e3attribute_type_to_mask(theType) ;
 		return kQ3Success ;
 		}
 
@@ -2279,19 +2582,21 @@ E3Set::Clear ( TQ3ElementType theType )
 
 
 
-
 //=============================================================================
 //      E3Set_Empty : Remove everything from a set.
 //-----------------------------------------------------------------------------
 TQ3Status
 E3Set::Empty ( void )
 	{
-	if ( setData.attributes.surfaceShader != NULL )
+	if ( setData.surfaceShader != NULL )
 		{
-		Q3Object_Dispose ( setData.attributes.surfaceShader ) ;
-		setData.attributes.surfaceShader = NULL ;
+		Q3Object_Dispose ( setData.surfaceShader ) ;
+		setData.surfaceShader = NULL ;
 		}
 
+	if ( setData.attributeSpill != NULL )
+		Q3Memory_Free ( & setData.attributeSpill ) ;
+
 	// Remove the elements from the set
 	if ( setData.theTable != NULL )
 		{
@@ -2309,7 +2614,6 @@ E3Set::Empty ( void )
 
 
 
-
 //=============================================================================
 //      E3Set_GetNextElementType : Get the next element type in a set.
 //-----------------------------------------------------------------------------
@@ -2351,49 +2655,33 @@ E3Set::SubmitElements ( TQ3ViewObject inView )
 	{
 	TQ3Status qd3dStatus = kQ3Success ;
 
-	// Submit the elements in the set
-
-	if ( setData.theMask != kQ3XAttributeMaskNone )
+	// Submit the built-in attributes in the set. Other than when writing, they
+	// only change the view state, so we can apply them in one step.
+	TQ3XAttributeMask builtInMask = ( setData.theMask & ~kQ3XAttributeMaskCustomAttribute ) ;
+	if ( builtInMask != kQ3XAttributeMaskNone )
 		{
-		TQ3XAttributeMask mask = setData.theMask ;
-		if ( ( ( mask & kQ3XAttributeMaskSurfaceUV ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeSurfaceUV, &setData.attributes.surfaceUV ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskShadingUV ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeShadingUV, &setData.attributes.shadingUV ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskNormal ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeNormal, &setData.attributes.normal ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskAmbientCoefficient ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeAmbientCoefficient, &setData.attributes.ambientCoeficient ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskDiffuseColor ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeDiffuseColor, &setData.attributes.diffuseColor ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskSpecularColor ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeSpecularColor, &setData.attributes.specularColor ) ;
+		const void* attributeData[ kQ3AttributeTypeNumTypes ] ;
+		TQ3Boolean  isWriting = (TQ3Boolean) ( E3View_GetViewMode ( inView ) == kQ3ViewModeWriting ) ;
 
-		if ( ( ( mask & kQ3XAttributeMaskSpecularControl ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeSpecularControl, &setData.attributes.specularControl ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskTransparencyColor ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeTransparencyColor, &setData.attributes.transparencyColor ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskEmissiveColor ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeEmissiveColor, &setData.attributes.emissiveColor ) ;
-
-		if ( ( ( mask & kQ3XAttributeMaskSurfaceTangent ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeSurfaceTangent, &setData.attributes.surfaceTangent ) ;
+		for ( TQ3Uns32 theType = kQ3AttributeTypeSurfaceUV ;
+			  ( theType < kQ3AttributeTypeNumTypes ) && ( qd3dStatus == kQ3Success ) ; ++theType )
+			{
+			if ( ( builtInMask & e3attribute_type_to_mask(theType) ) == 0 )
+				continue ;
+				
+			attributeData[ theType ] = e3set_attribute_pointer ( & setData, theType ) ;
+			if ( isWriting )
+				qd3dStatus = E3View_SubmitImmediate ( inView, E3Attribute_AttributeToClassType ( theType ),
+								attributeData[ theType ] ) ;
+			}
 
-		if ( ( ( mask & kQ3XAttributeMaskHighlightState ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeHighlightState, &setData.attributes.highlightState ) ;
+		if ( ! isWriting )
+			qd3dStatus = E3View_State_SetAttributes ( inView, builtInMask, attributeData ) ;
+		}
 
-		if ( ( ( mask & kQ3XAttributeMaskSurfaceShader ) != 0 ) && ( qd3dStatus == kQ3Success ) )
-			qd3dStatus = E3View_SubmitImmediate ( inView, kQ3ObjectTypeAttributeSurfaceShader, &setData.attributes.surfaceShader ) ;
 
-		}
 
+	// Submit the custom elements
 	if ( ( setData.theTable != NULL ) && ( qd3dStatus == kQ3Success ) )
 		qd3dStatus = e3set_iterate_elements ( & setData, e3set_iterator_submit, &inView ) ;
 	
@@ -2532,51 +2820,22 @@ E3AttributeSet_GetNextAttributeType(TQ3AttributeSet theSet, TQ3AttributeType *th
 	if ( *theType == kQ3ElementTypeNone )
 		{
 		// Reset our state from any previous scan 
-		set->setData.scanEditIndex = editIndex ;
-		set->setData.scanCount     = 0 ;
-		set->setData.scanIndex     = 0 ;
-		Q3Memory_Free(& set->setData.scanResults) ;
+		e3set_scan_free ( & set->setData ) ;
+
+		set->setData.scanState = (TQ3SetScanState *) Q3Memory_AllocateClear ( sizeof ( TQ3SetScanState ) ) ;
+		if ( set->setData.scanState == NULL )
+			return kQ3Failure ;
+
+		set->setData.scanState->scanEditIndex = editIndex ;
 		
 		// put in the built-in attributes
 		if ( set->setData.theMask != kQ3XAttributeMaskNone )
 			{
-			TQ3XAttributeMask mask = set->setData.theMask ;
-			if ( ( mask & kQ3XAttributeMaskSurfaceUV ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeSurfaceUV, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskShadingUV ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeShadingUV, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskNormal ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeNormal, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskAmbientCoefficient ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeAmbientCoefficient, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskDiffuseColor ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeDiffuseColor, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskSpecularColor ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeSpecularColor, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskSpecularControl ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeSpecularControl, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskTransparencyColor ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeTransparencyColor, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskSurfaceTangent ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeSurfaceTangent, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskHighlightState ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeHighlightState, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskSurfaceShader ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeSurfaceShader, NULL, NULL ) ;
-
-			if ( ( mask & kQ3XAttributeMaskEmissiveColor ) != 0 )
-				e3set_iterator_scan_types ( & set->setData , kQ3AttributeTypeEmissiveColor, NULL, NULL ) ;
-
+			for ( TQ3Uns32 builtInType = kQ3AttributeTypeSurfaceUV ; builtInType < kQ3AttributeTypeNumTypes ; ++builtInType )
+				{
+				if ( ( set->setData.theMask & e3attribute_type_to_mask(builtInType) ) != 0 )
+					e3set_iterator_scan_types ( & set->setData , builtInType, NULL, NULL ) ;
+				}
 			}
 
 		// Build the array of types in the set
@@ -2588,12 +2847,10 @@ E3AttributeSet_GetNextAttributeType(TQ3AttributeSet theSet, TQ3AttributeType *th
 	// Continue a previous scan
 	else
 		{
-		// If we've been edited, stop the scan
-		if ( editIndex != set->setData.scanEditIndex )
+		// If we've finished or been edited, stop the scan
+		if ( set->setData.scanState == NULL || editIndex != set->setData.scanState->scanEditIndex )
 			{
-			set->setData.scanCount     = 0 ;
-			set->setData.scanIndex     = 0 ;
-			Q3Memory_Free(&set->setData.scanResults) ;
+			e3set_scan_free ( & set->setData ) ;
 
 			*theType = kQ3ElementTypeNone ;
 			return kQ3Success ;
@@ -2603,12 +2860,14 @@ E3AttributeSet_GetNextAttributeType(TQ3AttributeSet theSet, TQ3AttributeType *th
 
 
 	// Return the next type in the set
-	if ( set->setData.scanIndex < set->setData.scanCount )
+	TQ3SetScanState* scanState = set->setData.scanState ;
+
+	if ( scanState->scanIndex < scanState->scanCount )
 		{
-		Q3_ASSERT_VALID_PTR(set->setData.scanResults) ;
+		Q3_ASSERT_VALID_PTR(scanState->scanResults) ;
 		
-		*theType = set->setData.scanResults [ set->setData.scanIndex ] ;
-		set->setData.scanIndex++ ;
+		*theType = scanState->scanResults [ scanState->scanIndex ] ;
+		scanState->scanIndex++ ;
 		}
 	else
 		{
@@ -2618,12 +2877,8 @@ E3AttributeSet_GetNextAttributeType(TQ3AttributeSet theSet, TQ3AttributeType *th
 
 
 	// If that was the last type, clean up
-	if ( set->setData.scanIndex == set->setData.scanCount )
-		{
-		set->setData.scanCount     = 0 ;
-		set->setData.scanIndex     = 0 ;
-		Q3Memory_Free(&set->setData.scanResults) ;
-		}
+	if ( scanState->scanIndex == scanState->scanCount )
+		e3set_scan_free ( & set->setData ) ;
 	
 	return kQ3Success ;
 	}
@@ -2718,14 +2973,13 @@ E3AttributeSet_Inherit(TQ3AttributeSet parent, TQ3AttributeSet child, TQ3Attribu
 		
 		if ( qd3dStatus != kQ3Failure )
 			{
-			// Copy the mask and attributes directly
-			resultSet->setData.theMask = temp->setData.theMask ;
-			resultSet->setData.attributes = temp->setData.attributes ;
-			if ( resultSet->setData.attributes.surfaceShader != NULL )
-				resultSet->setData.attributes.surfaceShader = Q3Shared_GetReference ( temp->setData.attributes.surfaceShader ) ;
+			// Copy the built-in attributes directly
+			qd3dStatus = e3set_attribute_copy ( & temp->setData, & resultSet->setData ) ;
+			if ( temp->setData.surfaceShader != NULL )
+				resultSet->setData.surfaceShader = Q3Shared_GetReference ( temp->setData.surfaceShader ) ;
 
 			// Iterate over any additional elements
-			if ( resultSet->setData.theTable != NULL )
+			if ( ( temp->setData.theTable != NULL ) && ( qd3dStatus == kQ3Success ) )
 				{
 				paramInfo.theResult = parent ;
 				paramInfo.isChild   = kQ3True ;
@@ -2740,102 +2994,88 @@ E3AttributeSet_Inherit(TQ3AttributeSet parent, TQ3AttributeSet child, TQ3Attribu
 		}
 
 
+	// Empty the final attribute set
 	if ( result != child )
 		{
-		// Empty the final attribute set
 		if ( resultSet->Empty () == kQ3Failure )
 			return kQ3Failure ;
-
-
-		// Process the child
-		if ( qd3dStatus == kQ3Success )
-			{
-			// Copy the mask and attributes directly
-			resultSet->setData.theMask    = childSet->setData.theMask ;
-			resultSet->setData.attributes = childSet->setData.attributes ;
-			if ( resultSet->setData.attributes.surfaceShader != NULL )
-				resultSet->setData.attributes.surfaceShader = Q3Shared_GetReference ( childSet->setData.attributes.surfaceShader ) ;
-
-
-
-			// Iterate over any additional elements
-			if ( childSet->setData.theTable != NULL )
-				{
-				paramInfo.theResult = result ;
-				paramInfo.isChild   = kQ3True ;
-				qd3dStatus = e3set_iterate_elements ( & childSet->setData, e3attributeset_iterator_inherit, &paramInfo ) ;
-				}
-			}
 		}
 
 
 
-	// Process the parent
-	if ( qd3dStatus == kQ3Success )
-		{
-		// Copy any attributes which were not defined by the child
-		if ( parentSet->setData.theMask != kQ3XAttributeMaskNone )
-			{
-			// Set theMask to the attributes unique to the parent
-			TQ3XAttributeMask theMask = ~childSet->setData.theMask ;
-			theMask &= parentSet->setData.theMask ;
-
+	// Merge the built-in attributes of the child and parent
+	qd3dStatus = e3set_attribute_inherit ( & parentSet->setData, & childSet->setData, & resultSet->setData ) ;
 
 
-			// Copy those attributes to the result
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskSurfaceUV) )
-				resultSet->setData.attributes.surfaceUV = parentSet->setData.attributes.surfaceUV ;
 
-			if  (E3Bit_IsSet(theMask, kQ3XAttributeMaskShadingUV) )
-				resultSet->setData.attributes.shadingUV = parentSet->setData.attributes.shadingUV ;
+	// Iterate over any additional elements in the child
+	if ( ( result != child ) && ( childSet->setData.theTable != NULL ) && ( qd3dStatus == kQ3Success ) )
+		{
+		paramInfo.theResult = result ;
+		paramInfo.isChild   = kQ3True ;
+		qd3dStatus = e3set_iterate_elements ( & childSet->setData, e3attributeset_iterator_inherit, &paramInfo ) ;
+		}
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskNormal) )
-				resultSet->setData.attributes.normal = parentSet->setData.attributes.normal ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskAmbientCoefficient) )
-				resultSet->setData.attributes.ambientCoeficient = parentSet->setData.attributes.ambientCoeficient ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskDiffuseColor) )
-				resultSet->setData.attributes.diffuseColor = parentSet->setData.attributes.diffuseColor ;
+	// Iterate over any additional elements in the parent
+	if ( ( parentSet->setData.theTable != NULL ) && ( qd3dStatus == kQ3Success ) )
+		{
+		paramInfo.theResult = result ;
+		paramInfo.isChild   = kQ3False ;
+		qd3dStatus          = e3set_iterate_elements ( & parentSet->setData, e3attributeset_iterator_inherit, &paramInfo ) ;
+		}
+	
+	return qd3dStatus ;
+	}
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskSpecularColor) )
-				resultSet->setData.attributes.specularColor = parentSet->setData.attributes.specularColor ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskSpecularControl) )
-				resultSet->setData.attributes.specularControl = parentSet->setData.attributes.specularControl ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskTransparencyColor) )
-				resultSet->setData.attributes.transparencyColor = parentSet->setData.attributes.transparencyColor ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskSurfaceTangent) )
-				resultSet->setData.attributes.surfaceTangent = parentSet->setData.attributes.surfaceTangent ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskHighlightState) )
-				resultSet->setData.attributes.highlightState = parentSet->setData.attributes.highlightState ;
+//=============================================================================
+//      E3AttributeSet_AddAttributes : Add several built-in attributes.
+//-----------------------------------------------------------------------------
+//		Note :	attributeData is indexed by attribute type, and only the types
+//				in theMask are read. The set is laid out and edited once.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3AttributeSet_AddAttributes(TQ3AttributeSet theSet, TQ3XAttributeMask theMask, const void *const *attributeData)
+	{
+	E3Set* set = (E3Set*) theSet ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskSurfaceShader) )
-				resultSet->setData.attributes.surfaceShader = Q3Shared_GetReference(parentSet->setData.attributes.surfaceShader ) ;
 
-			if ( E3Bit_IsSet(theMask, kQ3XAttributeMaskEmissiveColor) )
-				resultSet->setData.attributes.emissiveColor = parentSet->setData.attributes.emissiveColor ;
 
+	// Make room for any new attributes
+	theMask &= ~kQ3XAttributeMaskCustomAttribute ;
+	
+	if ( ( set->setData.theMask & theMask ) != theMask )
+		{
+		if ( e3set_attribute_resize ( & set->setData, set->setData.theMask | theMask ) == kQ3Failure )
+			return kQ3Failure ;
+		}
 
-			// Update the mask in the result
-			resultSet->setData.theMask |= theMask ;
-			}
 
 
+	// Copy their data
+	for ( TQ3Uns32 theType = kQ3AttributeTypeSurfaceUV ; theType < kQ3AttributeTypeNumTypes ; ++theType )
+		{
+		if ( ( theMask & e3attribute_type_to_mask(theType) ) == 0 )
+			continue ;
 
-		// Iterate over any additional elements
-		if  (parentSet->setData.theTable != NULL )
+		if ( theType == kQ3AttributeTypeSurfaceShader )
 			{
-			paramInfo.theResult = result ;
-			paramInfo.isChild   = kQ3False ;
-			qd3dStatus          = e3set_iterate_elements ( & parentSet->setData, e3attributeset_iterator_inherit, &paramInfo ) ;
+			TQ3SurfaceShaderObject theShader = * ( (const TQ3SurfaceShaderObject*) attributeData[ theType ] ) ;
+			E3Shared_Replace ( & set->setData.surfaceShader, theShader ) ;
 			}
+		else
+			memcpy ( e3set_attribute_pointer ( & set->setData, theType ), attributeData[ theType ],
+					 kSetAttributeSizes[ theType ] ) ;
 		}
+
+	Q3Shared_Edited ( theSet ) ;
 	
-	return qd3dStatus ;
+	return kQ3Success ;
 	}
 
 
@@ -2963,6 +3203,9 @@ E3XAttributeClass_Register(TQ3AttributeType *attributeType, const char *creatorN
 //			access to the internal data of custom attributes as well: renderers
 //			may well want to register their own custom attributes for apps and
 //			still get fast access to them during a rendering loop.
+//
+//			Built-in attributes are packed, so the pointer is only valid until
+//			attributes are next added to or removed from the set.
 //-----------------------------------------------------------------------------
 void *
 E3XAttributeSet_GetPointer(TQ3AttributeSet attributeSet, TQ3AttributeType attributeType)
@@ -2972,57 +3215,9 @@ E3XAttributeSet_GetPointer(TQ3AttributeSet attributeSet, TQ3AttributeType attrib
 	
 	Q3_REQUIRE_OR_RESULT(Q3_VALID_PTR(attributeSet),   NULL);
 	
-	switch (attributeType)
-		{
-		case kQ3AttributeTypeSurfaceUV:
-			data = ( set->setData.theMask & kQ3XAttributeMaskSurfaceUV ) == 0 ?
-					NULL : &set->setData.attributes.surfaceUV ;
-			break;
-		case kQ3AttributeTypeShadingUV:
-			data = ( set->setData.theMask & kQ3XAttributeMaskShadingUV ) == 0 ?
-					NULL : &set->setData.attributes.shadingUV ;
-			break;
-		case kQ3AttributeTypeNormal:
-			data = ( set->setData.theMask & kQ3XAttributeMaskNormal ) == 0 ?
-					NULL : &set->setData.attributes.normal ;
-			break;
-		case kQ3AttributeTypeAmbientCoefficient:
-			data = ( set->setData.theMask & kQ3XAttributeMaskAmbientCoefficient ) == 0 ?
-					NULL : &set->setData.attributes.ambientCoeficient ;
-			break;
-		case kQ3AttributeTypeDiffuseColor:
-			data = ( set->setData.theMask & kQ3XAttributeMaskDiffuseColor ) == 0 ?
-					NULL : &set->setData.attributes.diffuseColor ;
-			break;
-		case kQ3AttributeTypeSpecularColor:
-			data = ( set->setData.theMask & kQ3XAttributeMaskSpecularColor ) == 0 ?
-					NULL : &set->setData.attributes.specularColor ;
-			break;
-		case kQ3AttributeTypeSpecularControl:
-			data = ( set->setData.theMask & kQ3XAttributeMaskSpecularControl ) == 0 ?
-					NULL : &set->setData.attributes.specularControl ;
-			break;
-		case kQ3AttributeTypeTransparencyColor:
-			data = ( set->setData.theMask & kQ3XAttributeMaskTransparencyColor ) == 0 ?
-					NULL : &set->setData.attributes.transparencyColor ;
-			break;
-		case kQ3AttributeTypeSurfaceTangent:
-			data = ( set->setData.theMask & kQ3XAttributeMaskSurfaceTangent ) == 0 ?
-					NULL : &set->setData.attributes.surfaceTangent ;
-			break;
-		case kQ3AttributeTypeHighlightState:
-			data = ( set->setData.theMask & kQ3XAttributeMaskHighlightState ) == 0 ?
-					NULL : &set->setData.attributes.highlightState;
-			break;
-		case kQ3AttributeTypeSurfaceShader:
-			data = ( set->setData.theMask & kQ3XAttributeMaskSurfaceShader ) == 0 ?
-					NULL : &set->setData.attributes.surfaceShader  ;
-			break;
-		case kQ3AttributeTypeEmissiveColor:
-			data = ( set->setData.theMask & kQ3XAttributeMaskEmissiveColor ) == 0 ?
-					NULL : &set->setData.attributes.emissiveColor ;
-			break;
-		}
+	if ( ( attributeType > kQ3AttributeTypeNone ) && ( attributeType < kQ3AttributeTypeNumTypes ) &&
+		 ( ( set->setData.theMask & e3attribute_type_to_mask(attributeType) ) != 0 ) )
+		data = e3set_attribute_pointer ( & set->setData, attributeType ) ;
 		
 	return data ;
 }
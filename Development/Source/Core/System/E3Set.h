@@ -110,33 +110,35 @@ Q3_CLASS_ENUMS ( kQ3ElementTypeAttribute, E3Attribute, E3Element )
 	
 
 
-// Set attribute data
-typedef struct TQ3SetAttributes {
-	TQ3Vector3D			normal;
-	TQ3Switch			highlightState;
-	TQ3Tangent2D		surfaceTangent;
-	TQ3Param2D 			surfaceUV;
-	TQ3ColorRGB			diffuseColor;
-	float				ambientCoeficient;
-	TQ3ColorRGB			specularColor;
-	float				specularControl;
-	TQ3Param2D 			shadingUV;
-	TQ3SurfaceShaderObject surfaceShader;
-	TQ3ColorRGB			transparencyColor;
-	TQ3ColorRGB			emissiveColor;
-} TQ3SetAttributes;
+// Set attribute storage
+//
+// Built-in attributes other than the surface shader are packed in attribute
+// type order into attributeInline, or into attributeSpill once they no longer
+// fit. attributeOffsets gives the word offset of each attribute in theMask.
+const TQ3Uns32 kQ3SetInlineAttributeWords					= 12;
+const TQ3Uns32 kQ3SetMaxAttributeWords						= 28;
 
 
 
-// Set instance data
-typedef struct TQ3SetData {
-	TQ3SetAttributes	attributes;			// Data for built-in attributes
-	E3HashTablePtr		theTable;			// Elements in set, keyed by type
+// Set scan state
+typedef struct TQ3SetScanState {
 	TQ3Uns32			scanEditIndex;		// Set edit index while scanning
 	TQ3Uns32			scanCount;			// Size of scanResults
 	TQ3Uns32			scanIndex;			// Current index into scanResults
 	TQ3ElementType		*scanResults;		// Scan results
+} TQ3SetScanState;
+
+
+
+// Set instance data
+typedef struct TQ3SetData {
+	TQ3Uns32			attributeInline[kQ3SetInlineAttributeWords];	// Packed built-in attributes
+	TQ3Uns32			*attributeSpill;	// Packed built-in attributes, if too large to be inline
+	TQ3SurfaceShaderObject surfaceShader;	// Surface shader attribute
+	E3HashTablePtr		theTable;			// Custom elements in set, keyed by type
+	TQ3SetScanState		*scanState;			// Scan state, if scanning
 	TQ3XAttributeMask	theMask;			// Attribute mask
+	TQ3Uns8				attributeOffsets[kQ3AttributeTypeNumTypes];	// Word offset of each attribute
 } TQ3SetData;
 
 
@@ -145,6 +147,7 @@ typedef struct TQ3SetData {
 // compilers happy.
 TQ3Status			E3AttributeSet_GetNextAttributeType(TQ3AttributeSet theSet, TQ3AttributeType *theType);
 TQ3Status			E3AttributeSet_Inherit(TQ3AttributeSet parent, TQ3AttributeSet child, TQ3AttributeSet result);
+TQ3Status			E3AttributeSet_AddAttributes(TQ3AttributeSet theSet, TQ3XAttributeMask theMask, const void *const *attributeData);
 void				*E3XAttributeSet_GetPointer(TQ3AttributeSet attributeSet, TQ3AttributeType attributeType);
 TQ3XAttributeMask	E3XAttributeSet_GetMask(TQ3AttributeSet attributeSet);
 
@@ -174,6 +177,7 @@ public :
 
 	friend TQ3Status E3AttributeSet_GetNextAttributeType ( TQ3AttributeSet theSet, TQ3AttributeType *theType ) ;
 	friend TQ3Status E3AttributeSet_Inherit ( TQ3AttributeSet parent, TQ3AttributeSet child, TQ3AttributeSet result ) ;
+	friend TQ3Status E3AttributeSet_AddAttributes ( TQ3AttributeSet theSet, TQ3XAttributeMask theMask, const void *const *attributeData ) ;
 	friend void * E3XAttributeSet_GetPointer ( TQ3AttributeSet attributeSet, TQ3AttributeType attributeType ) ;
 	friend TQ3XAttributeMask E3XAttributeSet_GetMask ( TQ3AttributeSet attributeSet ) ;
 	} ;
@@ -195,6 +199,7 @@ TQ3Status			E3Attribute_Submit(TQ3AttributeType attributeType, const void *attri
 TQ3Status			E3AttributeSet_Submit(TQ3AttributeSet theSet, TQ3ViewObject theView);
 TQ3AttributeSet		E3AttributeSet_New(void);
 TQ3Status			E3AttributeSet_Inherit(TQ3AttributeSet parent, TQ3AttributeSet child, TQ3AttributeSet result);
+TQ3Status			E3AttributeSet_AddAttributes(TQ3AttributeSet theSet, TQ3XAttributeMask theMask, const void *const *attributeData);
 
 TQ3XObjectClass		E3XElementClass_Register(TQ3ElementType *elementType, const char *name, TQ3Uns32 sizeOfElement, TQ3XMetaHandler metaHandler);
 TQ3Status			E3XElementType_GetElementSize(TQ3ElementType elementType, TQ3Uns32 *sizeOfElement);
@@ -48,6 +48,10 @@
 
 #include <stdio.h>
 
+#if QUESA_OS_UNIX || (QUESA_OS_MACINTOSH && !TARGET_API_MAC_OS8)
+	#include <sys/types.h>
+#endif
+
 
 
 
@@ -57,6 +61,7 @@
 //-----------------------------------------------------------------------------
 #define kE3MemoryStorageDefaultGrowSize					1024
 #define kE3MemoryStorageMinimumGrowSize					32
+#define kE3PathStorageReadBufferSize					(256 * 1024)
 
 
 
@@ -75,7 +80,10 @@ E3StorageInfo::E3StorageInfo	(
 		: E3SharedInfo ( newClassMetaHandler, newParent ) ,
 		getData_Method		( (TQ3XStorageReadDataMethod)		Find_Method ( kQ3XMethodTypeStorageReadData ) ) ,
 		setData_Method		( (TQ3XStorageWriteDataMethod)		Find_Method ( kQ3XMethodTypeStorageWriteData ) ) ,
-		getEOF_Method		( (TQ3XStorageGetSizeMethod)		Find_Method ( kQ3XMethodTypeStorageGetSize ) )	
+		getEOF_Method		( (TQ3XStorageGetSizeMethod)		Find_Method ( kQ3XMethodTypeStorageGetSize ) ) ,
+		getData64_Method	( (TQ3XStorageReadData64Method)		Find_Method ( kQ3XMethodTypeStorageReadData64 ) ) ,
+		setData64_Method	( (TQ3XStorageWriteData64Method)	Find_Method ( kQ3XMethodTypeStorageWriteData64 ) ) ,
+		getEOF64_Method		( (TQ3XStorageGetSize64Method)		Find_Method ( kQ3XMethodTypeStorageGetSize64 ) )
 		 	 
 	{
 	if ( getData_Method == NULL
@@ -101,6 +109,95 @@ e3storage_new_class_info (
 
 
 
+//=============================================================================
+//      e3storage_file_seek : Seek to an absolute position in a file.
+//-----------------------------------------------------------------------------
+//		Note :	On 32-bit Unix builds, positions past 2Gb also need the
+//				library to be built with _FILE_OFFSET_BITS=64.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_file_seek ( FILE* theFile, TQ3StorageOffset offset )
+	{
+#if QUESA_OS_WIN32 && defined(_MSC_VER)
+	if ( _fseeki64 ( theFile, (__int64) offset, SEEK_SET ) )
+		return kQ3Failure ;
+
+#elif QUESA_OS_UNIX || (QUESA_OS_MACINTOSH && !TARGET_API_MAC_OS8)
+	if ( (TQ3StorageOffset) (off_t) offset != offset )
+		return kQ3Failure ;
+
+	if ( fseeko ( theFile, (off_t) offset, SEEK_SET ) )
+		return kQ3Failure ;
+
+#else
+	if ( (TQ3StorageOffset) (long) offset != offset )
+		return kQ3Failure ;
+
+	if ( fseek ( theFile, (long) offset, SEEK_SET ) )
+		return kQ3Failure ;
+#endif
+
+	return kQ3Success ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3storage_file_getsize : Get the size of a file.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_file_getsize ( FILE* theFile, TQ3StorageOffset* size )
+	{
+	fpos_t					oldPos;
+
+
+
+	// Get the current position in the file
+	if ( fgetpos ( theFile, &oldPos ) )
+		return kQ3Failure ;
+
+
+
+	// Seek to the end and get the position there
+#if QUESA_OS_WIN32 && defined(_MSC_VER)
+	if ( _fseeki64 ( theFile, 0, SEEK_END ) )
+		return kQ3Failure ;
+
+	__int64 endPos = _ftelli64 ( theFile ) ;
+
+#elif QUESA_OS_UNIX || (QUESA_OS_MACINTOSH && !TARGET_API_MAC_OS8)
+	if ( fseeko ( theFile, 0, SEEK_END ) )
+		return kQ3Failure ;
+
+	off_t endPos = ftello ( theFile ) ;
+
+#else
+	if ( fseek ( theFile, 0, SEEK_END ) )
+		return kQ3Failure ;
+
+	long endPos = ftell ( theFile ) ;
+#endif
+
+	if ( endPos < 0 )
+		return kQ3Failure ;
+
+	*size = (TQ3StorageOffset) endPos ;
+
+
+
+	// Restore the previous position in the file
+	if ( fsetpos ( theFile, &oldPos ) )
+		return kQ3Failure ;
+
+	return kQ3Success ;
+	}
+
+
+
+
+
 //=============================================================================
 //      e3storage_memory_read : Read data from the storage object.
 //-----------------------------------------------------------------------------
@@ -465,6 +562,8 @@ e3storage_path_delete(TQ3Object storage, void *privateData)
 	// Dispose of our instance data
 	if (instanceData->thePath != NULL)
 		Q3Memory_Free(&instanceData->thePath);
+
+	Q3Memory_Free(&instanceData->readBuffer);
 }
 
 
@@ -513,10 +612,13 @@ e3storage_path_close ( E3PathStorage* storage )
 
 
 
-	// Close the file		
+	// Close the file, and release our read buffer
 	fclose ( storage->pathDetails.theFile ) ;
 	storage->pathDetails.theFile = NULL ;
 
+	Q3Memory_Free ( & storage->pathDetails.readBuffer ) ;
+	storage->pathDetails.bufferValid = 0 ;
+
 	return kQ3Success ;
 	}
 
@@ -525,15 +627,11 @@ e3storage_path_close ( E3PathStorage* storage )
 
 
 //=============================================================================
-//      e3storage_path_getsize : Get the size of the storage object.
+//      e3storage_path_getsize64 : Get the size of the storage object.
 //-----------------------------------------------------------------------------
 TQ3Status
-e3storage_path_getsize ( E3PathStorage* storage, TQ3Uns32 *size )
+e3storage_path_getsize64 ( E3PathStorage* storage, TQ3StorageOffset *size )
 	{
-	fpos_t					oldPos;
-
-
-
 	// Make sure the file is open
 	if ( storage->pathDetails.theFile == NULL )
 		{
@@ -541,31 +639,32 @@ e3storage_path_getsize ( E3PathStorage* storage, TQ3Uns32 *size )
 		return kQ3Failure ;
 		}
 
+	return e3storage_file_getsize ( storage->pathDetails.theFile, size ) ;
+	}
 
 
-	// Get the current position in the file
-	if ( fgetpos ( storage->pathDetails.theFile, &oldPos ) )
-		return kQ3Failure ;
-
 
 
-	// Seek to the end and get the position there. Not that using ftell rather
-	// than fgetpos limits us to 2147483647 byte files, but casting an fpos_t
-	// to a 32-bit integer is not valid on some Unix systems.
-	if ( fseek ( storage->pathDetails.theFile, 0, SEEK_END ) )
-		return kQ3Failure ;
 
-	*size = (TQ3Uns32) ftell ( storage->pathDetails.theFile ) ;
+//=============================================================================
+//      e3storage_path_getsize : Get the size of the storage object.
+//-----------------------------------------------------------------------------
+TQ3Status
+e3storage_path_getsize ( E3PathStorage* storage, TQ3Uns32 *size )
+	{
+	TQ3StorageOffset		theSize;
 
-	if ( fseek ( storage->pathDetails.theFile, 0, SEEK_SET ) )
-		return kQ3Failure ;
 
 
+	// Get the size, failing if it can't be expressed in 32 bits
+	if ( e3storage_path_getsize64 ( storage, &theSize ) == kQ3Failure )
+		return kQ3Failure ;
 
-	// Restore the previous position in the file
-	if ( fsetpos ( storage->pathDetails.theFile, &oldPos ) )
+	if ( theSize > 0xFFFFFFFFUL )
 		return kQ3Failure ;
 
+	*size = (TQ3Uns32) theSize ;
+
 	return kQ3Success ;
 	}
 
@@ -574,15 +673,24 @@ e3storage_path_getsize ( E3PathStorage* storage, TQ3Uns32 *size )
 
 
 //=============================================================================
-//      e3storage_path_read : Read data from the storage object.
+//      e3storage_path_read64 : Read data from the storage object.
 //-----------------------------------------------------------------------------
-//		Note : Currently unbuffered - may cause performance problems.
+//		Note :	Small reads are served from a read-ahead buffer, which is
+//				refilled with a single fread when a read falls outside it.
+//				Reads at least as large as the buffer bypass it.
 //-----------------------------------------------------------------------------
 TQ3Status
-e3storage_path_read ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead )
+e3storage_path_read64 ( E3PathStorage* storage, TQ3StorageOffset offset, TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead )
 	{
+	TQ3PathStorageData		*pathDetails = & storage->pathDetails ;
+	TQ3Uns32				bytesToCopy;
+
+
+
 	// Make sure the file is open
-	if ( storage->pathDetails.theFile == NULL )
+	*sizeRead = 0 ;
+
+	if ( pathDetails->theFile == NULL )
 		{
 		E3ErrorManager_PostError ( kQ3ErrorFileNotOpen, kQ3False ) ;
 		return kQ3Failure ;
@@ -590,16 +698,57 @@ e3storage_path_read ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize
 
 
 
-	// Seek to the offset, and read the data
-	// (The ftell is needed because in the Windows version of
-	// CodeWarrior's standard library, fseek always flushes the buffer.)
-	if ( (TQ3Int32) offset != ftell ( storage->pathDetails.theFile ) )
+	// Read the data
+	while ( dataSize != 0 )
 		{
-		if ( fseek ( storage->pathDetails.theFile, (long) offset, SEEK_SET ) )
+		// Copy whatever we can from the buffer
+		if ( offset >= pathDetails->bufferOffset &&
+			 offset <  pathDetails->bufferOffset + pathDetails->bufferValid )
+			{
+			bytesToCopy = (TQ3Uns32) ( pathDetails->bufferOffset + pathDetails->bufferValid - offset ) ;
+			if ( bytesToCopy > dataSize )
+				bytesToCopy = dataSize ;
+
+			Q3Memory_Copy ( & pathDetails->readBuffer [ offset - pathDetails->bufferOffset ], data, bytesToCopy ) ;
+
+			offset    += bytesToCopy ;
+			data      += bytesToCopy ;
+			dataSize  -= bytesToCopy ;
+			*sizeRead += bytesToCopy ;
+			continue ;
+			}
+
+
+
+		// Allocate the buffer if this is our first read
+		if ( pathDetails->readBuffer == NULL && dataSize < kE3PathStorageReadBufferSize )
+			pathDetails->readBuffer = (TQ3Uns8 *) Q3Memory_Allocate ( kE3PathStorageReadBufferSize ) ;
+
+
+
+		// Seek to the offset
+		if ( e3storage_file_seek ( pathDetails->theFile, offset ) == kQ3Failure )
 			return kQ3Failure ;
-		}
 
-	*sizeRead = static_cast<TQ3Uns32>(fread ( data, 1, dataSize, storage->pathDetails.theFile ));
+
+
+		// Large reads go straight into the caller's memory
+		if ( dataSize >= kE3PathStorageReadBufferSize || pathDetails->readBuffer == NULL )
+			{
+			*sizeRead += static_cast<TQ3Uns32>(fread ( data, 1, dataSize, pathDetails->theFile ));
+			break ;
+			}
+
+
+
+		// Otherwise refill the buffer, stopping at the end of the file
+		pathDetails->bufferOffset = offset ;
+		pathDetails->bufferValid  = static_cast<TQ3Uns32>(fread ( pathDetails->readBuffer, 1,
+													kE3PathStorageReadBufferSize, pathDetails->theFile ));
+
+		if ( pathDetails->bufferValid == 0 )
+			break ;
+		}
 
 	return kQ3Success ;
 	}
@@ -609,12 +758,25 @@ e3storage_path_read ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize
 
 
 //=============================================================================
-//      e3storage_path_write : Write data to the storage object.
+//      e3storage_path_read : Read data from the storage object.
 //-----------------------------------------------------------------------------
-//		Note : Currently unbuffered - may cause performance problems.
+TQ3Status
+e3storage_path_read ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead )
+	{
+	return e3storage_path_read64 ( storage, offset, dataSize, data, sizeRead ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3storage_path_write64 : Write data to the storage object.
+//-----------------------------------------------------------------------------
+//		Note : Writes are left to the stdio buffer.
 //-----------------------------------------------------------------------------
 TQ3Status
-e3storage_path_write ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten )
+e3storage_path_write64 ( E3PathStorage* storage, TQ3StorageOffset offset, TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten )
 	{
 	// Make sure the file is open
 	if ( storage->pathDetails.theFile == NULL )
@@ -625,8 +787,13 @@ e3storage_path_write ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSiz
 
 
 
+	// Anything we have read ahead may be about to change
+	storage->pathDetails.bufferValid = 0 ;
+
+
+
 	// Seek to the offset, and write the data
-	if ( fseek ( storage->pathDetails.theFile, (long)offset, SEEK_SET ) )
+	if ( e3storage_file_seek ( storage->pathDetails.theFile, offset ) == kQ3Failure )
 		return kQ3Failure ;
 
 	*sizeWritten = static_cast<TQ3Uns32>(fwrite( data, 1, dataSize, storage->pathDetails.theFile ));
@@ -638,6 +805,19 @@ e3storage_path_write ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSiz
 
 
 
+//=============================================================================
+//      e3storage_path_write : Write data to the storage object.
+//-----------------------------------------------------------------------------
+TQ3Status
+e3storage_path_write ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten )
+	{
+	return e3storage_path_write64 ( storage, offset, dataSize, data, sizeWritten ) ;
+	}
+
+
+
+
+
 //=============================================================================
 //      e3storage_path_metahandler : Path storage metahandler.
 //-----------------------------------------------------------------------------
@@ -676,6 +856,18 @@ e3storage_path_metahandler(TQ3XMethodType methodType)
 		case kQ3XMethodTypeStorageWriteData:
 			theMethod = (TQ3XFunctionPointer) e3storage_path_write;
 			break;
+
+		case kQ3XMethodTypeStorageGetSize64:
+			theMethod = (TQ3XFunctionPointer) e3storage_path_getsize64;
+			break;
+
+		case kQ3XMethodTypeStorageReadData64:
+			theMethod = (TQ3XFunctionPointer) e3storage_path_read64;
+			break;
+
+		case kQ3XMethodTypeStorageWriteData64:
+			theMethod = (TQ3XFunctionPointer) e3storage_path_write64;
+			break;
 		}
 	
 	return(theMethod);
@@ -1044,6 +1236,80 @@ E3Storage::SetData ( TQ3Uns32 offset, TQ3Uns32 dataSize, const unsigned char* da
 
 
 
+//=============================================================================
+//      E3Storage::GetSize64 : Return the size of data in a storage object.
+//-----------------------------------------------------------------------------
+//		Note :	Storage classes without 64-bit methods fall back to their
+//				32-bit methods, and so are limited to 4Gb.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Storage::GetSize64 ( TQ3StorageOffset* size )
+	{
+	if ( GetClass ()->getEOF64_Method != NULL )
+		return GetClass ()->getEOF64_Method ( this, size ) ;
+
+	TQ3Uns32 theSize = 0 ;
+	TQ3Status result = GetClass ()->getEOF_Method ( this, &theSize ) ;
+	*size = theSize ;
+
+	return result ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Storage::GetData64 : Return the data in a storage object.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Storage::GetData64 ( TQ3StorageOffset offset, TQ3Uns32 dataSize, unsigned char* data, TQ3Uns32* sizeRead )
+	{
+	if ( GetClass ()->getData64_Method != NULL )
+		return GetClass ()->getData64_Method ( this, offset, dataSize, (TQ3Uns8*) data, sizeRead ) ;
+
+	if ( offset > 0xFFFFFFFFUL )
+		{
+		*sizeRead = 0 ;
+		return kQ3Failure ;
+		}
+
+	return GetClass ()->getData_Method ( this, (TQ3Uns32) offset, dataSize, (TQ3Uns8*) data, sizeRead ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3Storage::SetData64 : Set the data for a storage object.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3Storage::SetData64 ( TQ3StorageOffset offset, TQ3Uns32 dataSize, const unsigned char* data, TQ3Uns32* sizeWritten )
+	{
+	TQ3Status result ;
+
+	if ( GetClass ()->setData64_Method != NULL )
+		result = GetClass ()->setData64_Method ( this, offset, dataSize, (TQ3Uns8*) data, sizeWritten ) ;
+
+	else if ( offset + dataSize > 0xFFFFFFFFUL )
+		{
+		*sizeWritten = 0 ;
+		return kQ3Failure ;
+		}
+
+	else
+		result = GetClass ()->setData_Method ( this, (TQ3Uns32) offset, dataSize, (TQ3Uns8*) data, sizeWritten ) ;
+
+	Edited () ;
+	
+	return result ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3MemoryStorage_GetType : Return the type of a memory storage object.
 //-----------------------------------------------------------------------------
@@ -1290,6 +1556,8 @@ E3PathStorage:: Set( const char *pathName )
 	if ( newPath == NULL )
 		return kQ3Failure ;
 
+	strcpy ( newPath, pathName ) ;
+
 
 
 	// Clean up the instance data
@@ -1299,11 +1567,14 @@ E3PathStorage:: Set( const char *pathName )
 	if ( pathDetails.theFile != NULL )
 		fclose ( pathDetails.theFile ) ;
 
+	Q3Memory_Free ( & pathDetails.readBuffer ) ;
+
 
 
 	// Update the instance data
-	pathDetails.thePath = newPath ;
-	pathDetails.theFile = NULL ;
+	pathDetails.thePath     = newPath ;
+	pathDetails.theFile     = NULL ;
+	pathDetails.bufferValid = 0 ;
 
 	return kQ3Success ;	
 	}
@@ -78,8 +78,11 @@ typedef struct TE3_MemoryStorageData {
 
 // Path storage
 typedef struct TQ3PathStorageData {
-	char		*thePath;
-	FILE		*theFile;
+	char				*thePath;
+	FILE				*theFile;
+	TQ3Uns8				*readBuffer;
+	TQ3StorageOffset	bufferOffset;
+	TQ3Uns32			bufferValid;
 } TQ3PathStorageData;
 
 
@@ -90,6 +93,9 @@ class E3StorageInfo : public E3SharedInfo
 	const TQ3XStorageReadDataMethod		getData_Method ;
 	const TQ3XStorageWriteDataMethod	setData_Method ;
 	const TQ3XStorageGetSizeMethod		getEOF_Method ;
+	const TQ3XStorageReadData64Method	getData64_Method ;
+	const TQ3XStorageWriteData64Method	setData64_Method ;
+	const TQ3XStorageGetSize64Method	getEOF64_Method ;
 	
 public :
 
@@ -120,6 +126,10 @@ public :
 	TQ3Status						GetData ( TQ3Uns32 offset, TQ3Uns32 dataSize, unsigned char* data, TQ3Uns32* sizeRead ) ;
 	TQ3Status						SetData ( TQ3Uns32 offset, TQ3Uns32 dataSize, const unsigned char* data, TQ3Uns32* sizeWritten ) ;
 	
+	TQ3Status						GetSize64 ( TQ3StorageOffset* size ) ;
+	TQ3Status						GetData64 ( TQ3StorageOffset offset, TQ3Uns32 dataSize, unsigned char* data, TQ3Uns32* sizeRead ) ;
+	TQ3Status						SetData64 ( TQ3StorageOffset offset, TQ3Uns32 dataSize, const unsigned char* data, TQ3Uns32* sizeWritten ) ;
+	
 	} ;
 
 
@@ -160,6 +170,9 @@ public :
 	friend TQ3Status			e3storage_path_getsize ( E3PathStorage* storage, TQ3Uns32 *size ) ;
 	friend TQ3Status			e3storage_path_read ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead ) ;
 	friend TQ3Status			e3storage_path_write ( E3PathStorage* storage, TQ3Uns32 offset, TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten ) ;
+	friend TQ3Status			e3storage_path_getsize64 ( E3PathStorage* storage, TQ3StorageOffset *size ) ;
+	friend TQ3Status			e3storage_path_read64 ( E3PathStorage* storage, TQ3StorageOffset offset, TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead ) ;
+	friend TQ3Status			e3storage_path_write64 ( E3PathStorage* storage, TQ3StorageOffset offset, TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten ) ;
 	} ;
 
 
@@ -240,6 +253,8 @@ TQ3Status			E3UnixStorage_UnregisterClass(void);
 TQ3StorageObject	E3UnixPathStorage_New(const char *pathName);
 TQ3Status			E3UnixPathStorage_Set(TQ3StorageObject storage, const char *pathName);
 TQ3Status			E3UnixPathStorage_Get(TQ3StorageObject storage, char *pathName);
+
+TQ3StorageObject	E3UnixMappedStorage_New(const char *pathName);
 #endif
 
 
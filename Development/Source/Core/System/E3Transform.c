@@ -251,7 +251,7 @@ e3transform_matrix_submit(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Ob
 
 
 	// Update the view
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, instanceData);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, instanceData, E3Matrix4x4_GetKind(instanceData));
 
 	return(qd3dStatus);
 }
@@ -337,7 +337,7 @@ e3transform_rotate_submit(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Ob
 	// Convert the transform to a matrix, and update the view
 	e3transform_rotate_matrix(objectData, &theMatrix);
 
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix, kQ3MatrixKindRigid);
 	
 	return(qd3dStatus);
 }
@@ -467,7 +467,7 @@ e3transform_rotateaboutpoint_submit(TQ3ViewObject theView, TQ3ObjectType objectT
 	// Convert the transform to a matrix, and update the view
 	e3transform_rotateaboutpoint_matrix(objectData, &theMatrix);
 
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix, kQ3MatrixKindRigid);
 	
 	return(qd3dStatus);
 }
@@ -542,7 +542,7 @@ e3transform_rotateaboutaxis_submit(TQ3ViewObject theView, TQ3ObjectType objectTy
 	// Convert the transform to a matrix, and update the view
 	e3transform_rotateaboutaxis_matrix(objectData, &theMatrix);
 
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix, kQ3MatrixKindRigid);
 	
 	return(qd3dStatus);
 }
@@ -612,7 +612,7 @@ e3transform_scale_submit(TQ3ViewObject theView, TQ3ObjectType objectType, TQ3Obj
 	// Convert the transform to a matrix, and update the view
 	e3transform_scale_matrix(objectData, &theMatrix);
 
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix, kQ3MatrixKindAffine);
 	
 	return(qd3dStatus);
 }
@@ -682,7 +682,7 @@ e3transform_translate_submit(TQ3ViewObject theView, TQ3ObjectType objectType, TQ
 	// Convert the transform to a matrix, and update the view
 	e3transform_translate_matrix(objectData, &theMatrix);
 
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix, kQ3MatrixKindTranslation);
 	
 	return(qd3dStatus);
 }
@@ -749,10 +749,11 @@ e3transform_quaternion_submit(TQ3ViewObject theView, TQ3ObjectType objectType, T
 
 
 
-	// Convert the transform to a matrix, and update the view
+	// Convert the transform to a matrix, and update the view. The quaternion
+	// need not be normalised, so its matrix may include a scale.
 	e3transform_quaternion_matrix(objectData, &theMatrix);
 
-	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix);
+	qd3dStatus = E3View_State_AddMatrixLocalToWorld(theView, &theMatrix, kQ3MatrixKindAffine);
 	
 	return(qd3dStatus);
 }
@@ -50,11 +50,14 @@
 #include "E3Transform.h"
 #include "E3IOFileFormat.h"
 #include "E3Pick.h"
+#include "E3Set.h"
 #include "E3View.h"
 #include "E3Math_Intersect.h"
 #include "E3FastArray.h"
 #include "E3Math.h"
 
+#include <cstring>
+
 
 
 
@@ -64,6 +67,7 @@
 //-----------------------------------------------------------------------------
 // Misc
 #define kApproxBoundsThreshold								12
+#define kPickRaysPerThread									64
 
 
 // View stack
@@ -107,6 +111,26 @@ enum {
 typedef TQ3Uns32 TQ3ViewStackState;
 
 
+// Pass replay
+enum {
+	kQ3ViewReplayIdle						= 0,		// Not recording
+	kQ3ViewReplayRecording					= 1,		// Recording the first pass
+	kQ3ViewReplayRecorded					= 2,		// First pass can be replayed
+	kQ3ViewReplayInvalid					= 3			// First pass can't be replayed
+};
+
+enum {
+	kQ3ViewReplayCommandPush				= 0,		// Push the view stack
+	kQ3ViewReplayCommandPop					= 1,		// Pop the view stack
+	kQ3ViewReplayCommandState				= 2,		// Update the view stack state
+	kQ3ViewReplayCommandGeometry			= 3,		// Submit a geometry to the renderer
+	kQ3ViewReplayCommandCullBegin			= 4,		// Test the bounds of a group
+	kQ3ViewReplayCommandCullEnd				= 5			// End of a group with bounds
+};
+
+typedef TQ3Uns32 TQ3ViewReplayState;
+
+
 
 
 
@@ -120,16 +144,15 @@ class E3View ;
 
 // Stack data
 typedef struct TQ3ViewStackItem {
-	// Next stack item
-	struct TQ3ViewStackItem*	next;
-	
-	
 	// Stack item state
-	TQ3ViewStackState			stackState;
+	TQ3ViewStackState			stackState;		// Changes since the push sent to the renderer
+	TQ3ViewStackState			stackSaved;		// Changes since the push saved for the pop
 	TQ3Matrix4x4				matrixLocalToWorld;
 	TQ3Matrix4x4				matrixWorldToCamera;
 	TQ3Matrix4x4				matrixLocalToCamera;
 	TQ3Matrix4x4				matrixCameraToFrustum;
+	TQ3MatrixKind				matrixLocalToWorldKind;
+	TQ3MatrixKind				matrixWorldToCameraKind;
 	TQ3ShaderObject				shaderIllumination;
 	TQ3ShaderObject				shaderSurface;
 	TQ3BackfacingStyle			styleBackfacing;
@@ -159,6 +182,57 @@ typedef struct TQ3ViewStackItem {
 } TQ3ViewStackItem;
 
 
+// Stack level, saved by a push
+typedef struct TQ3ViewStackLevel {
+	TQ3ViewStackState			stackState;
+	TQ3ViewStackState			stackSaved;
+	TQ3Uns32					savedOffset;	// Start of the level's saved values
+} TQ3ViewStackLevel;
+
+
+// Stack storage
+//
+// The stack holds a single item with the current state. Each field keeps its
+// value from before the push in savedValues, as a field index followed by the
+// field data, the first time it changes after the push.
+typedef struct TQ3ViewStackData {
+	TQ3ViewStackItem					theItem;
+	E3FastArray<TQ3ViewStackLevel>		theLevels;
+	E3FastArray<TQ3Uns8>				savedValues;
+} TQ3ViewStackData;
+
+
+// Pass replay command
+typedef struct TQ3ViewReplayCommand {
+	TQ3Uns32					commandType;
+	TQ3Uns32					commandParam;	// State mask, or index of the cull end
+	TQ3Uns32					dataOffset;		// Offset of state fields or bounds
+	TQ3Boolean					wasVisible;		// Cull test result while recording
+	TQ3ObjectType				geomType;
+	TQ3GeometryObject			theGeom;		// NULL for immediate mode geometry
+	const void					*geomData;
+	TQ3Uns32					editIndex;
+} TQ3ViewReplayCommand;
+
+
+// Pass replay buffer
+typedef struct TQ3ViewReplayBuffer {
+	E3FastArray<TQ3ViewReplayCommand>	theCommands;
+	E3FastArray<TQ3Uns8>				theData;
+	E3FastArray<TQ3Object>				theObjects;		// References held by the commands
+	E3FastArray<TQ3Uns32>				openCullTests;
+} TQ3ViewReplayBuffer;
+
+
+// Pass replay stack field
+typedef struct TQ3ViewReplayField {
+	TQ3ViewStackState			stateMask;
+	TQ3Uns32					fieldOffset;
+	TQ3Uns32					fieldSize;
+	TQ3Boolean					isObject;
+} TQ3ViewReplayField;
+
+
 // View data
 typedef struct TQ3ViewData {
 	// View state
@@ -170,15 +244,23 @@ typedef struct TQ3ViewData {
 	TQ3AttributeSet				viewAttributes;
 	TQ3AttributeSet				stateAttributes;	// needed for E3View_GetAttributeState
 	TQ3Boolean					allowGroupCulling;
+	TQ3Boolean					allowPassReplay;
+	TQ3GroupObject				pretestedGroup;		// Found visible by its parent group
 
 
 	// View stack
 	TQ3ViewStackItem			*viewStack;
-	TQ3ViewStackItem			*viewStackFreeList;
+	TQ3ViewStackData			*viewStackData;
 	// Note: The renderer may cache pointers into the TQ3ViewStackItem, so the
-	// TQ3ViewStackItem should never move.  This is why we use a linked list
-	// rather than something like std::vector.  We keep a free list instead of
-	// freeing popped records, just to reduce memory allocations and frees.
+	// TQ3ViewStackItem should never move. viewStack is NULL when the stack is
+	// empty, and otherwise points to the item in viewStackData.
+
+
+	// Pass replay state
+	TQ3ViewReplayState			replayState;
+	TQ3Uns32					replaySuspendCount;
+	TQ3Uns32					replayMuteCount;
+	TQ3ViewReplayBuffer			*replayBuffer;
 
 
 	// Bounds state
@@ -264,6 +346,21 @@ public :
 	
 
 
+// Rays of a world rays pick shared between threads
+typedef struct TQ3ViewPickRaysWork {
+	E3View*								view;
+	E3Root*								theClass;
+	TQ3ObjectType						objectType;
+	TQ3Object							theObject;
+	const void*							objectData;
+	TQ3PickObject						thePick;
+	const TQ3Uns32*						rayIndices;
+	TQ3Uns32							numRays;
+	volatile TQ3Uns32					nextRay;
+	volatile TQ3Uns32					numFailed;
+} TQ3ViewPickRaysWork;
+
+
 class E3Push : public E3StateOperator  // This is a leaf class so no other classes use this,
 								// so it can be here in the .c file rather than in
 								// the .h file, hence all the fields can be public
@@ -290,6 +387,87 @@ public :
 	
 
 
+//=============================================================================
+//      Static variables
+//-----------------------------------------------------------------------------
+// View stack fields saved by a pass replay state command, in the order in
+// which they are stored. The local-to-camera matrix is derived from the
+// local-to-world and world-to-camera matrices, so travels with either.
+#define E3_REPLAY_FIELD(_mask, _field, _isObject)								\
+	{ (_mask), (TQ3Uns32) offsetof(TQ3ViewStackItem, _field),					\
+	  (TQ3Uns32) sizeof(((TQ3ViewStackItem *) NULL)->_field), (_isObject) }
+
+static const TQ3ViewReplayField kViewReplayFields[] = {
+	E3_REPLAY_FIELD(kQ3ViewStateMatrixLocalToWorld,          matrixLocalToWorld,          kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateMatrixLocalToWorld,          matrixLocalToWorldKind,      kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateMatrixWorldToCamera,         matrixWorldToCamera,         kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateMatrixWorldToCamera,         matrixWorldToCameraKind,     kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateMatrixLocalToWorld |
+					kQ3ViewStateMatrixWorldToCamera,         matrixLocalToCamera,         kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateMatrixCameraToFrustum,       matrixCameraToFrustum,       kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateShaderIllumination,          shaderIllumination,          kQ3True),
+	E3_REPLAY_FIELD(kQ3ViewStateShaderSurface,               shaderSurface,               kQ3True),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleBackfacing,             styleBackfacing,             kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleInterpolation,          styleInterpolation,          kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleFill,                   styleFill,                   kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleHighlight,              styleHighlight,              kQ3True),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleSubdivision,            styleSubdivision,            kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleOrientation,            styleOrientation,            kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleCastShadows,            styleCastShadows,            kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleReceiveShadows,         styleReceiveShadows,         kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStylePickID,                 stylePickID,                 kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStylePickParts,              stylePickParts,              kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleAntiAlias,              styleAntiAlias,              kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleFog,                    styleFog,                    kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateStyleLineWidth,              styleLineWidth,              kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSurfaceUV,          attributeSurfaceUV,          kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeShadingUV,          attributeShadingUV,          kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeNormal,             attributeNormal,             kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeAmbientCoefficient, attributeAmbientCoefficient, kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeDiffuseColour,      attributeDiffuseColor,       kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSpecularColour,     attributeSpecularColor,      kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSpecularControl,    attributeSpecularControl,    kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeTransparencyColour, attributeTransparencyColor,  kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeEmissiveColor,      attributeEmissiveColor,      kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSurfaceTangent,     attributeSurfaceTangent,     kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeHighlightState,     attributeHighlightState,     kQ3False)
+};
+
+
+
+// View stack fields for each built-in attribute type, indexed by type.
+static const TQ3ViewReplayField kViewAttributeFields[kQ3AttributeTypeNumTypes] = {
+	{ 0, 0, 0, kQ3False },
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSurfaceUV,          attributeSurfaceUV,          kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeShadingUV,          attributeShadingUV,          kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeNormal,             attributeNormal,             kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeAmbientCoefficient, attributeAmbientCoefficient, kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeDiffuseColour,      attributeDiffuseColor,       kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSpecularColour,     attributeSpecularColor,      kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSpecularControl,    attributeSpecularControl,    kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeTransparencyColour, attributeTransparencyColor,  kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeSurfaceTangent,     attributeSurfaceTangent,     kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeHighlightState,     attributeHighlightState,     kQ3False),
+	E3_REPLAY_FIELD(kQ3ViewStateShaderSurface,               shaderSurface,               kQ3True),
+	E3_REPLAY_FIELD(kQ3ViewStateAttributeEmissiveColor,      attributeEmissiveColor,      kQ3False)
+};
+
+#undef E3_REPLAY_FIELD
+
+const TQ3Uns32 kViewReplayNumFields = sizeof(kViewReplayFields) / sizeof(kViewReplayFields[0]);
+
+// The matrix fields come first, so a matrix change need only look at these.
+const TQ3Uns32 kViewReplayNumMatrixFields = 6;
+
+
+
+// World ray pick being tested on this thread, see e3view_pick_rays_thread
+static E3_THREAD_LOCAL TQ3PickObject sThreadRayPick = NULL;
+
+
+
+
+
 //=============================================================================
 //      Internal functions
 //-----------------------------------------------------------------------------
@@ -311,8 +489,11 @@ e3view_stack_initialise(TQ3ViewStackItem *theItem)
 	Q3Matrix4x4_SetIdentity( &theItem->matrixLocalToCamera );
 	Q3Matrix4x4_SetIdentity(&theItem->matrixCameraToFrustum);
 
-	theItem->next					 = NULL;
+	theItem->matrixLocalToWorldKind  = kQ3MatrixKindTranslation;
+	theItem->matrixWorldToCameraKind = kQ3MatrixKindTranslation;
+
 	theItem->stackState				 = kQ3ViewStateNone;
+	theItem->stackSaved				 = kQ3ViewStateNone;
 	theItem->shaderIllumination		 = Q3NULLIllumination_New();
 	theItem->shaderSurface			 = NULL;
 	theItem->styleBackfacing         = kQ3BackfacingStyleBoth;
@@ -394,27 +575,209 @@ e3view_stack_update_attribute(TQ3ViewObject				theView,
 static void
 e3view_stack_set_attributes( TQ3AttributeSet atts,
 							TQ3ViewStackItem* topItem )
-{
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeSurfaceUV, &topItem->attributeSurfaceUV );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeShadingUV, &topItem->attributeShadingUV );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeNormal, &topItem->attributeNormal );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeAmbientCoefficient, &topItem->attributeAmbientCoefficient );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeDiffuseColor, &topItem->attributeDiffuseColor );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeSpecularColor, &topItem->attributeSpecularColor );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeSpecularControl, &topItem->attributeSpecularControl );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeTransparencyColor, &topItem->attributeTransparencyColor );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeEmissiveColor, &topItem->attributeEmissiveColor );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeSurfaceTangent, &topItem->attributeSurfaceTangent );
-	Q3AttributeSet_Add( atts, kQ3AttributeTypeHighlightState, &topItem->attributeHighlightState );
-	if (topItem->shaderSurface != NULL)
-	{
-		Q3AttributeSet_Add( atts, kQ3AttributeTypeSurfaceShader, &topItem->shaderSurface );
-	}
+{	const void			*attributeData[kQ3AttributeTypeNumTypes];
+	TQ3XAttributeMask	theMask;
+
+
+
+	// Collect the state of each built-in attribute
+	theMask = kQ3XAttributeMaskNone;
+	
+	for (TQ3Uns32 theType = kQ3AttributeTypeSurfaceUV; theType < kQ3AttributeTypeNumTypes; ++theType)
+		{
+		attributeData[theType] = ( (const TQ3Uns8*) topItem ) + kViewAttributeFields[theType].fieldOffset;
+		
+		if (theType != kQ3AttributeTypeSurfaceShader || topItem->shaderSurface != NULL)
+			theMask |= (1 << (theType - 1));
+		}
+
+
+
+	// And add them to the set in one step
+	E3AttributeSet_AddAttributes( atts, theMask, attributeData );
 }
 
 
 
 
+//=============================================================================
+//      e3view_replay_is_recording : Are we recording the current pass?
+//-----------------------------------------------------------------------------
+//		Note :	Anything submitted by a renderer while it processes a geometry
+//				is part of that geometry, so recording is suspended around it.
+//-----------------------------------------------------------------------------
+static inline bool
+e3view_replay_is_recording ( const E3View* view )
+	{
+	return ( view->instanceData.replayState        == kQ3ViewReplayRecording ) &&
+		   ( view->instanceData.replaySuspendCount == 0 ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_add_command : Append a command to the replay buffer.
+//-----------------------------------------------------------------------------
+static TQ3ViewReplayCommand&
+e3view_replay_add_command ( E3View* view, TQ3Uns32 commandType )
+	{
+	E3FastArray<TQ3ViewReplayCommand>& theCommands( view->instanceData.replayBuffer->theCommands ) ;
+	TQ3ViewReplayCommand				theCommand ;
+
+
+
+	// Append a cleared command
+	Q3Memory_Clear ( &theCommand, sizeof ( theCommand ) ) ;
+	theCommand.commandType = commandType ;
+
+	theCommands.push_back ( theCommand ) ;
+	
+	return theCommands[ (int) ( theCommands.size () - 1 ) ] ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_add_data : Append data to the replay buffer.
+//-----------------------------------------------------------------------------
+//		Note :	Returns the offset of the data within the buffer.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3view_replay_add_data ( E3View* view, const void* theData, TQ3Uns32 dataSize )
+	{
+	E3FastArray<TQ3Uns8>&	bufferData( view->instanceData.replayBuffer->theData ) ;
+	TQ3Uns32				theOffset = bufferData.size () ;
+
+
+
+	// Grow the buffer geometrically, since resize only grows to fit
+	if ( theOffset + dataSize > bufferData.capacity () )
+		bufferData.reserve ( 2 * ( theOffset + dataSize ) ) ;
+
+	bufferData.resize ( theOffset + dataSize ) ;
+	Q3Memory_Copy ( theData, &bufferData[ (int) theOffset ], dataSize ) ;
+	
+	return theOffset ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_record_state : Record a view stack state change.
+//-----------------------------------------------------------------------------
+//		Note :	We store the resolved values of the fields which changed, with
+//				a reference to any objects they contain.
+//-----------------------------------------------------------------------------
+static void
+e3view_replay_record_state ( E3View* view, const TQ3ViewStackItem* theItem, TQ3ViewStackState stateChange )
+	{
+	TQ3ViewReplayBuffer&	theBuffer( *view->instanceData.replayBuffer ) ;
+	TQ3Uns32				dataOffset = theBuffer.theData.size () ;
+
+
+
+	// Save the fields which have changed
+	for ( TQ3Uns32 n = 0 ; n < kViewReplayNumFields ; ++n )
+		{
+		const TQ3ViewReplayField& theField( kViewReplayFields[ n ] ) ;
+		if ( ( stateChange & theField.stateMask ) == 0 )
+			continue ;
+
+		const TQ3Uns8* fieldData = ( (const TQ3Uns8*) theItem ) + theField.fieldOffset ;
+		e3view_replay_add_data ( view, fieldData, theField.fieldSize ) ;
+		
+		if ( theField.isObject )
+			{
+			TQ3Object theObject = *( (const TQ3Object*) fieldData ) ;
+			if ( theObject != NULL )
+				theBuffer.theObjects.push_back ( Q3Shared_GetReference ( theObject ) ) ;
+			}
+		}
+
+
+
+	// Add the command
+	TQ3ViewReplayCommand& theCommand = e3view_replay_add_command ( view, kQ3ViewReplayCommandState ) ;
+	theCommand.commandParam = stateChange ;
+	theCommand.dataOffset   = dataOffset ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_stack_save : Save state that is about to change.
+//-----------------------------------------------------------------------------
+//		Note :	Must be called before the fields in stateChange are modified.
+//				The first change to each field after a push saves its value,
+//				with a reference to any object it contains, for the pop.
+//
+//				Returns the top of the stack, to make the change to.
+//-----------------------------------------------------------------------------
+static TQ3ViewStackItem*
+e3view_stack_save ( E3View* view, TQ3ViewStackState stateChange )
+	{
+	TQ3ViewStackItem* theItem = view->instanceData.viewStack ;
+
+
+
+	// Nothing needs saving if nothing is new, or if there was no push
+	Q3_ASSERT_VALID_PTR ( theItem ) ;
+
+	if ( ( stateChange & ~theItem->stackSaved ) == 0 )
+		return theItem ;
+
+	TQ3ViewStackData& stackData( *view->instanceData.viewStackData ) ;
+	if ( stackData.theLevels.size () <= 1 )
+		{
+		theItem->stackSaved |= stateChange ;
+		return theItem ;
+		}
+
+
+
+	// Save the fields which have not changed since the push
+	TQ3Uns32 numFields = ( stateChange & ~kQ3ViewStateMatrixAny ) ? kViewReplayNumFields : kViewReplayNumMatrixFields ;
+
+	for ( TQ3Uns32 n = 0 ; n < numFields ; ++n )
+		{
+		const TQ3ViewReplayField& theField( kViewReplayFields[ n ] ) ;
+		if ( ( stateChange & theField.stateMask ) == 0 || ( theItem->stackSaved & theField.stateMask ) != 0 )
+			continue ;
+
+		const TQ3Uns8* fieldData = ( (const TQ3Uns8*) theItem ) + theField.fieldOffset ;
+		TQ3Uns32	   theOffset = stackData.savedValues.size () ;
+
+		if ( theOffset + sizeof ( TQ3Uns32 ) + theField.fieldSize > stackData.savedValues.capacity () )
+			stackData.savedValues.reserve ( 2 * ( theOffset + sizeof ( TQ3Uns32 ) + theField.fieldSize ) ) ;
+
+		// The fields are small, and this runs for every transform in a
+		// group, so copy them directly rather than through Q3Memory_Copy
+		stackData.savedValues.resize ( theOffset + sizeof ( TQ3Uns32 ) + theField.fieldSize ) ;
+		TQ3Uns8* savedData = &stackData.savedValues[ (int) theOffset ] ;
+		memcpy ( savedData,                      &n,        sizeof ( TQ3Uns32 ) ) ;
+		memcpy ( savedData + sizeof ( TQ3Uns32 ), fieldData, theField.fieldSize ) ;
+
+		if ( theField.isObject && * ( (const TQ3Object*) fieldData ) != NULL )
+			Q3Shared_GetReference ( * ( (const TQ3Object*) fieldData ) ) ;
+		}
+
+	theItem->stackSaved |= stateChange ;
+	
+	return theItem ;
+	}
+
+
+
+
+
 //=============================================================================
 //      e3view_stack_update : Update the renderer state.
 //-----------------------------------------------------------------------------
@@ -446,8 +809,15 @@ e3view_stack_update ( E3View* view, TQ3ViewStackState stateChange )
 
 
 
-	// Update the renderer if we're currently drawing
-	if ( view->instanceData.viewMode == kQ3ViewModeDrawing )
+	// Record the change if we're recording this pass for replay
+	if ( e3view_replay_is_recording ( view ) )
+		e3view_replay_record_state ( view, theItem, stateChange ) ;
+
+
+
+	// Update the renderer if we're currently drawing, unless we're recording
+	// the contents of a culled group
+	if ( view->instanceData.viewMode == kQ3ViewModeDrawing && view->instanceData.replayMuteCount == 0 )
 		{
 		if ( ( stateChange & kQ3ViewStateMatrixAny ) && qd3dStatus != kQ3Failure )
 			{
@@ -578,57 +948,53 @@ e3view_stack_push ( E3View* view )
 
 
 
-	// Grow the view stack to the hold the new item
-	TQ3ViewStackItem* newTop = NULL;
-	if (instanceData.viewStackFreeList != NULL)
-	{
-		newTop = instanceData.viewStackFreeList;
-		instanceData.viewStackFreeList = instanceData.viewStackFreeList->next;
-	}
-	else
-	{
-		newTop = (TQ3ViewStackItem*) Q3Memory_Allocate( sizeof ( TQ3ViewStackItem ) );
-		if ( newTop == NULL )
+	// Create the stack storage if we need it
+	if ( instanceData.viewStackData == NULL )
 		{
-			return kQ3Failure;
+		instanceData.viewStackData = new ( std::nothrow ) TQ3ViewStackData ;
+		if ( instanceData.viewStackData == NULL )
+			return kQ3Failure ;
 		}
-	}
-	TQ3ViewStackItem* oldTop = instanceData.viewStack;
-	instanceData.viewStack = newTop;
-	
+
+	TQ3ViewStackData& stackData( *instanceData.viewStackData ) ;
+	TQ3ViewStackItem* theItem = &stackData.theItem ;
+	TQ3ViewStackLevel theLevel ;
+
+
 
 	// If this is the first item, initialise it
-	if ( oldTop == NULL )
+	if ( instanceData.viewStack == NULL )
 		{
-		e3view_stack_initialise ( newTop ) ;
-		newTop->next = oldTop ;
+		e3view_stack_initialise ( theItem ) ;
+		stackData.theLevels.clear () ;
+		stackData.savedValues.clear () ;
+
+		instanceData.viewStack = theItem ;
 		instanceData.isLocalToFrustumValid = false;
 		instanceData.isLocalToFrustumInverseValid = false;
 		}
-	
-	// Otherwise, clone what was on the top to the new top
-	else
-		{
-		// Take a copy of the state
-		Q3Memory_Copy ( oldTop, newTop, sizeof ( TQ3ViewStackItem ) ) ;
-		newTop->next = oldTop ;
 
 
 
-		// The stack state represents renderer state that has been changed since the push.
-		newTop->stackState = kQ3ViewStateNone ;
+	// Save the state masks, and start a new level. Nothing is copied until
+	// a field is changed.
+	theLevel.stackState  = theItem->stackState ;
+	theLevel.stackSaved  = theItem->stackSaved ;
+	theLevel.savedOffset = stackData.savedValues.size () ;
+	
+	stackData.theLevels.push_back ( theLevel ) ;
 
 
 
-		// Adjust the reference counts of the shared objects. The Q3Memory_Copy will have
-		// have copied them without adjusting the reference counts, which is incorrect.
-		
-		E3Shared_Acquire ( &newTop->shaderIllumination,     oldTop->shaderIllumination ) ;
-		E3Shared_Acquire ( &newTop->shaderSurface,          oldTop->shaderSurface ) ;
-		E3Shared_Acquire ( &newTop->styleHighlight,         oldTop->styleHighlight ) ;
-		}
+	// The stack state represents renderer state that has been changed since the push.
+	theItem->stackState = kQ3ViewStateNone ;
+	theItem->stackSaved = kQ3ViewStateNone ;
+
 
 
+	// Record the push if we're recording this pass for replay
+	if ( e3view_replay_is_recording ( view ) )
+		e3view_replay_add_command ( view, kQ3ViewReplayCommandPush ) ;
 
 	return kQ3Success ;
 	}
@@ -650,15 +1016,17 @@ e3view_stack_pop ( E3View* view )
 
 
 
-	// Save the state mask for the topmost item
-	TQ3ViewStackState theStateToUpdate = instanceData.viewStack->stackState;
+	// Record the pop if we're recording this pass for replay. The renderer
+	// update below is implied by the pop, so is not recorded separately.
+	if ( e3view_replay_is_recording ( view ) )
+		e3view_replay_add_command ( view, kQ3ViewReplayCommandPop ) ;
 
 
 
-	// Dispose of the shared objects in the topmost item
-	Q3Object_CleanDispose ( & instanceData.viewStack->shaderIllumination );
-	Q3Object_CleanDispose ( & instanceData.viewStack->shaderSurface );
-	Q3Object_CleanDispose ( & instanceData.viewStack->styleHighlight );
+	// Save the state mask for the topmost item
+	TQ3ViewStackData& stackData( *instanceData.viewStackData ) ;
+	TQ3ViewStackItem* theItem = instanceData.viewStack ;
+	TQ3ViewStackState theStateToUpdate = theItem->stackState ;
 
 
 
@@ -668,11 +1036,46 @@ e3view_stack_pop ( E3View* view )
 
 
 
-	// Shrink the stack, moving the top item to the free list
-	TQ3ViewStackItem* theItem = instanceData.viewStack;
-	instanceData.viewStack = theItem->next;
-	theItem->next = instanceData.viewStackFreeList;
-	instanceData.viewStackFreeList = theItem;
+	// If this is the last item, dispose of its shared objects and we're done
+	if ( stackData.theLevels.size () <= 1 )
+		{
+		Q3Object_CleanDispose ( &theItem->shaderIllumination );
+		Q3Object_CleanDispose ( &theItem->shaderSurface );
+		Q3Object_CleanDispose ( &theItem->styleHighlight );
+
+		stackData.theLevels.clear () ;
+		instanceData.viewStack = NULL ;
+		return ;
+		}
+
+
+
+	// Restore the fields which were changed since the push. Saved objects
+	// carry the reference taken when they were saved.
+	const TQ3ViewStackLevel theLevel = stackData.theLevels[ (int) ( stackData.theLevels.size () - 1 ) ] ;
+	TQ3Uns32 theOffset = theLevel.savedOffset ;
+
+	while ( theOffset < stackData.savedValues.size () )
+		{
+		TQ3Uns32 n ;
+		memcpy ( &n, &stackData.savedValues[ (int) theOffset ], sizeof ( TQ3Uns32 ) ) ;
+		theOffset += sizeof ( TQ3Uns32 ) ;
+
+		const TQ3ViewReplayField& theField( kViewReplayFields[ n ] ) ;
+		TQ3Uns8* fieldData = ( (TQ3Uns8*) theItem ) + theField.fieldOffset ;
+
+		if ( theField.isObject )
+			Q3Object_CleanDispose ( (TQ3Object*) fieldData ) ;
+
+		memcpy ( fieldData, &stackData.savedValues[ (int) theOffset ], theField.fieldSize ) ;
+		theOffset += theField.fieldSize ;
+		}
+
+	stackData.savedValues.resize ( theLevel.savedOffset ) ;
+	stackData.theLevels.resize ( stackData.theLevels.size () - 1 ) ;
+	
+	theItem->stackState = theLevel.stackState ;
+	theItem->stackSaved = theLevel.stackSaved ;
 
 
 
@@ -682,15 +1085,266 @@ e3view_stack_pop ( E3View* view )
 	// In so doing, the mask of changes to view state after the last push
 	// will be ORed with the mask of changes before the push.
 	
-	// One might think that the mask could be kept the same as before the
-	// push, since we are undoing those state changes.  However, with the
-	// current design, it is not quite possible, because the renderer state
-	// keeps pointers into the top of the view stack.
-	// Suppose, for instance, you push twice, then set a diffuse color, then
-	// pop twice.  On the first (inner) pop, the renderer state points at the color
-	// in the TQ3ViewStackItem created by the first (outer) push.  The second
-	// pop deletes that storage, so it had better update the renderer.
+	// The renderer may keep pointers into the stack item, which stays put,
+	// but the values it points to have been restored so must be resent.
+	instanceData.replaySuspendCount++ ;
 	e3view_stack_update ( view, theStateToUpdate ) ;
+	instanceData.replaySuspendCount-- ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_stack_pop_clean : Pop the view stack clean.
+//-----------------------------------------------------------------------------
+static void
+e3view_stack_pop_clean ( E3View* view )
+	{
+	// Validate our parameters
+	Q3_ASSERT_VALID_PTR(view);
+
+
+
+	// Pop the stack clean
+	while ( view->instanceData.viewStack != NULL )
+		e3view_stack_pop ( view ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_state_set_matrix : Set the camera matrices.
+//-----------------------------------------------------------------------------
+//		Note :	The caller supplies the kind of the local-to-world matrix,
+//				which is normally known from the transform that produced it.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3view_state_set_matrix ( E3View*				view,
+							TQ3MatrixState		theState,
+							const TQ3Matrix4x4	*localToWorld,
+							TQ3MatrixKind		localToWorldKind,
+							const TQ3Matrix4x4	*worldToCamera,
+							const TQ3Matrix4x4	*cameraToFrustum )
+	{
+	// Validate our state
+	TQ3ViewData& instanceData( view->instanceData );
+	Q3_ASSERT ( Q3_VALID_PTR ( instanceData.viewStack ) ) ;
+
+
+
+	// Save the matrices which will change
+	TQ3ViewStackState stateChange = kQ3ViewStateNone;
+	
+	if (theState & kQ3MatrixStateLocalToWorld)
+		stateChange |= kQ3ViewStateMatrixLocalToWorld;
+	
+	if (theState & kQ3MatrixStateWorldToCamera)
+		stateChange |= kQ3ViewStateMatrixWorldToCamera;
+	
+	if (theState & kQ3MatrixStateCameraToFrustum)
+		stateChange |= kQ3ViewStateMatrixCameraToFrustum;
+	
+	e3view_stack_save ( view, stateChange ) ;
+
+
+
+	// Set the matrices which have changed
+	TQ3ViewStackItem* theItem = instanceData.viewStack ;
+
+	if (theState & kQ3MatrixStateLocalToWorld)
+		{
+		Q3_ASSERT(Q3_VALID_PTR(localToWorld));
+		theItem->matrixLocalToWorld     = *localToWorld;
+		theItem->matrixLocalToWorldKind = localToWorldKind;
+		}
+	
+	if (theState & kQ3MatrixStateWorldToCamera)
+		{
+		Q3_ASSERT(Q3_VALID_PTR(worldToCamera));
+		Q3_ASSERT( isfinite( worldToCamera->value[0][0] ) );
+		theItem->matrixWorldToCamera     = *worldToCamera;
+		theItem->matrixWorldToCameraKind = E3Matrix4x4_GetKind( worldToCamera );
+		}
+	
+	if ( (theState & (kQ3MatrixStateLocalToWorld | kQ3MatrixStateWorldToCamera)) != 0 )
+	{
+		E3Matrix4x4_MultiplyKind( &theItem->matrixLocalToWorld,  theItem->matrixLocalToWorldKind,
+								  &theItem->matrixWorldToCamera, theItem->matrixWorldToCameraKind,
+								  &theItem->matrixLocalToCamera );
+	}
+	
+	if (theState & kQ3MatrixStateCameraToFrustum)
+		{
+		Q3_ASSERT(Q3_VALID_PTR(cameraToFrustum));
+		theItem->matrixCameraToFrustum = *cameraToFrustum;
+		}
+
+
+	// Invalidate caches
+	instanceData.isLocalToFrustumValid = false;
+	instanceData.isLocalToFrustumInverseValid = false;
+
+
+	// Update the renderer
+	Q3_ASSERT(stateChange != kQ3ViewStateNone);
+	return e3view_stack_update ( view, stateChange) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_discard : Discard the pass replay buffer.
+//-----------------------------------------------------------------------------
+static void
+e3view_replay_discard ( E3View* view )
+	{
+	TQ3ViewData& instanceData( view->instanceData ) ;
+
+
+
+	// Release the objects held by the commands
+	if ( instanceData.replayBuffer != NULL )
+		{
+		TQ3ViewReplayBuffer& theBuffer( *instanceData.replayBuffer ) ;
+
+		for ( TQ3Uns32 n = 0 ; n < theBuffer.theObjects.size () ; ++n )
+			Q3Object_Dispose ( theBuffer.theObjects[ (int) n ] ) ;
+
+		theBuffer.theCommands.clear () ;
+		theBuffer.theData.clear () ;
+		theBuffer.theObjects.clear () ;
+		theBuffer.openCullTests.clear () ;
+		}
+
+
+
+	// Reset our state
+	instanceData.replayState        = kQ3ViewReplayIdle ;
+	instanceData.replaySuspendCount = 0 ;
+	instanceData.replayMuteCount    = 0 ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_begin_recording : Start recording a pass for replay.
+//-----------------------------------------------------------------------------
+static void
+e3view_replay_begin_recording ( E3View* view )
+	{
+	// Discard any previous recording
+	e3view_replay_discard ( view ) ;
+
+
+
+	// Start recording
+	if ( view->instanceData.replayBuffer == NULL )
+		view->instanceData.replayBuffer = new TQ3ViewReplayBuffer ;
+
+	view->instanceData.replayState = kQ3ViewReplayRecording ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_end_recording : Finish recording a pass for replay.
+//-----------------------------------------------------------------------------
+//		Note :	The recording holds the public data of retained geometries, so
+//				it can't be replayed if any of them were edited after they were
+//				submitted (e.g., by reusing one object for several submits).
+//-----------------------------------------------------------------------------
+static void
+e3view_replay_end_recording ( E3View* view )
+	{
+	// Make sure we were recording
+	if ( view->instanceData.replayState != kQ3ViewReplayRecording )
+		return ;
+
+
+
+	// Check the recording is still valid
+	TQ3ViewReplayBuffer& theBuffer( *view->instanceData.replayBuffer ) ;
+	view->instanceData.replayState = kQ3ViewReplayRecorded ;
+
+	if ( ! theBuffer.openCullTests.empty () )
+		view->instanceData.replayState = kQ3ViewReplayInvalid ;
+
+	for ( TQ3Uns32 n = 0 ; n < theBuffer.theCommands.size () && view->instanceData.replayState == kQ3ViewReplayRecorded ; ++n )
+		{
+		const TQ3ViewReplayCommand& theCommand( theBuffer.theCommands[ (int) n ] ) ;
+
+		if ( theCommand.commandType == kQ3ViewReplayCommandGeometry && theCommand.theGeom != NULL &&
+			 ( (E3Shared*) theCommand.theGeom )->GetEditIndex () != theCommand.editIndex )
+			view->instanceData.replayState = kQ3ViewReplayInvalid ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_replay_apply_state : Replay a view stack state change.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3view_replay_apply_state ( E3View* view, const TQ3ViewReplayCommand& theCommand )
+	{
+	TQ3ViewStackItem* theItem = view->instanceData.viewStack ;
+
+
+
+	// Make sure we have a stack
+	if ( theItem == NULL )
+		return kQ3Failure ;
+
+
+
+	// Restore the fields which changed
+	const TQ3Uns8* theData = &view->instanceData.replayBuffer->theData[ (int) theCommand.dataOffset ] ;
+	e3view_stack_save ( view, theCommand.commandParam ) ;
+
+	for ( TQ3Uns32 n = 0 ; n < kViewReplayNumFields ; ++n )
+		{
+		const TQ3ViewReplayField& theField( kViewReplayFields[ n ] ) ;
+		if ( ( theCommand.commandParam & theField.stateMask ) == 0 )
+			continue ;
+
+		TQ3Uns8* fieldData = ( (TQ3Uns8*) theItem ) + theField.fieldOffset ;
+		if ( theField.isObject )
+			{
+			TQ3Object theObject ;
+			Q3Memory_Copy ( theData, &theObject, sizeof ( theObject ) ) ;
+			E3Shared_Replace ( (TQ3Object*) fieldData, theObject ) ;
+			}
+		else
+			Q3Memory_Copy ( theData, fieldData, theField.fieldSize ) ;
+
+		theData += theField.fieldSize ;
+		}
+
+
+
+	// Invalidate caches
+	if ( theCommand.commandParam & kQ3ViewStateMatrixAny )
+		{
+		view->instanceData.isLocalToFrustumValid        = false ;
+		view->instanceData.isLocalToFrustumInverseValid = false ;
+		}
+
+
+
+	// Update the renderer
+	return e3view_stack_update ( view, theCommand.commandParam ) ;
 	}
 
 
@@ -698,19 +1352,68 @@ e3view_stack_pop ( E3View* view )
 
 
 //=============================================================================
-//      e3view_stack_pop_clean : Pop the view stack clean.
+//      e3view_replay_submit : Replay the recorded pass.
 //-----------------------------------------------------------------------------
-static void
-e3view_stack_pop_clean ( E3View* view )
+//		Note :	Group culling depends on the pass (e.g., shadow passes keep
+//				groups which are outside the frustum but can cast a shadow into
+//				it), so culled groups were recorded and are tested again here.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3view_replay_submit ( E3View* view )
 	{
-	// Validate our parameters
-	Q3_ASSERT_VALID_PTR(view);
+	const TQ3ViewReplayBuffer&	theBuffer( *view->instanceData.replayBuffer ) ;
+	TQ3Status					qd3dStatus = kQ3Success ;
+	TQ3BoundingBox				theBBox ;
+	TQ3Boolean					geomSupported ;
 
 
 
-	// Pop the stack clean
-	while ( view->instanceData.viewStack != NULL )
-		e3view_stack_pop ( view ) ;
+	// Replay the commands
+	for ( TQ3Uns32 n = 0 ; n < theBuffer.theCommands.size () ; ++n )
+		{
+		// Stop if we've been cancelled or something went wrong
+		if ( qd3dStatus == kQ3Failure || view->instanceData.viewState != kQ3ViewStateSubmitting )
+			break ;
+
+
+
+		// Replay the command
+		const TQ3ViewReplayCommand& theCommand( theBuffer.theCommands[ (int) n ] ) ;
+
+		switch ( theCommand.commandType )
+			{
+			case kQ3ViewReplayCommandPush:
+				qd3dStatus = e3view_stack_push ( view ) ;
+				break ;
+
+			case kQ3ViewReplayCommandPop:
+				if ( view->instanceData.viewStack != NULL )
+					e3view_stack_pop ( view ) ;
+				else
+					qd3dStatus = kQ3Failure ;
+				break ;
+
+			case kQ3ViewReplayCommandState:
+				qd3dStatus = e3view_replay_apply_state ( view, theCommand ) ;
+				break ;
+
+			case kQ3ViewReplayCommandGeometry:
+				qd3dStatus = E3Renderer_Method_SubmitGeometry ( view, theCommand.geomType, &geomSupported,
+																 theCommand.theGeom, theCommand.geomData ) ;
+				break ;
+
+			case kQ3ViewReplayCommandCullBegin:
+				Q3Memory_Copy ( &theBuffer.theData[ (int) theCommand.dataOffset ], &theBBox, sizeof ( theBBox ) ) ;
+				if ( ! E3Renderer_Method_IsBBoxVisible ( view, &theBBox ) )
+					n = theCommand.commandParam ;
+				break ;
+
+			case kQ3ViewReplayCommandCullEnd:
+				break ;
+			}
+		}
+
+	return qd3dStatus ;
 	}
 
 
@@ -998,6 +1701,100 @@ e3view_submit_retained_error ( E3View* view, TQ3Object theObject )
 
 
 
+//=============================================================================
+//      e3view_pick_rays_thread : Pick the rays of a world rays pick.
+//-----------------------------------------------------------------------------
+//		Note :	Run on each thread by e3view_submit_pick_method, taking rays
+//				until there are none left. The pick method sees the world ray
+//				pick of each ray through E3View_AccessPick.
+//-----------------------------------------------------------------------------
+static void
+e3view_pick_rays_thread ( void* userData )
+	{
+	TQ3ViewPickRaysWork* theWork = (TQ3ViewPickRaysWork*) userData ;
+	TQ3Uns32 n ;
+	
+	while ( ( n = E3Atomic_Increment ( &theWork->nextRay ) - 1 ) < theWork->numRays )
+		{
+		sThreadRayPick = E3WorldRaysPick_AccessRayPick ( theWork->thePick, theWork->rayIndices[ n ] ) ;
+		
+		if ( theWork->theClass->submitPickMethod ( theWork->view, theWork->objectType,
+													theWork->theObject, theWork->objectData ) == kQ3Failure )
+			E3Atomic_Increment ( &theWork->numFailed ) ;
+		}
+	
+	sThreadRayPick = NULL ;
+	}
+
+
+
+
+
+//=============================================================================
+//      e3view_submit_pick_method : Invoke the pick method of an object.
+//-----------------------------------------------------------------------------
+//		Note :	Geometries are handed a world rays pick as the world ray pick
+//				of each of its active rays in turn, so that they need only know
+//				how to pick a single ray. Other objects, such as groups and
+//				transforms, see the world rays pick itself and are submitted
+//				once for all of its rays.
+//
+//				The rays of a TriMesh may be shared between threads, since its
+//				pick method only reads the view and adds hits to the ray's own
+//				pick. Other geometries may decompose into the view, so their
+//				rays are always picked on this thread.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3view_submit_pick_method ( E3View* view, E3Root* theClass, TQ3ObjectType objectType,
+							TQ3Object theObject, const void* objectData )
+	{
+	TQ3PickObject thePick = view->instanceData.thePick ;
+	if ( E3Pick_GetType ( thePick ) != kQ3PickTypeWorldRays ||
+		 ! theClass->IsType ( kQ3ShapeTypeGeometry ) )
+		return theClass->submitPickMethod ( view, objectType, theObject, objectData ) ;
+
+
+
+	// Share the active rays of a TriMesh between threads, if we have enough
+	const TQ3Uns32* rayIndices ;
+	TQ3Uns32 numRays    = E3WorldRaysPick_GetActiveRays ( thePick, &rayIndices ) ;
+	TQ3Uns32 numThreads = E3WorldRaysPick_GetNumThreads ( thePick ) ;
+	
+	if ( numThreads > numRays / kPickRaysPerThread )
+		numThreads = numRays / kPickRaysPerThread ;
+	
+	if ( objectType == kQ3GeometryTypeTriMesh && numThreads > 1 )
+		{
+		TQ3ViewPickRaysWork theWork = { view, theClass, objectType, theObject, objectData,
+										thePick, rayIndices, numRays, 0, 0 } ;
+		
+		E3Thread_RunParallel ( numThreads, e3view_pick_rays_thread, &theWork ) ;
+		
+		return ( theWork.numFailed == 0 ) ? kQ3Success : kQ3Failure ;
+		}
+
+
+
+	// Pick each active ray
+	TQ3Status qd3dStatus = kQ3Success ;
+	
+	for ( TQ3Uns32 n = 0 ; n < numRays ; ++n )
+		{
+		view->instanceData.thePick = E3WorldRaysPick_AccessRayPick ( thePick, rayIndices[ n ] ) ;
+		
+		if ( theClass->submitPickMethod ( view, objectType, theObject, objectData ) == kQ3Failure )
+			qd3dStatus = kQ3Failure ;
+		}
+	
+	view->instanceData.thePick = thePick ;
+	
+	return qd3dStatus ;
+	}
+
+
+
+
+
 //=============================================================================
 //      e3view_submit_retained_pick : viewMode == kQ3ViewModePicking.
 //-----------------------------------------------------------------------------
@@ -1017,7 +1814,7 @@ e3view_submit_retained_pick ( E3View* view, TQ3Object theObject )
 	// Call the method
 	TQ3Status qd3dStatus = kQ3Success ;
 	if ( theClass->submitPickMethod != NULL )
-		qd3dStatus = theClass->submitPickMethod ( view, theClass->GetType (), theObject, theObject->FindLeafInstanceData () ) ;
+		qd3dStatus = e3view_submit_pick_method ( view, theClass, theClass->GetType (), theObject, theObject->FindLeafInstanceData () ) ;
 
 
 	// Reset the current hit target. Not strictly necessary (since we
@@ -1210,7 +2007,7 @@ e3view_submit_immediate_pick ( E3View* view , TQ3ObjectType objectType , const v
 	// Call the method
 	TQ3Status qd3dStatus ;
 	if ( theClass->submitPickMethod != NULL )
-		qd3dStatus = theClass->submitPickMethod ( view, objectType, NULL, objectData ) ;
+		qd3dStatus = e3view_submit_pick_method ( view, theClass, objectType, NULL, objectData ) ;
 	else
 		qd3dStatus = kQ3Success ;
 		
@@ -1538,6 +2335,12 @@ e3view_pick_begin ( E3View* view, TQ3PickObject thePick )
 
 
 
+	// If this is a world-rays pick, every ray starts out active
+	if (Q3Pick_GetType(thePick) == kQ3PickTypeWorldRays)
+		E3WorldRaysPick_ResetActiveRays(thePick);
+
+
+
 	// If this is a window-point pick, recalculate the pick ray
 	Q3Memory_Clear(& view->instanceData.rayThroughPick, sizeof( view->instanceData.rayThroughPick));
 	if (Q3Pick_GetType(thePick) == kQ3PickTypeWindowPoint)
@@ -1730,6 +2533,7 @@ e3view_new(TQ3Object theObject, void *privateData, const void *paramData)
 	instanceData->submitRetainedMethod  = (TQ3XViewSubmitRetainedMethod) e3view_submit_retained_error;
 	instanceData->submitImmediateMethod = (TQ3XViewSubmitImmediateMethod) e3view_submit_immediate_error;
 	instanceData->allowGroupCulling = kQ3True;
+	instanceData->pretestedGroup    = NULL;
 	
 	instanceData->viewAttributes = Q3AttributeSet_New();
 	if (instanceData->viewAttributes != NULL)
@@ -1787,15 +2591,11 @@ e3view_delete ( E3View* view, void *privateData )
 	Q3Object_CleanDispose(&instanceData->boundingPointsSlab);
 	delete instanceData->boundingPointsArray;
 
+	e3view_replay_discard ( view ) ;
+	delete instanceData->replayBuffer;
+
 	e3view_stack_pop_clean ( view ) ;
-	
-	// Clear the free list
-	while (instanceData->viewStackFreeList != NULL)
-	{
-		TQ3ViewStackItem* topItem = instanceData->viewStackFreeList;
-		instanceData->viewStackFreeList = instanceData->viewStackFreeList->next;
-		Q3Memory_Free( &topItem );
-	}
+	delete instanceData->viewStackData;
 }
 
 
@@ -2093,7 +2893,10 @@ E3View_CallIdleMethod(TQ3ViewObject theView, TQ3Uns32 current, TQ3Uns32 complete
 TQ3PickObject
 E3View_AccessPick(TQ3ViewObject theView)
 	{
-	// Return the pick
+	// Return the ray pick this thread is testing for a world rays pick, or our pick
+	if ( sThreadRayPick != NULL )
+		return sThreadRayPick ;
+	
 	return ( (E3View*) theView )->instanceData.thePick ;
 	}
 
@@ -2328,6 +3131,34 @@ E3View_GetBoundingMethod(TQ3ViewObject theView)
 
 
 
+
+//=============================================================================
+//      E3View_AccessBoundingBox : Access the accumulating bounding box.
+//-----------------------------------------------------------------------------
+//		Note :	Used internally by Quesa to find the bounds of individual
+//				objects within a bounding box loop, by emptying the box before
+//				each object is submitted and reading it back afterwards.
+//
+//				May only be called from within a bounding box loop.
+//-----------------------------------------------------------------------------
+TQ3BoundingBox *
+E3View_AccessBoundingBox(TQ3ViewObject theView)
+	{
+	// Validate our state
+	Q3_ASSERT( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModeCalcBounds ); 
+	Q3_ASSERT( ( (E3View*) theView )->instanceData.boundingMethod == kQ3BoxBoundsExact ||
+			   ( (E3View*) theView )->instanceData.boundingMethod == kQ3BoxBoundsApprox );
+
+
+
+	// Return the box
+	return & ( (E3View*) theView )->instanceData.boundingBox ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3View_GetRayThroughPickPoint : Return the pick point ray.
 //-----------------------------------------------------------------------------
@@ -2570,51 +3401,251 @@ E3View_PickStack_SaveObject(TQ3ViewObject theView, TQ3Object theObject)
 
 
 //=============================================================================
-//      E3View_PickStack_BeginDecomposedObject : Begin a decomposed object.
+//      E3View_PickStack_BeginDecomposedObject : Begin a decomposed object.
+//-----------------------------------------------------------------------------
+//		Note :	When picking, we need to distinguish between objects submitted
+//				by the app, and objects submitted due to the decomposition of
+//				those objects.
+//
+//				Whenever a decomposed object is submitted, we increment a count
+//				so we know that further objects can be ignored until the count
+//				falls to 0 again.
+//-----------------------------------------------------------------------------
+void
+E3View_PickStack_BeginDecomposedObject(TQ3ViewObject theView)
+	{
+	// Validate our state
+	Q3_ASSERT( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModePicking);
+
+
+
+	// Increment the count
+	( (E3View*) theView )->instanceData.pickDecomposeCount++ ;
+	Q3_ASSERT(( (E3View*) theView )->instanceData.pickDecomposeCount != 0);
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_PickStack_EndDecomposedObject : End a decomposed object.
+//-----------------------------------------------------------------------------
+//		Note :	When the count falls to 0, we have finished the object being
+//				decomposed and we can resume tracking the current object as the
+//				target for successful hits.
+//-----------------------------------------------------------------------------
+void
+E3View_PickStack_EndDecomposedObject(TQ3ViewObject theView)
+	{
+	// Validate our state
+	Q3_ASSERT ( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModePicking ) ;
+
+
+
+	// Increment the count
+	Q3_ASSERT ( ( (E3View*) theView )->instanceData.pickDecomposeCount > 0 ) ;
+	( (E3View*) theView )->instanceData.pickDecomposeCount-- ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_PickStack_PopGroup : Pop a group off the pick path.
+//-----------------------------------------------------------------------------
+void
+E3View_PickStack_PopGroup(TQ3ViewObject theView)
+	{
+	TQ3HitPath* pickedPath = &( (E3View*) theView )->instanceData.pickedPath ;
+
+
+
+	// Validate our state
+	Q3_ASSERT ( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModePicking ) ;
+
+
+
+	// If we are inside a decomposed object, never mind
+	if ( ( (E3View*) theView )->instanceData.pickDecomposeCount > 0 )
+		return;
+
+
+
+	// Make sure that there's at least one slot defined
+	Q3_ASSERT ( pickedPath->depth     != 0 ) ;
+	Q3_ASSERT ( pickedPath->positions != NULL ) ;
+
+
+
+	// Shrink the positions array. Note that we just decrement the count
+	// rather than shrinking the array, since future groups would cause
+	// the array to be resized - which realloc will skip if the array
+	// has already been extended.
+	pickedPath->depth-- ;
+
+
+
+	// If this was the last group, remove the root object
+	if ( pickedPath->depth == 0 )
+		Q3Object_CleanDispose ( & pickedPath->rootGroup ) ;
+
+
+
+	// Remove our reference to the picked object
+	E3Shared_Replace ( & ( (E3View*) theView )->instanceData.pickedObject, NULL ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_Replay_RecordGeometry : Record a geometry for pass replay.
+//-----------------------------------------------------------------------------
+//		Note :	Called for each geometry the renderer accepts. Returns kQ3False
+//				if the geometry should not be passed to the renderer, as it is
+//				inside a group which was culled while recording.
+//
+//				Immediate mode data belongs to the application, and may not
+//				survive until the next pass, so we record a copy of it.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+E3View_Replay_RecordGeometry(TQ3ViewObject theView, TQ3ObjectType geomType, TQ3GeometryObject theGeom, const void *geomData)
+	{
+	E3View* view = (E3View*) theView ;
+
+
+
+	// Record the geometry
+	if ( e3view_replay_is_recording ( view ) )
+		{
+		TQ3ViewReplayBuffer& theBuffer( *view->instanceData.replayBuffer ) ;
+		
+		if ( theGeom != NULL )
+			{
+			theBuffer.theObjects.push_back ( Q3Shared_GetReference ( theGeom ) ) ;
+
+			TQ3ViewReplayCommand& theCommand = e3view_replay_add_command ( view, kQ3ViewReplayCommandGeometry ) ;
+			theCommand.geomType  = geomType ;
+			theCommand.theGeom   = theGeom ;
+			theCommand.geomData  = geomData ;
+			theCommand.editIndex = ( (E3Shared*) theGeom )->GetEditIndex () ;
+			}
+		else
+			{
+			TQ3Object theCopy = E3ClassTree::CreateInstance ( geomType, kQ3False, geomData ) ;
+			if ( theCopy == NULL )
+				view->instanceData.replayState = kQ3ViewReplayInvalid ;
+			else
+				{
+				theBuffer.theObjects.push_back ( theCopy ) ;
+
+				const void* copyData = theCopy->FindLeafInstanceData () ;
+				if ( TQ3XGeomGetPublicDataMethod getPublicData = ( (E3GeometryInfo*) ( theCopy->GetClass () ) )->getPublicData )
+					copyData = getPublicData ( theCopy ) ;
+
+				TQ3ViewReplayCommand& theCommand = e3view_replay_add_command ( view, kQ3ViewReplayCommandGeometry ) ;
+				theCommand.geomType = geomType ;
+				theCommand.geomData = copyData ;
+				}
+			}
+		}
+
+	return (TQ3Boolean) ( view->instanceData.replayMuteCount == 0 ) ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_Replay_SuspendRecording : Suspend or resume pass recording.
+//-----------------------------------------------------------------------------
+void
+E3View_Replay_SuspendRecording(TQ3ViewObject theView, TQ3Boolean suspend)
+	{
+	TQ3ViewData& instanceData( ( (E3View*) theView )->instanceData ) ;
+
+
+
+	// Update the suspend count
+	if ( suspend )
+		instanceData.replaySuspendCount++ ;
+	else
+		{
+		Q3_ASSERT( instanceData.replaySuspendCount > 0 ) ;
+		instanceData.replaySuspendCount-- ;
+		}
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_Replay_IsRecording : Is the current pass being recorded?
+//-----------------------------------------------------------------------------
+TQ3Boolean
+E3View_Replay_IsRecording(TQ3ViewObject theView)
+	{
+	return e3view_replay_is_recording ( (E3View*) theView ) ? kQ3True : kQ3False ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_Replay_BeginCullTest : Record a group culling test.
 //-----------------------------------------------------------------------------
-//		Note :	When picking, we need to distinguish between objects submitted
-//				by the app, and objects submitted due to the decomposition of
-//				those objects.
+//		Note :	Returns kQ3True if the test was recorded, in which case the
+//				caller must submit the group whatever the result of the test,
+//				and call E3View_Replay_EndCullTest afterwards.
 //
-//				Whenever a decomposed object is submitted, we increment a count
-//				so we know that further objects can be ignored until the count
-//				falls to 0 again.
+//				If the group was not visible, later passes may still need it,
+//				so it is recorded in its own view stack item without being
+//				passed to the renderer.
 //-----------------------------------------------------------------------------
-void
-E3View_PickStack_BeginDecomposedObject(TQ3ViewObject theView)
+TQ3Boolean
+E3View_Replay_BeginCullTest(TQ3ViewObject theView, const TQ3BoundingBox *theBBox, TQ3Boolean isVisible)
 	{
-	// Validate our state
-	Q3_ASSERT( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModePicking);
+	E3View* view = (E3View*) theView ;
 
 
 
-	// Increment the count
-	( (E3View*) theView )->instanceData.pickDecomposeCount++ ;
-	Q3_ASSERT(( (E3View*) theView )->instanceData.pickDecomposeCount != 0);
-	}
+	// Check we're recording
+	if ( ! e3view_replay_is_recording ( view ) )
+		return kQ3False ;
 
 
 
+	// Record the test
+	TQ3Uns32 dataOffset = e3view_replay_add_data ( view, theBBox, sizeof ( TQ3BoundingBox ) ) ;
 
+	TQ3ViewReplayCommand& theCommand = e3view_replay_add_command ( view, kQ3ViewReplayCommandCullBegin ) ;
+	theCommand.dataOffset = dataOffset ;
+	theCommand.wasVisible = isVisible ;
 
-//=============================================================================
-//      E3View_PickStack_EndDecomposedObject : End a decomposed object.
-//-----------------------------------------------------------------------------
-//		Note :	When the count falls to 0, we have finished the object being
-//				decomposed and we can resume tracking the current object as the
-//				target for successful hits.
-//-----------------------------------------------------------------------------
-void
-E3View_PickStack_EndDecomposedObject(TQ3ViewObject theView)
-	{
-	// Validate our state
-	Q3_ASSERT ( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModePicking ) ;
+	view->instanceData.replayBuffer->openCullTests.push_back ( view->instanceData.replayBuffer->theCommands.size () - 1 ) ;
 
 
 
-	// Increment the count
-	Q3_ASSERT ( ( (E3View*) theView )->instanceData.pickDecomposeCount > 0 ) ;
-	( (E3View*) theView )->instanceData.pickDecomposeCount-- ;
+	// Hide the group from the renderer if it was culled
+	if ( ! isVisible )
+		{
+		view->instanceData.replaySuspendCount++ ;
+		TQ3Status qd3dStatus = e3view_stack_push ( view ) ;
+		view->instanceData.replaySuspendCount-- ;
+
+		if ( qd3dStatus == kQ3Failure )
+			view->instanceData.replayState = kQ3ViewReplayInvalid ;
+		
+		view->instanceData.replayMuteCount++ ;
+		}
+	
+	return kQ3True ;
 	}
 
 
@@ -2622,48 +3653,43 @@ E3View_PickStack_EndDecomposedObject(TQ3ViewObject theView)
 
 
 //=============================================================================
-//      E3View_PickStack_PopGroup : Pop a group off the pick path.
+//      E3View_Replay_EndCullTest : Finish a recorded group culling test.
 //-----------------------------------------------------------------------------
 void
-E3View_PickStack_PopGroup(TQ3ViewObject theView)
+E3View_Replay_EndCullTest(TQ3ViewObject theView)
 	{
-	TQ3HitPath* pickedPath = &( (E3View*) theView )->instanceData.pickedPath ;
-
-
-
-	// Validate our state
-	Q3_ASSERT ( ( (E3View*) theView )->instanceData.viewMode == kQ3ViewModePicking ) ;
+	E3View*					view = (E3View*) theView ;
+	TQ3ViewReplayBuffer&	theBuffer( *view->instanceData.replayBuffer ) ;
 
 
 
-	// If we are inside a decomposed object, never mind
-	if ( ( (E3View*) theView )->instanceData.pickDecomposeCount > 0 )
-		return;
-
-
-
-	// Make sure that there's at least one slot defined
-	Q3_ASSERT ( pickedPath->depth     != 0 ) ;
-	Q3_ASSERT ( pickedPath->positions != NULL ) ;
-
+	// Find the matching test
+	Q3_REQUIRE( ! theBuffer.openCullTests.empty () ) ;
+	TQ3Uns32 beginIndex = theBuffer.openCullTests[ (int) ( theBuffer.openCullTests.size () - 1 ) ] ;
+	theBuffer.openCullTests.resize ( theBuffer.openCullTests.size () - 1 ) ;
 
 
-	// Shrink the positions array. Note that we just decrement the count
-	// rather than shrinking the array, since future groups would cause
-	// the array to be resized - which realloc will skip if the array
-	// has already been extended.
-	pickedPath->depth-- ;
-
 
+	// Restore the view stack if we hid the group from the renderer
+	if ( ! theBuffer.theCommands[ (int) beginIndex ].wasVisible )
+		{
+		Q3_ASSERT( view->instanceData.replayMuteCount > 0 ) ;
+		view->instanceData.replayMuteCount-- ;
 
-	// If this was the last group, remove the root object
-	if ( pickedPath->depth == 0 )
-		Q3Object_CleanDispose ( & pickedPath->rootGroup ) ;
+		view->instanceData.replaySuspendCount++ ;
+		if ( view->instanceData.viewStack != NULL )
+			e3view_stack_pop ( view ) ;
+		view->instanceData.replaySuspendCount-- ;
+		}
 
 
 
-	// Remove our reference to the picked object
-	E3Shared_Replace ( & ( (E3View*) theView )->instanceData.pickedObject, NULL ) ;
+	// Record the end of the group, so later passes can skip it
+	if ( view->instanceData.replayState == kQ3ViewReplayRecording )
+		{
+		e3view_replay_add_command ( view, kQ3ViewReplayCommandCullEnd ) ;
+		theBuffer.theCommands[ (int) beginIndex ].commandParam = theBuffer.theCommands.size () - 1 ;
+		}
 	}
 
 
@@ -2673,15 +3699,21 @@ E3View_PickStack_PopGroup(TQ3ViewObject theView)
 //=============================================================================
 //      E3View_State_AddMatrixLocalToWorld : Add to the local-to-world matrix.
 //-----------------------------------------------------------------------------
+//		Note :	theKind must describe theMatrix, and lets us skip the terms of
+//				the product which are known to be 0 or 1. Callers which do not
+//				know the kind of their matrix can pass E3Matrix4x4_GetKind.
+//-----------------------------------------------------------------------------
 TQ3Status
-E3View_State_AddMatrixLocalToWorld(TQ3ViewObject theView, const TQ3Matrix4x4 *theMatrix)
+E3View_State_AddMatrixLocalToWorld(TQ3ViewObject theView, const TQ3Matrix4x4 *theMatrix, TQ3MatrixKind theKind)
 	{
 	TQ3Matrix4x4	tmpMatrix;
 
 
 
 	// Validate our state
-	Q3_ASSERT(Q3_VALID_PTR( ( (E3View*) theView )->instanceData.viewStack));
+	const TQ3ViewStackItem* theItem = ( (E3View*) theView )->instanceData.viewStack ;
+	Q3_ASSERT(Q3_VALID_PTR(theItem));
+	Q3_ASSERT(theKind == kQ3MatrixKindGeneral || E3Matrix4x4_GetKind(theMatrix) != kQ3MatrixKindGeneral);
 
 
 
@@ -2692,9 +3724,13 @@ E3View_State_AddMatrixLocalToWorld(TQ3ViewObject theView, const TQ3Matrix4x4 *th
 
 
 	// Accumulate the local to world transform
-	Q3Matrix4x4_Multiply ( theMatrix, E3View_State_GetMatrixLocalToWorld(theView), &tmpMatrix ) ;
+	TQ3MatrixKind worldKind = theItem->matrixLocalToWorldKind ;
+	
+	E3Matrix4x4_MultiplyKind ( theMatrix, theKind, &theItem->matrixLocalToWorld, worldKind, &tmpMatrix ) ;
 
-	return E3View_State_SetMatrix ( theView, kQ3MatrixStateLocalToWorld, &tmpMatrix, NULL, NULL ) ;
+	return e3view_state_set_matrix ( (E3View*) theView, kQ3MatrixStateLocalToWorld,
+									 &tmpMatrix, (theKind > worldKind) ? theKind : worldKind,
+									 NULL, NULL ) ;
 	}
 
 
@@ -2718,6 +3754,44 @@ E3View_State_GetMatrixLocalToWorld(TQ3ViewObject theView)
 
 
 
+//=============================================================================
+//      E3View_State_GetMatrixLocalToWorldKind : Get the local-to-world kind.
+//-----------------------------------------------------------------------------
+TQ3MatrixKind
+E3View_State_GetMatrixLocalToWorldKind(TQ3ViewObject theView)
+	{
+	// Validate our state
+	Q3_ASSERT(Q3_VALID_PTR(( (E3View*) theView )->instanceData.viewStack ) ) ;
+
+
+
+	// Return the state
+	return ( (E3View*) theView )->instanceData.viewStack->matrixLocalToWorldKind ;
+	}
+
+
+
+
+
+//=============================================================================
+//      E3View_State_GetMatrixLocalToCameraKind : Get the local-to-camera kind.
+//-----------------------------------------------------------------------------
+TQ3MatrixKind
+E3View_State_GetMatrixLocalToCameraKind(TQ3ViewObject theView)
+	{
+	// Validate our state
+	const TQ3ViewStackItem* theItem = ( (E3View*) theView )->instanceData.viewStack ;
+	Q3_ASSERT(Q3_VALID_PTR(theItem));
+
+
+
+	// Return the state
+	return (theItem->matrixLocalToWorldKind > theItem->matrixWorldToCameraKind) ?
+			theItem->matrixLocalToWorldKind : theItem->matrixWorldToCameraKind ;
+	}
+
+
+
 //=============================================================================
 //      E3View_State_GetMatrixLocalToFrustum : Get the local-to-frustum matrix.
 //-----------------------------------------------------------------------------
@@ -2728,9 +3802,11 @@ E3View_State_GetMatrixLocalToFrustum( TQ3ViewObject inView )
 	
 	if (! theView->instanceData.isLocalToFrustumValid)
 	{
-		Q3Matrix4x4_Multiply(
+		E3Matrix4x4_MultiplyKind(
 			&theView->instanceData.viewStack->matrixLocalToCamera,
+			E3View_State_GetMatrixLocalToCameraKind( inView ),
 			&theView->instanceData.viewStack->matrixCameraToFrustum,
+			kQ3MatrixKindGeneral,
 			&theView->instanceData.matrixLocalToFrustum );
 		
 		E3Math_CalcLocalFrustumPlanes(
@@ -2845,53 +3921,15 @@ E3View_State_SetMatrix(TQ3ViewObject			theView,
 							const TQ3Matrix4x4	*worldToCamera,
 							const TQ3Matrix4x4	*cameraToFrustum)
 	{
-	// Validate our state
-	TQ3ViewData& instanceData( ( (E3View*) theView )->instanceData );
-	Q3_ASSERT ( Q3_VALID_PTR ( instanceData.viewStack ) ) ;
-
-
-
-	// Set the matrices which have changed
-	TQ3ViewStackState stateChange = kQ3ViewStateNone;
-	
-	if (theState & kQ3MatrixStateLocalToWorld)
-		{
-		Q3_ASSERT(Q3_VALID_PTR(localToWorld));
-		stateChange                                 |= kQ3ViewStateMatrixLocalToWorld;
-		instanceData.viewStack->matrixLocalToWorld = *localToWorld;
-		}
-	
-	if (theState & kQ3MatrixStateWorldToCamera)
-		{
-		Q3_ASSERT(Q3_VALID_PTR(worldToCamera));
-		stateChange                                  |= kQ3ViewStateMatrixWorldToCamera;
-		Q3_ASSERT( isfinite( worldToCamera->value[0][0] ) );
-		instanceData.viewStack->matrixWorldToCamera = *worldToCamera;
-		}
+	// Classify the local to world matrix, and set the matrices
+	TQ3MatrixKind localToWorldKind = kQ3MatrixKindGeneral ;
 	
-	if ( (theState & (kQ3MatrixStateLocalToWorld | kQ3MatrixStateWorldToCamera)) != 0 )
-	{
-		Q3Matrix4x4_Multiply( &instanceData.viewStack->matrixLocalToWorld,
-			&instanceData.viewStack->matrixWorldToCamera,
-			&instanceData.viewStack->matrixLocalToCamera );
-	}
+	if ( (theState & kQ3MatrixStateLocalToWorld) && localToWorld != NULL )
+		localToWorldKind = E3Matrix4x4_GetKind( localToWorld ) ;
 	
-	if (theState & kQ3MatrixStateCameraToFrustum)
-		{
-		Q3_ASSERT(Q3_VALID_PTR(cameraToFrustum));
-		stateChange                                    |= kQ3ViewStateMatrixCameraToFrustum;
-		instanceData.viewStack->matrixCameraToFrustum = *cameraToFrustum;
-		}
-
-
-	// Invalidate caches
-	instanceData.isLocalToFrustumValid = false;
-	instanceData.isLocalToFrustumInverseValid = false;
-
-
-	// Update the renderer
-	Q3_ASSERT(stateChange != kQ3ViewStateNone);
-	return e3view_stack_update ( (E3View*) theView, stateChange) ;
+	return e3view_state_set_matrix ( (E3View*) theView, theState,
+									 localToWorld, localToWorldKind,
+									 worldToCamera, cameraToFrustum ) ;
 	}
 
 
@@ -2917,6 +3955,7 @@ E3View_State_SetShaderIllumination(TQ3ViewObject theView, const TQ3IlluminationS
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateShaderIllumination ) ;
 	E3Shared_Replace ( & ( (E3View*) theView )->instanceData.viewStack->shaderIllumination, theData ) ;
 
 
@@ -2944,6 +3983,7 @@ E3View_State_SetShaderSurface(	TQ3ViewObject theView, const TQ3SurfaceShaderObje
 	if ( ( (E3View*) theView )->instanceData.viewStack->shaderSurface != theData )
 		{
 		// Set the value
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateShaderSurface ) ;
 		E3Shared_Replace ( & ( (E3View*) theView )->instanceData.viewStack->shaderSurface, theData ) ;
 
 
@@ -2972,6 +4012,7 @@ E3View_State_SetStyleSubdivision(TQ3ViewObject theView, const TQ3SubdivisionStyl
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleSubdivision ) ;
 	( (E3View*) theView )->instanceData.viewStack->styleSubdivision = *theData ;
 
 
@@ -3002,6 +4043,7 @@ E3View_State_SetStylePickID(TQ3ViewObject theView, TQ3Uns32 pickID)
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStylePickID ) ;
 	( (E3View*) theView )->instanceData.viewStack->stylePickID = pickID ;
 
 
@@ -3026,6 +4068,7 @@ E3View_State_SetStylePickParts(TQ3ViewObject theView, TQ3PickParts pickParts)
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStylePickParts ) ;
 	( (E3View*) theView )->instanceData.viewStack->stylePickParts = pickParts ;
 
 
@@ -3050,6 +4093,7 @@ E3View_State_SetStyleCastShadows(TQ3ViewObject theView, TQ3Boolean castShadows)
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleCastShadows ) ;
 	( (E3View*) theView )->instanceData.viewStack->styleCastShadows = castShadows ;
 
 
@@ -3074,6 +4118,7 @@ E3View_State_SetStyleReceiveShadows(TQ3ViewObject theView, TQ3Boolean receiveSha
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleReceiveShadows ) ;
 	( (E3View*) theView )->instanceData.viewStack->styleReceiveShadows = receiveShadows;
 
 
@@ -3100,6 +4145,7 @@ E3View_State_SetStyleFill(TQ3ViewObject theView, TQ3FillStyle fillStyle)
 	if ( ( (E3View*) theView )->instanceData.viewStack->styleFill != fillStyle )
 		{
 		// Set the value
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleFill ) ;
 		( (E3View*) theView )->instanceData.viewStack->styleFill = fillStyle ;
 
 
@@ -3127,6 +4173,7 @@ E3View_State_SetStyleBackfacing(TQ3ViewObject theView, TQ3BackfacingStyle backfa
 	if ( ( (E3View*) theView )->instanceData.viewStack->styleBackfacing != backfacingStyle )
 		{
 		// Set the value
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleBackfacing ) ;
 		( (E3View*) theView )->instanceData.viewStack->styleBackfacing = backfacingStyle ;
 
 
@@ -3154,6 +4201,7 @@ E3View_State_SetStyleInterpolation(TQ3ViewObject theView, TQ3InterpolationStyle
 	if ( ( (E3View*) theView )->instanceData.viewStack->styleInterpolation != interpolationStyle )
 		{
 		// Set the value
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleInterpolation ) ;
 		( (E3View*) theView )->instanceData.viewStack->styleInterpolation = interpolationStyle ;
 
 
@@ -3179,6 +4227,7 @@ E3View_State_SetStyleHighlight(TQ3ViewObject theView, TQ3AttributeSet highlightA
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleHighlight ) ;
 	E3Shared_Replace ( & ( (E3View*) theView )->instanceData.viewStack->styleHighlight, highlightAttribute ) ;
 
 
@@ -3205,6 +4254,7 @@ E3View_State_SetStyleOrientation(TQ3ViewObject theView, TQ3OrientationStyle fron
 	if ( ( (E3View*) theView )->instanceData.viewStack->styleOrientation != frontFacingDirection )
 		{
 		// Set the value
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleOrientation ) ;
 		( (E3View*) theView )->instanceData.viewStack->styleOrientation = frontFacingDirection ;
 
 
@@ -3235,6 +4285,7 @@ E3View_State_SetStyleAntiAlias(TQ3ViewObject theView, const TQ3AntiAliasStyleDat
 	// so we can avoid updating the renderer if the style state does not change.
 	if ( memcmp ( & ( (E3View*) theView )->instanceData.viewStack->styleAntiAlias, theData, sizeof ( TQ3AntiAliasStyleData ) ) != 0 )
 		{
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleAntiAlias ) ;
 		( (E3View*) theView )->instanceData.viewStack->styleAntiAlias = *theData ;
 		e3view_stack_update ( (E3View*) theView, kQ3ViewStateStyleAntiAlias ) ;
 		}
@@ -3261,6 +4312,7 @@ E3View_State_SetStyleFog(TQ3ViewObject theView, const TQ3FogStyleData *theData)
 	// so we can avoid updating the renderer if the style state does not change.
 	if ( memcmp ( & ( (E3View*) theView )->instanceData.viewStack->styleFog, theData, sizeof ( TQ3FogStyleData ) ) != 0 )
 		{
+		e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleFog ) ;
 		( (E3View*) theView )->instanceData.viewStack->styleFog = *theData ;
 		e3view_stack_update ( (E3View*) theView, kQ3ViewStateStyleFog ) ;
 		}
@@ -3282,6 +4334,7 @@ E3View_State_SetStyleLineWidth(TQ3ViewObject theView, float inWidth)
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateStyleLineWidth ) ;
 	( (E3View*) theView )->instanceData.viewStack->styleLineWidth = inWidth;
 
 
@@ -3306,6 +4359,7 @@ E3View_State_SetAttributeSurfaceUV(TQ3ViewObject theView, const TQ3Param2D *theD
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeSurfaceUV ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeSurfaceUV = *theData ;
 
 
@@ -3330,6 +4384,7 @@ E3View_State_SetAttributeShadingUV(TQ3ViewObject theView, const TQ3Param2D *theD
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeShadingUV ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeShadingUV = *theData ;
 
 
@@ -3354,6 +4409,7 @@ E3View_State_SetAttributeNormal(TQ3ViewObject theView, const TQ3Vector3D *theDat
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeNormal ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeNormal = *theData ;
 
 
@@ -3378,6 +4434,7 @@ E3View_State_SetAttributeAmbientCoefficient(TQ3ViewObject theView, const float *
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeAmbientCoefficient ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeAmbientCoefficient = *theData ;
 
 
@@ -3402,6 +4459,7 @@ E3View_State_SetAttributeDiffuseColor(TQ3ViewObject theView, const TQ3ColorRGB *
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeDiffuseColour ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeDiffuseColor = *theData ;
 
 
@@ -3426,6 +4484,7 @@ E3View_State_SetAttributeSpecularColor(TQ3ViewObject theView, const TQ3ColorRGB
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeSpecularColour ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeSpecularColor = *theData ;
 
 
@@ -3450,6 +4509,7 @@ E3View_State_SetAttributeSpecularControl(TQ3ViewObject theView, const float *the
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeSpecularControl ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeSpecularControl = *theData ;
 
 
@@ -3474,6 +4534,7 @@ E3View_State_SetAttributeTransparencyColor(TQ3ViewObject theView, const TQ3Color
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeTransparencyColour ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeTransparencyColor = *theData ;
 
 
@@ -3498,6 +4559,7 @@ E3View_State_SetAttributeEmissiveColor(TQ3ViewObject theView, const TQ3ColorRGB
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeEmissiveColor ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeEmissiveColor = *theData ;
 
 
@@ -3522,6 +4584,7 @@ E3View_State_SetAttributeSurfaceTangent(TQ3ViewObject theView, const TQ3Tangent2
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeSurfaceTangent ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeSurfaceTangent = *theData ;
 
 
@@ -3546,6 +4609,7 @@ E3View_State_SetAttributeHighlightState(TQ3ViewObject theView, const TQ3Switch *
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateAttributeHighlightState ) ;
 	( (E3View*) theView )->instanceData.viewStack->attributeHighlightState = *theData ;
 
 
@@ -3570,6 +4634,7 @@ E3View_State_SetAttributeSurfaceShader(TQ3ViewObject theView, const TQ3SurfaceSh
 
 
 	// Set the value
+	e3view_stack_save ( (E3View*) theView, kQ3ViewStateShaderSurface ) ;
 	E3Shared_Replace ( & ( (E3View*) theView )->instanceData.viewStack->shaderSurface, *theData ) ;
 
 
@@ -3582,6 +4647,76 @@ E3View_State_SetAttributeSurfaceShader(TQ3ViewObject theView, const TQ3SurfaceSh
 
 
 
+//=============================================================================
+//      E3View_State_SetAttributes : Set several attributes at once.
+//-----------------------------------------------------------------------------
+//		Note :	Used to submit the built-in attributes of an attribute set in
+//				one step. attributeData is indexed by attribute type, and only
+//				the types in theMask are read.
+//
+//				Values which match the current state are skipped, and the
+//				renderer is updated once for everything that did change.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3View_State_SetAttributes(TQ3ViewObject theView, TQ3XAttributeMask theMask, const void *const *attributeData)
+	{
+	E3View*				view = (E3View*) theView ;
+	TQ3ViewStackState	stateChange = kQ3ViewStateNone ;
+
+
+
+	// If the stack is empty, we're done
+	TQ3ViewStackItem* theItem = view->instanceData.viewStack ;
+	if ( theItem == NULL )
+		return kQ3Success ;
+
+	Q3_ASSERT ( Q3_VALID_PTR ( theItem ) ) ;
+
+
+
+	// Copy the values which differ from the current state
+	for ( TQ3Uns32 theType = kQ3AttributeTypeSurfaceUV ; theType < kQ3AttributeTypeNumTypes ; ++theType )
+		{
+		if ( ( theMask & ( 1 << ( theType - 1 ) ) ) == 0 )
+			continue ;
+
+		const TQ3ViewReplayField& theField( kViewAttributeFields[ theType ] ) ;
+		TQ3Uns8* fieldData = ( (TQ3Uns8*) theItem ) + theField.fieldOffset ;
+
+		if ( theField.isObject )
+			{
+			TQ3Object theObject = * ( (const TQ3Object*) attributeData[ theType ] ) ;
+			if ( * ( (TQ3Object*) fieldData ) == theObject )
+				continue ;
+
+			e3view_stack_save ( view, theField.stateMask ) ;
+			E3Shared_Replace ( (TQ3Object*) fieldData, theObject ) ;
+			}
+		else
+			{
+			if ( memcmp ( fieldData, attributeData[ theType ], theField.fieldSize ) == 0 )
+				continue ;
+			
+			e3view_stack_save ( view, theField.stateMask ) ;
+			Q3Memory_Copy ( attributeData[ theType ], fieldData, theField.fieldSize ) ;
+			}
+
+		stateChange |= theField.stateMask ;
+		}
+
+
+
+	// Update the renderer
+	if ( stateChange == kQ3ViewStateNone )
+		return kQ3Success ;
+
+	return e3view_stack_update ( view, stateChange ) ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3View_New : Create a TQ3ViewObject.
 //-----------------------------------------------------------------------------
@@ -3859,6 +4994,13 @@ E3View_StartRendering(TQ3ViewObject theView)
 
 
 
+	// Record the first pass, if further passes may replay it
+	if ( qd3dStatus != kQ3Failure && ( (E3View*) theView )->instanceData.viewPass == 1 &&
+		 ( (E3View*) theView )->instanceData.allowPassReplay )
+		e3view_replay_begin_recording ( (E3View*) theView ) ;
+
+
+
 	// Handle failure
 	if ( qd3dStatus == kQ3Failure )
 		(void) e3view_submit_end ( (E3View*) theView, kQ3ViewStatusError ) ;
@@ -3876,18 +5018,55 @@ E3View_StartRendering(TQ3ViewObject theView)
 TQ3ViewStatus
 E3View_EndRendering(TQ3ViewObject theView)
 	{
-	TQ3ViewStatus viewStatus = kQ3ViewStatusDone ;
+	E3View*			view       = (E3View*) theView ;
+	TQ3ViewStatus	viewStatus = kQ3ViewStatusDone ;
 
 
 
 	// If we're still in the submit loop, end the pass
-	if ( ( (E3View*) theView )->instanceData.viewState == kQ3ViewStateSubmitting )
+	if ( view->instanceData.viewState == kQ3ViewStateSubmitting )
+		{
+		e3view_replay_end_recording ( view ) ;
 		viewStatus = E3Renderer_Method_EndPass ( theView ) ;
+		}
 
 
 
 	// End the submit loop
-	return e3view_submit_end ( (E3View*) theView, viewStatus ) ;
+	viewStatus = e3view_submit_end ( view, viewStatus ) ;
+
+
+
+	// Replay the recorded pass for as long as the renderer needs more passes,
+	// rather than asking the application to submit the scene again. The
+	// renderer still ends a pass which failed, but the frame ends with an error.
+	while ( viewStatus == kQ3ViewStatusRetraverse && view->instanceData.replayState == kQ3ViewReplayRecorded )
+		{
+		TQ3Status qd3dStatus = e3view_replay_submit ( view ) ;
+
+		viewStatus = kQ3ViewStatusDone ;
+		if ( view->instanceData.viewState == kQ3ViewStateSubmitting )
+			viewStatus = E3Renderer_Method_EndPass ( theView ) ;
+
+		if ( qd3dStatus == kQ3Failure )
+			viewStatus = kQ3ViewStatusError ;
+
+		viewStatus = e3view_submit_end ( view, viewStatus ) ;
+		}
+
+
+
+	// Release the recording once the frame is finished
+	if ( viewStatus != kQ3ViewStatusRetraverse )
+		e3view_replay_discard ( view ) ;
+
+
+
+	// If the frame is complete, age the immediate mode geometry cache
+	if ( viewStatus == kQ3ViewStatusDone )
+		E3Geometry_ImmediateCacheEndFrame () ;
+	
+	return viewStatus ;
 	}
 
 
@@ -4480,6 +5659,24 @@ E3View_IsBoundingBoxVisible(TQ3ViewObject theView, const TQ3BoundingBox *theBBox
 
 
 
+//=============================================================================
+//      E3View_IsBoundingBoxArrayVisible : See which bounding boxes are visible.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3View_IsBoundingBoxArrayVisible(TQ3ViewObject theView, TQ3Uns32 numBoxes,
+								 const TQ3BoundingBox *theBBoxes, TQ3Uns32 *visibleMask)
+{
+
+
+	E3BoundingBox_IntersectViewFrustumArray(theView, numBoxes, theBBoxes, visibleMask);
+	
+	return(kQ3Success);
+}
+
+
+
+
+
 //=============================================================================
 //      E3View_AllowAllGroupCulling : Set group culling behaviour.
 //-----------------------------------------------------------------------------
@@ -4496,6 +5693,22 @@ E3View_AllowAllGroupCulling(TQ3ViewObject theView, TQ3Boolean allowCulling)
 
 
 
+//=============================================================================
+//      E3View_AllowPassReplay : Set pass replay behaviour.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3View_AllowPassReplay(TQ3ViewObject theView, TQ3Boolean allowReplay)
+	{
+	// Update our state
+	( (E3View*) theView )->instanceData.allowPassReplay = allowReplay ;
+
+	return kQ3Success ;
+	}
+
+
+
+
+
 //=============================================================================
 //      E3View_IsGroupCullingAllowed : Access group culling state.
 //-----------------------------------------------------------------------------
@@ -4509,6 +5722,44 @@ E3View_IsGroupCullingAllowed( TQ3ViewObject theView )
 
 
 
+//=============================================================================
+//      E3View_SetPretestedGroup : Mark a group as already found visible.
+//-----------------------------------------------------------------------------
+//		Note :	Called by a group which has culled its members in bulk, just
+//				before it submits a member group that passed, so that the
+//				member can skip its own test.
+//-----------------------------------------------------------------------------
+void
+E3View_SetPretestedGroup( TQ3ViewObject theView, TQ3GroupObject theGroup )
+{
+	( (E3View*) theView )->instanceData.pretestedGroup = theGroup;
+}
+
+
+
+
+
+//=============================================================================
+//      E3View_TakePretestedGroup : Check whether a group was found visible.
+//-----------------------------------------------------------------------------
+//		Note :	Returns kQ3True if theGroup was marked by its parent, and
+//				clears the mark in either case.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+E3View_TakePretestedGroup( TQ3ViewObject theView, TQ3GroupObject theGroup )
+{
+	E3View* view = (E3View*) theView;
+	TQ3Boolean wasTested = (TQ3Boolean) ( theGroup != NULL && view->instanceData.pretestedGroup == theGroup );
+	
+	view->instanceData.pretestedGroup = NULL;
+	
+	return wasTested;
+}
+
+
+
+
+
 //=============================================================================
 //      E3View_TransformLocalToWorld : Transform a point from local->world.
 //-----------------------------------------------------------------------------
@@ -45,7 +45,7 @@
 //=============================================================================
 //      Include files
 //-----------------------------------------------------------------------------
-// Include files go here
+#include "E3Math.h"
 
 
 
@@ -119,6 +119,7 @@ void					E3View_EndFrame(TQ3ViewObject theView);
 TQ3ViewMode				E3View_GetViewMode(TQ3ViewObject theView);
 TQ3ViewState			E3View_GetViewState(TQ3ViewObject theView);
 TQ3BoundingMethod		E3View_GetBoundingMethod(TQ3ViewObject theView);
+TQ3BoundingBox			*E3View_AccessBoundingBox(TQ3ViewObject theView);
 void					E3View_GetRayThroughPickPoint(TQ3ViewObject theView, TQ3Ray3D *theRay);
 void					E3View_UpdateBounds(TQ3ViewObject theView, TQ3Uns32 numPoints, TQ3Uns32 pointStride, const TQ3Point3D *thePoints);
 TQ3Status				E3View_PickStack_PushGroup(TQ3ViewObject theView, TQ3GroupObject theGroup);
@@ -130,8 +131,16 @@ void					E3View_PickStack_BeginDecomposedObject(TQ3ViewObject theView);
 void					E3View_PickStack_EndDecomposedObject(TQ3ViewObject theView);
 void					E3View_PickStack_PopGroup(TQ3ViewObject theView);
 
-TQ3Status						E3View_State_AddMatrixLocalToWorld(TQ3ViewObject theView, const TQ3Matrix4x4 *theMatrix);
+TQ3Boolean				E3View_Replay_RecordGeometry(TQ3ViewObject theView, TQ3ObjectType geomType, TQ3GeometryObject theGeom, const void *geomData);
+void					E3View_Replay_SuspendRecording(TQ3ViewObject theView, TQ3Boolean suspend);
+TQ3Boolean				E3View_Replay_IsRecording(TQ3ViewObject theView);
+TQ3Boolean				E3View_Replay_BeginCullTest(TQ3ViewObject theView, const TQ3BoundingBox *theBBox, TQ3Boolean isVisible);
+void					E3View_Replay_EndCullTest(TQ3ViewObject theView);
+
+TQ3Status						E3View_State_AddMatrixLocalToWorld(TQ3ViewObject theView, const TQ3Matrix4x4 *theMatrix, TQ3MatrixKind theKind);
 const TQ3Matrix4x4				*E3View_State_GetMatrixLocalToWorld(TQ3ViewObject theView);
+TQ3MatrixKind					E3View_State_GetMatrixLocalToWorldKind(TQ3ViewObject theView);
+TQ3MatrixKind					E3View_State_GetMatrixLocalToCameraKind(TQ3ViewObject theView);
 const TQ3Matrix4x4&				E3View_State_GetMatrixLocalToFrustum( TQ3ViewObject theView );
 const TQ3Matrix4x4&				E3View_State_GetMatrixFrustumToLocal( TQ3ViewObject theView );
 const TQ3Matrix4x4&				E3View_State_GetMatrixCameraToFrustum( TQ3ViewObject theView );
@@ -167,6 +176,7 @@ void							E3View_State_SetAttributeEmissiveColor(TQ3ViewObject theView, const T
 void							E3View_State_SetAttributeSurfaceTangent(TQ3ViewObject theView, const TQ3Tangent2D *theData);
 void							E3View_State_SetAttributeHighlightState(TQ3ViewObject theView, const TQ3Switch *theData);
 void							E3View_State_SetAttributeSurfaceShader(TQ3ViewObject theView, const TQ3SurfaceShaderObject *theData);
+TQ3Status						E3View_State_SetAttributes(TQ3ViewObject theView, TQ3XAttributeMask theMask, const void *const *attributeData);
 
 TQ3ViewObject			E3View_New(void);
 TQ3ViewObject			E3View_NewWithDefaults(TQ3ObjectType drawContextType, void *drawContextTarget);
@@ -195,8 +205,12 @@ TQ3Status				E3View_SetIdleMethod(TQ3ViewObject theView, TQ3ViewIdleMethod idleM
 TQ3Status				E3View_SetIdleProgressMethod(TQ3ViewObject theView, TQ3ViewIdleProgressMethod idleMethod, const void *idleData);
 TQ3Status				E3View_SetEndFrameMethod(TQ3ViewObject theView, TQ3ViewEndFrameMethod endFrame, void *endFrameData);
 TQ3Boolean				E3View_IsBoundingBoxVisible(TQ3ViewObject theView, const TQ3BoundingBox *theBBox);
+TQ3Status				E3View_IsBoundingBoxArrayVisible(TQ3ViewObject theView, TQ3Uns32 numBoxes, const TQ3BoundingBox *theBBoxes, TQ3Uns32 *visibleMask);
 TQ3Status				E3View_AllowAllGroupCulling(TQ3ViewObject theView, TQ3Boolean allowCulling);
 TQ3Boolean				E3View_IsGroupCullingAllowed( TQ3ViewObject theView );
+void					E3View_SetPretestedGroup( TQ3ViewObject theView, TQ3GroupObject theGroup );
+TQ3Boolean				E3View_TakePretestedGroup( TQ3ViewObject theView, TQ3GroupObject theGroup );
+TQ3Status				E3View_AllowPassReplay(TQ3ViewObject theView, TQ3Boolean allowReplay);
 TQ3Status				E3View_TransformLocalToWorld(TQ3ViewObject theView, const TQ3Point3D *localPoint, TQ3Point3D *worldPoint);
 TQ3Status				E3View_TransformLocalToWindow(TQ3ViewObject theView, const TQ3Point3D *localPoint, TQ3Point2D *windowPoint);
 TQ3Status				E3View_TransformWorldToWindow(TQ3ViewObject theView, const TQ3Point3D *worldPoint, TQ3Point2D *windowPoint);
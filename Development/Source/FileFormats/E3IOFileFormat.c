@@ -47,12 +47,52 @@
 #include "E3IO.h"
 #include "E3IOFileFormat.h"
 #include "E3FFR_3DMF.h"
+#include "E3Storage.h"
 #include "E3View.h"
 
 
 
 
 
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+// Exponent bits of an IEEE single, all set for infinities and NaNs
+const TQ3Uns32 kFloat32ExponentMask								= 0x7F800000;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      e3fileformat_replace_nonfinite : Replace infinities and NaNs by 1.0.
+//-----------------------------------------------------------------------------
+//		Note :	As for the single-value reads, a warning is posted for each
+//				number that is replaced.
+//-----------------------------------------------------------------------------
+static void
+e3fileformat_replace_nonfinite(TQ3Uns32 numNums, TQ3Float32* data)
+{	const TQ3Uns32		*theBits = (const TQ3Uns32 *) data;
+	TQ3Uns32			n;
+
+
+
+	for (n = 0; n < numNums; ++n)
+		{
+		if ((theBits[n] & kFloat32ExponentMask) == kFloat32ExponentMask)
+			{
+			E3ErrorManager_PostWarning( kQ3WarningReadInfiniteFloatingPointNumber );
+			data[n] = 1.0f;
+			}
+		}
+}
+
+
+
+
+
 //=============================================================================
 //      Public functions
 //-----------------------------------------------------------------------------
@@ -145,7 +185,7 @@ E3FileFormat_Init(TQ3FileFormatObject theFileFormat, TQ3StorageObject storage)
 	instanceData->readInGroup = kQ3True;
 
 	
-	if(Q3Storage_GetSize(storage, &instanceData->logicalEOF) == kQ3Failure)
+	if( ( (E3Storage*) storage )->GetSize64 ( &instanceData->logicalEOF ) == kQ3Failure)
 		return kQ3Failure;
 	}
 	
@@ -277,6 +317,76 @@ E3FileFormat_GenericReadBinaryArray_32(TQ3FileFormatObject format, TQ3Uns32 numN
 
 
 
+//=============================================================================
+//      E3FileFormat_GenericReadBinaryArray_Float32 : Reads array of floats
+//													   and validates them.
+//-----------------------------------------------------------------------------
+//		Note :	The check is a single branch-free pass, which the compiler
+//				can vectorize. Invalid numbers are only searched for when
+//				the pass finds that there are some.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3FileFormat_GenericReadBinaryArray_Float32(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Float32* data)
+{	TQ3Status		result;
+	const TQ3Uns32	*theBits = (const TQ3Uns32 *) data;
+	TQ3Uns32		n, nonFinite = 0;
+
+
+
+	result = E3FileFormat_GenericReadBinary_Raw (format, (unsigned char*)data, numNums * 4);
+	
+	if (result == kQ3Success)
+	{
+		for (n = 0; n < numNums; ++n)
+		{
+			nonFinite |= ((theBits[n] & kFloat32ExponentMask) == kFloat32ExponentMask);
+		}
+		
+		if (nonFinite != 0)
+			e3fileformat_replace_nonfinite( numNums, data );
+	}
+	return result;
+}
+
+
+
+
+
+//=============================================================================
+//      E3FileFormat_GenericReadBinSwapArray_Float32 : Reads array of floats,
+//									swapping the byte order and validating them.
+//-----------------------------------------------------------------------------
+//		Note :	Swapping and checking are done in the same pass.
+//-----------------------------------------------------------------------------
+TQ3Status
+E3FileFormat_GenericReadBinSwapArray_Float32(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Float32* data)
+{	TQ3Status		result;
+	TQ3Uns32		*theBits = (TQ3Uns32 *) data;
+	TQ3Uns32		n, theValue, nonFinite = 0;
+
+
+
+	result = E3FileFormat_GenericReadBinary_Raw (format, (unsigned char*)data, numNums * 4);
+	
+	if (result == kQ3Success)
+	{
+		for (n = 0; n < numNums; ++n)
+		{
+			theValue    = E3EndianSwap32( theBits[n] );
+			theBits[n]  = theValue;
+			nonFinite  |= ((theValue & kFloat32ExponentMask) == kFloat32ExponentMask);
+		}
+		
+		if (nonFinite != 0)
+			e3fileformat_replace_nonfinite( numNums, data );
+	}
+	return result;
+}
+
+
+
+
+
 //=============================================================================
 //      E3FileFormat_GenericReadBinary_64 : Reads 64 bits from stream.
 //-----------------------------------------------------------------------------
@@ -331,25 +441,24 @@ E3FileFormat_GenericReadBinary_StringPadded(TQ3FileFormatObject format, char* da
 	TQ3Uns32 					sizeRead = 0;
 	TQ3Status 					result = kQ3Failure;
 	TQ3FFormatBaseData			*instanceData = (TQ3FFormatBaseData *) format->FindLeafInstanceData () ;
-	TQ3Uns32					startOffset;
+	TQ3StorageOffset			startOffset;
 	TQ3Uns32					bufferSize = *ioLength;
 	
 	char* 						dataPtr = data;
 	char 						lastChar;
 
-	TQ3XStorageReadDataMethod dataRead = (TQ3XStorageReadDataMethod) instanceData->storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
+	E3Storage* storage = (E3Storage*) instanceData->storage ;
 
 	*ioLength = 0;
 	
-	if ( dataRead != NULL)
+	if ( storage != NULL)
 	{
 		startOffset = instanceData->currentStoragePosition;
 		
 		// Read bytes one at a time, until we fail to read or read a zero byte.
 		do{
-			result = dataRead( instanceData->storage,
-								instanceData->currentStoragePosition,
-								1, (TQ3Uns8 *)&lastChar, &sizeRead );
+			result = storage->GetData64( instanceData->currentStoragePosition,
+								1, (unsigned char *)&lastChar, &sizeRead );
 								
 			instanceData->currentStoragePosition++;
 			*ioLength += 1;
@@ -377,7 +486,7 @@ E3FileFormat_GenericReadBinary_StringPadded(TQ3FileFormatObject format, char* da
 		else  if (padTo4 == kQ3True){
 			// skip pad bytes
 			instanceData->currentStoragePosition = startOffset +
-				Q3Size_Pad( instanceData->currentStoragePosition - startOffset );
+				Q3Size_Pad( (TQ3Uns32) (instanceData->currentStoragePosition - startOffset) );
 		}
 		
 		if (lastChar == 0)
@@ -402,12 +511,11 @@ E3FileFormat_GenericReadBinary_Raw(TQ3FileFormatObject format, unsigned char* da
 	TQ3Status result = kQ3Failure;
 	TQ3FFormatBaseData		*instanceData = (TQ3FFormatBaseData *) format->FindLeafInstanceData ();
 
-	TQ3XStorageReadDataMethod dataRead = (TQ3XStorageReadDataMethod) instanceData->storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
+	E3Storage* storage = (E3Storage*) instanceData->storage ;
 
-	if( dataRead != NULL)
-		result = dataRead(instanceData->storage,
-							instanceData->currentStoragePosition,
-							length, (TQ3Uns8*)data, &sizeRead);
+	if( storage != NULL)
+		result = storage->GetData64(instanceData->currentStoragePosition,
+							length, data, &sizeRead);
 
 	Q3_ASSERT(sizeRead == length);
 	instanceData->currentStoragePosition += length;
@@ -541,9 +649,9 @@ E3FileFormat_GenericReadText_SkipBlanks(TQ3FileFormatObject format)
 
 
 
-	// Get the read method
-	TQ3XStorageReadDataMethod dataRead = (TQ3XStorageReadDataMethod) instanceData->storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
-	if (dataRead == NULL)
+	// Get the storage
+	E3Storage* storage = (E3Storage*) instanceData->storage ;
+	if (storage == NULL)
 		return(kQ3Failure);
 
 
@@ -551,7 +659,7 @@ E3FileFormat_GenericReadText_SkipBlanks(TQ3FileFormatObject format)
 	// Skip until we find the end of the file or a non-blank character
 	while (result == kQ3Success && instanceData->currentStoragePosition < instanceData->logicalEOF)
 		{
-		result = dataRead(instanceData->storage, instanceData->currentStoragePosition, 1, (TQ3Uns8 *)&buffer, &sizeRead);
+		result = storage->GetData64(instanceData->currentStoragePosition, 1, (unsigned char *)&buffer, &sizeRead);
 		if (buffer <= 0x20 || buffer == 0x7F) 
 			instanceData->currentStoragePosition++;
 		else
@@ -605,17 +713,19 @@ E3FileFormat_GenericReadText_ReadUntilChars(TQ3FileFormatObject format, char* bu
 	if(foundChar)
 		*foundChar = -1;
 
-	TQ3XStorageReadDataMethod dataRead = (TQ3XStorageReadDataMethod) instanceData->storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
+	E3Storage* storage = (E3Storage*) instanceData->storage ;
 	
 	// The read method may post an error if we try to read beyond the end of file
-	maxLen = E3Num_Min( maxLen, instanceData->logicalEOF - instanceData->currentStoragePosition );
+	if (instanceData->currentStoragePosition >= instanceData->logicalEOF)
+		maxLen = 0;
+	else if (instanceData->logicalEOF - instanceData->currentStoragePosition < maxLen)
+		maxLen = (TQ3Uns32) (instanceData->logicalEOF - instanceData->currentStoragePosition);
 
-	if( (dataRead != NULL) && (maxLen > 0) )
+	if( (storage != NULL) && (maxLen > 0) )
 		{
 		found = kQ3False;
-		result = dataRead(instanceData->storage,
-						instanceData->currentStoragePosition,
-						maxLen, (TQ3Uns8*)buffer, &sizeRead); // read all the data at once
+		result = storage->GetData64(instanceData->currentStoragePosition,
+						maxLen, (unsigned char*)buffer, &sizeRead); // read all the data at once
 			
 		while((result == kQ3Success)
 				&& (instanceData->currentStoragePosition < instanceData->logicalEOF) 
@@ -760,12 +870,11 @@ E3FileFormat_GenericWriteBinary_Raw(TQ3FileFormatObject format,const unsigned ch
 	TQ3Status result = kQ3Failure;
 	TQ3FFormatBaseData		*instanceData = (TQ3FFormatBaseData *) format->FindLeafInstanceData ();
 
-	TQ3XStorageWriteDataMethod dataWrite = (TQ3XStorageWriteDataMethod) instanceData->storage->GetMethod ( kQ3XMethodTypeStorageWriteData ) ;
+	E3Storage* storage = (E3Storage*) instanceData->storage ;
 
-	if( dataWrite != NULL)
-		result = dataWrite(instanceData->storage,
-							instanceData->currentStoragePosition,
-							length, (TQ3Uns8*)data, &sizeWrite);
+	if( storage != NULL)
+		result = storage->SetData64(instanceData->currentStoragePosition,
+							length, data, &sizeWrite);
 
 	Q3_ASSERT(sizeWrite == length);
 	instanceData->currentStoragePosition += length;
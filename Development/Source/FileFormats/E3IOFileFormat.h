@@ -132,6 +132,8 @@ TQ3Status				E3FileFormat_GenericReadBinaryArray_16(TQ3FileFormatObject format,
 TQ3Status				E3FileFormat_GenericReadBinSwapArray_16(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Int16* data);
 TQ3Status				E3FileFormat_GenericReadBinaryArray_32(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Int32* data);
 TQ3Status				E3FileFormat_GenericReadBinSwapArray_32(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Int32* data);
+TQ3Status				E3FileFormat_GenericReadBinaryArray_Float32(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Float32* data);
+TQ3Status				E3FileFormat_GenericReadBinSwapArray_Float32(TQ3FileFormatObject format, TQ3Uns32 numNums, TQ3Float32* data);
 
 TQ3Status				E3FileFormat_GenericReadText_SkipBlanks(TQ3FileFormatObject format);
 TQ3Status				E3FileFormat_GenericReadText_ReadUntilChars(TQ3FileFormatObject format,char* buffer,
@@ -47,6 +47,7 @@
 #include "E3FFR_3DMF_Bin.h"
 #include "E3IO.h"
 #include "E3IOData.h"
+#include "E3Storage.h"
 #include "E3FFR_3DMF_Geometry.h"
 
 
@@ -115,6 +116,19 @@ public :
 //=============================================================================
 //      Internal functions
 //-----------------------------------------------------------------------------
+//      e3read_3dmf_bin_location : Return a 64-bit 3DMF location as an offset.
+//-----------------------------------------------------------------------------
+static TQ3StorageOffset
+e3read_3dmf_bin_location(TQ3Uns32 hi, TQ3Uns32 lo)
+{
+	return((((TQ3StorageOffset) hi) << 32) | lo);
+}
+
+
+
+
+
+//=============================================================================
 //      e3read_3dmf_bin_readflag : reads an int from storage.
 //-----------------------------------------------------------------------------
 static TQ3Status
@@ -184,7 +198,7 @@ e3read_3dmf_bin_readnextelement(TQ3AttributeSet parent, E3File* theFile )
 
 	TQ3XFFormatInt32ReadMethod int32Read = (TQ3XFFormatInt32ReadMethod) format->GetMethod ( kQ3XMethodTypeFFormatInt32Read ) ;
 
-	TQ3Uns32 elemLocation = fformatData->MFData.baseData.currentStoragePosition ;
+	TQ3StorageOffset elemLocation = fformatData->MFData.baseData.currentStoragePosition ;
 	
 	TQ3Status status = int32Read ( format, &elemType ) ;
 	if(status == kQ3Success){
@@ -284,15 +298,15 @@ e3fformat_3dmf_bin_canread(TQ3StorageObject storage, TQ3ObjectType* theFileForma
 
 	*theFileFormatFound = kQ3ObjectTypeInvalid ;
 	
-	TQ3XStorageReadDataMethod readMethod = (TQ3XStorageReadDataMethod) storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
+	E3Storage* readStorage = (E3Storage*) storage ;
 	
-	if(readMethod != NULL){
+	if(readStorage != NULL){
 		// read 4 bytes, search for 3DMF or FMD3 (if swapped)
-		readMethod(storage,0, 4,(TQ3Uns8*)&label, &sizeRead);
+		readStorage->GetData64(0, 4,(unsigned char*)&label, &sizeRead);
 		if (sizeRead != 4)
 			return kQ3False;
 			
-		readMethod(storage,12, 4,(TQ3Uns8*)&flags, &sizeRead);
+		readStorage->GetData64(12, 4,(unsigned char*)&flags, &sizeRead);
 		if (sizeRead != 4)
 			return kQ3False;
 			
@@ -449,8 +463,8 @@ e3fformat_3dmf_bin_read_toc(TQ3FileFormatObject format)
 		}
 	
 	// continue with next TOC
-	if(nextToc.lo != 0UL){
-		instanceData->MFData.baseData.currentStoragePosition = nextToc.lo;
+	if(nextToc.lo != 0UL || nextToc.hi != 0){
+		instanceData->MFData.baseData.currentStoragePosition = e3read_3dmf_bin_location((TQ3Uns32) nextToc.hi, nextToc.lo);
 		status = e3fformat_3dmf_bin_read_toc(format);
 		}
 		
@@ -512,8 +526,8 @@ e3fformat_3dmf_bin_read_header ( E3File* theFile )
 	
 	if(result == kQ3True){
 		result = (TQ3Boolean)(Q3Int64_Read((TQ3Int64*)&tocPosition, theFile) != kQ3Failure);
-		if((result == kQ3True) && (tocPosition.lo != 0UL)){
-			instanceData->MFData.baseData.currentStoragePosition = tocPosition.lo;
+		if((result == kQ3True) && (tocPosition.lo != 0UL || tocPosition.hi != 0UL)){
+			instanceData->MFData.baseData.currentStoragePosition = e3read_3dmf_bin_location(tocPosition.hi, tocPosition.lo);
 			result = (TQ3Boolean)(e3fformat_3dmf_bin_read_toc(format) != kQ3Failure);
 			}
 		
@@ -619,7 +633,7 @@ e3fformat_3dmf_bin_skipobject ( E3File* theFile )
 		result = Q3Int32_Read ( (TQ3Int32*) &objectSize, theFile ) ;
 		
 	if ( result != kQ3Failure )
-		instanceData->MFData.baseData.currentStoragePosition += objectSize ;
+		instanceData->MFData.baseData.currentStoragePosition += (TQ3Uns32) objectSize ;
 		
 	E3FFormat_3DMF_Bin_Check_MoreObjects( instanceData ) ;
 	E3FFormat_3DMF_Bin_Check_ContainerEnd( instanceData ) ;
@@ -651,7 +665,7 @@ e3fformat_3dmf_bin_readobject ( E3File* theFile )
 {
 	TQ3Object 				result = NULL;
 	TQ3Object 				childObject = NULL;
-	TQ3Uns32 				previousContainer;
+	TQ3StorageOffset		previousContainer;
 	TQ3XObjectReadMethod 	readMethod = NULL;
 	TQ3XObjectReadDefaultMethod		readDefaultMethod = NULL;
 	E3ClassInfoPtr			theClass = NULL;
@@ -664,7 +678,7 @@ e3fformat_3dmf_bin_readobject ( E3File* theFile )
 	
 	TQ3XFFormatInt32ReadMethod int32Read = (TQ3XFFormatInt32ReadMethod) format->GetMethod ( kQ3XMethodTypeFFormatInt32Read ) ;
 
-	TQ3Uns32 objLocation = instanceData->MFData.baseData.currentStoragePosition ;
+	TQ3StorageOffset objLocation = instanceData->MFData.baseData.currentStoragePosition ;
 
 	TQ3ObjectType objectType ;
 	TQ3Status status = int32Read ( format, (TQ3Int32*) &objectType ) ;
@@ -689,7 +703,9 @@ e3fformat_3dmf_bin_readobject ( E3File* theFile )
 						else{
 							// still not read, read it
 							previousContainer = instanceData->MFData.baseData.currentStoragePosition;
-							instanceData->MFData.baseData.currentStoragePosition = instanceData->MFData.toc->tocEntries[i].objLocation.lo;
+							instanceData->MFData.baseData.currentStoragePosition = e3read_3dmf_bin_location(
+								instanceData->MFData.toc->tocEntries[i].objLocation.hi,
+								instanceData->MFData.toc->tocEntries[i].objLocation.lo);
 							result = theFile->ReadObject();
 							instanceData->MFData.baseData.currentStoragePosition = previousContainer;
 							}
@@ -703,7 +719,8 @@ e3fformat_3dmf_bin_readobject ( E3File* theFile )
 		else{ // objectType != 0x7266726E /*rfrn - Reference*/
 			if(status == kQ3Success) for(i = 0; i < instanceData->MFData.toc->nEntries; i++)
 				{
-					if(instanceData->MFData.toc->tocEntries[i].objLocation.lo == objLocation){
+					if(e3read_3dmf_bin_location(instanceData->MFData.toc->tocEntries[i].objLocation.hi,
+							instanceData->MFData.toc->tocEntries[i].objLocation.lo) == objLocation){
 						tocEntryIndex = i;
 						break;
 						}
@@ -923,7 +940,7 @@ e3fformat_3dmf_bin_get_nexttype ( E3File* theFile )
 	
 	TQ3XFFormatInt32ReadMethod int32Read = (TQ3XFFormatInt32ReadMethod) format->GetMethod ( kQ3XMethodTypeFFormatInt32Read ) ;
 
-	TQ3Uns32 previousPosition = instanceData->MFData.baseData.currentStoragePosition ;
+	TQ3StorageOffset previousPosition = instanceData->MFData.baseData.currentStoragePosition ;
 	
 	TQ3ObjectType result ;
 	int32Read ( format, (TQ3Int32*) &result ) ;
@@ -943,7 +960,9 @@ e3fformat_3dmf_bin_get_nexttype ( E3File* theFile )
 					result = instanceData->MFData.toc->tocEntries[i].objType;
 				else{ // We have to read the object to get the type
 					// position the file mark
-					instanceData->MFData.baseData.currentStoragePosition = instanceData->MFData.toc->tocEntries[i].objLocation.lo;
+					instanceData->MFData.baseData.currentStoragePosition = e3read_3dmf_bin_location(
+						instanceData->MFData.toc->tocEntries[i].objLocation.hi,
+						instanceData->MFData.toc->tocEntries[i].objLocation.lo);
 					result = e3fformat_3dmf_bin_get_nexttype (theFile);
 					// cache the result
 					instanceData->MFData.toc->tocEntries[i].objType = result;
@@ -1062,6 +1081,10 @@ e3fformat_3dmf_bin_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) E3FileFormat_GenericReadBinaryArray_32;
 			break;
 
+		case kQ3XMethodTypeFFormatFloat32ReadArrayValid:
+			theMethod = (TQ3XFunctionPointer) E3FileFormat_GenericReadBinaryArray_Float32;
+			break;
+
 		case kQ3XMethodTypeFFormatFloat64Read:
 			theMethod = (TQ3XFunctionPointer) E3FileFormat_GenericReadBinary_64;
 			break;
@@ -1165,6 +1188,10 @@ e3fformat_3dmf_binswap_metahandler(TQ3XMethodType methodType)
 			theMethod = (TQ3XFunctionPointer) E3FileFormat_GenericReadBinSwapArray_32;
 			break;
 
+		case kQ3XMethodTypeFFormatFloat32ReadArrayValid:
+			theMethod = (TQ3XFunctionPointer) E3FileFormat_GenericReadBinSwapArray_Float32;
+			break;
+
 		case kQ3XMethodTypeFFormatFloat64Read:
 			theMethod = (TQ3XFunctionPointer) E3FileFormat_GenericReadBinSwap_64;
 			break;
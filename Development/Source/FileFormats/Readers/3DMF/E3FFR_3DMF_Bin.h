@@ -73,7 +73,7 @@ typedef struct TE3FFormat3DMF_TypeEntry {
 
 typedef struct TE3FFormat3DMF_Bin_Data {
 	TE3FFormat3DMF_Data				MFData;
-	TQ3Uns32						containerEnd;
+	TQ3StorageOffset				containerEnd;
 	TQ3Uns32						typesNum;
 	TE3FFormat3DMF_TypeEntry*		types;
 } TE3FFormat3DMF_Bin_Data;
@@ -276,6 +276,98 @@ e3read_3dmf_spreadarray_uns8to32( TQ3Uns32 numNums, void* ioData )
 
 
 
+//=============================================================================
+//      e3read_3dmf_index_size : Size in bytes of the indices into an array.
+//-----------------------------------------------------------------------------
+//		Note :	Binary 3DMF uses the smallest integer that can hold every
+//				index into an array of the given number of items.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+e3read_3dmf_index_size( TQ3Uns32 numItems )
+{
+	if (numItems >= 0x00010000U)
+		return 4;
+	
+	else if (numItems >= 0x00000100U)
+		return 2;
+	
+	return 1;
+}
+
+
+
+//=============================================================================
+//      e3read_3dmf_read_indices : Read an array of indices into an array of
+//								 numItems items, as 32-bit integers.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3read_3dmf_read_indices( TQ3Uns32 numNums, TQ3Uns32 numItems, TQ3Uns32* outArray,
+							TQ3FileObject theFile )
+{
+	switch (e3read_3dmf_index_size( numItems ))
+	{
+		case 4:
+			return Q3Uns32_ReadArray( numNums, outArray, theFile );
+		
+		case 2:
+			if (Q3Uns16_ReadArray( numNums, (TQ3Uns16*)outArray, theFile ) != kQ3Success)
+				return kQ3Failure;
+			e3read_3dmf_spreadarray_uns16to32( numNums, outArray );
+			break;
+		
+		default:
+			if (Q3Uns8_ReadArray( numNums, (TQ3Uns8*)outArray, theFile ) != kQ3Success)
+				return kQ3Failure;
+			e3read_3dmf_spreadarray_uns8to32( numNums, outArray );
+			break;
+	}
+	
+	return kQ3Success;
+}
+
+
+
+//=============================================================================
+//      e3read_3dmf_read_vertex_points : Read the points of an array of
+//										 vertices with a single array read.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3read_3dmf_read_vertex_points( TQ3Uns32 numVertices, TQ3Vertex3D* vertices,
+								TQ3FileObject theFile )
+{	TQ3Point3D	*thePoints;
+	TQ3Status	qd3dStatus;
+	TQ3Uns32	n;
+
+
+
+	// Read the points into a temporary array
+	if (numVertices > 0xFFFFFFFFU / sizeof(TQ3Point3D))
+		return kQ3Failure;
+
+	thePoints = (TQ3Point3D *) Q3Memory_Allocate( static_cast<TQ3Uns32>(numVertices * sizeof(TQ3Point3D)) );
+	if (thePoints == NULL)
+		return kQ3Failure;
+
+	qd3dStatus = Q3Float32_ReadArray( numVertices * 3, (TQ3Float32*)thePoints, theFile );
+
+
+
+	// And copy them to the vertices
+	if (qd3dStatus == kQ3Success)
+	{
+		for (n = 0; n < numVertices; ++n)
+		{
+			vertices[ n ].point = thePoints[ n ];
+		}
+	}
+	
+	Q3Memory_Free( &thePoints );
+	
+	return qd3dStatus;
+}
+
+
+
 //=============================================================================
 //      e3read_3dmf_group_subobjects : read the subobjects of a BeginGroup object.
 //-----------------------------------------------------------------------------
@@ -2475,10 +2567,9 @@ E3Read_3DMF_Geom_GeneralPolygon(TQ3FileObject theFile)
 		if(geomData.contours[j].vertices == NULL)
 			goto cleanup;
 	
-		for(i = 0; i< geomData.contours[j].numVertices; i++){
-			if(Q3Point3D_Read(&geomData.contours[j].vertices[i].point, theFile)!= kQ3Success)
-				goto cleanup;
-			}
+		if (e3read_3dmf_read_vertex_points( geomData.contours[j].numVertices,
+				geomData.contours[j].vertices, theFile ) != kQ3Success)
+			goto cleanup;
 		}
 	
 	
@@ -2717,16 +2808,18 @@ E3Read_3DMF_Geom_Mesh(TQ3FileObject theFile)
 	TQ3Uns32 			absFaceVertexIndices; // absolute of above
 	
 	TQ3Vertex3D			vertex;
+	TQ3Point3D*			points = NULL;
 	
 	TQ3MeshVertex*		vertices = NULL;
 	TQ3MeshVertex*		faceVertices = NULL;
+	TQ3Uns32*			faceIndices = NULL;
 	TQ3Uns32			allocatedFaceIndices = 0L;
 	
 	TQ3MeshFace			lastFace = NULL;
 	TQ3MeshFace*		faces = NULL;
 	TQ3Uns32			faceCount = 0L;
 	
-	TQ3Uns32			i,j,index;
+	TQ3Uns32			i,j;
 	TQ3Boolean			readFailed = kQ3False;
 	
 	TQ3AttributeSet		attributeSet;
@@ -2751,19 +2844,24 @@ E3Read_3DMF_Geom_Mesh(TQ3FileObject theFile)
 	Q3Mesh_DelayUpdates(mesh);
 	
 	
-	// read the vertices
+	// read the vertices, as one array of points
+	points = (TQ3Point3D *) Q3Memory_Allocate(sizeof(TQ3Point3D) * numVertices);
+	if ((points == NULL) ||
+		(Q3Float32_ReadArray(3 * numVertices, (TQ3Float32*)points, theFile) != kQ3Success))
+		{
+		readFailed = kQ3True;
+		goto cleanUp;
+		}
 	
 	vertex.attributeSet = NULL;
 	
 	for(i = 0; i< numVertices; i++){
-		if(Q3Point3D_Read(&vertex.point, theFile)!= kQ3Success)
-			{
-			readFailed = kQ3True;
-			goto cleanUp;
-			}
+		vertex.point = points[i];
 		vertices[i] = Q3Mesh_VertexNew (mesh, &vertex);
 		}
 	
+	Q3Memory_Free(&points);
+	
 	// read the number of faces
 	if(Q3Uns32_Read(&numFaces, theFile)!= kQ3Success)
 		{
@@ -2799,19 +2897,29 @@ E3Read_3DMF_Geom_Mesh(TQ3FileObject theFile)
 		absFaceVertexIndices = static_cast<TQ3Uns32>(E3Integer_Abs( numFaceVertexIndices));
 		
 		if(allocatedFaceIndices < absFaceVertexIndices){
-			if(Q3Memory_Reallocate (&faceVertices, (absFaceVertexIndices*sizeof(TQ3MeshVertex))) != kQ3Success)
+			if((Q3Memory_Reallocate (&faceVertices, (absFaceVertexIndices*sizeof(TQ3MeshVertex))) != kQ3Success) ||
+			   (Q3Memory_Reallocate (&faceIndices, (absFaceVertexIndices*sizeof(TQ3Uns32))) != kQ3Success))
+				{
+				readFailed = kQ3True;
 				goto cleanUp;
+				}
 			allocatedFaceIndices = absFaceVertexIndices;
 			}
 			
 		//read the Indices
+		if(Q3Uns32_ReadArray(absFaceVertexIndices, faceIndices, theFile)!= kQ3Success)
+			{
+			readFailed = kQ3True;
+			goto cleanUp;
+			}
+		
 		for(j = 0; j < absFaceVertexIndices; j++){
-			if(Q3Uns32_Read(&index, theFile)!= kQ3Success)
+			if(faceIndices[j] >= numVertices)
 				{
 				readFailed = kQ3True;
 				goto cleanUp;
 				}
-			faceVertices[j] = vertices[index];
+			faceVertices[j] = vertices[faceIndices[j]];
 			}
 		// create the face
 		if(numFaceVertexIndices > 0) // it's a face
@@ -2899,6 +3007,8 @@ cleanUp:
 	
 	Q3Memory_Free(&vertices);
 	Q3Memory_Free(&faceVertices);
+	Q3Memory_Free(&faceIndices);
+	Q3Memory_Free(&points);
 	Q3Memory_Free(&faces);
 	
 	return mesh;
@@ -3288,9 +3398,7 @@ E3Read_3DMF_Geom_PolyLine(TQ3FileObject theFile)
 
 	
 	// Read in vertices
-	for(i = 0; i< geomData.numVertices; i++){
-		Q3Point3D_Read(&geomData.vertices[i].point,theFile);
-		}
+	e3read_3dmf_read_vertex_points( geomData.numVertices, geomData.vertices, theFile );
 
 
 
@@ -3384,10 +3492,8 @@ E3Read_3DMF_Geom_Polygon(TQ3FileObject theFile)
 	if(geomData.vertices == NULL)
 		return (NULL);
 	
-	for(i = 0; i< geomData.numVertices; i++){
-		if(Q3Point3D_Read(&geomData.vertices[i].point, theFile)!= kQ3Success)
-			goto cleanup;
-		}
+	if (e3read_3dmf_read_vertex_points( geomData.numVertices, geomData.vertices, theFile ) != kQ3Success)
+		goto cleanup;
 	
 	
 
@@ -3605,10 +3711,8 @@ E3Read_3DMF_Geom_TriGrid(TQ3FileObject theFile)
 	if(geomData.vertices == NULL)
 		return (NULL);
 	
-	for(i = 0; i< numVertices; i++){
-		if(Q3Point3D_Read(&geomData.vertices[i].point, theFile)!= kQ3Success)
-			goto cleanup;
-		}
+	if (e3read_3dmf_read_vertex_points( numVertices, geomData.vertices, theFile ) != kQ3Success)
+		goto cleanup;
 	
 	
 
@@ -3689,7 +3793,7 @@ E3Read_3DMF_Geom_TriMesh(TQ3FileObject theFile)
 	TQ3Uns32				i;
 	TQ3Object				elementSet = NULL;
 	TQ3StorageObject		theStorage = NULL;
-	TQ3Uns32				storageSize;
+	TQ3StorageOffset		storageSize = 0;
 
 
 	// Initialise the geometry data
@@ -3705,7 +3809,7 @@ E3Read_3DMF_Geom_TriMesh(TQ3FileObject theFile)
 	
 	// Find the size of the storage, so we can do a sanity check before allocating memory.
 	Q3File_GetStorage( theFile, &theStorage );
-	Q3Storage_GetSize( theStorage, &storageSize );
+	Q3Storage_GetSize64( theStorage, &storageSize );
 	Q3Object_CleanDispose( &theStorage );
 
 
@@ -3730,23 +3834,9 @@ E3Read_3DMF_Geom_TriMesh(TQ3FileObject theFile)
 	geomData.triangles = (TQ3TriMeshTriangleData *)Q3Memory_Allocate(sizeof(TQ3TriMeshTriangleData)*geomData.numTriangles);
 	if(geomData.triangles == NULL)
 		goto cleanUp;
-	if(geomData.numPoints >= 0x00010000U)
-		{
-		if (Q3Uns32_ReadArray(3*geomData.numTriangles, (TQ3Uns32*)geomData.triangles, theFile) != kQ3Success)
-			goto cleanUp;
-		}
-	else if(geomData.numPoints >= 0x00000100U)
-		{
-		if (Q3Uns16_ReadArray(3*geomData.numTriangles, (TQ3Uns16*)geomData.triangles, theFile) != kQ3Success)
-			goto cleanUp;
-		e3read_3dmf_spreadarray_uns16to32( 3*geomData.numTriangles, geomData.triangles );
-		}
-	else	// geomData.numPoints <= 0x000000FFU
-		{
-		if (Q3Uns8_ReadArray(3*geomData.numTriangles, (TQ3Uns8*)geomData.triangles, theFile) != kQ3Success)
-			goto cleanUp;
-		e3read_3dmf_spreadarray_uns8to32( 3*geomData.numTriangles, geomData.triangles );
-		}
+	if (e3read_3dmf_read_indices( 3*geomData.numTriangles, geomData.numPoints,
+			(TQ3Uns32*)geomData.triangles, theFile ) != kQ3Success)
+		goto cleanUp;
 		
 	//================ read the edges
 	if(geomData.numEdges > 0){
@@ -3758,7 +3848,29 @@ E3Read_3DMF_Geom_TriMesh(TQ3FileObject theFile)
 		geomData.edges = (TQ3TriMeshEdgeData *)Q3Memory_Allocate(sizeof(TQ3TriMeshEdgeData)*geomData.numEdges);
 		if(geomData.edges == NULL)
 			goto cleanUp;
-		if(geomData.numPoints >= 0x00010000U)
+		
+		// If point and triangle indices are the same size, the edges can be
+		// read as one array. Missing triangles are then widened to 32 bits.
+		if (e3read_3dmf_index_size( geomData.numPoints ) == e3read_3dmf_index_size( geomData.numTriangles ))
+			{
+			if (e3read_3dmf_read_indices( 4*geomData.numEdges, geomData.numTriangles,
+					(TQ3Uns32*)geomData.edges, theFile ) != kQ3Success)
+				goto cleanUp;
+			
+			if (geomData.numTriangles < 0x00010000U)
+				{
+				TQ3Uns32 noTriangle = (geomData.numTriangles >= 0x00000100U) ? 0xFFFFU : 0xFFU;
+				
+				for(i = 0; i < geomData.numEdges; i++)
+					{
+					if (geomData.edges[i].triangleIndices[0] == noTriangle)
+						geomData.edges[i].triangleIndices[0] = 0xFFFFFFFFU;
+					if (geomData.edges[i].triangleIndices[1] == noTriangle)
+						geomData.edges[i].triangleIndices[1] = 0xFFFFFFFFU;
+					}
+				}
+			}
+		else if(geomData.numPoints >= 0x00010000U)
 			for(i = 0; i < geomData.numEdges; i++)
 				{
 				if(Q3Uns32_Read(&geomData.edges[i].pointIndices[0], theFile)!= kQ3Success)
@@ -57,6 +57,7 @@
 #include <vector>
 
 #include "E3IO.h"
+#include "E3Storage.h"
 #include "E3FFR_3DMF_Text.h"
 #include "E3FFR_3DMF_Geometry.h"
 #include "CQ3ObjectRef.h"
@@ -92,12 +93,12 @@
 //-----------------------------------------------------------------------------
 namespace
 {
-	typedef	std::map< std::string, TQ3Uns32 >	LabelToOffsetMap;
+	typedef	std::map< std::string, TQ3StorageOffset >	LabelToOffsetMap;
 
 	struct TOCEntry
 	{
 		TQ3Uns32						refID;
-		TQ3Uns32						objLocation;
+		TQ3StorageOffset				objLocation;
 		CQ3ObjectRef					object;
 	};
 
@@ -153,13 +154,13 @@ e3fformat_3dmf_text_skipcomments ( E3Text3DMFReader* format )
 	TQ3Status						result   = kQ3Success;
 	TQ3Boolean						found    = kQ3True;
 	TQ3Uns32						sizeRead = 0;
-	TQ3XStorageReadDataMethod		dataRead;
+	E3Storage*						storage;
 
 
 
-	// Get the read method
-	dataRead = (TQ3XStorageReadDataMethod) format->instanceData.MFData.baseData.storage->GetMethod (  kQ3XMethodTypeStorageReadData)  ;
-	if (dataRead == NULL)
+	// Get the storage
+	storage = (E3Storage*) format->instanceData.MFData.baseData.storage ;
+	if (storage == NULL)
 		return(kQ3Failure);
 
 
@@ -169,9 +170,9 @@ e3fformat_3dmf_text_skipcomments ( E3Text3DMFReader* format )
 			format->instanceData.MFData.baseData.currentStoragePosition < format->instanceData.MFData.baseData.logicalEOF)
 		{
 		found  = kQ3False;
-		result = dataRead( format->instanceData.MFData.baseData.storage,
+		result = storage->GetData64(
 			format->instanceData.MFData.baseData.currentStoragePosition, 1,
-			(TQ3Uns8*)buffer, &sizeRead);
+			(unsigned char*)buffer, &sizeRead);
 		
 		if (result == kQ3Success)
 			{
@@ -388,7 +389,8 @@ e3read_3dmf_text_readflag(TQ3Uns32* flag, E3File* theFile, TQ3ObjectType hint)
 										{kQ3ObjectTypeGeometryCaps,"BOTTOM",2},
 										{kQ3ObjectTypeGeometryCaps,"INTERIOR",4} };
 
-	TQ3Uns32                    i, charsRead, dictValues, saveStoragePos;
+	TQ3Uns32                    i, charsRead, dictValues;
+	TQ3StorageOffset			saveStoragePos;
 	TQ3FFormatBaseData			*formatInstanceData;
 	char						buffer[256];
 	TQ3Status					result;
@@ -836,7 +838,7 @@ e3fformat_3dmf_text_skip_to_level ( E3File* theFile, TQ3Uns32 nesting )
 static TQ3Boolean
 e3fformat_3dmf_text_canread(TQ3StorageObject storage, TQ3ObjectType* theFileFormatFound)
 {
-	TQ3XStorageReadDataMethod readMethod;
+	E3Storage* readStorage;
 	char label[11];
 	char key[] = "3DMetafile";
 	TQ3Uns32 sizeRead;
@@ -847,11 +849,11 @@ e3fformat_3dmf_text_canread(TQ3StorageObject storage, TQ3ObjectType* theFileForm
 
 	*theFileFormatFound = kQ3ObjectTypeInvalid;
 	
-	readMethod = (TQ3XStorageReadDataMethod) storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
+	readStorage = (E3Storage*) storage ;
 	
-	if(readMethod != NULL){
+	if(readStorage != NULL){
 		// read 10 bytes, search for "3DMetafile"
-		readMethod(storage,0, 10,(TQ3Uns8*)&label, &sizeRead);
+		readStorage->GetData64(0, 10,(unsigned char*)&label, &sizeRead);
 		label[10] = 0;
 		if (sizeRead != 10)
 			return kQ3False;
@@ -876,16 +878,15 @@ e3fformat_3dmf_text_readlabels( TQ3FileFormatObject format, TE3FFormat3DMF_Text_
 {
 	char		buffer[256];
 	TQ3Uns32	charsRead;
-	TQ3Uns32	labelStartOffset;
+	TQ3StorageOffset	labelStartOffset;
 	TQ3Uns8		firstNonBlank;
 	TQ3Status	result;
-	TQ3XStorageReadDataMethod		dataRead;
+	E3Storage*	storage;
 
 	
-	// Get the read method
-	dataRead = (TQ3XStorageReadDataMethod) instanceData->MFData.baseData.storage->GetMethod ( 
-		kQ3XMethodTypeStorageReadData ) ;
-	if (dataRead == NULL)
+	// Get the storage
+	storage = (E3Storage*) instanceData->MFData.baseData.storage ;
+	if (storage == NULL)
 		return;
 
 	while ( (kQ3Success == E3FileFormat_GenericReadText_SkipBlanks( format )) &&
@@ -893,7 +894,7 @@ e3fformat_3dmf_text_readlabels( TQ3FileFormatObject format, TE3FFormat3DMF_Text_
 	{
 		labelStartOffset = instanceData->MFData.baseData.currentStoragePosition;
 		
-		result = dataRead(instanceData->MFData.baseData.storage, instanceData->MFData.baseData.currentStoragePosition,
+		result = storage->GetData64( instanceData->MFData.baseData.currentStoragePosition,
 			1, &firstNonBlank, &charsRead );
 		if (result != kQ3Success)
 			break;
@@ -940,7 +941,7 @@ e3fformat_3dmf_text_read_toc ( E3Text3DMFReader* format, TE3FFormat3DMF_Text_Dat
 		LabelToOffsetMap::const_iterator	labelIter = instanceData->mLabelMap->find( tocLabel );
 		if (labelIter != instanceData->mLabelMap->end())
 		{
-			TQ3Uns32	tocOffset = static_cast<TQ3Uns32>(labelIter->second + tocLabel.size() + 1);
+			TQ3StorageOffset	tocOffset = labelIter->second + tocLabel.size() + 1;
 			instanceData->MFData.baseData.currentStoragePosition = tocOffset;
 			char	buffer[256];
 			TQ3Uns32	charsRead;
@@ -1019,7 +1020,7 @@ e3fformat_3dmf_text_read_header ( E3File* theFile )
 {
 	E3Text3DMFReader* format = (E3Text3DMFReader*) theFile->GetFileFormat () ;
 	bool						result;
-	TQ3Uns32 						oldPosition;
+	TQ3StorageOffset				oldPosition;
 	char							header[64];
 	TQ3Uns32 						charsRead;
 	TQ3Int16 						major = 0;
@@ -1130,7 +1131,7 @@ e3fformat_3dmf_text_skipobject ( E3File* theFile )
 //      e3fformat_3dmf_textreader_update_toc : Add an object to TOC if appropriate.
 //-----------------------------------------------------------------------------
 static void
-e3fformat_3dmf_textreader_update_toc( TQ3Object object, TQ3Uns32 objectOffset, TE3FFormat3DMF_Text_Data* instanceData )
+e3fformat_3dmf_textreader_update_toc( TQ3Object object, TQ3StorageOffset objectOffset, TE3FFormat3DMF_Text_Data* instanceData )
 {
 	if (Q3Object_IsType( object, kQ3ObjectTypeShared ))
 	{
@@ -1186,7 +1187,7 @@ e3fformat_3dmf_text_readobject ( E3File* theFile )
 	TQ3Status 				status;
 	TQ3Object 				result = NULL;
 	TQ3Object 				childObject = NULL;
-	TQ3Uns32 				objLocation;
+	TQ3StorageOffset		objLocation;
 	TQ3Uns32 				oldContainer;
 	TQ3XObjectReadMethod 			readMethod = NULL;
 	TQ3XObjectReadDefaultMethod		readDefaultMethod = NULL;
@@ -1345,7 +1346,7 @@ e3read_3dmf_text_readnextelement ( TQ3AttributeSet parent, E3File* theFile )
 {
 	TQ3ObjectType 				elemType;
 	TQ3Status 					status;
-	TQ3Uns32 					elemLocation;
+	TQ3StorageOffset			elemLocation;
 	TQ3Uns32 					oldContainer;
 	TQ3Object 					result = NULL;
 	char 						objectType[64];
@@ -1462,7 +1463,7 @@ e3fformat_3dmf_text_get_nexttype ( E3File* theFile )
 {
 	TQ3ObjectType 				result = kQ3ObjectTypeInvalid;
 	char 						objectType[64];
-	TQ3Uns32 					oldPosition;
+	TQ3StorageOffset			oldPosition;
 	TQ3Uns32 					oldNesting;
 	TQ3Uns32 					oldContainer;
 	TQ3Uns32 					charsRead;
@@ -1545,22 +1546,21 @@ e3fformat_3dmf_text_read_string(TQ3FileFormatObject format, char* data, TQ3Uns32
 	
 	e3fformat_3dmf_text_skipcomments( textFormat );
 	
-	// Get the storage read method
-	TQ3XStorageReadDataMethod dataRead = (TQ3XStorageReadDataMethod)
-		instanceData.MFData.baseData.storage->GetMethod ( kQ3XMethodTypeStorageReadData ) ;
-	if (dataRead == NULL)
+	// Get the storage
+	E3Storage* storage = (E3Storage*) instanceData.MFData.baseData.storage ;
+	if (storage == NULL)
 	{
 		return status;
 	}
 	
 	// Save the storage position, in case we need to reset it
-	TQ3Uns32 startOffset = instanceData.MFData.baseData.currentStoragePosition;
+	TQ3StorageOffset startOffset = instanceData.MFData.baseData.currentStoragePosition;
 	
 	// Read bytes one at a time.  The first one we read had better be \".
 	TQ3Uns32 sizeRead;
 	char oneChar;
-	status = dataRead( instanceData.MFData.baseData.storage, startOffset, 1,
-		(TQ3Uns8*)&oneChar, &sizeRead );
+	status = storage->GetData64( startOffset, 1,
+		(unsigned char*)&oneChar, &sizeRead );
 	if ( (status == kQ3Success) && (oneChar != '\"') )
 	{
 		status = kQ3Failure;
@@ -1569,9 +1569,9 @@ e3fformat_3dmf_text_read_string(TQ3FileFormatObject format, char* data, TQ3Uns32
 	instanceData.MFData.baseData.currentStoragePosition += 1;
 	while (true)
 	{
-		status = dataRead( instanceData.MFData.baseData.storage,
+		status = storage->GetData64(
 			instanceData.MFData.baseData.currentStoragePosition, 1,
-			(TQ3Uns8*)&oneChar, &sizeRead );
+			(unsigned char*)&oneChar, &sizeRead );
 		if (status != kQ3Success)
 		{
 			break;	// end of file
@@ -327,14 +327,17 @@ E3FFW_3DMF_EndPass(TQ3ViewObject				theView,
 	TQ3Status				status = kQ3Success;
 	TE3FFormat3DMF_TOC		*toc = fileFormatPrivate->toc;
 	TQ3Uns64 				pos = {0,0};
+	TQ3StorageOffset		tocPosition;
 	TQ3FileObject 			theFile = E3View_AccessFile (theView);
 	
 	if(toc != NULL) // write the toc
 		{
-		pos.lo = fileFormatPrivate->baseData.currentStoragePosition;
+		tocPosition = fileFormatPrivate->baseData.currentStoragePosition;
+		pos.lo = (TQ3Uns32) tocPosition;
+		pos.hi = (TQ3Uns32) (tocPosition >> 32);
 		status = E3FFW_3DMF_TraverseObject (theView, fileFormatPrivate, NULL, kQ3ObjectTypeTOC, fileFormatPrivate);
 		
-		if((status == kQ3Success) && (pos.lo != fileFormatPrivate->baseData.currentStoragePosition))// something has been written 
+		if((status == kQ3Success) && (tocPosition != fileFormatPrivate->baseData.currentStoragePosition))// something has been written 
 			{
 				fileFormatPrivate->baseData.currentStoragePosition = 16;
 				Q3Uns64_Write(pos, theFile);
@@ -469,7 +472,7 @@ e3ffw_3DMF_write_objects(TE3FFormatW3DMF_Data *instanceData, TQ3FileObject theFi
 	TQ3ObjectType			container;
 	TQ3Uns32				lastLevel;
 #if Q3_DEBUG
-	TQ3Uns32 pos;
+	TQ3StorageOffset pos;
 #endif
 
 	for(i=0; i<instanceData->stackCount; i++){
@@ -481,7 +484,9 @@ e3ffw_3DMF_write_objects(TE3FFormatW3DMF_Data *instanceData, TQ3FileObject theFi
 			if(instanceData->stack[i].tocIndex != kQ3ArrayIndexNULL)
 				{ // fill in the object position in the TOC
 				instanceData->toc->tocEntries[instanceData->stack[i].tocIndex].objLocation.lo =
-							 instanceData->baseData.currentStoragePosition;
+							 (TQ3Uns32) instanceData->baseData.currentStoragePosition;
+				instanceData->toc->tocEntries[instanceData->stack[i].tocIndex].objLocation.hi =
+							 (TQ3Uns32) (instanceData->baseData.currentStoragePosition >> 32);
 				}
 
 
@@ -5,7 +5,7 @@
         Unix specific Storage calls.
 
     COPYRIGHT:
-        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+        Copyright (c) 1999-2015, Quesa Developers. All rights reserved.
 
         For the current release of Quesa, please see:
 
@@ -46,6 +46,12 @@
 #include "E3Prefix.h"
 #include "E3Storage.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 
 
 
@@ -53,6 +59,13 @@
 //=============================================================================
 //      Internal types
 //-----------------------------------------------------------------------------
+// Mapped storage
+typedef struct TE3UnixMappedStorageData {
+	char				*thePath;
+	TQ3Boolean			isOpen;
+	const TQ3Uns8		*theData;
+	TQ3StorageOffset	theSize;
+} TE3UnixMappedStorageData;
 
 
 
@@ -62,6 +75,8 @@ class E3UnixStorage : public E3Storage // This is not a leaf class, but only cla
 								// the fields can be public as nobody should be
 								// including this file.
 	{
+Q3_CLASS_ENUMS ( kQ3StorageTypeUnix, E3UnixStorage, E3Storage )
+
 public :
 
 	// There is no extra data for this class
@@ -81,6 +96,378 @@ public :
 	
 
 
+class E3UnixMappedStorage : public E3UnixStorage  // This is a leaf class so no other classes use this,
+								// so it can be here in the .c file rather than in
+								// the .h file, hence all the fields can be public
+								// as nobody should be including this file
+	{
+Q3_CLASS_ENUMS ( kQ3UnixStorageTypeMapped, E3UnixMappedStorage, E3UnixStorage )
+
+public :
+
+	TE3UnixMappedStorageData	mappedDetails ;
+	} ;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      e3storage_unix_mapped_unmap : Release the file mapping.
+//-----------------------------------------------------------------------------
+static void
+e3storage_unix_mapped_unmap(TE3UnixMappedStorageData *instanceData)
+{
+
+
+	// Release the mapping
+	if (instanceData->theData != NULL)
+		munmap((void *) instanceData->theData, (size_t) instanceData->theSize);
+
+	instanceData->isOpen  = kQ3False;
+	instanceData->theData = NULL;
+	instanceData->theSize = 0;
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_new : Mapped storage new method.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_new(TQ3Object theObject, void *privateData, const void *paramData)
+{	TE3UnixMappedStorageData	*instanceData = (TE3UnixMappedStorageData *) privateData;
+	const char					*thePath      = (const char *) paramData;
+#pragma unused(theObject)
+
+
+
+	// Initialise our instance data
+	instanceData->thePath = (char *) Q3Memory_Allocate(static_cast<TQ3Uns32>(strlen(thePath) + 1));
+	if (instanceData->thePath == NULL)
+		return(kQ3Failure);
+
+	strcpy(instanceData->thePath, thePath);
+	
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_delete : Mapped storage delete method.
+//-----------------------------------------------------------------------------
+static void
+e3storage_unix_mapped_delete(TQ3Object storage, void *privateData)
+{	TE3UnixMappedStorageData	*instanceData = (TE3UnixMappedStorageData *) privateData;
+#pragma unused(storage)
+
+
+
+	// Make sure the file isn't open
+	if (instanceData->isOpen)
+		{
+		E3ErrorManager_PostError(kQ3ErrorFileIsOpen, kQ3False);
+		e3storage_unix_mapped_unmap(instanceData);
+		}
+
+
+
+	// Dispose of our instance data
+	Q3Memory_Free(&instanceData->thePath);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_open : Map the file into memory.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_open(E3UnixMappedStorage *storage, TQ3Boolean forWriting)
+{	TE3UnixMappedStorageData	*instanceData = &storage->mappedDetails;
+	struct stat					fileInfo;
+	void						*theData;
+	int							theFile;
+
+
+
+	// Mapped storage is read-only
+	if (forWriting)
+		{
+		E3ErrorManager_PostError(kQ3ErrorFileModeRestriction, kQ3False);
+		return(kQ3Failure);
+		}
+
+
+
+	// Make sure the file isn't already open
+	if (instanceData->isOpen)
+		{
+		E3ErrorManager_PostError(kQ3ErrorFileAlreadyOpen, kQ3False);
+		return(kQ3Failure);
+		}
+
+
+
+	// Open the file and find its size
+	theFile = open(instanceData->thePath, O_RDONLY);
+	if (theFile == -1)
+		return(kQ3Failure);
+
+	if (fstat(theFile, &fileInfo) != 0 || fileInfo.st_size < 0 ||
+		(TQ3StorageOffset) (size_t) fileInfo.st_size != (TQ3StorageOffset) fileInfo.st_size)
+		{
+		close(theFile);
+		return(kQ3Failure);
+		}
+
+
+
+	// Map the file. An empty file has nothing to map, and the mapping
+	// stays valid once the file has been closed.
+	theData = NULL;
+	if (fileInfo.st_size != 0)
+		{
+		theData = mmap(NULL, (size_t) fileInfo.st_size, PROT_READ, MAP_PRIVATE, theFile, 0);
+		if (theData == MAP_FAILED)
+			{
+			close(theFile);
+			return(kQ3Failure);
+			}
+
+#ifdef MADV_SEQUENTIAL
+		madvise(theData, (size_t) fileInfo.st_size, MADV_SEQUENTIAL);
+#endif
+		}
+
+	close(theFile);
+
+	instanceData->isOpen  = kQ3True;
+	instanceData->theData = (const TQ3Uns8 *) theData;
+	instanceData->theSize = (TQ3StorageOffset) fileInfo.st_size;
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_close : Unmap the file.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_close(E3UnixMappedStorage *storage)
+{
+
+
+	// Make sure the file is open
+	if (!storage->mappedDetails.isOpen)
+		{
+		E3ErrorManager_PostError(kQ3ErrorFileNotOpen, kQ3False);
+		return(kQ3Failure);
+		}
+
+	e3storage_unix_mapped_unmap(&storage->mappedDetails);
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_getsize64 : Get the size of the storage object.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_getsize64(E3UnixMappedStorage *storage, TQ3StorageOffset *size)
+{
+
+
+	// Make sure the file is open
+	if (!storage->mappedDetails.isOpen)
+		{
+		E3ErrorManager_PostError(kQ3ErrorFileNotOpen, kQ3False);
+		return(kQ3Failure);
+		}
+
+	*size = storage->mappedDetails.theSize;
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_getsize : Get the size of the storage object.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_getsize(E3UnixMappedStorage *storage, TQ3Uns32 *size)
+{	TQ3StorageOffset		theSize;
+
+
+
+	// Get the size, failing if it can't be expressed in 32 bits
+	if (e3storage_unix_mapped_getsize64(storage, &theSize) == kQ3Failure)
+		return(kQ3Failure);
+
+	if (theSize > 0xFFFFFFFFUL)
+		return(kQ3Failure);
+
+	*size = (TQ3Uns32) theSize;
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_read64 : Read data from the storage object.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_read64(E3UnixMappedStorage *storage, TQ3StorageOffset offset,
+							TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead)
+{	TE3UnixMappedStorageData	*instanceData = &storage->mappedDetails;
+
+
+
+	// Make sure the file is open
+	*sizeRead = 0;
+
+	if (!instanceData->isOpen)
+		{
+		E3ErrorManager_PostError(kQ3ErrorFileNotOpen, kQ3False);
+		return(kQ3Failure);
+		}
+
+
+
+	// Copy the data, stopping at the end of the file
+	if (offset < instanceData->theSize)
+		{
+		if (dataSize > instanceData->theSize - offset)
+			dataSize = (TQ3Uns32) (instanceData->theSize - offset);
+
+		Q3Memory_Copy(instanceData->theData + offset, data, dataSize);
+		*sizeRead = dataSize;
+		}
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_read : Read data from the storage object.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_read(E3UnixMappedStorage *storage, TQ3Uns32 offset,
+							TQ3Uns32 dataSize, unsigned char *data, TQ3Uns32 *sizeRead)
+{
+
+
+	return(e3storage_unix_mapped_read64(storage, offset, dataSize, data, sizeRead));
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_write : Write data to the storage object.
+//-----------------------------------------------------------------------------
+static TQ3Status
+e3storage_unix_mapped_write(E3UnixMappedStorage *storage, TQ3Uns32 offset,
+							TQ3Uns32 dataSize, const unsigned char *data, TQ3Uns32 *sizeWritten)
+{
+#pragma unused(storage)
+#pragma unused(offset)
+#pragma unused(dataSize)
+#pragma unused(data)
+
+
+
+	// Mapped storage is read-only
+	*sizeWritten = 0;
+	E3ErrorManager_PostError(kQ3ErrorFileModeRestriction, kQ3False);
+
+	return(kQ3Failure);
+}
+
+
+
+
+
+//=============================================================================
+//      e3storage_unix_mapped_metahandler : Mapped storage metahandler.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+e3storage_unix_mapped_metahandler(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3XMethodTypeObjectNew:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_new;
+			break;
+
+		case kQ3XMethodTypeObjectDelete:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_delete;
+			break;
+
+		case kQ3XMethodTypeStorageOpen:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_open;
+			break;
+
+		case kQ3XMethodTypeStorageClose:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_close;
+			break;
+
+		case kQ3XMethodTypeStorageGetSize:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_getsize;
+			break;
+
+		case kQ3XMethodTypeStorageReadData:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_read;
+			break;
+
+		case kQ3XMethodTypeStorageWriteData:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_write;
+			break;
+
+		case kQ3XMethodTypeStorageGetSize64:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_getsize64;
+			break;
+
+		case kQ3XMethodTypeStorageReadData64:
+			theMethod = (TQ3XFunctionPointer) e3storage_unix_mapped_read64;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
 //=============================================================================
 //      Public functions
 //-----------------------------------------------------------------------------
@@ -111,18 +498,24 @@ E3UnixStorage_RegisterClass(void)
 	// API was officially obsoleted, this will be OK - since nobody
 	// should be using this API anyway, anyone who does can just switch
 	// to the official PathStorage object.
-	qd3dStatus = E3ClassTree::RegisterClass(kQ3SharedTypeStorage,
-											kQ3StorageTypeUnix,
-											kQ3ClassNameStorageUnix,
+	qd3dStatus = Q3_REGISTER_CLASS_NO_DATA(kQ3ClassNameStorageUnix,
 											NULL,
-											sizeof(E3UnixStorage));
+											E3UnixStorage);
 
 	if (qd3dStatus == kQ3Success)
 		qd3dStatus = E3ClassTree::RegisterClass(kQ3StorageTypeUnix,
 												kQ3UnixStorageTypePath,
 												kQ3ClassNameStorageUnixPath,
 												theClass->GetMetaHandler (),
-												sizeof(E3UnixStorage));
+												sizeof(E3UnixPathStorage),
+												sizeof(TQ3PathStorageData),
+												Q3_OFFSETOF(E3UnixPathStorage, pathDetails));
+
+	if (qd3dStatus == kQ3Success)
+		qd3dStatus = Q3_REGISTER_CLASS_WITH_MEMBER(kQ3ClassNameStorageUnixMapped,
+												e3storage_unix_mapped_metahandler,
+												E3UnixMappedStorage,
+												mappedDetails);
 
 	return(qd3dStatus);
 }
@@ -141,6 +534,7 @@ E3UnixStorage_UnregisterClass(void)
 
 
 	// Unregister the classes
+	qd3dStatus = E3ClassTree::UnregisterClass(kQ3UnixStorageTypeMapped, kQ3True);
 	qd3dStatus = E3ClassTree::UnregisterClass(kQ3UnixStorageTypePath, kQ3True);
 	qd3dStatus = E3ClassTree::UnregisterClass(kQ3StorageTypeUnix,     kQ3True);
 
@@ -203,3 +597,19 @@ E3UnixPathStorage_Get(TQ3StorageObject storage, char *pathName)
 
 	return(qd3dStatus);
 }
+
+
+
+
+
+//=============================================================================
+//      E3UnixMappedStorage_New : Create a mapped storage object.
+//-----------------------------------------------------------------------------
+TQ3StorageObject
+E3UnixMappedStorage_New(const char *pathName)
+{
+
+
+	// Create the object
+	return(E3ClassTree::CreateInstance(kQ3UnixStorageTypeMapped, kQ3False, pathName));
+}
@@ -369,6 +369,25 @@ ir_is_bounding_box_visible( TQ3ViewObject           theView,
 
 
 
+//=============================================================================
+//      ir_is_bounding_box_array_visible : Test for group culling in bulk.
+//-----------------------------------------------------------------------------
+static TQ3Status
+ir_is_bounding_box_array_visible( TQ3ViewObject           theView,
+                                  void                    *rendererPrivate,
+                                  TQ3Uns32                numBounds,
+                                  const TQ3BoundingBox    *theBounds,
+                                  TQ3Uns32                *visibleMask )
+{
+#pragma unused( rendererPrivate )
+
+	return Q3View_IsBoundingBoxArrayVisible( theView, numBounds, theBounds, visibleMask );
+}
+
+
+
+
+
 //=============================================================================
 //      ir_interactive_metahandler : Renderer metahandler.
 //-----------------------------------------------------------------------------
@@ -439,6 +458,10 @@ ir_interactive_metahandler(TQ3XMethodType methodType)
 		case kQ3XMethodTypeRendererIsBoundingBoxVisible:
 			theMethod = (TQ3XFunctionPointer) ir_is_bounding_box_visible;
 			break;
+			
+		case kQ3XMethodTypeRendererIsBoundingBoxArrayVisible:
+			theMethod = (TQ3XFunctionPointer) ir_is_bounding_box_array_visible;
+			break;
 		}
 	
 	return(theMethod);
@@ -201,3 +201,39 @@ bool	QORenderer::Renderer::IsBoundingBoxVisible(
 	
 	return isVisible;
 }
+
+void	QORenderer::Renderer::IsBoundingBoxArrayVisible(
+								TQ3ViewObject inView,
+								TQ3Uns32 inNumBounds,
+								const TQ3BoundingBox* inBounds,
+								TQ3Uns32* outVisibleMask )
+{
+	TQ3Uns32	i;
+	
+	if (mLights.IsShadowMarkingPass())
+	{
+		std::fill( outVisibleMask, outVisibleMask + (inNumBounds + 31) / 32, 0U );
+		
+		for (i = 0; i < inNumBounds; ++i)
+		{
+			if (IsBoundingBoxVisible( inView, inBounds[i] ))
+			{
+				outVisibleMask[ i / 32 ] |= 1U << (i % 32);
+			}
+		}
+	}
+	else // lighting pass
+	{
+		E3BoundingBox_IntersectViewFrustumArray( inView, inNumBounds, inBounds,
+			outVisibleMask );
+		
+		for (i = 0; i < inNumBounds; ++i)
+		{
+			if ( (outVisibleMask[ i / 32 ] & (1U << (i % 32))) &&
+				! mLights.IsLit( inBounds[i] ) )
+			{
+				outVisibleMask[ i / 32 ] &= ~(1U << (i % 32));
+			}
+		}
+	}
+}
@@ -242,6 +242,12 @@ protected:
     bool					IsBoundingBoxVisible(
     								TQ3ViewObject inView,
     								const TQ3BoundingBox& inBounds );
+    
+    void					IsBoundingBoxArrayVisible(
+    								TQ3ViewObject inView,
+    								TQ3Uns32 inNumBounds,
+    								const TQ3BoundingBox* inBounds,
+    								TQ3Uns32* outVisibleMask );
 	
 	bool					SubmitTriMesh(
 									TQ3ViewObject inView,
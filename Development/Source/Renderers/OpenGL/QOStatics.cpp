@@ -215,6 +215,26 @@ TQ3Boolean	QORenderer::Statics::IsBoundingBoxVisibleMethod(
 	return shouldSubmit;
 }
 
+TQ3Status	QORenderer::Statics::IsBoundingBoxArrayVisibleMethod(
+									TQ3ViewObject           theView,
+		                            void                    *rendererPrivate,
+		                            TQ3Uns32                numBounds,
+		                            const TQ3BoundingBox    *theBounds,
+		                            TQ3Uns32                *visibleMask )
+{
+	TQ3Status	theStatus = kQ3Failure;
+	QORenderer::Renderer*	me = *(QORenderer::Renderer**)rendererPrivate;
+	try
+	{
+		me->IsBoundingBoxArrayVisible( theView, numBounds, theBounds, visibleMask );
+		theStatus = kQ3Success;
+	}
+	catch (...)
+	{
+	}
+	return theStatus;
+}
+
 TQ3Status	QORenderer::Statics::SubmitTriMeshMethod(
 									TQ3ViewObject inView,
 									void* privateData,
@@ -768,6 +788,10 @@ TQ3XFunctionPointer		QORenderer::Statics::MetaHandler( TQ3XMethodType inMethodTy
 			theMethod = (TQ3XFunctionPointer) &QORenderer::Statics::IsBoundingBoxVisibleMethod;
 			break;
 			
+		case kQ3XMethodTypeRendererIsBoundingBoxArrayVisible:
+			theMethod = (TQ3XFunctionPointer) &QORenderer::Statics::IsBoundingBoxArrayVisibleMethod;
+			break;
+			
 		case kQ3XMethodTypeRendererStartFrame:
 			theMethod = (TQ3XFunctionPointer) &QORenderer::Statics::StartFrameMethod;
 			break;
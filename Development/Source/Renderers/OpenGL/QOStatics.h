@@ -116,6 +116,13 @@ private:
 		                            void                    *rendererPrivate,
 		                            const TQ3BoundingBox    *theBounds );
 
+	static TQ3Status		IsBoundingBoxArrayVisibleMethod(
+									TQ3ViewObject           theView,
+		                            void                    *rendererPrivate,
+		                            TQ3Uns32                numBounds,
+		                            const TQ3BoundingBox    *theBounds,
+		                            TQ3Uns32                *visibleMask );
+
 	static TQ3XRendererSubmitGeometryMethod
 							SubmitGeometrySubMetaHandler(
 									TQ3ObjectType inGeomType );
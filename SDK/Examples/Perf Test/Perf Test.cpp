@@ -0,0 +1,3753 @@
+/*  NAME:
+        Perf Test.cpp
+        
+    DESCRIPTION:
+        Times Quesa operations on large scenes and geometries.
+
+        Each test prints its own timings, usually for the same work done at
+        several sizes so that the growth in cost can be seen. A test can be
+        run on its own by naming it on the command line, and with no
+        arguments every test is run.
+
+        Times are measured with clock(), so are processor times in
+        milliseconds, except where work is shared between threads, which
+        is timed by the clock on the wall. Build Quesa and this example
+        with optimisation on.
+
+        The example is a console application. It uses the generic renderer,
+        so needs no window, and can be built with something like:
+
+            c++ "Perf Test.cpp" "$UTIL/MergeNearTriMeshPoints.cpp"
+                "$UTIL/FindTriMeshVertexData.cpp" -O2 -I<Quesa includes>
+                -I"$UTIL" -lquesa
+
+        where $UTIL is "../../Extras/Utility Sources/Mutating Algorithms".
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "Quesa.h"
+#include "QuesaCamera.h"
+#include "QuesaDrawContext.h"
+#include "QuesaExtension.h"
+#include "QuesaGeometry.h"
+#include "QuesaGroup.h"
+#include "QuesaIO.h"
+#include "QuesaLight.h"
+#include "QuesaMath.h"
+#include "QuesaMemory.h"
+#include "QuesaPick.h"
+#include "QuesaRenderer.h"
+#include "QuesaSet.h"
+#include "QuesaShader.h"
+#include "QuesaStorage.h"
+#include "QuesaTransform.h"
+#include "QuesaView.h"
+
+#include "MergeNearTriMeshPoints.h"
+
+#include <map>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !QUESA_OS_WIN32
+	#include <sys/time.h>
+#endif
+
+
+
+
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kImageSize										64
+#define kNumPicks										200
+#define kNumLookups										1000000
+#define kMergeDistance									0.0005f
+#define kMaxScanPoints									40000
+#define kLargeFileName									"Perf Test Large.3dmf"
+#define kLargeFilePadSize								0x7FFFFFF8UL
+#define kLargeFileNumPads								3
+#define kNumShadowLights								8
+#define kNumReplayObjects								4096
+#define kNumParentEdits									1000000
+#define kCityGridSize									8
+#define kCityBlockSize									8
+#define kNumBatchRays									16384
+#define kNumRayTiles									4
+#define kNumQuadricPicks								2000
+#define kNumGeometryReads								4
+#define kNumPoolObjects									10000000
+#define kNumPoolLiveObjects								1000000
+#define kNumAttributeSets								200000
+#define kNumAttributeRuns								10
+#define kTreeDepth										16
+#define kNumGroupMembers								100000
+#define kNumTypeQueries									1000
+#define kNumTypeVisits									1000000
+#define kNumSceneObjects								100000
+#define kNumSceneTiles									10
+#define kNumPickLayers									16
+#define kNumKernelElements								4096
+#define kNumKernelRuns									5000
+#define kNumViewTransforms								500000
+
+
+
+
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+// A test
+typedef void (*TQ3PerfTestProc)(void);
+
+typedef struct TQ3PerfTest {
+	const char			*theName;
+	const char			*theDescription;
+	TQ3PerfTestProc		theProc;
+} TQ3PerfTest;
+
+
+// Contents of a tree of groups
+typedef enum TQ3TreeContents {
+	kTreeGroups,
+	kTreeColours,
+	kTreeSameColours,
+	kTreeTransforms
+} TQ3TreeContents;
+
+
+// Batch math kernels, and the forms of their arrays
+typedef enum TQ3MathKernel {
+	kKernelAffinePoints,
+	kKernelProjectivePoints,
+	kKernelVectors,
+	kKernelDots,
+	kKernelNormals,
+	kKernelCount
+} TQ3MathKernel;
+
+typedef enum TQ3KernelForm {
+	kFormElements,
+	kFormPacked,
+	kFormStrided,
+	kFormCount
+} TQ3KernelForm;
+
+
+// A vertex, for strided arrays
+typedef struct TQ3KernelVertex {
+	TQ3Point3D			thePoint;
+	TQ3Vector3D			theVector;
+	float				theDot;
+	TQ3Boolean			isNegative;
+} TQ3KernelVertex;
+
+
+// Arrays for the batch math kernels
+typedef struct TQ3KernelData {
+	TQ3Matrix4x4					affineMatrix;
+	TQ3Matrix4x4					projectiveMatrix;
+	std::vector<TQ3Point3D>			inPoints, outPoints;
+	std::vector<TQ3Vector3D>		inVectors, outVectors;
+	std::vector<float>				theDots;
+	std::vector<TQ3Boolean>			areNegative;
+	std::vector<TQ3Uns32>			theIndices;
+	std::vector<TQ3KernelVertex>	inVertices, outVertices;
+} TQ3KernelData;
+
+
+// Transforms for the view matrix test
+typedef enum TQ3TransformContents {
+	kTransformNone,
+	kTransformTranslate,
+	kTransformRotate,
+	kTransformScale,
+	kTransformMatrix,
+	kTransformMixed,
+	kTransformCount
+} TQ3TransformContents;
+
+
+
+
+
+//=============================================================================
+//      Globals
+//-----------------------------------------------------------------------------
+static double gColourSum = 0.0;
+
+static TQ3Uns32 gPassesNeeded = 0;
+static TQ3Uns32 gPassesDone   = 0;
+static TQ3Uns32 gFailPass     = 0;
+static TQ3Uns32 gNumTriMeshes = 0;
+static TQ3Uns32 gNumMatrices  = 0;
+
+
+
+
+
+//=============================================================================
+//      MyTime : Return the processor time in milliseconds.
+//-----------------------------------------------------------------------------
+static double
+MyTime(void)
+{
+	return(1000.0 * (double) clock() / (double) CLOCKS_PER_SEC);
+}
+
+
+
+
+
+//=============================================================================
+//      MyWallTime : Return the elapsed time in milliseconds.
+//-----------------------------------------------------------------------------
+static double
+MyWallTime(void)
+{
+#if QUESA_OS_WIN32
+	return((double) GetTickCount());
+#else
+	struct timeval		theTime;
+
+	gettimeofday(&theTime, NULL);
+	return(1000.0 * (double) theTime.tv_sec + (double) theTime.tv_usec / 1000.0);
+#endif
+}
+
+
+
+
+
+//=============================================================================
+//      MyRandom : Return a repeatable random number from 0 to 1.
+//-----------------------------------------------------------------------------
+static float
+MyRandom(void)
+{	static TQ3Uns32		theSeed = 1;
+
+
+
+	// A simple linear congruential generator, so every run sees the same values
+	theSeed = theSeed * 1664525 + 1013904223;
+
+	return((float) (theSeed >> 8) / (float) (1 << 24));
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewView : Create a view.
+//-----------------------------------------------------------------------------
+//		Note :	The camera looks down the z axis at the unit square, and the
+//				caller must free the image once the view has been disposed.
+//-----------------------------------------------------------------------------
+static TQ3ViewObject
+MyNewView(void **theImage)
+{	TQ3ViewAngleAspectCameraData	cameraData;
+	TQ3PixmapDrawContextData		pixmapData;
+	TQ3DrawContextObject			theDrawContext;
+	TQ3CameraObject					theCamera;
+	TQ3ViewObject					theView;
+
+
+
+	// Create the view
+	theView   = Q3View_New();
+	*theImage = calloc(kImageSize * kImageSize, 4);
+	if (theView == NULL || *theImage == NULL)
+		return(NULL);
+
+	Q3View_SetRendererByType(theView, kQ3RendererTypeGeneric);
+
+
+
+	// Create the draw context
+	memset(&pixmapData, 0, sizeof(pixmapData));
+	pixmapData.drawContextData.clearImageMethod  = kQ3ClearMethodWithColor;
+	pixmapData.drawContextData.paneState         = kQ3False;
+	pixmapData.drawContextData.maskState         = kQ3False;
+	pixmapData.drawContextData.doubleBufferState = kQ3False;
+	pixmapData.pixmap.image     = *theImage;
+	pixmapData.pixmap.width     = kImageSize;
+	pixmapData.pixmap.height    = kImageSize;
+	pixmapData.pixmap.rowBytes  = kImageSize * 4;
+	pixmapData.pixmap.pixelSize = 32;
+	pixmapData.pixmap.pixelType = kQ3PixelTypeARGB32;
+	pixmapData.pixmap.bitOrder  = kQ3EndianBig;
+	pixmapData.pixmap.byteOrder = kQ3EndianBig;
+
+	theDrawContext = Q3PixmapDrawContext_New(&pixmapData);
+	Q3View_SetDrawContext(theView, theDrawContext);
+	Q3Object_CleanDispose(&theDrawContext);
+
+
+
+	// Create the camera
+	memset(&cameraData, 0, sizeof(cameraData));
+	Q3Point3D_Set(&cameraData.cameraData.placement.cameraLocation,  0.5f, 0.5f, 1.0f);
+	Q3Point3D_Set(&cameraData.cameraData.placement.pointOfInterest, 0.5f, 0.5f, 0.0f);
+	Q3Vector3D_Set(&cameraData.cameraData.placement.upVector,       0.0f, 1.0f, 0.0f);
+	cameraData.cameraData.range.hither        = 0.1f;
+	cameraData.cameraData.range.yon           = 100.0f;
+	cameraData.cameraData.viewPort.origin.x   = -1.0f;
+	cameraData.cameraData.viewPort.origin.y   =  1.0f;
+	cameraData.cameraData.viewPort.width      =  2.0f;
+	cameraData.cameraData.viewPort.height     =  2.0f;
+	cameraData.fov                            = Q3Math_DegreesToRadians(60.0f);
+	cameraData.aspectRatioXToY                = 1.0f;
+
+	theCamera = Q3ViewAngleAspectCamera_New(&cameraData);
+	Q3View_SetCamera(theView, theCamera);
+	Q3Object_CleanDispose(&theCamera);
+
+	return(theView);
+}
+
+
+
+
+
+//=============================================================================
+//      MyPickObject : Pick an object, and return the number of hits.
+//-----------------------------------------------------------------------------
+//		Note :	The pick is disposed of.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+MyPickObject(TQ3ViewObject theView, TQ3PickObject thePick, TQ3Object theObject)
+{	TQ3Uns32		numHits = 0;
+
+
+
+	// Pick the object, and count the hits
+	if (thePick == NULL || Q3View_StartPicking(theView, thePick) != kQ3Success)
+		return(0);
+	
+	do
+		Q3Object_Submit(theObject, theView);
+	while (Q3View_EndPicking(theView) == kQ3ViewStatusRetraverse);
+
+	Q3Pick_GetNumHits(thePick, &numHits);
+	Q3Object_Dispose(thePick);
+	
+	return(numHits);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewGridMesh : Create a TriMesh grid over the unit square.
+//-----------------------------------------------------------------------------
+//		Note :	If requested, each vertex is given a random diffuse colour.
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject
+MyNewGridMesh(TQ3Uns32 theSize, float theHeight, TQ3Boolean withColours)
+{	TQ3TriMeshAttributeData	vertexAttributes;
+	TQ3TriMeshTriangleData	*theTriangles;
+	TQ3GeometryObject		theMesh;
+	TQ3TriMeshData			meshData;
+	TQ3ColorRGB				*theColours;
+	TQ3Point3D				*thePoints;
+	TQ3Uns32				x, y, n;
+
+
+
+	// Allocate the arrays
+	thePoints    = (TQ3Point3D *)             malloc((theSize + 1) * (theSize + 1) * sizeof(TQ3Point3D));
+	theColours   = (TQ3ColorRGB *)            malloc((theSize + 1) * (theSize + 1) * sizeof(TQ3ColorRGB));
+	theTriangles = (TQ3TriMeshTriangleData *) malloc(theSize * theSize * 2 * sizeof(TQ3TriMeshTriangleData));
+	if (thePoints == NULL || theColours == NULL || theTriangles == NULL)
+		{
+		free(thePoints);
+		free(theColours);
+		free(theTriangles);
+		return(NULL);
+		}
+
+
+
+	// Build the grid
+	for (y = 0; y <= theSize; y++)
+		for (x = 0; x <= theSize; x++)
+			Q3Point3D_Set(&thePoints[y * (theSize + 1) + x],
+							(float) x / (float) theSize, (float) y / (float) theSize, theHeight);
+
+	n = 0;
+	for (y = 0; y < theSize; y++)
+		{
+		for (x = 0; x < theSize; x++)
+			{
+			theTriangles[n].pointIndices[0] = (y + 0) * (theSize + 1) + x + 0;
+			theTriangles[n].pointIndices[1] = (y + 0) * (theSize + 1) + x + 1;
+			theTriangles[n].pointIndices[2] = (y + 1) * (theSize + 1) + x + 1;
+			n++;
+
+			theTriangles[n].pointIndices[0] = (y + 0) * (theSize + 1) + x + 0;
+			theTriangles[n].pointIndices[1] = (y + 1) * (theSize + 1) + x + 1;
+			theTriangles[n].pointIndices[2] = (y + 1) * (theSize + 1) + x + 0;
+			n++;
+			}
+		}
+
+
+
+	// Create the TriMesh
+	memset(&meshData, 0, sizeof(meshData));
+	meshData.numTriangles = n;
+	meshData.triangles    = theTriangles;
+	meshData.numPoints    = (theSize + 1) * (theSize + 1);
+	meshData.points       = thePoints;
+	Q3BoundingBox_SetFromPoints3D(&meshData.bBox, thePoints, meshData.numPoints, sizeof(TQ3Point3D));
+
+	if (withColours)
+		{
+		for (n = 0; n < meshData.numPoints; n++)
+			Q3ColorRGB_Set(&theColours[n], MyRandom(), MyRandom(), MyRandom());
+
+		vertexAttributes.attributeType     = kQ3AttributeTypeDiffuseColor;
+		vertexAttributes.data              = theColours;
+		vertexAttributes.attributeUseArray = NULL;
+		meshData.numVertexAttributeTypes   = 1;
+		meshData.vertexAttributeTypes      = &vertexAttributes;
+		}
+
+	theMesh = Q3TriMesh_New(&meshData);
+
+	free(thePoints);
+	free(theColours);
+	free(theTriangles);
+	
+	return(theMesh);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_TriMeshPick : Time TriMesh picks.
+//-----------------------------------------------------------------------------
+//		Note :	Large TriMeshes are picked through a tree of their triangles,
+//				built by the first pick. A TriMesh under a projective
+//				transform is picked by testing every triangle, so picking the
+//				mesh under a projective transform which leaves it in place
+//				gives the cost of a full scan for comparison.
+//-----------------------------------------------------------------------------
+static void
+MyTest_TriMeshPick(void)
+{	const TQ3Uns32			theSizes[] = { 64, 256, 1024 };
+	TQ3WindowPointPickData	pointData;
+	TQ3WindowRectPickData	rectData;
+	TQ3WorldRayPickData		rayData;
+	TQ3Matrix4x4			theMatrix;
+	TQ3TransformObject		theTransform;
+	TQ3GroupObject			scanGroup;
+	TQ3GeometryObject		theMesh;
+	TQ3ViewObject			theView;
+	TQ3Uns32				s, n, numHits, numScanHits;
+	double					startTime, buildTime, rayTime, nearestTime, pointTime, rectTime, scanTime;
+	void					*theImage;
+
+
+
+	// Create the view
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	memset(&rayData,   0, sizeof(rayData));
+	memset(&pointData, 0, sizeof(pointData));
+	memset(&rectData,  0, sizeof(rectData));
+	rayData.data.sort   = kQ3PickSortNearToFar;
+	pointData.data.sort = kQ3PickSortNearToFar;
+	rectData.data.sort  = kQ3PickSortNone;
+	Q3Vector3D_Set(&rayData.ray.direction, 0.0f, 0.0f, -1.0f);
+
+	// The projective matrix leaves points with z == 0 where they are
+	Q3Matrix4x4_SetIdentity(&theMatrix);
+	theMatrix.value[2][3] = 0.001f;
+
+	printf("  %10s %12s %10s %10s %10s %10s %10s\n", "triangles", "first pick",
+			"ray", "nearest", "point", "rect", "scan ray");
+
+
+
+	// Time picks at each size
+	for (s = 0; s < sizeof(theSizes) / sizeof(theSizes[0]); s++)
+		{
+		theMesh   = MyNewGridMesh(theSizes[s], 0.0f, kQ3False);
+		scanGroup = Q3OrderedDisplayGroup_New();
+		if (theMesh == NULL || scanGroup == NULL)
+			break;
+
+		theTransform = Q3MatrixTransform_New(&theMatrix);
+		Q3Group_AddObjectAndDispose(scanGroup, &theTransform);
+		Q3Group_AddObject(scanGroup, theMesh);
+
+
+
+		// The first pick builds the tree
+		Q3Point3D_Set(&rayData.ray.origin, 0.5f, 0.5f, 1.0f);
+		startTime = MyTime();
+		MyPickObject(theView, Q3WorldRayPick_New(&rayData), theMesh);
+		buildTime = MyTime() - startTime;
+
+
+
+		// Time each kind of pick at random points
+		numHits = 0;
+		rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+		startTime = MyTime();
+		for (n = 0; n < kNumPicks; n++)
+			{
+			Q3Point3D_Set(&rayData.ray.origin, MyRandom(), MyRandom(), 1.0f);
+			numHits += MyPickObject(theView, Q3WorldRayPick_New(&rayData), theMesh);
+			}
+		rayTime = MyTime() - startTime;
+
+		rayData.data.numHitsToReturn = 1;
+		startTime = MyTime();
+		for (n = 0; n < kNumPicks; n++)
+			{
+			Q3Point3D_Set(&rayData.ray.origin, MyRandom(), MyRandom(), 1.0f);
+			MyPickObject(theView, Q3WorldRayPick_New(&rayData), theMesh);
+			}
+		nearestTime = MyTime() - startTime;
+
+		startTime = MyTime();
+		for (n = 0; n < kNumPicks; n++)
+			{
+			Q3Point2D_Set(&pointData.point, MyRandom() * kImageSize, MyRandom() * kImageSize);
+			MyPickObject(theView, Q3WindowPointPick_New(&pointData), theMesh);
+			}
+		pointTime = MyTime() - startTime;
+
+		startTime = MyTime();
+		for (n = 0; n < kNumPicks; n++)
+			{
+			rectData.rect.min.x = MyRandom() * (kImageSize - 4);
+			rectData.rect.min.y = MyRandom() * (kImageSize - 4);
+			rectData.rect.max.x = rectData.rect.min.x + 4.0f;
+			rectData.rect.max.y = rectData.rect.min.y + 4.0f;
+			MyPickObject(theView, Q3WindowRectPick_New(&rectData), theMesh);
+			}
+		rectTime = MyTime() - startTime;
+
+
+
+		// Time a full scan, which should find the same hits
+		numScanHits = 0;
+		rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+		startTime = MyTime();
+		for (n = 0; n < kNumPicks / 10; n++)
+			{
+			Q3Point3D_Set(&rayData.ray.origin, MyRandom(), MyRandom(), 1.0f);
+			numScanHits += MyPickObject(theView, Q3WorldRayPick_New(&rayData), scanGroup);
+			}
+		scanTime = (MyTime() - startTime) * 10.0;
+
+		printf("  %10lu %9.2f ms %7.3f ms %7.3f ms %7.3f ms %7.3f ms %7.3f ms\n",
+				(unsigned long) (theSizes[s] * theSizes[s] * 2), buildTime,
+				rayTime / kNumPicks, nearestTime / kNumPicks, pointTime / kNumPicks,
+				rectTime / kNumPicks, scanTime / kNumPicks);
+
+		if (numHits != kNumPicks || numScanHits != kNumPicks / 10)
+			printf("  Missed hits: %lu of %lu, %lu of %lu in the scan\n",
+					(unsigned long) numHits, (unsigned long) kNumPicks,
+					(unsigned long) numScanHits, (unsigned long) (kNumPicks / 10));
+
+		Q3Object_Dispose(scanGroup);
+		Q3Object_Dispose(theMesh);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTriangleRenderer_Triangle : Triangle renderer triangle method.
+//-----------------------------------------------------------------------------
+//		Note :	Sums the vertex colours, copying them out of the attribute sets
+//				since the sets may be changed once we return.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MyTriangleRenderer_Triangle(TQ3ViewObject theView, void *instanceData,
+							TQ3GeometryObject theGeom, const TQ3TriangleData *geomData)
+{	const TQ3ColorRGB	*theColour;
+	TQ3Uns32			n;
+#pragma unused(theView)
+#pragma unused(instanceData)
+#pragma unused(theGeom)
+
+
+
+	// Sum the colours
+	for (n = 0; n < 3; n++)
+		{
+		theColour = (const TQ3ColorRGB *) Q3XAttributeSet_GetPointer(geomData->vertices[n].attributeSet,
+																		kQ3AttributeTypeDiffuseColor);
+		if (theColour != NULL)
+			gColourSum += theColour->r + theColour->g + theColour->b;
+		}
+	
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTriangleRenderer_Geometry : Triangle renderer geometry metahandler.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+MyTriangleRenderer_Geometry(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3GeometryTypeTriangle:
+			theMethod = (TQ3XFunctionPointer) MyTriangleRenderer_Triangle;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTriangleRenderer_MetaHandler : Triangle renderer metahandler.
+//-----------------------------------------------------------------------------
+//		Note :	The renderer only accepts triangles, so every other geometry
+//				is decomposed for it.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+MyTriangleRenderer_MetaHandler(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3XMethodTypeRendererSubmitGeometryMetaHandler:
+			theMethod = (TQ3XFunctionPointer) MyTriangleRenderer_Geometry;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_TriMeshSubmit : Time decomposed TriMesh submits.
+//-----------------------------------------------------------------------------
+//		Note :	A TriMesh is decomposed for a renderer which only accepts
+//				triangles, with one triangle attribute set and one set per
+//				vertex changed in place for each triangle. We compare this
+//				with creating the sets for each triangle, which is what Quesa
+//				would have to do to keep the sets for one triangle unchanged.
+//-----------------------------------------------------------------------------
+static void
+MyTest_TriMeshSubmit(void)
+{	const TQ3Uns32			theSizes[] = { 64, 256 };
+	TQ3AttributeSet			vertexSets[3];
+	TQ3ObjectType			rendererType;
+	TQ3XObjectClass			rendererClass;
+	TQ3TriangleData			triangleData;
+	TQ3TriMeshData			*meshData;
+	TQ3ColorRGB				*theColours;
+	TQ3GeometryObject		theMesh;
+	TQ3ViewObject			theView;
+	TQ3Uns32				s, n, i, t, numFrames;
+	double					startTime, meshTime, triangleTime, meshSum;
+	void					*theImage;
+
+
+
+	// Register the renderer and create the view
+	rendererClass = Q3XObjectHierarchy_RegisterClass(kQ3SharedTypeRenderer, &rendererType,
+														"PerfTest:TriangleRenderer",
+														MyTriangleRenderer_MetaHandler, NULL, 0, 0);
+	theView = MyNewView(&theImage);
+	if (rendererClass == NULL || theView == NULL)
+		return;
+
+	Q3View_SetRendererByType(theView, rendererType);
+
+	printf("  %10s %14s %14s\n", "triangles", "shared sets", "sets per tri");
+
+
+
+	// Time the submits at each size
+	for (s = 0; s < sizeof(theSizes) / sizeof(theSizes[0]); s++)
+		{
+		// Create a mesh with vertex colours
+		theMesh = MyNewGridMesh(theSizes[s], 0.0f, kQ3True);
+		if (theMesh == NULL)
+			break;
+
+		numFrames = (8 * 1024 * 1024) / (theSizes[s] * theSizes[s] * 2 * 16) + 1;
+
+
+
+		// Render the mesh, sharing attribute sets between its triangles
+		gColourSum = 0.0;
+		startTime  = MyTime();
+		for (t = 0; t < numFrames; t++)
+			{
+			Q3View_StartRendering(theView);
+			do
+				Q3Object_Submit(theMesh, theView);
+			while (Q3View_EndRendering(theView) == kQ3ViewStatusRetraverse);
+			}
+		meshTime = MyTime() - startTime;
+		meshSum  = gColourSum;
+
+
+
+		// Render the same triangles, with new attribute sets for each one
+		Q3TriMesh_LockData(theMesh, kQ3True, &meshData);
+		theColours = (TQ3ColorRGB *) meshData->vertexAttributeTypes[0].data;
+		Q3Memory_Clear(&triangleData, sizeof(triangleData));
+
+		gColourSum = 0.0;
+		startTime  = MyTime();
+		for (t = 0; t < numFrames; t++)
+			{
+			Q3View_StartRendering(theView);
+			do
+				{
+				for (n = 0; n < meshData->numTriangles; n++)
+					{
+					for (i = 0; i < 3; i++)
+						{
+						vertexSets[i] = Q3AttributeSet_New();
+						triangleData.vertices[i].point        = meshData->points[meshData->triangles[n].pointIndices[i]];
+						triangleData.vertices[i].attributeSet = vertexSets[i];
+						Q3AttributeSet_Add(vertexSets[i], kQ3AttributeTypeDiffuseColor,
+											&theColours[meshData->triangles[n].pointIndices[i]]);
+						}
+
+					triangleData.triangleAttributeSet = Q3AttributeSet_New();
+					Q3Triangle_Submit(&triangleData, theView);
+
+					Q3Object_Dispose(triangleData.triangleAttributeSet);
+					for (i = 0; i < 3; i++)
+						Q3Object_Dispose(vertexSets[i]);
+					}
+				}
+			while (Q3View_EndRendering(theView) == kQ3ViewStatusRetraverse);
+			}
+		triangleTime = MyTime() - startTime;
+
+		Q3TriMesh_UnlockData(theMesh);
+
+		printf("  %10lu %11.2f ms %11.2f ms\n", (unsigned long) (theSizes[s] * theSizes[s] * 2),
+				meshTime / numFrames, triangleTime / numFrames);
+
+		if (meshSum != gColourSum)
+			printf("  Colours differ: %f against %f\n", meshSum, gColourSum);
+
+		Q3Object_Dispose(theMesh);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+	Q3XObjectHierarchy_UnregisterClass(rendererClass);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_HashLookup : Time class and property lookups.
+//-----------------------------------------------------------------------------
+//		Note :	Classes are found by type, and object properties by property
+//				type, through Quesa's hash tables. We time lookups of every
+//				registered class, and of the properties of objects with up to
+//				4K properties, against a std::map holding the same items.
+//
+//				Property types are numbered from 0, which must be stored like
+//				any other type. The objects are also duplicated, which copies
+//				their property tables at the size they have grown to.
+//-----------------------------------------------------------------------------
+static void
+MyTest_HashLookup(void)
+{	const TQ3ObjectType							baseTypes[] = { kQ3ObjectTypeElement, kQ3ObjectTypePick,
+																kQ3ObjectTypeShared,  kQ3ObjectTypeView };
+	const TQ3Uns32								theSizes[]  = { 8, 64, 512, 4096 };
+	std::map<TQ3ObjectType, TQ3XObjectClass>	classMap;
+	std::map<TQ3ObjectType, TQ3Uns32>			propertyMap;
+	std::vector<TQ3ObjectType>					theTypes;
+	TQ3SubClassData								subClassData;
+	TQ3Uns32									s, n, theIndex, theValue, numErrors;
+	TQ3Object									theObject, theCopy;
+	double										startTime, hashTime, mapTime;
+	TQ3XObjectClass								theClass;
+
+
+
+	// Find every registered class
+	theTypes.assign(baseTypes, baseTypes + sizeof(baseTypes) / sizeof(baseTypes[0]));
+	for (n = 0; n < theTypes.size(); n++)
+		{
+		if (Q3ObjectHierarchy_GetSubClassData(theTypes[n], &subClassData) == kQ3Success)
+			{
+			theTypes.insert(theTypes.end(), subClassData.classTypes, subClassData.classTypes + subClassData.numClasses);
+			Q3ObjectHierarchy_EmptySubClassData(&subClassData);
+			}
+		}
+
+	for (n = 0; n < theTypes.size(); n++)
+		classMap[theTypes[n]] = Q3XObjectHierarchy_FindClassByType(theTypes[n]);
+
+
+
+	// Time the class lookups
+	numErrors = 0;
+	startTime = MyTime();
+	for (n = 0; n < kNumLookups; n++)
+		{
+		theIndex = (n * 7919) % theTypes.size();
+		theClass = Q3XObjectHierarchy_FindClassByType(theTypes[theIndex]);
+		if (theClass == NULL)
+			numErrors++;
+		}
+	hashTime = MyTime() - startTime;
+
+	startTime = MyTime();
+	for (n = 0; n < kNumLookups; n++)
+		{
+		theIndex = (n * 7919) % theTypes.size();
+		if (classMap.find(theTypes[theIndex])->second == NULL)
+			numErrors++;
+		}
+	mapTime = MyTime() - startTime;
+
+	printf("  %10s %12s %12s\n", "items", "Quesa", "std::map");
+	printf("  %10lu %9.1f ns %9.1f ns   classes\n", (unsigned long) theTypes.size(),
+			1.0e6 * hashTime / kNumLookups, 1.0e6 * mapTime / kNumLookups);
+
+
+
+	// Time property lookups at each size
+	for (s = 0; s < sizeof(theSizes) / sizeof(theSizes[0]); s++)
+		{
+		// Give an object its properties, and duplicate it
+		theObject = Q3DisplayGroup_New();
+		if (theObject == NULL)
+			break;
+
+		propertyMap.clear();
+		for (n = 0; n < theSizes[s]; n++)
+			{
+			theValue = n * 3 + 1;
+			Q3Object_SetProperty(theObject, (TQ3ObjectType) n, sizeof(theValue), &theValue);
+			propertyMap[(TQ3ObjectType) n] = theValue;
+			}
+
+		theCopy = Q3Object_Duplicate(theObject);
+		Q3Object_Dispose(theObject);
+		if (theCopy == NULL)
+			break;
+
+
+
+		// Time the lookups, checking the duplicate has every property
+		startTime = MyTime();
+		for (n = 0; n < kNumLookups; n++)
+			{
+			theIndex = (n * 7919) % theSizes[s];
+			if (Q3Object_GetProperty(theCopy, (TQ3ObjectType) theIndex, sizeof(theValue), NULL, &theValue) != kQ3Success ||
+				theValue != theIndex * 3 + 1)
+				numErrors++;
+			}
+		hashTime = MyTime() - startTime;
+
+		startTime = MyTime();
+		for (n = 0; n < kNumLookups; n++)
+			{
+			theIndex = (n * 7919) % theSizes[s];
+			if (propertyMap.find((TQ3ObjectType) theIndex)->second != theIndex * 3 + 1)
+				numErrors++;
+			}
+		mapTime = MyTime() - startTime;
+
+		printf("  %10lu %9.1f ns %9.1f ns   properties\n", (unsigned long) theSizes[s],
+				1.0e6 * hashTime / kNumLookups, 1.0e6 * mapTime / kNumLookups);
+
+		Q3Object_Dispose(theCopy);
+		}
+
+	if (numErrors != 0)
+		printf("  %lu lookups failed\n", (unsigned long) numErrors);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewPointPairs : Create a TriMesh whose points come in near pairs.
+//-----------------------------------------------------------------------------
+//		Note :	Point 2k+1 is within kMergeDistance of point 2k, and has the
+//				same UV. Every fourth pair has opposite normals, and so must
+//				not be merged.
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject
+MyNewPointPairs(TQ3Uns32 numPoints)
+{	std::vector<TQ3TriMeshTriangleData>	theTriangles(numPoints / 3);
+	std::vector<TQ3Point3D>				thePoints(numPoints);
+	std::vector<TQ3Vector3D>			theNormals(numPoints);
+	std::vector<TQ3Param2D>				theUVs(numPoints);
+	TQ3TriMeshAttributeData				vertexAttributes[2];
+	TQ3TriMeshData						meshData;
+	TQ3Uns32							n;
+
+
+
+	// Build the points
+	for (n = 0; n < numPoints; n++)
+		{
+		if ((n & 1) == 0)
+			{
+			Q3Point3D_Set(&thePoints[n], MyRandom(), MyRandom(), MyRandom());
+			Q3Vector3D_Set(&theNormals[n], 0.0f, 0.0f, 1.0f);
+			Q3Param2D_Set(&theUVs[n], thePoints[n].x, thePoints[n].y);
+			}
+		else
+			{
+			Q3Point3D_Set(&thePoints[n], thePoints[n - 1].x + 0.25f * kMergeDistance * MyRandom(),
+										 thePoints[n - 1].y + 0.25f * kMergeDistance * MyRandom(),
+										 thePoints[n - 1].z + 0.25f * kMergeDistance * MyRandom());
+			theNormals[n] = theNormals[n - 1];
+			theUVs[n]     = theUVs[n - 1];
+			
+			if ((n % 8) == 1)
+				theNormals[n].z = -1.0f;
+			}
+		}
+
+	for (n = 0; n < theTriangles.size(); n++)
+		{
+		theTriangles[n].pointIndices[0] = 3 * n + 0;
+		theTriangles[n].pointIndices[1] = 3 * n + 1;
+		theTriangles[n].pointIndices[2] = 3 * n + 2;
+		}
+
+
+
+	// Create the TriMesh
+	vertexAttributes[0].attributeType     = kQ3AttributeTypeNormal;
+	vertexAttributes[0].data              = &theNormals[0];
+	vertexAttributes[0].attributeUseArray = NULL;
+	vertexAttributes[1].attributeType     = kQ3AttributeTypeSurfaceUV;
+	vertexAttributes[1].data              = &theUVs[0];
+	vertexAttributes[1].attributeUseArray = NULL;
+
+	memset(&meshData, 0, sizeof(meshData));
+	meshData.numTriangles            = (TQ3Uns32) theTriangles.size();
+	meshData.triangles               = &theTriangles[0];
+	meshData.numPoints               = numPoints;
+	meshData.points                  = &thePoints[0];
+	meshData.numVertexAttributeTypes = 2;
+	meshData.vertexAttributeTypes    = vertexAttributes;
+	Q3BoundingBox_SetFromPoints3D(&meshData.bBox, &thePoints[0], numPoints, sizeof(TQ3Point3D));
+
+	return(Q3TriMesh_New(&meshData));
+}
+
+
+
+
+
+//=============================================================================
+//      MyScanNearPoints : Merge near points by comparing every pair.
+//-----------------------------------------------------------------------------
+//		Note :	This is the clustering MergeNearTriMeshPoints used before it
+//				had a grid: each point joins the lowest-numbered earlier
+//				cluster that it matches. Returns the merged point indices.
+//-----------------------------------------------------------------------------
+static std::vector<TQ3Uns32>
+MyScanNearPoints(TQ3GeometryObject theMesh, TQ3Uns32 *numMerged)
+{	float					distSqThreshold = kMergeDistance * kMergeDistance;
+	std::vector<TQ3Uns32>	firstOfCluster, newIndex;
+	TQ3Vector3D				*theNormals;
+	TQ3Param2D				*theUVs;
+	TQ3TriMeshData			meshData;
+	TQ3Uns32				i, j, numPoints;
+
+
+
+	// Cluster the points
+	*numMerged = 0;
+	if (Q3TriMesh_GetData(theMesh, &meshData) != kQ3Success)
+		return(newIndex);
+
+	theNormals = (TQ3Vector3D *) meshData.vertexAttributeTypes[0].data;
+	theUVs     = (TQ3Param2D  *) meshData.vertexAttributeTypes[1].data;
+	numPoints  = meshData.numPoints;
+	firstOfCluster.resize(numPoints);
+	newIndex.resize(numPoints);
+
+	for (i = 0; i < numPoints; i++)
+		{
+		firstOfCluster[i] = i;
+		for (j = 0; j < i; j++)
+			{
+			if (firstOfCluster[j] == j &&
+				Q3FastPoint3D_DistanceSquared(&meshData.points[i], &meshData.points[j]) < distSqThreshold &&
+				Q3FastParam2D_DistanceSquared(&theUVs[i], &theUVs[j]) < distSqThreshold &&
+				Q3FastVector3D_Dot(&theNormals[i], &theNormals[j]) > cosf(kMergeDistance))
+				{
+				firstOfCluster[i] = j;
+				break;
+				}
+			}
+		}
+
+
+
+	// Number the merged points
+	for (i = 0; i < numPoints; i++)
+		{
+		if (firstOfCluster[i] == i)
+			newIndex[i] = i - *numMerged;
+		else
+			{
+			newIndex[i] = newIndex[firstOfCluster[i]];
+			*numMerged += 1;
+			}
+		}
+
+	Q3TriMesh_EmptyData(&meshData);
+	return(newIndex);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_MergePoints : Time MergeNearTriMeshPoints.
+//-----------------------------------------------------------------------------
+//		Note :	The merge finds candidate points through a grid, and works out
+//				the neighbouring cells of each point as it goes. Up to
+//				kMaxScanPoints we also merge by comparing every pair of points,
+//				and check that both give the same TriMesh.
+//-----------------------------------------------------------------------------
+static void
+MyTest_MergePoints(void)
+{	const TQ3Uns32			theSizes[] = { 10000, 40000, 160000, 640000, 2560000 };
+	TQ3Uns32				s, n, numMerged, numScanMerged, numKept, numErrors;
+	double					startTime, mergeTime, scanTime;
+	TQ3GeometryObject		theMesh, theCopy;
+	std::vector<TQ3Uns32>	newIndex;
+	TQ3TriMeshData			meshData, copyData;
+
+
+
+	// Merge meshes of each size
+	printf("  %10s %10s %12s %12s\n", "points", "merged", "grid", "scan");
+	for (s = 0; s < sizeof(theSizes) / sizeof(theSizes[0]); s++)
+		{
+		theMesh = MyNewPointPairs(theSizes[s]);
+		theCopy = Q3Object_Duplicate(theMesh);
+		if (theMesh == NULL || theCopy == NULL)
+			break;
+
+		startTime = MyTime();
+		numMerged = MergeNearTriMeshPoints(theMesh, kMergeDistance, kMergeDistance, kMergeDistance);
+		mergeTime = MyTime() - startTime;
+
+
+
+		// Check the result against a scan of every pair of points
+		numErrors = 0;
+		scanTime  = 0.0;
+		if (theSizes[s] <= kMaxScanPoints)
+			{
+			startTime = MyTime();
+			newIndex  = MyScanNearPoints(theCopy, &numScanMerged);
+			scanTime  = MyTime() - startTime;
+
+			Q3TriMesh_GetData(theMesh, &meshData);
+			Q3TriMesh_GetData(theCopy, &copyData);
+			if (numScanMerged != numMerged || meshData.numPoints != copyData.numPoints - numMerged)
+				numErrors++;
+			else
+				{
+				// Each point which starts a cluster is kept, in order
+				numKept = 0;
+				for (n = 0; n < copyData.numPoints; n++)
+					{
+					if (newIndex[n] == numKept)
+						{
+						if (memcmp(&meshData.points[numKept], &copyData.points[n], sizeof(TQ3Point3D)) != 0)
+							numErrors++;
+						numKept++;
+						}
+					}
+
+				for (n = 0; n < copyData.numTriangles; n++)
+					{
+					if (meshData.triangles[n].pointIndices[0] != newIndex[copyData.triangles[n].pointIndices[0]] ||
+						meshData.triangles[n].pointIndices[1] != newIndex[copyData.triangles[n].pointIndices[1]] ||
+						meshData.triangles[n].pointIndices[2] != newIndex[copyData.triangles[n].pointIndices[2]])
+						numErrors++;
+					}
+				}
+			Q3TriMesh_EmptyData(&meshData);
+			Q3TriMesh_EmptyData(&copyData);
+			}
+
+		if (theSizes[s] <= kMaxScanPoints)
+			printf("  %10lu %10lu %9.1f ms %9.1f ms\n", (unsigned long) theSizes[s],
+					(unsigned long) numMerged, mergeTime, scanTime);
+		else
+			printf("  %10lu %10lu %9.1f ms %12s\n", (unsigned long) theSizes[s],
+					(unsigned long) numMerged, mergeTime, "-");
+
+		if (numErrors != 0)
+			printf("  %lu points or triangles differ from the scan\n", (unsigned long) numErrors);
+
+		Q3Object_Dispose(theMesh);
+		Q3Object_Dispose(theCopy);
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      MyWriteObject : Write an object to a storage as 3DMF.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MyWriteObject(TQ3StorageObject theStorage, TQ3Object theObject, TQ3FileMode fileMode)
+{	TQ3Status			qd3dStatus = kQ3Failure;
+	TQ3ViewStatus		viewStatus = kQ3ViewStatusRetraverse;
+	TQ3FileObject		theFile;
+	TQ3ViewObject		theView;
+	void				*theImage;
+
+
+
+	// Write the object
+	theView = MyNewView(&theImage);
+	theFile = Q3File_New();
+
+	if (theView != NULL && theFile != NULL &&
+		Q3File_SetStorage(theFile, theStorage) == kQ3Success &&
+		Q3File_OpenWrite(theFile, fileMode) == kQ3Success)
+		{
+		qd3dStatus = Q3View_StartWriting(theView, theFile);
+		while (qd3dStatus == kQ3Success && viewStatus == kQ3ViewStatusRetraverse)
+			{
+			qd3dStatus = Q3Object_Submit(theObject, theView);
+			viewStatus = Q3View_EndWriting(theView);
+			}
+
+		Q3File_Close(theFile);
+		}
+
+	if (theFile != NULL)
+		Q3Object_Dispose(theFile);
+
+	if (theView != NULL)
+		Q3Object_Dispose(theView);
+
+	free(theImage);
+	
+	return(qd3dStatus);
+}
+
+
+
+
+
+//=============================================================================
+//      MyReadTriMesh : Read the first TriMesh from a 3DMF storage.
+//-----------------------------------------------------------------------------
+//		Note :	Objects before the TriMesh are skipped without being read.
+//
+//				The size of the storage is returned, or 0 if its 32-bit size
+//				is available for a storage of 4Gb or more, or vice versa.
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject
+MyReadTriMesh(TQ3StorageObject theStorage, TQ3StorageOffset *theSize)
+{	TQ3GeometryObject	theMesh = NULL;
+	TQ3FileMode			fileMode;
+	TQ3FileObject		theFile;
+	TQ3Uns32			theSize32;
+	TQ3Boolean			hasSize32;
+
+
+
+	// Open the file
+	theFile = Q3File_New();
+	if (theFile == NULL)
+		return(NULL);
+
+	if (Q3File_SetStorage(theFile, theStorage) != kQ3Success ||
+		Q3File_OpenRead(theFile, &fileMode) != kQ3Success)
+		{
+		Q3Object_Dispose(theFile);
+		return(NULL);
+		}
+
+
+
+	// Get the size, which is only available while the storage is open
+	*theSize  = 0;
+	hasSize32 = (TQ3Boolean) (Q3Storage_GetSize(theStorage, &theSize32) == kQ3Success);
+	if (Q3Storage_GetSize64(theStorage, theSize) != kQ3Success ||
+		hasSize32 != (TQ3Boolean) (*theSize <= 0xFFFFFFFFULL))
+		*theSize = 0;
+
+
+
+	// Find the TriMesh
+	while (theMesh == NULL && !Q3File_IsEndOfFile(theFile))
+		{
+		if (Q3File_IsNextObjectOfType(theFile, kQ3GeometryTypeTriMesh))
+			theMesh = Q3File_ReadObject(theFile);
+		else if (Q3File_SkipObject(theFile) != kQ3Success)
+			break;
+		}
+
+	Q3File_Close(theFile);
+	Q3Object_Dispose(theFile);
+	
+	return(theMesh);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTimeRead : Time reading a TriMesh, checking the storage size and
+//					 the triangle count.
+//-----------------------------------------------------------------------------
+//		Note :	The storage is disposed of.
+//-----------------------------------------------------------------------------
+static void
+MyTimeRead(const char *theLabel, TQ3StorageObject theStorage, TQ3StorageOffset fileSize, TQ3Uns32 numTriangles,
+			TQ3StorageOffset meshSize)
+{	TQ3TriMeshData		*meshData;
+	double				startTime, readTime;
+	TQ3StorageOffset	theSize;
+	TQ3GeometryObject	theMesh;
+
+
+
+	// Read the TriMesh
+	if (theStorage == NULL)
+		return;
+
+	startTime = MyTime();
+	theMesh   = MyReadTriMesh(theStorage, &theSize);
+	readTime  = MyTime() - startTime;
+
+	if (theMesh == NULL || Q3TriMesh_LockData(theMesh, kQ3True, &meshData) != kQ3Success)
+		printf("  %-24s failed\n", theLabel);
+	else
+		{
+		printf("  %-24s %9.1f ms %9.1f Mb/s%s%s\n", theLabel, readTime,
+				((double) meshSize / (1024.0 * 1024.0)) / (readTime / 1000.0),
+				theSize == fileSize ? "" : "   wrong size",
+				meshData->numTriangles == numTriangles ? "" : "   wrong TriMesh");
+		Q3TriMesh_UnlockData(theMesh);
+		}
+
+	if (theMesh != NULL)
+		Q3Object_Dispose(theMesh);
+
+	Q3Object_Dispose(theStorage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_LargeFile : Time reading large 3DMF files.
+//-----------------------------------------------------------------------------
+//		Note :	A 2M triangle TriMesh is written to a file, and read back
+//				through path storage, and on Unix through mapped storage.
+//
+//				The same TriMesh is then placed past 6Gb in a second file,
+//				behind padding objects which are skipped without being read.
+//				The padding is left as a hole in the file, so on file systems
+//				with sparse files this takes little disk space or time. Read
+//				rates are for the TriMesh alone.
+//-----------------------------------------------------------------------------
+static void
+MyTest_LargeFile(void)
+{	TQ3Uns32				padHeader[2] = { Q3_OBJECT_TYPE('p', 'a', 'd', 's'), kLargeFilePadSize };
+	TQ3Uns32				theLabel     = Q3_OBJECT_TYPE('3', 'D', 'M', 'F');
+	TQ3Uns32				n, numTriangles;
+	TQ3StorageOffset		fileSize, largeSize;
+	std::vector<TQ3Uns8>	fileData;
+	TQ3GeometryObject		theMesh;
+	TQ3StorageObject		theStorage;
+	FILE					*theFile;
+	TQ3Uns8					*theBytes;
+
+
+
+	// Write the TriMesh
+	theMesh      = MyNewGridMesh(1024, 0.0f, kQ3False);
+	theStorage   = Q3PathStorage_New(kLargeFileName);
+	numTriangles = 2 * 1024 * 1024;
+	if (theMesh == NULL || theStorage == NULL || MyWriteObject(theStorage, theMesh, kQ3FileModeNormal) != kQ3Success)
+		{
+		printf("  could not write %s\n", kLargeFileName);
+		return;
+		}
+
+	Q3Object_Dispose(theMesh);
+	Q3Object_Dispose(theStorage);
+
+
+
+	// Read it back
+	theFile = fopen(kLargeFileName, "rb");
+	if (theFile != NULL)
+		{
+		fseek(theFile, 0, SEEK_END);
+		fileData.resize((size_t) ftell(theFile));
+		fseek(theFile, 0, SEEK_SET);
+		if (fileData.empty() || fread(&fileData[0], 1, fileData.size(), theFile) != fileData.size())
+			fileData.clear();
+		fclose(theFile);
+		}
+
+	fileSize = fileData.size();
+	printf("  %-24s %9.1f Mb\n", "file size", (double) fileSize / (1024.0 * 1024.0));
+
+	MyTimeRead("path storage",   Q3PathStorage_New(kLargeFileName),       fileSize, numTriangles, fileSize);
+#if QUESA_OS_UNIX
+	MyTimeRead("mapped storage", Q3UnixMappedStorage_New(kLargeFileName), fileSize, numTriangles, fileSize);
+#endif
+
+
+
+	// Move the TriMesh past 6Gb, behind padding in the file's byte order.
+	// The header has no table of contents, so the objects can be moved.
+	theBytes = fileData.empty() ? NULL : &fileData[0];
+	if (theBytes == NULL || fileSize < 24 || memcmp(theBytes + 16, "\0\0\0\0\0\0\0\0", 8) != 0)
+		{
+		printf("  could not read %s\n", kLargeFileName);
+		remove(kLargeFileName);
+		return;
+		}
+
+	if (memcmp(theBytes, &theLabel, 4) != 0)
+		{
+		for (n = 0; n < 2; n++)
+			padHeader[n] = ((padHeader[n] & 0x000000FF) << 24) | ((padHeader[n] & 0x0000FF00) <<  8) |
+						   ((padHeader[n] & 0x00FF0000) >>  8) | ((padHeader[n] & 0xFF000000) >> 24);
+		}
+
+	theFile = fopen(kLargeFileName, "wb");
+	if (theFile == NULL)
+		return;
+
+	fwrite(theBytes, 1, 24, theFile);
+	for (n = 0; n < kLargeFileNumPads; n++)
+		{
+		fwrite(padHeader, sizeof(padHeader), 1, theFile);
+#if QUESA_OS_UNIX
+		fseeko(theFile, (off_t) kLargeFilePadSize, SEEK_CUR);
+#else
+		fseek(theFile, (long) kLargeFilePadSize, SEEK_CUR);
+#endif
+		}
+
+	fwrite(theBytes + 24, 1, (size_t) (fileSize - 24), theFile);
+	fclose(theFile);
+
+
+
+	// Read the TriMesh again
+	largeSize = fileSize + kLargeFileNumPads * (sizeof(padHeader) + (TQ3StorageOffset) kLargeFilePadSize);
+	printf("  %-24s %9.1f Mb\n", "padded file size", (double) largeSize / (1024.0 * 1024.0));
+
+	MyTimeRead("padded, path storage",   Q3PathStorage_New(kLargeFileName),       largeSize, numTriangles, fileSize);
+#if QUESA_OS_UNIX
+	MyTimeRead("padded, mapped storage", Q3UnixMappedStorage_New(kLargeFileName), largeSize, numTriangles, fileSize);
+#endif
+
+	remove(kLargeFileName);
+}
+
+
+
+
+
+//=============================================================================
+//      MyShadowRenderer_StartPass : Shadow renderer start pass method.
+//-----------------------------------------------------------------------------
+//		Note :	The renderer takes one pass, plus one for each light, as a
+//				renderer with shadows would.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MyShadowRenderer_StartPass(TQ3ViewObject theView, void *instanceData,
+							TQ3CameraObject theCamera, TQ3GroupObject theLights)
+{	TQ3Uns32		numLights = 0;
+#pragma unused(theView)
+#pragma unused(instanceData)
+#pragma unused(theCamera)
+
+
+
+	// Count the passes we need
+	if (theLights != NULL)
+		Q3Group_CountObjects(theLights, &numLights);
+
+	gPassesNeeded = numLights + 1;
+	gPassesDone  += 1;
+	
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      MyShadowRenderer_EndPass : Shadow renderer end pass method.
+//-----------------------------------------------------------------------------
+static TQ3ViewStatus
+MyShadowRenderer_EndPass(TQ3ViewObject theView, void *instanceData)
+{
+#pragma unused(theView)
+#pragma unused(instanceData)
+
+
+
+	// Ask for another pass until we've done one for each light
+	if (gPassesDone < gPassesNeeded)
+		return(kQ3ViewStatusRetraverse);
+
+	gPassesDone = 0;
+	return(kQ3ViewStatusDone);
+}
+
+
+
+
+
+//=============================================================================
+//      MyShadowRenderer_TriMesh : Shadow renderer TriMesh method.
+//-----------------------------------------------------------------------------
+//		Note :	Fails in pass gFailPass, if that is set.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MyShadowRenderer_TriMesh(TQ3ViewObject theView, void *instanceData,
+							TQ3GeometryObject theGeom, const TQ3TriMeshData *geomData)
+{
+#pragma unused(theView)
+#pragma unused(instanceData)
+#pragma unused(theGeom)
+#pragma unused(geomData)
+
+
+
+	// Count the TriMesh
+	gNumTriMeshes++;
+	
+	return(gPassesDone == gFailPass ? kQ3Failure : kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      MyShadowRenderer_Geometry : Shadow renderer geometry metahandler.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+MyShadowRenderer_Geometry(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3GeometryTypeTriMesh:
+			theMethod = (TQ3XFunctionPointer) MyShadowRenderer_TriMesh;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
+//=============================================================================
+//      MyShadowRenderer_MetaHandler : Shadow renderer metahandler.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+MyShadowRenderer_MetaHandler(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3XMethodTypeRendererStartPass:
+			theMethod = (TQ3XFunctionPointer) MyShadowRenderer_StartPass;
+			break;
+
+		case kQ3XMethodTypeRendererEndPass:
+			theMethod = (TQ3XFunctionPointer) MyShadowRenderer_EndPass;
+			break;
+
+		case kQ3XMethodTypeRendererSubmitGeometryMetaHandler:
+			theMethod = (TQ3XFunctionPointer) MyShadowRenderer_Geometry;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
+//=============================================================================
+//      MyRenderFrames : Render a number of frames, and return the time.
+//-----------------------------------------------------------------------------
+//		Note :	The number of application submit loops is returned, and the
+//				status of the last frame.
+//-----------------------------------------------------------------------------
+static double
+MyRenderFrames(TQ3ViewObject theView, TQ3Object theObject, TQ3Uns32 numFrames,
+				TQ3Uns32 *numLoops, TQ3ViewStatus *viewStatus)
+{	double		startTime;
+	TQ3Uns32	t;
+
+
+
+	// Render the frames
+	*numLoops   = 0;
+	*viewStatus = kQ3ViewStatusError;
+	startTime   = MyTime();
+
+	for (t = 0; t < numFrames; t++)
+		{
+		if (Q3View_StartRendering(theView) != kQ3Success)
+			break;
+
+		do
+			{
+			Q3Object_Submit(theObject, theView);
+			(*numLoops)++;
+			*viewStatus = Q3View_EndRendering(theView);
+			}
+		while (*viewStatus == kQ3ViewStatusRetraverse);
+		}
+
+	return(MyTime() - startTime);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_PassReplay : Time multi-pass rendering with pass replay.
+//-----------------------------------------------------------------------------
+//		Note :	A renderer which takes a pass for each of 8 shadow casting
+//				lights renders a scene of translated, coloured TriMeshes. The
+//				application submits the scene for every pass, unless the view
+//				replays the first pass.
+//
+//				The renderer must see the same TriMeshes either way, and a
+//				replayed pass which fails must end the frame with an error.
+//-----------------------------------------------------------------------------
+static void
+MyTest_PassReplay(void)
+{	TQ3PointLightData		lightData;
+	TQ3GroupObject			theScene, theLights;
+	TQ3Uns32				n, numFrames, numLoops, numMeshes;
+	TQ3ViewStatus			viewStatus;
+	TQ3ObjectType			rendererType;
+	TQ3XObjectClass			rendererClass;
+	TQ3AttributeSet			theAttributes;
+	TQ3GeometryObject		theMesh;
+	TQ3Object				theObject;
+	TQ3ViewObject			theView;
+	TQ3ColorRGB				theColour;
+	TQ3Vector3D				theOffset;
+	TQ3GroupObject			theGroup;
+	double					submitTime, replayTime;
+	void					*theImage;
+
+
+
+	// Register the renderer and create the view
+	rendererClass = Q3XObjectHierarchy_RegisterClass(kQ3SharedTypeRenderer, &rendererType,
+														"PerfTest:ShadowRenderer",
+														MyShadowRenderer_MetaHandler, NULL, 0, 0);
+	theView = MyNewView(&theImage);
+	if (rendererClass == NULL || theView == NULL)
+		return;
+
+	Q3View_SetRendererByType(theView, rendererType);
+
+
+
+	// Add the lights
+	memset(&lightData, 0, sizeof(lightData));
+	lightData.lightData.isOn       = kQ3True;
+	lightData.lightData.brightness = 1.0f;
+	lightData.castsShadows         = kQ3True;
+	lightData.attenuation          = kQ3AttenuationTypeNone;
+	Q3ColorRGB_Set(&lightData.lightData.color, 1.0f, 1.0f, 1.0f);
+
+	theLights = Q3LightGroup_New();
+	for (n = 0; n < kNumShadowLights; n++)
+		{
+		Q3Point3D_Set(&lightData.location, MyRandom(), MyRandom(), 2.0f);
+		theObject = Q3PointLight_New(&lightData);
+		Q3Group_AddObjectAndDispose(theLights, &theObject);
+		}
+
+	Q3View_SetLightGroup(theView, theLights);
+	Q3Object_Dispose(theLights);
+
+
+
+	// Build the scene, each TriMesh in a group with a transform and colour
+	theMesh  = MyNewGridMesh(2, 0.0f, kQ3False);
+	theScene = Q3OrderedDisplayGroup_New();
+	for (n = 0; n < kNumReplayObjects; n++)
+		{
+		theGroup = Q3OrderedDisplayGroup_New();
+
+		Q3Vector3D_Set(&theOffset, MyRandom(), MyRandom(), -MyRandom());
+		theObject = Q3TranslateTransform_New(&theOffset);
+		Q3Group_AddObjectAndDispose(theGroup, &theObject);
+
+		Q3ColorRGB_Set(&theColour, MyRandom(), MyRandom(), MyRandom());
+		theAttributes = Q3AttributeSet_New();
+		Q3AttributeSet_Add(theAttributes, kQ3AttributeTypeDiffuseColor, &theColour);
+		Q3Group_AddObjectAndDispose(theGroup, &theAttributes);
+
+		Q3Group_AddObject(theGroup, theMesh);
+		Q3Group_AddObjectAndDispose(theScene, &theGroup);
+		}
+
+	Q3Object_Dispose(theMesh);
+
+	printf("  %10s %8s %14s %14s\n", "objects", "passes", "submit", "replay");
+
+
+
+	// Render the scene with the application submitting every pass, then with replay
+	numFrames = 20;
+
+	gNumTriMeshes = 0;
+	submitTime    = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus);
+	numMeshes     = gNumTriMeshes;
+
+	if (numLoops != numFrames * (kNumShadowLights + 1) || viewStatus != kQ3ViewStatusDone)
+		printf("  Submit loop ran %lu times\n", (unsigned long) numLoops);
+
+	Q3View_AllowPassReplay(theView, kQ3True);
+	gNumTriMeshes = 0;
+	replayTime    = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus);
+
+	if (numLoops != numFrames || viewStatus != kQ3ViewStatusDone)
+		printf("  Replayed submit loop ran %lu times\n", (unsigned long) numLoops);
+
+	printf("  %10lu %8lu %11.2f ms %11.2f ms\n", (unsigned long) kNumReplayObjects,
+			(unsigned long) (kNumShadowLights + 1), submitTime / numFrames, replayTime / numFrames);
+
+	if (gNumTriMeshes != numMeshes)
+		printf("  TriMeshes differ: %lu against %lu\n", (unsigned long) gNumTriMeshes, (unsigned long) numMeshes);
+
+
+
+	// Fail the second pass, which is replayed
+	gFailPass = 2;
+	MyRenderFrames(theView, theScene, 1, &numLoops, &viewStatus);
+	gFailPass   = 0;
+	gPassesDone = 0;
+
+	if (viewStatus != kQ3ViewStatusError)
+		printf("  Failed replay returned status %d\n", (int) viewStatus);
+
+
+
+	// Clean up
+	Q3Object_Dispose(theScene);
+	Q3Object_Dispose(theView);
+	free(theImage);
+	Q3XObjectHierarchy_UnregisterClass(rendererClass);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_GroupParents : Time an object held by many groups.
+//-----------------------------------------------------------------------------
+//		Note :	A shared TriMesh is placed in each of many groups, whose type
+//				indexes are then built. This links every group to the TriMesh,
+//				so that edits to the TriMesh reach them.
+//
+//				The groups are disposed of in the reverse order, which would
+//				find each one at the end of the TriMesh's list of groups if it
+//				were searched, and the time to edit an object which is in no
+//				group is measured for comparison.
+//-----------------------------------------------------------------------------
+static void
+MyTest_GroupParents(void)
+{	TQ3Uns32				n, numGroups;
+	double					startTime, buildTime, editTime, disposeTime;
+	std::vector<TQ3Object>	theGroups;
+	TQ3GroupPosition		thePosition;
+	TQ3GeometryObject		theMesh, loneMesh;
+
+
+
+	// Time edits to an object which is in no group
+	loneMesh  = MyNewGridMesh(2, 0.0f, kQ3False);
+	startTime = MyTime();
+
+	for (n = 0; n < kNumParentEdits; n++)
+		Q3Shared_Edited(loneMesh);
+
+	editTime = MyTime() - startTime;
+	Q3Object_Dispose(loneMesh);
+
+	printf("  %lu edits of an object in no group: %.2f ms\n\n", (unsigned long) kNumParentEdits, editTime);
+	printf("  %10s %14s %14s %14s\n", "groups", "build", "edit", "dispose");
+
+
+
+	// Time each number of groups
+	theMesh = MyNewGridMesh(2, 0.0f, kQ3False);
+
+	for (numGroups = 1000; numGroups <= 64000; numGroups *= 4)
+		{
+		// Place the TriMesh in the groups
+		theGroups.resize(numGroups);
+		for (n = 0; n < numGroups; n++)
+			{
+			theGroups[n] = Q3DisplayGroup_New();
+			Q3Group_AddObject(theGroups[n], theMesh);
+			}
+
+
+
+		// Build the type indexes, edit the TriMesh, and dispose of the groups
+		startTime = MyTime();
+		for (n = 0; n < numGroups; n++)
+			Q3Group_GetFirstPositionOfType(theGroups[n], kQ3ShapeTypeGeometry, &thePosition);
+		buildTime = MyTime() - startTime;
+
+		startTime = MyTime();
+		Q3Shared_Edited(theMesh);
+		editTime = MyTime() - startTime;
+
+		startTime = MyTime();
+		for (n = numGroups; n > 0; n--)
+			Q3Object_Dispose(theGroups[n - 1]);
+		disposeTime = MyTime() - startTime;
+
+		printf("  %10lu %11.2f ms %11.2f ms %11.2f ms\n", (unsigned long) numGroups, buildTime, editTime, disposeTime);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theMesh);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewCityGroup : Create a display group with automatic bounds.
+//-----------------------------------------------------------------------------
+static TQ3GroupObject
+MyNewCityGroup(void)
+{	TQ3GroupObject		theGroup;
+
+
+
+	// Create the group
+	theGroup = Q3DisplayGroup_New();
+	if (theGroup != NULL)
+		Q3DisplayGroup_SetState(theGroup, kQ3DisplayGroupStateMaskIsDrawn      |
+										  kQ3DisplayGroupStateMaskIsPicked     |
+										  kQ3DisplayGroupStateMaskIsWritten    |
+										  kQ3DisplayGroupStateMaskAutoBoundingBox);
+
+	return(theGroup);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_CityBounds : Time automatic bounds on a city-sized scene.
+//-----------------------------------------------------------------------------
+//		Note :	The city is a grid of districts, each a grid of blocks, each a
+//				row of box buildings, with every district and block a display
+//				group with automatic bounds. The camera sees about a third of
+//				the city, so most districts are culled by their bounds.
+//
+//				Frames are timed when the bounds are first calculated, when
+//				nothing has changed, and when one building moves each frame.
+//				A moved building should only re-bound its own block, with the
+//				district and the city built from the boxes of their children.
+//
+//				The city's approximate bounds must contain its exact bounds.
+//-----------------------------------------------------------------------------
+static void
+MyTest_CityBounds(void)
+{	TQ3Uns32				d, b, n, numFrames, numLoops;
+	TQ3GroupObject			theCity, theDistrict, theBlock;
+	double					firstTime, stillTime, movedTime;
+	TQ3BoundingBox			approxBounds, exactBounds;
+	TQ3Point3D				theOrigin;
+	TQ3ViewStatus			viewStatus;
+	TQ3GeometryObject		theBuilding, movedBuilding;
+	TQ3BoxData				boxData;
+	TQ3ViewObject			theView;
+	void					*theImage;
+
+
+
+	// Create the view
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+
+
+	// Build the city, with 4 by 4 districts to the unit square
+	memset(&boxData, 0, sizeof(boxData));
+	Q3Vector3D_Set(&boxData.orientation, 0.0f,   0.0f,   0.1f);
+	Q3Vector3D_Set(&boxData.majorAxis,   0.015f, 0.0f,   0.0f);
+	Q3Vector3D_Set(&boxData.minorAxis,   0.0f,   0.015f, 0.0f);
+
+	theCity       = MyNewCityGroup();
+	movedBuilding = NULL;
+
+	for (d = 0; d < kCityGridSize * kCityGridSize; d++)
+		{
+		theDistrict = MyNewCityGroup();
+
+		for (b = 0; b < kCityGridSize * kCityGridSize; b++)
+			{
+			theBlock = MyNewCityGroup();
+
+			for (n = 0; n < kCityBlockSize; n++)
+				{
+				Q3Point3D_Set(&boxData.origin,
+							  ((float) (d % kCityGridSize) * kCityGridSize + (float) (b % kCityGridSize)) / 32.0f - 0.5f + 0.02f * n,
+							  ((float) (d / kCityGridSize) * kCityGridSize + (float) (b / kCityGridSize)) / 32.0f - 0.5f,
+							  -0.1f * MyRandom());
+
+				theBuilding = Q3Box_New(&boxData);
+				if (movedBuilding == NULL)
+					movedBuilding = Q3Shared_GetReference(theBuilding);
+
+				Q3Group_AddObjectAndDispose(theBlock, &theBuilding);
+				}
+
+			Q3Group_AddObjectAndDispose(theDistrict, &theBlock);
+			}
+
+		Q3Group_AddObjectAndDispose(theCity, &theDistrict);
+		}
+
+	printf("  %10s %14s %14s %14s\n", "buildings", "first", "unchanged", "one moved");
+
+
+
+	// Time the frames, moving the first building
+	numFrames = 20;
+	firstTime = MyRenderFrames(theView, theCity, 1,         &numLoops, &viewStatus);
+	stillTime = MyRenderFrames(theView, theCity, numFrames, &numLoops, &viewStatus);
+
+	movedTime = 0.0;
+	for (n = 0; n < numFrames; n++)
+		{
+		Q3Box_GetOrigin(movedBuilding, &theOrigin);
+		theOrigin.z = -0.1f * MyRandom();
+		Q3Box_SetOrigin(movedBuilding, &theOrigin);
+
+		movedTime += MyRenderFrames(theView, theCity, 1, &numLoops, &viewStatus);
+		}
+
+	printf("  %10lu %11.2f ms %11.2f ms %11.2f ms\n",
+			(unsigned long) (kCityGridSize * kCityGridSize * kCityGridSize * kCityGridSize * kCityBlockSize),
+			firstTime, stillTime / numFrames, movedTime / numFrames);
+
+	if (viewStatus != kQ3ViewStatusDone)
+		printf("  Rendering returned status %d\n", (int) viewStatus);
+
+
+
+	// Check the city's bounds
+	Q3DisplayGroup_GetBoundingBox(theCity, &approxBounds);
+	Q3View_StartBoundingBox(theView, kQ3ComputeBoundsExact);
+	do
+		{
+		Q3Object_Submit(theCity, theView);
+		}
+	while (Q3View_EndBoundingBox(theView, &exactBounds) == kQ3ViewStatusRetraverse);
+
+	if (approxBounds.isEmpty || exactBounds.isEmpty ||
+		approxBounds.min.x > exactBounds.min.x || approxBounds.max.x < exactBounds.max.x ||
+		approxBounds.min.y > exactBounds.min.y || approxBounds.max.y < exactBounds.max.y ||
+		approxBounds.min.z > exactBounds.min.z || approxBounds.max.z < exactBounds.max.z)
+		printf("  City bounds do not contain its contents\n");
+
+
+
+	// Clean up
+	Q3Object_Dispose(movedBuilding);
+	Q3Object_Dispose(theCity);
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_RaysPick : Time a world rays pick against world ray picks.
+//-----------------------------------------------------------------------------
+//		Note :	Many rays are picked against a grid of TriMeshes, as a world
+//				ray pick for each ray and as world rays picks with the rays
+//				of each TriMesh shared between 1, 2 and 4 threads. Every pick
+//				must find the same number of hits.
+//-----------------------------------------------------------------------------
+static void
+MyTest_RaysPick(void)
+{	const TQ3Uns32			threadCounts[] = { 1, 2, 4 };
+	TQ3Uns32				n, t, numHits, numRayHits;
+	TQ3WorldRaysPickData	raysData;
+	TQ3WorldRayPickData		rayData;
+	TQ3TransformObject		theTransform;
+	TQ3GroupObject			theScene, theTile;
+	TQ3GeometryObject		theMesh;
+	std::vector<TQ3Ray3D>	theRays;
+	TQ3ViewObject			theView;
+	TQ3Vector3D				theOffset;
+	double					startTime, rayTime, raysTime;
+	void					*theImage;
+
+
+
+	// Create the view and the scene
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	theMesh  = MyNewGridMesh(128, 0.0f, kQ3False);
+	theScene = Q3OrderedDisplayGroup_New();
+	for (n = 0; n < kNumRayTiles * kNumRayTiles; n++)
+		{
+		theTile = Q3OrderedDisplayGroup_New();
+		Q3Vector3D_Set(&theOffset, (float) (n % kNumRayTiles), (float) (n / kNumRayTiles), 0.0f);
+		theTransform = Q3TranslateTransform_New(&theOffset);
+		Q3Group_AddObjectAndDispose(theTile, &theTransform);
+		Q3Group_AddObject(theTile, theMesh);
+		Q3Group_AddObjectAndDispose(theScene, &theTile);
+		}
+
+	Q3Object_Dispose(theMesh);
+
+
+
+	// Create the rays
+	theRays.resize(kNumBatchRays);
+	for (n = 0; n < kNumBatchRays; n++)
+		{
+		Q3Point3D_Set(&theRays[n].origin, MyRandom() * kNumRayTiles, MyRandom() * kNumRayTiles, 1.0f);
+		Q3Vector3D_Set(&theRays[n].direction, 0.0f, 0.0f, -1.0f);
+		}
+
+	memset(&rayData,  0, sizeof(rayData));
+	memset(&raysData, 0, sizeof(raysData));
+	rayData.data.sort            = kQ3PickSortNearToFar;
+	rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+	raysData.data                = rayData.data;
+	raysData.numRays             = kNumBatchRays;
+	raysData.rays                = &theRays[0];
+
+	printf("  %10s %14s %14s %8s\n", "rays", "ray picks", "rays pick", "threads");
+
+
+
+	// Pick each ray on its own, once the first pick has built the TriMesh's tree
+	rayData.ray = theRays[0];
+	MyPickObject(theView, Q3WorldRayPick_New(&rayData), theScene);
+
+	numRayHits = 0;
+	startTime  = MyWallTime();
+	for (n = 0; n < kNumBatchRays; n++)
+		{
+		rayData.ray = theRays[n];
+		numRayHits += MyPickObject(theView, Q3WorldRayPick_New(&rayData), theScene);
+		}
+	rayTime = MyWallTime() - startTime;
+
+
+
+	// Pick every ray at once, on each number of threads
+	for (t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+		{
+		raysData.numThreads = threadCounts[t];
+		startTime = MyWallTime();
+		numHits   = MyPickObject(theView, Q3WorldRaysPick_New(&raysData), theScene);
+		raysTime  = MyWallTime() - startTime;
+
+		printf("  %10lu %11.2f ms %11.2f ms %8lu\n", (unsigned long) kNumBatchRays,
+				rayTime, raysTime, (unsigned long) threadCounts[t]);
+
+		if (numHits != numRayHits)
+			printf("  Hits differ: %lu against %lu\n", (unsigned long) numHits, (unsigned long) numRayHits);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theScene);
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewQuadric : Create a complete quadric geometry.
+//-----------------------------------------------------------------------------
+//		Note :	The shapes are the box, cone, cylinder, disk, ellipsoid and
+//				torus, in that order, each about the size of the unit cube.
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject
+MyNewQuadric(TQ3Uns32 theShape)
+{	TQ3CylinderData		cylinderData;
+	TQ3EllipsoidData	ellipsoidData;
+	TQ3TorusData		torusData;
+	TQ3ConeData			coneData;
+	TQ3DiskData			diskData;
+	TQ3BoxData			boxData;
+	TQ3Vector3D			orientation, majorRadius, minorRadius;
+	TQ3Point3D			theOrigin;
+
+
+
+	// Create the shape
+	Q3Point3D_Set(&theOrigin,       0.0f, 0.0f, -0.5f);
+	Q3Vector3D_Set(&orientation,    0.0f, 0.0f,  1.0f);
+	Q3Vector3D_Set(&majorRadius,    1.0f, 0.0f,  0.0f);
+	Q3Vector3D_Set(&minorRadius,    0.0f, 1.0f,  0.0f);
+
+	switch (theShape) {
+		case 0:
+			memset(&boxData, 0, sizeof(boxData));
+			Q3Point3D_Set(&boxData.origin, -0.5f, -0.5f, -0.5f);
+			boxData.orientation = orientation;
+			boxData.majorAxis   = majorRadius;
+			boxData.minorAxis   = minorRadius;
+			return(Q3Box_New(&boxData));
+
+		case 1:
+			memset(&coneData, 0, sizeof(coneData));
+			coneData.origin      = theOrigin;
+			coneData.orientation = orientation;
+			coneData.majorRadius = majorRadius;
+			coneData.minorRadius = minorRadius;
+			coneData.uMax        = 1.0f;
+			coneData.vMax        = 1.0f;
+			coneData.caps        = kQ3EndCapMaskBottom;
+			return(Q3Cone_New(&coneData));
+
+		case 2:
+			memset(&cylinderData, 0, sizeof(cylinderData));
+			cylinderData.origin      = theOrigin;
+			cylinderData.orientation = orientation;
+			cylinderData.majorRadius = majorRadius;
+			cylinderData.minorRadius = minorRadius;
+			cylinderData.uMax        = 1.0f;
+			cylinderData.vMax        = 1.0f;
+			cylinderData.caps        = kQ3EndCapMaskTop | kQ3EndCapMaskBottom;
+			return(Q3Cylinder_New(&cylinderData));
+
+		case 3:
+			memset(&diskData, 0, sizeof(diskData));
+			diskData.majorRadius = majorRadius;
+			diskData.minorRadius = minorRadius;
+			diskData.uMax        = 1.0f;
+			diskData.vMax        = 1.0f;
+			return(Q3Disk_New(&diskData));
+
+		case 4:
+			memset(&ellipsoidData, 0, sizeof(ellipsoidData));
+			ellipsoidData.orientation = orientation;
+			ellipsoidData.majorRadius = majorRadius;
+			ellipsoidData.minorRadius = minorRadius;
+			ellipsoidData.uMax        = 1.0f;
+			ellipsoidData.vMax        = 1.0f;
+			return(Q3Ellipsoid_New(&ellipsoidData));
+
+		case 5:
+			memset(&torusData, 0, sizeof(torusData));
+			Q3Vector3D_Scale(&orientation, 0.3f, &torusData.orientation);
+			torusData.majorRadius = majorRadius;
+			torusData.minorRadius = minorRadius;
+			torusData.ratio       = 1.0f;
+			torusData.uMax        = 1.0f;
+			torusData.vMax        = 1.0f;
+			return(Q3Torus_New(&torusData));
+		}
+
+	return(NULL);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_QuadricPick : Time analytic quadric picks.
+//-----------------------------------------------------------------------------
+//		Note :	Ray picks on complete quadrics intersect their exact surface,
+//				while picks which ask for TriMesh faces still test the
+//				triangles of the cached form. Each shape is picked both ways,
+//				under the default subdivision and under a fine one, by rays
+//				from above at random points of the unit square.
+//-----------------------------------------------------------------------------
+static void
+MyTest_QuadricPick(void)
+{	const char				*theNames[] = { "box", "cone", "cylinder", "disk", "ellipsoid", "torus" };
+	const float				theSubdivisions[] = { 0.0f, 64.0f };
+	TQ3SubdivisionStyleData	subdivisionData;
+	TQ3WorldRayPickData		rayData;
+	TQ3GroupObject			theGroup;
+	TQ3Object				theObject;
+	TQ3ViewObject			theView;
+	TQ3Uns32				s, d, m, n;
+	double					startTime, pickTime[2];
+	void					*theImage;
+
+
+
+	// Create the view
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	memset(&rayData, 0, sizeof(rayData));
+	rayData.data.sort            = kQ3PickSortNearToFar;
+	rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+	Q3Vector3D_Set(&rayData.ray.direction, 0.0f, 0.0f, -1.0f);
+
+	printf("  %10s %12s %12s %12s\n", "shape", "subdivision", "exact", "cached form");
+
+
+
+	// Time picks of each shape, under each subdivision
+	for (s = 0; s < sizeof(theNames) / sizeof(theNames[0]); s++)
+		{
+		for (d = 0; d < sizeof(theSubdivisions) / sizeof(theSubdivisions[0]); d++)
+			{
+			theGroup = Q3OrderedDisplayGroup_New();
+			if (theSubdivisions[d] != 0.0f)
+				{
+				subdivisionData.method = kQ3SubdivisionMethodConstant;
+				subdivisionData.c1     = theSubdivisions[d];
+				subdivisionData.c2     = theSubdivisions[d];
+				theObject = Q3SubdivisionStyle_New(&subdivisionData);
+				Q3Group_AddObjectAndDispose(theGroup, &theObject);
+				}
+
+			theObject = MyNewQuadric(s);
+			Q3Group_AddObjectAndDispose(theGroup, &theObject);
+
+
+
+			// Pick the exact surface, then the cached form, once the first
+			// pick has built the cached form
+			for (m = 0; m < 2; m++)
+				{
+				rayData.data.mask = kQ3PickDetailMaskDistance | kQ3PickDetailMaskNormal;
+				if (m == 1)
+					rayData.data.mask |= kQ3PickDetailMaskTriMeshFace;
+
+				Q3Point3D_Set(&rayData.ray.origin, 0.1f, 0.1f, 2.0f);
+				MyPickObject(theView, Q3WorldRayPick_New(&rayData), theGroup);
+
+				startTime = MyTime();
+				for (n = 0; n < kNumQuadricPicks; n++)
+					{
+					Q3Point3D_Set(&rayData.ray.origin, MyRandom() * 2.0f - 1.0f, MyRandom() * 2.0f - 1.0f, 2.0f);
+					MyPickObject(theView, Q3WorldRayPick_New(&rayData), theGroup);
+					}
+				pickTime[m] = MyTime() - startTime;
+				}
+
+			if (theSubdivisions[d] == 0.0f)
+				printf("  %10s %12s %9.2f ms %9.2f ms\n", theNames[s], "default",
+						pickTime[0], pickTime[1]);
+			else
+				printf("  %10s %12.0f %9.2f ms %9.2f ms\n", theNames[s], theSubdivisions[d],
+						pickTime[0], pickTime[1]);
+
+			Q3Object_Dispose(theGroup);
+			}
+		}
+
+	printf("  %lu picks of each\n", (unsigned long) kNumQuadricPicks);
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewPointGeometry : Create a large TriGrid or PolyLine.
+//-----------------------------------------------------------------------------
+//		Note :	The vertices have no attribute sets, so their points are read
+//				as a single array.
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject
+MyNewPointGeometry(TQ3ObjectType theType, TQ3Uns32 theSize)
+{	std::vector<TQ3Vertex3D>	theVertices(theSize * theSize);
+	TQ3PolyLineData				polyLineData;
+	TQ3TriGridData				triGridData;
+	TQ3Uns32					n;
+
+
+
+	// Build the vertices
+	for (n = 0; n < theVertices.size(); n++)
+		{
+		Q3Point3D_Set(&theVertices[n].point, (float) (n % theSize), (float) (n / theSize), MyRandom());
+		theVertices[n].attributeSet = NULL;
+		}
+
+
+
+	// Create the geometry
+	if (theType == kQ3GeometryTypeTriGrid)
+		{
+		memset(&triGridData, 0, sizeof(triGridData));
+		triGridData.numRows    = theSize;
+		triGridData.numColumns = theSize;
+		triGridData.vertices   = &theVertices[0];
+		return(Q3TriGrid_New(&triGridData));
+		}
+
+	memset(&polyLineData, 0, sizeof(polyLineData));
+	polyLineData.numVertices = (TQ3Uns32) theVertices.size();
+	polyLineData.vertices    = &theVertices[0];
+	return(Q3PolyLine_New(&polyLineData));
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_ReadGeometry : Time reading geometries from binary 3DMF.
+//-----------------------------------------------------------------------------
+//		Note :	Each geometry is written to memory in our own byte order and
+//				in the swapped order, and read back kNumGeometryReads times.
+//				Its point, index and attribute arrays are read in bulk, and
+//				swapped and checked for bad floats in one pass. Read rates
+//				are for the whole file.
+//-----------------------------------------------------------------------------
+static void
+MyTest_ReadGeometry(void)
+{	const char				*theNames[] = { "trimesh", "trigrid", "polyline" };
+	const char				*theOrders[] = { "native", "swapped" };
+	const TQ3FileMode		theModes[]  = { kQ3FileModeNormal, kQ3FileModeNormal | kQ3FileModeSwap };
+	TQ3Uns32				s, m, n, theSize, numRead;
+	TQ3GeometryObject		theGeometry;
+	TQ3StorageObject		theStorage;
+	double					startTime, readTime;
+	TQ3FileObject			theFile;
+	TQ3FileMode				fileMode;
+	TQ3Object				theObject;
+
+
+
+	// Time reading each geometry, in each byte order
+	printf("  %10s %10s %10s %12s %12s\n", "geometry", "order", "size", "read", "rate");
+
+	for (s = 0; s < sizeof(theNames) / sizeof(theNames[0]); s++)
+		{
+		switch (s) {
+			case 0:
+				theGeometry = MyNewPointPairs(3 * 400000);
+				break;
+
+			case 1:
+				theGeometry = MyNewPointGeometry(kQ3GeometryTypeTriGrid, 1024);
+				break;
+
+			default:
+				theGeometry = MyNewPointGeometry(kQ3GeometryTypePolyLine, 1024);
+				break;
+			}
+
+		if (theGeometry == NULL)
+			break;
+
+		for (m = 0; m < sizeof(theModes) / sizeof(theModes[0]); m++)
+			{
+			// Write the geometry
+			theStorage = Q3MemoryStorage_New(NULL, 0);
+			if (theStorage == NULL || MyWriteObject(theStorage, theGeometry, theModes[m]) != kQ3Success ||
+				Q3Storage_GetSize(theStorage, &theSize) != kQ3Success)
+				{
+				printf("  could not write %s\n", theNames[s]);
+				if (theStorage != NULL)
+					Q3Object_Dispose(theStorage);
+				continue;
+				}
+
+
+
+			// Read it back
+			numRead   = 0;
+			startTime = MyTime();
+			for (n = 0; n < kNumGeometryReads; n++)
+				{
+				theFile = Q3File_New();
+				if (theFile != NULL && Q3File_SetStorage(theFile, theStorage) == kQ3Success &&
+					Q3File_OpenRead(theFile, &fileMode) == kQ3Success)
+					{
+					while (!Q3File_IsEndOfFile(theFile))
+						{
+						theObject = Q3File_ReadObject(theFile);
+						if (theObject == NULL)
+							break;
+
+						if (Q3Object_IsType(theObject, Q3Object_GetLeafType(theGeometry)))
+							numRead++;
+
+						Q3Object_Dispose(theObject);
+						}
+
+					Q3File_Close(theFile);
+					}
+
+				if (theFile != NULL)
+					Q3Object_Dispose(theFile);
+				}
+			readTime = (MyTime() - startTime) / kNumGeometryReads;
+
+			printf("  %10s %10s %7.1f Mb %9.1f ms %7.1f Mb/s%s\n", theNames[s], theOrders[m],
+					(double) theSize / (1024.0 * 1024.0), readTime,
+					((double) theSize / (1024.0 * 1024.0)) / (readTime / 1000.0),
+					numRead == kNumGeometryReads ? "" : "   read failed");
+
+			Q3Object_Dispose(theStorage);
+			}
+
+		Q3Object_Dispose(theGeometry);
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_CacheScales : Time geometries instanced at several scales.
+//-----------------------------------------------------------------------------
+//		Note :	A torus and an ellipsoid are each submitted at several scales
+//				under a world space subdivision style, so each scale needs its
+//				own decomposition. A geometry keeps up to three decompositions
+//				besides its current one, within the cache budget. With a budget
+//				of 0 it keeps only the current one, and is decomposed again at
+//				every change of scale.
+//
+//				The renderer takes only TriMeshes, so that the shapes are
+//				decomposed.
+//-----------------------------------------------------------------------------
+static void
+MyTest_CacheScales(void)
+{	const TQ3Uns32					theCounts[] = { 1, 2, 4, 8 };
+	const TQ3Uns32					theBudgets[] = { 0, 16 * 1024 * 1024 };
+	TQ3GeometryObject				theTorus, theEllipsoid;
+	TQ3GeometryCacheStatistics		theStatistics[2];
+	TQ3SubdivisionStyleData			subdivisionData;
+	TQ3GroupObject					theScene, theGroup;
+	TQ3Object						theObject;
+	TQ3ViewStatus					viewStatus;
+	TQ3Uns32						c, b, n, numLoops, numFrames;
+	TQ3XObjectClass					rendererClass;
+	TQ3ObjectType					rendererType;
+	TQ3Vector3D						theScale;
+	double							frameTime[2];
+	TQ3ViewObject					theView;
+	void							*theImage;
+
+
+
+	// Register the renderer, and create the view and the shapes
+	rendererClass = Q3XObjectHierarchy_RegisterClass(kQ3SharedTypeRenderer, &rendererType,
+														"PerfTest:TriMeshRenderer",
+														MyShadowRenderer_MetaHandler, NULL, 0, 0);
+	theView      = MyNewView(&theImage);
+	theTorus     = MyNewQuadric(5);
+	theEllipsoid = MyNewQuadric(4);
+	if (rendererClass == NULL || theView == NULL || theTorus == NULL || theEllipsoid == NULL)
+		return;
+
+	Q3View_SetRendererByType(theView, rendererType);
+
+	subdivisionData.method = kQ3SubdivisionMethodWorldSpace;
+	subdivisionData.c1     = 0.02f;
+	subdivisionData.c2     = 0.02f;
+	numFrames              = 50;
+
+	printf("  %10s %14s %14s %10s %10s\n", "scales", "single", "alternates", "rebuilds", "hits");
+
+
+
+	// Time each number of scales, with and without alternates
+	for (c = 0; c < sizeof(theCounts) / sizeof(theCounts[0]); c++)
+		{
+		theScene  = Q3OrderedDisplayGroup_New();
+		theObject = Q3SubdivisionStyle_New(&subdivisionData);
+		Q3Group_AddObjectAndDispose(theScene, &theObject);
+
+		for (n = 0; n < theCounts[c]; n++)
+			{
+			theGroup = Q3OrderedDisplayGroup_New();
+			Q3Vector3D_Set(&theScale, 0.2f + 0.1f * n, 0.2f + 0.1f * n, 0.2f + 0.1f * n);
+			theObject = Q3ScaleTransform_New(&theScale);
+			Q3Group_AddObjectAndDispose(theGroup, &theObject);
+			Q3Group_AddObject(theGroup, theTorus);
+			Q3Group_AddObject(theGroup, theEllipsoid);
+			Q3Group_AddObjectAndDispose(theScene, &theGroup);
+			}
+
+		for (b = 0; b < 2; b++)
+			{
+			Q3Geometry_SetCacheBudget(theBudgets[b]);
+			MyRenderFrames(theView, theScene, 1, &numLoops, &viewStatus);
+
+			Q3Geometry_ResetCacheStatistics();
+			frameTime[b] = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus) / numFrames;
+			Q3Geometry_GetCacheStatistics(&theStatistics[b]);
+			}
+
+		printf("  %10lu %11.2f ms %11.2f ms %4lu / %-4lu %4lu / %-4lu\n", (unsigned long) theCounts[c],
+				frameTime[0], frameTime[1],
+				(unsigned long) theStatistics[0].numRebuilds, (unsigned long) theStatistics[1].numRebuilds,
+				(unsigned long) theStatistics[0].numHits,     (unsigned long) theStatistics[1].numHits);
+
+		Q3Object_Dispose(theScene);
+		}
+
+	printf("  %lu frames, statistics without / with alternates\n", (unsigned long) numFrames);
+
+
+
+	// Clean up
+	Q3Geometry_SetCacheBudget(theBudgets[1]);
+	Q3Object_Dispose(theTorus);
+	Q3Object_Dispose(theEllipsoid);
+	Q3Object_Dispose(theView);
+	free(theImage);
+	Q3XObjectHierarchy_UnregisterClass(rendererClass);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_ObjectPools : Time creating and disposing of many objects.
+//-----------------------------------------------------------------------------
+//		Note :	kNumPoolObjects transforms, points and attribute sets are made
+//				in batches of kNumPoolLiveObjects, and each batch is disposed
+//				of in a scattered order. Instance data up to 512 bytes comes
+//				from pools of items of each size, which are reported while
+//				the last batch is alive and again once it has gone.
+//-----------------------------------------------------------------------------
+static void
+MyTest_ObjectPools(void)
+{	const TQ3ObjectType				theTypes[] = { kQ3TransformTypeTranslate, kQ3GeometryTypePoint, kQ3SetTypeAttribute };
+	const char						*theNames[] = { "translate", "point", "attribute set" };
+	TQ3InstancePoolStatistics		theStatistics;
+	std::vector<TQ3Object>			theObjects(kNumPoolLiveObjects);
+	TQ3Uns32						b, n, t;
+	double							startTime, newTime, disposeTime;
+	TQ3PointData					pointData;
+	TQ3Vector3D						theOffset;
+
+
+
+	// Create and dispose of the objects
+	memset(&pointData, 0, sizeof(pointData));
+	Q3Vector3D_Set(&theOffset, 1.0f, 2.0f, 3.0f);
+	newTime     = 0.0;
+	disposeTime = 0.0;
+
+	printf("  %10s %12s %10s %10s %10s %10s\n", "class", "instances", "item size", "blocks", "items", "in use");
+
+	for (b = 0; b < kNumPoolObjects / kNumPoolLiveObjects; b++)
+		{
+		startTime = MyTime();
+		for (n = 0; n < kNumPoolLiveObjects; n++)
+			{
+			switch (n % 3) {
+				case 0:
+					theObjects[n] = Q3TranslateTransform_New(&theOffset);
+					break;
+
+				case 1:
+					theObjects[n] = Q3Point_New(&pointData);
+					break;
+
+				default:
+					theObjects[n] = Q3AttributeSet_New();
+					break;
+				}
+			}
+		newTime += MyTime() - startTime;
+
+
+
+		// Report the pools while the last batch is alive
+		if (b == kNumPoolObjects / kNumPoolLiveObjects - 1)
+			{
+			for (t = 0; t < sizeof(theTypes) / sizeof(theTypes[0]); t++)
+				{
+				theStatistics.structureVersion = kQ3InstancePoolStatisticsStructureVersion;
+				if (Q3Memory_GetInstancePoolStatistics(theTypes[t], &theStatistics) == kQ3Success)
+					printf("  %10s %12lu %10lu %10lu %10lu %10lu\n", theNames[t],
+							(unsigned long) theStatistics.numInstances, (unsigned long) theStatistics.itemSize,
+							(unsigned long) theStatistics.numBlocks,    (unsigned long) theStatistics.numItems,
+							(unsigned long) theStatistics.numItemsInUse);
+				}
+			}
+
+
+
+		// Dispose of the batch, in a scattered order
+		startTime = MyTime();
+		for (n = 0; n < kNumPoolLiveObjects; n++)
+			Q3Object_Dispose(theObjects[(n * 997) % kNumPoolLiveObjects]);
+		disposeTime += MyTime() - startTime;
+		}
+
+
+
+	// Report the pools once the objects have gone
+	for (t = 0; t < sizeof(theTypes) / sizeof(theTypes[0]); t++)
+		{
+		theStatistics.structureVersion = kQ3InstancePoolStatisticsStructureVersion;
+		if (Q3Memory_GetInstancePoolStatistics(theTypes[t], &theStatistics) == kQ3Success)
+			printf("  %10s %12lu %10lu %10lu %10lu %10lu\n", theNames[t],
+					(unsigned long) theStatistics.numInstances, (unsigned long) theStatistics.itemSize,
+					(unsigned long) theStatistics.numBlocks,    (unsigned long) theStatistics.numItems,
+					(unsigned long) theStatistics.numItemsInUse);
+		}
+
+	printf("  %lu objects: %.1f ms to create, %.1f ms to dispose of\n", (unsigned long) kNumPoolObjects,
+			newTime, disposeTime);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_AttributeSets : Time adding, getting and inheriting attributes.
+//-----------------------------------------------------------------------------
+//		Note :	Each of kNumAttributeSets sets is given a diffuse colour, a
+//				specular colour and a transparency, as in a typical scene.
+//				The memory per set is the pool item its instance data is
+//				allocated from.
+//-----------------------------------------------------------------------------
+static void
+MyTest_AttributeSets(void)
+{	TQ3AttributeSet					parentSet, resultSet;
+	TQ3InstancePoolStatistics		theStatistics;
+	std::vector<TQ3AttributeSet>	theSets(kNumAttributeSets);
+	double							startTime, addTime, getTime, inheritTime;
+	TQ3ColorRGB						theColour, theSpecular, theTransparency;
+	float							theCoefficient;
+	TQ3Uns32						n, r;
+
+
+
+	// Create the sets, and time adding their attributes
+	Q3ColorRGB_Set(&theSpecular,     1.0f, 1.0f, 1.0f);
+	Q3ColorRGB_Set(&theTransparency, 0.5f, 0.5f, 0.5f);
+
+	for (n = 0; n < kNumAttributeSets; n++)
+		theSets[n] = Q3AttributeSet_New();
+
+	startTime = MyTime();
+	for (n = 0; n < kNumAttributeSets; n++)
+		{
+		Q3ColorRGB_Set(&theColour, MyRandom(), MyRandom(), MyRandom());
+		Q3AttributeSet_Add(theSets[n], kQ3AttributeTypeDiffuseColor,      &theColour);
+		Q3AttributeSet_Add(theSets[n], kQ3AttributeTypeSpecularColor,     &theSpecular);
+		Q3AttributeSet_Add(theSets[n], kQ3AttributeTypeTransparencyColor, &theTransparency);
+		}
+	addTime = MyTime() - startTime;
+
+
+
+	// Time getting the attributes back
+	startTime = MyTime();
+	for (r = 0; r < kNumAttributeRuns; r++)
+		{
+		for (n = 0; n < kNumAttributeSets; n++)
+			{
+			Q3AttributeSet_Get(theSets[n], kQ3AttributeTypeDiffuseColor,      &theColour);
+			gColourSum += theColour.r;
+			Q3AttributeSet_Get(theSets[n], kQ3AttributeTypeTransparencyColor, &theColour);
+			gColourSum += theColour.g;
+			}
+		}
+	getTime = MyTime() - startTime;
+
+
+
+	// Time inheriting each set from a parent, as a group's contents would
+	parentSet = Q3AttributeSet_New();
+	resultSet = Q3AttributeSet_New();
+	theCoefficient = 0.25f;
+	Q3ColorRGB_Set(&theColour, 0.2f, 0.4f, 0.6f);
+	Q3AttributeSet_Add(parentSet, kQ3AttributeTypeAmbientCoefficient, &theCoefficient);
+	Q3AttributeSet_Add(parentSet, kQ3AttributeTypeDiffuseColor,       &theColour);
+
+	startTime = MyTime();
+	for (n = 0; n < kNumAttributeSets; n++)
+		Q3AttributeSet_Inherit(parentSet, theSets[n], resultSet);
+	inheritTime = MyTime() - startTime;
+
+	Q3AttributeSet_Get(resultSet, kQ3AttributeTypeDiffuseColor, &theColour);
+	gColourSum += theColour.b;
+
+
+
+	// Report the results
+	memset(&theStatistics, 0, sizeof(theStatistics));
+	theStatistics.structureVersion = kQ3InstancePoolStatisticsStructureVersion;
+	Q3Memory_GetInstancePoolStatistics(kQ3SetTypeAttribute, &theStatistics);
+
+	printf("  %lu sets of 3 attributes, in pool items of %lu bytes\n",
+			(unsigned long) kNumAttributeSets, (unsigned long) theStatistics.itemSize);
+	printf("  %10.1f ns per add\n",     1.0e6 * addTime     / (3.0 * kNumAttributeSets));
+	printf("  %10.1f ns per get\n",     1.0e6 * getTime     / (2.0 * kNumAttributeSets * kNumAttributeRuns));
+	printf("  %10.1f ns per inherit\n", 1.0e6 * inheritTime / kNumAttributeSets);
+
+
+
+	// Clean up
+	for (n = 0; n < kNumAttributeSets; n++)
+		Q3Object_Dispose(theSets[n]);
+
+	Q3Object_Dispose(parentSet);
+	Q3Object_Dispose(resultSet);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewTree : Create a binary tree of groups.
+//-----------------------------------------------------------------------------
+//		Note :	Each group may hold an attribute set, coloured at random or
+//				the same as every other, or a translation, and the leaves hold
+//				a point.
+//-----------------------------------------------------------------------------
+static TQ3GroupObject
+MyNewTree(TQ3Uns32 theDepth, TQ3TreeContents theContents)
+{	TQ3AttributeSet		theAttributes;
+	TQ3ColorRGB			theColour;
+	TQ3GroupObject		theGroup;
+	TQ3PointData		pointData;
+	TQ3Vector3D			theOffset;
+	TQ3Object			theObject;
+	TQ3Uns32			n;
+
+
+
+	// Add the attributes
+	theGroup = Q3OrderedDisplayGroup_New();
+
+	if (theContents == kTreeColours || theContents == kTreeSameColours)
+		{
+		if (theContents == kTreeColours)
+			Q3ColorRGB_Set(&theColour, MyRandom(), MyRandom(), MyRandom());
+		else
+			Q3ColorRGB_Set(&theColour, 0.5f, 0.5f, 0.5f);
+
+		theAttributes = Q3AttributeSet_New();
+		Q3AttributeSet_Add(theAttributes, kQ3AttributeTypeDiffuseColor,  &theColour);
+		Q3AttributeSet_Add(theAttributes, kQ3AttributeTypeSpecularColor, &theColour);
+		Q3Group_AddObjectAndDispose(theGroup, &theAttributes);
+		}
+
+	else if (theContents == kTreeTransforms)
+		{
+		Q3Vector3D_Set(&theOffset, 0.1f * MyRandom(), 0.1f * MyRandom(), 0.0f);
+		theObject = Q3TranslateTransform_New(&theOffset);
+		Q3Group_AddObjectAndDispose(theGroup, &theObject);
+		}
+
+
+
+	// Add the point, or the children
+	if (theDepth == 0)
+		{
+		Q3Point3D_Set(&pointData.point, MyRandom(), MyRandom(), 0.0f);
+		pointData.pointAttributeSet = NULL;
+
+		theObject = Q3Point_New(&pointData);
+		Q3Group_AddObjectAndDispose(theGroup, &theObject);
+		}
+	else
+		{
+		for (n = 0; n < 2; n++)
+			{
+			theObject = MyNewTree(theDepth - 1, theContents);
+			Q3Group_AddObjectAndDispose(theGroup, &theObject);
+			}
+		}
+
+	return(theGroup);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_AttributeTree : Time rendering a deep attributed tree.
+//-----------------------------------------------------------------------------
+//		Note :	A tree of kTreeDepth levels is rendered with no attributes, with
+//				a different colour in every group, and with the same colour in
+//				every group. Each attribute set is inherited from its parent's
+//				state, so the last case changes nothing after the root.
+//-----------------------------------------------------------------------------
+static void
+MyTest_AttributeTree(void)
+{	const char			*theNames[] = { "no colours", "colours", "same colours" };
+	TQ3Uns32			c, numFrames, numLoops;
+	TQ3ViewStatus		viewStatus;
+	TQ3ViewObject		theView;
+	TQ3GroupObject		theScene;
+	double				frameTime;
+	void				*theImage;
+
+
+
+	// Create the view
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	printf("  %14s %10s %14s\n", "contents", "groups", "frame");
+
+
+
+	// Render each tree
+	numFrames = 10;
+
+	for (c = kTreeGroups; c <= kTreeSameColours; c++)
+		{
+		theScene = MyNewTree(kTreeDepth, (TQ3TreeContents) c);
+		MyRenderFrames(theView, theScene, 1, &numLoops, &viewStatus);
+
+		frameTime = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus) / numFrames;
+		if (viewStatus != kQ3ViewStatusDone)
+			printf("  Rendering returned status %d\n", (int) viewStatus);
+
+		printf("  %14s %10lu %11.2f ms\n", theNames[c], (unsigned long) ((2 << kTreeDepth) - 1), frameTime);
+		Q3Object_Dispose(theScene);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_ViewStack : Time pushing and popping the view state.
+//-----------------------------------------------------------------------------
+//		Note :	Every group pushes the view state before its contents and
+//				pops it after them. Trees of several depths are rendered with
+//				nothing in their groups, so only the push and pop are paid
+//				for, and with a translation in every group, which changes the
+//				local to world matrix between them.
+//-----------------------------------------------------------------------------
+static void
+MyTest_ViewStack(void)
+{	const TQ3Uns32		theDepths[] = { 8, 12, 16 };
+	TQ3Uns32			d, numFrames, numGroups, numLoops;
+	double				groupTime, transformTime;
+	TQ3ViewStatus		viewStatus;
+	TQ3ViewObject		theView;
+	TQ3GroupObject		theScene;
+	void				*theImage;
+
+
+
+	// Create the view
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	printf("  %6s %10s %14s %14s\n", "depth", "groups", "empty", "translated");
+
+
+
+	// Render each tree, in ns per group
+	for (d = 0; d < sizeof(theDepths) / sizeof(theDepths[0]); d++)
+		{
+		numGroups = (2 << theDepths[d]) - 1;
+		numFrames = (10 << kTreeDepth) / (1 << theDepths[d]);
+
+		theScene  = MyNewTree(theDepths[d], kTreeGroups);
+		MyRenderFrames(theView, theScene, 1, &numLoops, &viewStatus);
+		groupTime = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus);
+		Q3Object_Dispose(theScene);
+
+		theScene      = MyNewTree(theDepths[d], kTreeTransforms);
+		MyRenderFrames(theView, theScene, 1, &numLoops, &viewStatus);
+		transformTime = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus);
+		Q3Object_Dispose(theScene);
+
+		printf("  %6lu %10lu %11.1f ns %11.1f ns\n", (unsigned long) theDepths[d], (unsigned long) numGroups,
+				1.0e6 * groupTime     / ((double) numFrames * numGroups),
+				1.0e6 * transformTime / ((double) numFrames * numGroups));
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_GroupTypes : Time type queries on a large group.
+//-----------------------------------------------------------------------------
+//		Note :	A group of kNumGroupMembers objects holds a light in every
+//				thousand and a transform in every ten, with points for the
+//				rest. For each type, the first count is timed on its own as
+//				it may index the group, then repeated counts and a walk
+//				through the positions of that type.
+//-----------------------------------------------------------------------------
+static void
+MyTest_GroupTypes(void)
+{	const TQ3ObjectType		theTypes[] = { kQ3ShapeTypeLight, kQ3ShapeTypeTransform, kQ3ShapeTypeGeometry };
+	const char				*theNames[] = { "lights", "transforms", "geometries" };
+	TQ3Uns32				n, t, r, numRuns, numFound, numVisited;
+	double					startTime, firstTime, countTime, visitTime;
+	TQ3GroupPosition		thePosition;
+	TQ3GroupObject			theGroup;
+	TQ3Object				theObject;
+	TQ3LightData			lightData;
+	TQ3PointData			pointData;
+	TQ3Vector3D				theOffset;
+
+
+
+	// Create the group
+	lightData.isOn       = kQ3True;
+	lightData.brightness = 1.0f;
+	Q3ColorRGB_Set(&lightData.color, 1.0f, 1.0f, 1.0f);
+
+	pointData.pointAttributeSet = NULL;
+	theGroup = Q3Group_New();
+
+	for (n = 0; n < kNumGroupMembers; n++)
+		{
+		if ((n % 1000) == 0)
+			theObject = Q3AmbientLight_New(&lightData);
+
+		else if ((n % 10) == 0)
+			{
+			Q3Vector3D_Set(&theOffset, MyRandom(), MyRandom(), MyRandom());
+			theObject = Q3TranslateTransform_New(&theOffset);
+			}
+		else
+			{
+			Q3Point3D_Set(&pointData.point, MyRandom(), MyRandom(), MyRandom());
+			theObject = Q3Point_New(&pointData);
+			}
+
+		Q3Group_AddObjectAndDispose(theGroup, &theObject);
+		}
+
+	printf("  %lu objects in one group\n", (unsigned long) kNumGroupMembers);
+	printf("  %10s %10s %14s %14s %14s\n", "type", "objects", "first count", "count", "visit");
+
+
+
+	// Time each type
+	for (t = 0; t < sizeof(theTypes) / sizeof(theTypes[0]); t++)
+		{
+		// Time the first count, then repeated counts
+		startTime = MyTime();
+		Q3Group_CountObjectsOfType(theGroup, theTypes[t], &numFound);
+		firstTime = MyTime() - startTime;
+
+		startTime = MyTime();
+		for (r = 0; r < kNumTypeQueries; r++)
+			Q3Group_CountObjectsOfType(theGroup, theTypes[t], &numFound);
+		countTime = MyTime() - startTime;
+
+
+
+		// Time walking through the positions of the type
+		numRuns    = (numFound >= kNumTypeVisits) ? 1 : (kNumTypeVisits / numFound);
+		numVisited = 0;
+		startTime  = MyTime();
+
+		for (r = 0; r < numRuns; r++)
+			{
+			Q3Group_GetFirstPositionOfType(theGroup, theTypes[t], &thePosition);
+			while (thePosition != NULL)
+				{
+				numVisited++;
+				Q3Group_GetNextPositionOfType(theGroup, theTypes[t], &thePosition);
+				}
+			}
+
+		visitTime = MyTime() - startTime;
+
+		printf("  %10s %10lu %11.3f ms %11.2f us %11.1f ns\n", theNames[t], (unsigned long) numFound,
+				firstTime, 1.0e3 * countTime / kNumTypeQueries, 1.0e6 * visitTime / numVisited);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theGroup);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewPickScene : Create a scene of many small triangles.
+//-----------------------------------------------------------------------------
+//		Note :	The unit square is split into kNumSceneTiles by kNumSceneTiles
+//				tiles, each a display group of triangles scattered over the
+//				tile at random depths.
+//-----------------------------------------------------------------------------
+static TQ3GroupObject
+MyNewPickScene(void)
+{	TQ3Uns32				x, y, n, v, numPerTile;
+	TQ3GroupObject			theScene, theTile;
+	TQ3GeometryObject		theTriangle;
+	TQ3TriangleData			triangleData;
+	TQ3Point3D				theCentre;
+	float					tileSize;
+
+
+
+	// Create the scene
+	theScene   = Q3DisplayGroup_New();
+	numPerTile = kNumSceneObjects / (kNumSceneTiles * kNumSceneTiles);
+	tileSize   = 1.0f / kNumSceneTiles;
+	memset(&triangleData, 0, sizeof(triangleData));
+
+	for (y = 0; y < kNumSceneTiles; y++)
+		{
+		for (x = 0; x < kNumSceneTiles; x++)
+			{
+			theTile = Q3DisplayGroup_New();
+
+			for (n = 0; n < numPerTile; n++)
+				{
+				Q3Point3D_Set(&theCentre, tileSize * (x + MyRandom()), tileSize * (y + MyRandom()), -0.5f * MyRandom());
+
+				for (v = 0; v < 3; v++)
+					Q3Point3D_Set(&triangleData.vertices[v].point, theCentre.x, theCentre.y, theCentre.z);
+
+				triangleData.vertices[1].point.x += 0.005f;
+				triangleData.vertices[2].point.y += 0.005f;
+
+				theTriangle = Q3Triangle_New(&triangleData);
+				Q3Group_AddObjectAndDispose(theTile, &theTriangle);
+				}
+
+			Q3Group_AddObjectAndDispose(theScene, &theTile);
+			}
+		}
+
+	return(theScene);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_ScenePick : Time picks on a scene of many objects.
+//-----------------------------------------------------------------------------
+//		Note :	The first pick may prepare the scene for picking, so is timed
+//				on its own. Each kind of pick is then made at random points,
+//				returning all hits.
+//-----------------------------------------------------------------------------
+static void
+MyTest_ScenePick(void)
+{	TQ3WindowPointPickData	pointData;
+	TQ3WindowRectPickData	rectData;
+	TQ3WorldRayPickData		rayData;
+	TQ3GroupObject			theScene;
+	TQ3ViewObject			theView;
+	TQ3Uns32				n, numPointHits, numRectHits, numRayHits;
+	double					startTime, firstTime, pointTime, rectTime, rayTime;
+	void					*theImage;
+
+
+
+	// Create the view and the scene
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	theScene = MyNewPickScene();
+
+	memset(&rayData,   0, sizeof(rayData));
+	memset(&pointData, 0, sizeof(pointData));
+	memset(&rectData,  0, sizeof(rectData));
+	rayData.data.sort            = kQ3PickSortNearToFar;
+	pointData.data.sort          = kQ3PickSortNearToFar;
+	rectData.data.sort           = kQ3PickSortNone;
+	rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+	Q3Vector3D_Set(&rayData.ray.direction, 0.0f, 0.0f, -1.0f);
+
+
+
+	// Time the first pick
+	Q3Point2D_Set(&pointData.point, 0.5f * kImageSize, 0.5f * kImageSize);
+	startTime = MyTime();
+	MyPickObject(theView, Q3WindowPointPick_New(&pointData), theScene);
+	firstTime = MyTime() - startTime;
+
+
+
+	// Time each kind of pick at random points
+	numPointHits = 0;
+	startTime    = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		Q3Point2D_Set(&pointData.point, MyRandom() * kImageSize, MyRandom() * kImageSize);
+		numPointHits += MyPickObject(theView, Q3WindowPointPick_New(&pointData), theScene);
+		}
+	pointTime = MyTime() - startTime;
+
+	numRectHits = 0;
+	startTime   = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		rectData.rect.min.x = MyRandom() * (kImageSize - 4);
+		rectData.rect.min.y = MyRandom() * (kImageSize - 4);
+		rectData.rect.max.x = rectData.rect.min.x + 4.0f;
+		rectData.rect.max.y = rectData.rect.min.y + 4.0f;
+		numRectHits += MyPickObject(theView, Q3WindowRectPick_New(&rectData), theScene);
+		}
+	rectTime = MyTime() - startTime;
+
+	numRayHits = 0;
+	startTime  = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		Q3Point3D_Set(&rayData.ray.origin, MyRandom(), MyRandom(), 1.0f);
+		numRayHits += MyPickObject(theView, Q3WorldRayPick_New(&rayData), theScene);
+		}
+	rayTime = MyTime() - startTime;
+
+
+
+	// Report the results
+	printf("  %lu triangles in %lu groups\n", (unsigned long) kNumSceneObjects,
+			(unsigned long) (kNumSceneTiles * kNumSceneTiles));
+	printf("  %10s %14s %14s %14s\n", "first pick", "point", "rect", "ray");
+	printf("  %7.2f ms %11.3f ms %11.3f ms %11.3f ms\n", firstTime,
+			pointTime / kNumPicks, rectTime / kNumPicks, rayTime / kNumPicks);
+	printf("  %10s %14.2f %14.2f %14.2f hits per pick\n", "",
+			(double) numPointHits / kNumPicks, (double) numRectHits / kNumPicks, (double) numRayHits / kNumPicks);
+
+
+
+	// Clean up
+	Q3Object_Dispose(theScene);
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_NearestPick : Time picks for the nearest hit.
+//-----------------------------------------------------------------------------
+//		Note :	kNumPickLayers TriMeshes cover the unit square one above the
+//				other, each in a display group with its own translation, so
+//				every pick passes through all of them. Picks which return all
+//				hits are compared with picks for only the nearest hit.
+//-----------------------------------------------------------------------------
+static void
+MyTest_NearestPick(void)
+{	TQ3WindowPointPickData	pointData;
+	TQ3WorldRayPickData		rayData;
+	TQ3TransformObject		theTransform;
+	TQ3GroupObject			theScene, theLayer;
+	TQ3GeometryObject		theMesh;
+	TQ3ViewObject			theView;
+	TQ3Vector3D				theOffset;
+	TQ3Uns32				l, n, numAllHits, numNearestHits;
+	double					startTime, allRayTime, nearestRayTime, allPointTime, nearestPointTime;
+	void					*theImage;
+
+
+
+	// Create the view and the scene
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		return;
+
+	theScene = Q3DisplayGroup_New();
+	for (l = 0; l < kNumPickLayers; l++)
+		{
+		theLayer = Q3DisplayGroup_New();
+
+		Q3Vector3D_Set(&theOffset, 0.0f, 0.0f, -0.05f * l);
+		theTransform = Q3TranslateTransform_New(&theOffset);
+		Q3Group_AddObjectAndDispose(theLayer, &theTransform);
+
+		theMesh = MyNewGridMesh(64, 0.01f, kQ3False);
+		Q3Group_AddObjectAndDispose(theLayer, &theMesh);
+		Q3Group_AddObjectAndDispose(theScene, &theLayer);
+		}
+
+	memset(&rayData,   0, sizeof(rayData));
+	memset(&pointData, 0, sizeof(pointData));
+	rayData.data.sort   = kQ3PickSortNearToFar;
+	pointData.data.sort = kQ3PickSortNearToFar;
+	Q3Vector3D_Set(&rayData.ray.direction, 0.0f, 0.0f, -1.0f);
+
+
+
+	// Build the trees, then time ray picks for all hits and the nearest
+	Q3Point3D_Set(&rayData.ray.origin, 0.5f, 0.5f, 1.0f);
+	MyPickObject(theView, Q3WorldRayPick_New(&rayData), theScene);
+
+	numAllHits = 0;
+	rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+	startTime = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		Q3Point3D_Set(&rayData.ray.origin, MyRandom(), MyRandom(), 1.0f);
+		numAllHits += MyPickObject(theView, Q3WorldRayPick_New(&rayData), theScene);
+		}
+	allRayTime = MyTime() - startTime;
+
+	numNearestHits = 0;
+	rayData.data.numHitsToReturn = 1;
+	startTime = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		Q3Point3D_Set(&rayData.ray.origin, MyRandom(), MyRandom(), 1.0f);
+		numNearestHits += MyPickObject(theView, Q3WorldRayPick_New(&rayData), theScene);
+		}
+	nearestRayTime = MyTime() - startTime;
+
+
+
+	// Time window point picks for all hits and the nearest
+	pointData.data.numHitsToReturn = kQ3ReturnAllHits;
+	startTime = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		Q3Point2D_Set(&pointData.point, (0.25f + 0.5f * MyRandom()) * kImageSize, (0.25f + 0.5f * MyRandom()) * kImageSize);
+		numAllHits += MyPickObject(theView, Q3WindowPointPick_New(&pointData), theScene);
+		}
+	allPointTime = MyTime() - startTime;
+
+	pointData.data.numHitsToReturn = 1;
+	startTime = MyTime();
+	for (n = 0; n < kNumPicks; n++)
+		{
+		Q3Point2D_Set(&pointData.point, (0.25f + 0.5f * MyRandom()) * kImageSize, (0.25f + 0.5f * MyRandom()) * kImageSize);
+		numNearestHits += MyPickObject(theView, Q3WindowPointPick_New(&pointData), theScene);
+		}
+	nearestPointTime = MyTime() - startTime;
+
+
+
+	// Report the results
+	printf("  %lu layers of %lu triangles\n", (unsigned long) kNumPickLayers, (unsigned long) (64 * 64 * 2));
+	printf("  %10s %14s %14s\n", "", "all hits", "nearest");
+	printf("  %10s %11.3f ms %11.3f ms\n", "ray",   allRayTime   / kNumPicks, nearestRayTime   / kNumPicks);
+	printf("  %10s %11.3f ms %11.3f ms\n", "point", allPointTime / kNumPicks, nearestPointTime / kNumPicks);
+	printf("  %10s %14.2f %14.2f hits per pick\n", "",
+			(double) numAllHits / (2 * kNumPicks), (double) numNearestHits / (2 * kNumPicks));
+
+
+
+	// Clean up
+	Q3Object_Dispose(theScene);
+	Q3Object_Dispose(theView);
+	free(theImage);
+}
+
+
+
+
+
+//=============================================================================
+//      MyRunKernel : Run a batch math kernel over kNumKernelElements.
+//-----------------------------------------------------------------------------
+//		Note :	The element form calls the function for a single element in a
+//				loop, for comparison with the kernel on packed and strided
+//				arrays. Triangle normals are found from indices, so have no
+//				strided form.
+//-----------------------------------------------------------------------------
+static void
+MyRunKernel(TQ3MathKernel theKernel, TQ3KernelForm theForm, TQ3KernelData *theData)
+{	const TQ3Matrix4x4		*theMatrix;
+	TQ3Uns32				n, *theIndices;
+
+
+
+	// Run the kernel
+	switch (theKernel)
+		{
+		case kKernelAffinePoints:
+		case kKernelProjectivePoints:
+			theMatrix = (theKernel == kKernelAffinePoints) ? &theData->affineMatrix : &theData->projectiveMatrix;
+
+			if (theForm == kFormElements)
+				{
+				for (n = 0; n < kNumKernelElements; n++)
+					Q3Point3D_Transform(&theData->inPoints[n], theMatrix, &theData->outPoints[n]);
+				}
+
+			else if (theForm == kFormPacked)
+				Q3Point3D_To3DTransformArray(&theData->inPoints[0], theMatrix, &theData->outPoints[0],
+											 kNumKernelElements, sizeof(TQ3Point3D), sizeof(TQ3Point3D));
+			else
+				Q3Point3D_To3DTransformArray(&theData->inVertices[0].thePoint, theMatrix, &theData->outVertices[0].thePoint,
+											 kNumKernelElements, sizeof(TQ3KernelVertex), sizeof(TQ3KernelVertex));
+			break;
+
+		case kKernelVectors:
+			if (theForm == kFormElements)
+				{
+				for (n = 0; n < kNumKernelElements; n++)
+					Q3Vector3D_Transform(&theData->inVectors[n], &theData->affineMatrix, &theData->outVectors[n]);
+				}
+
+			else if (theForm == kFormPacked)
+				Q3Vector3D_To3DTransformArray(&theData->inVectors[0], &theData->affineMatrix, &theData->outVectors[0],
+											  kNumKernelElements, sizeof(TQ3Vector3D), sizeof(TQ3Vector3D));
+			else
+				Q3Vector3D_To3DTransformArray(&theData->inVertices[0].theVector, &theData->affineMatrix, &theData->outVertices[0].theVector,
+											  kNumKernelElements, sizeof(TQ3KernelVertex), sizeof(TQ3KernelVertex));
+			break;
+
+		case kKernelDots:
+			if (theForm == kFormElements)
+				{
+				for (n = 0; n < kNumKernelElements; n++)
+					{
+					theData->theDots[n]     = Q3Vector3D_Dot(&theData->inVectors[n], &theData->outVectors[n]);
+					theData->areNegative[n] = (TQ3Boolean) (theData->theDots[n] < 0.0f);
+					}
+				}
+
+			else if (theForm == kFormPacked)
+				Q3Vector3D_DotArray(&theData->inVectors[0], &theData->outVectors[0], &theData->theDots[0], &theData->areNegative[0],
+									kNumKernelElements, sizeof(TQ3Vector3D), sizeof(float), sizeof(TQ3Boolean));
+			else
+				Q3Vector3D_DotArray(&theData->inVertices[0].theVector, &theData->outVertices[0].theVector,
+									&theData->outVertices[0].theDot, &theData->outVertices[0].isNegative,
+									kNumKernelElements, sizeof(TQ3KernelVertex), sizeof(TQ3KernelVertex), sizeof(TQ3KernelVertex));
+			break;
+
+		case kKernelNormals:
+			if (theForm == kFormElements)
+				{
+				for (n = 0; n < kNumKernelElements; n++)
+					{
+					theIndices = &theData->theIndices[n * 3];
+					Q3Point3D_CrossProductTri(&theData->inPoints[theIndices[0]], &theData->inPoints[theIndices[1]],
+											  &theData->inPoints[theIndices[2]], &theData->outVectors[n]);
+					Q3Vector3D_Normalize(&theData->outVectors[n], &theData->outVectors[n]);
+					}
+				}
+
+			else if (theForm == kFormPacked)
+				Q3Triangle_CrossProductArray(kNumKernelElements, NULL, &theData->theIndices[0],
+											 &theData->inPoints[0], &theData->outVectors[0]);
+			break;
+
+		default:
+			break;
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_MathKernels : Time the batch math kernels.
+//-----------------------------------------------------------------------------
+//		Note :	Each kernel is run kNumKernelRuns times over kNumKernelElements
+//				random points, vectors or triangles, which stay in the cache.
+//				The projective matrix has a perspective divide.
+//-----------------------------------------------------------------------------
+static void
+MyTest_MathKernels(void)
+{	const char			*kernelNames[kKernelCount] = { "affine points", "projective points", "vectors", "dot products", "triangle normals" };
+	TQ3Uns32			k, f, n, r;
+	double				startTime, formTimes[kFormCount];
+	TQ3KernelData		theData;
+
+
+
+	// Create the arrays
+	theData.inPoints.resize(kNumKernelElements);
+	theData.outPoints.resize(kNumKernelElements);
+	theData.inVectors.resize(kNumKernelElements);
+	theData.outVectors.resize(kNumKernelElements);
+	theData.theDots.resize(kNumKernelElements);
+	theData.areNegative.resize(kNumKernelElements);
+	theData.theIndices.resize(kNumKernelElements * 3);
+	theData.inVertices.resize(kNumKernelElements);
+	theData.outVertices.resize(kNumKernelElements);
+
+	for (n = 0; n < kNumKernelElements; n++)
+		{
+		Q3Point3D_Set(&theData.inPoints[n],   MyRandom(), MyRandom(), MyRandom());
+		Q3Vector3D_Set(&theData.inVectors[n], MyRandom() - 0.5f, MyRandom() - 0.5f, MyRandom() - 0.5f);
+		theData.outVectors[n] = theData.inVectors[n];
+
+		theData.inVertices[n].thePoint  = theData.inPoints[n];
+		theData.inVertices[n].theVector = theData.inVectors[n];
+		theData.outVertices[n]          = theData.inVertices[n];
+		}
+
+	for (n = 0; n < kNumKernelElements * 3; n++)
+		theData.theIndices[n] = (TQ3Uns32) (MyRandom() * (kNumKernelElements - 1));
+
+	Q3Matrix4x4_SetRotate_XYZ(&theData.affineMatrix, 0.3f, 0.5f, 0.7f);
+	theData.affineMatrix.value[3][0] = 1.0f;
+	theData.affineMatrix.value[3][1] = 2.0f;
+	theData.affineMatrix.value[3][2] = 3.0f;
+
+	theData.projectiveMatrix = theData.affineMatrix;
+	theData.projectiveMatrix.value[2][3] = 0.5f;
+	theData.projectiveMatrix.value[3][3] = 2.0f;
+
+	printf("  %18s %14s %14s %14s\n", "", "element loop", "packed", "strided");
+
+
+
+	// Time each kernel in each form, in ns per element
+	for (k = 0; k < kKernelCount; k++)
+		{
+		for (f = 0; f < kFormCount; f++)
+			{
+			startTime = MyTime();
+			for (r = 0; r < kNumKernelRuns; r++)
+				MyRunKernel((TQ3MathKernel) k, (TQ3KernelForm) f, &theData);
+
+			formTimes[f] = 1.0e6 * (MyTime() - startTime) / ((double) kNumKernelRuns * kNumKernelElements);
+			}
+
+		if (k == kKernelNormals)
+			printf("  %18s %11.2f ns %11.2f ns %14s\n", kernelNames[k], formTimes[kFormElements], formTimes[kFormPacked], "-");
+		else
+			printf("  %18s %11.2f ns %11.2f ns %11.2f ns\n", kernelNames[k],
+					formTimes[kFormElements], formTimes[kFormPacked], formTimes[kFormStrided]);
+		}
+
+	gColourSum += theData.outPoints[0].x + theData.outVectors[0].x + theData.theDots[0] + theData.outVertices[0].theDot;
+}
+
+
+
+
+
+//=============================================================================
+//      MyMatrixRenderer_UpdateMatrix : Matrix renderer update method.
+//-----------------------------------------------------------------------------
+//		Note :	Registered for each matrix the view derives from the local to
+//				world matrix, so that the view has to compute them all.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MyMatrixRenderer_UpdateMatrix(TQ3ViewObject theView, void *instanceData, const TQ3Matrix4x4 *theMatrix)
+{
+#pragma unused(theView)
+#pragma unused(instanceData)
+
+
+
+	// Count the matrix
+	gColourSum += theMatrix->value[3][0];
+	gNumMatrices++;
+
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      MyMatrixRenderer_MetaHandler : Matrix renderer metahandler.
+//-----------------------------------------------------------------------------
+static TQ3XFunctionPointer
+MyMatrixRenderer_MetaHandler(TQ3XMethodType methodType)
+{	TQ3XFunctionPointer		theMethod = NULL;
+
+
+
+	// Return our methods
+	switch (methodType) {
+		case kQ3XMethodTypeRendererUpdateMatrixLocalToWorld:
+		case kQ3XMethodTypeRendererUpdateMatrixLocalToWorldInverse:
+		case kQ3XMethodTypeRendererUpdateMatrixLocalToCamera:
+		case kQ3XMethodTypeRendererUpdateMatrixLocalToFrustum:
+			theMethod = (TQ3XFunctionPointer) MyMatrixRenderer_UpdateMatrix;
+			break;
+		}
+	
+	return(theMethod);
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewTransformScene : Create a group of transformed groups.
+//-----------------------------------------------------------------------------
+//		Note :	Each of the kNumViewTransforms groups holds one transform, or
+//				nothing. The mixed scene cycles through the other transforms.
+//-----------------------------------------------------------------------------
+static TQ3GroupObject
+MyNewTransformScene(TQ3TransformContents theContents)
+{	TQ3TransformContents	theTransform;
+	TQ3RotateTransformData	rotateData;
+	TQ3GroupObject			theScene, theGroup;
+	TQ3Matrix4x4			theMatrix;
+	TQ3Vector3D				theVector;
+	TQ3Object				theObject;
+	TQ3Uns32				n;
+
+
+
+	// Build the scene
+	theScene = Q3OrderedDisplayGroup_New();
+
+	for (n = 0; n < kNumViewTransforms; n++)
+		{
+		theGroup     = Q3OrderedDisplayGroup_New();
+		theObject    = NULL;
+		theTransform = theContents;
+		if (theContents == kTransformMixed)
+			theTransform = (TQ3TransformContents) (kTransformTranslate + (n % (kTransformMixed - kTransformTranslate)));
+
+		switch (theTransform) {
+			case kTransformTranslate:
+				Q3Vector3D_Set(&theVector, MyRandom(), MyRandom(), -MyRandom());
+				theObject = Q3TranslateTransform_New(&theVector);
+				break;
+
+			case kTransformRotate:
+				rotateData.axis    = kQ3AxisZ;
+				rotateData.radians = MyRandom();
+				theObject = Q3RotateTransform_New(&rotateData);
+				break;
+
+			case kTransformScale:
+				theVector.x = theVector.y = theVector.z = 0.5f + MyRandom();
+				theObject = Q3ScaleTransform_New(&theVector);
+				break;
+
+			case kTransformMatrix:
+				Q3Matrix4x4_SetRotate_XYZ(&theMatrix, MyRandom(), MyRandom(), MyRandom());
+				theMatrix.value[3][0] = MyRandom();
+				theMatrix.value[3][1] = MyRandom();
+				theObject = Q3MatrixTransform_New(&theMatrix);
+				break;
+
+			default:
+				break;
+			}
+
+		if (theObject != NULL)
+			Q3Group_AddObjectAndDispose(theGroup, &theObject);
+
+		Q3Group_AddObjectAndDispose(theScene, &theGroup);
+		}
+
+	return(theScene);
+}
+
+
+
+
+
+//=============================================================================
+//      MyTest_ViewTransforms : Time the view matrices of many transforms.
+//-----------------------------------------------------------------------------
+//		Note :	A renderer which wants the local to world matrix, its inverse,
+//				and the local to camera and local to frustum matrices renders
+//				a scene of kNumViewTransforms transforms of each kind. Every
+//				transform is in its own group, so the matrix cost per frame is
+//				the frame time less that of the same groups with no transforms.
+//-----------------------------------------------------------------------------
+static void
+MyTest_ViewTransforms(void)
+{	const char				*theNames[kTransformCount] = { "none", "translate", "rotate", "scale", "matrix", "mixed" };
+	TQ3Uns32				c, numFrames, numLoops;
+	double					frameTime, groupTime;
+	TQ3XObjectClass			rendererClass;
+	TQ3ObjectType			rendererType;
+	TQ3ViewStatus			viewStatus;
+	TQ3ViewObject			theView;
+	TQ3GroupObject			theScene;
+	void					*theImage;
+
+
+
+	// Register the renderer and create the view
+	rendererClass = Q3XObjectHierarchy_RegisterClass(kQ3SharedTypeRenderer, &rendererType,
+														"PerfTest:MatrixRenderer",
+														MyMatrixRenderer_MetaHandler, NULL, 0, 0);
+	theView = MyNewView(&theImage);
+	if (rendererClass == NULL || theView == NULL)
+		return;
+
+	Q3View_SetRendererByType(theView, rendererType);
+
+	printf("  %10s %14s %14s %12s\n", "transforms", "frame", "matrices", "updates");
+
+
+
+	// Render each scene
+	numFrames = 10;
+	groupTime = 0.0;
+
+	for (c = kTransformNone; c < kTransformCount; c++)
+		{
+		theScene = MyNewTransformScene((TQ3TransformContents) c);
+		MyRenderFrames(theView, theScene, 1, &numLoops, &viewStatus);
+
+		gNumMatrices = 0;
+		frameTime    = MyRenderFrames(theView, theScene, numFrames, &numLoops, &viewStatus) / numFrames;
+		if (viewStatus != kQ3ViewStatusDone)
+			printf("  Rendering returned status %d\n", (int) viewStatus);
+
+		if (c == kTransformNone)
+			groupTime = frameTime;
+
+		printf("  %10s %11.2f ms %11.2f ms %12lu\n", theNames[c], frameTime, frameTime - groupTime,
+				(unsigned long) (gNumMatrices / numFrames));
+		Q3Object_Dispose(theScene);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+	Q3XObjectHierarchy_UnregisterClass(rendererClass);
+}
+
+
+
+
+
+//=============================================================================
+//      Static variables
+//-----------------------------------------------------------------------------
+static const TQ3PerfTest gTests[] = {
+	{ "trimesh-pick",	"TriMesh picks through the triangle tree",		MyTest_TriMeshPick },
+	{ "trimesh-submit",	"TriMeshes decomposed into triangles",			MyTest_TriMeshSubmit },
+	{ "hash-lookup",	"Class and property lookups by type",			MyTest_HashLookup },
+	{ "merge-points",	"Merging near TriMesh points through a grid",	MyTest_MergePoints },
+	{ "large-file",		"Reading 3DMF files, including past 4Gb",		MyTest_LargeFile },
+	{ "pass-replay",	"Multi-pass rendering with 8 shadow lights",	MyTest_PassReplay },
+	{ "group-parents",	"An object held by many groups",				MyTest_GroupParents },
+	{ "city-bounds",	"Automatic bounds on a city of 32768 boxes",	MyTest_CityBounds },
+	{ "rays-pick",		"Many rays in one pick, on several threads",	MyTest_RaysPick },
+	{ "quadric-pick",	"Quadrics picked exactly and through TriMeshes",	MyTest_QuadricPick },
+	{ "3dmf-read",		"Reading large geometries from binary 3DMF",	MyTest_ReadGeometry },
+	{ "cache-scales",	"Geometries decomposed at several scales",		MyTest_CacheScales },
+	{ "object-pools",	"Creating and disposing of 10M objects",		MyTest_ObjectPools },
+	{ "attribute-sets",	"Adding, getting and inheriting attributes",	MyTest_AttributeSets },
+	{ "attribute-tree",	"Rendering a deep tree of attributed groups",	MyTest_AttributeTree },
+	{ "view-stack",		"Pushing and popping the view state in deep trees",	MyTest_ViewStack },
+	{ "group-types",	"Type queries on a group of 100K objects",		MyTest_GroupTypes },
+	{ "scene-pick",		"Picking a scene of 100K triangles",			MyTest_ScenePick },
+	{ "nearest-pick",	"Picking the nearest of 16 layers of TriMeshes",	MyTest_NearestPick },
+	{ "math-kernels",	"Batch transforms, dot products and normals",	MyTest_MathKernels },
+	{ "view-transforms",	"View matrices for 500K transforms",		MyTest_ViewTransforms }
+};
+
+
+
+
+
+//=============================================================================
+//      main : Program entry point.
+//-----------------------------------------------------------------------------
+int main(int argc, char * argv[])
+{	TQ3Uns32		n;
+	int				a, runTest;
+
+
+
+	// Initialise Quesa
+	if (Q3Initialize() != kQ3Success)
+		{
+		printf("Q3Initialize failed\n");
+		return(EXIT_FAILURE);
+		}
+
+
+
+	// Run the tests which were named, or every test if none were
+	for (n = 0; n < sizeof(gTests) / sizeof(gTests[0]); n++)
+		{
+		runTest = (argc < 2);
+		for (a = 1; a < argc; a++)
+			runTest = runTest || (strcmp(argv[a], gTests[n].theName) == 0);
+
+		if (runTest)
+			{
+			printf("%s: %s\n", gTests[n].theName, gTests[n].theDescription);
+			gTests[n].theProc();
+			printf("\n");
+			}
+		}
+
+
+
+	// Clean up
+	Q3Exit();
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,648 @@
+/*  NAME:
+        Thread Test.c
+        
+    DESCRIPTION:
+        Renders and picks one shared scene from several threads at once.
+
+        Each thread owns its view, camera, draw context and picks, while the
+        scene itself is shared. The first pass over the scene from several
+        threads at once builds the caches which Quesa keeps with groups and
+        geometries, so the scene is edited between rounds to have them
+        rebuilt. Every thread should see the same pick results as a single
+        thread does.
+
+        The example is a console application. It uses the generic renderer,
+        so needs no window, and can be built with something like:
+
+            cc "Thread Test.c" -I<Quesa includes> -lquesa -lpthread
+
+    COPYRIGHT:
+        Copyright (c) 1999-2026, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "Quesa.h"
+#include "QuesaCamera.h"
+#include "QuesaDrawContext.h"
+#include "QuesaGeometry.h"
+#include "QuesaGroup.h"
+#include "QuesaMath.h"
+#include "QuesaPick.h"
+#include "QuesaRenderer.h"
+#include "QuesaTransform.h"
+#include "QuesaView.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if QUESA_OS_WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+
+
+
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kNumThreads										4
+#define kNumRounds										4
+#define kNumPassesPerRound								8
+#define kNumCellsPerSide								8
+#define kNumPicksPerPass								16
+#define kMeshSize										12
+#define kImageSize										64
+
+
+
+
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+// Per-thread state
+typedef struct TQ3ThreadState {
+	TQ3GroupObject		theScene;
+	TQ3Uns32			theHits[kNumPicksPerPass];
+	TQ3Uns32			numObjects;
+	TQ3Uns32			numTriangles;
+	TQ3BoundingBox		theBounds;
+	TQ3Status			theStatus;
+} TQ3ThreadState;
+
+
+
+
+
+//=============================================================================
+//      Static variables
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject	gSharedMesh = NULL;
+static TQ3GroupObject		gCells[kNumCellsPerSide * kNumCellsPerSide];
+
+
+
+
+
+//=============================================================================
+//      MyNewMesh : Create a TriMesh grid.
+//-----------------------------------------------------------------------------
+//		Note :	The grid is large enough for Quesa to pick it through a tree
+//				of its triangles, which is built the first time it is picked.
+//-----------------------------------------------------------------------------
+static TQ3GeometryObject
+MyNewMesh(float theHeight)
+{	TQ3Point3D			thePoints[(kMeshSize + 1) * (kMeshSize + 1)];
+	TQ3TriMeshTriangleData	theTriangles[kMeshSize * kMeshSize * 2];
+	TQ3TriMeshData		meshData;
+	TQ3Uns32			x, y, n;
+
+
+
+	// Build the grid, in the unit square
+	for (y = 0; y <= kMeshSize; y++)
+		for (x = 0; x <= kMeshSize; x++)
+			Q3Point3D_Set(&thePoints[y * (kMeshSize + 1) + x],
+						  (float) x / kMeshSize, (float) y / kMeshSize,
+						  theHeight * (float) ((x + y) & 1));
+
+	n = 0;
+	for (y = 0; y < kMeshSize; y++)
+		{
+		for (x = 0; x < kMeshSize; x++)
+			{
+			TQ3Uns32 theCorner = y * (kMeshSize + 1) + x;
+			
+			theTriangles[n].pointIndices[0] = theCorner;
+			theTriangles[n].pointIndices[1] = theCorner + 1;
+			theTriangles[n].pointIndices[2] = theCorner + kMeshSize + 2;
+			n++;
+			
+			theTriangles[n].pointIndices[0] = theCorner;
+			theTriangles[n].pointIndices[1] = theCorner + kMeshSize + 2;
+			theTriangles[n].pointIndices[2] = theCorner + kMeshSize + 1;
+			n++;
+			}
+		}
+
+
+
+	// Create the TriMesh
+	memset(&meshData, 0, sizeof(meshData));
+	meshData.numPoints    = (kMeshSize + 1) * (kMeshSize + 1);
+	meshData.points       = thePoints;
+	meshData.numTriangles = n;
+	meshData.triangles    = theTriangles;
+
+	Q3BoundingBox_SetFromPoints3D(&meshData.bBox, thePoints, meshData.numPoints, sizeof(TQ3Point3D));
+
+	return(Q3TriMesh_New(&meshData));
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewScene : Create the shared scene.
+//-----------------------------------------------------------------------------
+//		Note :	The scene is a grid of cells, each of which is a display group
+//				holding a transform, its own TriMesh, a box and an ellipsoid.
+//				Every cell also holds a TriMesh which is shared by all of them.
+//-----------------------------------------------------------------------------
+static TQ3GroupObject
+MyNewScene(void)
+{	TQ3BoxData				boxData;
+	TQ3EllipsoidData		ellipsoidData;
+	TQ3GeometryObject		theGeom;
+	TQ3GroupObject			theScene;
+	TQ3TransformObject		theTransform;
+	TQ3Vector3D				theOffset;
+	TQ3Uns32				x, y;
+
+
+
+	// Create the scene
+	theScene    = Q3OrderedDisplayGroup_New();
+	gSharedMesh = MyNewMesh(0.1f);
+	if (theScene == NULL || gSharedMesh == NULL)
+		return(NULL);
+
+	memset(&boxData,       0, sizeof(boxData));
+	memset(&ellipsoidData, 0, sizeof(ellipsoidData));
+
+	Q3Point3D_Set(&boxData.origin,        0.2f, 0.2f, 0.0f);
+	Q3Vector3D_Set(&boxData.orientation,  0.0f, 0.0f, 0.3f);
+	Q3Vector3D_Set(&boxData.majorAxis,    0.3f, 0.0f, 0.0f);
+	Q3Vector3D_Set(&boxData.minorAxis,    0.0f, 0.3f, 0.0f);
+	
+	Q3Point3D_Set(&ellipsoidData.origin,       0.7f, 0.7f, 0.2f);
+	Q3Vector3D_Set(&ellipsoidData.orientation, 0.0f, 0.0f, 0.2f);
+	Q3Vector3D_Set(&ellipsoidData.majorRadius, 0.2f, 0.0f, 0.0f);
+	Q3Vector3D_Set(&ellipsoidData.minorRadius, 0.0f, 0.2f, 0.0f);
+	ellipsoidData.uMax = 1.0f;
+	ellipsoidData.vMax = 1.0f;
+
+
+
+	// Add the cells
+	for (y = 0; y < kNumCellsPerSide; y++)
+		{
+		for (x = 0; x < kNumCellsPerSide; x++)
+			{
+			TQ3GroupObject theCell = Q3DisplayGroup_New();
+			if (theCell == NULL)
+				return(NULL);
+
+			Q3DisplayGroup_SetState(theCell, kQ3DisplayGroupStateMaskIsDrawn         |
+											 kQ3DisplayGroupStateMaskIsPicked        |
+											 kQ3DisplayGroupStateMaskUseBoundingBox  |
+											 kQ3DisplayGroupStateMaskAutoBoundingBox);
+
+			Q3Vector3D_Set(&theOffset, (float) x * 1.5f, (float) y * 1.5f, 0.0f);
+			theTransform = Q3TranslateTransform_New(&theOffset);
+			Q3Group_AddObjectAndDispose(theCell, &theTransform);
+
+			theGeom = MyNewMesh(0.05f * (float) (x + y));
+			Q3Group_AddObjectAndDispose(theCell, &theGeom);
+
+			theGeom = Q3Box_New(&boxData);
+			Q3Group_AddObjectAndDispose(theCell, &theGeom);
+
+			theGeom = Q3Ellipsoid_New(&ellipsoidData);
+			Q3Group_AddObjectAndDispose(theCell, &theGeom);
+
+			Q3Group_AddObject(theCell, gSharedMesh);
+			
+			gCells[y * kNumCellsPerSide + x] = theCell;
+			Q3Group_AddObjectAndDispose(theScene, &theCell);
+			}
+		}
+
+	return(theScene);
+}
+
+
+
+
+
+//=============================================================================
+//      MyEditScene : Edit the scene between rounds.
+//-----------------------------------------------------------------------------
+//		Note :	Invalidates the caches kept by the groups and geometries, so
+//				that the next round builds them again from several threads.
+//-----------------------------------------------------------------------------
+static void
+MyEditScene(TQ3Uns32 theRound)
+{	TQ3TriMeshData			*meshData;
+	TQ3TransformObject		theTransform;
+	TQ3Vector3D				theScale;
+	TQ3Uns32				n;
+
+
+
+	// Lift the shared TriMesh a little
+	if (Q3TriMesh_LockData(gSharedMesh, kQ3False, &meshData) == kQ3Success)
+		{
+		for (n = 0; n < meshData->numPoints; n++)
+			meshData->points[n].z += 0.01f;
+
+		Q3TriMesh_UnlockData(gSharedMesh);
+		}
+
+
+
+	// Scale one cell in each row
+	Q3Vector3D_Set(&theScale, 1.0f, 1.0f, 1.1f);
+	
+	for (n = theRound % kNumCellsPerSide; n < kNumCellsPerSide * kNumCellsPerSide; n += kNumCellsPerSide)
+		{
+		theTransform = Q3ScaleTransform_New(&theScale);
+		Q3Group_AddObjectBefore(gCells[n], NULL, theTransform);
+		Q3Object_Dispose(theTransform);
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      MyNewView : Create a view.
+//-----------------------------------------------------------------------------
+static TQ3ViewObject
+MyNewView(void **theImage)
+{	TQ3ViewAngleAspectCameraData	cameraData;
+	TQ3PixmapDrawContextData		pixmapData;
+	TQ3DrawContextObject			theDrawContext;
+	TQ3CameraObject					theCamera;
+	TQ3ViewObject					theView;
+	float							theCentre;
+
+
+
+	// Create the view
+	theView   = Q3View_New();
+	*theImage = calloc(kImageSize * kImageSize, 4);
+	if (theView == NULL || *theImage == NULL)
+		return(NULL);
+
+	Q3View_SetRendererByType(theView, kQ3RendererTypeGeneric);
+
+
+
+	// Create the draw context
+	memset(&pixmapData, 0, sizeof(pixmapData));
+	pixmapData.drawContextData.clearImageMethod  = kQ3ClearMethodWithColor;
+	pixmapData.drawContextData.paneState         = kQ3False;
+	pixmapData.drawContextData.maskState         = kQ3False;
+	pixmapData.drawContextData.doubleBufferState = kQ3False;
+	pixmapData.pixmap.image     = *theImage;
+	pixmapData.pixmap.width     = kImageSize;
+	pixmapData.pixmap.height    = kImageSize;
+	pixmapData.pixmap.rowBytes  = kImageSize * 4;
+	pixmapData.pixmap.pixelSize = 32;
+	pixmapData.pixmap.pixelType = kQ3PixelTypeARGB32;
+	pixmapData.pixmap.bitOrder  = kQ3EndianBig;
+	pixmapData.pixmap.byteOrder = kQ3EndianBig;
+
+	theDrawContext = Q3PixmapDrawContext_New(&pixmapData);
+	Q3View_SetDrawContext(theView, theDrawContext);
+	Q3Object_CleanDispose(&theDrawContext);
+
+
+
+	// Create the camera, looking down on the whole scene
+	theCentre = 0.75f * (float) kNumCellsPerSide;
+	
+	memset(&cameraData, 0, sizeof(cameraData));
+	Q3Point3D_Set(&cameraData.cameraData.placement.cameraLocation,  theCentre, theCentre, 2.0f * theCentre);
+	Q3Point3D_Set(&cameraData.cameraData.placement.pointOfInterest, theCentre, theCentre, 0.0f);
+	Q3Vector3D_Set(&cameraData.cameraData.placement.upVector,       0.0f, 1.0f, 0.0f);
+	cameraData.cameraData.range.hither        = 0.1f;
+	cameraData.cameraData.range.yon           = 100.0f;
+	cameraData.cameraData.viewPort.origin.x   = -1.0f;
+	cameraData.cameraData.viewPort.origin.y   =  1.0f;
+	cameraData.cameraData.viewPort.width      =  2.0f;
+	cameraData.cameraData.viewPort.height     =  2.0f;
+	cameraData.fov                            = Q3Math_DegreesToRadians(60.0f);
+	cameraData.aspectRatioXToY                = 1.0f;
+
+	theCamera = Q3ViewAngleAspectCamera_New(&cameraData);
+	Q3View_SetCamera(theView, theCamera);
+	Q3Object_CleanDispose(&theCamera);
+
+	return(theView);
+}
+
+
+
+
+
+//=============================================================================
+//      MyPickScene : Pick the scene with a pick object.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+MyPickScene(TQ3ViewObject theView, TQ3PickObject thePick, TQ3GroupObject theScene)
+{	TQ3Uns32		numHits = 0;
+
+
+
+	// Pick the scene, and count the hits
+	if (thePick == NULL || Q3View_StartPicking(theView, thePick) != kQ3Success)
+		return(0);
+	
+	do
+		Q3Object_Submit(theScene, theView);
+	while (Q3View_EndPicking(theView) == kQ3ViewStatusRetraverse);
+
+	Q3Pick_GetNumHits(thePick, &numHits);
+	Q3Object_Dispose(thePick);
+	
+	return(numHits);
+}
+
+
+
+
+
+//=============================================================================
+//      MyRunPasses : Render and pick the scene from one thread.
+//-----------------------------------------------------------------------------
+static void
+MyRunPasses(TQ3ThreadState *theState)
+{	TQ3WindowPointPickData		pointData;
+	TQ3WorldRayPickData			rayData;
+	TQ3TriMeshData				*meshData;
+	TQ3ViewObject				theView;
+	void						*theImage = NULL;
+	TQ3Uns32					n, thePass;
+
+
+
+	// Create our view
+	theState->theStatus = kQ3Failure;
+	theView = MyNewView(&theImage);
+	if (theView == NULL)
+		{
+		free(theImage);
+		return;
+		}
+
+	memset(&pointData, 0, sizeof(pointData));
+	pointData.data.sort            = kQ3PickSortNearToFar;
+	pointData.data.mask            = kQ3PickDetailMaskObject | kQ3PickDetailMaskDistance;
+	pointData.data.numHitsToReturn = kQ3ReturnAllHits;
+	pointData.vertexTolerance      = 2.0f;
+	pointData.edgeTolerance        = 2.0f;
+
+	memset(&rayData, 0, sizeof(rayData));
+	rayData.data = pointData.data;
+	Q3Vector3D_Set(&rayData.ray.direction, 0.0f, 0.0f, -1.0f);
+
+
+
+	// Render, pick and bound the scene
+	for (thePass = 0; thePass < kNumPassesPerRound; thePass++)
+		{
+		if (Q3View_StartRendering(theView) == kQ3Success)
+			{
+			do
+				Q3Object_Submit(theState->theScene, theView);
+			while (Q3View_EndRendering(theView) == kQ3ViewStatusRetraverse);
+			}
+
+		for (n = 0; n < kNumPicksPerPass; n++)
+			{
+			if ((n & 1) == 0)
+				{
+				Q3Point2D_Set(&pointData.point, (float) (kImageSize * n) / kNumPicksPerPass, (float) kImageSize / 2.0f);
+				theState->theHits[n] = MyPickScene(theView, Q3WindowPointPick_New(&pointData), theState->theScene);
+				}
+			else
+				{
+				Q3Point3D_Set(&rayData.ray.origin, 1.5f * (float) (n / 2) + 0.5f, 0.5f, 10.0f);
+				theState->theHits[n] = MyPickScene(theView, Q3WorldRayPick_New(&rayData), theState->theScene);
+				}
+			}
+
+		if (Q3View_StartBoundingBox(theView, kQ3ComputeBoundsApproximate) == kQ3Success)
+			{
+			do
+				Q3Object_Submit(theState->theScene, theView);
+			while (Q3View_EndBoundingBox(theView, &theState->theBounds) == kQ3ViewStatusRetraverse);
+			}
+
+		Q3Group_CountObjectsOfType(gCells[thePass], kQ3GeometryTypeTriMesh, &theState->numObjects);
+
+		if (Q3TriMesh_LockData(gSharedMesh, kQ3True, &meshData) == kQ3Success)
+			{
+			theState->numTriangles = meshData->numTriangles;
+			Q3TriMesh_UnlockData(gSharedMesh);
+			}
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theView);
+	free(theImage);
+	
+	theState->theStatus = kQ3Success;
+}
+
+
+
+
+
+//=============================================================================
+//      MyThreadEntry : Thread entry point.
+//-----------------------------------------------------------------------------
+#if QUESA_OS_WIN32
+static DWORD WINAPI
+MyThreadEntry(LPVOID theParam)
+{
+	MyRunPasses((TQ3ThreadState *) theParam);
+	return(0);
+}
+#else
+static void *
+MyThreadEntry(void *theParam)
+{
+	MyRunPasses((TQ3ThreadState *) theParam);
+	return(NULL);
+}
+#endif
+
+
+
+
+
+//=============================================================================
+//      MyRunThreads : Run the passes on several threads at once.
+//-----------------------------------------------------------------------------
+static void
+MyRunThreads(TQ3ThreadState *theStates)
+{	TQ3Uns32		n;
+#if QUESA_OS_WIN32
+	HANDLE			theThreads[kNumThreads];
+#else
+	pthread_t		theThreads[kNumThreads];
+#endif
+
+
+
+	// Start the threads, then wait for them to finish
+	for (n = 0; n < kNumThreads; n++)
+		{
+#if QUESA_OS_WIN32
+		theThreads[n] = CreateThread(NULL, 0, MyThreadEntry, &theStates[n], 0, NULL);
+#else
+		pthread_create(&theThreads[n], NULL, MyThreadEntry, &theStates[n]);
+#endif
+		}
+
+	for (n = 0; n < kNumThreads; n++)
+		{
+#if QUESA_OS_WIN32
+		WaitForSingleObject(theThreads[n], INFINITE);
+		CloseHandle(theThreads[n]);
+#else
+		pthread_join(theThreads[n], NULL);
+#endif
+		}
+}
+
+
+
+
+
+//=============================================================================
+//      main : Program entry point.
+//-----------------------------------------------------------------------------
+int main(int argc, char * argv[])
+{	TQ3ThreadState		theStates[kNumThreads];
+	TQ3ThreadState		theReference;
+	TQ3GroupObject		theScene;
+	TQ3Uns32			theRound, numHits, editIndex, n;
+	int					numErrors = 0;
+#pragma unused(argc)
+#pragma unused(argv)
+
+
+
+	// Initialise Quesa, and create the scene
+	if (Q3Initialize() != kQ3Success)
+		{
+		printf("Q3Initialize failed\n");
+		return(EXIT_FAILURE);
+		}
+
+	theScene = MyNewScene();
+	if (theScene == NULL)
+		{
+		printf("Unable to create the scene\n");
+		Q3Exit();
+		return(EXIT_FAILURE);
+		}
+
+
+
+	// Run the rounds
+	//
+	// The threads run first, so that they build the caches between them, and
+	// then a single thread runs to give the results they should have seen.
+	//
+	// Each thread also locks the shared TriMesh read-only, which should not
+	// count as an edit however the locks overlap.
+	for (theRound = 0; theRound < kNumRounds; theRound++)
+		{
+		memset(theStates, 0, sizeof(theStates));
+		for (n = 0; n < kNumThreads; n++)
+			theStates[n].theScene = theScene;
+		
+		editIndex = Q3Shared_GetEditIndex(gSharedMesh);
+		MyRunThreads(theStates);
+
+		if (Q3Shared_GetEditIndex(gSharedMesh) != editIndex)
+			{
+			printf("Round %lu: read-only locks edited the shared TriMesh\n", (unsigned long) theRound);
+			numErrors++;
+			}
+
+		memset(&theReference, 0, sizeof(theReference));
+		theReference.theScene = theScene;
+		MyRunPasses(&theReference);
+
+		for (n = 0; n < kNumThreads; n++)
+			{
+			if (theStates[n].theStatus  != theReference.theStatus  ||
+				theStates[n].numObjects != theReference.numObjects ||
+				theStates[n].numTriangles != theReference.numTriangles ||
+				memcmp(theStates[n].theHits,    theReference.theHits,    sizeof(theReference.theHits))   != 0 ||
+				memcmp(&theStates[n].theBounds, &theReference.theBounds, sizeof(theReference.theBounds)) != 0)
+				{
+				printf("Round %lu: thread %lu saw different results\n", (unsigned long) theRound, (unsigned long) n);
+				numErrors++;
+				}
+			}
+
+		numHits = 0;
+		for (n = 0; n < kNumPicksPerPass; n++)
+			numHits += theReference.theHits[n];
+
+		printf("Round %lu: %lu threads, %lu hits per pass\n", (unsigned long) theRound,
+				(unsigned long) kNumThreads, (unsigned long) numHits);
+
+		MyEditScene(theRound);
+		}
+
+
+
+	// Clean up
+	Q3Object_Dispose(theScene);
+	Q3Object_Dispose(gSharedMesh);
+	Q3Exit();
+
+	printf(numErrors == 0 ? "Passed\n" : "Failed\n");
+	
+	return(numErrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
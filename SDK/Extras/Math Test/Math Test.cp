@@ -44,13 +44,24 @@
 //      Include files
 //-----------------------------------------------------------------------------
 #include "Quesa.h"
+#include "QuesaCamera.h"
+#include "QuesaDrawContext.h"
 #include "QuesaErrors.h"
+#include "QuesaExtension.h"
+#include "QuesaGeometry.h"
+#include "QuesaGroup.h"
 #include "QuesaMath.h"
+#include "QuesaPick.h"
+#include "QuesaRenderer.h"
+#include "QuesaTransform.h"
+#include "QuesaView.h"
 
 #include <iomanip.h>
 #include <iostream.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 
 
@@ -5985,6 +5996,1584 @@ Test_Q3BoundingSphere_UnionRationalPoint4D()
 
 
 
+//=============================================================================
+//	Array Functions Against Single Element Functions
+//-----------------------------------------------------------------------------
+//		Note :	The array functions may process blocks of four elements with
+//				SIMD code, and leave the remainder to a scalar loop. Every
+//				element must match the single element function bit for bit,
+//				signed zeros included, whatever the count and stride.
+//-----------------------------------------------------------------------------
+#pragma mark -
+
+const long kNumScalarElements = 9;
+
+static const TQ3Point3D kScalarPoints3D[kNumScalarElements] = {
+	{ -0.0f,     0.0f,    -0.0f    },
+	{  1.0f,    -0.0f,     2.0f    },
+	{ -1.5f,     2.25f,   -3.125f  },
+	{  0.1f,    -0.2f,     0.3f    },
+	{  1.0e6f,  -1.0e-6f,  7.0f    },
+	{ -0.0f,    -0.0f,     4.0f    },
+	{  3.0f,     5.0f,    -7.0f    },
+	{ -11.0f,   13.0f,     0.0f    },
+	{  0.333f,  -0.0f,     1.0e-3f } };
+
+static const TQ3Vector3D kScalarVectors3D[kNumScalarElements] = {
+	{ -0.0f,     0.0f,    -0.0f    },
+	{  1.0f,    -2.0f,     0.5f    },
+	{ -0.0f,    -0.0f,    -0.0f    },
+	{  3.0f,     0.25f,   -4.0f    },
+	{  1.0f,    -0.0f,     2.0f    },
+	{  0.1f,     0.2f,    -0.3f    },
+	{ -7.0f,    11.0f,    13.0f    },
+	{  1.0e-3f, -1.0e3f,   0.0f    },
+	{  0.5f,    -0.0f,    -0.5f    } };
+
+static const long kNumScalarMatrices = 3;
+
+static const char* const kScalarMatrixNames[kNumScalarMatrices] = {
+	"Rigid",
+	"Affine",
+	"Projective" };
+
+static const TQ3Matrix4x4 kScalarMatrices4x4[kNumScalarMatrices] = {
+	{ {
+		{  0.0f,   1.0f,   0.0f,   0.0f    },
+		{ -1.0f,   0.0f,   0.0f,   0.0f    },
+		{  0.0f,   0.0f,  -1.0f,   0.0f    },
+		{ -0.0f,   0.0f,  -0.0f,   1.0f    } } },
+	{ {
+		{  2.0f,   0.5f,  -0.0f,   0.0f    },
+		{ -0.25f,  3.0f,   0.0f,   0.0f    },
+		{  0.0f,  -1.0f,   1.5f,   0.0f    },
+		{ 10.0f, -20.0f,   0.0f,   1.0f    } } },
+	{ {
+		{ 11.0f,  13.0f,  17.0f,   0.001f  },
+		{ 23.0f, -29.0f,  31.0f,  -0.002f  },
+		{ 41.0f,  43.0f,  -0.0f,   0.0005f },
+		{ 61.0f, -67.0f,  71.0f,   1.5f    } } } };
+
+template<class T>
+static TQ3Boolean
+SameBits(const T& value1, const T& value2)
+{
+	return (TQ3Boolean) (memcmp(&value1, &value2, sizeof(T)) == 0);
+}
+
+//	Q3Point3D_To3DTransformArray against Q3Point3D_Transform
+static void
+Test_Q3Point3D_To3DTransformArray_Scalar()
+{
+	Begin("Q3Point3D_To3DTransformArray against Q3Point3D_Transform");
+
+	struct TQ3InPoint3D
+	{
+		TQ3Point3D value;
+		const char* ignore;
+	};
+	struct TQ3OutPoint3D
+	{
+		TQ3Point3D value;
+		double ignore;
+	};
+
+	TQ3InPoint3D inPoints3D[kNumScalarElements];
+	TQ3Point3D scalarPoints3D[kNumScalarElements];
+	TQ3Point3D packedPoints3D[kNumScalarElements];
+	TQ3OutPoint3D stridedPoints3D[kNumScalarElements];
+	TQ3OutPoint3D samePoints3D[kNumScalarElements];
+	const unsigned long inStructSize = sizeof(TQ3InPoint3D);
+	const unsigned long outStructSize = sizeof(TQ3OutPoint3D);
+	
+	long m, n;
+	int i;
+
+	for (i = 0; i < kNumScalarElements; ++i)
+	{
+		inPoints3D[i].value = kScalarPoints3D[i];
+		inPoints3D[i].ignore = "a";
+	}
+
+	// Each line gives the count, then whether the packed, strided and
+	// same parameter results match Q3Point3D_Transform
+	for (m = 0; m < kNumScalarMatrices; ++m)
+	{
+		BeginPhase(kScalarMatrixNames[m]);
+
+		for (i = 0; i < kNumScalarElements; ++i)
+			Q3Point3D_Transform(&kScalarPoints3D[i], &kScalarMatrices4x4[m], &scalarPoints3D[i]);
+
+		for (n = 1; n <= kNumScalarElements; ++n)
+		{
+			TQ3Boolean packedSame = kQ3True;
+			TQ3Boolean stridedSame = kQ3True;
+			TQ3Boolean sameSame = kQ3True;
+
+			for (i = 0; i < n; ++i)
+				samePoints3D[i].value = kScalarPoints3D[i];
+
+			Q3Point3D_To3DTransformArray(kScalarPoints3D, &kScalarMatrices4x4[m], packedPoints3D, n, sizeof(TQ3Point3D), sizeof(TQ3Point3D));
+			Q3Point3D_To3DTransformArray((const TQ3Point3D*) inPoints3D, &kScalarMatrices4x4[m], (TQ3Point3D*) stridedPoints3D, n, inStructSize, outStructSize);
+			Q3Point3D_To3DTransformArray((const TQ3Point3D*) samePoints3D, &kScalarMatrices4x4[m], (TQ3Point3D*) samePoints3D, n, outStructSize, outStructSize);
+
+			for (i = 0; i < n; ++i)
+			{
+				if (!SameBits(packedPoints3D[i], scalarPoints3D[i]))
+					packedSame = kQ3False;
+				if (!SameBits(stridedPoints3D[i].value, scalarPoints3D[i]))
+					stridedSame = kQ3False;
+				if (!SameBits(samePoints3D[i].value, scalarPoints3D[i]))
+					sameSame = kQ3False;
+			}
+
+			cout << "    " << n << ": " << packedSame << " " << stridedSame << " " << sameSame << endl;
+		}
+	}
+
+	BeginPhase("Infinite Point");
+
+	// The first point has w == 0, which posts kQ3ErrorInfiniteRationalPoint
+	const TQ3Matrix4x4 perspective4x4 = { {
+		{  1.0f,   0.0f,   0.0f,   0.0f    },
+		{  0.0f,   1.0f,   0.0f,   0.0f    },
+		{  0.0f,   0.0f,   1.0f,  -1.0f    },
+		{  0.0f,   0.0f,   0.0f,   0.0f    } } };
+	const long numInfinitePoints = 5;
+	TQ3Boolean infiniteSame = kQ3True;
+
+	for (i = 0; i < numInfinitePoints; ++i)
+		Q3Point3D_Transform(&kScalarPoints3D[i], &perspective4x4, &scalarPoints3D[i]);
+	Q3Point3D_To3DTransformArray(kScalarPoints3D, &perspective4x4, packedPoints3D, numInfinitePoints, sizeof(TQ3Point3D), sizeof(TQ3Point3D));
+	for (i = 0; i < numInfinitePoints; ++i)
+		if (!SameBits(packedPoints3D[i], scalarPoints3D[i]))
+			infiniteSame = kQ3False;
+	Test(infiniteSame);
+}
+
+//	Q3Vector3D_To3DTransformArray against Q3Vector3D_Transform
+static void
+Test_Q3Vector3D_To3DTransformArray_Scalar()
+{
+	Begin("Q3Vector3D_To3DTransformArray against Q3Vector3D_Transform");
+
+	struct TQ3InVector3D
+	{
+		TQ3Vector3D value;
+		const char* ignore;
+	};
+	struct TQ3OutVector3D
+	{
+		TQ3Vector3D value;
+		double ignore;
+	};
+
+	TQ3InVector3D inVectors3D[kNumScalarElements];
+	TQ3Vector3D scalarVectors3D[kNumScalarElements];
+	TQ3Vector3D packedVectors3D[kNumScalarElements];
+	TQ3OutVector3D stridedVectors3D[kNumScalarElements];
+	TQ3OutVector3D sameVectors3D[kNumScalarElements];
+	const unsigned long inStructSize = sizeof(TQ3InVector3D);
+	const unsigned long outStructSize = sizeof(TQ3OutVector3D);
+	
+	long m, n;
+	int i;
+
+	for (i = 0; i < kNumScalarElements; ++i)
+	{
+		inVectors3D[i].value = kScalarVectors3D[i];
+		inVectors3D[i].ignore = "a";
+	}
+
+	// Each line gives the count, then whether the packed, strided and
+	// same parameter results match Q3Vector3D_Transform
+	for (m = 0; m < kNumScalarMatrices; ++m)
+	{
+		BeginPhase(kScalarMatrixNames[m]);
+
+		for (i = 0; i < kNumScalarElements; ++i)
+			Q3Vector3D_Transform(&kScalarVectors3D[i], &kScalarMatrices4x4[m], &scalarVectors3D[i]);
+
+		for (n = 1; n <= kNumScalarElements; ++n)
+		{
+			TQ3Boolean packedSame = kQ3True;
+			TQ3Boolean stridedSame = kQ3True;
+			TQ3Boolean sameSame = kQ3True;
+
+			for (i = 0; i < n; ++i)
+				sameVectors3D[i].value = kScalarVectors3D[i];
+
+			Q3Vector3D_To3DTransformArray(kScalarVectors3D, &kScalarMatrices4x4[m], packedVectors3D, n, sizeof(TQ3Vector3D), sizeof(TQ3Vector3D));
+			Q3Vector3D_To3DTransformArray((const TQ3Vector3D*) inVectors3D, &kScalarMatrices4x4[m], (TQ3Vector3D*) stridedVectors3D, n, inStructSize, outStructSize);
+			Q3Vector3D_To3DTransformArray((const TQ3Vector3D*) sameVectors3D, &kScalarMatrices4x4[m], (TQ3Vector3D*) sameVectors3D, n, outStructSize, outStructSize);
+
+			for (i = 0; i < n; ++i)
+			{
+				if (!SameBits(packedVectors3D[i], scalarVectors3D[i]))
+					packedSame = kQ3False;
+				if (!SameBits(stridedVectors3D[i].value, scalarVectors3D[i]))
+					stridedSame = kQ3False;
+				if (!SameBits(sameVectors3D[i].value, scalarVectors3D[i]))
+					sameSame = kQ3False;
+			}
+
+			cout << "    " << n << ": " << packedSame << " " << stridedSame << " " << sameSame << endl;
+		}
+	}
+}
+
+//	Q3Vector3D_DotArray against Q3Vector3D_Dot
+static void
+Test_Q3Vector3D_DotArray_Scalar()
+{
+	Begin("Q3Vector3D_DotArray against Q3Vector3D_Dot");
+
+	struct TQ3InVector3D
+	{
+		TQ3Vector3D value;
+		const char* ignore;
+	};
+	struct TQ3OutDotProduct
+	{
+		float value;
+		double ignore;
+	};
+	struct TQ3OutDotLessThanZero
+	{
+		TQ3Boolean value;
+		const char* ignore;
+	};
+
+	// The first and fifth vectors give a dot product of -0.0f
+	TQ3Vector3D secondVectors3D[kNumScalarElements];
+	TQ3InVector3D inFirstVectors3D[kNumScalarElements];
+	TQ3InVector3D inSecondVectors3D[kNumScalarElements];
+	float scalarDotProducts[kNumScalarElements];
+	TQ3Boolean scalarDotLessThanZeros[kNumScalarElements];
+	float packedDotProducts[kNumScalarElements];
+	TQ3Boolean packedDotLessThanZeros[kNumScalarElements];
+	TQ3OutDotProduct stridedDotProducts[kNumScalarElements];
+	TQ3OutDotLessThanZero stridedDotLessThanZeros[kNumScalarElements];
+	
+	long n;
+	int i;
+
+	for (i = 0; i < kNumScalarElements; ++i)
+	{
+		secondVectors3D[i] = kScalarVectors3D[(i + 4) % kNumScalarElements];
+		inFirstVectors3D[i].value = kScalarVectors3D[i];
+		inFirstVectors3D[i].ignore = "a";
+		inSecondVectors3D[i].value = secondVectors3D[i];
+		inSecondVectors3D[i].ignore = "b";
+		scalarDotProducts[i] = Q3Vector3D_Dot(&kScalarVectors3D[i], &secondVectors3D[i]);
+		scalarDotLessThanZeros[i] = (TQ3Boolean) (scalarDotProducts[i] < 0.0f);
+	}
+
+	// Each line gives the count, then whether the products and the
+	// "< 0.0" flags match Q3Vector3D_Dot
+	BeginPhase("Products and Flags");
+
+	for (n = 1; n <= kNumScalarElements; ++n)
+	{
+		TQ3Boolean productsSame = kQ3True;
+		TQ3Boolean flagsSame = kQ3True;
+
+		Q3Vector3D_DotArray(kScalarVectors3D, secondVectors3D, packedDotProducts, packedDotLessThanZeros, n, sizeof(TQ3Vector3D), sizeof(float), sizeof(TQ3Boolean));
+		for (i = 0; i < n; ++i)
+		{
+			if (!SameBits(packedDotProducts[i], scalarDotProducts[i]))
+				productsSame = kQ3False;
+			if (packedDotLessThanZeros[i] != scalarDotLessThanZeros[i])
+				flagsSame = kQ3False;
+		}
+
+		cout << "    " << n << ": " << productsSame << " " << flagsSame << endl;
+	}
+
+	BeginPhase("Products");
+
+	for (n = 1; n <= kNumScalarElements; ++n)
+	{
+		TQ3Boolean productsSame = kQ3True;
+
+		Q3Vector3D_DotArray(kScalarVectors3D, secondVectors3D, packedDotProducts, NULL, n, sizeof(TQ3Vector3D), sizeof(float), sizeof(TQ3Boolean));
+		for (i = 0; i < n; ++i)
+			if (!SameBits(packedDotProducts[i], scalarDotProducts[i]))
+				productsSame = kQ3False;
+
+		cout << "    " << n << ": " << productsSame << endl;
+	}
+
+	BeginPhase("Flags");
+
+	for (n = 1; n <= kNumScalarElements; ++n)
+	{
+		TQ3Boolean flagsSame = kQ3True;
+
+		Q3Vector3D_DotArray(kScalarVectors3D, secondVectors3D, NULL, packedDotLessThanZeros, n, sizeof(TQ3Vector3D), sizeof(float), sizeof(TQ3Boolean));
+		for (i = 0; i < n; ++i)
+			if (packedDotLessThanZeros[i] != scalarDotLessThanZeros[i])
+				flagsSame = kQ3False;
+
+		cout << "    " << n << ": " << flagsSame << endl;
+	}
+
+	BeginPhase("Strided");
+
+	for (n = 1; n <= kNumScalarElements; ++n)
+	{
+		TQ3Boolean productsSame = kQ3True;
+		TQ3Boolean flagsSame = kQ3True;
+
+		Q3Vector3D_DotArray((const TQ3Vector3D*) inFirstVectors3D, (const TQ3Vector3D*) inSecondVectors3D,
+			(float*) stridedDotProducts, (TQ3Boolean*) stridedDotLessThanZeros, n,
+			sizeof(TQ3InVector3D), sizeof(TQ3OutDotProduct), sizeof(TQ3OutDotLessThanZero));
+		for (i = 0; i < n; ++i)
+		{
+			if (!SameBits(stridedDotProducts[i].value, scalarDotProducts[i]))
+				productsSame = kQ3False;
+			if (stridedDotLessThanZeros[i].value != scalarDotLessThanZeros[i])
+				flagsSame = kQ3False;
+		}
+
+		cout << "    " << n << ": " << productsSame << " " << flagsSame << endl;
+	}
+}
+
+//	Q3Triangle_CrossProductArray against Q3Point3D_CrossProductTri and Q3Vector3D_Normalize
+static void
+Test_Q3Triangle_CrossProductArray_Scalar()
+{
+	Begin("Q3Triangle_CrossProductArray against Q3Point3D_CrossProductTri and Q3Vector3D_Normalize");
+
+	// The fifth triangle is degenerate, and has a zero normal
+	const TQ3Uns32 theIndices[kNumScalarElements * 3] = {
+		0, 1, 2,
+		3, 4, 5,
+		6, 7, 8,
+		2, 5, 8,
+		1, 1, 4,
+		8, 0, 3,
+		7, 2, 6,
+		4, 6, 0,
+		5, 3, 1 };
+	const TQ3Uns8 usageFlags[kNumScalarElements] = {
+		0, 1, 0, 0, 1, 0, 1, 0, 0 };
+	const TQ3Vector3D unusedNormal = { -0.0f, 99.0f, -0.0f };
+	TQ3Vector3D scalarNormals[kNumScalarElements];
+	TQ3Vector3D theNormals[kNumScalarElements];
+	
+	long n;
+	int i;
+
+	for (i = 0; i < kNumScalarElements; ++i)
+	{
+		Q3Point3D_CrossProductTri(&kScalarPoints3D[theIndices[i * 3 + 0]],
+								  &kScalarPoints3D[theIndices[i * 3 + 1]],
+								  &kScalarPoints3D[theIndices[i * 3 + 2]],
+								  &scalarNormals[i]);
+		Q3Vector3D_Normalize(&scalarNormals[i], &scalarNormals[i]);
+	}
+
+	// Each line gives the count, then whether the normals match, and
+	// whether the normals of unused triangles were left alone
+	BeginPhase("All Triangles");
+
+	for (n = 1; n <= kNumScalarElements; ++n)
+	{
+		TQ3Boolean normalsSame = kQ3True;
+
+		for (i = 0; i < kNumScalarElements; ++i)
+			theNormals[i] = unusedNormal;
+		Q3Triangle_CrossProductArray(n, NULL, theIndices, kScalarPoints3D, theNormals);
+		for (i = 0; i < n; ++i)
+			if (!SameBits(theNormals[i], scalarNormals[i]))
+				normalsSame = kQ3False;
+
+		cout << "    " << n << ": " << normalsSame << endl;
+	}
+
+	BeginPhase("Usage Flags");
+
+	for (n = 1; n <= kNumScalarElements; ++n)
+	{
+		TQ3Boolean normalsSame = kQ3True;
+		TQ3Boolean unusedSame = kQ3True;
+
+		for (i = 0; i < kNumScalarElements; ++i)
+			theNormals[i] = unusedNormal;
+		Q3Triangle_CrossProductArray(n, usageFlags, theIndices, kScalarPoints3D, theNormals);
+		for (i = 0; i < n; ++i)
+		{
+			if (usageFlags[i] == 0 && !SameBits(theNormals[i], scalarNormals[i]))
+				normalsSame = kQ3False;
+			if (usageFlags[i] != 0 && !SameBits(theNormals[i], unusedNormal))
+				unusedSame = kQ3False;
+		}
+
+		cout << "    " << n << ": " << normalsSame << " " << unusedSame << endl;
+	}
+}
+
+
+
+
+
+//=============================================================================
+//	View Matrix State Against Matrix Functions
+//-----------------------------------------------------------------------------
+//		Note :	The view tags each matrix on its stack with a kind, and uses
+//				the kinds to skip terms of its products and inverses. A
+//				renderer must still receive the same products as
+//				Q3Matrix4x4_Multiply, compared by value so that 0.0 matches
+//				-0.0, and an inverse which agrees with Q3Matrix4x4_Invert.
+//-----------------------------------------------------------------------------
+#pragma mark -
+
+struct TQ3MatrixTestState
+{
+	TQ3Matrix4x4 localToWorld;
+	TQ3Matrix4x4 localToWorldInverse;
+	TQ3Matrix4x4 localToCamera;
+	TQ3Matrix4x4 localToFrustum;
+	TQ3Matrix4x4 worldToCamera;
+	TQ3Matrix4x4 cameraToFrustum;
+};
+
+static TQ3MatrixTestState gMatrixTestState;
+
+static TQ3Status
+MatrixTest_LocalToWorld(TQ3ViewObject theView, void *rendererPrivate, const TQ3Matrix4x4 *theMatrix)
+{
+	gMatrixTestState.localToWorld = *theMatrix;
+	return(kQ3Success);
+}
+
+static TQ3Status
+MatrixTest_LocalToWorldInverse(TQ3ViewObject theView, void *rendererPrivate, const TQ3Matrix4x4 *theMatrix)
+{
+	gMatrixTestState.localToWorldInverse = *theMatrix;
+	return(kQ3Success);
+}
+
+static TQ3Status
+MatrixTest_LocalToCamera(TQ3ViewObject theView, void *rendererPrivate, const TQ3Matrix4x4 *theMatrix)
+{
+	gMatrixTestState.localToCamera = *theMatrix;
+	return(kQ3Success);
+}
+
+static TQ3Status
+MatrixTest_LocalToFrustum(TQ3ViewObject theView, void *rendererPrivate, const TQ3Matrix4x4 *theMatrix)
+{
+	gMatrixTestState.localToFrustum = *theMatrix;
+	return(kQ3Success);
+}
+
+static TQ3Status
+MatrixTest_WorldToCamera(TQ3ViewObject theView, void *rendererPrivate, const TQ3Matrix4x4 *theMatrix)
+{
+	gMatrixTestState.worldToCamera = *theMatrix;
+	return(kQ3Success);
+}
+
+static TQ3Status
+MatrixTest_CameraToFrustum(TQ3ViewObject theView, void *rendererPrivate, const TQ3Matrix4x4 *theMatrix)
+{
+	gMatrixTestState.cameraToFrustum = *theMatrix;
+	return(kQ3Success);
+}
+
+static TQ3XFunctionPointer
+MatrixTest_MatrixMetaHandler(TQ3XMethodType methodType)
+{
+	switch (methodType)
+	{
+	case kQ3XMethodTypeRendererUpdateMatrixLocalToWorld:
+		return (TQ3XFunctionPointer) MatrixTest_LocalToWorld;
+	case kQ3XMethodTypeRendererUpdateMatrixLocalToWorldInverse:
+		return (TQ3XFunctionPointer) MatrixTest_LocalToWorldInverse;
+	case kQ3XMethodTypeRendererUpdateMatrixLocalToCamera:
+		return (TQ3XFunctionPointer) MatrixTest_LocalToCamera;
+	case kQ3XMethodTypeRendererUpdateMatrixLocalToFrustum:
+		return (TQ3XFunctionPointer) MatrixTest_LocalToFrustum;
+	case kQ3XMethodTypeRendererUpdateMatrixWorldToCamera:
+		return (TQ3XFunctionPointer) MatrixTest_WorldToCamera;
+	case kQ3XMethodTypeRendererUpdateMatrixCameraToFrustum:
+		return (TQ3XFunctionPointer) MatrixTest_CameraToFrustum;
+	}
+	
+	return(NULL);
+}
+
+static TQ3XFunctionPointer
+MatrixTest_MetaHandler(TQ3XMethodType methodType)
+{
+	switch (methodType)
+	{
+	case kQ3XMethodTypeRendererUpdateMatrixMetaHandler:
+		return (TQ3XFunctionPointer) MatrixTest_MatrixMetaHandler;
+	}
+	
+	return(NULL);
+}
+
+static TQ3Boolean
+SameValues(const TQ3Matrix4x4& matrix1, const TQ3Matrix4x4& matrix2)
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			if (matrix1.value[i][j] != matrix2.value[i][j])
+				return(kQ3False);
+
+	return(kQ3True);
+}
+
+static TQ3Boolean
+CloseValues(const TQ3Matrix4x4& matrix1, const TQ3Matrix4x4& matrix2)
+{
+	float largest = 1.0f;
+	int i, j;
+	
+	for (i = 0; i < 4; ++i)
+		for (j = 0; j < 4; ++j)
+			if (fabs(matrix2.value[i][j]) > largest)
+				largest = (float) fabs(matrix2.value[i][j]);
+
+	for (i = 0; i < 4; ++i)
+		for (j = 0; j < 4; ++j)
+			if (fabs(matrix1.value[i][j] - matrix2.value[i][j]) > 1.0e-5f * largest)
+				return(kQ3False);
+
+	return(kQ3True);
+}
+
+//	Local-to-world, local-to-camera, local-to-frustum and world-to-local
+//	matrices against Q3Matrix4x4_Multiply and Q3Matrix4x4_Invert
+static void
+Test_Q3View_MatrixState_Scalar()
+{
+	Begin("View matrix state against Q3Matrix4x4_Multiply and Q3Matrix4x4_Invert");
+
+	// Register a renderer which records the matrices it is given
+	TQ3ObjectType rendererType = kQ3ObjectTypeInvalid;
+	TQ3XObjectClass rendererClass = Q3XObjectHierarchy_RegisterClass(kQ3SharedTypeRenderer, &rendererType,
+		"Quesa:Math Test:Matrix Renderer", MatrixTest_MetaHandler, NULL, 0, 0);
+	if (rendererClass == NULL)
+		return;
+
+
+
+	// Create a view to render with it
+	const long imageSize = 8;
+	unsigned char theImage[imageSize * imageSize * 4];
+	TQ3PixmapDrawContextData pixmapData;
+	TQ3ViewAngleAspectCameraData cameraData;
+
+	memset(&pixmapData, 0, sizeof(pixmapData));
+	pixmapData.drawContextData.clearImageMethod  = kQ3ClearMethodWithColor;
+	pixmapData.drawContextData.paneState         = kQ3False;
+	pixmapData.drawContextData.maskState         = kQ3False;
+	pixmapData.drawContextData.doubleBufferState = kQ3False;
+	pixmapData.pixmap.image     = theImage;
+	pixmapData.pixmap.width     = imageSize;
+	pixmapData.pixmap.height    = imageSize;
+	pixmapData.pixmap.rowBytes  = imageSize * 4;
+	pixmapData.pixmap.pixelSize = 32;
+	pixmapData.pixmap.pixelType = kQ3PixelTypeARGB32;
+	pixmapData.pixmap.bitOrder  = kQ3EndianBig;
+	pixmapData.pixmap.byteOrder = kQ3EndianBig;
+
+	memset(&cameraData, 0, sizeof(cameraData));
+	Q3Point3D_Set(&cameraData.cameraData.placement.cameraLocation,  1.0f, -0.0f, 5.0f);
+	Q3Point3D_Set(&cameraData.cameraData.placement.pointOfInterest, 0.0f,  0.0f, -0.0f);
+	Q3Vector3D_Set(&cameraData.cameraData.placement.upVector,       0.0f,  1.0f, 0.0f);
+	cameraData.cameraData.range.hither      = 0.1f;
+	cameraData.cameraData.range.yon         = 100.0f;
+	cameraData.cameraData.viewPort.origin.x = -1.0f;
+	cameraData.cameraData.viewPort.origin.y =  1.0f;
+	cameraData.cameraData.viewPort.width    =  2.0f;
+	cameraData.cameraData.viewPort.height   =  2.0f;
+	cameraData.fov                          = Q3Math_DegreesToRadians(60.0f);
+	cameraData.aspectRatioXToY              = 1.0f;
+
+	TQ3ViewObject theView = Q3View_New();
+	TQ3DrawContextObject theDrawContext = Q3PixmapDrawContext_New(&pixmapData);
+	TQ3CameraObject theCamera = Q3ViewAngleAspectCamera_New(&cameraData);
+
+	Q3View_SetRendererByType(theView, rendererType);
+	Q3View_SetDrawContext(theView, theDrawContext);
+	Q3View_SetCamera(theView, theCamera);
+	Q3Object_Dispose(theDrawContext);
+	Q3Object_Dispose(theCamera);
+
+
+
+	// Create transforms of each kind, with signed zeros
+	const TQ3Vector3D translate1 = { -0.0f, 2.0f, 0.0f };
+	const TQ3RotateTransformData rotate = { kQ3AxisX, -0.0f };
+	const TQ3RotateAboutAxisTransformData rotateAboutAxis = { { 1.0f, -0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, 0.5f };
+	const TQ3Vector3D scale = { 2.0f, 0.5f, -3.0f };
+	const TQ3Quaternion quaternion = { 0.8f, 0.0f, -0.6f, 0.0f };
+	const TQ3Matrix4x4 matrix4x4 = { {
+		{  1.0f,   0.0f,  -0.0f,   0.1f    },
+		{  0.0f,   2.0f,   0.0f,  -0.0f    },
+		{ -0.0f,   0.5f,   1.0f,   0.0f    },
+		{  3.0f,  -0.0f,   1.0f,   1.0f    } } };
+	const TQ3Vector3D translate2 = { 1.0f, -0.0f, -3.0f };
+	const TQ3RotateAboutPointTransformData rotateAboutPoint = { kQ3AxisY, 1.25f, { -0.0f, 2.0f, 0.0f } };
+
+	const long numTransforms = 8;
+	const char* const transformNames[numTransforms] = {
+		"Translate",
+		"Rotate",
+		"Rotate About Axis",
+		"Scale",
+		"Quaternion",
+		"Matrix",
+		"Translate",
+		"Rotate About Point" };
+	TQ3TransformObject theTransforms[numTransforms] = {
+		Q3TranslateTransform_New(&translate1),
+		Q3RotateTransform_New(&rotate),
+		Q3RotateAboutAxisTransform_New(&rotateAboutAxis),
+		Q3ScaleTransform_New(&scale),
+		Q3QuaternionTransform_New(&quaternion),
+		Q3MatrixTransform_New(&matrix4x4),
+		Q3TranslateTransform_New(&translate2),
+		Q3RotateAboutPointTransform_New(&rotateAboutPoint) };
+
+	// The view pushes its state before the second step, and pops it after
+	// the sixth, so the steps which follow check that the kinds were restored
+	const long kPushStep = -1;
+	const long kPopStep = -2;
+	const long numSteps = 15;
+	const long theSteps[numSteps] = {
+		0, kPushStep, 1, 2, 3, 4, kPopStep, 1, 2, 3, 4, 5, 6, 7, 1 };
+	
+	TQ3Matrix4x4 pushedLocalToWorld, previousLocalToWorld, transformMatrix;
+	TQ3Matrix4x4 expectedLocalToWorld, expectedLocalToCamera, expectedLocalToFrustum, expectedInverse;
+	long n;
+
+
+
+	// Each transform gives whether the local-to-world, local-to-camera and
+	// local-to-frustum products match, and whether the inverse agrees
+	if (Q3View_StartRendering(theView) == kQ3Success)
+	{
+		do
+		{
+			for (n = 0; n < numSteps; ++n)
+			{
+				if (theSteps[n] == kPushStep)
+				{
+					BeginPhase("Push");
+					pushedLocalToWorld = gMatrixTestState.localToWorld;
+					Q3Push_Submit(theView);
+				}
+				else if (theSteps[n] == kPopStep)
+				{
+					BeginPhase("Pop");
+					Q3Pop_Submit(theView);
+					Test(SameValues(gMatrixTestState.localToWorld, pushedLocalToWorld));
+				}
+				else
+				{
+					previousLocalToWorld = gMatrixTestState.localToWorld;
+					Q3Object_Submit(theTransforms[theSteps[n]], theView);
+					Q3Transform_GetMatrix(theTransforms[theSteps[n]], &transformMatrix);
+
+					Q3Matrix4x4_Multiply(&transformMatrix, &previousLocalToWorld, &expectedLocalToWorld);
+					Q3Matrix4x4_Multiply(&gMatrixTestState.localToWorld, &gMatrixTestState.worldToCamera, &expectedLocalToCamera);
+					Q3Matrix4x4_Multiply(&gMatrixTestState.localToCamera, &gMatrixTestState.cameraToFrustum, &expectedLocalToFrustum);
+					Q3Matrix4x4_Invert(&gMatrixTestState.localToWorld, &expectedInverse);
+
+					cout << "    " << transformNames[theSteps[n]] << ": "
+						 << SameValues(gMatrixTestState.localToWorld, expectedLocalToWorld) << " "
+						 << SameValues(gMatrixTestState.localToCamera, expectedLocalToCamera) << " "
+						 << SameValues(gMatrixTestState.localToFrustum, expectedLocalToFrustum) << " "
+						 << CloseValues(gMatrixTestState.localToWorldInverse, expectedInverse) << endl;
+				}
+			}
+		}
+		while (Q3View_EndRendering(theView) == kQ3ViewStatusRetraverse);
+	}
+
+
+
+	// Clean up
+	for (n = 0; n < numTransforms; ++n)
+		Q3Object_Dispose(theTransforms[n]);
+
+	Q3Object_Dispose(theView);
+	Q3XObjectHierarchy_UnregisterClass(rendererClass);
+}
+
+
+
+
+
+//=============================================================================
+//	Immediate Mode Geometry Cache
+//-----------------------------------------------------------------------------
+//		Note :	Geometries submitted in immediate mode are decomposed once,
+//				and the decomposition reused while their data is unchanged.
+//				Each frame fills the data with a different byte before setting
+//				its fields, so that padding must not be part of the key.
+//-----------------------------------------------------------------------------
+#pragma mark -
+
+static TQ3XFunctionPointer
+CacheTest_MetaHandler(TQ3XMethodType methodType)
+{
+	// The renderer accepts no geometries, so every one is decomposed
+	return(NULL);
+}
+
+static TQ3ViewObject
+NewTestView(TQ3ObjectType rendererType)
+{
+	static unsigned char theImage[8 * 8 * 4];
+	TQ3PixmapDrawContextData pixmapData;
+	TQ3ViewAngleAspectCameraData cameraData;
+
+	memset(&pixmapData, 0, sizeof(pixmapData));
+	pixmapData.drawContextData.clearImageMethod  = kQ3ClearMethodWithColor;
+	pixmapData.drawContextData.paneState         = kQ3False;
+	pixmapData.drawContextData.maskState         = kQ3False;
+	pixmapData.drawContextData.doubleBufferState = kQ3False;
+	pixmapData.pixmap.image     = theImage;
+	pixmapData.pixmap.width     = 8;
+	pixmapData.pixmap.height    = 8;
+	pixmapData.pixmap.rowBytes  = 8 * 4;
+	pixmapData.pixmap.pixelSize = 32;
+	pixmapData.pixmap.pixelType = kQ3PixelTypeARGB32;
+	pixmapData.pixmap.bitOrder  = kQ3EndianBig;
+	pixmapData.pixmap.byteOrder = kQ3EndianBig;
+
+	memset(&cameraData, 0, sizeof(cameraData));
+	Q3Point3D_Set(&cameraData.cameraData.placement.cameraLocation,  0.0f, 0.0f, 5.0f);
+	Q3Point3D_Set(&cameraData.cameraData.placement.pointOfInterest, 0.0f, 0.0f, 0.0f);
+	Q3Vector3D_Set(&cameraData.cameraData.placement.upVector,       0.0f, 1.0f, 0.0f);
+	cameraData.cameraData.range.hither      = 0.1f;
+	cameraData.cameraData.range.yon         = 100.0f;
+	cameraData.cameraData.viewPort.origin.x = -1.0f;
+	cameraData.cameraData.viewPort.origin.y =  1.0f;
+	cameraData.cameraData.viewPort.width    =  2.0f;
+	cameraData.cameraData.viewPort.height   =  2.0f;
+	cameraData.fov                          = Q3Math_DegreesToRadians(60.0f);
+	cameraData.aspectRatioXToY              = 1.0f;
+
+	TQ3ViewObject theView = Q3View_New();
+	TQ3DrawContextObject theDrawContext = Q3PixmapDrawContext_New(&pixmapData);
+	TQ3CameraObject theCamera = Q3ViewAngleAspectCamera_New(&cameraData);
+
+	Q3View_SetRendererByType(theView, rendererType);
+	Q3View_SetDrawContext(theView, theDrawContext);
+	Q3View_SetCamera(theView, theCamera);
+	Q3Object_Dispose(theDrawContext);
+	Q3Object_Dispose(theCamera);
+	
+	return(theView);
+}
+
+const long kNumCacheShapes = 7;
+
+static const char* const kCacheShapeNames[kNumCacheShapes] = {
+	"Box",
+	"Cone",
+	"Cylinder",
+	"Disk",
+	"Ellipse",
+	"Ellipsoid",
+	"Torus" };
+
+//	Submit a shape in immediate mode, its data first filled with fillByte
+static void
+SubmitCacheShape(long theShape, unsigned char fillByte, TQ3ViewObject theView)
+{
+	const TQ3Point3D origin = { 0.0f, 0.0f, 0.0f };
+	const TQ3Vector3D orientation = { 0.0f, 0.0f, 1.0f };
+	const TQ3Vector3D majorRadius = { 1.0f, 0.0f, 0.0f };
+	const TQ3Vector3D minorRadius = { 0.0f, 1.0f, 0.0f };
+	TQ3BoxData boxData;
+	TQ3ConeData coneData;
+	TQ3CylinderData cylinderData;
+	TQ3DiskData diskData;
+	TQ3EllipseData ellipseData;
+	TQ3EllipsoidData ellipsoidData;
+	TQ3TorusData torusData;
+
+	switch (theShape)
+	{
+	case 0:
+		memset(&boxData, fillByte, sizeof(boxData));
+		boxData.origin           = origin;
+		boxData.orientation      = orientation;
+		boxData.majorAxis        = majorRadius;
+		boxData.minorAxis        = minorRadius;
+		boxData.faceAttributeSet = NULL;
+		boxData.boxAttributeSet  = NULL;
+		Q3Box_Submit(&boxData, theView);
+		break;
+
+	case 1:
+		memset(&coneData, fillByte, sizeof(coneData));
+		coneData.origin               = origin;
+		coneData.orientation          = orientation;
+		coneData.majorRadius          = majorRadius;
+		coneData.minorRadius          = minorRadius;
+		coneData.uMin                 = 0.0f;
+		coneData.uMax                 = 1.0f;
+		coneData.vMin                 = 0.0f;
+		coneData.vMax                 = 1.0f;
+		coneData.caps                 = kQ3EndCapMaskBottom;
+		coneData.interiorAttributeSet = NULL;
+		coneData.faceAttributeSet     = NULL;
+		coneData.bottomAttributeSet   = NULL;
+		coneData.coneAttributeSet     = NULL;
+		Q3Cone_Submit(&coneData, theView);
+		break;
+
+	case 2:
+		memset(&cylinderData, fillByte, sizeof(cylinderData));
+		cylinderData.origin               = origin;
+		cylinderData.orientation          = orientation;
+		cylinderData.majorRadius          = majorRadius;
+		cylinderData.minorRadius          = minorRadius;
+		cylinderData.uMin                 = 0.0f;
+		cylinderData.uMax                 = 1.0f;
+		cylinderData.vMin                 = 0.0f;
+		cylinderData.vMax                 = 1.0f;
+		cylinderData.caps                 = kQ3EndCapMaskTop | kQ3EndCapMaskBottom;
+		cylinderData.interiorAttributeSet = NULL;
+		cylinderData.topAttributeSet      = NULL;
+		cylinderData.faceAttributeSet     = NULL;
+		cylinderData.bottomAttributeSet   = NULL;
+		cylinderData.cylinderAttributeSet = NULL;
+		Q3Cylinder_Submit(&cylinderData, theView);
+		break;
+
+	case 3:
+		memset(&diskData, fillByte, sizeof(diskData));
+		diskData.origin           = origin;
+		diskData.majorRadius      = majorRadius;
+		diskData.minorRadius      = minorRadius;
+		diskData.uMin             = 0.0f;
+		diskData.uMax             = 1.0f;
+		diskData.vMin             = 0.0f;
+		diskData.vMax             = 1.0f;
+		diskData.diskAttributeSet = NULL;
+		Q3Disk_Submit(&diskData, theView);
+		break;
+
+	case 4:
+		memset(&ellipseData, fillByte, sizeof(ellipseData));
+		ellipseData.origin              = origin;
+		ellipseData.majorRadius         = majorRadius;
+		ellipseData.minorRadius         = minorRadius;
+		ellipseData.uMin                = 0.0f;
+		ellipseData.uMax                = 1.0f;
+		ellipseData.ellipseAttributeSet = NULL;
+		Q3Ellipse_Submit(&ellipseData, theView);
+		break;
+
+	case 5:
+		memset(&ellipsoidData, fillByte, sizeof(ellipsoidData));
+		ellipsoidData.origin                = origin;
+		ellipsoidData.orientation           = orientation;
+		ellipsoidData.majorRadius           = majorRadius;
+		ellipsoidData.minorRadius           = minorRadius;
+		ellipsoidData.uMin                  = 0.0f;
+		ellipsoidData.uMax                  = 1.0f;
+		ellipsoidData.vMin                  = 0.0f;
+		ellipsoidData.vMax                  = 1.0f;
+		ellipsoidData.caps                  = kQ3EndCapNone;
+		ellipsoidData.interiorAttributeSet  = NULL;
+		ellipsoidData.ellipsoidAttributeSet = NULL;
+		Q3Ellipsoid_Submit(&ellipsoidData, theView);
+		break;
+
+	case 6:
+		memset(&torusData, fillByte, sizeof(torusData));
+		torusData.origin               = origin;
+		torusData.orientation          = orientation;
+		torusData.majorRadius          = majorRadius;
+		torusData.minorRadius          = minorRadius;
+		torusData.ratio                = 0.5f;
+		torusData.uMin                 = 0.0f;
+		torusData.uMax                 = 1.0f;
+		torusData.vMin                 = 0.0f;
+		torusData.vMax                 = 1.0f;
+		torusData.caps                 = kQ3EndCapNone;
+		torusData.interiorAttributeSet = NULL;
+		torusData.torusAttributeSet    = NULL;
+		Q3Torus_Submit(&torusData, theView);
+		break;
+	}
+}
+
+//	Render a number of frames, submitting the shapes of showShape which are
+//	true, and return the immediate mode cache statistics
+static TQ3GeometryCacheStatistics
+RenderCacheFrames(TQ3ViewObject theView, long numFrames, const TQ3Boolean* showShape)
+{
+	TQ3GeometryCacheStatistics theStatistics;
+	long frame, n;
+
+	Q3Geometry_ResetCacheStatistics();
+	
+	for (frame = 0; frame < numFrames; ++frame)
+	{
+		if (Q3View_StartRendering(theView) == kQ3Success)
+		{
+			do
+			{
+				for (n = 0; n < kNumCacheShapes; ++n)
+					if (showShape[n])
+						SubmitCacheShape(n, (unsigned char) (0x55 + frame), theView);
+			}
+			while (Q3View_EndRendering(theView) == kQ3ViewStatusRetraverse);
+		}
+	}
+
+	Q3Geometry_GetCacheStatistics(&theStatistics);
+	return(theStatistics);
+}
+
+//	Immediate mode cache hits and misses, and idle frame limits
+static void
+Test_Q3Geometry_ImmediateCache()
+{
+	Begin("Immediate mode geometry cache hit rate");
+
+	// Register a renderer which accepts no geometries
+	TQ3ObjectType rendererType = kQ3ObjectTypeInvalid;
+	TQ3XObjectClass rendererClass = Q3XObjectHierarchy_RegisterClass(kQ3SharedTypeRenderer, &rendererType,
+		"Quesa:Math Test:Cache Renderer", CacheTest_MetaHandler, NULL, 0, 0);
+	if (rendererClass == NULL)
+		return;
+
+	TQ3ViewObject theView = NewTestView(rendererType);
+	TQ3GeometryCacheStatistics theStatistics;
+	TQ3Boolean showShape[kNumCacheShapes];
+	const long numFrames = 10;
+	long n;
+
+
+
+	// Each shape is decomposed on the first frame, and reused on the others
+	BeginPhase("Repeated submits");
+	Q3Geometry_SetImmediateCacheLimits(64, 60);
+
+	for (n = 0; n < kNumCacheShapes; ++n)
+	{
+		Q3Geometry_FlushImmediateCache();
+		memset(showShape, 0, sizeof(showShape));
+		showShape[n] = kQ3True;
+		
+		theStatistics = RenderCacheFrames(theView, numFrames, showShape);
+		cout << "    " << kCacheShapeNames[n] << ": "
+			 << (theStatistics.numImmediateMisses == 1) << " "
+			 << (theStatistics.numImmediateHits == numFrames - 1) << endl;
+	}
+
+	for (n = 0; n < kNumCacheShapes; ++n)
+		showShape[n] = kQ3True;
+
+	Q3Geometry_FlushImmediateCache();
+	theStatistics = RenderCacheFrames(theView, numFrames, showShape);
+	Output((float) theStatistics.numImmediateHits /
+		   (float) (theStatistics.numImmediateHits + theStatistics.numImmediateMisses));
+
+
+
+	// A shape which is not submitted for more than the idle frame limit is
+	// decomposed again, unless the limit is 0
+	BeginPhase("Idle frames");
+	memset(showShape, 0, sizeof(showShape));
+	showShape[1] = kQ3True;
+
+	Q3Geometry_SetImmediateCacheLimits(64, 2);
+	Q3Geometry_FlushImmediateCache();
+	RenderCacheFrames(theView, 1, showShape);
+	showShape[1] = kQ3False;
+	RenderCacheFrames(theView, 3, showShape);
+	showShape[1] = kQ3True;
+	theStatistics = RenderCacheFrames(theView, 1, showShape);
+	Test(theStatistics.numImmediateMisses == 1);
+
+	Q3Geometry_SetImmediateCacheLimits(64, 0);
+	Q3Geometry_FlushImmediateCache();
+	RenderCacheFrames(theView, 1, showShape);
+	showShape[1] = kQ3False;
+	RenderCacheFrames(theView, 3, showShape);
+	showShape[1] = kQ3True;
+	theStatistics = RenderCacheFrames(theView, 1, showShape);
+	Test(theStatistics.numImmediateHits == 1);
+
+
+
+	// Clean up
+	Q3Geometry_SetImmediateCacheLimits(64, 60);
+	Q3Geometry_FlushImmediateCache();
+	Q3Object_Dispose(theView);
+	Q3XObjectHierarchy_UnregisterClass(rendererClass);
+}
+
+
+
+
+
+//=============================================================================
+//	World Rays Pick
+//-----------------------------------------------------------------------------
+//		Note :	A world rays pick must find the same hits for each ray as a
+//				world ray pick of that ray alone, however many threads the
+//				rays of each TriMesh are shared between.
+//-----------------------------------------------------------------------------
+#pragma mark -
+
+//	A bumpy grid of triangles over the unit square
+static TQ3GeometryObject
+NewPickTestMesh(long gridSize)
+{
+	const long numPoints = (gridSize + 1) * (gridSize + 1);
+	TQ3Point3D* thePoints = new TQ3Point3D[numPoints];
+	TQ3TriMeshTriangleData* theTriangles = new TQ3TriMeshTriangleData[gridSize * gridSize * 2];
+	TQ3TriMeshData triMeshData;
+	long x, y, n = 0;
+
+	for (y = 0; y <= gridSize; ++y)
+	{
+		for (x = 0; x <= gridSize; ++x)
+			Q3Point3D_Set(&thePoints[y * (gridSize + 1) + x], (float) x / gridSize, (float) y / gridSize,
+						  0.05f * (float) sin(0.7f * x) * (float) cos(0.9f * y));
+	}
+
+	for (y = 0; y < gridSize; ++y)
+	{
+		for (x = 0; x < gridSize; ++x)
+		{
+			TQ3Uns32 p = (TQ3Uns32) (y * (gridSize + 1) + x);
+			theTriangles[n].pointIndices[0]   = p;
+			theTriangles[n].pointIndices[1]   = p + 1;
+			theTriangles[n++].pointIndices[2] = p + gridSize + 2;
+			theTriangles[n].pointIndices[0]   = p;
+			theTriangles[n].pointIndices[1]   = p + gridSize + 2;
+			theTriangles[n++].pointIndices[2] = p + gridSize + 1;
+		}
+	}
+
+	memset(&triMeshData, 0, sizeof(triMeshData));
+	triMeshData.numPoints    = (TQ3Uns32) numPoints;
+	triMeshData.points       = thePoints;
+	triMeshData.numTriangles = (TQ3Uns32) n;
+	triMeshData.triangles    = theTriangles;
+	Q3BoundingBox_SetFromPoints3D(&triMeshData.bBox, thePoints, (TQ3Uns32) numPoints, sizeof(TQ3Point3D));
+
+	TQ3GeometryObject theMesh = Q3TriMesh_New(&triMeshData);
+	delete [] thePoints;
+	delete [] theTriangles;
+	
+	return(theMesh);
+}
+
+//	Pick an object
+static void
+PickTestObject(TQ3ViewObject theView, TQ3PickObject thePick, TQ3Object theObject)
+{
+	if (Q3View_StartPicking(theView, thePick) == kQ3Success)
+	{
+		do
+		{
+			Q3Object_Submit(theObject, theView);
+		}
+		while (Q3View_EndPicking(theView) == kQ3ViewStatusRetraverse);
+	}
+}
+
+//	World rays picks on 1 and 4 threads against world ray picks
+static void
+Test_Q3WorldRaysPick_Threads()
+{
+	Begin("World rays pick against a world ray pick for each ray");
+
+	// Build a scene of two overlapping TriMeshes, one of them moved and
+	// tilted, so that most rays hit both
+	const TQ3Vector3D offset = { 0.25f, 0.0f, -0.5f };
+	const TQ3RotateTransformData rotate = { kQ3AxisY, 0.2f };
+	TQ3GroupObject theScene = Q3OrderedDisplayGroup_New();
+	TQ3GroupObject tiltGroup = Q3OrderedDisplayGroup_New();
+	TQ3Object theObject;
+
+	theObject = NewPickTestMesh(40);
+	Q3Group_AddObjectAndDispose(theScene, &theObject);
+	
+	theObject = Q3TranslateTransform_New(&offset);
+	Q3Group_AddObjectAndDispose(tiltGroup, &theObject);
+	theObject = Q3RotateTransform_New(&rotate);
+	Q3Group_AddObjectAndDispose(tiltGroup, &theObject);
+	theObject = NewPickTestMesh(40);
+	Q3Group_AddObjectAndDispose(tiltGroup, &theObject);
+	Q3Group_AddObjectAndDispose(theScene, &tiltGroup);
+
+
+
+	// Make the rays, mostly over the meshes
+	const long numRays = 1024;
+	TQ3Ray3D* theRays = new TQ3Ray3D[numRays];
+	long n;
+
+	srand(1);
+	for (n = 0; n < numRays; ++n)
+	{
+		Q3Point3D_Set(&theRays[n].origin, 1.4f * rand() / RAND_MAX - 0.2f, 1.4f * rand() / RAND_MAX - 0.2f, 2.0f);
+		Q3Vector3D_Set(&theRays[n].direction, 0.1f * rand() / RAND_MAX - 0.05f, 0.1f * rand() / RAND_MAX - 0.05f, -1.0f);
+		Q3Vector3D_Normalize(&theRays[n].direction, &theRays[n].direction);
+	}
+
+	TQ3WorldRaysPickData raysData;
+	memset(&raysData, 0, sizeof(raysData));
+	raysData.data.sort            = kQ3PickSortNearToFar;
+	raysData.data.mask            = kQ3PickDetailMaskDistance | kQ3PickDetailMaskXYZ;
+	raysData.data.numHitsToReturn = kQ3ReturnAllHits;
+	raysData.numRays              = (TQ3Uns32) numRays;
+	raysData.rays                 = theRays;
+
+	TQ3WorldRayPickData rayData;
+	memset(&rayData, 0, sizeof(rayData));
+	rayData.data = raysData.data;
+
+
+
+	// Pick each ray on its own
+	TQ3ViewObject theView = NewTestView(kQ3RendererTypeGeneric);
+	TQ3Uns32* rayHits = new TQ3Uns32[numRays];
+	float* rayDistances = new float[numRays];
+	TQ3Uns32 numHits, totalHits = 0;
+	TQ3PickObject thePick;
+
+	for (n = 0; n < numRays; ++n)
+	{
+		rayData.ray = theRays[n];
+		thePick = Q3WorldRayPick_New(&rayData);
+		PickTestObject(theView, thePick, theScene);
+
+		Q3Pick_GetNumHits(thePick, &rayHits[n]);
+		rayDistances[n] = 0.0f;
+		if (rayHits[n] != 0)
+			Q3Pick_GetPickDetailData(thePick, 0, kQ3PickDetailMaskDistance, &rayDistances[n]);
+
+		totalHits += rayHits[n];
+		Q3Object_Dispose(thePick);
+	}
+
+	Output(totalHits > (TQ3Uns32) numRays);
+
+
+
+	// Pick every ray at once, on 1 thread then on 4, and count the rays whose
+	// hits and nearest distance match
+	const TQ3Uns32 threadCounts[2] = { 1, 4 };
+	const char* const phaseNames[2] = { "1 thread", "4 threads" };
+	float theDistance;
+	long t, numMatched;
+
+	for (t = 0; t < 2; ++t)
+	{
+		BeginPhase(phaseNames[t]);
+		raysData.numThreads = threadCounts[t];
+		thePick = Q3WorldRaysPick_New(&raysData);
+		PickTestObject(theView, thePick, theScene);
+
+		numMatched = 0;
+		for (n = 0; n < numRays; ++n)
+		{
+			Q3WorldRaysPick_GetNumHits(thePick, (TQ3Uns32) n, &numHits);
+			theDistance = 0.0f;
+			if (numHits != 0)
+				Q3WorldRaysPick_GetPickDetailData(thePick, (TQ3Uns32) n, 0, kQ3PickDetailMaskDistance, &theDistance);
+
+			if (numHits == rayHits[n] && theDistance == rayDistances[n])
+				++numMatched;
+		}
+
+		Q3Pick_GetNumHits(thePick, &numHits);
+		Test(numMatched == numRays);
+		Test(numHits == totalHits);
+		Q3Object_Dispose(thePick);
+	}
+
+
+
+	// Clean up
+	delete [] theRays;
+	delete [] rayHits;
+	delete [] rayDistances;
+	Q3Object_Dispose(theScene);
+	Q3Object_Dispose(theView);
+}
+
+
+
+
+
+//=============================================================================
+//	Analytic Quadric Pick
+//-----------------------------------------------------------------------------
+//		Note :	Ray picks on complete quadrics intersect their exact surface.
+//				A pick which asks for TriMesh faces still tests the triangles
+//				of the cached form, so with a fine subdivision both must find
+//				nearly the same hits. They can differ near silhouettes, and the
+//				tessellated normals are only close to the exact ones.
+//-----------------------------------------------------------------------------
+#pragma mark -
+
+const long kNumPickQuadrics = 6;
+
+static const char* const kPickQuadricNames[kNumPickQuadrics] = {
+	"Box",
+	"Cone",
+	"Cylinder",
+	"Disk",
+	"Ellipsoid",
+	"Torus" };
+
+//	A complete quadric, in a frame which is neither unit nor orthogonal
+static TQ3GeometryObject
+NewPickQuadric(long theShape)
+{
+	const TQ3Point3D origin = { 0.1f, -0.2f, 0.05f };
+	const TQ3Vector3D orientation = { 0.0f, 0.2f, 0.9f };
+	const TQ3Vector3D majorRadius = { 1.0f, 0.0f, 0.0f };
+	const TQ3Vector3D minorRadius = { 0.0f, 0.7f, 0.0f };
+	TQ3BoxData boxData;
+	TQ3ConeData coneData;
+	TQ3CylinderData cylinderData;
+	TQ3DiskData diskData;
+	TQ3EllipsoidData ellipsoidData;
+	TQ3TorusData torusData;
+
+	switch (theShape)
+	{
+	case 0:
+		memset(&boxData, 0, sizeof(boxData));
+		boxData.origin      = origin;
+		boxData.orientation = orientation;
+		boxData.majorAxis   = majorRadius;
+		boxData.minorAxis   = minorRadius;
+		return(Q3Box_New(&boxData));
+
+	case 1:
+		memset(&coneData, 0, sizeof(coneData));
+		coneData.origin      = origin;
+		coneData.orientation = orientation;
+		coneData.majorRadius = majorRadius;
+		coneData.minorRadius = minorRadius;
+		coneData.uMax        = 1.0f;
+		coneData.vMax        = 1.0f;
+		coneData.caps        = kQ3EndCapMaskBottom;
+		return(Q3Cone_New(&coneData));
+
+	case 2:
+		memset(&cylinderData, 0, sizeof(cylinderData));
+		cylinderData.origin      = origin;
+		cylinderData.orientation = orientation;
+		cylinderData.majorRadius = majorRadius;
+		cylinderData.minorRadius = minorRadius;
+		cylinderData.uMax        = 1.0f;
+		cylinderData.vMax        = 1.0f;
+		cylinderData.caps        = kQ3EndCapMaskTop | kQ3EndCapMaskBottom;
+		return(Q3Cylinder_New(&cylinderData));
+
+	case 3:
+		memset(&diskData, 0, sizeof(diskData));
+		diskData.origin      = origin;
+		diskData.majorRadius = majorRadius;
+		diskData.minorRadius = minorRadius;
+		diskData.uMax        = 1.0f;
+		diskData.vMax        = 1.0f;
+		return(Q3Disk_New(&diskData));
+
+	case 4:
+		memset(&ellipsoidData, 0, sizeof(ellipsoidData));
+		ellipsoidData.origin      = origin;
+		ellipsoidData.orientation = orientation;
+		ellipsoidData.majorRadius = majorRadius;
+		ellipsoidData.minorRadius = minorRadius;
+		ellipsoidData.uMax        = 1.0f;
+		ellipsoidData.vMax        = 1.0f;
+		return(Q3Ellipsoid_New(&ellipsoidData));
+
+	case 5:
+		memset(&torusData, 0, sizeof(torusData));
+		torusData.origin      = origin;
+		torusData.orientation = orientation;
+		torusData.majorRadius = majorRadius;
+		torusData.ratio       = 0.3f;
+		torusData.uMax        = 1.0f;
+		torusData.vMax        = 1.0f;
+		Q3Vector3D_Set(&torusData.minorRadius, 0.0f, 1.0f, 0.0f);
+		return(Q3Torus_New(&torusData));
+	}
+	
+	return(NULL);
+}
+
+//	Analytic picks against picks of the cached form, for each quadric
+static void
+Test_Q3Geometry_AnalyticPick()
+{
+	Begin("Analytic quadric picks against tessellated picks");
+
+	// Make the rays, from a sphere around the shapes towards points near them
+	const long numRays = 1000;
+	TQ3Ray3D* theRays = new TQ3Ray3D[numRays];
+	TQ3Point3D theTarget;
+	long n, s;
+
+	srand(2);
+	for (n = 0; n < numRays; ++n)
+	{
+		Q3Vector3D_Set(&theRays[n].direction, 2.0f * rand() / RAND_MAX - 1.0f, 2.0f * rand() / RAND_MAX - 1.0f,
+					   2.0f * rand() / RAND_MAX - 1.0f);
+		Q3Vector3D_Normalize(&theRays[n].direction, &theRays[n].direction);
+		Q3Point3D_Set(&theRays[n].origin, 4.0f * theRays[n].direction.x, 4.0f * theRays[n].direction.y,
+					  4.0f * theRays[n].direction.z);
+
+		Q3Point3D_Set(&theTarget, 2.4f * rand() / RAND_MAX - 1.2f, 2.4f * rand() / RAND_MAX - 1.2f,
+					  2.4f * rand() / RAND_MAX - 1.2f);
+		Q3Point3D_Subtract(&theTarget, &theRays[n].origin, &theRays[n].direction);
+		Q3Vector3D_Normalize(&theRays[n].direction, &theRays[n].direction);
+	}
+
+
+
+	// Pick each ray against each shape, both ways, under a fine subdivision
+	TQ3SubdivisionStyleData subdivisionData = { kQ3SubdivisionMethodConstant, 128.0f, 128.0f };
+	TQ3ViewObject theView = NewTestView(kQ3RendererTypeGeneric);
+	TQ3WorldRayPickData rayData;
+	TQ3PickObject thePick;
+	TQ3Uns32 numHits[2];
+	float theDistance[2];
+	TQ3Vector3D theNormal[2];
+	long numMissed, numFar, numBent, m;
+
+	memset(&rayData, 0, sizeof(rayData));
+	rayData.data.sort            = kQ3PickSortNearToFar;
+	rayData.data.numHitsToReturn = kQ3ReturnAllHits;
+
+	for (s = 0; s < kNumPickQuadrics; ++s)
+	{
+		TQ3GroupObject theGroup = Q3OrderedDisplayGroup_New();
+		TQ3Object theObject = Q3SubdivisionStyle_New(&subdivisionData);
+		Q3Group_AddObjectAndDispose(theGroup, &theObject);
+		theObject = NewPickQuadric(s);
+		Q3Group_AddObjectAndDispose(theGroup, &theObject);
+
+		numMissed = numFar = numBent = 0;
+		for (n = 0; n < numRays; ++n)
+		{
+			rayData.ray = theRays[n];
+			for (m = 0; m < 2; ++m)
+			{
+				rayData.data.mask = kQ3PickDetailMaskDistance | kQ3PickDetailMaskNormal;
+				if (m == 1)
+					rayData.data.mask |= kQ3PickDetailMaskTriMeshFace;
+
+				thePick = Q3WorldRayPick_New(&rayData);
+				PickTestObject(theView, thePick, theGroup);
+				Q3Pick_GetNumHits(thePick, &numHits[m]);
+				if (numHits[m] != 0)
+				{
+					Q3Pick_GetPickDetailData(thePick, 0, kQ3PickDetailMaskDistance, &theDistance[m]);
+					Q3Pick_GetPickDetailData(thePick, 0, kQ3PickDetailMaskNormal,   &theNormal[m]);
+					Q3Vector3D_Normalize(&theNormal[m], &theNormal[m]);
+				}
+				Q3Object_Dispose(thePick);
+			}
+
+			if ((numHits[0] == 0) != (numHits[1] == 0))
+				++numMissed;
+			else if (numHits[0] != 0 && fabs(theDistance[0] - theDistance[1]) > 0.01f)
+				++numFar;
+			else if (numHits[0] != 0 && Q3Vector3D_Dot(&theNormal[0], &theNormal[1]) < 0.95f)
+				++numBent;
+		}
+
+		cout << "    " << kPickQuadricNames[s] << ": "
+			 << (numMissed <= numRays / 100) << " "
+			 << (numFar    <= numRays / 100) << " "
+			 << (numBent   <= numRays / 100) << endl;
+
+		Q3Object_Dispose(theGroup);
+	}
+
+
+
+	// Clean up
+	delete [] theRays;
+	Q3Object_Dispose(theView);
+}
+
+
+
+
+
+//=============================================================================
+//	Bounding Box Array Visibility
+//-----------------------------------------------------------------------------
+//		Note :	Q3View_IsBoundingBoxArrayVisible must find exactly the boxes
+//				that Q3View_IsBoundingBoxVisible finds, whatever the number of
+//				boxes and the local to frustum matrix. The array is timed
+//				against the single box function on 100K boxes, with few of
+//				them straddling the frustum and with a quarter of them.
+//-----------------------------------------------------------------------------
+#pragma mark -
+
+//	Random boxes around the view frustum, a fraction of them large enough that
+//	they are likely to straddle its sides
+static void
+SetRandomBoxes(long numBoxes, float largeFraction, TQ3BoundingBox* theBoxes)
+{
+	TQ3Point3D theCentre;
+	float theSize;
+	long n;
+
+	for (n = 0; n < numBoxes; ++n)
+	{
+		Q3Point3D_Set(&theCentre, 20.0f * rand() / RAND_MAX - 10.0f, 20.0f * rand() / RAND_MAX - 10.0f,
+					  -20.0f * rand() / RAND_MAX + 4.0f);
+		theSize = (float) rand() / RAND_MAX < largeFraction ? 2.0f : 0.05f;
+		if (n % 17 == 0)
+			theSize = 0.0f;
+
+		theBoxes[n].min.x = theCentre.x - theSize * rand() / RAND_MAX;
+		theBoxes[n].min.y = theCentre.y - theSize * rand() / RAND_MAX;
+		theBoxes[n].min.z = theCentre.z - theSize * rand() / RAND_MAX;
+		theBoxes[n].max.x = theCentre.x + theSize * rand() / RAND_MAX;
+		theBoxes[n].max.y = theCentre.y + theSize * rand() / RAND_MAX;
+		theBoxes[n].max.z = theCentre.z + theSize * rand() / RAND_MAX;
+		theBoxes[n].isEmpty = kQ3False;
+	}
+}
+
+//	Count the boxes whose array bit differs from the single box result
+static long
+CountVisibilityMismatches(TQ3ViewObject theView, long numBoxes, const TQ3BoundingBox* theBoxes)
+{
+	TQ3Uns32* visibleMask = new TQ3Uns32[numBoxes / 32 + 1];
+	TQ3Boolean arrayVisible;
+	long n, numMismatched = 0;
+
+	memset(visibleMask, 0xFF, (numBoxes / 32 + 1) * sizeof(TQ3Uns32));
+	Q3View_IsBoundingBoxArrayVisible(theView, (TQ3Uns32) numBoxes, theBoxes, visibleMask);
+
+	for (n = 0; n < numBoxes; ++n)
+	{
+		arrayVisible = (visibleMask[n / 32] & (1UL << (n % 32))) != 0 ? kQ3True : kQ3False;
+		if (arrayVisible != Q3View_IsBoundingBoxVisible(theView, &theBoxes[n]))
+			++numMismatched;
+	}
+
+	delete [] visibleMask;
+	return(numMismatched);
+}
+
+//	Q3View_IsBoundingBoxArrayVisible against Q3View_IsBoundingBoxVisible
+static void
+Test_Q3View_IsBoundingBoxArrayVisible()
+{
+	Begin("Q3View_IsBoundingBoxArrayVisible against Q3View_IsBoundingBoxVisible");
+
+	const long numCounts = 6;
+	const long theCounts[numCounts] = { 1, 3, 4, 33, 1000, 1003 };
+	const long maxBoxes = 100000;
+	const long numTimings = 10;
+	const TQ3RotateTransformData rotate = { kQ3AxisY, 0.4f };
+	const TQ3Vector3D scale = { 2.0f, 0.5f, 1.5f };
+	TQ3BoundingBox* theBoxes = new TQ3BoundingBox[maxBoxes];
+	TQ3Uns32* visibleMask = new TQ3Uns32[maxBoxes / 32 + 1];
+	TQ3ViewObject theView = NewTestView(kQ3RendererTypeGeneric);
+	long c, n, t, numMismatched;
+	clock_t startTime, singleTime, arrayTime;
+	TQ3Boolean isVisible;
+	TQ3Uns32 numVisible;
+
+	srand(3);
+
+	if (Q3View_StartRendering(theView) == kQ3Success)
+	{
+		do
+		{
+			// Each count of boxes, under the identity then under a rotation
+			// and a non-uniform scale
+			BeginPhase("Agreement");
+			for (t = 0; t < 2; ++t)
+			{
+				if (t == 1)
+				{
+					Q3RotateTransform_Submit(&rotate, theView);
+					Q3ScaleTransform_Submit(&scale, theView);
+				}
+
+				numMismatched = 0;
+				for (c = 0; c < numCounts; ++c)
+				{
+					SetRandomBoxes(theCounts[c], 0.25f, theBoxes);
+					numMismatched += CountVisibilityMismatches(theView, theCounts[c], theBoxes);
+				}
+				Test(numMismatched == 0);
+			}
+
+
+
+			// Time 100K boxes with few and with many straddling the frustum
+			BeginPhase("100K boxes, per box against array");
+			for (t = 0; t < 2; ++t)
+			{
+				SetRandomBoxes(maxBoxes, t == 0 ? 0.0f : 0.25f, theBoxes);
+				Test(CountVisibilityMismatches(theView, maxBoxes, theBoxes) == 0);
+
+				numVisible = 0;
+				startTime = clock();
+				for (c = 0; c < numTimings; ++c)
+				{
+					for (n = 0; n < maxBoxes; ++n)
+					{
+						isVisible = Q3View_IsBoundingBoxVisible(theView, &theBoxes[n]);
+						numVisible += (TQ3Uns32) isVisible;
+					}
+				}
+				singleTime = clock() - startTime;
+
+				startTime = clock();
+				for (c = 0; c < numTimings; ++c)
+					Q3View_IsBoundingBoxArrayVisible(theView, (TQ3Uns32) maxBoxes, theBoxes, visibleMask);
+				arrayTime = clock() - startTime;
+
+				cout << "    " << (t == 0 ? "Few straddling: " : "Quarter straddling: ")
+					 << 1000.0 * singleTime / CLOCKS_PER_SEC / numTimings << " ms against "
+					 << 1000.0 * arrayTime / CLOCKS_PER_SEC / numTimings << " ms, "
+					 << numVisible / numTimings << " visible" << endl;
+			}
+		}
+		while (Q3View_EndRendering(theView) == kQ3ViewStatusRetraverse);
+	}
+
+
+
+	// Clean up
+	delete [] theBoxes;
+	delete [] visibleMask;
+	Q3Object_Dispose(theView);
+}
+
+
+
+
+
 //=============================================================================
 //		Public functions.
 //-----------------------------------------------------------------------------
@@ -6193,6 +7782,27 @@ int main(void)
 	Test_Q3BoundingSphere_UnionPoint3D();
 	Test_Q3BoundingSphere_UnionRationalPoint4D();
 
+	BeginSection("Array Functions Against Single Element Functions");
+	Test_Q3Point3D_To3DTransformArray_Scalar();
+	Test_Q3Vector3D_To3DTransformArray_Scalar();
+	Test_Q3Vector3D_DotArray_Scalar();
+	Test_Q3Triangle_CrossProductArray_Scalar();
+
+	BeginSection("View Matrix State Against Matrix Functions");
+	Test_Q3View_MatrixState_Scalar();
+
+	BeginSection("Immediate Mode Geometry Cache");
+	Test_Q3Geometry_ImmediateCache();
+
+	BeginSection("World Rays Pick");
+	Test_Q3WorldRaysPick_Threads();
+
+	BeginSection("Analytic Quadric Pick");
+	Test_Q3Geometry_AnalyticPick();
+
+	BeginSection("Bounding Box Array Visibility");
+	Test_Q3View_IsBoundingBoxArrayVisible();
+
 	// Clean up.
 	Terminate();
 
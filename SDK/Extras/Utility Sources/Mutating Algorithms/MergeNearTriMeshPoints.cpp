@@ -60,6 +60,215 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
+
+namespace
+{
+	// Cell coordinates are clamped to this range on each axis, so that a
+	// tiny threshold over a huge model cannot overflow the cell indices.
+	const double	kMaxCellsPerAxis	= 1048576.0;
+	
+	const TQ3Uns32	kNoIndex			= 0xFFFFFFFFUL;
+	
+	struct CellKey
+	{
+		TQ3Int32	x, y, z;
+		
+		bool		operator<( const CellKey& inOther ) const
+					{
+						if (x != inOther.x)
+							return x < inOther.x;
+						if (y != inOther.y)
+							return y < inOther.y;
+						return z < inOther.z;
+					}
+		
+		bool		operator==( const CellKey& inOther ) const
+					{
+						return (x == inOther.x) && (y == inOther.y) &&
+							(z == inOther.z);
+					}
+	};
+	
+	struct KeyedPoint
+	{
+		CellKey		key;
+		TQ3Uns32	index;
+		
+		bool		operator<( const KeyedPoint& inOther ) const
+					{
+						return key < inOther.key;
+					}
+	};
+	
+	
+	/*
+		Uniform grid over the TriMesh points.  Each point is assigned to a
+		dense cell number, and each cell keeps the list of cluster
+		representatives found in it so far, in increasing index order.
+	*/
+	class PointGrid
+	{
+	public:
+					PointGrid( const TQ3Point3D* inPoints, TQ3Uns32 inNumPoints,
+								float inCellSize );
+	
+		// Cell numbers of the occupied cells among the cell containing a
+		// point and its neighbours.  Returns the number of cells found.
+		TQ3Uns32	NeighbourCells( TQ3Uns32 inPointIndex,
+								TQ3Uns32 outCells[27] ) const;
+		
+		TQ3Uns32	FirstRepresentative( TQ3Uns32 inCell ) const
+					{
+						return mFirstRep[ inCell ];
+					}
+		
+		TQ3Uns32	NextRepresentative( TQ3Uns32 inPointIndex ) const
+					{
+						return mNextRep[ inPointIndex ];
+					}
+		
+		void		AddRepresentative( TQ3Uns32 inPointIndex );
+
+	private:
+		TQ3Int32	CellCoordinate( float inValue, double inMin ) const;
+	
+		double					mInvCellSize;
+		std::vector<TQ3Uns32>	mCellOfPoint;
+		std::vector<CellKey>	mCellKeys;
+		std::vector<TQ3Uns32>	mFirstRep;
+		std::vector<TQ3Uns32>	mLastRep;
+		std::vector<TQ3Uns32>	mNextRep;
+	};
+}
+
+PointGrid::PointGrid( const TQ3Point3D* inPoints, TQ3Uns32 inNumPoints,
+						float inCellSize )
+	: mCellOfPoint( inNumPoints )
+	, mNextRep( inNumPoints, kNoIndex )
+{
+	// Bounds of the finite points
+	double	minCoord[3] = { 0.0, 0.0, 0.0 };
+	double	maxCoord[3] = { 0.0, 0.0, 0.0 };
+	bool	haveBounds = false;
+	TQ3Uns32	i, axis;
+	
+	for (i = 0; i < inNumPoints; ++i)
+	{
+		const float*	coords = &inPoints[i].x;
+		
+		if ( std::fabs( coords[0] ) <= kQ3MaxFloat &&
+			std::fabs( coords[1] ) <= kQ3MaxFloat &&
+			std::fabs( coords[2] ) <= kQ3MaxFloat )
+		{
+			for (axis = 0; axis < 3; ++axis)
+			{
+				if ( (! haveBounds) || (coords[axis] < minCoord[axis]) )
+					minCoord[axis] = coords[axis];
+				if ( (! haveBounds) || (coords[axis] > maxCoord[axis]) )
+					maxCoord[axis] = coords[axis];
+			}
+			haveBounds = true;
+		}
+	}
+	
+	
+	// The cell is made a little larger than the threshold so that rounding
+	// in the distance test can never pair points two cells apart.  Larger
+	// cells only add candidates, so clamping the cell count is also safe.
+	double	cellSize = inCellSize * 1.0001;
+	for (axis = 0; axis < 3; ++axis)
+	{
+		double	extent = maxCoord[axis] - minCoord[axis];
+		if (extent / cellSize > kMaxCellsPerAxis)
+			cellSize = extent / kMaxCellsPerAxis;
+	}
+	mInvCellSize = 1.0 / cellSize;
+	
+	
+	// Sort the points by cell, and number the distinct cells
+	std::vector<KeyedPoint>	keyed( inNumPoints );
+	for (i = 0; i < inNumPoints; ++i)
+	{
+		keyed[i].key.x = CellCoordinate( inPoints[i].x, minCoord[0] );
+		keyed[i].key.y = CellCoordinate( inPoints[i].y, minCoord[1] );
+		keyed[i].key.z = CellCoordinate( inPoints[i].z, minCoord[2] );
+		keyed[i].index = i;
+	}
+	std::sort( keyed.begin(), keyed.end() );
+	
+	for (i = 0; i < inNumPoints; ++i)
+	{
+		if ( mCellKeys.empty() || ! (mCellKeys.back() == keyed[i].key) )
+			mCellKeys.push_back( keyed[i].key );
+		mCellOfPoint[ keyed[i].index ] = static_cast<TQ3Uns32>(mCellKeys.size() - 1);
+	}
+	
+	
+	const TQ3Uns32	kNumCells = static_cast<TQ3Uns32>(mCellKeys.size());
+	mFirstRep.resize( kNumCells, kNoIndex );
+	mLastRep.resize( kNumCells, kNoIndex );
+}
+
+TQ3Uns32	PointGrid::NeighbourCells( TQ3Uns32 inPointIndex,
+										TQ3Uns32 outCells[27] ) const
+{
+	// The cells are sorted by x, then y, then z, so for each of the 9
+	// columns of neighbours the cells z-1, z and z+1 that exist are
+	// consecutive, starting from the first cell not below z-1.
+	const CellKey&	theCell = mCellKeys[ mCellOfPoint[ inPointIndex ] ];
+	TQ3Uns32	numCells = 0;
+	CellKey		theKey;
+	
+	theKey.z = theCell.z - 1;
+	
+	for (TQ3Int32 dx = -1; dx <= 1; ++dx)
+	{
+		for (TQ3Int32 dy = -1; dy <= 1; ++dy)
+		{
+			theKey.x = theCell.x + dx;
+			theKey.y = theCell.y + dy;
+			
+			std::vector<CellKey>::const_iterator	found =
+				std::lower_bound( mCellKeys.begin(), mCellKeys.end(), theKey );
+			
+			while ( (found != mCellKeys.end()) && (found->x == theKey.x) &&
+				(found->y == theKey.y) && (found->z <= theCell.z + 1) )
+			{
+				outCells[ numCells++ ] = static_cast<TQ3Uns32>(found - mCellKeys.begin());
+				++found;
+			}
+		}
+	}
+	
+	return numCells;
+}
+
+TQ3Int32	PointGrid::CellCoordinate( float inValue, double inMin ) const
+{
+	double	cell = std::floor( (inValue - inMin) * mInvCellSize );
+	
+	// Also catches NaN, which cannot match anything anyway
+	if (! (cell >= 0.0))
+		cell = 0.0;
+	else if (cell > kMaxCellsPerAxis)
+		cell = kMaxCellsPerAxis;
+	
+	return static_cast<TQ3Int32>(cell);
+}
+
+void	PointGrid::AddRepresentative( TQ3Uns32 inPointIndex )
+{
+	TQ3Uns32	theCell = mCellOfPoint[ inPointIndex ];
+	
+	if (mLastRep[ theCell ] == kNoIndex)
+		mFirstRep[ theCell ] = inPointIndex;
+	else
+		mNextRep[ mLastRep[ theCell ] ] = inPointIndex;
+	
+	mLastRep[ theCell ] = inPointIndex;
+}
+
 
 /*!
 	@function	MergeNearTriMeshPoints
@@ -71,8 +280,12 @@
 				normal and UV, it will be discarded.  We assume that the normal
 				vectors are unit length.
 				
-				The time taken by the algorithm is approximately proportional to
-				the square of the number of points.
+				Candidate points are found through a uniform grid whose cells
+				are the size of the distance threshold, so the time taken is
+				roughly proportional to n log n for points that are spread out
+				in space.  Points are still clustered in index order, each one
+				joining the lowest-numbered earlier cluster that it matches,
+				exactly as a comparison against every earlier point would.
 	
 	@param		ioMesh					A TriMesh object to be updated.
 	@param		inDistanceThreshold		If the distance between two points is
@@ -123,34 +336,51 @@ TQ3Uns32	MergeNearTriMeshPoints( TQ3GeometryObject ioMesh,
 			std::vector<TQ3Uns32>	firstOfCluster( kNumOrigPoints );
 			TQ3Uns32	i, j;
 			
-			for (i = 0; i < kNumOrigPoints; ++i)
+			// Only the square of the distance threshold is compared, so a
+			// negative threshold acts as its magnitude, and a zero threshold
+			// can never be met
+			const float	kCellSize = std::fabs( inDistanceThreshold );
+			
+			if ( (kNumOrigPoints > 1) && (kCellSize > 0.0f) )
 			{
-				firstOfCluster[i] = i;	// until further notice
-
-			#if PP_Debug
-				TQ3Point3D	pt_i = points[i];	// debug
-				TQ3Param2D	uv_i = uvArray[i];
-				TQ3Vector3D	norm_i = normalArray[i];
-			#endif
+				PointGrid	theGrid( points, kNumOrigPoints, kCellSize );
 				
-				for (j = 0; j < i; ++j)
+				for (i = 0; i < kNumOrigPoints; ++i)
 				{
-					if (firstOfCluster[j] == j)
+					firstOfCluster[i] = i;	// until further notice
+					
+					// Look for the lowest-numbered matching representative in
+					// the neighbouring cells.  Each cell lists its
+					// representatives in increasing order, so we can stop
+					// scanning a cell at the first match or at the best so far.
+					TQ3Uns32	neighbours[27];
+					TQ3Uns32	numNeighbours = theGrid.NeighbourCells( i, neighbours );
+					
+					for (TQ3Uns32 n = 0; n < numNeighbours; ++n)
 					{
-						// Is point i equivalent to point j?
-						if ( (Q3FastPoint3D_DistanceSquared( &points[i],
-								&points[j] ) < distSqThreshold) &&
-							(Q3FastParam2D_DistanceSquared( &uvArray[i],
-								&uvArray[j] ) < uvSqThreshold) &&
-							(Q3FastVector3D_Dot( &normalArray[i],
-								&normalArray[j] ) > normalDotThreshold )
-						)
+						for (j = theGrid.FirstRepresentative( neighbours[n] );
+							j < firstOfCluster[i];
+							j = theGrid.NextRepresentative( j ))
 						{
-							firstOfCluster[i] = j;
-							pointCountReduction += 1;
-							break;
+							// Is point i equivalent to point j?
+							if ( (Q3FastPoint3D_DistanceSquared( &points[i],
+									&points[j] ) < distSqThreshold) &&
+								(Q3FastParam2D_DistanceSquared( &uvArray[i],
+									&uvArray[j] ) < uvSqThreshold) &&
+								(Q3FastVector3D_Dot( &normalArray[i],
+									&normalArray[j] ) > normalDotThreshold )
+							)
+							{
+								firstOfCluster[i] = j;
+								break;
+							}
 						}
 					}
+					
+					if (firstOfCluster[i] == i)
+						theGrid.AddRepresentative( i );
+					else
+						pointCountReduction += 1;
 				}
 			}
 			
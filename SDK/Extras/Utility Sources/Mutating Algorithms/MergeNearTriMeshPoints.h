@@ -67,8 +67,12 @@ extern "C" {
 				normal and UV, it will be discarded.  We assume that the normal
 				vectors are unit length.
 				
-				The time taken by the algorithm is approximately proportional to
-				the square of the number of points.
+				Candidate points are found through a uniform grid whose cells
+				are the size of the distance threshold, so the time taken is
+				roughly proportional to n log n for points that are spread out
+				in space.  Points are still clustered in index order, each one
+				joining the lowest-numbered earlier cluster that it matches,
+				exactly as a comparison against every earlier point would.
 	
 	@param		ioMesh					A TriMesh object to be updated.
 	@param		inDistanceThreshold		If the distance between two points is
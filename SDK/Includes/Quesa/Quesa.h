@@ -616,6 +616,9 @@ enum {
         kQ3PickTypeWindowPoint                  = Q3_OBJECT_TYPE('p', 'k', 'w', 'p'),
         kQ3PickTypeWindowRect                   = Q3_OBJECT_TYPE('p', 'k', 'w', 'r'),
         kQ3PickTypeWorldRay                     = Q3_OBJECT_TYPE('p', 'k', 'r', 'y'),
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+        kQ3PickTypeWorldRays                    = Q3_OBJECT_TYPE('p', 'k', 'r', 's'),
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
     kQ3ObjectTypeShared                         = Q3_OBJECT_TYPE('s', 'h', 'r', 'd'),
         kQ3SharedTypeRenderer                   = Q3_OBJECT_TYPE('r', 'd', 'd', 'r'),
             kQ3RendererTypeWireFrame            = Q3_OBJECT_TYPE('w', 'r', 'f', 'r'),
@@ -727,6 +730,7 @@ enum {
             kQ3StorageTypeFileStream            = Q3_OBJECT_TYPE('Q', 's', 'f', 's'),
             kQ3StorageTypeUnix                  = Q3_OBJECT_TYPE('u', 'x', 's', 't'),
                 kQ3UnixStorageTypePath          = Q3_OBJECT_TYPE('u', 'n', 'i', 'x'),
+                kQ3UnixStorageTypeMapped        = Q3_OBJECT_TYPE('Q', 'u', 'm', 's'),
             kQ3StorageTypeMacintosh             = Q3_OBJECT_TYPE('m', 'a', 'c', 'n'),
                 kQ3MacintoshStorageTypeFSSpec   = Q3_OBJECT_TYPE('m', 'a', 'c', 'p'),
             kQ3StorageTypeWin32                 = Q3_OBJECT_TYPE('w', 'i', 's', 't'),
@@ -786,6 +790,13 @@ typedef double                                  TQ3Float64;
 	@abstract		Size type.
 */
 typedef TQ3Uns32                                TQ3Size;
+/*!
+	@typedef		TQ3StorageOffset
+	@abstract		Offset or size within a storage object.
+	@discussion		Storage objects may hold more than 4Gb of data, so offsets
+					and sizes within them are 64-bit.
+*/
+typedef unsigned long long                      TQ3StorageOffset;
 
 #if QUESA_HOST_IS_BIG_ENDIAN
 /*!
@@ -1190,6 +1190,51 @@ typedef struct TQ3TriMeshData {
 } TQ3TriMeshData;
 
 
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+/*!
+ *	@struct
+ *      TQ3GeometryCacheStatistics
+ *	@discussion
+ *		Statistics for the cache of decomposed geometries.
+ *
+ *		Geometries which are not supported directly by a renderer are decomposed
+ *		to simpler geometries, which are cached. Each geometry can cache several
+ *		decompositions, for different subdivision styles, orientation styles or
+ *		scales; the decompositions other than the most recently used one share
+ *		a global memory budget.
+ *
+ *		Decompositions of immediate mode geometries are held in a separate cache,
+ *		whose size is set with <code>Q3Geometry_SetImmediateCacheLimits</code>.
+ *
+ *		<em>This structure is not available in QD3D.</em>
+ *	@field		numHits					Number of submits which used a cached decomposition.
+ *	@field		numMisses				Number of submits which found no valid cached decomposition.
+ *	@field		numRebuilds				Number of decompositions which have been built.
+ *	@field		numEvictions			Number of decompositions discarded to stay within the budget.
+ *	@field		numEntries				Number of decompositions held against the budget.
+ *	@field		bytesUsed				Approximate size of the decompositions held against the budget.
+ *	@field		bytesBudget				Memory budget, in bytes.
+ *	@field		numImmediateHits		Number of immediate mode submits which used a cached decomposition.
+ *	@field		numImmediateMisses		Number of immediate mode submits which were decomposed.
+ *	@field		numImmediateEntries		Number of decompositions in the immediate mode cache.
+ */
+typedef struct TQ3GeometryCacheStatistics {
+    TQ3Uns32                                    numHits;
+    TQ3Uns32                                    numMisses;
+    TQ3Uns32                                    numRebuilds;
+    TQ3Uns32                                    numEvictions;
+    TQ3Uns32                                    numEntries;
+    TQ3Uns32                                    bytesUsed;
+    TQ3Uns32                                    bytesBudget;
+    TQ3Uns32                                    numImmediateHits;
+    TQ3Uns32                                    numImmediateMisses;
+    TQ3Uns32                                    numImmediateEntries;
+} TQ3GeometryCacheStatistics;
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
 
 
 
@@ -1557,6 +1602,141 @@ Q3Geometry_GetDecomposed (
 
 
 
+/*!
+ *	@function
+ *		Q3Geometry_GetCacheStatistics
+ *	@discussion
+ *		Get the statistics for the cache of decomposed geometries.
+ *
+ *		The hit, miss, rebuild and eviction counts accumulate from the time
+ *		Quesa is initialised, or from the last call to
+ *		<code>Q3Geometry_ResetCacheStatistics</code>.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *	@param	statistics		Receives the cache statistics.
+ *	@result					Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C( TQ3Status )
+Q3Geometry_GetCacheStatistics (
+	TQ3GeometryCacheStatistics	*statistics
+);
+
+#endif
+
+
+
+/*!
+ *	@function
+ *		Q3Geometry_ResetCacheStatistics
+ *	@discussion
+ *		Reset the hit, miss, rebuild and eviction counts for the cache of
+ *		decomposed geometries.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *	@result					Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C( TQ3Status )
+Q3Geometry_ResetCacheStatistics (
+	void
+);
+
+#endif
+
+
+
+/*!
+ *	@function
+ *		Q3Geometry_SetCacheBudget
+ *	@discussion
+ *		Set the memory budget for the cache of decomposed geometries.
+ *
+ *		The budget applies to the decompositions each geometry keeps for view
+ *		states other than the one it was last submitted with. The least recently
+ *		used decompositions are discarded when the budget is exceeded; passing 0
+ *		limits each geometry to a single cached decomposition.
+ *
+ *		The default budget is 16MB.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *	@param	numBytes		The new budget, in bytes.
+ *	@result					Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C( TQ3Status )
+Q3Geometry_SetCacheBudget (
+	TQ3Uns32					numBytes
+);
+
+#endif
+
+
+
+/*!
+ *	@function
+ *		Q3Geometry_SetImmediateCacheLimits
+ *	@discussion
+ *		Set the size and flush policy of the immediate mode geometry cache.
+ *
+ *		Box, cone, cylinder, disk, ellipse, ellipsoid and torus geometries which
+ *		are submitted in immediate mode are decomposed once, and the result is
+ *		reused while the geometry data, its attribute sets and the relevant view
+ *		state (such as the subdivision style) are unchanged.
+ *
+ *		The least recently used decompositions are discarded when the cache holds
+ *		more than maxEntries of them. A decomposition which has not been used while
+ *		maxIdleFrames rendering loops (of any view) were completed is also discarded;
+ *		passing 0 keeps decompositions until the cache is full.
+ *
+ *		Passing 0 for maxEntries disables the cache. The defaults are 64 entries,
+ *		and 60 frames.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *	@param	maxEntries		The maximum number of cached decompositions.
+ *	@param	maxIdleFrames	The number of frames after which an unused decomposition is discarded.
+ *	@result					Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C( TQ3Status )
+Q3Geometry_SetImmediateCacheLimits (
+	TQ3Uns32					maxEntries,
+	TQ3Uns32					maxIdleFrames
+);
+
+#endif
+
+
+
+/*!
+ *	@function
+ *		Q3Geometry_FlushImmediateCache
+ *	@discussion
+ *		Discard every decomposition in the immediate mode geometry cache.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *	@result					Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C( TQ3Status )
+Q3Geometry_FlushImmediateCache (
+	void
+);
+
+#endif
+
+
+
 /*!
 	@functiongroup	Box Functions
 */
@@ -95,6 +95,12 @@ extern "C" {
  *  @constant kQ3DisplayGroupStateMaskIsWritten            The group will be submitted during writing.
  *	@constant kQ3DisplayGroupStateMaskIsNotForBounding	   The group will not be submitted during bounding.
  *														   (Not in QD3D.)
+ *	@constant kQ3DisplayGroupStateMaskAutoBoundingBox	   The group keeps its own approximate bounding box up to
+ *														   date, recalculating it when the group or its contents
+ *														   have changed, and uses it for culling when rendering.
+ *														   Replaces any bounding box set by hand, and does not
+ *														   include contents which are not submitted for bounding.
+ *														   (Not in QD3D.)
  */
 typedef enum {
     kQ3DisplayGroupStateNone                    = 0,
@@ -107,6 +113,7 @@ typedef enum {
     
 #if QUESA_ALLOW_QD3D_EXTENSIONS
     kQ3DisplayGroupStateMaskIsNotForBounding	= (1 << 6),
+    kQ3DisplayGroupStateMaskAutoBoundingBox		= (1 << 7),
 #endif // QUESA_ALLOW_QD3D_EXTENSIONS
 
     kQ3DisplayGroupStateMaskSize32              = 0xFFFFFFFF
@@ -883,6 +890,36 @@ Q3Group_GetPreviousObjectPosition (
 
 
 
+/*!
+ *  @function
+ *      Q3Group_GetSubtreeEditIndex
+ *  @discussion
+ *      Get the subtree edit index of a group.
+ *
+ *      The subtree edit index changes whenever the group, or any object
+ *		reachable through its members, is edited.  Caches derived from the
+ *		contents of a group can compare this value to decide whether they
+ *		need to be rebuilt, without walking the group themselves.
+ *
+ *		The value itself has no meaning beyond being compared for equality
+ *		with a previous value for the same group.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param group            Group to inspect.
+ *  @result                 The subtree edit index of the group, or 0 on failure.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3Uns32  )
+Q3Group_GetSubtreeEditIndex (
+    TQ3GroupObject                group
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
 /*!
 	@functiongroup Display Groups
 */
@@ -750,14 +750,15 @@ typedef Q3_CALLBACK_API_C(TQ3Status, TQ3FileIdleMethod) (TQ3FileObject theFile,
  *  @field baseDataVersion           The base data version.
  *  @field storage                   The storage object.
  *  @field currentStoragePosition    The current position within the storage object.
+ *                                   Positions are 64-bit, so files may be larger than 4Gb.
  *  @field logicalEOF                The number of bytes in the storage object.
  */
 typedef struct TQ3FFormatBaseData {
     // Initialised by Quesa
     TQ3Uns32                                    baseDataVersion;
     TQ3StorageObject                            storage;
-    TQ3Uns32                                    currentStoragePosition;
-    TQ3Uns32                                    logicalEOF;
+    TQ3StorageOffset                            currentStoragePosition;
+    TQ3StorageOffset                            logicalEOF;
 
 
     // Initialised by the importer
@@ -75,6 +75,13 @@ extern "C" {
 #define	kQ3MemoryStatisticsStructureVersion	1
 
 
+/*!
+	@constant	kQ3InstancePoolStatisticsStructureVersion
+	@abstract	Current version of TQ3InstancePoolStatistics structure.
+*/
+#define	kQ3InstancePoolStatisticsStructureVersion	1
+
+
 
 
 
@@ -102,6 +109,32 @@ typedef struct TQ3MemoryStatistics
 } TQ3MemoryStatistics;
 
 
+/*!
+	@struct		TQ3InstancePoolStatistics
+	@abstract	Parameter structure for Q3Memory_GetInstancePoolStatistics.
+	@discussion	Objects are allocated from pools of fixed size items, shared by
+				all classes whose instances round up to the same item size.
+	@field		structureVersion	Version of this structure.
+									Initialize to kQ3InstancePoolStatisticsStructureVersion.
+	@field		numInstances		Current number of instances of the class.
+	@field		itemSize			Size in bytes of the items in the class's pool, or 0 if
+									instances of the class are too large to be pooled.
+	@field		numBlocks			Number of blocks of items allocated by the pool.
+	@field		numItems			Number of items in those blocks.
+	@field		numItemsInUse		Number of items not in the pool's free list. This includes
+									items kept by each thread for reuse.
+*/
+typedef struct TQ3InstancePoolStatistics
+{
+	TQ3Uns32	structureVersion;
+	TQ3Uns32	numInstances;
+	TQ3Uns32	itemSize;
+	TQ3Uns32	numBlocks;
+	TQ3Uns32	numItems;
+	TQ3Uns32	numItemsInUse;
+} TQ3InstancePoolStatistics;
+
+
 
 
 
@@ -527,6 +560,36 @@ Q3Memory_GetStatistics(
 
 
 
+/*!
+ *	@function
+ *		Q3Memory_GetInstancePoolStatistics
+ *	@abstract
+ *		Get information about the memory used for instances of a class.
+ *
+ *	@discussion
+ *		Retrieve the occupancy of the pool from which instances of a class
+ *		are allocated. Unlike Q3Memory_GetStatistics, this function is
+ *		available in all builds.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *	@param		classType	The class to query.
+ *	@param		info		Structure to receive the statistics.  You must initialize
+ *							the structureVersion field to kQ3InstancePoolStatisticsStructureVersion.
+ *	@result		Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3Status )
+Q3Memory_GetInstancePoolStatistics(
+	TQ3ObjectType				classType,
+	TQ3InstancePoolStatistics*	info
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
 /*!
  *  @function
  *      Q3SlabMemory_New
@@ -109,9 +109,15 @@ extern "C" {
  *													 Data type: TQ3Param2D.
  *	@constant kQ3PickDetailMaskTriMeshFace			 The The 0-based index of the TriMesh face that
  *													 was hit.  Not in QuickDraw 3D.
+ *													 Boxes and quadrics are normally picked against
+ *													 their exact surfaces; requesting this detail
+ *													 picks their decomposed TriMesh instead.
  *													 Data type: TQ3Uns32.
  *	@constant kQ3PickDetailMaskBarycentric			 The barycentric coordinates of a picked point within
  *													 a triangle.  Not available for points, lines etc.
+ *													 As with kQ3PickDetailMaskTriMeshFace, requesting
+ *													 this detail picks boxes and quadrics through their
+ *													 decomposed TriMesh.
  *													 Not in QuickDraw 3D.
  *													 Data type: TQ3Param3D.
  */
@@ -253,6 +259,43 @@ typedef struct TQ3WorldRayPickData {
 } TQ3WorldRayPickData;
 
 
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+/*!
+ *  @struct
+ *      TQ3WorldRaysPickData
+ *  @discussion
+ *      Describes the state for a world-rays pick object.
+ *
+ *		A world-rays pick tests many rays against a scene in a single
+ *		submit loop, and keeps a separate hit list for each ray.
+ *
+ *		<em>This structure is not available in QD3D.</em>
+ *
+ *  @field data             The common state for the pick, applied to each ray.
+ *  @field numRays          The number of rays.
+ *  @field rays             The pick rays in world coordinates.  The directions
+ *							must be normalized.  The rays are copied when the
+ *							pick is created.
+ *  @field vertexTolerance  The vertex tolerance.  Only relevant to picking Point objects.
+ *  @field edgeTolerance    The edge tolerance.  Only relevant to picking one-dimensional
+ *							objects such as Lines and PolyLines.
+ *  @field numThreads       The most threads to test the rays of a TriMesh on.  0 or 1
+ *							tests every ray on the picking thread.  The hits found
+ *							do not depend on the number of threads.
+ */
+typedef struct TQ3WorldRaysPickData {
+    TQ3PickData                                 data;
+    TQ3Uns32                                    numRays;
+    const TQ3Ray3D                              *rays;
+    float                                       vertexTolerance;
+    float                                       edgeTolerance;
+    TQ3Uns32                                    numThreads;
+} TQ3WorldRaysPickData;
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
 /*!
  *  @struct
  *      TQ3HitPath
@@ -813,6 +856,144 @@ Q3WorldRayPick_SetData (
     const TQ3WorldRayPickData     *data
 );
 
+
+
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+/*!
+	@functiongroup	World Rays Picking
+*/
+
+/*!
+ *  @function
+ *      Q3WorldRaysPick_New
+ *  @discussion
+ *      Create a new world-rays pick object.
+ *
+ *		A world-rays pick finds the hits of many world rays with a single
+ *		submit loop. Each geometry is tested against every ray whose path
+ *		might reach it, and each ray collects its own list of hits, sorted
+ *		and limited as described by the common pick data.
+ *
+ *		The hits of each ray are read with Q3WorldRaysPick_GetNumHits,
+ *		Q3WorldRaysPick_GetPickDetailValidMask and Q3WorldRaysPick_GetPickDetailData.
+ *		Q3Pick_GetNumHits returns the total number of hits of every ray, and
+ *		Q3Pick_EmptyHitList empties the hit lists of every ray.
+ *
+ *		If the data asks for more than one thread, the rays which reach a
+ *		TriMesh are shared between that many threads, started and finished
+ *		while the TriMesh is submitted. The scene must not be edited while
+ *		it is picked, and each thread only adds hits to its own rays.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *  @param data             The data for the pick object.
+ *  @result                 The new pick object.
+ */
+Q3_EXTERN_API_C ( TQ3PickObject  )
+Q3WorldRaysPick_New (
+    const TQ3WorldRaysPickData    *data
+);
+
+
+
+/*!
+ *  @function
+ *      Q3WorldRaysPick_GetNumRays
+ *  @discussion
+ *      Get the number of rays of a world-rays pick object.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *  @param pick             The pick object to query.
+ *  @param numRays          Receives the number of rays of the pick object.
+ *  @result                 Success or failure of the operation.
+ */
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3WorldRaysPick_GetNumRays (
+    TQ3PickObject                 pick,
+    TQ3Uns32                      *numRays
+);
+
+
+
+/*!
+ *  @function
+ *      Q3WorldRaysPick_GetNumHits
+ *  @discussion
+ *      Get the number of hits of one ray of a world-rays pick object.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *  @param pick             The pick object to query.
+ *  @param rayIndex         The index of the ray to query.
+ *  @param numHits          Receives the number of hits of the ray.
+ *  @result                 Success or failure of the operation.
+ */
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3WorldRaysPick_GetNumHits (
+    TQ3PickObject                 pick,
+    TQ3Uns32                      rayIndex,
+    TQ3Uns32                      *numHits
+);
+
+
+
+/*!
+ *  @function
+ *      Q3WorldRaysPick_GetPickDetailValidMask
+ *  @discussion
+ *      Get the pick details available for a hit of one ray of a
+ *      world-rays pick object.
+ *
+ *		As Q3Pick_GetPickDetailValidMask, for the hit list of a single ray.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *  @param pick             The pick object to query.
+ *  @param rayIndex         The index of the ray to query.
+ *  @param hitIndex         The index of the hit within the hits of the ray.
+ *  @param pickDetailValidMask  Receives the pick details available for the hit.
+ *  @result                 Success or failure of the operation.
+ */
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3WorldRaysPick_GetPickDetailValidMask (
+    TQ3PickObject                 pick,
+    TQ3Uns32                      rayIndex,
+    TQ3Uns32                      hitIndex,
+    TQ3PickDetail                 *pickDetailValidMask
+);
+
+
+
+/*!
+ *  @function
+ *      Q3WorldRaysPick_GetPickDetailData
+ *  @discussion
+ *      Get a pick detail for a hit of one ray of a world-rays pick object.
+ *
+ *		As Q3Pick_GetPickDetailData, for the hit list of a single ray.
+ *
+ *		<em>This function is not available in QD3D.</em>
+ *
+ *  @param pick             The pick object to query.
+ *  @param rayIndex         The index of the ray to query.
+ *  @param hitIndex         The index of the hit within the hits of the ray.
+ *  @param pickDetailValue  The pick detail to return.
+ *  @param detailData       Receives the pick detail data.
+ *  @result                 Success or failure of the operation.
+ */
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3WorldRaysPick_GetPickDetailData (
+    TQ3PickObject                 pick,
+    TQ3Uns32                      rayIndex,
+    TQ3Uns32                      hitIndex,
+    TQ3PickDetail                 pickDetailValue,
+    void                          *detailData
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
 /*!
 	@functiongroup	Object Parts
 */
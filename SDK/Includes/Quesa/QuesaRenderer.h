@@ -415,6 +415,7 @@ typedef enum TQ3XDrawContextValidationMasks {
  *  @constant kQ3XMethodTypeRendererPush                                        Push the renderer state.
  *  @constant kQ3XMethodTypeRendererPop                                         Pop the renderer state.
  *  @constant kQ3XMethodTypeRendererIsBoundingBoxVisible                        Is a local-coordinate bounding box visible to the camera?
+ *  @constant kQ3XMethodTypeRendererIsBoundingBoxArrayVisible                   Which of an array of local-coordinate bounding boxes are visible? Not available in QD3D.
  *  @constant kQ3XMethodTypeRendererSubmitGeometryMetaHandler                   Meta-handler for geometry methods.
  *  @constant kQ3XMethodTypeRendererSubmitCameraMetaHandler                     Meta-handler for camera methods.
  *  @constant kQ3XMethodTypeRendererSubmitLightMetaHandler                      Meta-handler for light methods.
@@ -447,6 +448,9 @@ typedef enum TQ3XMethodTypeRenderer {
     kQ3XMethodTypeRendererPush                                      = Q3_METHOD_TYPE('r', 'd', 'p', 's'),
     kQ3XMethodTypeRendererPop                                       = Q3_METHOD_TYPE('r', 'd', 'p', 'o'),
     kQ3XMethodTypeRendererIsBoundingBoxVisible                      = Q3_METHOD_TYPE('r', 'd', 'b', 'x'),
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+    kQ3XMethodTypeRendererIsBoundingBoxArrayVisible                 = Q3_METHOD_TYPE('r', 'd', 'b', 'a'),
+#endif
     kQ3XMethodTypeRendererSubmitGeometryMetaHandler                 = Q3_METHOD_TYPE('r', 'd', 'g', 'm'),
     kQ3XMethodTypeRendererSubmitCameraMetaHandler                   = Q3_METHOD_TYPE('r', 'd', 'c', 'm'),
     kQ3XMethodTypeRendererSubmitLightMetaHandler                    = Q3_METHOD_TYPE('r', 'd', 'l', 'g'),
@@ -861,6 +865,47 @@ typedef Q3_CALLBACK_API_C(TQ3Boolean,          TQ3XRendererIsBoundingBoxVisibleM
                             const TQ3BoundingBox    *theBounds);
 
 
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+/*!
+ *  @typedef
+ *      TQ3XRendererIsBoundingBoxArrayVisibleMethod
+ *  @abstract
+ *      Test an array of local-coordinate bounding boxes for visibility.
+ *
+ *  @discussion
+ *      Renderers should set the bit for each bounding box that would affect
+ *		the current rendering pass, and clear the bits of the others.  Box i
+ *		corresponds to bit (i % 32) of visibleMask[i / 32].  This method is
+ *		used for group culling, when several groups can be tested at once.
+ *
+ *      The result for each box should be the one that the renderer's
+ *		TQ3XRendererIsBoundingBoxVisibleMethod would give.  Renderers which
+ *		only test the view frustum can use
+ *		<code>Q3View_IsBoundingBoxArrayVisible</code>.
+ *
+ *      This method is optional.  If it is not supplied, Quesa will call the
+ *		TQ3XRendererIsBoundingBoxVisibleMethod for each box.
+ *
+ *      <em>This method is not available in QD3D.</em>
+ *
+ *  @param theView          The view being rendered to.
+ *  @param rendererPrivate  Renderer-specific instance data.
+ *  @param numBounds        The number of bounding boxes.
+ *  @param theBounds        The local bounding boxes to test.
+ *  @param visibleMask      Receives the visibility of the bounding boxes.
+ *  @result                 Success or failure of the callback.
+ */
+typedef Q3_CALLBACK_API_C(TQ3Status,           TQ3XRendererIsBoundingBoxArrayVisibleMethod)(
+                            TQ3ViewObject           theView,
+                            void                    *rendererPrivate,
+                            TQ3Uns32                numBounds,
+                            const TQ3BoundingBox    *theBounds,
+                            TQ3Uns32                *visibleMask);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
 /*!
  *  @typedef
  *      TQ3XRendererSubmitGeometryMetaHandlerMethod
@@ -866,6 +866,14 @@ Q3XAttributeClass_Register (
  *      For attributes of type kQ3AttributeTypeXXX, the internal attribute data
  *      is currently identical to the data structured passed to Q3AttributeSet_Add.
  *
+ *      The pointer is only valid until the attribute set is next changed. Quesa
+ *      may change an attribute set between the geometries it submits to a
+ *      renderer: the triangles of a decomposed TriMesh share one triangle set
+ *      and one set per vertex, which are updated in place for each triangle.
+ *      A renderer which needs the data after its geometry method returns must
+ *      copy it, or take a reference to the set with Q3Shared_GetReference. A
+ *      set which a renderer holds a reference to is not changed again.
+ *
  *      This function should only be called from renderer plug-ins.
  *
  *  @param attributeSet     The attribute set to query.
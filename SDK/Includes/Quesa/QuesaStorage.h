@@ -187,6 +187,103 @@ Q3Storage_SetData (
 );
 
 
+
+/*!
+ *  @function
+ *      Q3Storage_GetSize64
+ *  @discussion
+ *      Get the size of the data in a storage object, which may be larger
+ *		than 4Gb.
+ *
+ *		Storage classes which can only express 32-bit sizes are asked for
+ *		their 32-bit size.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param storage          The storage object.
+ *  @param size             On output, receives the size.
+ *  @result                 Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3Storage_GetSize64 (
+    TQ3StorageObject              storage,
+    TQ3StorageOffset              *size
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
+/*!
+ *  @function
+ *      Q3Storage_GetData64
+ *  @discussion
+ *      Read some data from a storage object, at an offset which may be
+ *		past 4Gb.
+ *
+ *		Storage classes which can only express 32-bit offsets fail to read
+ *		past 4Gb.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param storage          The storage object.
+ *  @param offset           Starting offset of the data to be retrieved.
+ *  @param dataSize         Number of bytes of data to get.
+ *  @param data             Buffer to receive the data.
+ *  @param sizeRead         On output, number of bytes actually received.
+ *  @result                 Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3Storage_GetData64 (
+    TQ3StorageObject              storage,
+    TQ3StorageOffset              offset,
+    TQ3Uns32                      dataSize,
+    unsigned char                 *data,
+    TQ3Uns32                      *sizeRead
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
+/*!
+ *  @function
+ *      Q3Storage_SetData64
+ *  @discussion
+ *      Write some data to a storage object, at an offset which may be
+ *		past 4Gb.
+ *
+ *		Storage classes which can only express 32-bit offsets fail to write
+ *		past 4Gb.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param storage          The storage object.
+ *  @param offset           The offset at which to begin writing new data.
+ *  @param dataSize         Number of bytes of data to be written.
+ *  @param data             Data to be written.
+ *  @param sizeWritten      On output, number of bytes actually written,
+ *							normally the same as dataSize.
+ *  @result                 Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3Storage_SetData64 (
+    TQ3StorageObject              storage,
+    TQ3StorageOffset              offset,
+    TQ3Uns32                      dataSize,
+    const unsigned char           *data,
+    TQ3Uns32                      *sizeWritten
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
 /*!
 	@functiongroup Memory Storage
 */
@@ -948,6 +1045,33 @@ Q3UnixPathStorage_Get (
     char                          *pathName
 );
 
+
+
+/*!
+ *  @function
+ *      Q3UnixMappedStorage_New
+ *  @discussion
+ *      Create a read-only storage object which maps a file into memory.
+ *
+ *		The file is mapped when the storage is opened for reading, and reads
+ *		are copied straight from the mapping. This is usually the fastest way
+ *		to read a large file, and files larger than 4Gb can be mapped on
+ *		64-bit systems. Opening the storage for writing fails.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param pathName        A NULL-terminated file system path.
+ *  @result                The new storage object.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3StorageObject  )
+Q3UnixMappedStorage_New (
+    const char                    *pathName
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
 #endif // QUESA_OS_UNIX
 
 
@@ -791,6 +791,43 @@ Q3View_IsBoundingBoxVisible (
 
 
 
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+/*!
+ *  @function
+ *      Q3View_IsBoundingBoxArrayVisible
+ *  @abstract
+ *      Test an array of bounding boxes for visibility.
+ *
+ *  @discussion
+ *      Each bounding box (assumed to be in local coordinates) is tested for
+ *		intersection with the view frustum of the camera currently associated
+ *		with the view, as with Q3View_IsBoundingBoxVisible.  Testing many
+ *		boxes in one call is faster than testing them one at a time.
+ *
+ *		Box i is visible if bit (i % 32) of visibleMask[i / 32] is set, so
+ *		visibleMask must have room for (numBoxes + 31) / 32 words.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param view             The view to check the bounding boxes against.
+ *  @param numBoxes         The number of bounding boxes.
+ *  @param bboxes           The local bounding boxes to test.
+ *  @param visibleMask      Receives the visibility of the bounding boxes.
+ *  @result                 Success or failure of the operation.
+ */
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3View_IsBoundingBoxArrayVisible (
+    TQ3ViewObject                 view,
+    TQ3Uns32                      numBoxes,
+    const TQ3BoundingBox          *bboxes,
+    TQ3Uns32                      *visibleMask
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
 /*!
  *  @function
  *      Q3View_AllowAllGroupCulling
@@ -812,6 +849,50 @@ Q3View_AllowAllGroupCulling (
 
 
 
+/*!
+ *  @function
+ *      Q3View_AllowPassReplay
+ *  @discussion
+ *      Set the pass replay state of a view.
+ *
+ *      Renderers which need several passes over the scene (e.g., to render
+ *      shadows for each light) ask the application to re-submit the scene
+ *      by returning kQ3ViewStatusRetraverse from Q3View_EndRendering.
+ *
+ *      If pass replay is active, the view records the state changes and
+ *      geometries submitted during the first pass of a rendering loop, and
+ *      plays them back to the renderer for any further passes it requests
+ *      within the same Q3View_EndRendering call. The application's submit
+ *      loop will then only run once per frame.
+ *
+ *      Group culling is re-evaluated for each replayed pass. Any other
+ *      per-pass decisions made by the application's submit code (such as
+ *      culling objects with Q3View_IsBoundingBoxVisible) will be fixed by
+ *      the first pass, and so such applications should not enable replay.
+ *
+ *      If a pass can not be recorded, the view falls back to returning
+ *      kQ3ViewStatusRetraverse to the application.
+ *
+ *      Pass replay is off by default.
+ *
+ *      <em>This function is not available in QD3D.</em>
+ *
+ *  @param view             The view to update.
+ *  @param allowReplay      The new pass replay state for the view.
+ *  @result                 Success or failure of the operation.
+ */
+#if QUESA_ALLOW_QD3D_EXTENSIONS
+
+Q3_EXTERN_API_C ( TQ3Status  )
+Q3View_AllowPassReplay (
+    TQ3ViewObject                 view,
+    TQ3Boolean                    allowReplay
+);
+
+#endif // QUESA_ALLOW_QD3D_EXTENSIONS
+
+
+
 /*!
  *  @function
  *      Q3View_TransformLocalToWorld